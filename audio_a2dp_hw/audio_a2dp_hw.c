@@ -33,6 +33,8 @@
 #include <sys/poll.h>
 #include <sys/errno.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <cutils/str_parms.h>
@@ -97,6 +99,8 @@ struct a2dp_stream_out {
     pthread_mutex_t         lock;
     int                     ctrl_fd;
     int                     audio_fd;
+    tA2DP_SHM_HDR           *shm;       /* pcm ring offered by the stack, NULL on socket */
+    int                     shm_evtfd;
     size_t                  buffer_sz;
     a2dp_state_t            state;
     struct a2dp_config      cfg;
@@ -243,6 +247,169 @@ static int skt_write(int fd, const void *p, size_t len)
     return sent;
 }
 
+/*****************************************************************************
+**
+**   shared memory pcm ring
+**
+*****************************************************************************/
+
+/* picks up the ring the stack offers right after accepting the data socket.
+   a stack without a ring says so at once; one without shm support at all
+   sends nothing, and the socket is used after the offer timeout */
+static int shm_attach(struct a2dp_stream_out *out)
+{
+    char cmsg_buf[CMSG_SPACE(2 * sizeof(int))];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    struct pollfd pfd;
+    unsigned int magic = 0;
+    int fds[2];
+    void *map;
+
+    pfd.fd = out->audio_fd;
+    pfd.events = POLLIN;
+
+    if (poll(&pfd, 1, A2DP_SHM_OFFER_TMO_MS) <= 0)
+    {
+        INFO("no shm offer, using socket");
+        return -1;
+    }
+
+    iov.iov_base = &magic;
+    iov.iov_len = sizeof(magic);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+
+    if (recvmsg(out->audio_fd, &msg, MSG_DONTWAIT) != sizeof(magic))
+        return -1;
+
+    if (magic == A2DP_SHM_MAGIC_NONE)
+    {
+        INFO("no shm ring offered, using socket");
+        return -1;
+    }
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if ((cmsg == NULL) || (cmsg->cmsg_type != SCM_RIGHTS) ||
+        (cmsg->cmsg_len != CMSG_LEN(sizeof(fds))))
+    {
+        ERROR("shm offer without fds");
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    if (magic != A2DP_SHM_MAGIC)
+    {
+        ERROR("bad shm offer 0x%x", magic);
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    map = mmap(NULL, A2DP_SHM_HDR_SZ + A2DP_SHM_RING_SZ, PROT_READ | PROT_WRITE,
+               MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+
+    if ((map == MAP_FAILED) || (((tA2DP_SHM_HDR *)map)->ring_sz != A2DP_SHM_RING_SZ))
+    {
+        ERROR("shm map failed (%s)", strerror(errno));
+        if (map != MAP_FAILED)
+            munmap(map, A2DP_SHM_HDR_SZ + A2DP_SHM_RING_SZ);
+        close(fds[1]);
+        return -1;
+    }
+
+    out->shm = (tA2DP_SHM_HDR *)map;
+    out->shm_evtfd = fds[1];
+    out->shm->attached = 1;
+    __sync_synchronize();
+
+    INFO("writing pcm through shm ring (%d bytes)", A2DP_SHM_RING_SZ);
+    return 0;
+}
+
+static void shm_detach(struct a2dp_stream_out *out)
+{
+    if (out->shm == NULL)
+        return;
+
+    munmap(out->shm, A2DP_SHM_HDR_SZ + A2DP_SHM_RING_SZ);
+    close(out->shm_evtfd);
+    out->shm = NULL;
+    out->shm_evtfd = AUDIO_SKT_DISCONNECTED;
+}
+
+/* same contract as skt_write : blocks up to 500 ms for room, then returns
+   what was written, -1 once the stack went away */
+static int shm_write(struct a2dp_stream_out *out, const void *p, size_t len)
+{
+    tA2DP_SHM_HDR *shm = out->shm;
+    /* keep no more queued than the socket send buffer would */
+    unsigned int capacity = out->buffer_sz * 2;
+    unsigned int space, offset, first, n;
+    uint64_t ring = 1;
+    struct pollfd pfd;
+    size_t done = 0;
+    int waited_us = 0;
+    int delay_us;
+
+    FNLOG();
+
+    if (capacity > A2DP_SHM_RING_SZ)
+        capacity = A2DP_SHM_RING_SZ;
+
+    /* the stack closes the socket when the channel goes down */
+    pfd.fd = out->audio_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 0) > 0)
+        return -1;
+
+    ts_log("shm_write", len, NULL);
+
+    while (done < len)
+    {
+        __sync_synchronize();
+        space = capacity - (shm->wr_idx - shm->rd_idx);
+
+        if ((int)space <= 0)
+        {
+            if (waited_us >= 500000)
+                break;
+
+            delay_us = calc_audiotime(out->cfg, len - done);
+            if (delay_us > 20000)
+                delay_us = 20000;
+            usleep(delay_us);
+            waited_us += delay_us;
+            continue;
+        }
+
+        n = ((len - done) < space) ? (len - done) : space;
+        offset = shm->wr_idx & (A2DP_SHM_RING_SZ - 1);
+        first = A2DP_SHM_RING_SZ - offset;
+        if (first > n)
+            first = n;
+
+        memcpy((uint8_t *)shm + A2DP_SHM_HDR_SZ + offset, (const uint8_t *)p + done, first);
+        memcpy((uint8_t *)shm + A2DP_SHM_HDR_SZ, (const uint8_t *)p + done + first, n - first);
+
+        /* publish the pcm before the index, then ring if the stack sleeps */
+        __sync_synchronize();
+        shm->wr_idx += n;
+        done += n;
+        __sync_synchronize();
+
+        if (shm->rd_waiting)
+            write(out->shm_evtfd, &ring, sizeof(ring));
+    }
+
+    return done;
+}
+
 static int skt_disconnect(int fd)
 {
     INFO("fd %d", fd);
@@ -313,6 +480,8 @@ static void a2dp_stream_out_init(struct a2dp_stream_out *out)
 
     out->ctrl_fd = AUDIO_SKT_DISCONNECTED;
     out->audio_fd = AUDIO_SKT_DISCONNECTED;
+    out->shm = NULL;
+    out->shm_evtfd = AUDIO_SKT_DISCONNECTED;
     out->state = AUDIO_A2DP_STATE_STOPPED;
 
     out->cfg.channel_flags = AUDIO_STREAM_DEFAULT_CHANNEL_FLAG;
@@ -353,6 +522,8 @@ static int start_audio_datapath(struct a2dp_stream_out *out)
             return -1;
         }
 
+        shm_attach(out);
+
         out->state = AUDIO_A2DP_STATE_STARTED;
     }
 
@@ -383,6 +554,7 @@ static int stop_audio_datapath(struct a2dp_stream_out *out)
     out->state = AUDIO_A2DP_STATE_STOPPED;
 
     /* disconnect audio path */
+    shm_detach(out);
     skt_disconnect(out->audio_fd);
     out->audio_fd = AUDIO_SKT_DISCONNECTED;
 
@@ -408,6 +580,7 @@ static int suspend_audio_datapath(struct a2dp_stream_out *out, bool standby)
         out->state = AUDIO_A2DP_STATE_SUSPENDED;
 
     /* disconnect audio path */
+    shm_detach(out);
     skt_disconnect(out->audio_fd);
 
     out->audio_fd = AUDIO_SKT_DISCONNECTED;
@@ -476,10 +649,14 @@ static ssize_t out_write(struct audio_stream_out *stream, const void* buffer,
         return -1;
     }
 
-    sent = skt_write(out->audio_fd, buffer,  bytes);
+    if (out->shm)
+        sent = shm_write(out, buffer, bytes);
+    else
+        sent = skt_write(out->audio_fd, buffer,  bytes);
 
     if (sent == -1)
     {
+        shm_detach(out);
         skt_disconnect(out->audio_fd);
         out->audio_fd = AUDIO_SKT_DISCONNECTED;
         out->state = AUDIO_A2DP_STATE_STOPPED;
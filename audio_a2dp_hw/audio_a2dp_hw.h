@@ -34,6 +34,7 @@
 #define A2DP_AUDIO_HARDWARE_INTERFACE "audio.a2dp"
 #define A2DP_CTRL_PATH "/data/misc/bluedroid/.a2dp_ctrl"
 #define A2DP_DATA_PATH "/data/misc/bluedroid/.a2dp_data"
+#define A2DP_SINK_DATA_PATH "/data/misc/bluedroid/.a2dp_sink_data"
 
 #define AUDIO_STREAM_DEFAULT_RATE          44100
 #define AUDIO_STREAM_DEFAULT_FORMAT        AUDIO_FORMAT_PCM_16_BIT
@@ -41,6 +42,33 @@
 #define AUDIO_STREAM_OUTPUT_BUFFER_SZ      (20*512)
 #define AUDIO_SKT_DISCONNECTED             (-1)
 
+/*
+ * Shared memory pcm transport for the audio data channel.
+ *
+ * When the stack accepts the data socket it sends one message carrying
+ * A2DP_SHM_MAGIC and, as SCM_RIGHTS, a memfd and an eventfd. The memfd holds
+ * a tA2DP_SHM_HDR page followed by A2DP_SHM_RING_SZ bytes of pcm ring. A hal
+ * that maps it sets attached and from then on writes pcm into the ring
+ * instead of the socket; a hal that ignores the offer keeps using the socket.
+ * A stack without a ring to offer sends A2DP_SHM_MAGIC_NONE alone, so the
+ * hal only waits up to A2DP_SHM_OFFER_TMO_MS on a stack that sends nothing.
+ * The eventfd is only rung when the stack has set rd_waiting.
+ */
+#define A2DP_SHM_MAGIC                     0x41324450   /* "A2DP" */
+#define A2DP_SHM_MAGIC_NONE                0x4132444E   /* "A2DN" */
+#define A2DP_SHM_HDR_SZ                    4096
+#define A2DP_SHM_RING_SZ                   32768        /* power of 2 */
+#define A2DP_SHM_OFFER_TMO_MS              200
+
+typedef struct {
+    unsigned int          magic;
+    unsigned int          ring_sz;
+    volatile unsigned int wr_idx;       /* free running, advanced by the hal */
+    volatile unsigned int rd_idx;       /* free running, advanced by the stack */
+    volatile unsigned int attached;     /* hal writes through the ring */
+    volatile unsigned int rd_waiting;   /* stack waits on the eventfd */
+} tA2DP_SHM_HDR;
+
 typedef enum {
     A2DP_CTRL_CMD_NONE,
     A2DP_CTRL_CMD_CHECK_READY,
@@ -627,7 +627,8 @@ static void bta_av_adjust_seps_idx(tBTA_AV_SCB *p_scb)
     {
         APPL_TRACE_DEBUG2("av_handle: %d codec_type: %d",
             p_scb->seps[xx].av_handle, p_scb->seps[xx].codec_type);
-        if(p_scb->seps[xx].av_handle && p_scb->codec_type == p_scb->seps[xx].codec_type)
+        if(p_scb->seps[xx].av_handle && p_scb->codec_type == p_scb->seps[xx].codec_type &&
+            p_scb->tsep == p_scb->seps[xx].tsep)
         {
             p_scb->sep_idx      = xx;
             p_scb->avdt_handle  = p_scb->seps[xx].av_handle;
@@ -935,6 +936,7 @@ void bta_av_cleanup(tBTA_AV_SCB *p_scb, tBTA_AV_DATA *p_data)
     p_scb->cur_psc_mask = 0;
     p_scb->wait = 0;
     p_scb->num_disc_snks = 0;
+    p_scb->tsep = AVDT_TSEP_SRC;
     bta_sys_stop_timer(&p_scb->timer);
     if (p_scb->deregistring)
     {
@@ -986,8 +988,20 @@ void bta_av_config_ind (tBTA_AV_SCB *p_scb, tBTA_AV_DATA *p_data)
     tAVDT_SEP_INFO       *p_info;
     tAVDT_CFG            *p_evt_cfg = &p_data->str_msg.cfg;
     UINT8   psc_mask = (p_evt_cfg->psc_mask | p_scb->cfg.psc_mask);
+    int     xx;
 
     p_scb->avdt_label = p_data->str_msg.msg.hdr.label;
+
+    /* the peer configures one of our end points, take its role */
+    p_scb->tsep = AVDT_TSEP_SRC;
+    for (xx = 0; xx < BTA_AV_MAX_SEPS; xx++)
+    {
+        if (p_scb->seps[xx].av_handle && p_scb->seps[xx].av_handle == p_data->str_msg.handle)
+        {
+            p_scb->tsep = p_scb->seps[xx].tsep;
+            break;
+        }
+    }
     memcpy(p_scb->cfg.codec_info, p_evt_cfg->codec_info, AVDT_CODEC_SIZE);
     p_scb->codec_type = p_evt_cfg->codec_info[BTA_AV_CODEC_TYPE_IDX];
     bta_av_save_addr(p_scb, p_data->str_msg.bd_addr);
@@ -1012,7 +1026,7 @@ void bta_av_config_ind (tBTA_AV_SCB *p_scb, tBTA_AV_DATA *p_data)
         p_info->in_use = 0;
         p_info->media_type = p_scb->media_type;
         p_info->seid = p_data->str_msg.msg.config_ind.int_seid;
-        p_info->tsep = AVDT_TSEP_SNK;
+        p_info->tsep = (p_scb->tsep == AVDT_TSEP_SNK) ? AVDT_TSEP_SRC : AVDT_TSEP_SNK;
         p_scb->role      |= BTA_AV_ROLE_AD_ACP;
         p_scb->cur_psc_mask = p_evt_cfg->psc_mask;
         if (bta_av_cb.features & BTA_AV_FEAT_RCTG)
@@ -1024,12 +1038,24 @@ void bta_av_config_ind (tBTA_AV_SCB *p_scb, tBTA_AV_DATA *p_data)
         p_scb->sep_info_idx = 0;
         APPL_TRACE_DEBUG3("bta_av_config_ind: SEID: %d use_rc: %d cur_psc_mask:0x%x", p_info->seid, p_scb->use_rc, p_scb->cur_psc_mask);
 
-        p_scb->p_cos->setcfg(p_scb->hndl, p_scb->codec_type,
-                             p_evt_cfg->codec_info,
-                             p_info->seid,
-                             p_scb->peer_addr,
-                             p_evt_cfg->num_protect,
-                             p_evt_cfg->protect_info);
+        if (p_scb->tsep == AVDT_TSEP_SNK)
+        {
+            bta_av_co_audio_sink_setconfig(p_scb->hndl, p_scb->codec_type,
+                                           p_evt_cfg->codec_info,
+                                           p_info->seid,
+                                           p_scb->peer_addr,
+                                           p_evt_cfg->num_protect,
+                                           p_evt_cfg->protect_info);
+        }
+        else
+        {
+            p_scb->p_cos->setcfg(p_scb->hndl, p_scb->codec_type,
+                                 p_evt_cfg->codec_info,
+                                 p_info->seid,
+                                 p_scb->peer_addr,
+                                 p_evt_cfg->num_protect,
+                                 p_evt_cfg->protect_info);
+        }
     }
 }
 
@@ -1140,6 +1166,15 @@ void bta_av_setconfig_rsp (tBTA_AV_SCB *p_scb, tBTA_AV_DATA *p_data)
         if (p_scb->cur_psc_mask & AVDT_PSC_DELAY_RPT)
             p_scb->avdt_version = AVDT_VERSION_SYNC;
 
+        if (p_scb->tsep == AVDT_TSEP_SNK)
+        {
+            /* the peer is the source and picked the configuration, its
+             * capabilities are of no use to a sink */
+            p_scb->wait &= ~BTA_AV_WAIT_ACP_CAPS_ON;
+            p_scb->p_cos->disc_res(p_scb->hndl, 1, 0, p_scb->peer_addr);
+            return;
+        }
+
 
         if (p_scb->codec_type == BTA_AV_CODEC_SBC || num > 1)
         {
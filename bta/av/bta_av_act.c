@@ -1896,6 +1896,11 @@ void bta_av_dereg_comp(tBTA_AV_DATA *p_data)
 #endif
                 bta_av_del_sdp_rec(&p_cb->sdp_a2d_handle);
                 bta_sys_remove_uuid(UUID_SERVCLASS_AUDIO_SOURCE);
+                if (p_cb->sdp_a2d_snk_handle)
+                {
+                    bta_av_del_sdp_rec(&p_cb->sdp_a2d_snk_handle);
+                    bta_sys_remove_uuid(UUID_SERVCLASS_AUDIO_SINK);
+                }
             }
         }
         else
@@ -378,6 +378,7 @@ typedef struct
 {
     UINT8               av_handle;      /* AVDTP handle */
     tBTA_AV_CODEC       codec_type;     /* codec type */
+    UINT8               tsep;           /* AVDT_TSEP_SRC or AVDT_TSEP_SNK */
 } tBTA_AV_SEP;
 
 
@@ -485,6 +486,7 @@ typedef struct
     UINT8               num_disc_snks;  /* number of discovered snks */
     UINT8               sep_info_idx;   /* current index into sep_info */
     UINT8               sep_idx;        /* current index into local seps[] */
+    UINT8               tsep;           /* local role of the stream, AVDT_TSEP_SRC or AVDT_TSEP_SNK */
     UINT8               rcfg_idx;       /* reconfig requested index into sep_info */
     UINT8               state;          /* state machine state */
     UINT8               avdt_label;     /* AVDTP label */
@@ -553,6 +555,7 @@ typedef struct
     TIMER_LIST_ENT      sig_tmr;        /* link timer */
     TIMER_LIST_ENT      acp_sig_tmr;    /* timer to monitor signalling when accepting */
     UINT32              sdp_a2d_handle; /* SDP record handle for audio src */
+    UINT32              sdp_a2d_snk_handle; /* SDP record handle for audio snk */
     UINT32              sdp_vdp_handle; /* SDP record handle for video src */
     tBTA_AV_FEAT        features;       /* features mask */
     tBTA_SEC            sec_mask;       /* security mask */
@@ -455,6 +455,36 @@ static void bta_av_a2dp_report_cback(UINT8 handle, AVDT_REPORT_TYPE type,
 }
 #endif
 
+/*******************************************************************************
+**
+** Function         bta_av_sink_data_cback
+**
+** Description      AVDTP data callback of the audio SNK stream end points.
+**                  Hands the media packet to the call-out module, which
+**                  frees it.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_av_sink_data_cback(UINT8 handle, BT_HDR *p_pkt, UINT32 time_stamp, UINT8 m_pt)
+{
+    tBTA_AV_SCB *p_scb;
+    int         xx;
+
+    for (xx = 0; xx < BTA_AV_NUM_STRS; xx++)
+    {
+        p_scb = bta_av_cb.p_scb[xx];
+        if (p_scb && p_scb->avdt_handle == handle && p_scb->tsep == AVDT_TSEP_SNK)
+        {
+            bta_av_co_audio_sink_data(p_scb->hndl, p_pkt, time_stamp);
+            return;
+        }
+    }
+
+    APPL_TRACE_WARNING1("bta_av_sink_data_cback: no stream for handle %d", handle);
+    GKI_freebuf(p_pkt);
+}
+
 /*******************************************************************************
 **
 ** Function         bta_av_api_register
@@ -593,6 +623,7 @@ static void bta_av_api_register(tBTA_AV_DATA *p_data)
                 if(AVDT_CreateStream(&p_scb->seps[index].av_handle, &cs) == AVDT_SUCCESS)
                 {
                     p_scb->seps[index].codec_type = codec_type;
+                    p_scb->seps[index].tsep = AVDT_TSEP_SRC;
                     APPL_TRACE_DEBUG3("audio[%d] av_handle: %d codec_type: %d",
                         index, p_scb->seps[index].av_handle, p_scb->seps[index].codec_type);
                     index++;
@@ -601,6 +632,22 @@ static void bta_av_api_register(tBTA_AV_DATA *p_data)
                     break;
             }
 
+            /* the SNK end point takes the next free seps[] entry */
+            if((bta_av_cb.features & BTA_AV_FEAT_SINK) && index < BTA_AV_MAX_SEPS &&
+                bta_av_co_audio_sink_init(&codec_type, cs.cfg.codec_info,
+                &cs.cfg.num_protect, cs.cfg.protect_info) == TRUE)
+            {
+                cs.tsep = AVDT_TSEP_SNK;
+                cs.p_data_cback = bta_av_sink_data_cback;
+                if(AVDT_CreateStream(&p_scb->seps[index].av_handle, &cs) == AVDT_SUCCESS)
+                {
+                    p_scb->seps[index].codec_type = codec_type;
+                    p_scb->seps[index].tsep = AVDT_TSEP_SNK;
+                    APPL_TRACE_DEBUG3("audio snk[%d] av_handle: %d codec_type: %d",
+                        index, p_scb->seps[index].av_handle, p_scb->seps[index].codec_type);
+                }
+            }
+
             if(!bta_av_cb.reg_audio)
             {
                 /* create the SDP records on the 1st audio channel */
@@ -609,6 +656,14 @@ static void bta_av_api_register(tBTA_AV_DATA *p_data)
                                   A2D_SUPF_PLAYER, bta_av_cb.sdp_a2d_handle);
                 bta_sys_add_uuid(UUID_SERVCLASS_AUDIO_SOURCE);
 
+                if (bta_av_cb.features & BTA_AV_FEAT_SINK)
+                {
+                    bta_av_cb.sdp_a2d_snk_handle = SDP_CreateRecord();
+                    A2D_AddRecord(UUID_SERVCLASS_AUDIO_SINK, p_service_name, NULL,
+                                      A2D_SUPF_HEADPHONE, bta_av_cb.sdp_a2d_snk_handle);
+                    bta_sys_add_uuid(UUID_SERVCLASS_AUDIO_SINK);
+                }
+
                 /* start listening when A2DP is registered */
                 if (bta_av_cb.features & BTA_AV_FEAT_RCTG)
                     bta_av_rc_create(&bta_av_cb, AVCT_ACP, 0, BTA_AV_NUM_LINKS + 1);
@@ -289,6 +289,7 @@ static tBTA_GATT_STATUS bta_gattc_add_srvc_to_cache(tBTA_GATTC_SERV *p_srvc_cb,
     memcpy(&p_new_srvc->service_uuid.id.uuid, p_uuid, sizeof(tBT_UUID));
     p_new_srvc->service_uuid.id.inst_id = srvc_inst;
     p_new_srvc->p_next  = NULL;
+    p_new_srvc->attr_deferred = FALSE;
 
     if (p_srvc_cb->p_cur_srvc != NULL)
         p_srvc_cb->p_cur_srvc->p_next = p_new_srvc;
@@ -388,6 +389,45 @@ static tBTA_GATT_STATUS bta_gattc_add_attr_to_cache(tBTA_GATTC_SERV *p_srvc_cb,
     return status;
 }
 
+/*******************************************************************************
+**
+** Function         bta_gattc_load_srvc_attr
+**
+** Description      Add the attributes of a service loaded from NV without them
+**                  into the database cache.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void bta_gattc_load_srvc_attr(tBTA_GATTC_SERV *p_srvc_cb, tBTA_GATTC_CACHE *p_cache)
+{
+#if (defined BTA_GATTC_CACHE_LAZY && BTA_GATTC_CACHE_LAZY == TRUE)
+    tBTA_GATTC_CACHE    *p_cur_srvc = p_srvc_cb->p_cur_srvc;
+    tBTA_GATTC_NV_ATTR  *p_attr = NULL;
+    UINT16              num_attr;
+
+    if (!p_cache->attr_deferred)
+        return;
+
+    p_cache->attr_deferred = FALSE;
+
+    num_attr = bta_gattc_co_cache_load_srvc(p_srvc_cb->server_bda, p_cache->s_handle,
+                                            p_cache->e_handle, &p_attr);
+    APPL_TRACE_DEBUG3("load service [0x%04x ~ 0x%04x]: %d attributes",
+                      p_cache->s_handle, p_cache->e_handle, num_attr);
+
+    /* attributes are added to the current service */
+    p_srvc_cb->p_cur_srvc = p_cache;
+    for (; num_attr > 0 && p_attr != NULL; num_attr --, p_attr ++)
+    {
+        if (bta_gattc_add_attr_to_cache(p_srvc_cb, p_attr->s_handle, &p_attr->uuid,
+                                        p_attr->prop, p_attr->attr_type) != BTA_GATT_OK)
+            break;
+    }
+    p_srvc_cb->p_cur_srvc = p_cur_srvc;
+#endif
+}
+
 /*******************************************************************************
 **
 ** Function         bta_gattc_get_disc_range
@@ -1038,12 +1078,13 @@ UINT16 bta_gattc_id2handle(tBTA_GATTC_SERV *p_srcb, tBTA_GATT_SRVC_ID *p_service
                           p_cache->s_handle, p_cache->service_uuid.id.uuid.uu.uuid16,
                           p_cache->service_uuid.id.inst_id);
 #endif
-        p_attr = p_cache->p_attr;
-
         if (bta_gattc_uuid_compare(p_service_id->id.uuid, p_cache->service_uuid.id.uuid, TRUE) &&
             p_service_id->id.inst_id == p_cache->service_uuid.id.inst_id &&
             p_cache->service_uuid.is_primary == p_service_id->is_primary)
         {
+            bta_gattc_load_srvc_attr(p_srcb, p_cache);
+            p_attr = p_cache->p_attr;
+
             for (j = 0; p_attr; j ++)
             {
 #if (defined BTA_GATT_DEBUG && BTA_GATT_DEBUG == TRUE)
@@ -1145,6 +1186,9 @@ BOOLEAN bta_gattc_handle2id(tBTA_GATTC_SERV *p_srcb, UINT16 handle, tBTA_GATT_SR
         }
         else /* start looking for attributes within the service */
         {
+            if (handle > p_cache->s_handle && handle <= p_cache->e_handle)
+                bta_gattc_load_srvc_attr(p_srcb, p_cache);
+
             p_attr = p_cache->p_attr;
 
             for (j = 0; p_attr; j ++)
@@ -1260,7 +1304,7 @@ static tBTA_GATT_STATUS bta_gattc_find_record(tBTA_GATTC_SERV *p_srcb,
     if (p_uuid_cond)
         memcpy(&uuid_cond, p_uuid_cond, sizeof(tBT_UUID));
 
-    for (i = 0;  p_cache <= p_srcb->p_cur_srvc && p_cache && status != BTA_GATT_OK; i ++)
+    for (i = 0;  p_cache && status != BTA_GATT_OK; i ++)
     {
         if (bta_gattc_uuid_compare(p_service_id->id.uuid, p_cache->service_uuid.id.uuid, FALSE) &&
             p_service_id->id.inst_id == p_cache->service_uuid.id.inst_id &&
@@ -1271,6 +1315,7 @@ static tBTA_GATT_STATUS bta_gattc_find_record(tBTA_GATTC_SERV *p_srcb,
                               p_cache->service_uuid.id.uuid.uu.uuid16,
                               p_cache->service_uuid.id.inst_id);
 #endif
+            bta_gattc_load_srvc_attr(p_srcb, p_cache);
             p_attr = p_cache->p_attr;
 
             for (j = 0; p_attr; j ++)
@@ -1481,16 +1526,25 @@ void bta_gattc_rebuild_cache(tBTA_GATTC_SERV *p_srvc_cb, UINT16 num_attr,
                                             &p_attr->uuid,
                                             p_attr->is_primary,
                                             p_attr->id);
+#if (defined BTA_GATTC_CACHE_LAZY && BTA_GATTC_CACHE_LAZY == TRUE)
+                /* attributes are loaded when the service is first queried */
+                if (p_srvc_cb->p_cur_srvc != NULL)
+                    p_srvc_cb->p_cur_srvc->attr_deferred = TRUE;
+#endif
                 break;
 
             case BTA_GATTC_ATTR_TYPE_CHAR:
             case BTA_GATTC_ATTR_TYPE_CHAR_DESCR:
             case BTA_GATTC_ATTR_TYPE_INCL_SRVC:
+#if (defined BTA_GATTC_CACHE_LAZY && BTA_GATTC_CACHE_LAZY == TRUE)
+                /* not delivered by the callout in lazy mode */
+#else
                 bta_gattc_add_attr_to_cache(p_srvc_cb,
                                             p_attr->s_handle,
                                             &p_attr->uuid,
                                             p_attr->prop,
                                             p_attr->attr_type);
+#endif
                 break;
         }
         p_attr ++;
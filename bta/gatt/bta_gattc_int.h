@@ -228,6 +228,7 @@ typedef struct gattc_svc_cache
     UINT16                  s_handle;
     UINT16                  e_handle;
     struct                  gattc_svc_cache *p_next;
+    BOOLEAN                 attr_deferred;  /* attributes not loaded from NV yet */
 // btla-specific ++
 } __attribute__((packed)) tBTA_GATTC_CACHE;
 // btla-specific --
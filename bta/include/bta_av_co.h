@@ -164,6 +164,50 @@ BTA_API extern void bta_av_co_audio_setconfig(tBTA_AV_HNDL hndl, tBTA_AV_CODEC c
                                         UINT8 *p_codec_info, UINT8 seid, BD_ADDR addr,
                                         UINT8 num_protect, UINT8 *p_protect_info);
 
+/*******************************************************************************
+**
+** Function         bta_av_co_audio_sink_init
+**
+** Description      This callout function is executed by AV when it is
+**                  started by calling BTA_AvRegister() with the feature
+**                  BTA_AV_FEAT_SINK, to get the capabilities of the audio
+**                  SNK stream end point.
+**
+** Returns          TRUE and the codec and content protection capabilities
+**                  info if a SNK end point is to be created.
+**
+*******************************************************************************/
+BTA_API extern BOOLEAN bta_av_co_audio_sink_init(UINT8 *p_codec_type, UINT8 *p_codec_info,
+                                                 UINT8 *p_num_protect, UINT8 *p_protect_info);
+
+/*******************************************************************************
+**
+** Function         bta_av_co_audio_sink_setconfig
+**
+** Description      This callout function is executed by AV when the peer
+**                  source sets the codec and content protection configuration
+**                  of the audio SNK stream end point.
+**
+** Returns          void
+**
+*******************************************************************************/
+BTA_API extern void bta_av_co_audio_sink_setconfig(tBTA_AV_HNDL hndl, tBTA_AV_CODEC codec_type,
+                                        UINT8 *p_codec_info, UINT8 seid, BD_ADDR addr,
+                                        UINT8 num_protect, UINT8 *p_protect_info);
+
+/*******************************************************************************
+**
+** Function         bta_av_co_audio_sink_data
+**
+** Description      This function is called by AV with each media packet
+**                  received on the audio SNK stream end point. p_pkt holds
+**                  the media payload and is freed by the callee.
+**
+** Returns          void
+**
+*******************************************************************************/
+BTA_API extern void bta_av_co_audio_sink_data(tBTA_AV_HNDL hndl, BT_HDR *p_pkt, UINT32 time_stamp);
+
 /*******************************************************************************
 **
 ** Function         bta_av_co_video_setconfig
@@ -97,5 +97,26 @@ BTA_API extern void bta_gattc_co_cache_save(BD_ADDR server_bda, UINT16 evt,
 BTA_API extern void bta_gattc_co_cache_load(BD_ADDR server_bda, UINT16 evt,
                                             UINT16 start_index, UINT16 conn_id);
 
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_load_srvc
+**
+** Description      This callout function is executed by GATT when the attributes
+**                  of a service that was loaded without them are needed. Unlike
+**                  the other cache callouts it returns synchronously.
+**
+** Parameter        server_bda: server bd address of this cache belongs to
+**                  s_handle: start handle of the service.
+**                  e_handle: end handle of the service.
+**                  pp_attr: set to the attribute records of the service, which
+**                           stay valid until the next callout on this cache.
+**
+** Returns          number of attribute records, 0 if the service is not cached.
+**
+*******************************************************************************/
+BTA_API extern UINT16 bta_gattc_co_cache_load_srvc(BD_ADDR server_bda, UINT16 s_handle,
+                                                   UINT16 e_handle,
+                                                   tBTA_GATTC_NV_ATTR **pp_attr);
+
 #endif /* BTA_GATT_CO_H */
 
@@ -1734,6 +1734,8 @@ static int bta_jv_port_data_co_cback(UINT16 port_handle, UINT8 *buf, UINT16 len,
                 return bta_co_rfc_data_outgoing_size(p_pcb->user_data, (int*)buf);
             case DATA_CO_CALLBACK_TYPE_OUTGOING:
                 return bta_co_rfc_data_outgoing(p_pcb->user_data, buf, len);
+            case DATA_CO_CALLBACK_TYPE_OUTGOING_VECTOR:
+                return bta_co_rfc_data_outgoing_vector(p_pcb->user_data, (tPORT_CO_SEG*)buf, len);
             default:
                 APPL_TRACE_ERROR1("unknown callout type:%d", type);
                 break;
@@ -78,6 +78,18 @@ const tA2D_SBC_CIE bta_av_co_sbc_caps =
     A2D_SBC_IE_MIN_BITPOOL /* min_bitpool */
 };
 
+/* SBC capabilities of the SNK end point, whatever the decoder handles */
+const tA2D_SBC_CIE bta_av_co_sbc_sink_caps =
+{
+    (A2D_SBC_IE_SAMP_FREQ_16 | A2D_SBC_IE_SAMP_FREQ_32 | A2D_SBC_IE_SAMP_FREQ_44 | A2D_SBC_IE_SAMP_FREQ_48), /* samp_freq */
+    (A2D_SBC_IE_CH_MD_MONO | A2D_SBC_IE_CH_MD_STEREO | A2D_SBC_IE_CH_MD_JOINT | A2D_SBC_IE_CH_MD_DUAL), /* ch_mode */
+    (A2D_SBC_IE_BLOCKS_16 | A2D_SBC_IE_BLOCKS_12 | A2D_SBC_IE_BLOCKS_8 | A2D_SBC_IE_BLOCKS_4), /* block_len */
+    (A2D_SBC_IE_SUBBAND_4 | A2D_SBC_IE_SUBBAND_8), /* num_subbands */
+    (A2D_SBC_IE_ALLOC_MD_L | A2D_SBC_IE_ALLOC_MD_S), /* alloc_mthd */
+    A2D_SBC_IE_MAX_BITPOOL, /* max_bitpool */
+    A2D_SBC_IE_MIN_BITPOOL /* min_bitpool */
+};
+
 #if !defined(BTIF_AV_SBC_DEFAULT_SAMP_FREQ)
 #define BTIF_AV_SBC_DEFAULT_SAMP_FREQ A2D_SBC_IE_SAMP_FREQ_44
 #endif
@@ -122,6 +134,7 @@ typedef struct
     BOOLEAN         acp;                /* acceptor */
     BOOLEAN         recfg_needed;       /* reconfiguration is needed */
     BOOLEAN         opened;             /* opened */
+    BOOLEAN         sink;               /* configured on our SNK end point */
     UINT16          mtu;                /* maximum transmit unit size */
 } tBTA_AV_CO_PEER;
 
@@ -630,6 +643,104 @@ BTA_API void bta_av_co_audio_setconfig(tBTA_AV_HNDL hndl, tBTA_AV_CODEC codec_ty
     }
 }
 
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_sink_init
+ **
+ ** Description      This callout function is executed by AV when it is
+ **                  started by calling BTA_AvRegister() with BTA_AV_FEAT_SINK.
+ **
+ ** Returns          SNK end point codec and content protection capabilities info.
+ **
+ *******************************************************************************/
+BTA_API BOOLEAN bta_av_co_audio_sink_init(UINT8 *p_codec_type, UINT8 *p_codec_info,
+        UINT8 *p_num_protect, UINT8 *p_protect_info)
+{
+    FUNC_TRACE();
+
+    /* no content protection on the sink */
+    *p_num_protect = 0;
+    *p_protect_info = 0;
+
+    *p_codec_type = BTA_AV_CODEC_SBC;
+    A2D_BldSbcInfo(AVDT_MEDIA_AUDIO, (tA2D_SBC_CIE *) &bta_av_co_sbc_sink_caps, p_codec_info);
+
+    return TRUE;
+}
+
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_sink_setconfig
+ **
+ ** Description      This callout function is executed by AV when the peer
+ **                  source configures our SNK end point. Any SBC configuration
+ **                  within the sink capabilities is taken as it is: the
+ **                  decoder follows the frame headers, so there is never a
+ **                  reason to reconfigure.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+BTA_API void bta_av_co_audio_sink_setconfig(tBTA_AV_HNDL hndl, tBTA_AV_CODEC codec_type,
+        UINT8 *p_codec_info, UINT8 seid, BD_ADDR addr, UINT8 num_protect, UINT8 *p_protect_info)
+{
+    tBTA_AV_CO_PEER *p_peer;
+
+    FUNC_TRACE();
+
+    APPL_TRACE_DEBUG6("bta_av_co_audio_sink_setconfig p_codec_info[%x:%x:%x:%x:%x:%x]",
+            p_codec_info[1], p_codec_info[2], p_codec_info[3],
+            p_codec_info[4], p_codec_info[5], p_codec_info[6]);
+
+    p_peer = bta_av_co_get_peer(hndl);
+    if (p_peer == NULL)
+    {
+        APPL_TRACE_ERROR0("bta_av_co_audio_sink_setconfig could not find peer entry");
+        bta_av_ci_setconfig(hndl, A2D_BUSY, AVDT_ASC_CODEC, 0, NULL, FALSE);
+        return;
+    }
+
+    if (num_protect != 0)
+    {
+        APPL_TRACE_ERROR0("bta_av_co_audio_sink_setconfig wrong CP configuration");
+        bta_av_ci_setconfig(hndl, A2D_BAD_CP_TYPE, AVDT_ASC_PROTECT, 0, NULL, FALSE);
+        return;
+    }
+
+    if ((codec_type != BTA_AV_CODEC_SBC) ||
+        (bta_av_sbc_cfg_in_cap(p_codec_info, (tA2D_SBC_CIE *) &bta_av_co_sbc_sink_caps) != 0))
+    {
+        APPL_TRACE_ERROR1("bta_av_co_audio_sink_setconfig unsupported codec %d", codec_type);
+        bta_av_ci_setconfig(hndl, A2D_WRONG_CODEC, AVDT_ASC_CODEC, 0, NULL, FALSE);
+        return;
+    }
+
+    bdcpy(p_peer->addr, addr);
+    memcpy(p_peer->codec_cfg, p_codec_info, AVDT_CODEC_SIZE);
+    p_peer->acp = TRUE;
+    p_peer->sink = TRUE;
+    p_peer->recfg_needed = FALSE;
+
+    bta_av_ci_setconfig(hndl, A2D_SUCCESS, A2D_SUCCESS, 0, NULL, FALSE);
+}
+
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_sink_data
+ **
+ ** Description      This function is called by AV with each media packet
+ **                  received on the SNK end point. It goes to the media task,
+ **                  which frees it.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+BTA_API void bta_av_co_audio_sink_data(tBTA_AV_HNDL hndl, BT_HDR *p_pkt, UINT32 time_stamp)
+{
+    /* AVDTP reports the RTP sequence number in layer_specific */
+    btif_media_aa_writebuf(p_pkt, time_stamp, p_pkt->layer_specific);
+}
+
 /*******************************************************************************
  **
  ** Function         bta_av_co_audio_open
@@ -1501,4 +1612,19 @@ BOOLEAN bta_av_co_get_remote_bitpool_pref(UINT8 *min, UINT8 *max)
     return TRUE;
 }
 
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_is_sink
+ **
+ ** Description      Checks if the stream was configured by the peer on our
+ **                  audio SNK end point
+ **
+ ** Returns          TRUE if the local device is the sink of the stream
+ **
+ *******************************************************************************/
+BOOLEAN bta_av_co_audio_is_sink(tBTA_AV_HNDL hndl)
+{
+    tBTA_AV_CO_PEER *p_peer = bta_av_co_get_peer(hndl);
 
+    return (p_peer != NULL) && p_peer->sink;
+}
@@ -0,0 +1,686 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2013 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      bta_gattc_co.c
+ *
+ *  Description:   GATT client cache callout api
+ *
+ *                 The attribute list of each server is kept in its own file,
+ *                 gatt_cache_<bd addr>, as a header followed by the
+ *                 tBTA_GATTC_NV_ATTR records in discovery order. Files are
+ *                 mapped read only and stay mapped across connections, so a
+ *                 reconnect only re-checks the file identity before serving
+ *                 the records. Pages of the mapping are faulted in as the
+ *                 records are loaded, and the attributes of a service are
+ *                 served again when BTA loads them lazily.
+ *
+ *                 The hashes in the header are computed over the file itself
+ *                 when it is written. They detect a damaged, truncated or
+ *                 foreign file, not a change of the database on the peer:
+ *                 that is still left to the Service Changed indication.
+ *
+ ***********************************************************************************/
+#include "bt_target.h"
+
+#if (defined(BLE_INCLUDED) && (BLE_INCLUDED == TRUE)) && \
+    (defined(BTA_GATT_INCLUDED) && (BTA_GATT_INCLUDED == TRUE))
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "gki.h"
+#include "bd.h"
+#include "bta_gattc_co.h"
+#include "bta_gattc_ci.h"
+
+/* same directory as bt_config */
+#ifndef BTA_GATTC_CO_CACHE_PATH
+#define BTA_GATTC_CO_CACHE_PATH     "/tmp/bluedroid/"
+#endif
+
+#define BTA_GATTC_CO_CACHE_PREFIX   "gatt_cache_"
+#define BTA_GATTC_CO_CACHE_EXT_NEW  ".new"
+
+#define BTA_GATTC_CO_CACHE_MAGIC    0x43545447  /* "GTTC" */
+#define BTA_GATTC_CO_CACHE_VERSION  1
+
+/* cache file header */
+typedef struct
+{
+    UINT32      magic;
+    UINT16      version;
+    UINT16      rec_size;       /* sizeof(tBTA_GATTC_NV_ATTR) of the writer */
+    UINT16      num_attr;       /* number of records following the header */
+    UINT16      num_srvc;       /* number of service records */
+    UINT32      srvc_hash;      /* check of the service records: type, handle range, UUID */
+    UINT32      attr_hash;      /* check of all records */
+} tBTA_GATTC_CO_CACHE_HDR;
+
+/* one server cache */
+typedef struct
+{
+    BOOLEAN             in_use;
+    BD_ADDR             bda;
+    UINT32              last_use;
+
+    /* load: validated read only mapping of the cache file */
+    UINT8               *p_map;
+    size_t              map_len;
+    dev_t               dev;
+    ino_t               ino;
+    struct timespec     mtime;
+
+    /* save: records received through bta_gattc_co_cache_save */
+    BOOLEAN             saving;
+    tBTA_GATTC_NV_ATTR  *p_save;
+    UINT16              num_save;
+    UINT16              max_save;
+} tBTA_GATTC_CO_CACHE;
+
+typedef struct
+{
+    tBTA_GATTC_CO_CACHE cache[BTA_GATTC_CO_CACHE_MAX];
+    UINT32              use_count;
+
+    /* load statistics */
+    UINT32              hit;            /* cache served from an existing mapping */
+    UINT32              mapped;         /* cache file mapped and validated */
+    UINT32              miss;           /* no cache file */
+    UINT32              stale;          /* cache file damaged or of another format */
+    UINT32              srvc_load;      /* services loaded lazily */
+} tBTA_GATTC_CO_CB;
+
+static tBTA_GATTC_CO_CB bta_gattc_co_cb;
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_file
+**
+** Description      Build the cache file name of a server.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_gattc_co_cache_file(BD_ADDR bda, char *p_name, int len, BOOLEAN is_new)
+{
+    snprintf(p_name, len, "%s%s%02x%02x%02x%02x%02x%02x%s",
+             BTA_GATTC_CO_CACHE_PATH, BTA_GATTC_CO_CACHE_PREFIX,
+             bda[0], bda[1], bda[2], bda[3], bda[4], bda[5],
+             is_new ? BTA_GATTC_CO_CACHE_EXT_NEW : "");
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_hash
+**
+** Description      FNV-1a over a byte string.
+**
+** Returns          updated hash
+**
+*******************************************************************************/
+static UINT32 bta_gattc_co_hash(UINT32 hash, const UINT8 *p, int len)
+{
+    while (len-- > 0)
+    {
+        hash ^= *p++;
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_hash_attrs
+**
+** Description      Hash a record list field by field, so that structure padding
+**                  does not take part. The service hash only covers the service
+**                  records: type, handle range and UUID.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_gattc_co_hash_attrs(const tBTA_GATTC_NV_ATTR *p_attr, UINT16 num_attr,
+                                    UINT32 *p_srvc_hash, UINT32 *p_attr_hash, UINT16 *p_num_srvc)
+{
+    UINT32  srvc_hash = 2166136261UL, attr_hash = 2166136261UL;
+    UINT16  num_srvc = 0;
+    UINT8   rec[4 + 2 + LEN_UUID_128 + 4], *p;
+
+    for (; num_attr > 0; num_attr--, p_attr++)
+    {
+        p = rec;
+        UINT16_TO_STREAM(p, p_attr->s_handle);
+        UINT16_TO_STREAM(p, p_attr->e_handle);
+        UINT16_TO_STREAM(p, p_attr->uuid.len);
+        if (p_attr->uuid.len == LEN_UUID_16)
+        {
+            UINT16_TO_STREAM(p, p_attr->uuid.uu.uuid16);
+        }
+        else if (p_attr->uuid.len == LEN_UUID_32)
+        {
+            UINT32_TO_STREAM(p, p_attr->uuid.uu.uuid32);
+        }
+        else
+        {
+            ARRAY_TO_STREAM(p, p_attr->uuid.uu.uuid128, LEN_UUID_128);
+        }
+        UINT8_TO_STREAM(p, p_attr->attr_type);
+        UINT8_TO_STREAM(p, p_attr->is_primary);
+
+        if (p_attr->attr_type == BTA_GATTC_ATTR_TYPE_SRVC)
+        {
+            srvc_hash = bta_gattc_co_hash(srvc_hash, rec, (int)(p - rec));
+            num_srvc++;
+        }
+
+        UINT8_TO_STREAM(p, p_attr->id);
+        UINT8_TO_STREAM(p, p_attr->prop);
+        attr_hash = bta_gattc_co_hash(attr_hash, rec, (int)(p - rec));
+    }
+
+    *p_srvc_hash = srvc_hash;
+    *p_attr_hash = attr_hash;
+    *p_num_srvc  = num_srvc;
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_find_cache
+**
+** Description      Find the cache entry of a server, allocating one (and
+**                  evicting the least recently used idle entry) if needed.
+**
+** Returns          pointer to the entry, NULL if all entries are busy.
+**
+*******************************************************************************/
+static tBTA_GATTC_CO_CACHE *bta_gattc_co_find_cache(BD_ADDR bda, BOOLEAN alloc)
+{
+    tBTA_GATTC_CO_CACHE *p_cache, *p_free = NULL;
+    int                 i;
+
+    for (i = 0, p_cache = bta_gattc_co_cb.cache; i < BTA_GATTC_CO_CACHE_MAX; i++, p_cache++)
+    {
+        if (p_cache->in_use)
+        {
+            if (bdcmp(p_cache->bda, bda) == 0)
+            {
+                p_cache->last_use = ++bta_gattc_co_cb.use_count;
+                return p_cache;
+            }
+            if (!p_cache->saving &&
+                (p_free == NULL || (p_free->in_use && p_cache->last_use < p_free->last_use)))
+                p_free = p_cache;
+        }
+        else if (p_free == NULL || p_free->in_use)
+        {
+            p_free = p_cache;
+        }
+    }
+
+    if (!alloc || p_free == NULL)
+        return NULL;
+
+    if (p_free->in_use)
+    {
+        BTIF_TRACE_DEBUG1("%s: evicting cache entry", __FUNCTION__);
+        if (p_free->p_map)
+            munmap(p_free->p_map, p_free->map_len);
+    }
+
+    memset(p_free, 0, sizeof(tBTA_GATTC_CO_CACHE));
+    p_free->in_use = TRUE;
+    bdcpy(p_free->bda, bda);
+    p_free->last_use = ++bta_gattc_co_cb.use_count;
+
+    return p_free;
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_unmap
+**
+** Description      Drop the mapping of a cache entry.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bta_gattc_co_unmap(tBTA_GATTC_CO_CACHE *p_cache)
+{
+    if (p_cache->p_map)
+    {
+        munmap(p_cache->p_map, p_cache->map_len);
+        p_cache->p_map = NULL;
+        p_cache->map_len = 0;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_map
+**
+** Description      Map and check the cache file of a server. An existing
+**                  mapping is reused as long as the file was not replaced.
+**
+** Returns          BTA_GATT_OK if the cache is usable, BTA_GATT_ERROR otherwise.
+**
+*******************************************************************************/
+static tBTA_GATT_STATUS bta_gattc_co_map(tBTA_GATTC_CO_CACHE *p_cache)
+{
+    char                    name[sizeof(BTA_GATTC_CO_CACHE_PATH) + 32];
+    struct stat             st;
+    tBTA_GATTC_CO_CACHE_HDR *p_hdr;
+    UINT32                  srvc_hash, attr_hash;
+    UINT16                  num_srvc;
+    UINT8                   *p_map;
+    int                     fd;
+
+    bta_gattc_co_cache_file(p_cache->bda, name, sizeof(name), FALSE);
+
+    if ((fd = open(name, O_RDONLY)) < 0)
+    {
+        bta_gattc_co_unmap(p_cache);
+        bta_gattc_co_cb.miss++;
+        return BTA_GATT_ERROR;
+    }
+
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        bta_gattc_co_unmap(p_cache);
+        bta_gattc_co_cb.miss++;
+        return BTA_GATT_ERROR;
+    }
+
+    if (p_cache->p_map && p_cache->dev == st.st_dev && p_cache->ino == st.st_ino &&
+        p_cache->mtime.tv_sec == st.st_mtim.tv_sec &&
+        p_cache->mtime.tv_nsec == st.st_mtim.tv_nsec &&
+        p_cache->map_len == (size_t)st.st_size)
+    {
+        close(fd);
+        bta_gattc_co_cb.hit++;
+        return BTA_GATT_OK;
+    }
+
+    bta_gattc_co_unmap(p_cache);
+
+    if (st.st_size < (off_t)sizeof(tBTA_GATTC_CO_CACHE_HDR))
+    {
+        close(fd);
+        bta_gattc_co_cb.stale++;
+        return BTA_GATT_ERROR;
+    }
+
+    p_map = (UINT8 *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (p_map == MAP_FAILED)
+    {
+        BTIF_TRACE_ERROR2("%s: mmap failed, %s", __FUNCTION__, strerror(errno));
+        bta_gattc_co_cb.miss++;
+        return BTA_GATT_ERROR;
+    }
+
+    p_hdr = (tBTA_GATTC_CO_CACHE_HDR *)p_map;
+
+    if (p_hdr->magic != BTA_GATTC_CO_CACHE_MAGIC ||
+        p_hdr->version != BTA_GATTC_CO_CACHE_VERSION ||
+        p_hdr->rec_size != sizeof(tBTA_GATTC_NV_ATTR) ||
+        (size_t)st.st_size != sizeof(tBTA_GATTC_CO_CACHE_HDR) +
+                              p_hdr->num_attr * sizeof(tBTA_GATTC_NV_ATTR))
+    {
+        BTIF_TRACE_WARNING1("%s: cache format mismatch", __FUNCTION__);
+        munmap(p_map, st.st_size);
+        bta_gattc_co_cb.stale++;
+        return BTA_GATT_ERROR;
+    }
+
+    bta_gattc_co_hash_attrs((tBTA_GATTC_NV_ATTR *)(p_hdr + 1), p_hdr->num_attr,
+                            &srvc_hash, &attr_hash, &num_srvc);
+
+    if (num_srvc != p_hdr->num_srvc || srvc_hash != p_hdr->srvc_hash ||
+        attr_hash != p_hdr->attr_hash)
+    {
+        BTIF_TRACE_WARNING1("%s: cache file damaged", __FUNCTION__);
+        munmap(p_map, st.st_size);
+        bta_gattc_co_cb.stale++;
+        return BTA_GATT_ERROR;
+    }
+
+    p_cache->p_map   = p_map;
+    p_cache->map_len = st.st_size;
+    p_cache->dev     = st.st_dev;
+    p_cache->ino     = st.st_ino;
+    p_cache->mtime   = st.st_mtim;
+    bta_gattc_co_cb.mapped++;
+
+    return BTA_GATT_OK;
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_write
+**
+** Description      Write the saved records of a server into its cache file.
+**                  The file is replaced atomically.
+**
+** Returns          TRUE if the cache file was written.
+**
+*******************************************************************************/
+static BOOLEAN bta_gattc_co_write(tBTA_GATTC_CO_CACHE *p_cache)
+{
+    char                    name[sizeof(BTA_GATTC_CO_CACHE_PATH) + 32];
+    char                    name_new[sizeof(BTA_GATTC_CO_CACHE_PATH) + 32];
+    tBTA_GATTC_CO_CACHE_HDR hdr;
+    size_t                  len = p_cache->num_save * sizeof(tBTA_GATTC_NV_ATTR);
+    int                     fd;
+    BOOLEAN                 ok;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic    = BTA_GATTC_CO_CACHE_MAGIC;
+    hdr.version  = BTA_GATTC_CO_CACHE_VERSION;
+    hdr.rec_size = sizeof(tBTA_GATTC_NV_ATTR);
+    hdr.num_attr = p_cache->num_save;
+    bta_gattc_co_hash_attrs(p_cache->p_save, p_cache->num_save,
+                            &hdr.srvc_hash, &hdr.attr_hash, &hdr.num_srvc);
+
+    bta_gattc_co_cache_file(p_cache->bda, name, sizeof(name), FALSE);
+    bta_gattc_co_cache_file(p_cache->bda, name_new, sizeof(name_new), TRUE);
+
+    if ((fd = open(name_new, O_WRONLY | O_CREAT | O_TRUNC, 0660)) < 0)
+    {
+        BTIF_TRACE_ERROR3("%s: unable to create %s, %s", __FUNCTION__, name_new, strerror(errno));
+        return FALSE;
+    }
+
+    ok = (write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr)) &&
+         (write(fd, p_cache->p_save, len) == (ssize_t)len) &&
+         (fsync(fd) == 0);
+    close(fd);
+
+    if (!ok || rename(name_new, name) < 0)
+    {
+        BTIF_TRACE_ERROR2("%s: unable to write cache, %s", __FUNCTION__, strerror(errno));
+        unlink(name_new);
+        return FALSE;
+    }
+
+    BTIF_TRACE_DEBUG3("%s: %d attributes, %d services", __FUNCTION__, hdr.num_attr, hdr.num_srvc);
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_open
+**
+** Description      This callout function is executed by GATTC when a GATT server
+**                  cache is ready to be sent.
+**
+** Parameter        server_bda: server bd address of this cache belongs to
+**                  evt: call in event to be passed in when cache open is done.
+**                  conn_id: connection ID of this cache operation attach to.
+**                  to_save: open cache to save or to load.
+**
+** Returns          void.
+**
+*******************************************************************************/
+void bta_gattc_co_cache_open(BD_ADDR server_bda, UINT16 evt, UINT16 conn_id, BOOLEAN to_save)
+{
+    tBTA_GATTC_CO_CACHE *p_cache = bta_gattc_co_find_cache(server_bda, TRUE);
+    tBTA_GATT_STATUS    status = BTA_GATT_ERROR;
+    UINT32              loads;
+
+    if (p_cache == NULL)
+    {
+        BTIF_TRACE_ERROR1("%s: no cache entry available", __FUNCTION__);
+    }
+    else if (to_save)
+    {
+        /* the mapping describes the old database, drop it */
+        bta_gattc_co_unmap(p_cache);
+        p_cache->saving = TRUE;
+        p_cache->num_save = 0;
+        status = BTA_GATT_OK;
+    }
+    else
+    {
+        status = bta_gattc_co_map(p_cache);
+
+        loads = bta_gattc_co_cb.hit + bta_gattc_co_cb.mapped +
+                bta_gattc_co_cb.miss + bta_gattc_co_cb.stale;
+        BTIF_TRACE_DEBUG6("%s: status %d, hit %d mapped %d miss %d stale %d",
+                          __FUNCTION__, status, bta_gattc_co_cb.hit, bta_gattc_co_cb.mapped,
+                          bta_gattc_co_cb.miss, bta_gattc_co_cb.stale);
+        BTIF_TRACE_DEBUG2("%s: %d services loaded lazily", __FUNCTION__,
+                          bta_gattc_co_cb.srvc_load);
+        BTIF_TRACE_DEBUG2("%s: hit rate %d%%", __FUNCTION__,
+                          (bta_gattc_co_cb.hit + bta_gattc_co_cb.mapped) * 100 / loads);
+    }
+
+    bta_gattc_ci_cache_open(server_bda, evt, status, conn_id);
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_load
+**
+** Description      This callout function is executed by GATT when server cache
+**                  is required to load.
+**
+** Parameter        server_bda: server bd address of this cache belongs to
+**                  evt: call in event to be passed in when cache save is done.
+**                  num_attr: number of attribute to be save.
+**                  attr_index: starting attribute index of the save operation.
+**                  conn_id: connection ID of this cache operation attach to.
+** Returns
+**
+*******************************************************************************/
+void bta_gattc_co_cache_load(BD_ADDR server_bda, UINT16 evt, UINT16 start_index, UINT16 conn_id)
+{
+    tBTA_GATTC_CO_CACHE     *p_cache = bta_gattc_co_find_cache(server_bda, FALSE);
+    tBTA_GATTC_CO_CACHE_HDR *p_hdr;
+    tBTA_GATT_STATUS        status = BTA_GATT_ERROR;
+    UINT16                  num_attr = 0;
+    tBTA_GATTC_NV_ATTR      *p_attr = NULL;
+#if (defined BTA_GATTC_CACHE_LAZY && BTA_GATTC_CACHE_LAZY == TRUE)
+    tBTA_GATTC_NV_ATTR      *p_end, srvc[BTA_GATTC_NV_LOAD_MAX];
+    UINT16                  srvc_index = 0;
+#endif
+
+    /* the cache is closed after every chunk, the mapping stays */
+    if (p_cache != NULL && p_cache->p_map != NULL)
+    {
+        p_hdr = (tBTA_GATTC_CO_CACHE_HDR *)p_cache->p_map;
+
+#if (defined BTA_GATTC_CACHE_LAZY && BTA_GATTC_CACHE_LAZY == TRUE)
+        /* service records only, start_index counts services; the attributes
+        ** are read with bta_gattc_co_cache_load_srvc() */
+        p_end = (tBTA_GATTC_NV_ATTR *)(p_hdr + 1) + p_hdr->num_attr;
+        for (p_attr = (tBTA_GATTC_NV_ATTR *)(p_hdr + 1); p_attr < p_end; p_attr++)
+        {
+            if (p_attr->attr_type != BTA_GATTC_ATTR_TYPE_SRVC || srvc_index++ < start_index)
+                continue;
+            if (num_attr == BTA_GATTC_NV_LOAD_MAX)
+                break;
+            memcpy(&srvc[num_attr++], p_attr, sizeof(tBTA_GATTC_NV_ATTR));
+        }
+
+        if (num_attr > 0)
+            status = (p_attr < p_end) ? BTA_GATT_MORE : BTA_GATT_OK;
+        p_attr = srvc;
+#else
+        if (start_index < p_hdr->num_attr)
+        {
+            num_attr = p_hdr->num_attr - start_index;
+            if (num_attr > BTA_GATTC_NV_LOAD_MAX)
+                num_attr = BTA_GATTC_NV_LOAD_MAX;
+
+            p_attr = (tBTA_GATTC_NV_ATTR *)(p_hdr + 1) + start_index;
+            status = (start_index + num_attr < p_hdr->num_attr) ? BTA_GATT_MORE : BTA_GATT_OK;
+        }
+#endif
+    }
+
+    bta_gattc_ci_cache_load(server_bda, evt, num_attr, p_attr, status, conn_id);
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_load_srvc
+**
+** Description      This callout function is executed by GATT when the attributes
+**                  of a service that was loaded without them are needed.
+**
+** Parameter        server_bda: server bd address of this cache belongs to
+**                  s_handle: start handle of the service.
+**                  e_handle: end handle of the service.
+**                  pp_attr: set to the attribute records of the service.
+**
+** Returns          number of attribute records, 0 if the service is not cached.
+**
+*******************************************************************************/
+UINT16 bta_gattc_co_cache_load_srvc(BD_ADDR server_bda, UINT16 s_handle, UINT16 e_handle,
+                                    tBTA_GATTC_NV_ATTR **pp_attr)
+{
+    tBTA_GATTC_CO_CACHE     *p_cache = bta_gattc_co_find_cache(server_bda, TRUE);
+    tBTA_GATTC_CO_CACHE_HDR *p_hdr;
+    tBTA_GATTC_NV_ATTR      *p_attr, *p_end;
+    UINT16                  num_attr = 0;
+
+    *pp_attr = NULL;
+
+    /* the entry may have been evicted since the services were loaded */
+    if (p_cache == NULL || p_cache->saving ||
+        (p_cache->p_map == NULL && bta_gattc_co_map(p_cache) != BTA_GATT_OK))
+        return 0;
+
+    p_hdr  = (tBTA_GATTC_CO_CACHE_HDR *)p_cache->p_map;
+    p_attr = (tBTA_GATTC_NV_ATTR *)(p_hdr + 1);
+    p_end  = p_attr + p_hdr->num_attr;
+
+    for (; p_attr < p_end; p_attr++)
+    {
+        if (p_attr->attr_type == BTA_GATTC_ATTR_TYPE_SRVC &&
+            p_attr->s_handle == s_handle && p_attr->e_handle == e_handle)
+            break;
+    }
+
+    if (p_attr < p_end)
+    {
+        *pp_attr = ++p_attr;
+        while (p_attr < p_end && p_attr->attr_type != BTA_GATTC_ATTR_TYPE_SRVC)
+        {
+            p_attr++;
+            num_attr++;
+        }
+        bta_gattc_co_cb.srvc_load++;
+    }
+
+    return num_attr;
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_save
+**
+** Description      This callout function is executed by GATT when a server cache
+**                  is available to save.
+**
+** Parameter        server_bda: server bd address of this cache belongs to
+**                  evt: call in event to be passed in when cache save is done.
+**                  num_attr: number of attribute to be save.
+**                  p_attr: pointer to the list of attributes to save.
+**                  attr_index: starting attribute index of the save operation.
+**                  conn_id: connection ID of this cache operation attach to.
+** Returns
+**
+*******************************************************************************/
+void bta_gattc_co_cache_save(BD_ADDR server_bda, UINT16 evt, UINT16 num_attr,
+                             tBTA_GATTC_NV_ATTR *p_attr_list, UINT16 attr_index, UINT16 conn_id)
+{
+    tBTA_GATTC_CO_CACHE *p_cache = bta_gattc_co_find_cache(server_bda, FALSE);
+    tBTA_GATT_STATUS    status = BTA_GATT_ERROR;
+    tBTA_GATTC_NV_ATTR  *p_new;
+    UINT32              max_save;
+
+    if (p_cache != NULL && p_cache->saving && attr_index <= p_cache->num_save &&
+        (UINT32)attr_index + num_attr <= 0xFFFF)
+    {
+        if (attr_index + num_attr > p_cache->max_save)
+        {
+            max_save = p_cache->max_save ? p_cache->max_save * 2 : 64;
+            while (max_save < (UINT32)attr_index + num_attr)
+                max_save *= 2;
+            if (max_save > 0xFFFF)
+                max_save = 0xFFFF;
+
+            if ((p_new = realloc(p_cache->p_save, max_save * sizeof(tBTA_GATTC_NV_ATTR))) != NULL)
+            {
+                p_cache->p_save = p_new;
+                p_cache->max_save = (UINT16)max_save;
+            }
+        }
+
+        if (attr_index + num_attr <= p_cache->max_save)
+        {
+            memcpy(p_cache->p_save + attr_index, p_attr_list, num_attr * sizeof(tBTA_GATTC_NV_ATTR));
+            p_cache->num_save = attr_index + num_attr;
+            status = BTA_GATT_OK;
+        }
+    }
+
+    bta_gattc_ci_cache_save(server_bda, evt, status, conn_id);
+}
+
+/*******************************************************************************
+**
+** Function         bta_gattc_co_cache_close
+**
+** Description      This callout function is executed by GATTC when a GATT server
+**                  cache is written completely.
+**
+** Parameter        server_bda: server bd address of this cache belongs to
+**                  conn_id: connection ID of this cache operation attach to.
+**
+** Returns          void.
+**
+*******************************************************************************/
+void bta_gattc_co_cache_close(BD_ADDR server_bda, UINT16 conn_id)
+{
+    tBTA_GATTC_CO_CACHE *p_cache = bta_gattc_co_find_cache(server_bda, FALSE);
+
+    if (p_cache == NULL || !p_cache->saving)
+        return;
+
+    if (p_cache->num_save > 0)
+        bta_gattc_co_write(p_cache);
+
+    free(p_cache->p_save);
+    p_cache->p_save = NULL;
+    p_cache->num_save = p_cache->max_save = 0;
+    p_cache->saving = FALSE;
+}
+
+#endif /* BLE_INCLUDED && BTA_GATT_INCLUDED */
@@ -170,4 +170,16 @@ BOOLEAN bta_av_co_peer_cp_supported(tBTA_AV_HNDL hndl);
  *******************************************************************************/
 BOOLEAN bta_av_co_get_remote_bitpool_pref(UINT8 *min, UINT8 *max);
 
+/*******************************************************************************
+ **
+ ** Function         bta_av_co_audio_is_sink
+ **
+ ** Description      Checks if the stream was configured by the peer on our
+ **                  audio SNK end point
+ **
+ ** Returns          TRUE if the local device is the sink of the stream
+ **
+ *******************************************************************************/
+BOOLEAN bta_av_co_audio_is_sink(tBTA_AV_HNDL hndl);
+
 #endif
@@ -69,6 +69,7 @@ int btif_config_enum(btif_config_enum_callback cb, void* user_data);
 
 int btif_config_save();
 void btif_config_flush();
+int btif_config_export_xml();
 
 #ifdef __cplusplus
 }
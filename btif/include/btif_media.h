@@ -166,6 +166,41 @@ extern BOOLEAN btif_media_task_stop_aa_req(void);
  *******************************************************************************/
 extern BOOLEAN btif_media_task_aa_tx_flush_req(void);
 
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_start_rx_req
+ **
+ ** Description      Request to start the A2DP sink path : received SBC
+ **                  packets are decoded and the pcm written to the sink
+ **                  data channel
+ **
+ ** Returns          TRUE is success
+ **
+ *******************************************************************************/
+extern BOOLEAN btif_media_task_aa_start_rx_req(void);
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_stop_rx_req
+ **
+ ** Description      Request to stop the A2DP sink path
+ **
+ ** Returns          TRUE is success
+ **
+ *******************************************************************************/
+extern BOOLEAN btif_media_task_aa_stop_rx_req(void);
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_rx_flush_req
+ **
+ ** Description      Request to flush the A2DP sink jitter buffer
+ **
+ ** Returns          TRUE is success
+ **
+ *******************************************************************************/
+extern BOOLEAN btif_media_task_aa_rx_flush_req(void);
+
 /*******************************************************************************
  **
  ** Function         btif_media_aa_readbuf
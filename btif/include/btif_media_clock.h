@@ -0,0 +1,56 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      btif_media_clock.h
+ *
+ *  Description:   Frame accounting of the A2DP source media clock
+ *
+ ******************************************************************************/
+
+#ifndef BTIF_MEDIA_CLOCK_H
+#define BTIF_MEDIA_CLOCK_H
+
+#include <stdint.h>
+
+#include "data_types.h"
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_frames
+ **
+ ** Description      Converts elapsed_us of pcm time into frames of
+ **                  frame_samples samples per channel at sample_rate.
+ **                  *p_residue carries the pcm time not encoded yet, in
+ **                  samples x us, from one call to the next. With round_up a
+ **                  partial frame is sent ahead and the residue goes
+ **                  negative, so it is paid back by the following calls.
+ **
+ ** Returns          The number of frames due, at most 255
+ **
+ *******************************************************************************/
+extern UINT8 btif_media_clock_frames(int64_t *p_residue, uint64_t elapsed_us,
+                                     UINT32 sample_rate, UINT32 frame_samples,
+                                     BOOLEAN round_up);
+
+#endif /* BTIF_MEDIA_CLOCK_H */
@@ -39,6 +39,7 @@
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <stdlib.h>
+#include <stdint.h>
 #ifndef LINUX_NATIVE
 #include <private/android_filesystem_config.h>
 #endif
@@ -54,11 +55,14 @@
 
 #define asrt(s) if(!(s)) BTIF_TRACE_ERROR3 ("## %s assert %s failed at line:%d ##",__FUNCTION__, #s, __LINE__)
 //#define UNIT_TEST
+#ifndef CFG_PATH
 #define CFG_PATH "/tmp/bluedroid/"
+#endif
 #define CFG_FILE_NAME "bt_config"
 #define CFG_FILE_EXT ".xml"
 #define CFG_FILE_EXT_OLD ".old"
 #define CFG_FILE_EXT_NEW ".new"
+#define CFG_FILE_EXT_JOURNAL ".journal"
 #define CFG_GROW_SIZE (10*sizeof(cfg_node))
 #define GET_CHILD_MAX_COUNT(node) (short)((int)(node)->bytes / sizeof(cfg_node))
 #define IS_EMPTY(node) ((node)->name == NULL)
@@ -67,6 +71,31 @@
 #define MAX_CACHED_COUNT 150
 #define CFG_CMD_SAVE 1
 
+/*
+ * The store is an append-only journal of set/remove records. Changes are
+ * buffered in memory (write-behind) and appended by the command thread on
+ * btif_config_save(), after MAX_CACHED_COUNT changes or CFG_JOURNAL_BUF_SIZE
+ * bytes. Once the journal is over CFG_JOURNAL_COMPACT_MIN bytes and
+ * CFG_JOURNAL_COMPACT_RATIO times the size of the live data it is rewritten
+ * with one set record per value. A change that cannot be buffered makes the
+ * next save rewrite the journal whole. The xml file is only read when there
+ * is no journal yet, to migrate it. It is only written on an explicit
+ * btif_config_export_xml(), and with BTIF_CONFIG_EXPORT_XML on
+ * btif_config_flush(), for the tools that read it; never on a save.
+ */
+#define CFG_JOURNAL_MAGIC 0xBC1F
+#define CFG_JOURNAL_SET 1
+#define CFG_JOURNAL_REMOVE 2
+#define CFG_JOURNAL_BUF_SIZE 4096
+#define CFG_JOURNAL_COMPACT_MIN (16*1024)
+#define CFG_JOURNAL_COMPACT_RATIO 4
+#ifndef BTIF_CONFIG_EXPORT_XML
+#define BTIF_CONFIG_EXPORT_XML FALSE
+#endif
+
+/* section/key/name hash index, open addressing */
+#define CFG_INDEX_MIN_SIZE 64
+
 #ifndef FALSE
 #define TRUE 1
 #define FALSE 0
@@ -85,21 +114,68 @@ typedef struct cfg_node_s
     short flag;
 } cfg_node;
 
+typedef struct
+{
+    uint32_t hash;  /* 0: never used */
+    short si;       /* -1: deleted */
+    short ki;       /* -1: section entry */
+    short vi;       /* -1: key entry */
+    short reserved;
+} cfg_index_entry;
+
+typedef struct
+{
+    uint16_t magic;
+    uint8_t  op;
+    uint8_t  reserved;
+    uint16_t type;
+    uint16_t section_len;   /* all lengths include the terminating 0 */
+    uint16_t key_len;
+    uint16_t name_len;      /* 0: the whole key is removed */
+    uint16_t value_len;
+    uint16_t reserved2;
+    uint32_t check;         /* fnv-1a of the record with check set to 0 */
+} cfg_journal_rec;
+
+typedef struct
+{
+    char* data;
+    int len;
+    int size;
+} cfg_journal_buf;
+
 static pthread_mutex_t slot_lock;
 static int pth = -1; //poll thread handle
 static cfg_node root;
 static int cached_change;
+static int save_posted;
+static cfg_index_entry* cfg_index;
+static int cfg_index_size;      /* power of 2 */
+static int cfg_index_used;      /* live and deleted entries */
+static cfg_journal_buf journal; /* records not appended to the journal file yet */
+static int journal_file_bytes;
+static int journal_live_bytes;  /* size of the journal once compacted, as last computed */
+static int journal_resync;      /* a change was not buffered, the next save compacts */
 static void cfg_cmd_callback(int cmd_fd, int type, int flags, uint32_t user_id);
 static inline short alloc_node(cfg_node* p, short grow);
 static inline void free_node(cfg_node* p);
 static inline void free_inode(cfg_node* p, int child);
-static inline short find_inode(const cfg_node* p, const char* name);
+static int index_resize(int live);
+static cfg_index_entry* index_find(const char* section, const char* key, const char* name);
+static int index_add(const char* section, const char* key, const char* name, short si, short ki, short vi);
+static int journal_add(cfg_journal_buf* buf, int op, const char* section, const char* key,
+                       const char* name, const char* value, short bytes, short type);
+static int journal_flush();
+static int journal_load(const char* file_name);
+static int journal_compact();
+static int journal_live_size();
+static int journal_compact_due();
 static cfg_node* find_node(const char* section, const char* key, const char* name);
 static int remove_node(const char* section, const char* key, const char* name);
-static inline cfg_node* find_free_node(cfg_node* p);
 static int set_node(const char* section, const char* key, const char* name,
                         const char* value, short bytes, short type);
 static int save_cfg();
+static int save_xml();
 static void load_cfg();
 static short find_next_node(const cfg_node* p, short start, char* name, int* bytes);
 static int create_dir(const char* path);
@@ -133,6 +209,7 @@ int btif_config_init()
         lock_slot(&slot_lock);
         root.name = "Bluedroid";
         alloc_node(&root, CFG_GROW_SIZE);
+        index_resize(0);
         dump_node("root", &root);
         pth = btsock_thread_create(NULL, cfg_cmd_callback);
         load_cfg();
@@ -223,10 +300,16 @@ int btif_config_set(const char* section, const char* key, const char* name, cons
     {
         lock_slot(&slot_lock);
         ret = set_node(section, key, name, value, (short)bytes, (short)type);
-        if(ret && !(type & BTIF_CFG_TYPE_VOLATILE) && ++cached_change > MAX_CACHED_COUNT)
+        if(ret && !(type & BTIF_CFG_TYPE_VOLATILE))
         {
-            cached_change = 0;
-            btsock_thread_post_cmd(pth, CFG_CMD_SAVE, NULL, 0, 0);
+            if(!journal_add(&journal, CFG_JOURNAL_SET, section, key, name, value, (short)bytes, (short)type))
+                journal_resync = TRUE;
+            if((++cached_change > MAX_CACHED_COUNT || journal.len > CFG_JOURNAL_BUF_SIZE) && !save_posted)
+            {
+                cached_change = 0;
+                save_posted = TRUE;
+                btsock_thread_post_cmd(pth, CFG_CMD_SAVE, NULL, 0, 0);
+            }
         }
 
         unlock_slot(&slot_lock);
@@ -242,7 +325,11 @@ int btif_config_remove(const char* section, const char* key, const char* name)
          lock_slot(&slot_lock);
          ret = remove_node(section, key, name);
          if(ret)
+         {
+            if(!journal_add(&journal, CFG_JOURNAL_REMOVE, section, key, name, NULL, 0, 0))
+                journal_resync = TRUE;
             cached_change++;
+         }
          unlock_slot(&slot_lock);
     }
     return ret;
@@ -257,12 +344,9 @@ short btif_config_next_key(short pos, const char* section, char * name, int* byt
 {
     int next = -1;
     lock_slot(&slot_lock);
-    short si = find_inode(&root, section);
-    if(si >= 0)
-    {
-        const cfg_node* section_node = &root.child[si];
+    const cfg_node* section_node = section && *section ? find_node(section, NULL, NULL) : NULL;
+    if(section_node)
         next = find_next_node(section_node, pos, name, bytes);
-    }
     unlock_slot(&slot_lock);
     return next;
 }
@@ -270,17 +354,9 @@ short btif_config_next_value(short pos, const char* section, const char* key, ch
 {
     int next = -1;
     lock_slot(&slot_lock);
-    short si = find_inode(&root, section);
-    if(si >= 0)
-    {
-        const cfg_node* section_node = &root.child[si];
-        short ki = find_inode(section_node, key);
-        if(ki >= 0)
-        {
-            const cfg_node* key_node = &section_node->child[ki];
-            next = find_next_node(key_node, pos, name, bytes);
-        }
-    }
+    const cfg_node* key_node = section && *section && key && *key ? find_node(section, key, NULL) : NULL;
+    if(key_node)
+        next = find_next_node(key_node, pos, name, bytes);
     unlock_slot(&slot_lock);
     return next;
 }
@@ -321,9 +397,10 @@ int btif_config_enum(btif_config_enum_callback cb, void* user_data)
 int btif_config_save()
 {
     lock_slot(&slot_lock);
-    if(cached_change > 0)
+    if((cached_change > 0 || journal.len > 0 || journal_resync) && !save_posted)
     {
         cached_change = 0;
+        save_posted = TRUE;
         btsock_thread_post_cmd(pth, CFG_CMD_SAVE, NULL, 0, 0);
     }
     unlock_slot(&slot_lock);
@@ -332,9 +409,20 @@ int btif_config_save()
 void btif_config_flush()
 {
     lock_slot(&slot_lock);
-    if(cached_change > 0)
+    if(cached_change > 0 || journal.len > 0 || journal_resync)
         save_cfg();
+#if (BTIF_CONFIG_EXPORT_XML == TRUE)
+    save_xml();
+#endif
+    unlock_slot(&slot_lock);
+}
+int btif_config_export_xml()
+{
+    int ret;
+    lock_slot(&slot_lock);
+    ret = save_xml();
     unlock_slot(&slot_lock);
+    return ret;
 }
 /////////////////////////////////////////////////////////////////////////////////////////////
 static inline short alloc_node(cfg_node* p, short grow)
@@ -376,140 +464,208 @@ static inline void free_node(cfg_node* p)
         p->used = p->bytes = p->flag = p->type = 0;
     }
 }
-static inline short find_inode(const cfg_node* p, const char* name)
+static inline uint32_t cfg_hash(uint32_t h, const void* data, int len)
 {
-    //debug("in");
-    if(p && p->child && name && *name)
+    const uint8_t* p = (const uint8_t*)data;
+    while(len-- > 0)
+        h = (h ^ *p++) * 16777619u;
+    return h;
+}
+static uint32_t index_hash(const char* section, const char* key, const char* name)
+{
+    uint32_t h = cfg_hash(2166136261u, section, strlen(section) + 1);
+    if(key)
     {
-        int i;
-        int count = GET_CHILD_MAX_COUNT(p);
-        //debug("child name:%s, child max count:%d", name, count);
-        for(i = 0; i < count; i++)
+        h = cfg_hash(h, key, strlen(key) + 1);
+        if(name)
+            h = cfg_hash(h, name, strlen(name) + 1);
+    }
+    return h ? h : 1;
+}
+static inline cfg_node* index_node(const cfg_index_entry* e)
+{
+    cfg_node* node = &root.child[e->si];
+    if(e->ki >= 0)
+    {
+        node = &node->child[e->ki];
+        if(e->vi >= 0)
+            node = &node->child[e->vi];
+    }
+    return node;
+}
+/*******************************************************************************
+**
+** Function         index_resize
+**
+** Description      Rebuilds the index with room for twice the live entries
+**                  plus the given number, dropping the deleted ones. Entries
+**                  keep their hash so nothing is rehashed.
+**
+** Returns          TRUE if the new table could be allocated
+**
+*******************************************************************************/
+static int index_resize(int live)
+{
+    int i, j, size = CFG_INDEX_MIN_SIZE;
+    cfg_index_entry* table;
+    for(i = 0; i < cfg_index_size; i++)
+    {
+        if(cfg_index[i].hash && cfg_index[i].si >= 0)
+            live++;
+    }
+    while(size < live * 4)
+        size <<= 1;
+    if(!(table = (cfg_index_entry*)calloc(size, sizeof(cfg_index_entry))))
+    {
+        BTIF_TRACE_ERROR1("cannot allocate config index of %d entries", size);
+        return FALSE;
+    }
+    cfg_index_used = 0;
+    for(i = 0; i < cfg_index_size; i++)
+    {
+        if(cfg_index[i].hash && cfg_index[i].si >= 0)
         {
-            if(p->child[i].name && *p->child[i].name &&
-                strcmp(p->child[i].name, name) == 0)
-            {
-                  //debug("out found child index:%d", i);
-                  return (short)i;
-            }
+            j = cfg_index[i].hash & (size - 1);
+            while(table[j].hash)
+                j = (j + 1) & (size - 1);
+            table[j] = cfg_index[i];
+            cfg_index_used++;
         }
     }
-    //debug("out, child name: %s not found", name);
-    return -1;
+    free(cfg_index);
+    cfg_index = table;
+    cfg_index_size = size;
+    return TRUE;
 }
-static inline cfg_node* find_free_node(cfg_node* p)
+static cfg_index_entry* index_find(const char* section, const char* key, const char* name)
 {
-    if(p && p->child)
+    uint32_t h = index_hash(section, key, name);
+    int i = h & (cfg_index_size - 1);
+    while(cfg_index[i].hash)
     {
-        int i;
-        int count = GET_CHILD_MAX_COUNT(p);
-        //debug("p->name:%s, max child count:%d", p->name, count);
-        for(i = 0; i < count; i++)
+        const cfg_index_entry* e = &cfg_index[i];
+        if(e->hash == h && e->si >= 0 && (e->ki >= 0) == (key != NULL) &&
+           (e->vi >= 0) == (key != NULL && name != NULL))
         {
-            if(IS_EMPTY(p->child + i))
-                return p->child + i;
+            const cfg_node* section_node = &root.child[e->si];
+            if(strcmp(section_node->name, section) == 0 &&
+               (!key || (strcmp(section_node->child[e->ki].name, key) == 0 &&
+                         (!name || strcmp(section_node->child[e->ki].child[e->vi].name, name) == 0))))
+                return &cfg_index[i];
         }
+        i = (i + 1) & (cfg_index_size - 1);
     }
     return NULL;
 }
-static cfg_node* find_add_node(cfg_node* p, const char* name)
+static int index_add(const char* section, const char* key, const char* name, short si, short ki, short vi)
+{
+    uint32_t h = index_hash(section, key, name);
+    int i;
+    if((cfg_index_used + 1) * 2 > cfg_index_size && !index_resize(1))
+        return FALSE;
+    i = h & (cfg_index_size - 1);
+    while(cfg_index[i].hash && cfg_index[i].si >= 0)
+        i = (i + 1) & (cfg_index_size - 1);
+    if(!cfg_index[i].hash)
+        cfg_index_used++;
+    cfg_index[i].hash = h;
+    cfg_index[i].si = si;
+    cfg_index[i].ki = ki;
+    cfg_index[i].vi = vi;
+    return TRUE;
+}
+static inline void index_remove(cfg_index_entry* e)
+{
+    //keep the hash so that probing goes on past the deleted entry
+    if(e)
+        e->si = -1;
+}
+static short add_inode(cfg_node* p, const char* name)
 {
-    int i = -1;
-    cfg_node* node = NULL;
-    //debug("in, p->name:%s, p->bytes:%d, adding child:%s", p->name, p->bytes, name);
-    if((i = find_inode(p, name)) < 0)
+    int i, count = GET_CHILD_MAX_COUNT(p);
+    for(i = 0; i < count; i++)
     {
-        if(!(node = find_free_node(p)))
-        {
-            int old_size = alloc_node(p, CFG_GROW_SIZE);
-            if(old_size >= 0)
-            {
-                i = GET_NODE_COUNT(old_size);
-                node = &p->child[i];
-            }
-        }
+        if(IS_EMPTY(p->child + i))
+            break;
     }
-    else node = &p->child[i];
-    if(!node->name)
-        node->name = strdup(name);
-    //debug("out");
-    return node;
+    if(i == count)
+    {
+        int old_size = alloc_node(p, CFG_GROW_SIZE);
+        if(old_size < 0)
+            return -1;
+        i = GET_NODE_COUNT(old_size);
+    }
+    if(!(p->child[i].name = strdup(name)))
+        return -1;
+    return (short)i;
+}
+/*******************************************************************************
+**
+** Function         find_add_inode
+**
+** Description      Looks up the section, key or value node, adding it and
+**                  its index entry if it does not exist yet
+**
+** Returns          child index of the node in its parent, -1 on failure
+**
+*******************************************************************************/
+static short find_add_inode(const char* section, const char* key, const char* name,
+                            short si, short ki)
+{
+    const cfg_index_entry* e = index_find(section, key, name);
+    cfg_node* p = &root;
+    short i;
+    if(e)
+        return name ? e->vi : key ? e->ki : e->si;
+    if(key)
+    {
+        p = &root.child[si];
+        if(name)
+            p = &p->child[ki];
+    }
+    if((i = add_inode(p, name ? name : key ? key : section)) >= 0 &&
+       !index_add(section, key, name, name || key ? si : i, name ? ki : key ? i : -1, name ? i : -1))
+    {
+        free_node(&p->child[i]);
+        i = -1;
+    }
+    return i;
 }
 static int set_node(const char* section, const char* key, const char* name,
                     const char* value, short bytes, short type)
 {
-    int si = -1, ki = -1, vi = -1;
-    cfg_node* section_node = NULL;
-    //debug("in");
-    //dump_node("root", &root);
-    if((section_node = find_add_node(&root, section)))
+    short si = -1, ki = -1, vi = -1;
+    if((si = find_add_inode(section, NULL, NULL, -1, -1)) >= 0 &&
+       (ki = find_add_inode(section, key, NULL, si, -1)) >= 0 &&
+       (vi = find_add_inode(section, key, name, si, ki)) >= 0)
     {
-        //dump_node("section node", section_node);
-        cfg_node* key_node;
-        if((key_node = find_add_node(section_node, key)))
+        cfg_node* value_node = &root.child[si].child[ki].child[vi];
+        if(value_node->bytes < bytes)
         {
-            //dump_node("key node", key_node);
-            cfg_node* value_node;
-            if((value_node = find_add_node(key_node, name)))
+            if(value_node->value)
+                free(value_node->value);
+            value_node->value = (char*)malloc(bytes);
+            if(value_node->value)
+                value_node->bytes = bytes;
+            else
             {
-                //dump_node("value node", value_node);
-                if(value_node->bytes < bytes)
-                {
-                    if(value_node->value)
-                        free(value_node->value);
-                    value_node->value = (char*)malloc(bytes);
-                    if(value_node->value)
-                        value_node->bytes = bytes;
-                    else
-                    {
-                        BTIF_TRACE_ERROR0("not enough memory!");
-                        value_node->bytes = 0;
-                        return FALSE;
-                    }
-                }
-                if(value_node->value && value != NULL && bytes > 0)
-                    memcpy(value_node->value, value, bytes);
-                value_node->type = type;
-                value_node->used = bytes;
-                //dump_node("changed value node", value_node);
-                return TRUE;
+                BTIF_TRACE_ERROR0("not enough memory!");
+                value_node->bytes = 0;
+                return FALSE;
             }
         }
+        if(value_node->value && value != NULL && bytes > 0)
+            memcpy(value_node->value, value, bytes);
+        value_node->type = type;
+        value_node->used = bytes;
+        return TRUE;
     }
     return FALSE;
 }
 static cfg_node* find_node(const char* section, const char* key, const char* name)
 {
-    int si = -1, ki = -1, vi = -1;
-    if((si = find_inode(&root, section)) >= 0)
-    {
-        cfg_node* section_node = &root.child[si];
-        if(key)
-        {
-            //dump_node("found section node", section_node);
-            if((ki = find_inode(section_node, key)) >= 0)
-            {
-                cfg_node* key_node = &section_node->child[ki];
-                //dump_node("found key node", key_node);
-                if(name)
-                {
-                    if((vi = find_inode(key_node, name)) >= 0)
-                    {
-                        //dump_node("found value node", &key_node->child[vi]);
-                        return &key_node->child[vi];
-                    }
-                    //debug("value node:%s not found", name);
-                    return NULL;
-                }
-                return key_node;
-            }
-            //debug("key node:%s not found", key);
-            return NULL;
-        }
-        return section_node;
-    }
-    //debug("section node:%s not found", section);
-    return NULL;
+    const cfg_index_entry* e = index_find(section, key, key ? name : NULL);
+    return e ? index_node(e) : NULL;
 }
 static short find_next_node(const cfg_node* p, short start, char* name, int* bytes)
 {
@@ -547,33 +703,341 @@ static short find_next_node(const cfg_node* p, short start, char* name, int* byt
 }
 static int remove_node(const char* section, const char* key, const char* name)
 {
-    short  si = -1, ki = -1, vi = -1;
-    if((si = find_inode(&root, section)) >= 0)
+    cfg_index_entry* e;
+    if(key && (e = index_find(section, key, name)))
     {
-        cfg_node* section_node = &root.child[si];
-        if((ki = find_inode(section_node, key)) >= 0)
+        cfg_node* node = index_node(e);
+        if(name == NULL)
         {
-            cfg_node* key_node = &section_node->child[ki];
-            if(name == NULL)
+            int count = GET_CHILD_MAX_COUNT(node);
+            int i;
+            for(i = 0; i < count; i++)
             {
-                int count = GET_CHILD_MAX_COUNT(key_node);
-                int i;
-                for(i = 0; i < count; i++)
-                    free_node(&key_node->child[i]);
-                free_node(key_node);
-                return TRUE;
+                if(node->child[i].name)
+                {
+                    index_remove(index_find(section, key, node->child[i].name));
+                    free_node(&node->child[i]);
+                }
             }
-            else if((vi = find_inode(key_node, name)) >= 0)
+        }
+        index_remove(e);
+        free_node(node);
+        return TRUE;
+    }
+    return FALSE;
+}
+static int write_all(int fd, const char* data, int len)
+{
+    while(len > 0)
+    {
+        int ret = write(fd, data, len);
+        if(ret < 0 && errno == EINTR)
+            continue;
+        if(ret <= 0)
+            return FALSE;
+        data += ret;
+        len -= ret;
+    }
+    return TRUE;
+}
+/*******************************************************************************
+**
+** Function         journal_add
+**
+** Description      Appends a set or remove record to the buffer. A remove
+**                  record without name removes the whole key.
+**
+** Returns          TRUE if the record was added
+**
+*******************************************************************************/
+static int journal_add(cfg_journal_buf* buf, int op, const char* section, const char* key,
+                       const char* name, const char* value, short bytes, short type)
+{
+    cfg_journal_rec rec;
+    char* p;
+    int rec_bytes;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = CFG_JOURNAL_MAGIC;
+    rec.op = (uint8_t)op;
+    rec.type = (uint16_t)type;
+    rec.section_len = (uint16_t)(strlen(section) + 1);
+    rec.key_len = (uint16_t)(strlen(key) + 1);
+    rec.name_len = (uint16_t)(name ? strlen(name) + 1 : 0);
+    rec.value_len = (uint16_t)(value ? bytes : 0);
+    rec_bytes = sizeof(rec) + rec.section_len + rec.key_len + rec.name_len + rec.value_len;
+    if(buf->len + rec_bytes > buf->size)
+    {
+        int size = buf->size ? buf->size : CFG_JOURNAL_BUF_SIZE;
+        while(size < buf->len + rec_bytes)
+            size *= 2;
+        if(!(p = (char*)realloc(buf->data, size)))
+        {
+            BTIF_TRACE_ERROR1("cannot grow config journal buffer to %d bytes", size);
+            return FALSE;
+        }
+        buf->data = p;
+        buf->size = size;
+    }
+    p = buf->data + buf->len + sizeof(rec);
+    memcpy(p, section, rec.section_len);
+    p += rec.section_len;
+    memcpy(p, key, rec.key_len);
+    p += rec.key_len;
+    if(rec.name_len)
+        memcpy(p, name, rec.name_len);
+    p += rec.name_len;
+    if(rec.value_len)
+        memcpy(p, value, rec.value_len);
+    rec.check = cfg_hash(cfg_hash(2166136261u, &rec, sizeof(rec)),
+                         buf->data + buf->len + sizeof(rec), rec_bytes - sizeof(rec));
+    memcpy(buf->data + buf->len, &rec, sizeof(rec));
+    buf->len += rec_bytes;
+    return TRUE;
+}
+/*******************************************************************************
+**
+** Function         journal_flush
+**
+** Description      Appends the buffered records to the journal file. A
+**                  partial write is cut off again so that the next append
+**                  does not land behind a torn record.
+**
+** Returns          TRUE if the records are on disk
+**
+*******************************************************************************/
+static int journal_flush()
+{
+    const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL;
+    int fd, ret;
+    if(journal.len == 0)
+        return TRUE;
+    fd = open(file_name, O_WRONLY | O_APPEND);
+    if(fd < 0)
+    {
+        //the journal is only created whole, by compaction
+        if(errno == ENOENT)
+            return journal_compact();
+        BTIF_TRACE_ERROR2("cannot open %s, errno:%d", file_name, errno);
+        return FALSE;
+    }
+    ret = write_all(fd, journal.data, journal.len) && fdatasync(fd) == 0;
+    if(ret)
+    {
+        journal_file_bytes += journal.len;
+        journal.len = 0;
+    }
+    else
+    {
+        BTIF_TRACE_ERROR2("%s append failed, errno:%d", file_name, errno);
+        ftruncate(fd, journal_file_bytes);
+    }
+    close(fd);
+    return ret;
+}
+/*******************************************************************************
+**
+** Function         journal_compact
+**
+** Description      Rewrites the journal with one set record per persistent
+**                  value, replacing the buffered records as well
+**
+** Returns          TRUE if the new journal is in place
+**
+*******************************************************************************/
+static int journal_compact()
+{
+    const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL;
+    const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL CFG_FILE_EXT_NEW;
+    cfg_journal_buf buf = {NULL, 0, 0};
+    int si, ki, vi, fd, ret = FALSE;
+    for(si = 0; si < GET_CHILD_MAX_COUNT(&root); si++)
+    {
+        const cfg_node* section_node = &root.child[si];
+        if(!section_node->name)
+            continue;
+        for(ki = 0; ki < GET_CHILD_MAX_COUNT(section_node); ki++)
+        {
+            const cfg_node* key_node = &section_node->child[ki];
+            if(!key_node->name)
+                continue;
+            for(vi = 0; vi < GET_CHILD_MAX_COUNT(key_node); vi++)
             {
-                //debug("remove value:%s", key_node->child[vi].name);
-                free_node(&key_node->child[vi]);
-                return TRUE;
+                const cfg_node* value_node = &key_node->child[vi];
+                if(value_node->name && !(value_node->type & BTIF_CFG_TYPE_VOLATILE) &&
+                   !journal_add(&buf, CFG_JOURNAL_SET, section_node->name, key_node->name,
+                                value_node->name, value_node->value ? value_node->value : "",
+                                value_node->used, value_node->type))
+                    goto out;
             }
         }
     }
-    return FALSE;
+    fd = open(file_name_new, O_WRONLY | O_CREAT | O_TRUNC, 0660);
+    if(fd < 0)
+    {
+        BTIF_TRACE_ERROR2("cannot create %s, errno:%d", file_name_new, errno);
+        goto out;
+    }
+    ret = write_all(fd, buf.data, buf.len) && fsync(fd) == 0;
+    close(fd);
+    if(ret)
+    {
+#ifndef LINUX_NATIVE
+        chown(file_name_new, -1, AID_NET_BT_STACK);
+#endif
+        ret = rename(file_name_new, file_name) == 0;
+    }
+    if(ret)
+    {
+        BTIF_TRACE_DEBUG2("journal compacted from %d to %d bytes", journal_file_bytes + journal.len, buf.len);
+        journal_file_bytes = journal_live_bytes = buf.len;
+        journal.len = 0;
+        cached_change = 0;
+        journal_resync = FALSE;
+    }
+    else
+    {
+        BTIF_TRACE_ERROR2("%s write failed, errno:%d", file_name_new, errno);
+        unlink(file_name_new);
+    }
+out:
+    free(buf.data);
+    return ret;
+}
+/*******************************************************************************
+**
+** Function         journal_load
+**
+** Description      Replays the journal file. Replay stops at the first
+**                  incomplete or corrupt record, which is cut off together
+**                  with anything behind it.
+**
+** Returns          TRUE if the journal exists
+**
+*******************************************************************************/
+static int journal_load(const char* file_name)
+{
+    struct stat st;
+    char* data = NULL;
+    int fd, size, pos = 0, rd = 0;
+    if((fd = open(file_name, O_RDWR)) < 0)
+        return FALSE;
+    if(fstat(fd, &st) == 0 && st.st_size > 0 && (data = (char*)malloc(st.st_size)))
+    {
+        size = (int)st.st_size;
+        while(rd < size)
+        {
+            int ret = read(fd, data + rd, size - rd);
+            if(ret < 0 && errno == EINTR)
+                continue;
+            if(ret <= 0)
+                break;
+            rd += ret;
+        }
+        while(pos + (int)sizeof(cfg_journal_rec) <= rd)
+        {
+            cfg_journal_rec rec;
+            uint32_t check;
+            memcpy(&rec, data + pos, sizeof(rec));
+            const char* section = data + pos + sizeof(rec);
+            const char* key = section + rec.section_len;
+            const char* name = key + rec.key_len;
+            const char* value = name + rec.name_len;
+            int rec_bytes = sizeof(rec) + rec.section_len + rec.key_len + rec.name_len + rec.value_len;
+            if(rec.magic != CFG_JOURNAL_MAGIC || pos + rec_bytes > rd ||
+               rec.section_len < 2 || rec.key_len < 2 || rec.name_len == 1)
+                break;
+            check = rec.check;
+            rec.check = 0;
+            if(cfg_hash(cfg_hash(2166136261u, &rec, sizeof(rec)), section, rec_bytes - sizeof(rec)) != check ||
+               section[rec.section_len - 1] || key[rec.key_len - 1] || (rec.name_len && name[rec.name_len - 1]))
+                break;
+            if(rec.op == CFG_JOURNAL_SET && rec.name_len)
+                set_node(section, key, name, value, rec.value_len, rec.type);
+            else if(rec.op == CFG_JOURNAL_REMOVE)
+                remove_node(section, key, rec.name_len ? name : NULL);
+            pos += rec_bytes;
+        }
+    }
+    if(pos < (int)st.st_size)
+    {
+        BTIF_TRACE_ERROR3("%s: dropping %d bytes after offset %d", file_name, (int)st.st_size - pos, pos);
+        ftruncate(fd, pos);
+    }
+    journal_file_bytes = pos;
+    free(data);
+    close(fd);
+    return TRUE;
+}
+/*******************************************************************************
+**
+** Function         journal_live_size
+**
+** Description      Size of the journal if it was compacted now
+**
+** Returns          bytes
+**
+*******************************************************************************/
+static int journal_live_size()
+{
+    int si, ki, vi, size = 0;
+    for(si = 0; si < GET_CHILD_MAX_COUNT(&root); si++)
+    {
+        const cfg_node* section_node = &root.child[si];
+        if(!section_node->name)
+            continue;
+        for(ki = 0; ki < GET_CHILD_MAX_COUNT(section_node); ki++)
+        {
+            const cfg_node* key_node = &section_node->child[ki];
+            if(!key_node->name)
+                continue;
+            for(vi = 0; vi < GET_CHILD_MAX_COUNT(key_node); vi++)
+            {
+                const cfg_node* value_node = &key_node->child[vi];
+                if(value_node->name && !(value_node->type & BTIF_CFG_TYPE_VOLATILE))
+                    size += sizeof(cfg_journal_rec) + strlen(section_node->name) + 1 +
+                            strlen(key_node->name) + 1 + strlen(value_node->name) + 1 +
+                            value_node->used;
+            }
+        }
+    }
+    return size;
+}
+/*******************************************************************************
+**
+** Function         journal_compact_due
+**
+** Description      Checks the journal file against the compaction thresholds.
+**                  The live size is only walked again when the last one
+**                  computed says the journal is over the ratio.
+**
+** Returns          TRUE if the journal should be compacted
+**
+*******************************************************************************/
+static int journal_compact_due()
+{
+    if(journal_file_bytes <= CFG_JOURNAL_COMPACT_MIN ||
+       journal_file_bytes <= journal_live_bytes * CFG_JOURNAL_COMPACT_RATIO)
+        return FALSE;
+    journal_live_bytes = journal_live_size();
+    return journal_file_bytes > journal_live_bytes * CFG_JOURNAL_COMPACT_RATIO;
 }
 static int save_cfg()
+{
+    int ret;
+    //a change missing from the buffer leaves only the tree right, write it whole
+    if(journal_resync)
+        ret = journal_compact();
+    else
+    {
+        ret = journal_flush();
+        if(ret && journal_compact_due())
+            ret = journal_compact();
+    }
+    if(ret)
+        cached_change = 0;
+    return ret;
+}
+static int save_xml()
 {
     const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT;
     const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_NEW;
@@ -585,7 +1049,6 @@ static int save_cfg()
         unlink(file_name_new);
    if(btif_config_save_file(file_name_new))
     {
-        cached_change = 0;
 #ifndef LINUX_NATIVE
         chown(file_name_new, -1, AID_NET_BT_STACK);
 #endif
@@ -656,13 +1119,23 @@ static void load_cfg()
     const char* file_name = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT;
     const char* file_name_new = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_NEW;
     const char* file_name_old = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_OLD;
-    if(!btif_config_load_file(file_name))
+    const char* file_name_journal = CFG_PATH CFG_FILE_NAME CFG_FILE_EXT_JOURNAL;
+    if(journal_load(file_name_journal))
+    {
+        journal_live_bytes = journal_live_size();
+        if(journal_compact_due())
+            journal_compact();
+    }
+    else
     {
-        unlink(file_name);
-        if(!btif_config_load_file(file_name_old))
+        //first start on the journal, import the xml config or the bluez one
+        if(btif_config_load_file(file_name) || btif_config_load_file(file_name_old))
+            journal_compact();
+        else
         {
+            unlink(file_name);
             unlink(file_name_old);
-            if(load_bluez_cfg() && save_cfg())
+            if(load_bluez_cfg() && journal_compact())
                 remove_bluez_cfg();
         }
     }
@@ -683,6 +1156,7 @@ static void cfg_cmd_callback(int cmd_fd, int type, int size, uint32_t user_id)
     {
         case CFG_CMD_SAVE:
             lock_slot(&slot_lock);
+            save_posted = FALSE;
             save_cfg();
             unlock_slot(&slot_lock);
             break;
@@ -0,0 +1,72 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ **
+ **  Name:          btif_media_clock.c
+ **
+ **  Description:   Frame accounting of the A2DP source media clock, kept
+ **                 apart from the media task so it can be exercised alone
+ **
+ ******************************************************************************/
+
+#include "btif_media_clock.h"
+
+/*****************************************************************************
+ **  Constants & Macros
+ ******************************************************************************/
+
+#define BTIF_MEDIA_CLOCK_USEC_PER_SEC   1000000
+#define BTIF_MEDIA_CLOCK_MAX_FRAMES     0xFF
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_frames
+ **
+ ** Description      Converts elapsed_us of pcm time into frames, carrying
+ **                  the fraction of a frame over in *p_residue
+ **
+ ** Returns          The number of frames due
+ **
+ *******************************************************************************/
+UINT8 btif_media_clock_frames(int64_t *p_residue, uint64_t elapsed_us,
+                              UINT32 sample_rate, UINT32 frame_samples,
+                              BOOLEAN round_up)
+{
+    /* residue and frame cost are in samples x us to keep the division exact */
+    int64_t frame_cost = (int64_t)frame_samples * BTIF_MEDIA_CLOCK_USEC_PER_SEC;
+    int64_t frames = 0;
+
+    *p_residue += (int64_t)(elapsed_us * sample_rate);
+    if (*p_residue > 0)
+    {
+        frames = *p_residue / frame_cost;
+        if (frames > BTIF_MEDIA_CLOCK_MAX_FRAMES)
+            frames = BTIF_MEDIA_CLOCK_MAX_FRAMES;
+        *p_residue -= frames * frame_cost;
+    }
+
+    /* a partial frame sent ahead is owed by the next ticks */
+    if (round_up && (*p_residue > 0) && (frames < BTIF_MEDIA_CLOCK_MAX_FRAMES))
+    {
+        frames++;
+        *p_residue -= frame_cost;
+    }
+
+    return (UINT8)frames;
+}
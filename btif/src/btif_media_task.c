@@ -35,6 +35,8 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <sys/prctl.h>
+#include <errno.h>
 
 #include "bt_target.h"
 #include "gki.h"
@@ -54,10 +56,12 @@
 
 #include "btif_av_co.h"
 #include "btif_media.h"
+#include "btif_media_clock.h"
 
 
 #if (BTA_AV_INCLUDED == TRUE)
 #include "sbc_encoder.h"
+#include "sbc_decoder.h"
 #endif
 
 #define LOG_TAG "BTIF-MEDIA"
@@ -103,7 +107,8 @@ enum
     BTIF_MEDIA_FLUSH_AA_TX,
     BTIF_MEDIA_FLUSH_AA_RX,
     BTIF_MEDIA_AUDIO_FEEDING_INIT,
-    BTIF_MEDIA_AUDIO_RECEIVING_INIT
+    BTIF_MEDIA_AUDIO_RECEIVING_INIT,
+    BTIF_MEDIA_STOP_AA_RX
 };
 
 enum {
@@ -136,6 +141,33 @@ enum {
 /* 2.5 frames/tick  @ 20 ms tick (every 2nd frame send one less) */
 #define BTIF_MEDIA_FR_PER_TICKS_16               (3 * BTIF_MEDIA_NUM_TICK)
 
+/*
+ * A2DP SOURCE MEDIA CLOCK ::
+ *
+ * When BTIF_MEDIA_CLOCK_TIMERFD is TRUE the encoder is paced by a
+ * CLOCK_MONOTONIC timerfd firing every BTIF_MEDIA_CLOCK_PERIOD_MS instead
+ * of the GKI timer. Each tick encodes the pcm time that really elapsed since
+ * the previous one, keeping the remainder for the next tick, so a late tick
+ * sends more frames rather than drifting. At most BTIF_MEDIA_CLOCK_MAX_LATE_MS
+ * of audio is caught up at once, anything beyond is dropped.
+ * The GKI timer (BTIF_MEDIA_TIME_TICK) remains the fallback.
+ */
+#ifndef BTIF_MEDIA_CLOCK_TIMERFD
+#define BTIF_MEDIA_CLOCK_TIMERFD TRUE
+#endif
+
+#ifndef BTIF_MEDIA_CLOCK_PERIOD_MS
+#define BTIF_MEDIA_CLOCK_PERIOD_MS 10
+#endif
+
+#ifndef BTIF_MEDIA_CLOCK_MAX_LATE_MS
+#define BTIF_MEDIA_CLOCK_MAX_LATE_MS 100
+#endif
+
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+#include <sys/timerfd.h>
+#endif
+
 
 /* buffer pool */
 #define BTIF_MEDIA_AA_POOL_ID GKI_POOL_ID_3
@@ -156,6 +188,31 @@ enum {
 /* Middle quality quality setting @ 44.1 khz */
 #define DEFAULT_SBC_BITRATE 229
 
+/*
+ * A2DP SINK JITTER BUFFER ::
+ *
+ * Received media packets are queued until BTIF_MEDIA_SINK_PREFILL_MS of
+ * audio is available, then decoded at the pace of the media task tick.
+ * The oldest packets are dropped once more than BTIF_MEDIA_SINK_MAX_MS is
+ * queued (source running fast or pcm reader stalled), and an empty queue
+ * at decode time goes back to prefilling.
+ */
+#ifndef BTIF_MEDIA_SINK_PREFILL_MS
+#define BTIF_MEDIA_SINK_PREFILL_MS 100
+#endif
+
+#ifndef BTIF_MEDIA_SINK_MAX_MS
+#define BTIF_MEDIA_SINK_MAX_MS 500
+#endif
+
+/* pcm samples written per tick : one tick of 48 khz stereo plus the frame
+   decoded ahead of the tick boundary */
+#define BTIF_MEDIA_SINK_PCM_MAX (2 * (48 * BTIF_MEDIA_TIME_TICK) + SBC_DEC_MAX_PCM_SAMPLES)
+
+/* sbc media payload header (A2DP 4.3.4) */
+#define BTIF_MEDIA_SBC_HDR_FRAG_MASK     0x80
+#define BTIF_MEDIA_SBC_HDR_NUM_MASK      0x0F
+
 #ifndef A2DP_MEDIA_TASK_STACK_SIZE
 #define A2DP_MEDIA_TASK_STACK_SIZE       0x2000         /* In bytes */
 #endif
@@ -204,6 +261,8 @@ typedef struct
     UINT32 aa_frame_counter;
     INT32  aa_feed_counter;
     INT32  aa_feed_residue;
+    uint64_t aa_clock_last_us;  /* monotonic time of the previous media clock tick */
+    int64_t aa_clock_residue;   /* pcm time not encoded yet, in samples x us, negative when sent ahead */
 } tBTIF_AV_MEDIA_FEEDINGS_PCM_STATE;
 
 
@@ -229,6 +288,36 @@ typedef struct
     UINT8 a2dp_cmd_pending; /* we can have max one command pending */
     BOOLEAN tx_flush; /* discards any outgoing data when true */
     BOOLEAN scaling_disabled;
+
+    /* a2dp source media clock */
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+    int tx_clock_fd;            /* timerfd, -1 until the first stream starts */
+    pthread_t tx_clock_tid;
+    BOOLEAN tx_clock_exit;      /* set by the closer, read by the clock thread */
+#endif
+    UINT32 tx_ticks;
+    UINT32 tx_late_ticks;       /* ticks more than half a period late */
+    UINT32 tx_underruns;        /* short pcm reads from the audio path */
+    UINT32 tx_q_depth_max;      /* TxAaQ depth seen at each tick */
+    UINT32 tx_q_depth_sum;
+    UINT32 tx_pcm_in_place;     /* shm ring bytes the encoder reads in place */
+
+    /* a2dp sink path */
+    BUFFER_Q RxSbcQ;            /* jitter buffer, sbc frames of each packet start at offset */
+    BOOLEAN is_rx_timer;
+    BOOLEAN rx_active;          /* the stream was started with us as the sink */
+    BOOLEAN rx_prefill;         /* waiting for BTIF_MEDIA_SINK_PREFILL_MS of audio */
+    BOOLEAN rx_pcm_open;        /* a pcm reader is attached to the sink channel */
+    SBC_DEC_PARAMS decoder;
+    UINT32 rx_sample_rate;      /* of the last packet queued */
+    UINT32 rx_queued_samples;   /* per channel, in RxSbcQ */
+    UINT32 rx_tick_budget;      /* samples owed to the pcm reader, in 1/1000 sample */
+    UINT16 rx_last_seq;
+    BOOLEAN rx_seq_valid;
+    UINT32 rx_lost_pkts;
+    UINT32 rx_overruns;
+    UINT32 rx_underruns;
+    UINT32 rx_bad_frames;
 #endif
 
 } tBTIF_MEDIA_CB;
@@ -248,6 +337,17 @@ typedef struct {
 static tBTIF_MEDIA_CB btif_media_cb;
 static int media_task_running = MEDIA_TASK_STATE_OFF;
 
+#if (BTA_AV_INCLUDED == TRUE)
+#if (SBC_NO_PCM_CPY_OPTION == TRUE)
+/* encoder input when the pcm can not be read in place from the shm ring */
+static SINT16 btif_media_pcm_buf[SBC_MAX_NUM_FRAME * SBC_MAX_NUM_OF_BLOCKS
+        * SBC_MAX_NUM_OF_CHANNELS * SBC_MAX_NUM_OF_SUBBANDS];
+#define BTIF_MEDIA_PCM_BUF btif_media_pcm_buf
+#else
+#define BTIF_MEDIA_PCM_BUF btif_media_cb.encoder.as16PcmBuffer
+#endif
+#endif
+
 
 /*****************************************************************************
  **  Local functions
@@ -274,6 +374,15 @@ static void btif_media_task_enc_update(BT_HDR *p_msg);
 static void btif_media_task_audio_feeding_init(BT_HDR *p_msg);
 static void btif_media_task_aa_tx_flush(BT_HDR *p_msg);
 static void btif_media_aa_prep_2_send(UINT8 nb_frame);
+static void btif_a2dp_sink_data_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event);
+static void btif_media_task_aa_start_rx(void);
+static void btif_media_task_aa_stop_rx(void);
+static void btif_media_task_aa_rx_flush(void);
+static void btif_media_task_aa_rx_enqueue(BT_HDR *p_msg);
+static void btif_media_task_aa_handle_rx_timer(void);
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+static void btif_media_clock_close(void);
+#endif
 #endif
 
 
@@ -360,6 +469,7 @@ const char* dump_media_event(UINT16 event)
         CASE_RETURN_STR(BTIF_MEDIA_FLUSH_AA_RX)
         CASE_RETURN_STR(BTIF_MEDIA_AUDIO_FEEDING_INIT)
         CASE_RETURN_STR(BTIF_MEDIA_AUDIO_RECEIVING_INIT)
+        CASE_RETURN_STR(BTIF_MEDIA_STOP_AA_RX)
 
         default:
             return "UNKNOWN MEDIA EVENT";
@@ -845,7 +955,16 @@ void btif_a2dp_on_started(tBTA_AV_START *p_av)
 
     if (p_av->status == BTA_AV_SUCCESS)
     {
-        if (p_av->suspending == FALSE)
+        if ((p_av->suspending == FALSE) && bta_av_co_audio_is_sink(p_av->hndl))
+        {
+            /* the peer is the source, decode what it sends */
+            if (p_av->initiator)
+                a2dp_cmd_acknowledge(A2DP_CTRL_ACK_SUCCESS);
+
+            btif_media_cb.rx_active = TRUE;
+            btif_media_task_aa_start_rx_req();
+        }
+        else if (p_av->suspending == FALSE)
         {
             if (p_av->initiator)
             {
@@ -895,6 +1014,13 @@ void btif_a2dp_on_stopped(tBTA_AV_SUSPEND *p_av)
         }
     }
 
+    if (btif_media_cb.rx_active)
+    {
+        btif_media_cb.rx_active = FALSE;
+        btif_media_task_aa_stop_rx_req();
+        return;
+    }
+
     /* ensure tx frames are immediately suspended */
     btif_media_cb.tx_flush = 1;
 
@@ -929,6 +1055,16 @@ void btif_a2dp_on_suspended(tBTA_AV_SUSPEND *p_av)
 
     /* once stream is fully stopped we will ack back */
 
+    if (btif_media_cb.rx_active)
+    {
+        if (p_av->status == BTA_AV_SUCCESS)
+        {
+            btif_media_cb.rx_active = FALSE;
+            btif_media_task_aa_stop_rx_req();
+        }
+        return;
+    }
+
     /* ensure tx frames are immediately flushed */
     btif_media_cb.tx_flush = 1;
 
@@ -997,6 +1133,10 @@ static void btif_media_task_aa_handle_timer(void)
     log_tstamps_us("media task tx timer");
 
 #if (BTA_AV_INCLUDED == TRUE)
+    /* a media clock tick may still be pending after the stream stopped */
+    if (btif_media_cb.is_tx_timer == FALSE)
+        return;
+
     btif_media_send_aa_frame();
 #endif
 }
@@ -1040,6 +1180,9 @@ static void btif_media_task_aa_handle_uipc_rx_rdy(void)
 void btif_media_task_init(void)
 {
     memset(&(btif_media_cb), 0, sizeof(btif_media_cb));
+#if (BTA_AV_INCLUDED == TRUE) && (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+    btif_media_cb.tx_clock_fd = -1;
+#endif
 
     UIPC_Init(NULL);
 
@@ -1106,6 +1249,14 @@ int btif_media_task(void *p)
             btif_media_task_aa_handle_timer();
         }
 
+#if (BTA_AV_INCLUDED == TRUE)
+        if (event & BTIF_MEDIA_AV_TASK_TIMER)
+        {
+            /* sink side, decode one tick worth of audio */
+            btif_media_task_aa_handle_rx_timer();
+        }
+#endif
+
 
         VERBOSE("=============== MEDIA TASK EVENT %d DONE ============", event);
 
@@ -1117,6 +1268,10 @@ int btif_media_task(void *p)
 
             /* this calls blocks until uipc is fully closed */
             UIPC_Close(UIPC_CH_ID_ALL);
+
+#if (BTA_AV_INCLUDED == TRUE) && (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+            btif_media_clock_close();
+#endif
             break;
         }
     }
@@ -1208,6 +1363,15 @@ static void btif_media_task_handle_cmd(BT_HDR *p_msg)
     case BTIF_MEDIA_UIPC_RX_RDY:
         btif_media_task_aa_handle_uipc_rx_rdy();
         break;
+    case BTIF_MEDIA_SBC_DEC_INIT:
+        btif_media_task_aa_start_rx();
+        break;
+    case BTIF_MEDIA_STOP_AA_RX:
+        btif_media_task_aa_stop_rx();
+        break;
+    case BTIF_MEDIA_FLUSH_AA_RX:
+        btif_media_task_aa_rx_flush();
+        break;
 #endif
     default:
         APPL_TRACE_ERROR1("ERROR in btif_media_task_handle_cmd unknown event %d", p_msg->event);
@@ -1227,7 +1391,15 @@ static void btif_media_task_handle_cmd(BT_HDR *p_msg)
  *******************************************************************************/
 static void btif_media_task_handle_media(BT_HDR *p_msg)
 {
-    APPL_TRACE_ERROR0("ERROR btif_media_task_handle_media: not in use");
+#if (BTA_AV_INCLUDED == TRUE)
+    if (p_msg->event == BTIF_MEDIA_AA_RX_RDY)
+    {
+        /* ownership moves to the jitter buffer */
+        btif_media_task_aa_rx_enqueue(p_msg);
+        return;
+    }
+#endif
+    APPL_TRACE_ERROR1("ERROR btif_media_task_handle_media: unknown event %d", p_msg->event);
 
     GKI_freebuf(p_msg);
 }
@@ -1378,6 +1550,48 @@ BOOLEAN btif_media_task_aa_tx_flush_req(void)
     return TRUE;
 }
 
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_start_rx_req
+ **
+ ** Description
+ **
+ ** Returns          TRUE is success
+ **
+ *******************************************************************************/
+BOOLEAN btif_media_task_aa_start_rx_req(void)
+{
+    return btif_media_task_send_cmd_evt(BTIF_MEDIA_SBC_DEC_INIT);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_stop_rx_req
+ **
+ ** Description
+ **
+ ** Returns          TRUE is success
+ **
+ *******************************************************************************/
+BOOLEAN btif_media_task_aa_stop_rx_req(void)
+{
+    return btif_media_task_send_cmd_evt(BTIF_MEDIA_STOP_AA_RX);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_rx_flush_req
+ **
+ ** Description
+ **
+ ** Returns          TRUE is success
+ **
+ *******************************************************************************/
+BOOLEAN btif_media_task_aa_rx_flush_req(void)
+{
+    return btif_media_task_send_cmd_evt(BTIF_MEDIA_FLUSH_AA_RX);
+}
+
 /*******************************************************************************
  **
  ** Function         btif_media_task_aa_tx_flush
@@ -1728,6 +1942,146 @@ static void btif_media_task_feeding_state_reset(void)
     /* By default, just clear the entire state */
     memset(&btif_media_cb.media_feeding_state, 0, sizeof(btif_media_cb.media_feeding_state));
 }
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_now_us
+ **
+ ** Description      Reads CLOCK_MONOTONIC
+ **
+ ** Returns          microseconds
+ **
+ *******************************************************************************/
+static uint64_t btif_media_clock_now_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_thread
+ **
+ ** Description      Waits on the media clock timerfd and posts the tx timer
+ **                  event to the media task on every expiration. Missed
+ **                  expirations are not replayed; the media task encodes
+ **                  from the elapsed time instead.
+ **
+ ** Returns          void *
+ **
+ *******************************************************************************/
+static void *btif_media_clock_thread(void *arg)
+{
+    uint64_t expirations;
+
+    prctl(PR_SET_NAME, (unsigned long)"a2dp-clock", 0, 0, 0);
+    raise_priority_a2dp(TASK_HIGH_MEDIA);
+
+    while (1)
+    {
+        if (read(btif_media_cb.tx_clock_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        {
+            if (errno == EINTR)
+                continue;
+            APPL_TRACE_ERROR1("media clock read failed : %s", strerror(errno));
+            break;
+        }
+
+        if (__atomic_load_n(&btif_media_cb.tx_clock_exit, __ATOMIC_ACQUIRE))
+            break;
+
+        GKI_send_event(BT_MEDIA_TASK, BTIF_MEDIA_AA_TASK_TIMER);
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_open
+ **
+ ** Description      Creates the media clock timerfd and its thread, once
+ **
+ ** Returns          TRUE if the media clock is available
+ **
+ *******************************************************************************/
+static BOOLEAN btif_media_clock_open(void)
+{
+    if (btif_media_cb.tx_clock_fd >= 0)
+        return TRUE;
+
+    btif_media_cb.tx_clock_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (btif_media_cb.tx_clock_fd < 0)
+    {
+        APPL_TRACE_ERROR1("media clock timerfd_create failed : %s", strerror(errno));
+        return FALSE;
+    }
+
+    __atomic_store_n(&btif_media_cb.tx_clock_exit, FALSE, __ATOMIC_RELAXED);
+    if (pthread_create(&btif_media_cb.tx_clock_tid, NULL, btif_media_clock_thread, NULL) != 0)
+    {
+        APPL_TRACE_ERROR0("media clock thread creation failed");
+        close(btif_media_cb.tx_clock_fd);
+        btif_media_cb.tx_clock_fd = -1;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_arm
+ **
+ ** Description      Starts (period_ms != 0) or stops the media clock
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_clock_arm(UINT32 period_ms)
+{
+    struct itimerspec its;
+
+    its.it_value.tv_sec = period_ms / 1000;
+    its.it_value.tv_nsec = (period_ms % 1000) * 1000000L;
+    its.it_interval = its.it_value;
+
+    if (timerfd_settime(btif_media_cb.tx_clock_fd, 0, &its, NULL) < 0)
+        APPL_TRACE_ERROR1("media clock timerfd_settime failed : %s", strerror(errno));
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_close
+ **
+ ** Description      Wakes the media clock thread up for exit, joins it and
+ **                  releases the timerfd
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_clock_close(void)
+{
+    struct itimerspec its;
+
+    if (btif_media_cb.tx_clock_fd < 0)
+        return;
+
+    /* expire once right away so the blocked read returns and sees the flag */
+    __atomic_store_n(&btif_media_cb.tx_clock_exit, TRUE, __ATOMIC_RELEASE);
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_nsec = 1;
+    timerfd_settime(btif_media_cb.tx_clock_fd, 0, &its, NULL);
+
+    pthread_join(btif_media_cb.tx_clock_tid, NULL);
+    close(btif_media_cb.tx_clock_fd);
+    btif_media_cb.tx_clock_fd = -1;
+}
+#endif
+
 /*******************************************************************************
  **
  ** Function         btif_media_task_aa_start_tx
@@ -1750,6 +2104,22 @@ static void btif_media_task_aa_start_tx(void)
 
     /* Reset the media feeding state */
     btif_media_task_feeding_state_reset();
+    btif_media_cb.media_feeding_state.pcm.aa_clock_last_us = btif_media_clock_now_us();
+
+    btif_media_cb.tx_ticks = 0;
+    btif_media_cb.tx_late_ticks = 0;
+    btif_media_cb.tx_underruns = 0;
+    btif_media_cb.tx_q_depth_max = 0;
+    btif_media_cb.tx_q_depth_sum = 0;
+
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+    if (btif_media_clock_open())
+    {
+        APPL_TRACE_EVENT1("starting media clock %d ms", BTIF_MEDIA_CLOCK_PERIOD_MS);
+        btif_media_clock_arm(BTIF_MEDIA_CLOCK_PERIOD_MS);
+        return;
+    }
+#endif
 
     APPL_TRACE_EVENT2("starting timer %d ticks (%d)", GKI_MS_TO_TICKS(BTIF_MEDIA_TIME_TICK), TICKS_PER_SEC);
     GKI_start_timer(BTIF_MEDIA_AA_TASK_TIMER_ID, GKI_MS_TO_TICKS(BTIF_MEDIA_TIME_TICK), TRUE);
@@ -1769,7 +2139,18 @@ static void btif_media_task_aa_stop_tx(void)
     APPL_TRACE_DEBUG1("btif_media_task_aa_stop_tx is timer: %d", btif_media_cb.is_tx_timer);
 
     /* Stop the timer first */
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+    if (btif_media_cb.tx_clock_fd >= 0)
+        btif_media_clock_arm(0);
+#endif
     GKI_stop_timer(BTIF_MEDIA_AA_TASK_TIMER_ID);
+
+    if (btif_media_cb.is_tx_timer && btif_media_cb.tx_ticks)
+    {
+        APPL_TRACE_EVENT5("media tx stats : ticks %d, late %d, underruns %d, queue max %d, avg %d",
+                btif_media_cb.tx_ticks, btif_media_cb.tx_late_ticks, btif_media_cb.tx_underruns,
+                btif_media_cb.tx_q_depth_max, btif_media_cb.tx_q_depth_sum / btif_media_cb.tx_ticks);
+    }
     btif_media_cb.is_tx_timer = FALSE;
 
     UIPC_Close(UIPC_CH_ID_AV_AUDIO);
@@ -1792,13 +2173,88 @@ static void btif_media_task_aa_stop_tx(void)
  *******************************************************************************/
 
 
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+/*******************************************************************************
+ **
+ ** Function         btif_media_clock_num_sbc_frame
+ **
+ ** Description      Converts the pcm time elapsed since the previous media
+ **                  clock tick into sbc frames, carrying the fraction of a
+ **                  frame over to the next tick
+ **
+ ** Returns          The number of sbc frames due
+ **
+ *******************************************************************************/
+static UINT8 btif_media_clock_num_sbc_frame(uint64_t elapsed_us)
+{
+    tBTIF_AV_MEDIA_FEEDINGS_PCM_STATE *p_state = &btif_media_cb.media_feeding_state.pcm;
+    UINT32 sample_rate;
+
+    switch (btif_media_cb.encoder.s16SamplingFreq)
+    {
+    case SBC_sf16000:
+        sample_rate = 16000;
+        break;
+    case SBC_sf32000:
+        sample_rate = 32000;
+        break;
+    case SBC_sf44100:
+        sample_rate = 44100;
+        break;
+    default:
+        sample_rate = 48000;
+        break;
+    }
+
+    if (elapsed_us > BTIF_MEDIA_CLOCK_MAX_LATE_MS * 1000)
+    {
+        APPL_TRACE_WARNING1("media clock stalled %d us, dropping the excess",
+                (int)elapsed_us);
+        elapsed_us = BTIF_MEDIA_CLOCK_MAX_LATE_MS * 1000;
+    }
+
+    /* without rate scaling partial frames are sent ahead, as with the gki
+       tick, and taken back from the following ticks */
+    return btif_media_clock_frames(&p_state->aa_clock_residue, elapsed_us, sample_rate,
+                                   (UINT32)btif_media_cb.encoder.s16NumOfBlocks *
+                                   btif_media_cb.encoder.s16NumOfSubBands,
+                                   btif_media_cb.scaling_disabled);
+}
+#endif
+
 static UINT8 btif_get_num_aa_frame(void)
 {
     UINT8 result=0;
+    tBTIF_AV_MEDIA_FEEDINGS_PCM_STATE *p_state = &btif_media_cb.media_feeding_state.pcm;
+    uint64_t now_us = btif_media_clock_now_us();
+    uint64_t elapsed_us = now_us - p_state->aa_clock_last_us;
+    UINT32 period_us = BTIF_MEDIA_TIME_TICK * 1000;
+
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+    if (btif_media_cb.tx_clock_fd >= 0)
+        period_us = BTIF_MEDIA_CLOCK_PERIOD_MS * 1000;
+#endif
+
+    /* per stream statistics */
+    p_state->aa_clock_last_us = now_us;
+    btif_media_cb.tx_ticks++;
+    if (elapsed_us > period_us + period_us / 2)
+        btif_media_cb.tx_late_ticks++;
+    btif_media_cb.tx_q_depth_sum += btif_media_cb.TxAaQ.count;
+    if (btif_media_cb.TxAaQ.count > btif_media_cb.tx_q_depth_max)
+        btif_media_cb.tx_q_depth_max = btif_media_cb.TxAaQ.count;
 
     switch (btif_media_cb.TxTranscoding)
     {
         case BTIF_MEDIA_TRSCD_PCM_2_SBC:
+#if (BTIF_MEDIA_CLOCK_TIMERFD == TRUE)
+            if (btif_media_cb.tx_clock_fd >= 0)
+            {
+                result = btif_media_clock_num_sbc_frame(elapsed_us);
+                VERBOSE("WRITE %d FRAMES", result);
+                break;
+            }
+#endif
             switch (btif_media_cb.encoder.s16SamplingFreq)
             {
             case SBC_sf16000:
@@ -1920,6 +2376,49 @@ BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
         break;
     }
 
+    /* pcm already at the sbc rate and in the encoder layout (16 bit stereo)
+       is taken in place from the shm ring, skipping the socket read and
+       the resampler */
+    if ((btif_media_cb.media_feeding.cfg.pcm.sampling_freq == sbc_sampling) &&
+        (btif_media_cb.media_feeding.cfg.pcm.num_channel == 2) &&
+        (btif_media_cb.media_feeding.cfg.pcm.bit_per_sample == 16) &&
+        (btif_media_cb.encoder.s16NumOfChannels == 2) &&
+        (btif_media_cb.media_feeding_state.pcm.aa_feed_residue == 0))
+    {
+        UINT8 *p_pcm;
+
+        nb_byte_read = UIPC_ReadPtr(channel_id, &p_pcm, bytes_needed);
+        if (p_pcm != NULL)
+        {
+            if (nb_byte_read < bytes_needed)
+            {
+                APPL_TRACE_WARNING2("### UNDERRUN :: ONLY %d BYTES OUT OF %d IN RING ###",
+                        nb_byte_read, bytes_needed);
+                btif_media_cb.tx_underruns++;
+
+                /* a synchronous feeding keeps what is there for the next tick */
+                if ((nb_byte_read == 0) || (btif_media_cb.feeding_mode != BTIF_AV_FEEDING_ASYNCHRONOUS))
+                    return FALSE;
+
+                /* Fill the unfilled part of the encoder input with silence (0) */
+                memcpy((UINT8 *)BTIF_MEDIA_PCM_BUF, p_pcm, nb_byte_read);
+                memset((UINT8 *)BTIF_MEDIA_PCM_BUF + nb_byte_read, 0, bytes_needed - nb_byte_read);
+                UIPC_ReadRelease(channel_id, nb_byte_read);
+                return TRUE;
+            }
+
+#if (SBC_NO_PCM_CPY_OPTION == TRUE)
+            /* released by btif_media_aa_prep_sbc_2_send once encoded */
+            btif_media_cb.encoder.ps16PcmBuffer = (SINT16 *)p_pcm;
+            btif_media_cb.tx_pcm_in_place = bytes_needed;
+#else
+            memcpy((UINT8 *)BTIF_MEDIA_PCM_BUF, p_pcm, bytes_needed);
+            UIPC_ReadRelease(channel_id, bytes_needed);
+#endif
+            return TRUE;
+        }
+    }
+
     /* Some Feeding PCM frequencies require to split the number of sample */
     /* to read. */
     /* E.g 128/6=21.3333 => read 22 and 21 and 21 => max = 2; threshold = 0*/
@@ -1975,6 +2474,8 @@ BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
         APPL_TRACE_WARNING2("### UNDERRUN :: ONLY READ %d BYTES OUT OF %d ###",
                 nb_byte_read, read_size);
 
+        btif_media_cb.tx_underruns++;
+
         if (nb_byte_read == 0)
             return FALSE;
 
@@ -2011,7 +2512,7 @@ BOOLEAN btif_media_aa_read_feeding(tUIPC_CH_ID channel_id)
     if(btif_media_cb.media_feeding_state.pcm.aa_feed_residue >= bytes_needed)
     {
         /* Copy the output pcm samples in SBC encoding buffer */
-        memcpy((UINT8 *)btif_media_cb.encoder.as16PcmBuffer,
+        memcpy((UINT8 *)BTIF_MEDIA_PCM_BUF,
                 (UINT8 *)up_sampled_buffer,
                 bytes_needed);
         /* update the residue */
@@ -2070,14 +2571,22 @@ static void btif_media_aa_prep_sbc_2_send(UINT8 nb_frame)
             btif_media_cb.encoder.pu8Packet = (UINT8 *) (p_buf + 1) + p_buf->offset + p_buf->len;
             /* Fill allocated buffer with 0 */
             /* coverity[SIGN_EXTENSION] False-positive: Parameter are always in range avoiding sign extension*/
-            memset(btif_media_cb.encoder.as16PcmBuffer, 0, blocm_x_subband
+            memset(BTIF_MEDIA_PCM_BUF, 0, blocm_x_subband
                     * btif_media_cb.encoder.s16NumOfChannels);
+#if (SBC_NO_PCM_CPY_OPTION == TRUE)
+            btif_media_cb.encoder.ps16PcmBuffer = BTIF_MEDIA_PCM_BUF;
+#endif
 
             /* Read PCM data and upsample them if needed */
             if (btif_media_aa_read_feeding(UIPC_CH_ID_AV_AUDIO))
             {
                 /* SBC encode and descramble frame */
                 SBC_Encoder(&(btif_media_cb.encoder));
+                if (btif_media_cb.tx_pcm_in_place)
+                {
+                    UIPC_ReadRelease(UIPC_CH_ID_AV_AUDIO, btif_media_cb.tx_pcm_in_place);
+                    btif_media_cb.tx_pcm_in_place = 0;
+                }
                 A2D_SbcChkFrInit(btif_media_cb.encoder.pu8Packet);
                 A2D_SbcDescramble(btif_media_cb.encoder.pu8Packet, btif_media_cb.encoder.u16PacketLength);
                 /* Update SBC frame length */
@@ -2209,6 +2718,335 @@ void btif_media_check_iop_exceptions(UINT8 *peer_bda)
 }
 
 
+/*****************************************************************************
+ **  A2DP SINK PATH
+ *****************************************************************************/
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_sbc_frame_info
+ **
+ ** Description      Reads the sampling rate and the number of samples per
+ **                  channel from the header of the sbc frame at p_frame
+ **
+ ** Returns          samples per channel, 0 if p_frame is not an sbc frame
+ **
+ *******************************************************************************/
+static UINT16 btif_media_sbc_frame_info(UINT8 *p_frame, UINT16 len, UINT32 *p_rate)
+{
+    static const UINT32 sbc_rates[4] = {16000, 32000, 44100, 48000};
+
+    if ((len < SBC_DEC_HEADER_SIZE) || (p_frame[0] != SBC_DEC_SYNCWORD))
+        return 0;
+
+    *p_rate = sbc_rates[p_frame[1] >> 6];
+
+    /* blocks x subbands */
+    return (UINT16)((((p_frame[1] >> 4) & 0x03) + 1) * 4 * ((p_frame[1] & 0x01) ? 8 : 4));
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_a2dp_sink_data_cb
+ **
+ ** Description      Sink pcm channel events. The reader is not expected to
+ **                  send anything; reading only detects its departure.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_a2dp_sink_data_cb(tUIPC_CH_ID ch_id, tUIPC_EVENT event)
+{
+    UINT8 discard[64];
+
+    APPL_TRACE_DEBUG1("BTIF MEDIA (A2DP-SINK-DATA) EVENT %s", dump_uipc_event(event));
+
+    switch(event)
+    {
+        case UIPC_OPEN_EVT:
+            btif_media_cb.rx_pcm_open = TRUE;
+            break;
+
+        case UIPC_CLOSE_EVT:
+            btif_media_cb.rx_pcm_open = FALSE;
+
+            /* keep listening for the next reader while the sink is active */
+            if ((media_task_running == MEDIA_TASK_STATE_ON) && btif_media_cb.is_rx_timer)
+                UIPC_Open(UIPC_CH_ID_AV_AUDIO_SINK, btif_a2dp_sink_data_cb);
+            break;
+
+        case UIPC_RX_DATA_READY_EVT:
+            UIPC_Read(UIPC_CH_ID_AV_AUDIO_SINK, NULL, discard, sizeof(discard));
+            break;
+
+        default :
+            APPL_TRACE_ERROR1("### A2DP-SINK-DATA EVENT %d NOT HANDLED ###", event);
+            break;
+    }
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_aa_writebuf
+ **
+ ** Description      Enqueue a Advance Audio media GKI buffer to be processed by btif media task.
+ **                  p_buf holds the sbc media payload (media header byte then
+ **                  the frames) and is freed by the media task.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+void btif_media_aa_writebuf(BT_HDR *p_buf, UINT32 timestamp, UINT16 seq_num)
+{
+    /* playout is paced by the media task tick, only the sequence number is kept */
+    p_buf->event = BTIF_MEDIA_AA_RX_RDY;
+    p_buf->layer_specific = seq_num;
+
+    GKI_send_msg(BT_MEDIA_TASK, BTIF_MEDIA_TASK_DATA_MBOX, p_buf);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_start_rx
+ **
+ ** Description      Start the sink path : decoder reset, pcm channel server
+ **                  and decoding tick
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_task_aa_start_rx(void)
+{
+    APPL_TRACE_DEBUG1("btif_media_task_aa_start_rx is timer %d", btif_media_cb.is_rx_timer);
+
+    if (btif_media_cb.is_rx_timer)
+        return;
+
+    SBC_Decoder_Init(&btif_media_cb.decoder);
+    btif_media_task_aa_rx_flush();
+
+    btif_media_cb.rx_seq_valid = FALSE;
+    btif_media_cb.rx_lost_pkts = 0;
+    btif_media_cb.rx_overruns = 0;
+    btif_media_cb.rx_underruns = 0;
+    btif_media_cb.rx_bad_frames = 0;
+    btif_media_cb.is_rx_timer = TRUE;
+
+    UIPC_Open(UIPC_CH_ID_AV_AUDIO_SINK, btif_a2dp_sink_data_cb);
+
+    GKI_start_timer(BTIF_MEDIA_AV_TASK_TIMER_ID, GKI_MS_TO_TICKS(BTIF_MEDIA_TIME_TICK), TRUE);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_stop_rx
+ **
+ ** Description      Stop the sink path
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_task_aa_stop_rx(void)
+{
+    APPL_TRACE_DEBUG1("btif_media_task_aa_stop_rx is timer %d", btif_media_cb.is_rx_timer);
+
+    GKI_stop_timer(BTIF_MEDIA_AV_TASK_TIMER_ID);
+    btif_media_cb.is_rx_timer = FALSE;
+
+    UIPC_Close(UIPC_CH_ID_AV_AUDIO_SINK);
+
+    btif_media_task_aa_rx_flush();
+
+    APPL_TRACE_EVENT4("sink stats : lost pkts %d, overruns %d, underruns %d, bad frames %d",
+            btif_media_cb.rx_lost_pkts, btif_media_cb.rx_overruns,
+            btif_media_cb.rx_underruns, btif_media_cb.rx_bad_frames);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_rx_flush
+ **
+ ** Description      Drop the jitter buffer and go back to prefilling
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_task_aa_rx_flush(void)
+{
+    APPL_TRACE_DEBUG0("btif_media_task_aa_rx_flush");
+
+    btif_media_flush_q(&(btif_media_cb.RxSbcQ));
+    btif_media_cb.rx_queued_samples = 0;
+    btif_media_cb.rx_tick_budget = 0;
+    btif_media_cb.rx_prefill = TRUE;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_rx_enqueue
+ **
+ ** Description      Queue a received media packet in the jitter buffer
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_task_aa_rx_enqueue(BT_HDR *p_msg)
+{
+    UINT8 *p_data = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT8 num_frames;
+    UINT16 frame_samples;
+    UINT32 rate = 0;
+    BT_HDR *p_old;
+
+    if ((btif_media_cb.is_rx_timer == FALSE) || (p_msg->len < 1 + SBC_DEC_HEADER_SIZE))
+    {
+        GKI_freebuf(p_msg);
+        return;
+    }
+
+    if (btif_media_cb.rx_seq_valid && (p_msg->layer_specific != (UINT16)(btif_media_cb.rx_last_seq + 1)))
+        btif_media_cb.rx_lost_pkts += (UINT16)(p_msg->layer_specific - btif_media_cb.rx_last_seq - 1);
+    btif_media_cb.rx_last_seq = p_msg->layer_specific;
+    btif_media_cb.rx_seq_valid = TRUE;
+
+    /* fragmented frames are not reassembled */
+    num_frames = p_data[0] & BTIF_MEDIA_SBC_HDR_NUM_MASK;
+    frame_samples = btif_media_sbc_frame_info(p_data + 1, p_msg->len - 1, &rate);
+    if ((p_data[0] & BTIF_MEDIA_SBC_HDR_FRAG_MASK) || (num_frames == 0) || (frame_samples == 0))
+    {
+        btif_media_cb.rx_bad_frames++;
+        GKI_freebuf(p_msg);
+        return;
+    }
+
+    /* frames start after the media header, layer_specific now holds the
+       samples per channel left in the packet */
+    p_msg->offset++;
+    p_msg->len--;
+    p_msg->layer_specific = num_frames * frame_samples;
+
+    btif_media_cb.rx_sample_rate = rate;
+    btif_media_cb.rx_queued_samples += p_msg->layer_specific;
+    GKI_enqueue(&(btif_media_cb.RxSbcQ), p_msg);
+
+    /* drop the oldest audio above the jitter buffer capacity */
+    while (btif_media_cb.rx_queued_samples > rate * BTIF_MEDIA_SINK_MAX_MS / 1000)
+    {
+        p_old = GKI_dequeue(&(btif_media_cb.RxSbcQ));
+        btif_media_cb.rx_queued_samples -= p_old->layer_specific;
+        btif_media_cb.rx_overruns++;
+        GKI_freebuf(p_old);
+    }
+}
+
+/*******************************************************************************
+ **
+ ** Function         btif_media_task_aa_handle_rx_timer
+ **
+ ** Description      Decode the frames due in this tick and write the pcm to
+ **                  the sink channel. The tick budget is kept in 1/1000
+ **                  sample so 44.1 khz and tick multiples stay exact.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+static void btif_media_task_aa_handle_rx_timer(void)
+{
+    static INT16 pcm[BTIF_MEDIA_SINK_PCM_MAX];
+    UINT16 pcm_len = 0;
+    UINT16 frame_samples;
+    UINT32 rate = 0;
+    INT16 status;
+    BT_HDR *p_buf;
+    UINT8 *p_data;
+
+    log_tstamps_us("media task rx timer");
+
+    if (btif_media_cb.rx_prefill)
+    {
+        if ((btif_media_cb.rx_queued_samples == 0) ||
+            (btif_media_cb.rx_queued_samples <
+             btif_media_cb.rx_sample_rate * BTIF_MEDIA_SINK_PREFILL_MS / 1000))
+            return;
+
+        APPL_TRACE_DEBUG1("sink prefill done, %d samples queued", btif_media_cb.rx_queued_samples);
+        btif_media_cb.rx_prefill = FALSE;
+        btif_media_cb.rx_tick_budget = 0;
+    }
+
+    btif_media_cb.rx_tick_budget += btif_media_cb.rx_sample_rate * BTIF_MEDIA_TIME_TICK;
+
+    while (pcm_len + SBC_DEC_MAX_PCM_SAMPLES <= BTIF_MEDIA_SINK_PCM_MAX)
+    {
+        if ((p_buf = (BT_HDR *)GKI_getfirst(&(btif_media_cb.RxSbcQ))) == NULL)
+        {
+            /* starved, rebuild the jitter buffer before playing again */
+            btif_media_cb.rx_underruns++;
+            btif_media_cb.rx_prefill = TRUE;
+            break;
+        }
+
+        p_data = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        frame_samples = btif_media_sbc_frame_info(p_data, p_buf->len, &rate);
+        if (frame_samples == 0)
+        {
+            /* lost sync, drop what is left of the packet */
+            btif_media_cb.rx_bad_frames++;
+            btif_media_cb.rx_queued_samples -= p_buf->layer_specific;
+            GKI_freebuf(GKI_dequeue(&(btif_media_cb.RxSbcQ)));
+            continue;
+        }
+
+        if (btif_media_cb.rx_tick_budget < (UINT32)frame_samples * 1000)
+            break;
+
+        status = SBC_Decoder(&btif_media_cb.decoder, p_data, p_buf->len, &pcm[pcm_len]);
+        if ((status != SBC_DEC_OK) && (status != SBC_DEC_ERR_CRC))
+        {
+            btif_media_cb.rx_bad_frames++;
+            btif_media_cb.rx_queued_samples -= p_buf->layer_specific;
+            GKI_freebuf(GKI_dequeue(&(btif_media_cb.RxSbcQ)));
+            continue;
+        }
+
+        if (status == SBC_DEC_ERR_CRC)
+        {
+            /* conceal with silence, the frame still takes its time slot */
+            btif_media_cb.rx_bad_frames++;
+            memset(&pcm[pcm_len], 0, btif_media_cb.decoder.u16PcmLength * sizeof(INT16));
+        }
+        pcm_len += btif_media_cb.decoder.u16PcmLength;
+        btif_media_cb.rx_tick_budget -= (UINT32)frame_samples * 1000;
+
+        p_buf->offset += btif_media_cb.decoder.u16FrameLength;
+        p_buf->len = (p_buf->len > btif_media_cb.decoder.u16FrameLength) ?
+                     (p_buf->len - btif_media_cb.decoder.u16FrameLength) : 0;
+        p_buf->layer_specific = (p_buf->layer_specific > frame_samples) ?
+                                (p_buf->layer_specific - frame_samples) : 0;
+        btif_media_cb.rx_queued_samples = (btif_media_cb.rx_queued_samples > frame_samples) ?
+                                          (btif_media_cb.rx_queued_samples - frame_samples) : 0;
+
+        if ((p_buf->len == 0) || (p_buf->layer_specific == 0))
+        {
+            btif_media_cb.rx_queued_samples -= p_buf->layer_specific;
+            GKI_freebuf(GKI_dequeue(&(btif_media_cb.RxSbcQ)));
+        }
+    }
+
+    if (btif_media_cb.rx_prefill)
+        btif_media_cb.rx_tick_budget = 0;
+
+    /* decoding keeps pace without a reader so the stream stays in sync */
+    if ((pcm_len > 0) && btif_media_cb.rx_pcm_open)
+    {
+        if (!UIPC_Send(UIPC_CH_ID_AV_AUDIO_SINK, 0, (UINT8 *)pcm, pcm_len * sizeof(INT16)))
+            VERBOSE("sink pcm reader late, %d bytes dropped", (int)(pcm_len * sizeof(INT16)));
+    }
+
+    tput_mon(TRUE, pcm_len * sizeof(INT16), FALSE);
+}
+
+
 #endif /* BTA_AV_INCLUDED == TRUE */
 
 /*******************************************************************************
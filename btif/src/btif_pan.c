@@ -38,6 +38,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <net/if.h>
 #include <linux/sockios.h>
@@ -58,6 +59,9 @@
 
 #include "bta_api.h"
 #include "bta_pan_api.h"
+#include "gki.h"
+#include "bta_pan_ci.h"
+#include "pan_api.h"
 #include "btif_sock_thread.h"
 #include "btif_sock_util.h"
 #include "btif_pan_internal.h"
@@ -387,6 +391,8 @@ int btpan_tap_open()
         close(fd);
         return err;
     }
+    /* frames are read until the device queue is empty */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
     BTM_GetLocalDeviceAddr (local_addr);
     if(tap_if_up(TAP_IF_NAME, local_addr) == 0)
     {
@@ -402,25 +408,26 @@ int btpan_tap_send(int tap_fd, const BD_ADDR src, const BD_ADDR dst, UINT16 prot
     if(tap_fd != -1)
     {
         tETH_HDR eth_hdr;
+        struct iovec iov[2];
         //if(is_empty_eth_addr(dst))
         //    memcpy(&eth_hdr.h_dest, local_addr, ETH_ADDR_LEN);
         //else
         memcpy(&eth_hdr.h_dest, dst, ETH_ADDR_LEN);
         memcpy(&eth_hdr.h_src, src, ETH_ADDR_LEN);
         eth_hdr.h_proto = htons(proto);
-        char packet[2000];
-        memcpy(packet, &eth_hdr, sizeof(tETH_HDR));
         if(len > 2000)
         {
             ALOGE("btpan_tap_send eth packet size:%d is exceeded limit!", len);
             return -1;
         }
-        memcpy(packet + sizeof(tETH_HDR), buf, len);
 
-        /* Send data to network interface */
+        /* Send data to network interface, the kernel gathers the header and the payload */
         //btnet_send(btpan_cb.conn[i].sock.sock, &buffer, (len + sizeof(tETH_HDR)));
-        //dump_bin("packet to network", packet, len + sizeof(tETH_HDR));
-        int ret = write(tap_fd, packet, len + sizeof(tETH_HDR));
+        iov[0].iov_base = &eth_hdr;
+        iov[0].iov_len = sizeof(tETH_HDR);
+        iov[1].iov_base = (void*)buf;
+        iov[1].iov_len = len;
+        int ret = writev(tap_fd, iov, 2);
         BTIF_TRACE_DEBUG1("ret:%d", ret);
         return ret;
     }
@@ -496,9 +503,7 @@ static inline int should_forward(tETH_HDR* hdr)
     BTIF_TRACE_DEBUG1("unknown proto:%x", ntohs(hdr->h_proto));
     return FALSE;
 }
-extern void bta_pan_ci_rx_write(UINT16 handle, BD_ADDR dst, BD_ADDR src, UINT16 protocol,
-        UINT8 *p_data, UINT16 len, BOOLEAN ext);
-static void forward_bnep(tETH_HDR* eth_hdr, char * packet, int size)
+static int find_bnep_handle(const tETH_HDR* eth_hdr)
 {
     int broadcast = eth_hdr->h_dest[0] & 1;
     int i;
@@ -508,13 +513,21 @@ static void forward_bnep(tETH_HDR* eth_hdr, char * packet, int size)
         if(handle != (UINT16)-1 &&
                 (broadcast || memcmp(btpan_cb.conns[i].eth_addr, eth_hdr->h_dest, sizeof(BD_ADDR)) == 0
                  || memcmp(btpan_cb.conns[i].peer, eth_hdr->h_dest, sizeof(BD_ADDR)) == 0))
-        {
-            BTIF_TRACE_DEBUG1("calling bta_pan_ci_rx_write, handle:%d", handle);
-            bta_pan_ci_rx_write(handle, eth_hdr->h_dest, eth_hdr->h_src,
-                    ntohs(eth_hdr->h_proto), (UINT8*)packet, size, 0);
-            break;
-        }
+            return handle;
+    }
+    return -1;
+}
+static void forward_bnep(tETH_HDR* eth_hdr, BT_HDR* p_buf)
+{
+    int handle = find_bnep_handle(eth_hdr);
+    if(handle != -1)
+    {
+        BTIF_TRACE_DEBUG1("calling bta_pan_ci_rx_writebuf, handle:%d", handle);
+        //the buffer goes to pan as it is, pan frees it
+        bta_pan_ci_rx_writebuf((UINT16)handle, eth_hdr->h_dest, eth_hdr->h_src,
+                ntohs(eth_hdr->h_proto), p_buf, 0);
     }
+    else GKI_freebuf(p_buf);
 }
 
 static void bta_pan_callback_transfer(UINT16 event, char *p_param)
@@ -612,33 +625,61 @@ static void bta_pan_callback(tBTA_PAN_EVT event, tBTA_PAN *p_data)
     btif_transfer_context(bta_pan_callback_transfer, event, (char*)p_data, sizeof(tBTA_PAN), NULL);
 }
 #define MAX_PACKET_SIZE 2000
+#ifndef MAX_TAP_READ_PACKETS
+#define MAX_TAP_READ_PACKETS 32 /* frames read per tap fd wakeup */
+#endif
+/*******************************************************************************
+ **
+ ** Function         btpan_tap_fd_signaled
+ **
+ ** Description      Reads the frames queued on the tap device, up to
+ **                  MAX_TAP_READ_PACKETS of them. The ethernet header is read
+ **                  apart and the payload straight into a pan pool buffer,
+ **                  behind the headroom bnep and l2cap need, so the buffer is
+ **                  handed to pan without a copy.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
 static void btpan_tap_fd_signaled(int fd, int type, int flags, uint32_t user_id)
 {
-    char packet[MAX_PACKET_SIZE];
     tETH_HDR eth_hdr;
+    struct iovec iov[2];
+    BT_HDR* p_buf;
+    int i, size;
     if(flags & SOCK_THREAD_FD_EXCEPTION)
     {
         BTIF_TRACE_ERROR1("pan tap fd:%d exception", fd);
     }
     else if(flags & SOCK_THREAD_FD_RD)
     {
-        /* debug("tab fd read trigged,  data"); */
-        int size = read(fd, packet, MAX_PACKET_SIZE);
-        /* debug("tap fd read trigged, read size:%d", size); */
-        memcpy(&eth_hdr, &packet, sizeof(tETH_HDR));
-        /* debug("eth src = %02x:%02x:%02x:%02x:%02x:%02x", */
-        /*         eth_hdr.h_src[0],  eth_hdr.h_src[1], eth_hdr.h_src[2], eth_hdr.h_src[3], */
-        /*         eth_hdr.h_src[4], eth_hdr.h_src[5]); */
-        /* debug("eth dest = %02x:%02x:%02x:%02x:%02x:%02x", */
-        /*         eth_hdr.h_dest[0], eth_hdr.h_dest[1], eth_hdr.h_dest[2], eth_hdr.h_dest[3], */
-        /*         eth_hdr.h_dest[4], eth_hdr.h_dest[5]); */
-        //dump_bin("eth packet received", packet, size);
-        if(should_forward(&eth_hdr))
+        for(i = 0; i < MAX_TAP_READ_PACKETS; i++)
         {
-            forward_bnep(&eth_hdr, packet + sizeof(tETH_HDR),  size - sizeof(tETH_HDR));
+            if((p_buf = (BT_HDR*)GKI_getpoolbuf(PAN_POOL_ID)) == NULL)
+            {
+                BTIF_TRACE_ERROR0("pan tap read, no buffer");
+                break;
+            }
+            p_buf->offset = PAN_MINIMUM_OFFSET;
+            iov[0].iov_base = &eth_hdr;
+            iov[0].iov_len = sizeof(tETH_HDR);
+            iov[1].iov_base = (UINT8*)(p_buf + 1) + p_buf->offset;
+            iov[1].iov_len = GKI_get_buf_size(p_buf) - sizeof(BT_HDR) - p_buf->offset;
+            if(iov[1].iov_len > MAX_PACKET_SIZE - sizeof(tETH_HDR))
+                iov[1].iov_len = MAX_PACKET_SIZE - sizeof(tETH_HDR);
+            size = readv(fd, iov, 2);
+            if(size < (int)sizeof(tETH_HDR))
+            {
+                if(size < 0 && errno != EAGAIN && errno != EINTR)
+                    BTIF_TRACE_ERROR2("pan tap fd:%d read error:%d", fd, errno);
+                GKI_freebuf(p_buf);
+                break;
+            }
+            p_buf->len = (UINT16)(size - sizeof(tETH_HDR));
+            if(should_forward(&eth_hdr))
+                forward_bnep(&eth_hdr, p_buf);
+            else GKI_freebuf(p_buf);
         }
         btsock_thread_add_fd(pth, fd, 0, SOCK_THREAD_FD_RD | SOCK_THREAD_ADD_FD_SYNC, 0);
     }
 }
-
-
@@ -30,6 +30,7 @@
 #include <sys/socket.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 
 #define LOG_TAG "BTIF_SOCK"
 #include "btif_common.h"
@@ -72,6 +73,7 @@ static inline void logu(const char* title, const uint8_t * p_uuid)
 
 
 #define MAX_RFC_CHANNEL 30
+#define RFC_SEND_MAX_BUFS 16 //incoming buffers sent to the app with one sendmsg()
 #define MAX_RFC_SESSION BTA_JV_MAX_RFC_SR_SESSION //3 by default
 typedef struct {
     int outgoing_congest : 1;
@@ -817,54 +819,84 @@ static void jv_dm_cback(tBTA_JV_EVT event, tBTA_JV *p_data, void *user_data)
 #define SENT_PARTIAL 1
 #define SENT_NONE 0
 #define SENT_FAILED (-1)
-static int send_data_to_app(int fd, BT_HDR *p_buf)
+/*******************************************************************************
+**
+** Function         send_que_to_app
+**
+** Description      Sends the queued incoming buffers to the app, up to
+**                  RFC_SEND_MAX_BUFS of them with each sendmsg(). Buffers
+**                  that went out are freed, a partially sent one is left at
+**                  the head of the queue.
+**
+** Returns          SENT_ALL if the queue is empty, SENT_NONE or SENT_PARTIAL
+**                  if the app socket is full, SENT_FAILED on socket error
+**
+*******************************************************************************/
+static int send_que_to_app(rfc_slot_t* rs)
 {
-    if(p_buf->len == 0)
-        return SENT_ALL;
-    int sent = send(fd, (UINT8 *)(p_buf + 1) + p_buf->offset,  p_buf->len, MSG_DONTWAIT);
-    if(sent == p_buf->len)
-        return SENT_ALL;
-
-    if(sent > 0 && sent < p_buf->len)
-    {
-        //sent partial
-        APPL_TRACE_ERROR2("send partial, sent:%d, p_buf->len:%d", sent, p_buf->len);
-        p_buf->offset += sent;
-        p_buf->len -= sent;
-        return SENT_PARTIAL;
-
-    }
-    if(sent < 0 &&
-        (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    struct iovec iov[RFC_SEND_MAX_BUFS];
+    struct msghdr msg;
+    BT_HDR* p_buf;
+    int count, total, sent, ret = SENT_NONE;
+    while(!GKI_queue_is_empty(&rs->incoming_que))
     {
-        APPL_TRACE_ERROR1("send none, EAGAIN or EWOULDBLOCK, errno:%d", errno);
-        return SENT_NONE;
+        count = total = 0;
+        for(p_buf = GKI_getfirst(&rs->incoming_que); p_buf && count < RFC_SEND_MAX_BUFS;
+            p_buf = GKI_getnext(p_buf))
+        {
+            iov[count].iov_base = (UINT8 *)(p_buf + 1) + p_buf->offset;
+            iov[count].iov_len = p_buf->len;
+            total += p_buf->len;
+            count++;
+        }
+        sent = 0;
+        if(total > 0)
+        {
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = count;
+            sent = sendmsg(rs->fd, &msg, MSG_DONTWAIT);
+            if(sent < 0)
+            {
+                if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                {
+                    APPL_TRACE_ERROR1("send none, EAGAIN or EWOULDBLOCK, errno:%d", errno);
+                    return ret;
+                }
+                APPL_TRACE_ERROR2("unknown sendmsg() error, total:%d, errno:%d", total, errno);
+                return SENT_FAILED;
+            }
+        }
+        //free what went out
+        while((p_buf = GKI_getfirst(&rs->incoming_que)) != NULL && p_buf->len <= sent)
+        {
+            sent -= p_buf->len;
+            total -= p_buf->len;
+            GKI_freebuf(GKI_dequeue(&rs->incoming_que));
+        }
+        if(total > 0)
+        {
+            //sent partial
+            APPL_TRACE_ERROR2("send partial, sent:%d, p_buf->len:%d", sent, p_buf->len);
+            p_buf->offset += sent;
+            p_buf->len -= sent;
+            return SENT_PARTIAL;
+        }
+        ret = SENT_PARTIAL;
     }
-    APPL_TRACE_ERROR3("unknown send() error, sent:%d, p_buf->len:%d,  errno:%d", sent, p_buf->len, errno);
-    return SENT_FAILED;
+    return SENT_ALL;
 }
 static BOOLEAN flush_incoming_que_on_wr_signal(rfc_slot_t* rs)
 {
-    while(!GKI_queue_is_empty(&rs->incoming_que))
+    switch(send_que_to_app(rs))
     {
-        BT_HDR *p_buf = GKI_dequeue(&rs->incoming_que);
-        int sent = send_data_to_app(rs->fd, p_buf);
-        switch(sent)
-        {
-            case SENT_NONE:
-            case SENT_PARTIAL:
-                //add it back to the queue at same position
-                GKI_enqueue_head (&rs->incoming_que, p_buf);
-                //monitor the fd to get callback when app is ready to receive data
-                btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
-                return TRUE;
-            case SENT_ALL:
-                GKI_freebuf(p_buf);
-                break;
-            case SENT_FAILED:
-                GKI_freebuf(p_buf);
-                return FALSE;
-        }
+        case SENT_NONE:
+        case SENT_PARTIAL:
+            //monitor the fd to get callback when app is ready to receive data
+            btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
+            return TRUE;
+        case SENT_FAILED:
+            return FALSE;
     }
 
     //app is ready to receive data, tell stack to start the data flow
@@ -929,22 +961,19 @@ int bta_co_rfc_data_incoming(void *user_data, BT_HDR *p_buf)
     if(rs)
     {
 
-        int sent = send_data_to_app(rs->fd, p_buf);
-        switch(sent)
+        //queue it behind what the app has not taken yet, and send them together
+        GKI_enqueue(&rs->incoming_que, p_buf);
+        switch(send_que_to_app(rs))
         {
             case SENT_NONE:
             case SENT_PARTIAL:
-                //add it to the end of the queue
-                GKI_enqueue(&rs->incoming_que, p_buf);
                 //monitor the fd to get callback when app is ready to receive data
                 btsock_thread_add_fd(pth, rs->fd, BTSOCK_RFCOMM, SOCK_THREAD_FD_WR, rs->id);
                 break;
             case SENT_ALL:
-                GKI_freebuf(p_buf);
                 ret = 1;//enable the data flow
                 break;
             case SENT_FAILED:
-                GKI_freebuf(p_buf);
                 cleanup_rfc_slot(rs);
                 break;
         }
@@ -996,5 +1025,36 @@ int bta_co_rfc_data_outgoing(void *user_data, UINT8* buf, UINT16 size)
     unlock_slot(&slot_lock);
     return ret;
 }
+int bta_co_rfc_data_outgoing_vector(void *user_data, tPORT_CO_SEG *p_seg, int count)
+{
+    uint32_t id = (uint32_t)user_data;
+    struct iovec iov[PORT_CO_MAX_SEGS];
+    int i, size = 0, ret = FALSE;
+    asrt(0 < count && count <= PORT_CO_MAX_SEGS);
+    if(count <= 0 || count > PORT_CO_MAX_SEGS)
+        return FALSE;
+    for(i = 0; i < count; i++)
+    {
+        iov[i].iov_base = p_seg[i].p_data;
+        iov[i].iov_len = p_seg[i].len;
+        size += p_seg[i].len;
+    }
+    lock_slot(&slot_lock);
+    rfc_slot_t* rs = find_rfc_slot_by_id(id);
+    if(rs)
+    {
+        int received = readv(rs->fd, iov, count);
+        if(received == size)
+            ret = TRUE;
+        else
+        {
+            APPL_TRACE_ERROR4("readv error, errno:%d, fd:%d, size:%d, received:%d",
+                             errno, rs->fd, size, received);
+            cleanup_rfc_slot(rs);
+        }
+    }
+    unlock_slot(&slot_lock);
+    return ret;
+}
 //]
 
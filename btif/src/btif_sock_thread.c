@@ -34,7 +34,8 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -45,8 +46,6 @@
 #include <pthread.h>
 #include <ctype.h>
 
-#include <sys/select.h>
-#include <sys/poll.h>
 #ifndef LINUX_NATIVE
 #include <cutils/sockets.h>
 #endif
@@ -66,22 +65,22 @@
 //#include <cutils/log.h>
 #define asrt(s) if(!(s)) APPL_TRACE_ERROR3("## %s assert %s failed at line:%d ##",__FUNCTION__, #s, __LINE__)
 #define print_events(events) do { \
-    APPL_TRACE_DEBUG1("print poll event:%x", events); \
-    if (events & POLLIN) APPL_TRACE_DEBUG0(  "   POLLIN "); \
-    if (events & POLLPRI) APPL_TRACE_DEBUG0( "   POLLPRI "); \
-    if (events & POLLOUT) APPL_TRACE_DEBUG0( "   POLLOUT "); \
-    if (events & POLLERR) APPL_TRACE_DEBUG0( "   POLLERR "); \
-    if (events & POLLHUP) APPL_TRACE_DEBUG0( "   POLLHUP "); \
-    if (events & POLLNVAL) APPL_TRACE_DEBUG0("   POLLNVAL "); \
-    if (events & POLLRDHUP) APPL_TRACE_DEBUG0("   POLLRDHUP"); \
+    APPL_TRACE_DEBUG1("print epoll event:%x", events); \
+    if (events & EPOLLIN) APPL_TRACE_DEBUG0(  "   EPOLLIN "); \
+    if (events & EPOLLPRI) APPL_TRACE_DEBUG0( "   EPOLLPRI "); \
+    if (events & EPOLLOUT) APPL_TRACE_DEBUG0( "   EPOLLOUT "); \
+    if (events & EPOLLERR) APPL_TRACE_DEBUG0( "   EPOLLERR "); \
+    if (events & EPOLLHUP) APPL_TRACE_DEBUG0( "   EPOLLHUP "); \
+    if (events & EPOLLRDHUP) APPL_TRACE_DEBUG0("   EPOLLRDHUP"); \
     } while(0)
 
 #define MAX_THREAD 8
-#define MAX_POLL 64
-#define POLL_EXCEPTION_EVENTS (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL)
+#define MAX_EPOLL_EVENTS 64 /* events taken per epoll_wait, not a limit on the fd count */
+#define POLL_SLOT_GROW 64
+#define POLL_EXCEPTION_EVENTS (EPOLLHUP | EPOLLRDHUP | EPOLLERR)
 #define IS_EXCEPTION(e) ((e) & POLL_EXCEPTION_EVENTS)
-#define IS_READ(e) ((e) & POLLIN)
-#define IS_WRITE(e) ((e) & POLLOUT)
+#define IS_READ(e) ((e) & EPOLLIN)
+#define IS_WRITE(e) ((e) & EPOLLOUT)
 /*cmd executes in socket poll thread */
 #define CMD_WAKEUP       1
 #define CMD_EXIT         2
@@ -92,18 +91,42 @@
 #define ANDROID_SOCKET_NAMESPACE_ABSTRACT 0
 #endif
 
+/*
+ * Each fd is armed with EPOLLONESHOT: once one of the monitored events is
+ * signaled the fd stays quiet until btsock_thread_add_fd() is called again,
+ * which is what the callers of the former poll() loop expect. Re-arming
+ * with EPOLL_CTL_MOD reports events that are already pending, so edge
+ * triggering does not lose data left in the socket.
+ */
 typedef struct {
-    struct pollfd pfd;
     uint32_t user_id;
     int type;
-    int flags;
+    int flags;  //monitored flags, 0 if the fd is not armed
+    int added;  //fd is in the epoll set
 } poll_slot_t;
+typedef struct
+{
+    int id;
+    int fd;
+    int type;
+    int flags;
+    uint32_t user_id;
+} sock_cmd_t;
+typedef struct cmd_node_s {
+    struct cmd_node_s* next;
+    sock_cmd_t cmd;
+    //user cmd data follows
+} cmd_node_t;
 typedef struct {
-    int cmd_fdr, cmd_fdw;
-    int poll_count;
-    poll_slot_t ps[MAX_POLL];
-    int psi[MAX_POLL]; //index of poll slot
-    volatile pid_t thread_id;
+    int epoll_fd;
+    int cmd_evtfd;          //signaled when cmds are queued
+    int cmd_data_fd[2];     //passes the user cmd data to cmd_callback, created on demand
+    pthread_mutex_t cmd_lock;
+    cmd_node_t* cmd_head;
+    cmd_node_t* cmd_tail;
+    poll_slot_t* ps;        //indexed by fd
+    int ps_count;
+    pthread_t thread_id;
     btsock_signaled_cb callback;
     btsock_cmd_cb cmd_callback;
     int used;
@@ -271,6 +294,7 @@ static void free_thread_slot(int h)
     if(0 <= h && h < MAX_THREAD)
     {
         close_cmd_fd(h);
+        ts[h].thread_id = -1;
         ts[h].used = 0;
     }
     else APPL_TRACE_ERROR1("invalid thread handle:%d", h);
@@ -286,10 +310,14 @@ int btsock_thread_init()
         int h;
         for(h = 0; h < MAX_THREAD; h++)
         {
-            ts[h].cmd_fdr = ts[h].cmd_fdw = -1;
+            ts[h].epoll_fd = ts[h].cmd_evtfd = -1;
+            ts[h].cmd_data_fd[0] = ts[h].cmd_data_fd[1] = -1;
+            init_slot_lock(&ts[h].cmd_lock);
+            ts[h].cmd_head = ts[h].cmd_tail = NULL;
+            ts[h].ps = NULL;
+            ts[h].ps_count = 0;
             ts[h].used = 0;
             ts[h].thread_id = -1;
-            ts[h].poll_count = 0;
             ts[h].callback = NULL;
             ts[h].cmd_callback = NULL;
         }
@@ -307,55 +335,108 @@ int btsock_thread_create(btsock_signaled_cb callback, btsock_cmd_cb cmd_callback
     if(h >= 0)
     {
         init_poll(h);
-        if((ts[h].thread_id = create_thread(sock_poll_thread, (void*)h)) != -1)
+        //the thread may get a callback as soon as it runs
+        ts[h].callback = callback;
+        ts[h].cmd_callback = cmd_callback;
+        if(ts[h].cmd_evtfd != -1 &&
+           (ts[h].thread_id = create_thread(sock_poll_thread, (void*)h)) != (pthread_t)-1)
         {
             APPL_TRACE_DEBUG2("h:%d, thread id:%d", h, ts[h].thread_id);
-            ts[h].callback = callback;
-            ts[h].cmd_callback = cmd_callback;
         }
         else
         {
+            lock_slot(&thread_slot_lock);
             free_thread_slot(h);
+            unlock_slot(&thread_slot_lock);
             h = -1;
         }
     }
     return h;
 }
 
-/* create dummy socket pair used to wake up select loop */
+/* create the epoll set and the eventfd used to wake up the poll loop */
 static inline void init_cmd_fd(int h)
 {
-    asrt(ts[h].cmd_fdr == -1 && ts[h].cmd_fdw == -1);
-    if(socketpair(AF_UNIX, SOCK_STREAM, 0, &ts[h].cmd_fdr) < 0)
+    struct epoll_event ev;
+    asrt(ts[h].epoll_fd == -1 && ts[h].cmd_evtfd == -1);
+    if((ts[h].epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        APPL_TRACE_ERROR1("epoll_create1 failed: %s", strerror(errno));
+        return;
+    }
+    if((ts[h].cmd_evtfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
     {
-        APPL_TRACE_ERROR1("socketpair failed: %s", strerror(errno));
+        APPL_TRACE_ERROR1("eventfd failed: %s", strerror(errno));
         return;
     }
-    APPL_TRACE_DEBUG3("h:%d, cmd_fdr:%d, cmd_fdw:%d", h, ts[h].cmd_fdr, ts[h].cmd_fdw);
-    //add the cmd fd for read & write
-    add_poll(h, ts[h].cmd_fdr, 0, SOCK_THREAD_FD_RD, 0);
+    //level triggered, it is read out before the queued cmds are processed
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = (uint32_t)ts[h].cmd_evtfd;
+    if(epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_ADD, ts[h].cmd_evtfd, &ev) < 0)
+    {
+        APPL_TRACE_ERROR1("epoll_ctl add cmd fd failed: %s", strerror(errno));
+        close(ts[h].cmd_evtfd);
+        ts[h].cmd_evtfd = -1;
+        return;
+    }
+    APPL_TRACE_DEBUG3("h:%d, epoll_fd:%d, cmd_evtfd:%d", h, ts[h].epoll_fd, ts[h].cmd_evtfd);
 }
 static inline void close_cmd_fd(int h)
 {
-    if(ts[h].cmd_fdr != -1)
+    cmd_node_t* node;
+    int i;
+    if(ts[h].cmd_evtfd != -1)
+    {
+        close(ts[h].cmd_evtfd);
+        ts[h].cmd_evtfd = -1;
+    }
+    if(ts[h].epoll_fd != -1)
     {
-        close(ts[h].cmd_fdr);
-        ts[h].cmd_fdr = -1;
+        close(ts[h].epoll_fd);
+        ts[h].epoll_fd = -1;
     }
-    if(ts[h].cmd_fdw != -1)
+    for(i = 0; i < 2; i++)
     {
-        close(ts[h].cmd_fdw);
-        ts[h].cmd_fdw = -1;
+        if(ts[h].cmd_data_fd[i] != -1)
+        {
+            close(ts[h].cmd_data_fd[i]);
+            ts[h].cmd_data_fd[i] = -1;
+        }
     }
+    lock_slot(&ts[h].cmd_lock);
+    while((node = ts[h].cmd_head) != NULL)
+    {
+        ts[h].cmd_head = node->next;
+        free(node);
+    }
+    ts[h].cmd_tail = NULL;
+    unlock_slot(&ts[h].cmd_lock);
+    free(ts[h].ps);
+    ts[h].ps = NULL;
+    ts[h].ps_count = 0;
 }
-typedef struct
+static int queue_cmd(int h, const sock_cmd_t* cmd, const unsigned char* data, int size)
 {
-    int id;
-    int fd;
-    int type;
-    int flags;
-    uint32_t user_id;
-} sock_cmd_t;
+    uint64_t n = 1;
+    cmd_node_t* node = (cmd_node_t*)malloc(sizeof(cmd_node_t) + size);
+    if(!node)
+    {
+        APPL_TRACE_ERROR3("no memory for cmd at h:%d, cmd id:%d, size:%d", h, cmd->id, size);
+        return FALSE;
+    }
+    node->next = NULL;
+    node->cmd = *cmd;
+    if(size > 0)
+        memcpy(node + 1, data, size);
+    lock_slot(&ts[h].cmd_lock);
+    if(ts[h].cmd_tail)
+        ts[h].cmd_tail->next = node;
+    else ts[h].cmd_head = node;
+    ts[h].cmd_tail = node;
+    unlock_slot(&ts[h].cmd_lock);
+    return write(ts[h].cmd_evtfd, &n, sizeof(n)) == sizeof(n);
+}
 int btsock_thread_add_fd(int h, int fd, int type, int flags, uint32_t user_id)
 {
     if(h < 0 || h >= MAX_THREAD)
@@ -363,9 +444,9 @@ int btsock_thread_add_fd(int h, int fd, int type, int flags, uint32_t user_id)
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    if(ts[h].cmd_evtfd == -1)
     {
-        APPL_TRACE_ERROR0("cmd socket is not created. socket thread may not initialized");
+        APPL_TRACE_ERROR0("cmd eventfd is not created. socket thread may not initialized");
         return FALSE;
     }
     if(flags & SOCK_THREAD_ADD_FD_SYNC)
@@ -382,7 +463,7 @@ int btsock_thread_add_fd(int h, int fd, int type, int flags, uint32_t user_id)
     }
     sock_cmd_t cmd = {CMD_ADD_FD, fd, type, flags, user_id};
     APPL_TRACE_DEBUG2("adding fd:%d, flags:0x%x", fd, flags);
-    return send(ts[h].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd);
+    return queue_cmd(h, &cmd, NULL, 0);
 }
 int btsock_thread_post_cmd(int h, int type, const unsigned char* data, int size, uint32_t user_id)
 {
@@ -391,46 +472,29 @@ int btsock_thread_post_cmd(int h, int type, const unsigned char* data, int size,
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    if(ts[h].cmd_evtfd == -1)
     {
-        APPL_TRACE_ERROR0("cmd socket is not created. socket thread may not initialized");
+        APPL_TRACE_ERROR0("cmd eventfd is not created. socket thread may not initialized");
         return FALSE;
     }
     sock_cmd_t cmd = {CMD_USER_PRIVATE, 0, type, size, user_id};
     APPL_TRACE_DEBUG3("post cmd type:%d, size:%d, h:%d, ", type, size, h);
-    sock_cmd_t* cmd_send = &cmd;
-    int size_send = sizeof(cmd);
-    if(data && size)
-    {
-        size_send = sizeof(cmd) + size;
-        cmd_send = (sock_cmd_t*)alloca(size_send);
-        if(cmd_send)
-        {
-            *cmd_send = cmd;
-            memcpy(cmd_send + 1, data, size);
-        }
-        else
-        {
-            APPL_TRACE_ERROR3("alloca failed at h:%d, cmd type:%d, size:%d", h, type, size_send);
-            return FALSE;
-        }
-    }
-    return send(ts[h].cmd_fdw, cmd_send, size_send, 0) == size_send;
+    return queue_cmd(h, &cmd, data, data && size > 0 ? size : 0);
 }
 int btsock_thread_wakeup(int h)
 {
+    uint64_t n = 1;
     if(h < 0 || h >= MAX_THREAD)
     {
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    if(ts[h].cmd_evtfd == -1)
     {
-        APPL_TRACE_ERROR1("thread handle:%d, cmd socket is not created", h);
+        APPL_TRACE_ERROR1("thread handle:%d, cmd eventfd is not created", h);
         return FALSE;
     }
-    sock_cmd_t cmd = {CMD_WAKEUP, 0, 0, 0, 0};
-    return send(ts[h].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd);
+    return write(ts[h].cmd_evtfd, &n, sizeof(n)) == sizeof(n);
 }
 int btsock_thread_exit(int h)
 {
@@ -439,13 +503,13 @@ int btsock_thread_exit(int h)
         APPL_TRACE_ERROR1("invalid bt thread handle:%d", h);
         return FALSE;
     }
-    if(ts[h].cmd_fdw == -1)
+    if(ts[h].cmd_evtfd == -1)
     {
-        APPL_TRACE_ERROR0("cmd socket is not created");
+        APPL_TRACE_ERROR0("cmd eventfd is not created");
         return FALSE;
     }
     sock_cmd_t cmd = {CMD_EXIT, 0, 0, 0, 0};
-    if(send(ts[h].cmd_fdw, &cmd, sizeof(cmd), 0) == sizeof(cmd))
+    if(queue_cmd(h, &cmd, NULL, 0))
     {
         pthread_join(ts[h].thread_id, 0);
         lock_slot(&thread_slot_lock);
@@ -457,212 +521,227 @@ int btsock_thread_exit(int h)
 }
 static void init_poll(int h)
 {
-    int i;
-    ts[h].poll_count = 0;
     ts[h].thread_id = -1;
     ts[h].callback = NULL;
     ts[h].cmd_callback = NULL;
-    for(i = 0; i < MAX_POLL; i++)
-    {
-        ts[h].ps[i].pfd.fd = -1;
-        ts[h].psi[i] = -1;
-    }
+    ts[h].ps = NULL;
+    ts[h].ps_count = 0;
     init_cmd_fd(h);
 }
 static inline unsigned int flags2pevents(int flags)
 {
-    unsigned int pevents = 0;
+    unsigned int pevents = EPOLLET | EPOLLONESHOT;
     if(flags & SOCK_THREAD_FD_WR)
-        pevents |= POLLOUT;
+        pevents |= EPOLLOUT;
     if(flags & SOCK_THREAD_FD_RD)
-        pevents |= POLLIN;
-    pevents |= POLL_EXCEPTION_EVENTS;
+        pevents |= EPOLLIN;
+    //EPOLLERR and EPOLLHUP are always reported
+    pevents |= EPOLLRDHUP;
     return pevents;
 }
-
-static inline void set_poll(poll_slot_t* ps, int fd, int type, int flags, uint32_t user_id)
+static poll_slot_t* get_poll_slot(int h, int fd)
 {
-    ps->pfd.fd = fd;
-    ps->user_id = user_id;
-    if(ps->type != 0 && ps->type != type)
-        APPL_TRACE_ERROR2("poll socket type should not changed! type was:%d, type now:%d", ps->type, type);
-    ps->type = type;
-    ps->flags = flags;
-    ps->pfd.events = flags2pevents(flags);
-    ps->pfd.revents = 0;
+    if(fd >= ts[h].ps_count)
+    {
+        int count = ts[h].ps_count ? ts[h].ps_count : POLL_SLOT_GROW;
+        while(count <= fd)
+            count *= 2;
+        poll_slot_t* ps = (poll_slot_t*)realloc(ts[h].ps, count * sizeof(poll_slot_t));
+        if(!ps)
+        {
+            APPL_TRACE_ERROR2("no memory for poll slot of fd:%d, h:%d", fd, h);
+            return NULL;
+        }
+        memset(ps + ts[h].ps_count, 0, (count - ts[h].ps_count) * sizeof(poll_slot_t));
+        ts[h].ps = ps;
+        ts[h].ps_count = count;
+    }
+    return &ts[h].ps[fd];
 }
-static inline void add_poll(int h, int fd, int type, int flags, uint32_t user_id)
+/*******************************************************************************
+**
+** Function         arm_poll
+**
+** Description      Arms the fd in the epoll set for its monitored flags.
+**                  An fd that was closed and reopened since it was added is
+**                  no longer in the set, and is added again.
+**
+** Returns          TRUE if the fd is armed
+**
+*******************************************************************************/
+static int arm_poll(int h, int fd, poll_slot_t* ps)
 {
-    asrt(fd != -1);
-    int i;
-    int empty = -1;
-    poll_slot_t* ps = ts[h].ps;
-
-    for(i = 0; i < MAX_POLL; i++)
+    struct epoll_event ev;
+    int op = ps->added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = flags2pevents(ps->flags);
+    ev.data.u64 = ((uint64_t)ps->user_id << 32) | (uint32_t)fd;
+    if(epoll_ctl(ts[h].epoll_fd, op, fd, &ev) < 0)
     {
-        if(ps[i].pfd.fd == fd)
+        op = errno == ENOENT ? EPOLL_CTL_ADD : errno == EEXIST ? EPOLL_CTL_MOD : -1;
+        if(op < 0 || epoll_ctl(ts[h].epoll_fd, op, fd, &ev) < 0)
         {
-            asrt(ts[h].poll_count < MAX_POLL);
-
-            set_poll(&ps[i], fd, type, flags | ps[i].flags, user_id);
-            return;
+            APPL_TRACE_ERROR3("epoll_ctl fd:%d, h:%d failed, errno:%d", fd, h, errno);
+            ps->added = 0;
+            return FALSE;
         }
-        else if(empty < 0 && ps[i].pfd.fd == -1)
-            empty = i;
     }
-    if(empty >= 0)
-    {
-        asrt(ts[h].poll_count < MAX_POLL);
-        set_poll(&ps[empty], fd, type, flags, user_id);
-        ++ts[h].poll_count;
+    ps->added = 1;
+    return TRUE;
+}
+static inline void add_poll(int h, int fd, int type, int flags, uint32_t user_id)
+{
+    asrt(fd != -1);
+    poll_slot_t* ps;
+    if(fd < 0 || !(ps = get_poll_slot(h, fd)))
         return;
-    }
-    APPL_TRACE_ERROR1("exceeded max poll slot:%d!", MAX_POLL);
+    if(ps->flags && ps->type != type)
+        APPL_TRACE_ERROR2("poll socket type should not changed! type was:%d, type now:%d", ps->type, type);
+    ps->user_id = user_id;
+    ps->type = type;
+    ps->flags |= flags;
+    if(!arm_poll(h, fd, ps))
+        ps->flags = 0;
 }
-static inline void remove_poll(int h, poll_slot_t* ps, int flags)
+static inline void remove_poll(int h, int fd, poll_slot_t* ps, int flags)
 {
-    if(flags == ps->flags)
+    if((flags & ps->flags) == ps->flags)
     {
-        //all monitored events signaled. To remove it, just clear the slot
-        --ts[h].poll_count;
-        memset(ps, 0, sizeof(*ps));
-        ps->pfd.fd = -1;
+        //all monitored events signaled, the one-shot fd is disarmed already
+        ps->flags = 0;
+        if(flags & SOCK_THREAD_FD_EXCEPTION)
+        {
+            //the fd is about to be closed, take it out of the set
+            epoll_ctl(ts[h].epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            ps->added = 0;
+        }
     }
     else
     {
         //one read or one write monitor event signaled, removed the accordding bit
         ps->flags &= ~flags;
-        //update the poll events mask
-        ps->pfd.events = flags2pevents(ps->flags);
+        //and wait for the rest
+        if(!arm_poll(h, fd, ps))
+            ps->flags = 0;
     }
 }
-static int process_cmd_sock(int h)
+static void process_user_cmd(int h, cmd_node_t* node)
 {
-    sock_cmd_t cmd = {-1, 0, 0, 0, 0};
-    int fd = ts[h].cmd_fdr;
-    if(recv(fd, &cmd, sizeof(cmd), MSG_WAITALL) != sizeof(cmd))
+    int size = node->cmd.flags;
+    int fd = ts[h].cmd_data_fd[0];
+    char buf[256];
+    if(size > 0)
     {
-        APPL_TRACE_ERROR1("recv cmd errno:%d", errno);
-        return FALSE;
-    }
-    APPL_TRACE_DEBUG1("cmd.id:%d", cmd.id);
-    switch(cmd.id)
+        //the callback reads the cmd data from the fd it gets, like from the former cmd socket
+        if(fd == -1 && socketpair(AF_UNIX, SOCK_STREAM, 0, ts[h].cmd_data_fd) == 0)
+            fd = ts[h].cmd_data_fd[0];
+        if(fd == -1 || send(ts[h].cmd_data_fd[1], node + 1, size, MSG_DONTWAIT) != size)
+            APPL_TRACE_ERROR3("cannot pass cmd data, h:%d, type:%d, size:%d", h, node->cmd.type, size);
+    }
+    ts[h].cmd_callback(fd, node->cmd.type, size, node->cmd.user_id);
+    //drop the data the callback did not read
+    if(size > 0 && fd != -1)
+        while(recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0);
+}
+static int process_cmd_sock(int h)
+{
+    uint64_t n;
+    cmd_node_t* node;
+    int ret = TRUE;
+    read(ts[h].cmd_evtfd, &n, sizeof(n));
+    while(ret)
     {
-        case CMD_ADD_FD:
-            add_poll(h, cmd.fd, cmd.type, cmd.flags, cmd.user_id);
+        lock_slot(&ts[h].cmd_lock);
+        if((node = ts[h].cmd_head) != NULL && !(ts[h].cmd_head = node->next))
+            ts[h].cmd_tail = NULL;
+        unlock_slot(&ts[h].cmd_lock);
+        if(!node)
             break;
-        case CMD_WAKEUP:
-            break;
-        case CMD_USER_PRIVATE:
-            asrt(ts[h].cmd_callback);
-            if(ts[h].cmd_callback)
-                ts[h].cmd_callback(fd, cmd.type, cmd.flags, cmd.user_id);
-            break;
-        case CMD_EXIT:
-            return FALSE;
-        default:
-            APPL_TRACE_DEBUG1("unknown cmd: %d", cmd.id);
-             break;
+        APPL_TRACE_DEBUG1("cmd.id:%d", node->cmd.id);
+        switch(node->cmd.id)
+        {
+            case CMD_ADD_FD:
+                add_poll(h, node->cmd.fd, node->cmd.type, node->cmd.flags, node->cmd.user_id);
+                break;
+            case CMD_WAKEUP:
+                break;
+            case CMD_USER_PRIVATE:
+                asrt(ts[h].cmd_callback);
+                if(ts[h].cmd_callback)
+                    process_user_cmd(h, node);
+                break;
+            case CMD_EXIT:
+                ret = FALSE;
+                break;
+            default:
+                APPL_TRACE_DEBUG1("unknown cmd: %d", node->cmd.id);
+                 break;
+        }
+        free(node);
     }
-    return TRUE;
+    return ret;
 }
-static void process_data_sock(int h, struct pollfd *pfds, int count)
+static void process_data_sock(int h, struct epoll_event* events, int count)
 {
-    asrt(count <= ts[h].poll_count);
     int i;
-    for( i= 1; i < ts[h].poll_count; i++)
+    for(i = 0; i < count; i++)
     {
-        if(pfds[i].revents)
+        int fd = (int)(uint32_t)events[i].data.u64;
+        uint32_t user_id = (uint32_t)(events[i].data.u64 >> 32);
+        uint32_t revents = events[i].events;
+        poll_slot_t* ps;
+        if(fd == ts[h].cmd_evtfd || fd >= ts[h].ps_count || !(ps = &ts[h].ps[fd])->flags)
+            continue;
+        int type = ps->type;
+        int flags = 0;
+        print_events(revents);
+        if(IS_READ(revents))
         {
-            int ps_i = ts[h].psi[i];
-            asrt(pfds[i].fd == ts[h].ps[ps_i].pfd.fd);
-            uint32_t user_id = ts[h].ps[ps_i].user_id;
-            int type = ts[h].ps[ps_i].type;
-            int flags = 0;
-            print_events(pfds[i].revents);
-            if(IS_READ(pfds[i].revents))
-            {
-                flags |= SOCK_THREAD_FD_RD;
-            }
-            if(IS_WRITE(pfds[i].revents))
-            {
-                flags |= SOCK_THREAD_FD_WR;
-            }
-            if(IS_EXCEPTION(pfds[i].revents))
-            {
-                flags |= SOCK_THREAD_FD_EXCEPTION;
-                //remove the whole slot not flags
-                remove_poll(h, &ts[h].ps[ps_i], ts[h].ps[ps_i].flags);
-            }
-            else if(flags)
-                 remove_poll(h, &ts[h].ps[ps_i], flags); //remove the monitor flags that already processed
-            if(flags)
-                ts[h].callback(pfds[i].fd, type, flags, user_id);
+            flags |= SOCK_THREAD_FD_RD;
         }
-    }
-}
-
-static void prepare_poll_fds(int h, struct pollfd* pfds)
-{
-    int count = 0;
-    int ps_i = 0;
-    int pfd_i = 0;
-    asrt(ts[h].poll_count <= MAX_POLL);
-    memset(pfds, 0, sizeof(pfds[0])*ts[h].poll_count);
-    while(count < ts[h].poll_count)
-    {
-        if(ps_i >= MAX_POLL)
+        if(IS_WRITE(revents))
         {
-            APPL_TRACE_ERROR4("exceed max poll range, ps_i:%d, MAX_POLL:%d, count:%d, ts[h].poll_count:%d",
-                    ps_i, MAX_POLL, count, ts[h].poll_count);
-            return;
+            flags |= SOCK_THREAD_FD_WR;
         }
-        if(ts[h].ps[ps_i].pfd.fd >= 0)
+        if(IS_EXCEPTION(revents))
         {
-            pfds[pfd_i] =  ts[h].ps[ps_i].pfd;
-            ts[h].psi[pfd_i] = ps_i;
-            count++;
-            pfd_i++;
+            flags |= SOCK_THREAD_FD_EXCEPTION;
+            //remove the whole slot not flags, and the fd from the set
+            remove_poll(h, fd, ps, ps->flags | SOCK_THREAD_FD_EXCEPTION);
         }
-        ps_i++;
+        else if(flags)
+             remove_poll(h, fd, ps, flags); //remove the monitor flags that already processed
+        if(flags)
+            ts[h].callback(fd, type, flags, user_id);
     }
 }
 static void *sock_poll_thread(void *arg)
 {
-    struct pollfd pfds[MAX_POLL];
-    memset(pfds, 0, sizeof(pfds));
+    struct epoll_event events[MAX_EPOLL_EVENTS];
     int h = (int)arg;
     for(;;)
     {
-        prepare_poll_fds(h, pfds);
-        int ret = poll(pfds, ts[h].poll_count, -1);
+        int i, ret = epoll_wait(ts[h].epoll_fd, events, MAX_EPOLL_EVENTS, -1);
         if(ret == -1)
         {
-            APPL_TRACE_ERROR2("poll ret -1, exit the thread, errno:%d, err:%s", errno, strerror(errno));
+            if(errno == EINTR)
+                continue;
+            APPL_TRACE_ERROR2("epoll_wait ret -1, exit the thread, errno:%d, err:%s", errno, strerror(errno));
             break;
         }
-        if(ret != 0)
+        //cmds first, as they were with the cmd fd always in the first poll slot
+        for(i = 0; i < ret; i++)
         {
-            int need_process_data_fd = TRUE;
-            if(pfds[0].revents) //cmd fd always is the first one
-            {
-                asrt(pfds[0].fd == ts[h].cmd_fdr);
-                if(!process_cmd_sock(h))
-                {
-                    APPL_TRACE_DEBUG1("h:%d, process_cmd_sock return false, exit...", h);
-                    break;
-                }
-                if(ret == 1)
-                    need_process_data_fd = FALSE;
-                else ret--; //exclude the cmd fd
-            }
-            if(need_process_data_fd)
-                process_data_sock(h, pfds, ret);
+            if((int)(uint32_t)events[i].data.u64 == ts[h].cmd_evtfd)
+                break;
         }
-        else {APPL_TRACE_DEBUG1("no data, select ret: %d", ret)};
+        if(i < ret && !process_cmd_sock(h))
+        {
+            APPL_TRACE_DEBUG1("h:%d, process_cmd_sock return false, exit...", h);
+            break;
+        }
+        process_data_sock(h, events, ret);
     }
-    ts[h].thread_id = -1;
     APPL_TRACE_DEBUG1("socket poll thread exiting, h:%d", h);
     return 0;
 }
-
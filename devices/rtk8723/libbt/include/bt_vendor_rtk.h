@@ -51,6 +51,12 @@
 #define BLUETOOTH_UART_DEVICE_PORT      "/dev/ttyO1"    /* maguro */
 #endif
 
+/* Environment variable that overrides the device port when set, e.g. to
+** run against the controller emulator in tools/btemu */
+#ifndef BLUETOOTH_UART_PORT_ENV
+#define BLUETOOTH_UART_PORT_ENV         "BT_UART_PORT"
+#endif
+
 /* Location of firmware patch files */
 #ifndef FW_PATCHFILE_LOCATION
 #define FW_PATCHFILE_LOCATION "/vendor/firmware/"  /* maguro */
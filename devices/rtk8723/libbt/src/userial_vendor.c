@@ -33,6 +33,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "bt_vendor_rtk.h"
 #include "userial.h"
@@ -175,9 +176,11 @@ void userial_ioctl_init_bt_wake(int fd)
 *******************************************************************************/
 void userial_vendor_init(void)
 {
+    char *p_port = getenv(BLUETOOTH_UART_PORT_ENV);
+
     vnd_userial.fd = -1;
     snprintf(vnd_userial.port_name, VND_PORT_NAME_MAXLEN, "%s", \
-            BLUETOOTH_UART_DEVICE_PORT);
+            (p_port != NULL) ? p_port : BLUETOOTH_UART_DEVICE_PORT);
 }
 
 /*******************************************************************************
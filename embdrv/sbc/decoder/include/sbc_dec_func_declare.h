@@ -0,0 +1,57 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Decoder internal function declarations.
+ *
+ ******************************************************************************/
+
+#ifndef SBC_DEC_FUNCDECLARE_H
+#define SBC_DEC_FUNCDECLARE_H
+
+/* Fraction bits of the coefficient tables */
+#define SBC_DEC_WINDOW_FRAC 14
+#define SBC_DEC_MATRIX_FRAC 14
+#define SBC_DEC_LEVEL_FRAC  29
+
+/* 64 bit accumulator of the fixed point filter bank and dequantizer */
+#if defined(_MSC_VER)
+typedef __int64 SBC_DEC_ACC;
+#else
+typedef long long SBC_DEC_ACC;
+#endif
+
+/* Global data */
+extern const INT16 gas16SbcSynWindow4[];
+extern const INT16 gas16SbcSynWindow8[];
+extern const INT16 gas16SbcSynMatrix4[];
+extern const INT16 gas16SbcSynMatrix8[];
+extern const INT32 gas32SbcDecLevelScale[];
+extern const INT16 gas16SbcDecOffset4[4][4];
+extern const INT16 gas16SbcDecOffset8[4][8];
+
+/* Global functions*/
+extern void sbc_dec_bit_alloc(SBC_DEC_PARAMS *pstrDecParams);
+
+extern BOOLEAN SbcSynthesisSetKernel(UINT8 u8Kernel);
+extern void SbcSynthesisInit(SBC_DEC_PARAMS *pstrDecParams);
+extern void SbcSynthesisFilter4(SBC_DEC_PARAMS *pstrDecParams, INT16 *ps16Pcm);
+extern void SbcSynthesisFilter8(SBC_DEC_PARAMS *pstrDecParams, INT16 *ps16Pcm);
+
+#endif
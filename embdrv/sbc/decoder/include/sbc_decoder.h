@@ -0,0 +1,140 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains constants and structures used by Decoder.
+ *
+ ******************************************************************************/
+
+#ifndef SBC_DECODER_H
+#define SBC_DECODER_H
+
+#define DECODER_VERSION "0001"
+
+#ifdef BUILDCFG
+    #include "bt_target.h"
+#endif
+
+#include "data_types.h"
+
+/*DEFINES*/
+#define SBC_DEC_MAX_NUM_OF_SUBBANDS 8
+#define SBC_DEC_MAX_NUM_OF_CHANNELS 2
+#define SBC_DEC_MAX_NUM_OF_BLOCKS   16
+
+/* PCM samples (all channels) produced by the largest frame */
+#define SBC_DEC_MAX_PCM_SAMPLES (SBC_DEC_MAX_NUM_OF_BLOCKS * SBC_DEC_MAX_NUM_OF_CHANNELS * SBC_DEC_MAX_NUM_OF_SUBBANDS)
+
+/* Synthesis V vector holds 10 blocks of 2*M matrixed samples */
+#define SBC_DEC_V_SIZE  (10 * 2 * SBC_DEC_MAX_NUM_OF_SUBBANDS)
+
+/* The decoder runs in fixed point. Sub band samples (at most 2^18 after   */
+/* joint stereo, whatever the frame holds) carry SBC_DEC_SB_FRAC fraction  */
+/* bits and V entries (at most 2^21) SBC_DEC_V_FRAC, so both stay within   */
+/* 2^27 resp. 2^28 and split exactly into two 16 bit halves for the 16 bit */
+/* multiplies of the SIMD kernels.                                         */
+#define SBC_DEC_SB_FRAC     9
+#define SBC_DEC_V_FRAC      7
+
+#define SBC_DEC_SYNCWORD    0x9C
+#define SBC_DEC_HEADER_SIZE 4
+
+/* header field values, same coding as the encoder */
+#ifndef SBC_sf16000
+#define SBC_sf16000 0
+#define SBC_sf32000 1
+#define SBC_sf44100 2
+#define SBC_sf48000 3
+#endif
+
+#ifndef SBC_MONO
+#define SBC_MONO    0
+#define SBC_DUAL    1
+#define SBC_STEREO  2
+#define SBC_JOINT_STEREO    3
+#endif
+
+#ifndef SBC_LOUDNESS
+#define SBC_LOUDNESS    0
+#define SBC_SNR 1
+#endif
+
+/* Set SBC_DEC_CRC_CHECK to FALSE to decode frames even when the header CRC does not match */
+#ifndef SBC_DEC_CRC_CHECK
+#define SBC_DEC_CRC_CHECK  TRUE
+#endif
+
+/* Set SBC_DEC_SIMD_OPT to FALSE to run the synthesis filter without its SSE2 (selected at run time) or NEON kernel */
+#ifndef SBC_DEC_SIMD_OPT
+#define SBC_DEC_SIMD_OPT  TRUE
+#endif
+
+/* Synthesis kernels, see SbcSynthesisSetKernel(); all give the same PCM, bit for bit */
+#define SBC_DEC_KERNEL_AUTO 0   /* the best one the CPU supports */
+#define SBC_DEC_KERNEL_C    1
+#define SBC_DEC_KERNEL_SSE2 2
+#define SBC_DEC_KERNEL_NEON 3
+
+/* SBC_Decoder return values */
+#define SBC_DEC_OK              0
+#define SBC_DEC_ERR_SHORT       (-1)    /* buffer holds less than one frame */
+#define SBC_DEC_ERR_SYNC        (-2)    /* no sync word */
+#define SBC_DEC_ERR_BITPOOL     (-3)    /* bitpool out of range for the mode */
+#define SBC_DEC_ERR_CRC         (-4)    /* header CRC mismatch, u16FrameLength is valid */
+
+typedef struct SBC_DEC_PARAMS_TAG
+{
+    /* parsed from the last frame header */
+    INT16 s16SamplingFreq;                          /* 16k, 32k, 44.1k or 48k*/
+    INT16 s16ChannelMode;                           /* mono, dual, streo or joint streo*/
+    INT16 s16NumOfSubBands;                         /* 4 or 8 */
+    INT16 s16NumOfChannels;
+    INT16 s16NumOfBlocks;                           /* 4, 8, 12 or 16*/
+    INT16 s16AllocationMethod;                      /* loudness or SNR*/
+    INT16 s16BitPool;
+
+    UINT16 u16FrameLength;                          /* bytes consumed by the last frame */
+    UINT16 u16PcmLength;                            /* samples (all channels) written by the last frame */
+
+    INT16 as16Join[SBC_DEC_MAX_NUM_OF_SUBBANDS];    /*1 if JS, 0 otherwise*/
+    INT16 as16ScaleFactor[SBC_DEC_MAX_NUM_OF_CHANNELS*SBC_DEC_MAX_NUM_OF_SUBBANDS];
+    INT16 as16Bits[SBC_DEC_MAX_NUM_OF_CHANNELS*SBC_DEC_MAX_NUM_OF_SUBBANDS];
+
+    /* dequantized sub-band samples, [block][channel][sub-band], SBC_DEC_SB_FRAC fraction bits */
+    INT32 as32SbSample[SBC_DEC_MAX_NUM_OF_BLOCKS * SBC_DEC_MAX_NUM_OF_CHANNELS * SBC_DEC_MAX_NUM_OF_SUBBANDS];
+
+    /* synthesis history; every entry is written twice, SBC_DEC_V_SIZE apart, */
+    /* so the 10 block window starting at as16VOffset never wraps; SBC_DEC_V_FRAC fraction bits, */
+    /* kept as V = Hi * 2^14 + Lo with Lo in [-2^13, 2^13) */
+    INT16 as16VHi[SBC_DEC_MAX_NUM_OF_CHANNELS][2 * SBC_DEC_V_SIZE];
+    INT16 as16VLo[SBC_DEC_MAX_NUM_OF_CHANNELS][2 * SBC_DEC_V_SIZE];
+    INT16 as16VOffset[SBC_DEC_MAX_NUM_OF_CHANNELS];
+
+}SBC_DEC_PARAMS;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+extern void SBC_Decoder_Init(SBC_DEC_PARAMS *pstrDecParams);
+extern INT16 SBC_Decoder(SBC_DEC_PARAMS *pstrDecParams, const UINT8 *pu8Frame, UINT16 u16Len, INT16 *ps16Pcm);
+#ifdef __cplusplus
+}
+#endif
+#endif
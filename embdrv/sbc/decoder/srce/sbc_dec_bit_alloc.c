@@ -0,0 +1,173 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the code for bit allocation algorithm. It calculates
+ *  the number of bits required for the encoded stream of data, mirroring
+ *  the encoder so both ends derive the same allocation from the header.
+ *
+ ******************************************************************************/
+
+#include "sbc_decoder.h"
+#include "sbc_dec_func_declare.h"
+
+/****************************************************************************
+* SbcDecBitAllocGroup - Allocates the bitpool of one channel (mono, dual) or
+* of both channels together (stereo, joint stereo).
+*
+* ps16Scf and ps16Bits point to s32NumOfCh consecutive rows of
+* s32NumOfSubBands entries.
+*
+* RETURNS : N/A
+*/
+static void SbcDecBitAllocGroup(SBC_DEC_PARAMS *pstrDecParams, const INT16 *ps16Scf,
+                                INT16 *ps16Bits, INT32 s32NumOfCh)
+{
+    INT16  as16BitNeed[SBC_DEC_MAX_NUM_OF_CHANNELS*SBC_DEC_MAX_NUM_OF_SUBBANDS];
+    INT32  s32NumOfSubBands = pstrDecParams->s16NumOfSubBands;
+    INT32  s32BitPool = pstrDecParams->s16BitPool;
+    INT32  s32MaxBitNeed = 0;
+    INT32  s32BitCount;
+    INT32  s32SliceCount;
+    INT32  s32BitSlice;
+    INT32  s32Loudness;
+    INT32  s32Ch, s32Sb, s32Idx;
+    const INT16 *ps16Offset;
+
+    if (s32NumOfSubBands == 4)
+        ps16Offset = gas16SbcDecOffset4[pstrDecParams->s16SamplingFreq];
+    else
+        ps16Offset = gas16SbcDecOffset8[pstrDecParams->s16SamplingFreq];
+
+    /* bitneed values are derived from scale factor */
+    for (s32Ch = 0; s32Ch < s32NumOfCh; s32Ch++)
+    {
+        for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++)
+        {
+            s32Idx = s32Ch * s32NumOfSubBands + s32Sb;
+            if (pstrDecParams->s16AllocationMethod == SBC_SNR)
+                as16BitNeed[s32Idx] = ps16Scf[s32Idx];
+            else if (ps16Scf[s32Idx] == 0)
+                as16BitNeed[s32Idx] = -5;
+            else
+            {
+                s32Loudness = ps16Scf[s32Idx] - ps16Offset[s32Sb];
+                as16BitNeed[s32Idx] = (INT16)((s32Loudness > 0) ? (s32Loudness >> 1) : s32Loudness);
+            }
+
+            if (as16BitNeed[s32Idx] > s32MaxBitNeed)
+                s32MaxBitNeed = as16BitNeed[s32Idx];
+        }
+    }
+
+    /* iterative process to find out how many bitslices fit into the bitpool */
+    s32BitSlice = s32MaxBitNeed + 1;
+    s32BitCount = s32BitPool;
+    s32SliceCount = 0;
+    do
+    {
+        s32BitSlice--;
+        s32BitCount -= s32SliceCount;
+        s32SliceCount = 0;
+        for (s32Idx = 0; s32Idx < s32NumOfCh * s32NumOfSubBands; s32Idx++)
+        {
+            if ((as16BitNeed[s32Idx] >= s32BitSlice + 1) && (as16BitNeed[s32Idx] < s32BitSlice + 16))
+            {
+                if (as16BitNeed[s32Idx] == s32BitSlice + 1)
+                    s32SliceCount += 2;
+                else
+                    s32SliceCount++;
+            }
+        }
+    } while (s32BitCount - s32SliceCount > 0);
+
+    if (s32BitCount - s32SliceCount == 0)
+    {
+        s32BitCount -= s32SliceCount;
+        s32BitSlice--;
+    }
+
+    /* Bits are distributed until the last bitslice is reached */
+    for (s32Idx = 0; s32Idx < s32NumOfCh * s32NumOfSubBands; s32Idx++)
+    {
+        if (as16BitNeed[s32Idx] < s32BitSlice + 2)
+            ps16Bits[s32Idx] = 0;
+        else
+            ps16Bits[s32Idx] = (INT16)(((as16BitNeed[s32Idx] - s32BitSlice) < 16) ?
+                                       (as16BitNeed[s32Idx] - s32BitSlice) : 16);
+    }
+
+    /* the remaining bits are allocated starting at subband 0, */
+    /* alternating between the channels of the group */
+    for (s32Sb = 0; (s32BitCount > 0) && (s32Sb < s32NumOfSubBands); s32Sb++)
+    {
+        for (s32Ch = 0; (s32BitCount > 0) && (s32Ch < s32NumOfCh); s32Ch++)
+        {
+            s32Idx = s32Ch * s32NumOfSubBands + s32Sb;
+            if ((ps16Bits[s32Idx] >= 2) && (ps16Bits[s32Idx] < 16))
+            {
+                ps16Bits[s32Idx]++;
+                s32BitCount--;
+            }
+            else if ((as16BitNeed[s32Idx] == s32BitSlice + 1) && (s32BitCount > 1))
+            {
+                ps16Bits[s32Idx] = 2;
+                s32BitCount -= 2;
+            }
+        }
+    }
+
+    for (s32Sb = 0; (s32BitCount > 0) && (s32Sb < s32NumOfSubBands); s32Sb++)
+    {
+        for (s32Ch = 0; (s32BitCount > 0) && (s32Ch < s32NumOfCh); s32Ch++)
+        {
+            s32Idx = s32Ch * s32NumOfSubBands + s32Sb;
+            if (ps16Bits[s32Idx] < 16)
+            {
+                ps16Bits[s32Idx]++;
+                s32BitCount--;
+            }
+        }
+    }
+}
+
+/****************************************************************************
+* sbc_dec_bit_alloc - Fills as16Bits from the scale factors of the frame.
+*
+* RETURNS : N/A
+*/
+void sbc_dec_bit_alloc(SBC_DEC_PARAMS *pstrDecParams)
+{
+    INT32 s32NumOfSubBands = pstrDecParams->s16NumOfSubBands;
+
+    if ((pstrDecParams->s16ChannelMode == SBC_STEREO) ||
+        (pstrDecParams->s16ChannelMode == SBC_JOINT_STEREO))
+    {
+        SbcDecBitAllocGroup(pstrDecParams, pstrDecParams->as16ScaleFactor,
+                            pstrDecParams->as16Bits, 2);
+    }
+    else
+    {
+        SbcDecBitAllocGroup(pstrDecParams, pstrDecParams->as16ScaleFactor,
+                            pstrDecParams->as16Bits, 1);
+        if (pstrDecParams->s16ChannelMode == SBC_DUAL)
+            SbcDecBitAllocGroup(pstrDecParams, pstrDecParams->as16ScaleFactor + s32NumOfSubBands,
+                                pstrDecParams->as16Bits + s32NumOfSubBands, 1);
+    }
+}
@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the fixed point coefficients of the synthesis filter,
+ *  the bit allocation offsets and the dequantizer scale factors.
+ *
+ ******************************************************************************/
+
+#include "sbc_decoder.h"
+#include "sbc_dec_func_declare.h"
+
+/* Synthesis window D[i] = -M * C[i] for 4 sub bands, C being the prototype */
+/* filter the analysis filter uses; Q14 (SBC_DEC_WINDOW_FRAC). Stored by i  */
+/* then output j as the pairs (D[2Mi+j], D[2Mi+M+j]), the taps of V[4Mi+j]  */
+/* and V[4Mi+3M+j], so that one pmaddwd or vld2 takes both                  */
+const INT16 gas16SbcSynWindow4[40] =
+{
+         0,   -251,    -35,   -255,    -98,   -122,   -179,    201,
+      -715,  -1696,  -1339,   -402,  -1892,   1889,  -2110,   5089,
+     -8886, -19288, -12779, -18470, -16164, -16164, -18470, -12779,
+      8886,  -1696,   5089,  -2110,   1889,  -1892,   -402,  -1339,
+       715,   -251,    201,   -179,   -122,    -98,   -255,    -35
+};
+
+/* Synthesis window D[i] = -M * C[i] for 8 sub bands, Q14, same pairs */
+const INT16 gas16SbcSynWindow8[80] =
+{
+         0,   -264,    -21,   -276,    -45,   -261,    -73,   -212,
+      -108,   -118,   -149,     23,   -194,    216,   -234,    458,
+      -742,  -1696,  -1052,  -1161,  -1371,   -383,  -1671,    644,
+     -1921,   1919,  -2085,   3422,  -2126,   5122,  -2008,   6971,
+     -8913, -19262, -10877, -19057, -12789, -18449, -14575, -17467,
+    -16157, -16157, -17467, -14575, -18449, -12789, -19057, -10877,
+      8913,  -1696,   6971,  -2008,   5122,  -2126,   3422,  -2085,
+      1919,  -1921,    644,  -1671,   -383,  -1371,  -1161,  -1052,
+       742,   -264,    458,   -234,    216,   -194,     23,   -149,
+      -118,   -108,   -212,    -73,   -261,    -45,   -276,    -21
+};
+
+/* Matrixing N[k][i] = cos((i + 0.5) * (k + M/2) * PI / M); Q14            */
+/* (SBC_DEC_MATRIX_FRAC). Stored by sub band pair p then k as the pairs    */
+/* (N[k][2p], N[k][2p+1]), the weights of sub band samples 2p and 2p+1     */
+/* in V[k]                                                                  */
+const INT16 gas16SbcSynMatrix4[4*8] =
+{
+     11585, -11585,   6270, -15137,      0,      0,  -6270,  15137,
+    -11585,  11585, -15137,  -6270, -16384, -16384, -15137,  -6270,
+    -11585,  11585,  15137,  -6270,      0,      0, -15137,   6270,
+     11585, -11585,   6270,  15137, -16384, -16384,   6270,  15137
+};
+
+const INT16 gas16SbcSynMatrix8[8*16] =
+{
+     11585, -11585,   9102, -16069,   6270, -15137,   3196,  -9102,
+         0,      0,  -3196,   9102,  -6270,  15137,  -9102,  16069,
+    -11585,  11585, -13623,   3196, -15137,  -6270, -16069, -13623,
+    -16384, -16384, -16069, -13623, -15137,  -6270, -13623,   3196,
+    -11585,  11585,   3196,  13623,  15137,  -6270,  13623, -16069,
+         0,      0, -13623,  16069, -15137,   6270,  -3196, -13623,
+     11585, -11585,  16069,   9102,   6270,  15137,  -9102,  -3196,
+    -16384, -16384,  -9102,  -3196,   6270,  15137,  16069,   9102,
+     11585, -11585, -13623,  -3196,  -6270,  15137,  16069, -13623,
+         0,      0, -16069,  13623,   6270, -15137,  13623,   3196,
+    -11585,  11585,  -9102, -16069,  15137,   6270,   3196,   9102,
+    -16384, -16384,   3196,   9102,  15137,   6270,  -9102, -16069,
+    -11585,  11585,  16069,  -9102, -15137,   6270,   9102,  -3196,
+         0,      0,  -9102,   3196,  15137,  -6270, -16069,   9102,
+     11585, -11585,  -3196,  13623,  -6270, -15137,  13623,  16069,
+    -16384, -16384,  13623,  16069,  -6270, -15137,  -3196,  13623
+};
+
+/* 2^bits / (2^bits - 1), indexed by the number of allocated bits; Q29 */
+/* (SBC_DEC_LEVEL_FRAC), so that (2q + 1) / (2^bits - 1) only takes a   */
+/* multiply and a shift                                                 */
+const INT32 gas32SbcDecLevelScale[17] =
+{
+              0,  1073741824,   715827883,   613566757,
+      572662306,   554189329,   545392673,   541098242,
+      538976288,   537921540,   537395713,   537133184,
+      537002016,   536936456,   536903682,   536887297,
+      536879104
+};
+
+/* Loudness offsets, indexed by sampling frequency then sub band */
+const INT16 gas16SbcDecOffset4[4][4] = {  {-1, 0, 0, 0}, {-2, 0, 0, 1},
+                                         {-2, 0, 0, 1}, {-2, 0, 0, 1} };
+const INT16 gas16SbcDecOffset8[4][8] = {  {-2, 0, 0, 0, 0, 0, 0, 1},
+                                         {-3, 0, 0, 0, 0, 0, 1, 2},
+                                         {-4, 0, 0, 0, 0, 0, 1, 2},
+                                         {-4, 0, 0, 0, 0, 0, 1, 2} };
@@ -0,0 +1,245 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  contains code for decoder flow: header parsing, CRC check, bit
+ *  allocation, dequantization and the synthesis filter bank
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "sbc_decoder.h"
+#include "sbc_dec_func_declare.h"
+
+/* MSB first bit reader over one frame */
+typedef struct
+{
+    const UINT8 *pu8Cur;
+    const UINT8 *pu8End;
+    UINT32 u32Cache;
+    INT32  s32Count;
+} tSBC_DEC_BITS;
+
+/****************************************************************************
+* SbcDecReadBits - returns the next s32Bits (1 to 16) bits of the frame.
+* Reading past the end returns zeros; the frame length is checked before.
+*
+* RETURNS : the bits, right aligned
+*/
+static UINT32 SbcDecReadBits(tSBC_DEC_BITS *pBits, INT32 s32Bits)
+{
+    while (pBits->s32Count < s32Bits)
+    {
+        pBits->u32Cache <<= 8;
+        if (pBits->pu8Cur < pBits->pu8End)
+            pBits->u32Cache |= *pBits->pu8Cur++;
+        pBits->s32Count += 8;
+    }
+    pBits->s32Count -= s32Bits;
+    return (pBits->u32Cache >> pBits->s32Count) & ((1UL << s32Bits) - 1);
+}
+
+/****************************************************************************
+* SbcDecCrc8 - runs s32Bits bits of pu8Data, MSB first, through the SBC
+* CRC (x^8 + x^4 + x^3 + x^2 + 1).
+*
+* RETURNS : the updated CRC
+*/
+static UINT8 SbcDecCrc8(UINT8 u8Crc, const UINT8 *pu8Data, INT32 s32Bits)
+{
+    INT32 s32Bit;
+    UINT8 u8Byte = 0;
+
+    for (s32Bit = 0; s32Bit < s32Bits; s32Bit++)
+    {
+        if ((s32Bit & 7) == 0)
+            u8Byte = *pu8Data++;
+        if (((u8Crc ^ u8Byte) & 0x80) != 0)
+            u8Crc = (UINT8)((u8Crc << 1) ^ 0x1D);
+        else
+            u8Crc = (UINT8)(u8Crc << 1);
+        u8Byte <<= 1;
+    }
+    return u8Crc;
+}
+
+/****************************************************************************
+* SBC_Decoder_Init - Resets the synthesis history. The stream parameters are
+* taken from each frame header.
+*
+* RETURNS : N/A
+*/
+void SBC_Decoder_Init(SBC_DEC_PARAMS *pstrDecParams)
+{
+    memset(pstrDecParams, 0, sizeof(SBC_DEC_PARAMS));
+    SbcSynthesisInit(pstrDecParams);
+}
+
+/****************************************************************************
+* SBC_Decoder - Decodes the frame at pu8Frame into interleaved 16 bit PCM.
+*
+* ps16Pcm must hold SBC_DEC_MAX_PCM_SAMPLES samples. On SBC_DEC_OK and on
+* SBC_DEC_ERR_CRC u16FrameLength gives the number of bytes to skip, and
+* u16PcmLength the samples the frame stands for (not written on CRC error).
+*
+* RETURNS : SBC_DEC_OK or one of the SBC_DEC_ERR_xxx codes
+*/
+INT16 SBC_Decoder(SBC_DEC_PARAMS *pstrDecParams, const UINT8 *pu8Frame, UINT16 u16Len, INT16 *ps16Pcm)
+{
+    static const INT16 as16Blocks[4] = {4, 8, 12, 16};
+    tSBC_DEC_BITS strBits;
+    INT32 s32NumOfSubBands, s32NumOfChannels, s32NumOfBlocks;
+    INT32 s32ChannelMode, s32BitPool;
+    INT32 s32Blk, s32Ch, s32Sb, s32Bits;
+    INT32 s32DataBits, s32HdrBits;
+    UINT8 u8Crc;
+    UINT32 u32Level;
+    INT32 s32Shift;
+    INT32 *ps32Sb;
+    INT32 s32Sum, s32Diff;
+    SBC_DEC_ACC s64Sb;
+
+    if (u16Len < SBC_DEC_HEADER_SIZE)
+        return SBC_DEC_ERR_SHORT;
+    if (pu8Frame[0] != SBC_DEC_SYNCWORD)
+        return SBC_DEC_ERR_SYNC;
+
+    s32NumOfBlocks   = as16Blocks[(pu8Frame[1] >> 4) & 0x03];
+    s32ChannelMode   = (pu8Frame[1] >> 2) & 0x03;
+    s32NumOfSubBands = (pu8Frame[1] & 0x01) ? 8 : 4;
+    s32NumOfChannels = (s32ChannelMode == SBC_MONO) ? 1 : 2;
+    s32BitPool       = pu8Frame[2];
+
+    if ((s32BitPool < 2) ||
+        (s32BitPool > (((s32ChannelMode == SBC_MONO) || (s32ChannelMode == SBC_DUAL)) ? 16 : 32) * s32NumOfSubBands))
+        return SBC_DEC_ERR_BITPOOL;
+
+    /* frame length as per A2DP spec */
+    if ((s32ChannelMode == SBC_MONO) || (s32ChannelMode == SBC_DUAL))
+        s32DataBits = s32NumOfBlocks * s32NumOfChannels * s32BitPool;
+    else if (s32ChannelMode == SBC_STEREO)
+        s32DataBits = s32NumOfBlocks * s32BitPool;
+    else
+        s32DataBits = s32NumOfSubBands + s32NumOfBlocks * s32BitPool;
+    pstrDecParams->u16FrameLength = (UINT16)(SBC_DEC_HEADER_SIZE +
+                                             ((4 * s32NumOfSubBands * s32NumOfChannels) >> 3) +
+                                             ((s32DataBits + 7) >> 3));
+    pstrDecParams->u16PcmLength = (UINT16)(s32NumOfBlocks * s32NumOfSubBands * s32NumOfChannels);
+    if (u16Len < pstrDecParams->u16FrameLength)
+        return SBC_DEC_ERR_SHORT;
+
+    /* a new sub band count or channel layout restarts the synthesis history */
+    if ((s32NumOfSubBands != pstrDecParams->s16NumOfSubBands) ||
+        (s32NumOfChannels != pstrDecParams->s16NumOfChannels))
+    {
+        pstrDecParams->s16NumOfSubBands = (INT16)s32NumOfSubBands;
+        pstrDecParams->s16NumOfChannels = (INT16)s32NumOfChannels;
+        SbcSynthesisInit(pstrDecParams);
+    }
+    pstrDecParams->s16SamplingFreq     = (pu8Frame[1] >> 6) & 0x03;
+    pstrDecParams->s16NumOfBlocks      = (INT16)s32NumOfBlocks;
+    pstrDecParams->s16ChannelMode      = (INT16)s32ChannelMode;
+    pstrDecParams->s16AllocationMethod = (pu8Frame[1] >> 1) & 0x01;
+    pstrDecParams->s16BitPool          = (INT16)s32BitPool;
+
+    strBits.pu8Cur   = pu8Frame + SBC_DEC_HEADER_SIZE;
+    strBits.pu8End   = pu8Frame + pstrDecParams->u16FrameLength;
+    strBits.u32Cache = 0;
+    strBits.s32Count = 0;
+
+    s32HdrBits = 4 * s32NumOfSubBands * s32NumOfChannels;
+    if (s32ChannelMode == SBC_JOINT_STEREO)
+    {
+        for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++)
+            pstrDecParams->as16Join[s32Sb] = (INT16)SbcDecReadBits(&strBits, 1);
+        s32HdrBits += s32NumOfSubBands;
+    }
+    else
+    {
+        memset(pstrDecParams->as16Join, 0, sizeof(pstrDecParams->as16Join));
+    }
+
+    for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++)
+        for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++)
+            pstrDecParams->as16ScaleFactor[s32Ch * s32NumOfSubBands + s32Sb] = (INT16)SbcDecReadBits(&strBits, 4);
+
+    /* the CRC covers the 2nd and 3rd header bytes, the join bits and the scale factors */
+    u8Crc = SbcDecCrc8(0x0F, pu8Frame + 1, 16);
+    u8Crc = SbcDecCrc8(u8Crc, pu8Frame + SBC_DEC_HEADER_SIZE, s32HdrBits);
+#if (SBC_DEC_CRC_CHECK == TRUE)
+    if (u8Crc != pu8Frame[3])
+        return SBC_DEC_ERR_CRC;
+#endif
+
+    sbc_dec_bit_alloc(pstrDecParams);
+
+    /* read and dequantize: sb = 2^(scf+1) * ((2q + 1) / (2^bits - 1) - 1), */
+    /* (2q + 1) / (2^bits - 1) being (2q + 1) * 2^-bits * LevelScale[bits]   */
+    ps32Sb = pstrDecParams->as32SbSample;
+    for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++)
+    {
+        for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++)
+        {
+            for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++)
+            {
+                s32Bits = pstrDecParams->as16Bits[s32Ch * s32NumOfSubBands + s32Sb];
+                if (s32Bits == 0)
+                {
+                    *ps32Sb++ = 0;
+                    continue;
+                }
+                u32Level = SbcDecReadBits(&strBits, s32Bits);
+                s64Sb = (SBC_DEC_ACC)(2 * u32Level + 1) * gas32SbcDecLevelScale[s32Bits] -
+                        ((SBC_DEC_ACC)1 << (SBC_DEC_LEVEL_FRAC + s32Bits));
+
+                /* from LEVEL_FRAC + bits fraction bits to SB_FRAC, times 2^(scf+1): */
+                /* at least 5 with 1 bit and a scale factor of 15                    */
+                s32Shift = SBC_DEC_LEVEL_FRAC + s32Bits - SBC_DEC_SB_FRAC -
+                           pstrDecParams->as16ScaleFactor[s32Ch * s32NumOfSubBands + s32Sb] - 1;
+                *ps32Sb++ = (INT32)((s64Sb + ((SBC_DEC_ACC)1 << (s32Shift - 1))) >> s32Shift);
+            }
+        }
+    }
+
+    if (s32ChannelMode == SBC_JOINT_STEREO)
+    {
+        ps32Sb = pstrDecParams->as32SbSample;
+        for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++)
+        {
+            for (s32Sb = 0; s32Sb < s32NumOfSubBands; s32Sb++)
+            {
+                if (pstrDecParams->as16Join[s32Sb])
+                {
+                    s32Sum  = ps32Sb[s32Sb] + ps32Sb[s32NumOfSubBands + s32Sb];
+                    s32Diff = ps32Sb[s32Sb] - ps32Sb[s32NumOfSubBands + s32Sb];
+                    ps32Sb[s32Sb] = s32Sum;
+                    ps32Sb[s32NumOfSubBands + s32Sb] = s32Diff;
+                }
+            }
+            ps32Sb += 2 * s32NumOfSubBands;
+        }
+    }
+
+    if (s32NumOfSubBands == 4)
+        SbcSynthesisFilter4(pstrDecParams, ps16Pcm);
+    else
+        SbcSynthesisFilter8(pstrDecParams, ps16Pcm);
+
+    return SBC_DEC_OK;
+}
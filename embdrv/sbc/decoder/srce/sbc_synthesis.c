@@ -0,0 +1,444 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the code that realizes the synthesis filter bank:
+ *  matrixing of each block of sub band samples into the V vector, then
+ *  windowing of 10 blocks of V into M PCM samples.
+ *
+ *  The filter bank runs in fixed point with 16 bit coefficients, so it
+ *  needs no FPU. The C kernel multiplies them with the 32 bit samples and
+ *  sums in 64 bits. The SSE2 (pmaddwd) and NEON (vmlal) kernels split each
+ *  sample into hi * 2^14 + lo, both 16 bit, and sum the hi and lo products
+ *  apart in 32 bits; the sample and table ranges keep both sums below 2^31
+ *  and the shifts are at least 14, so the recombined result is the C one,
+ *  bit for bit.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include <stdint.h>
+#include "sbc_decoder.h"
+#include "sbc_dec_func_declare.h"
+
+#if (SBC_DEC_SIMD_OPT == TRUE)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SBC_DEC_SIMD_X86
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SBC_DEC_SIMD_NEON
+#include <arm_neon.h>
+#else
+#undef SBC_DEC_SIMD_OPT
+#define SBC_DEC_SIMD_OPT FALSE
+#endif
+#endif
+
+/* V = S * N keeps SBC_DEC_V_FRAC fraction bits, X = D * V none */
+#define SBC_SYN_MATRIX_SHIFT    (SBC_DEC_SB_FRAC + SBC_DEC_MATRIX_FRAC - SBC_DEC_V_FRAC)
+#define SBC_SYN_WINDOW_SHIFT    (SBC_DEC_V_FRAC + SBC_DEC_WINDOW_FRAC)
+
+/* samples split into hi * 2^SBC_SYN_SPLIT + lo, lo in [-2^(SPLIT-1), 2^(SPLIT-1)) */
+#define SBC_SYN_SPLIT           14
+#define SBC_SYN_SPLIT_HALF      (1 << (SBC_SYN_SPLIT - 1))
+#define SBC_SYN_SPLIT_MASK      ((1 << SBC_SYN_SPLIT) - 1)
+#define SBC_SYN_SPLIT_LO(x)     ((((x) + SBC_SYN_SPLIT_HALF) & SBC_SYN_SPLIT_MASK) - SBC_SYN_SPLIT_HALF)
+
+/* V entry n of a channel from its two halves */
+#define SBC_SYN_V(ps16Hi, ps16Lo, n)    ((INT32)(ps16Hi)[n] * (1 << SBC_SYN_SPLIT) + (ps16Lo)[n])
+
+/* One block of one channel through the filter bank. ps32S holds the M sub
+** band samples, ps16VHi and ps16VLo the newest 2*M entries of the channel V
+** vector. The M output samples are written s32Stride apart. */
+typedef void (tSBC_SYN_BLOCK_FUNC)(const INT32 *ps32S, INT16 *ps16VHi, INT16 *ps16VLo, INT32 s32M,
+                                   const INT16 *ps16Matrix, const INT16 *ps16Window,
+                                   INT16 *ps16Out, INT32 s32Stride);
+
+/* synthesis kernel asked for with SbcSynthesisSetKernel() */
+static UINT8 u8SbcSynKernel = SBC_DEC_KERNEL_AUTO;
+
+static void SbcSynthesisBlockC(const INT32 *ps32S, INT16 *ps16VHi, INT16 *ps16VLo, INT32 s32M,
+                               const INT16 *ps16Matrix, const INT16 *ps16Window,
+                               INT16 *ps16Out, INT32 s32Stride);
+
+/* block kernel selected in SbcSynthesisInit() */
+static tSBC_SYN_BLOCK_FUNC *pfnSynBlock = SbcSynthesisBlockC;
+
+/****************************************************************************
+* SbcSynthesisPcm - Rounds half up and saturates one output sample.
+*
+* RETURNS : the PCM sample
+*/
+static INT16 SbcSynthesisPcm(SBC_DEC_ACC s64X)
+{
+    s64X = (s64X + ((SBC_DEC_ACC)1 << (SBC_SYN_WINDOW_SHIFT - 1))) >> SBC_SYN_WINDOW_SHIFT;
+    if (s64X > 32767)
+        return 32767;
+    if (s64X < -32768)
+        return -32768;
+    return (INT16)s64X;
+}
+
+/****************************************************************************
+* SbcSynthesisBlockC - The C kernel, and the reference of the others.
+*
+* RETURNS : N/A
+*/
+static void SbcSynthesisBlockC(const INT32 *ps32S, INT16 *ps16VHi, INT16 *ps16VLo, INT32 s32M,
+                               const INT16 *ps16Matrix, const INT16 *ps16Window,
+                               INT16 *ps16Out, INT32 s32Stride)
+{
+    INT32 s32I, s32J, s32K, s32V, s32Lo;
+    const INT16 *ps16N, *ps16D;
+    SBC_DEC_ACC s64Acc;
+
+    /* matrixing, V[k] = sum over i of N[k][i] * S[i] */
+    for (s32K = 0; s32K < 2 * s32M; s32K++)
+    {
+        s64Acc = (SBC_DEC_ACC)1 << (SBC_SYN_MATRIX_SHIFT - 1);
+        ps16N = ps16Matrix + 2 * s32K;
+        for (s32I = 0; s32I < s32M; s32I += 2, ps16N += 4 * s32M)
+            s64Acc += (SBC_DEC_ACC)ps16N[0] * ps32S[s32I] + (SBC_DEC_ACC)ps16N[1] * ps32S[s32I + 1];
+        s32V = (INT32)(s64Acc >> SBC_SYN_MATRIX_SHIFT);
+
+        s32Lo = SBC_SYN_SPLIT_LO(s32V);
+        ps16VHi[s32K] = ps16VHi[s32K + 20 * s32M] = (INT16)((s32V - s32Lo) >> SBC_SYN_SPLIT);
+        ps16VLo[s32K] = ps16VLo[s32K + 20 * s32M] = (INT16)s32Lo;
+    }
+
+    /* windowing, X[j] = sum over i of D[2Mi+j] * V[4Mi+j] + D[2Mi+M+j] * V[4Mi+3M+j] */
+    for (s32J = 0; s32J < s32M; s32J++)
+    {
+        s64Acc = 0;
+        ps16D = ps16Window + 2 * s32J;
+        for (s32I = 0; s32I < 5; s32I++, ps16D += 2 * s32M)
+        {
+            s64Acc += (SBC_DEC_ACC)ps16D[0] * SBC_SYN_V(ps16VHi, ps16VLo, 4 * s32M * s32I + s32J);
+            s64Acc += (SBC_DEC_ACC)ps16D[1] * SBC_SYN_V(ps16VHi, ps16VLo, 4 * s32M * s32I + 3 * s32M + s32J);
+        }
+        ps16Out[s32J * s32Stride] = SbcSynthesisPcm(s64Acc);
+    }
+}
+
+#if defined(SBC_DEC_SIMD_X86)
+/* lo and hi halves of four 32 bit samples, hi packed to 16 bit with the next four */
+__attribute__((target("sse2")))
+static inline __m128i SbcSynthesisLoSse2(__m128i vX)
+{
+    const __m128i vHalf = _mm_set1_epi32(SBC_SYN_SPLIT_HALF);
+
+    return _mm_sub_epi32(_mm_and_si128(_mm_add_epi32(vX, vHalf), _mm_set1_epi32(SBC_SYN_SPLIT_MASK)), vHalf);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i SbcSynthesisHiSse2(__m128i vX0, __m128i vLo0, __m128i vX1, __m128i vLo1)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_sub_epi32(vX0, vLo0), SBC_SYN_SPLIT),
+                           _mm_srai_epi32(_mm_sub_epi32(vX1, vLo1), SBC_SYN_SPLIT));
+}
+
+/* (hi * 2^SPLIT + lo + round) >> shift, in 32 bits: the shift is at least SPLIT */
+#define SBC_SYN_JOIN_SSE2(vHi, vLo, shift) \
+    _mm_srai_epi32(_mm_add_epi32((vHi), _mm_srai_epi32(_mm_add_epi32((vLo), _mm_set1_epi32(1 << ((shift) - 1))), \
+                                                       SBC_SYN_SPLIT)), (shift) - SBC_SYN_SPLIT)
+
+/****************************************************************************
+* SbcSynthesisBlockSse2 - pmaddwd kernel: the matrix is stored in sub band
+* pairs, so each 32 bit lane of a broadcast (S[2p], S[2p+1]) half meets its
+* two weights; the window pairs the two taps of each output, which take V
+* interleaved from its two rows.
+*
+* RETURNS : N/A
+*/
+__attribute__((target("sse2")))
+static void SbcSynthesisBlockSse2(const INT32 *ps32S, INT16 *ps16VHi, INT16 *ps16VLo, INT32 s32M,
+                                  const INT16 *ps16Matrix, const INT16 *ps16Window,
+                                  INT16 *ps16Out, INT32 s32Stride)
+{
+    __m128i aHi[4], aLo[4], vS0, vS1, vLo0, vLo1, vHi, vLo, vC, vA, vB;
+    int32_t as32SHi[4], as32SLo[4];
+    INT16 as16Pcm[8];
+    INT32 s32P, s32K, s32I, s32J;
+
+    /* split S (INT32 may be wider than the lanes), each 32 bit word holding */
+    /* the halves of one sub band pair                                       */
+    vS0 = _mm_set_epi32((int)ps32S[3], (int)ps32S[2], (int)ps32S[1], (int)ps32S[0]);
+    vS1 = (s32M == 8) ? _mm_set_epi32((int)ps32S[7], (int)ps32S[6], (int)ps32S[5], (int)ps32S[4]) :
+                        _mm_setzero_si128();
+    vLo0 = SbcSynthesisLoSse2(vS0);
+    vLo1 = SbcSynthesisLoSse2(vS1);
+    _mm_storeu_si128((__m128i *)as32SHi, SbcSynthesisHiSse2(vS0, vLo0, vS1, vLo1));
+    _mm_storeu_si128((__m128i *)as32SLo, _mm_packs_epi32(vLo0, vLo1));
+
+    /* matrixing, V[4k..4k+3] in aHi[k] and aLo[k] */
+    for (s32K = 0; s32K < s32M >> 1; s32K++)
+        aHi[s32K] = aLo[s32K] = _mm_setzero_si128();
+    for (s32P = 0; s32P < s32M >> 1; s32P++)
+    {
+        vHi = _mm_set1_epi32(as32SHi[s32P]);
+        vLo = _mm_set1_epi32(as32SLo[s32P]);
+        for (s32K = 0; s32K < s32M >> 1; s32K++)
+        {
+            vC = _mm_loadu_si128((const __m128i *)(ps16Matrix + 4 * s32M * s32P + 8 * s32K));
+            aHi[s32K] = _mm_add_epi32(aHi[s32K], _mm_madd_epi16(vC, vHi));
+            aLo[s32K] = _mm_add_epi32(aLo[s32K], _mm_madd_epi16(vC, vLo));
+        }
+    }
+    for (s32K = 0; s32K < s32M >> 1; s32K += 2)
+    {
+        vA = SBC_SYN_JOIN_SSE2(aHi[s32K], aLo[s32K], SBC_SYN_MATRIX_SHIFT);
+        vB = SBC_SYN_JOIN_SSE2(aHi[s32K + 1], aLo[s32K + 1], SBC_SYN_MATRIX_SHIFT);
+        vLo0 = SbcSynthesisLoSse2(vA);
+        vLo1 = SbcSynthesisLoSse2(vB);
+        vHi = SbcSynthesisHiSse2(vA, vLo0, vB, vLo1);
+        vLo = _mm_packs_epi32(vLo0, vLo1);
+        _mm_storeu_si128((__m128i *)(ps16VHi + 4 * s32K), vHi);
+        _mm_storeu_si128((__m128i *)(ps16VHi + 4 * s32K + 20 * s32M), vHi);
+        _mm_storeu_si128((__m128i *)(ps16VLo + 4 * s32K), vLo);
+        _mm_storeu_si128((__m128i *)(ps16VLo + 4 * s32K + 20 * s32M), vLo);
+    }
+
+    /* windowing, X[4j..4j+3] in aHi[j] and aLo[j] */
+    for (s32J = 0; s32J < s32M >> 2; s32J++)
+        aHi[s32J] = aLo[s32J] = _mm_setzero_si128();
+    for (s32I = 0; s32I < 5; s32I++)
+    {
+        const INT16 *ps16D = ps16Window + 2 * s32M * s32I;
+        INT32 s32N = 4 * s32M * s32I;
+
+        if (s32M == 8)
+        {
+            vA = _mm_loadu_si128((const __m128i *)(ps16VHi + s32N));
+            vB = _mm_loadu_si128((const __m128i *)(ps16VHi + s32N + 24));
+            aHi[0] = _mm_add_epi32(aHi[0], _mm_madd_epi16(_mm_loadu_si128((const __m128i *)ps16D), _mm_unpacklo_epi16(vA, vB)));
+            aHi[1] = _mm_add_epi32(aHi[1], _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(ps16D + 8)), _mm_unpackhi_epi16(vA, vB)));
+            vA = _mm_loadu_si128((const __m128i *)(ps16VLo + s32N));
+            vB = _mm_loadu_si128((const __m128i *)(ps16VLo + s32N + 24));
+            aLo[0] = _mm_add_epi32(aLo[0], _mm_madd_epi16(_mm_loadu_si128((const __m128i *)ps16D), _mm_unpacklo_epi16(vA, vB)));
+            aLo[1] = _mm_add_epi32(aLo[1], _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(ps16D + 8)), _mm_unpackhi_epi16(vA, vB)));
+        }
+        else
+        {
+            vC = _mm_loadu_si128((const __m128i *)ps16D);
+            vA = _mm_loadl_epi64((const __m128i *)(ps16VHi + s32N));
+            vB = _mm_loadl_epi64((const __m128i *)(ps16VHi + s32N + 12));
+            aHi[0] = _mm_add_epi32(aHi[0], _mm_madd_epi16(vC, _mm_unpacklo_epi16(vA, vB)));
+            vA = _mm_loadl_epi64((const __m128i *)(ps16VLo + s32N));
+            vB = _mm_loadl_epi64((const __m128i *)(ps16VLo + s32N + 12));
+            aLo[0] = _mm_add_epi32(aLo[0], _mm_madd_epi16(vC, _mm_unpacklo_epi16(vA, vB)));
+        }
+    }
+
+    /* round half up and saturate to 16 bit */
+    vA = SBC_SYN_JOIN_SSE2(aHi[0], aLo[0], SBC_SYN_WINDOW_SHIFT);
+    vB = (s32M == 8) ? SBC_SYN_JOIN_SSE2(aHi[1], aLo[1], SBC_SYN_WINDOW_SHIFT) : _mm_setzero_si128();
+    _mm_storeu_si128((__m128i *)as16Pcm, _mm_packs_epi32(vA, vB));
+    for (s32J = 0; s32J < s32M; s32J++)
+        ps16Out[s32J * s32Stride] = as16Pcm[s32J];
+}
+#endif /* SBC_DEC_SIMD_X86 */
+
+#if defined(SBC_DEC_SIMD_NEON)
+/* (hi * 2^SPLIT + lo + round) >> shift, in 32 bits: the shift is at least SPLIT */
+#define SBC_SYN_JOIN_NEON(vHi, vLo, shift) \
+    vshrq_n_s32(vaddq_s32((vHi), vshrq_n_s32(vaddq_s32((vLo), vdupq_n_s32(1 << ((shift) - 1))), \
+                                             SBC_SYN_SPLIT)), (shift) - SBC_SYN_SPLIT)
+
+static inline int32x4_t SbcSynthesisLoNeon(int32x4_t vX)
+{
+    const int32x4_t vHalf = vdupq_n_s32(SBC_SYN_SPLIT_HALF);
+
+    return vsubq_s32(vandq_s32(vaddq_s32(vX, vHalf), vdupq_n_s32(SBC_SYN_SPLIT_MASK)), vHalf);
+}
+
+/****************************************************************************
+* SbcSynthesisBlockNeon - vmlal kernel: vld2 takes the matrix and window
+* pairs apart, so the lanes run over k (matrixing) or j (windowing) and the
+* sub band sample halves are scalars.
+*
+* RETURNS : N/A
+*/
+static void SbcSynthesisBlockNeon(const INT32 *ps32S, INT16 *ps16VHi, INT16 *ps16VLo, INT32 s32M,
+                                  const INT16 *ps16Matrix, const INT16 *ps16Window,
+                                  INT16 *ps16Out, INT32 s32Stride)
+{
+    int32x4_t aHi[4], aLo[4], vX, vLo;
+    int16x4x2_t vC;
+    int16x4_t vHi16, vLo16;
+    INT16 as16SHi[8], as16SLo[8], as16Pcm[8];
+    INT32 s32I, s32J, s32K, s32N, s32Lo;
+
+    /* split S, scalars for vmlal_n */
+    for (s32I = 0; s32I < s32M; s32I++)
+    {
+        s32Lo = SBC_SYN_SPLIT_LO(ps32S[s32I]);
+        as16SHi[s32I] = (INT16)((ps32S[s32I] - s32Lo) >> SBC_SYN_SPLIT);
+        as16SLo[s32I] = (INT16)s32Lo;
+    }
+
+    /* matrixing, V[4k..4k+3] in aHi[k] and aLo[k] */
+    for (s32K = 0; s32K < s32M >> 1; s32K++)
+        aHi[s32K] = aLo[s32K] = vdupq_n_s32(0);
+    for (s32I = 0; s32I < s32M; s32I += 2)
+    {
+        for (s32K = 0; s32K < s32M >> 1; s32K++)
+        {
+            vC = vld2_s16(ps16Matrix + 2 * s32M * s32I + 8 * s32K);
+            aHi[s32K] = vmlal_n_s16(aHi[s32K], vC.val[0], as16SHi[s32I]);
+            aHi[s32K] = vmlal_n_s16(aHi[s32K], vC.val[1], as16SHi[s32I + 1]);
+            aLo[s32K] = vmlal_n_s16(aLo[s32K], vC.val[0], as16SLo[s32I]);
+            aLo[s32K] = vmlal_n_s16(aLo[s32K], vC.val[1], as16SLo[s32I + 1]);
+        }
+    }
+    for (s32K = 0; s32K < s32M >> 1; s32K++)
+    {
+        vX = SBC_SYN_JOIN_NEON(aHi[s32K], aLo[s32K], SBC_SYN_MATRIX_SHIFT);
+        vLo = SbcSynthesisLoNeon(vX);
+        vHi16 = vmovn_s32(vshrq_n_s32(vsubq_s32(vX, vLo), SBC_SYN_SPLIT));
+        vLo16 = vmovn_s32(vLo);
+        vst1_s16(ps16VHi + 4 * s32K, vHi16);
+        vst1_s16(ps16VHi + 4 * s32K + 20 * s32M, vHi16);
+        vst1_s16(ps16VLo + 4 * s32K, vLo16);
+        vst1_s16(ps16VLo + 4 * s32K + 20 * s32M, vLo16);
+    }
+
+    /* windowing, X[4j..4j+3] in aHi[j] and aLo[j] */
+    for (s32J = 0; s32J < s32M >> 2; s32J++)
+        aHi[s32J] = aLo[s32J] = vdupq_n_s32(0);
+    for (s32I = 0; s32I < 5; s32I++)
+    {
+        for (s32J = 0; s32J < s32M >> 2; s32J++)
+        {
+            s32N = 4 * s32M * s32I + 4 * s32J;
+            vC = vld2_s16(ps16Window + 2 * s32M * s32I + 8 * s32J);
+            aHi[s32J] = vmlal_s16(aHi[s32J], vC.val[0], vld1_s16(ps16VHi + s32N));
+            aHi[s32J] = vmlal_s16(aHi[s32J], vC.val[1], vld1_s16(ps16VHi + s32N + 3 * s32M));
+            aLo[s32J] = vmlal_s16(aLo[s32J], vC.val[0], vld1_s16(ps16VLo + s32N));
+            aLo[s32J] = vmlal_s16(aLo[s32J], vC.val[1], vld1_s16(ps16VLo + s32N + 3 * s32M));
+        }
+    }
+
+    /* round half up and saturate to 16 bit */
+    for (s32J = 0; s32J < s32M >> 2; s32J++)
+        vst1_s16(as16Pcm + 4 * s32J, vqmovn_s32(SBC_SYN_JOIN_NEON(aHi[s32J], aLo[s32J], SBC_SYN_WINDOW_SHIFT)));
+    for (s32J = 0; s32J < s32M; s32J++)
+        ps16Out[s32J * s32Stride] = as16Pcm[s32J];
+}
+#endif /* SBC_DEC_SIMD_NEON */
+
+/****************************************************************************
+* SbcSynthesisSupported - Tells whether a kernel runs on the host CPU.
+*
+* RETURNS : TRUE if it is compiled in and the CPU has the instructions
+*/
+static BOOLEAN SbcSynthesisSupported(UINT8 u8Kernel)
+{
+    if (u8Kernel == SBC_DEC_KERNEL_C)
+        return TRUE;
+#if defined(SBC_DEC_SIMD_X86)
+    __builtin_cpu_init();
+    if (u8Kernel == SBC_DEC_KERNEL_SSE2)
+        return __builtin_cpu_supports("sse2") ? TRUE : FALSE;
+#elif defined(SBC_DEC_SIMD_NEON)
+    if (u8Kernel == SBC_DEC_KERNEL_NEON)
+        return TRUE;
+#endif
+    return FALSE;
+}
+
+/****************************************************************************
+* SbcSynthesisSetKernel - Selects the kernel of the next SbcSynthesisInit():
+* SBC_DEC_KERNEL_AUTO for the best one the CPU supports, or a given one to
+* compare them.
+*
+* RETURNS : FALSE if the kernel is not available, the selection is unchanged
+*/
+BOOLEAN SbcSynthesisSetKernel(UINT8 u8Kernel)
+{
+    if ((u8Kernel != SBC_DEC_KERNEL_AUTO) && !SbcSynthesisSupported(u8Kernel))
+        return FALSE;
+
+    u8SbcSynKernel = u8Kernel;
+    return TRUE;
+}
+
+/****************************************************************************
+* SbcSynthesisInit - Clears the V vector of both channels and picks the
+* block kernel.
+*
+* RETURNS : N/A
+*/
+void SbcSynthesisInit(SBC_DEC_PARAMS *pstrDecParams)
+{
+    memset(pstrDecParams->as16VHi, 0, sizeof(pstrDecParams->as16VHi));
+    memset(pstrDecParams->as16VLo, 0, sizeof(pstrDecParams->as16VLo));
+    pstrDecParams->as16VOffset[0] = 0;
+    pstrDecParams->as16VOffset[1] = 0;
+
+    pfnSynBlock = SbcSynthesisBlockC;
+#if defined(SBC_DEC_SIMD_X86)
+    if (((u8SbcSynKernel == SBC_DEC_KERNEL_AUTO) || (u8SbcSynKernel == SBC_DEC_KERNEL_SSE2)) &&
+        SbcSynthesisSupported(SBC_DEC_KERNEL_SSE2))
+        pfnSynBlock = SbcSynthesisBlockSse2;
+#elif defined(SBC_DEC_SIMD_NEON)
+    if ((u8SbcSynKernel == SBC_DEC_KERNEL_AUTO) || (u8SbcSynKernel == SBC_DEC_KERNEL_NEON))
+        pfnSynBlock = SbcSynthesisBlockNeon;
+#endif
+}
+
+/****************************************************************************
+* SbcSynthesisFilter - Synthesizes all blocks of the frame.
+*
+* RETURNS : N/A
+*/
+static inline void SbcSynthesisFilter(SBC_DEC_PARAMS *pstrDecParams, INT16 *ps16Pcm, INT32 s32M,
+                                      const INT16 *ps16Matrix, const INT16 *ps16Window)
+{
+    INT32 s32NumOfChannels = pstrDecParams->s16NumOfChannels;
+    INT32 s32Blk, s32Ch, s32Offset;
+    const INT32 *ps32S = pstrDecParams->as32SbSample;
+    tSBC_SYN_BLOCK_FUNC *pfnBlock = pfnSynBlock;
+
+    for (s32Blk = 0; s32Blk < pstrDecParams->s16NumOfBlocks; s32Blk++)
+    {
+        for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++)
+        {
+            /* shift V by one block: the newest 2*M entries move down the ring */
+            s32Offset = pstrDecParams->as16VOffset[s32Ch] - 2 * s32M;
+            if (s32Offset < 0)
+                s32Offset += 20 * s32M;
+            pstrDecParams->as16VOffset[s32Ch] = (INT16)s32Offset;
+
+            pfnBlock(ps32S, pstrDecParams->as16VHi[s32Ch] + s32Offset, pstrDecParams->as16VLo[s32Ch] + s32Offset,
+                     s32M, ps16Matrix, ps16Window,
+                     ps16Pcm + s32Blk * s32M * s32NumOfChannels + s32Ch, s32NumOfChannels);
+            ps32S += s32M;
+        }
+    }
+}
+
+void SbcSynthesisFilter4(SBC_DEC_PARAMS *pstrDecParams, INT16 *ps16Pcm)
+{
+    SbcSynthesisFilter(pstrDecParams, ps16Pcm, 4, gas16SbcSynMatrix4, gas16SbcSynWindow4);
+}
+
+void SbcSynthesisFilter8(SBC_DEC_PARAMS *pstrDecParams, INT16 *ps16Pcm)
+{
+    SbcSynthesisFilter(pstrDecParams, ps16Pcm, 8, gas16SbcSynMatrix8, gas16SbcSynWindow8);
+}
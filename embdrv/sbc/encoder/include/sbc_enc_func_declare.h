@@ -41,6 +41,7 @@ extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS *CodecParams);
 extern void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS *CodecParams);
 
 extern void SbcAnalysisInit (void);
+extern BOOLEAN SbcAnalysisSetKernel (UINT8 u8Kernel);
 
 extern void SbcAnalysisFilter4(SBC_ENC_PARAMS *strEncParams);
 extern void SbcAnalysisFilter8(SBC_ENC_PARAMS *strEncParams);
@@ -126,6 +126,19 @@
 #define SBC_FAST_DCT  TRUE
 #endif /*SBC_FAST_DCT */
 
+/* Set SBC_SIMD_OPT to TRUE to run the windowing with SSE2/AVX2 (selected at run time) or NEON kernels. */
+/* Output is bit exact with the C code. It only applies to the SBC_IPAQ_OPT 16 bit windowing */
+#ifndef SBC_SIMD_OPT
+#define SBC_SIMD_OPT  TRUE
+#endif /*SBC_SIMD_OPT */
+
+/* Windowing kernels, see SbcAnalysisSetKernel() */
+#define SBC_KERNEL_AUTO 0   /* the best one the CPU supports */
+#define SBC_KERNEL_C    1   /* WINDOW_PARTIAL_x macros */
+#define SBC_KERNEL_SSE2 2
+#define SBC_KERNEL_AVX2 3   /* 8 subbands only, SSE2 for 4 */
+#define SBC_KERNEL_NEON 4
+
 /* In case we do not use joint stereo mode the flag save some RAM and ROM in case it is set to FALSE */
 #ifndef SBC_JOINT_STE_INCLUDED
 #define SBC_JOINT_STE_INCLUDED TRUE
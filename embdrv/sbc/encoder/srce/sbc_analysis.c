@@ -23,10 +23,31 @@
  *
  ******************************************************************************/
 #include <string.h>
+#include <stdint.h>
 #include "sbc_encoder.h"
 #include "sbc_enc_func_declare.h"
 /*#include <math.h>*/
 
+/* the vector kernels implement the 16 bit coefficient windowing of SBC_IPAQ_OPT */
+#if (SBC_SIMD_OPT == TRUE) && ((SBC_ARM_ASM_OPT == TRUE) || (SBC_IPAQ_OPT == FALSE) || (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE))
+#undef SBC_SIMD_OPT
+#define SBC_SIMD_OPT FALSE
+#endif
+
+#if (SBC_SIMD_OPT == TRUE)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SBC_SIMD_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SBC_SIMD_NEON
+#include <arm_neon.h>
+#else
+#undef SBC_SIMD_OPT
+#define SBC_SIMD_OPT FALSE
+#endif
+#endif
+
+
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
 #define WIND_4_SUBBANDS_0_1 (SINT32)0x01659F45  /* gas32CoeffFor4SBs[8] = -gas32CoeffFor4SBs[32] = 0x01659F45 */
 #define WIND_4_SUBBANDS_0_2 (SINT32)0x115B1ED2  /* gas32CoeffFor4SBs[16] = -gas32CoeffFor4SBs[24] = 0x115B1ED2 */
@@ -166,7 +187,7 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 /* This macro is for 4 subbands */
 #define SHIFTUP_X4                                                               \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+38);                                 \
+    ps32X=(uint32_t *)(s16X+EncMaxShiftCounter+38);                                 \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-2-(ShiftCounter>>1));  ps32X--;                                 \
@@ -175,8 +196,8 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 }
 #define SHIFTUP_X4_2                                                              \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+38);                                   \
-    ps32X2=(SINT32 *)(s16X+(EncMaxShiftCounter<<1)+78);                             \
+    ps32X=(uint32_t *)(s16X+EncMaxShiftCounter+38);                                   \
+    ps32X2=(uint32_t *)(s16X+(EncMaxShiftCounter<<1)+78);                             \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-2-(ShiftCounter>>1));  *(ps32X2)=*(ps32X2-2-(ShiftCounter>>1)); ps32X--;  ps32X2--;                     \
@@ -187,7 +208,7 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 /* This macro is for 8 subbands */
 #define SHIFTUP_X8                                                               \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+78);                                 \
+    ps32X=(uint32_t *)(s16X+EncMaxShiftCounter+78);                                 \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-4-(ShiftCounter>>1));  ps32X--;                                 \
@@ -198,8 +219,8 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 }
 #define SHIFTUP_X8_2                                                               \
 {                                                                                   \
-    ps32X=(SINT32 *)(s16X+EncMaxShiftCounter+78);                                   \
-    ps32X2=(SINT32 *)(s16X+(EncMaxShiftCounter<<1)+158);                             \
+    ps32X=(uint32_t *)(s16X+EncMaxShiftCounter+78);                                   \
+    ps32X2=(uint32_t *)(s16X+(EncMaxShiftCounter<<1)+158);                             \
     for (i=0;i<9;i++)                                                               \
     {                                                                               \
         *ps32X=*(ps32X-4-(ShiftCounter>>1));  *(ps32X2)=*(ps32X2-4-(ShiftCounter>>1)); ps32X--;  ps32X2--;                     \
@@ -897,6 +918,275 @@ static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  S
 #endif
 #endif
 
+/* windowing kernel asked for with SbcAnalysisSetKernel() */
+static UINT8 u8SbcKernel = SBC_KERNEL_AUTO;
+
+#if (SBC_SIMD_OPT == TRUE)
+/* WINDOW_PARTIAL_8 and WINDOW_PARTIAL_4 written as s32DCTY[j] = sum(k) taps[k][j] * s16X[ChOffset+j+k*subbands] */
+static const SINT16 as16Win8Taps[5][16] =
+{
+    {0,                    WIND_8_SUBBANDS_1_0, WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_3_0,
+     WIND_8_SUBBANDS_4_0,  WIND_8_SUBBANDS_5_0, WIND_8_SUBBANDS_6_0, WIND_8_SUBBANDS_7_0,
+     WIND_8_SUBBANDS_8_0,  WIND_8_SUBBANDS_7_4, WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_5_4,
+     WIND_8_SUBBANDS_4_4,  WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_1_4},
+    {WIND_8_SUBBANDS_0_1,  WIND_8_SUBBANDS_1_1, WIND_8_SUBBANDS_2_1, WIND_8_SUBBANDS_3_1,
+     WIND_8_SUBBANDS_4_1,  WIND_8_SUBBANDS_5_1, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_7_1,
+     WIND_8_SUBBANDS_8_1,  WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_5_3,
+     WIND_8_SUBBANDS_4_3,  WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_2_3, WIND_8_SUBBANDS_1_3},
+    {WIND_8_SUBBANDS_0_2,  WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_2_2, WIND_8_SUBBANDS_3_2,
+     WIND_8_SUBBANDS_4_2,  WIND_8_SUBBANDS_5_2, WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_7_2,
+     WIND_8_SUBBANDS_8_2,  WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_5_2,
+     WIND_8_SUBBANDS_4_2,  WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_2_2, WIND_8_SUBBANDS_1_2},
+    {-WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_3, WIND_8_SUBBANDS_2_3, WIND_8_SUBBANDS_3_3,
+     WIND_8_SUBBANDS_4_3,  WIND_8_SUBBANDS_5_3, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_7_3,
+     WIND_8_SUBBANDS_8_1,  WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_5_1,
+     WIND_8_SUBBANDS_4_1,  WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_2_1, WIND_8_SUBBANDS_1_1},
+    {-WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_4, WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_3_4,
+     WIND_8_SUBBANDS_4_4,  WIND_8_SUBBANDS_5_4, WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_7_4,
+     WIND_8_SUBBANDS_8_0,  WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_6_0, WIND_8_SUBBANDS_5_0,
+     WIND_8_SUBBANDS_4_0,  WIND_8_SUBBANDS_3_0, WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_1_0}
+};
+
+static const SINT16 as16Win4Taps[5][8] =
+{
+    {0,                    WIND_4_SUBBANDS_1_0, WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_3_0,
+     WIND_4_SUBBANDS_4_0,  WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_2_4, WIND_4_SUBBANDS_1_4},
+    {WIND_4_SUBBANDS_0_1,  WIND_4_SUBBANDS_1_1, WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_3_1,
+     WIND_4_SUBBANDS_4_1,  WIND_4_SUBBANDS_3_3, WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_1_3},
+    {WIND_4_SUBBANDS_0_2,  WIND_4_SUBBANDS_1_2, WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_3_2,
+     WIND_4_SUBBANDS_4_2,  WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_1_2},
+    {-WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_3, WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_3_3,
+     WIND_4_SUBBANDS_4_1,  WIND_4_SUBBANDS_3_1, WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_1_1},
+    {-WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_4, WIND_4_SUBBANDS_2_4, WIND_4_SUBBANDS_3_4,
+     WIND_4_SUBBANDS_4_0,  WIND_4_SUBBANDS_3_0, WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_1_0}
+};
+
+/* windowing kernel selected in SbcAnalysisInit(), NULL -> WINDOW_PARTIAL_x macros */
+typedef void (tSBC_WINDOW_FUNC)(const SINT16 *ps16X, SINT32 *ps32Y);
+static tSBC_WINDOW_FUNC *pfnWindow4 = NULL;
+static tSBC_WINDOW_FUNC *pfnWindow8 = NULL;
+
+#if defined(SBC_SIMD_X86)
+/* taps (0,1), (2,3) and (4,-) interleaved per output so that one pmaddwd does two taps */
+static SINT16 as16Win8Pairs[3][32];
+static SINT16 as16Win4Pairs[3][16];
+
+static void SbcWindowPairsInit(void)
+{
+    SINT32 s32Pair, s32Sb;
+
+    for (s32Pair = 0; s32Pair < 3; s32Pair++)
+    {
+        for (s32Sb = 0; s32Sb < 16; s32Sb++)
+        {
+            as16Win8Pairs[s32Pair][s32Sb*2]   = as16Win8Taps[s32Pair*2][s32Sb];
+            as16Win8Pairs[s32Pair][s32Sb*2+1] = (s32Pair < 2) ? as16Win8Taps[s32Pair*2+1][s32Sb] : 0;
+        }
+        for (s32Sb = 0; s32Sb < 8; s32Sb++)
+        {
+            as16Win4Pairs[s32Pair][s32Sb*2]   = as16Win4Taps[s32Pair*2][s32Sb];
+            as16Win4Pairs[s32Pair][s32Sb*2+1] = (s32Pair < 2) ? as16Win4Taps[s32Pair*2+1][s32Sb] : 0;
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+static void SbcWindow4Sse2(const SINT16 *ps16X, SINT32 *ps32Y)
+{
+    const __m128i *pC = (const __m128i *)as16Win4Pairs;
+    __m128i x0 = _mm_loadu_si128((const __m128i *)(ps16X));
+    __m128i x1 = _mm_loadu_si128((const __m128i *)(ps16X + 8));
+    __m128i x2 = _mm_loadu_si128((const __m128i *)(ps16X + 16));
+    __m128i x3 = _mm_loadu_si128((const __m128i *)(ps16X + 24));
+    __m128i x4 = _mm_loadu_si128((const __m128i *)(ps16X + 32));
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc0, acc1;
+    int32_t as32Y[8];
+    int i;
+
+    acc0 = _mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), _mm_loadu_si128(pC + 0));
+    acc1 = _mm_madd_epi16(_mm_unpackhi_epi16(x0, x1), _mm_loadu_si128(pC + 1));
+    acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(x2, x3), _mm_loadu_si128(pC + 2)));
+    acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(x2, x3), _mm_loadu_si128(pC + 3)));
+    acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(x4, zero), _mm_loadu_si128(pC + 4)));
+    acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(x4, zero), _mm_loadu_si128(pC + 5)));
+
+    _mm_storeu_si128((__m128i *)as32Y, acc0);
+    _mm_storeu_si128((__m128i *)(as32Y + 4), acc1);
+    for (i = 0; i < 8; i++)
+        ps32Y[i] = as32Y[i];
+}
+
+__attribute__((target("sse2")))
+static void SbcWindow8Sse2(const SINT16 *ps16X, SINT32 *ps32Y)
+{
+    const __m128i *pC = (const __m128i *)as16Win8Pairs;
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+    __m128i xa0, xa1, xb0, xb1;
+    int32_t as32Y[16];
+    int i, k;
+
+    for (k = 0; k < 5; k += 2, pC += 4)
+    {
+        xa0 = _mm_loadu_si128((const __m128i *)(ps16X + k*16));
+        xa1 = _mm_loadu_si128((const __m128i *)(ps16X + k*16 + 8));
+        if (k < 4)
+        {
+            xb0 = _mm_loadu_si128((const __m128i *)(ps16X + k*16 + 16));
+            xb1 = _mm_loadu_si128((const __m128i *)(ps16X + k*16 + 24));
+        }
+        else
+        {
+            xb0 = xb1 = zero;
+        }
+        acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(xa0, xb0), _mm_loadu_si128(pC + 0)));
+        acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(xa0, xb0), _mm_loadu_si128(pC + 1)));
+        acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(xa1, xb1), _mm_loadu_si128(pC + 2)));
+        acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(xa1, xb1), _mm_loadu_si128(pC + 3)));
+    }
+
+    _mm_storeu_si128((__m128i *)as32Y, acc0);
+    _mm_storeu_si128((__m128i *)(as32Y + 4), acc1);
+    _mm_storeu_si128((__m128i *)(as32Y + 8), acc2);
+    _mm_storeu_si128((__m128i *)(as32Y + 12), acc3);
+    for (i = 0; i < 16; i++)
+        ps32Y[i] = as32Y[i];
+}
+
+__attribute__((target("avx2")))
+static void SbcWindow8Avx2(const SINT16 *ps16X, SINT32 *ps32Y)
+{
+    const __m256i *pC = (const __m256i *)as16Win8Pairs;
+    __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero, acc1 = zero;
+    __m256i xa, xb;
+    int32_t as32Y[16];
+    int i, k;
+
+    for (k = 0; k < 5; k += 2, pC += 2)
+    {
+        /* 64 bit lanes 0,2,1,3 so that the in-lane unpacks give outputs 0..7 and 8..15 */
+        xa = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(ps16X + k*16)), 0xD8);
+        xb = (k < 4) ? _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *)(ps16X + k*16 + 16)), 0xD8) : zero;
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(xa, xb), _mm256_loadu_si256(pC + 0)));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(xa, xb), _mm256_loadu_si256(pC + 1)));
+    }
+
+    _mm256_storeu_si256((__m256i *)as32Y, acc0);
+    _mm256_storeu_si256((__m256i *)(as32Y + 8), acc1);
+    for (i = 0; i < 16; i++)
+        ps32Y[i] = as32Y[i];
+}
+#endif /* SBC_SIMD_X86 */
+
+#if defined(SBC_SIMD_NEON)
+static void SbcWindow4Neon(const SINT16 *ps16X, SINT32 *ps32Y)
+{
+    int32x4_t acc0 = vdupq_n_s32(0), acc1 = vdupq_n_s32(0);
+    int16x8_t x, c;
+    int32_t as32Y[8];
+    int i, k;
+
+    for (k = 0; k < 5; k++)
+    {
+        x = vld1q_s16(ps16X + k*8);
+        c = vld1q_s16(as16Win4Taps[k]);
+        acc0 = vmlal_s16(acc0, vget_low_s16(x), vget_low_s16(c));
+        acc1 = vmlal_s16(acc1, vget_high_s16(x), vget_high_s16(c));
+    }
+
+    vst1q_s32(as32Y, acc0);
+    vst1q_s32(as32Y + 4, acc1);
+    for (i = 0; i < 8; i++)
+        ps32Y[i] = as32Y[i];
+}
+
+static void SbcWindow8Neon(const SINT16 *ps16X, SINT32 *ps32Y)
+{
+    int32x4_t acc0 = vdupq_n_s32(0), acc1 = vdupq_n_s32(0);
+    int32x4_t acc2 = vdupq_n_s32(0), acc3 = vdupq_n_s32(0);
+    int16x8_t xa, xb, ca, cb;
+    int32_t as32Y[16];
+    int i, k;
+
+    for (k = 0; k < 5; k++)
+    {
+        xa = vld1q_s16(ps16X + k*16);
+        xb = vld1q_s16(ps16X + k*16 + 8);
+        ca = vld1q_s16(as16Win8Taps[k]);
+        cb = vld1q_s16(as16Win8Taps[k] + 8);
+        acc0 = vmlal_s16(acc0, vget_low_s16(xa), vget_low_s16(ca));
+        acc1 = vmlal_s16(acc1, vget_high_s16(xa), vget_high_s16(ca));
+        acc2 = vmlal_s16(acc2, vget_low_s16(xb), vget_low_s16(cb));
+        acc3 = vmlal_s16(acc3, vget_high_s16(xb), vget_high_s16(cb));
+    }
+
+    vst1q_s32(as32Y, acc0);
+    vst1q_s32(as32Y + 4, acc1);
+    vst1q_s32(as32Y + 8, acc2);
+    vst1q_s32(as32Y + 12, acc3);
+    for (i = 0; i < 16; i++)
+        ps32Y[i] = as32Y[i];
+}
+#endif /* SBC_SIMD_NEON */
+
+/****************************************************************************
+* SbcWindowSupported - tells whether a windowing kernel runs on the host CPU
+*
+* RETURNS : TRUE if it is compiled in and the CPU has the instructions
+*/
+static BOOLEAN SbcWindowSupported(UINT8 u8Kernel)
+{
+#if defined(SBC_SIMD_X86)
+    __builtin_cpu_init();
+    if (u8Kernel == SBC_KERNEL_SSE2)
+        return __builtin_cpu_supports("sse2") ? TRUE : FALSE;
+    if (u8Kernel == SBC_KERNEL_AVX2)
+        return (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("avx2")) ? TRUE : FALSE;
+#elif defined(SBC_SIMD_NEON)
+    if (u8Kernel == SBC_KERNEL_NEON)
+        return TRUE;
+#endif
+    return FALSE;
+}
+
+/****************************************************************************
+* SbcWindowSelect - picks the windowing kernels, the best the host CPU
+*                   supports unless SbcAnalysisSetKernel() asked for one
+*
+* RETURNS : N/A
+*/
+static void SbcWindowSelect(void)
+{
+    pfnWindow4 = NULL;
+    pfnWindow8 = NULL;
+
+#if defined(SBC_SIMD_X86)
+    SbcWindowPairsInit();
+    if ((u8SbcKernel == SBC_KERNEL_AUTO) || (u8SbcKernel >= SBC_KERNEL_SSE2))
+    {
+        if (SbcWindowSupported(SBC_KERNEL_SSE2))
+        {
+            pfnWindow4 = SbcWindow4Sse2;
+            pfnWindow8 = SbcWindow8Sse2;
+        }
+    }
+    if ((u8SbcKernel == SBC_KERNEL_AUTO) || (u8SbcKernel == SBC_KERNEL_AVX2))
+    {
+        if (SbcWindowSupported(SBC_KERNEL_AVX2))
+            pfnWindow8 = SbcWindow8Avx2;
+    }
+#elif defined(SBC_SIMD_NEON)
+    if ((u8SbcKernel == SBC_KERNEL_AUTO) || (u8SbcKernel == SBC_KERNEL_NEON))
+    {
+        pfnWindow4 = SbcWindow4Neon;
+        pfnWindow8 = SbcWindow8Neon;
+    }
+#endif
+}
+#endif /* SBC_SIMD_OPT */
+
 static SINT16 ShiftCounter=0;
 extern SINT16 EncMaxShiftCounter;
 /****************************************************************************
@@ -910,7 +1200,8 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
     SINT32 *ps32SbBuf;
     SINT32  s32Blk,s32Ch;
     SINT32  s32NumOfChannels, s32NumOfBlocks;
-    SINT32 i,*ps32X,*ps32X2;
+    SINT32 i;
+    uint32_t *ps32X,*ps32X2;                        /* history moves two samples at a time */
     SINT32 Offset,Offset2,ChOffset;
 #if (SBC_ARM_ASM_OPT==TRUE)
     register SINT32 s32Hi,s32Hi2;
@@ -963,6 +1254,11 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
         {
             ChOffset=s32Ch*Offset2+Offset;
 
+#if (SBC_SIMD_OPT == TRUE)
+            if (pfnWindow4 != NULL)
+                pfnWindow4(&s16X[ChOffset], s32DCTY);
+            else
+#endif
             WINDOW_PARTIAL_4
 
             SBC_FastIDCT4(s32DCTY, ps32SbBuf);
@@ -1004,7 +1300,8 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
     SINT32  s32Blk,s32Ch;                                     /* counter for block*/
     SINT32 Offset,Offset2;
     SINT32  s32NumOfChannels, s32NumOfBlocks;
-    SINT32 i,*ps32X,*ps32X2;
+    SINT32 i;
+    uint32_t *ps32X,*ps32X2;                        /* history moves two samples at a time */
     SINT32 ChOffset;
 #if (SBC_ARM_ASM_OPT==TRUE)
     register SINT32 s32Hi,s32Hi2;
@@ -1067,6 +1364,11 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
         {
             ChOffset=s32Ch*Offset2+Offset;
 
+#if (SBC_SIMD_OPT == TRUE)
+            if (pfnWindow8 != NULL)
+                pfnWindow8(&s16X[ChOffset], s32DCTY);
+            else
+#endif
             WINDOW_PARTIAL_8
 
             SBC_FastIDCT8 (s32DCTY, ps32SbBuf);
@@ -1100,8 +1402,32 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
     }
 }
 
+/****************************************************************************
+* SbcAnalysisSetKernel - selects the windowing kernel of the next
+*                        SbcAnalysisInit(): SBC_KERNEL_AUTO for the best one
+*                        the CPU supports, or a given one to compare them
+*
+* RETURNS : FALSE if the kernel is not available, the selection is unchanged
+*/
+BOOLEAN SbcAnalysisSetKernel (UINT8 u8Kernel)
+{
+    if ((u8Kernel != SBC_KERNEL_AUTO) && (u8Kernel != SBC_KERNEL_C))
+    {
+#if (SBC_SIMD_OPT == TRUE)
+        if (!SbcWindowSupported(u8Kernel))
+#endif
+            return FALSE;
+    }
+
+    u8SbcKernel = u8Kernel;
+    return TRUE;
+}
+
 void SbcAnalysisInit (void)
 {
     memset(s16X,0,ENC_VX_BUFFER_SIZE*sizeof(SINT16));
     ShiftCounter=0;
+#if (SBC_SIMD_OPT == TRUE)
+    SbcWindowSelect();
+#endif
 }
@@ -114,19 +114,46 @@ SINT32   s32LRDiff[SBC_MAX_NUM_OF_BLOCKS]    = {0};
 SINT32   s32LRSum[SBC_MAX_NUM_OF_BLOCKS]     = {0};
 #endif
 
+/* |x| - 1 (0 for x == 0): OR-ing it over a sub-band gives the same top bit as max(|x|) - 1 */
+#define SBC_SCF_BITS(x) ( ((x) < 0) ? ~(x) : ((x) - ((x) != 0)) )
+
+/****************************************************************************
+* SbcScaleFactor - smallest scf (0..15) with max(|x|) <= (0x8000 << scf), from
+*                  the OR of SBC_SCF_BITS() over the sub-band samples
+*
+* RETURNS : the scale factor
+*/
+static UINT32 SbcScaleFactor(UINT32 u32Bits)
+{
+    UINT32 u32Count = 0;
+
+    u32Bits >>= 15;
+#if defined(__GNUC__)
+    if (u32Bits)
+        u32Count = (UINT32)(sizeof(unsigned long) * 8 - __builtin_clzl(u32Bits));
+#else
+    while (u32Bits)
+    {
+        u32Bits >>= 1;
+        u32Count++;
+    }
+#endif
+    return (u32Count > 15) ? 15 : u32Count;
+}
+
 void SBC_Encoder(SBC_ENC_PARAMS *pstrEncParams)
 {
     SINT32 s32Ch;                               /* counter for ch*/
     SINT32 s32Sb;                               /* counter for sub-band*/
     UINT32 u32Count, maxBit = 0;                          /* loop count*/
-    SINT32 s32MaxValue;                         /* temp variable to store max value */
+    UINT32 au32ScfBits[SBC_MAX_NUM_OF_CHANNELS*SBC_MAX_NUM_OF_SUBBANDS];
 
     SINT16 *ps16ScfL;
     SINT32 *SbBuffer;
     SINT32 s32Blk;                              /* counter for block*/
     SINT32  s32NumOfBlocks   = pstrEncParams->s16NumOfBlocks;
 #if (SBC_JOINT_STE_INCLUDED == TRUE)
-    SINT32 s32MaxValue2;
+    UINT32 u32BitsSum,u32BitsDiff;
     UINT32 u32CountSum,u32CountDiff;
     SINT32 *pSum, *pDiff;
 #endif
@@ -156,24 +183,20 @@ void SBC_Encoder(SBC_ENC_PARAMS *pstrEncParams)
 
             pstrEncParams->ps16NextPcmBuffer+=s32Ch*s32NumOfBlocks; /* in case of multible sbc frame to encode update the pcm pointer */
 
+        /* one unit stride pass over the block, no compare per sample */
         for (s32Sb=0; s32Sb<s32Ch; s32Sb++)
+            au32ScfBits[s32Sb] = 0;
+        SbBuffer=pstrEncParams->s32SbBuffer;
+        for (s32Blk=s32NumOfBlocks;s32Blk>0;s32Blk--)
         {
-            SbBuffer=pstrEncParams->s32SbBuffer+s32Sb;
-            s32MaxValue=0;
-            for (s32Blk=s32NumOfBlocks;s32Blk>0;s32Blk--)
-            {
-                if (s32MaxValue<abs32(*SbBuffer))
-                    s32MaxValue=abs32(*SbBuffer);
-                SbBuffer+=s32Ch;
-            }
-
-            u32Count = (s32MaxValue > 0x800000) ? 9 : 0;
+            for (s32Sb=0; s32Sb<s32Ch; s32Sb++)
+                au32ScfBits[s32Sb] |= (UINT32)SBC_SCF_BITS(SbBuffer[s32Sb]);
+            SbBuffer+=s32Ch;
+        }
 
-            for ( ; u32Count < 15; u32Count++)
-            {
-                if (s32MaxValue <= (SINT32)(0x8000 << u32Count))
-                    break;
-            }
+        for (s32Sb=0; s32Sb<s32Ch; s32Sb++)
+        {
+            u32Count = SbcScaleFactor(au32ScfBits[s32Sb]);
             *ps16ScfL++ = (SINT16)u32Count;
 
             if (u32Count > maxBit)
@@ -189,36 +212,22 @@ void SBC_Encoder(SBC_ENC_PARAMS *pstrEncParams)
             for (s32Sb = 0; s32Sb < s32NumOfSubBands-1; s32Sb++)
             {
                 SbBuffer=pstrEncParams->s32SbBuffer+s32Sb;
-                s32MaxValue2=0;
-                s32MaxValue=0;
+                u32BitsSum=0;
+                u32BitsDiff=0;
                 pSum       = s32LRSum;
                 pDiff      = s32LRDiff;
                 for (s32Blk=0;s32Blk<s32NumOfBlocks;s32Blk++)
                 {
                     *pSum=(*SbBuffer+*(SbBuffer+s32NumOfSubBands))>>1;
-                    if (abs32(*pSum)>s32MaxValue)
-                        s32MaxValue=abs32(*pSum);
+                    u32BitsSum |= (UINT32)SBC_SCF_BITS(*pSum);
                     pSum++;
                     *pDiff=(*SbBuffer-*(SbBuffer+s32NumOfSubBands))>>1;
-                    if (abs32(*pDiff)>s32MaxValue2)
-                        s32MaxValue2=abs32(*pDiff);
+                    u32BitsDiff |= (UINT32)SBC_SCF_BITS(*pDiff);
                     pDiff++;
                     SbBuffer+=s32Ch;
                 }
-                u32Count = (s32MaxValue > 0x800000) ? 9 : 0;
-                for ( ; u32Count < 15; u32Count++)
-                {
-                    if (s32MaxValue <= (SINT32)(0x8000 << u32Count))
-                        break;
-                }
-                u32CountSum=u32Count;
-                u32Count = (s32MaxValue2 > 0x800000) ? 9 : 0;
-                for ( ; u32Count < 15; u32Count++)
-                {
-                    if (s32MaxValue2 <= (SINT32)(0x8000 << u32Count))
-                        break;
-                }
-                u32CountDiff=u32Count;
+                u32CountSum=SbcScaleFactor(u32BitsSum);
+                u32CountDiff=SbcScaleFactor(u32BitsDiff);
                 if ( (*ps16ScfL + *(ps16ScfL+s32NumOfSubBands)) > (SINT16)(u32CountSum + u32CountDiff) )
                 {
 
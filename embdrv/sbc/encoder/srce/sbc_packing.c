@@ -71,13 +71,16 @@ void EncPacking(SBC_ENC_PARAMS *pstrEncParams)
     SINT32 s32NumOfBlocks;
     SINT32 s32NumOfSubBands = pstrEncParams->s16NumOfSubBands;
     SINT32 s32NumOfChannels = pstrEncParams->s16NumOfChannels;
-	UINT32 u32SfRaisedToPow2;	/*scale factor raised to power 2*/
+	UINT32 au32QuantOffset[SBC_MAX_NUM_OF_CHANNELS*SBC_MAX_NUM_OF_SUBBANDS];	/*scale factor raised to power 2, per sub-band*/
+	UINT16 au16Levels[SBC_MAX_NUM_OF_CHANNELS*SBC_MAX_NUM_OF_SUBBANDS];
     SINT16 *ps16ScfPtr;
     SINT32 *ps32SbPtr;
 	UINT16 u16Levels;	/*to store levels*/
 	SINT32 s32Temp1;	/*used in 64-bit multiplication*/
+#if (SBC_IS_64_MULT_IN_QUANTIZER==FALSE) || (SBC_IPAQ_OPT==FALSE)
 	SINT32 s32Low;	/*used in 64-bit multiplication*/
-#if (SBC_IS_64_MULT_IN_QUANTIZER==TRUE)
+#endif
+#if (SBC_IS_64_MULT_IN_QUANTIZER==TRUE) && (SBC_IPAQ_OPT==FALSE)
 	SINT32 s32Hi1,s32Low1,s32Carry,s32TempVal2,s32Hi, s32Temp2;
 #endif
 
@@ -135,6 +138,20 @@ void EncPacking(SBC_ENC_PARAMS *pstrEncParams)
         }
     }
 
+    /* quantizer constants only depend on the sub-band: compute them once per frame */
+    for (s32Ch = 0; s32Ch < s32Sb; s32Ch++)
+    {
+        s32LoopCount = pstrEncParams->as16Bits[s32Ch];
+        ps16ScfPtr   = &pstrEncParams->as16ScaleFactor[s32Ch];
+        au16Levels[s32Ch] = (UINT16)(((UINT32)1 << s32LoopCount) - 1);
+#if (SBC_IS_64_MULT_IN_QUANTIZER==TRUE)
+        /* finding level from reconstruction part of decoder */
+        au32QuantOffset[s32Ch] = ((UINT32)1 << ((*ps16ScfPtr)+1)) << 12;
+#else
+        au32QuantOffset[s32Ch] = ((UINT32)1 << *ps16ScfPtr);
+#endif
+    }
+
     /* Pack samples */
     ps32SbPtr   = pstrEncParams->s32SbBuffer;
     /*Temp=*pu8PacketPtr;*/
@@ -143,18 +160,19 @@ void EncPacking(SBC_ENC_PARAMS *pstrEncParams)
     {
         ps16GenPtr  = pstrEncParams->as16Bits;
         ps16ScfPtr  = pstrEncParams->as16ScaleFactor;
-        for (s32Ch = s32Sb-1; s32Ch >= 0; s32Ch--)
+        for (s32Ch = 0; s32Ch < s32Sb; s32Ch++)
         {
             s32LoopCount = *ps16GenPtr++;
             if (s32LoopCount != 0)
             {
+                u16Levels = au16Levels[s32Ch];
 #if (SBC_IS_64_MULT_IN_QUANTIZER==TRUE)
-                /* finding level from reconstruction part of decoder */
-                u32SfRaisedToPow2 = ((UINT32)1 << ((*ps16ScfPtr)+1));
-                u16Levels = (UINT16)(((UINT32)1 << s32LoopCount) - 1);
-
                 /* quantizer */
-                s32Temp1 = (*ps32SbPtr >> 2) + (u32SfRaisedToPow2 << 12);
+                s32Temp1 = (*ps32SbPtr >> 2) + au32QuantOffset[s32Ch];
+#if (SBC_IPAQ_OPT==TRUE)
+                /* same bits as the Mult64() emulation below: (s32Temp1 * u16Levels) >> (scf+2) >> 12 */
+                u32QuantizedSbValue0 = (UINT16)(((SINT64)s32Temp1 * u16Levels) >> ((*ps16ScfPtr)+14));
+#else
                 s32Temp2 = u16Levels;
 
                 Mult64 (s32Temp1, s32Temp2, s32Low, s32Hi);
@@ -164,13 +182,10 @@ void EncPacking(SBC_ENC_PARAMS *pstrEncParams)
                 s32Hi1    = s32Hi << (32 - ((*ps16ScfPtr) +2));
 
                 u32QuantizedSbValue0 = (UINT16)((s32Low1 | s32Hi1) >> 12);
+#endif
 #else
-                /* finding level from reconstruction part of decoder */
-                u32SfRaisedToPow2 = ((UINT32)1 << *ps16ScfPtr);
-                u16Levels = (UINT16)(((UINT32)1 << s32LoopCount)-1);
-
                 /* quantizer */
-                s32Temp1 = (*ps32SbPtr >> 15) + u32SfRaisedToPow2;
+                s32Temp1 = (*ps32SbPtr >> 15) + au32QuantOffset[s32Ch];
                 Mult32(s32Temp1,u16Levels,s32Low);
                 s32Low>>= (*ps16ScfPtr+1);
                 u32QuantizedSbValue0 = (UINT16)s32Low;
@@ -26,6 +26,7 @@
 
 static void gki_add_to_pool_list(UINT8 pool_id);
 static void gki_remove_from_pool_list(UINT8 pool_id);
+static void gki_build_size_classes(void);
 
 /*******************************************************************************
 **
@@ -99,7 +100,7 @@ static BOOLEAN gki_alloc_free_queue(UINT8 id)
     tGKI_COM_CB *p_cb = &gki_cb.com;
     GKI_TRACE("\ngki_alloc_free_queue in, id:%d \n", (int)id );
 
-    Q = &p_cb->freeq[p_cb->pool_list[id]];
+    Q = &p_cb->freeq[id];
 
     if(Q->p_first == 0)
     {
@@ -137,6 +138,16 @@ void gki_dealloc_free_queue(void)
             p_cb->pool_start[i] = NULL;
             p_cb->pool_end[i]   = NULL;
             p_cb->pool_size[i]  = 0;
+
+#if (GKI_BUF_TASK_CACHE == TRUE)
+            if (i < GKI_NUM_FIXED_BUF_POOLS)
+            {
+                UINT8 tt;
+
+                for (tt = 0; tt < GKI_MAX_TASKS; tt++)
+                    p_cb->task_cache_cnt[tt][i] = 0;
+            }
+#endif
         }
     }
 }
@@ -144,6 +155,229 @@ void gki_dealloc_free_queue(void)
 #endif
 // btla-specific --
 
+/*******************************************************************************
+**
+** Function         gki_buf_count_alloc
+**
+** Description      Internal function to account for a buffer handed out of a
+**                  pool. With task caches the counters are also updated
+**                  outside the GKI lock, so the update is done atomically.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_buf_count_alloc (FREE_QUEUE_T *Q)
+{
+#if (GKI_BUF_TASK_CACHE == TRUE)
+    UINT16 cnt = __atomic_add_fetch(&Q->cur_cnt, 1, __ATOMIC_RELAXED);
+    UINT16 max = __atomic_load_n(&Q->max_cnt, __ATOMIC_RELAXED);
+
+    while ((cnt > max) &&
+           !__atomic_compare_exchange_n(&Q->max_cnt, &max, cnt, FALSE,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+#else
+    if(++Q->cur_cnt > Q->max_cnt)
+        Q->max_cnt = Q->cur_cnt;
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_count_free
+**
+** Description      Internal function to account for a buffer given back to a
+**                  pool (its free queue or a task cache).
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_buf_count_free (FREE_QUEUE_T *Q)
+{
+#if (GKI_BUF_TASK_CACHE == TRUE)
+    UINT16 cnt = __atomic_load_n(&Q->cur_cnt, __ATOMIC_RELAXED);
+
+    while ((cnt > 0) &&
+           !__atomic_compare_exchange_n(&Q->cur_cnt, &cnt, (UINT16)(cnt - 1), FALSE,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+#else
+    if (Q->cur_cnt > 0)
+        Q->cur_cnt--;
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         gki_take_free_buf
+**
+** Description      Internal function to unlink the first buffer of a pool's
+**                  free queue. The caller must hold the GKI lock and account
+**                  for the buffer once it is handed out.
+**
+** Returns          the buffer header, or NULL if the free queue is empty
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_take_free_buf (UINT8 pool_id)
+{
+    FREE_QUEUE_T  *Q = &gki_cb.com.freeq[pool_id];
+    BUFFER_HDR_T  *p_hdr;
+
+    if (Q->cur_cnt >= Q->total)
+        return (NULL);
+
+// btla-specific ++
+#ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
+    if ((gki_cb.com.pool_start[pool_id] == NULL) && (gki_alloc_free_queue(pool_id) != TRUE))
+        return (NULL);
+#endif
+// btla-specific --
+
+    /* With task caches the remaining free buffers may be held by other tasks */
+    if ((p_hdr = Q->p_first) == NULL)
+        return (NULL);
+
+    Q->p_first = p_hdr->p_next;
+
+    if (!Q->p_first)
+        Q->p_last = NULL;
+
+    return (p_hdr);
+}
+
+/*******************************************************************************
+**
+** Function         gki_buf_hand_out
+**
+** Description      Internal function to prepare a buffer taken from a pool
+**                  for the application.
+**
+** Returns          pointer to the user area of the buffer
+**
+*******************************************************************************/
+static void *gki_buf_hand_out (BUFFER_HDR_T *p_hdr, UINT8 task_id)
+{
+    p_hdr->task_id = task_id;
+
+    p_hdr->status  = BUF_STATUS_UNLINKED;
+    p_hdr->p_next  = NULL;
+    p_hdr->Type    = 0;
+
+    return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
+}
+
+#if (GKI_BUF_TASK_CACHE == TRUE)
+/*******************************************************************************
+**
+** Function         gki_cache_get
+**
+** Description      Internal function to get a free buffer of a fixed pool from
+**                  the cache of the calling task. An empty cache is refilled
+**                  with half its depth under a single GKI lock.
+**
+** Returns          the buffer header, or NULL if the pool is not cached or has
+**                  no free buffer left
+**
+*******************************************************************************/
+static BUFFER_HDR_T *gki_cache_get (UINT8 task_id, UINT8 pool_id)
+{
+    tGKI_COM_CB   *p_cb = &gki_cb.com;
+    BUFFER_HDR_T  **p_cache;
+    BUFFER_HDR_T  *p_hdr;
+    UINT8         *p_cnt;
+
+    if ((task_id >= GKI_MAX_TASKS) || (pool_id >= GKI_NUM_FIXED_BUF_POOLS) ||
+        (p_cb->task_cache_depth[pool_id] == 0))
+        return (NULL);
+
+    p_cache = p_cb->task_cache[task_id][pool_id];
+    p_cnt   = &p_cb->task_cache_cnt[task_id][pool_id];
+
+    if (*p_cnt == 0)
+    {
+        GKI_disable();
+
+        while (*p_cnt < (p_cb->task_cache_depth[pool_id] + 1) / 2)
+        {
+            if ((p_hdr = gki_take_free_buf(pool_id)) == NULL)
+                break;
+
+            p_cache[(*p_cnt)++] = p_hdr;
+        }
+
+        GKI_enable();
+
+        if (*p_cnt == 0)
+            return (NULL);
+    }
+
+    p_hdr = p_cache[--(*p_cnt)];
+    gki_buf_count_alloc(&p_cb->freeq[pool_id]);
+
+    return (p_hdr);
+}
+
+/*******************************************************************************
+**
+** Function         gki_cache_put
+**
+** Description      Internal function to give a buffer back to the cache of the
+**                  calling task. A full cache first returns its upper half to
+**                  the pool's free queue under a single GKI lock.
+**
+** Returns          TRUE if the buffer was cached, FALSE if the caller has to
+**                  release it to the free queue
+**
+*******************************************************************************/
+static BOOLEAN gki_cache_put (UINT8 task_id, BUFFER_HDR_T *p_hdr)
+{
+    tGKI_COM_CB   *p_cb = &gki_cb.com;
+    FREE_QUEUE_T  *Q;
+    BUFFER_HDR_T  **p_cache;
+    UINT8         *p_cnt;
+    UINT8         depth, keep, i;
+
+    if ((task_id >= GKI_MAX_TASKS) || (p_hdr->q_id >= GKI_NUM_FIXED_BUF_POOLS) ||
+        ((depth = p_cb->task_cache_depth[p_hdr->q_id]) == 0))
+        return (FALSE);
+
+    Q       = &p_cb->freeq[p_hdr->q_id];
+    p_cache = p_cb->task_cache[task_id][p_hdr->q_id];
+    p_cnt   = &p_cb->task_cache_cnt[task_id][p_hdr->q_id];
+
+    if (*p_cnt >= depth)
+    {
+        keep = depth / 2;
+
+        for (i = keep; i < *p_cnt - 1; i++)
+            p_cache[i]->p_next = p_cache[i + 1];
+        p_cache[*p_cnt - 1]->p_next = NULL;
+
+        GKI_disable();
+
+        if (Q->p_last)
+            Q->p_last->p_next = p_cache[keep];
+        else
+            Q->p_first = p_cache[keep];
+
+        Q->p_last = p_cache[*p_cnt - 1];
+
+        GKI_enable();
+
+        *p_cnt = keep;
+    }
+
+    p_hdr->p_next  = NULL;
+    p_hdr->status  = BUF_STATUS_FREE;
+    p_hdr->task_id = GKI_INVALID_TASK;
+
+    p_cache[(*p_cnt)++] = p_hdr;
+    gki_buf_count_free(Q);
+
+    return (TRUE);
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         gki_buffer_init
@@ -328,6 +562,17 @@ void gki_buffer_init(void)
     }
 
     p_cb->curr_total_no_of_pools = GKI_NUM_FIXED_BUF_POOLS;
+    gki_build_size_classes();
+
+#if (GKI_BUF_TASK_CACHE == TRUE)
+    /* Let the task caches hold at most half of the buffers of a pool between them */
+    for(i=0; i < GKI_NUM_FIXED_BUF_POOLS ; i++)
+    {
+        UINT16 depth = p_cb->freeq[i].total / (2 * GKI_MAX_TASKS);
+
+        p_cb->task_cache_depth[i] = (UINT8)((depth > GKI_BUF_TASK_CACHE_SIZE) ? GKI_BUF_TASK_CACHE_SIZE : depth);
+    }
+#endif
 
     return;
 }
@@ -370,7 +615,7 @@ void GKI_init_q (BUFFER_Q *p_q)
 void *GKI_getbuf (UINT16 size)
 {
     UINT8         i;
-    FREE_QUEUE_T  *Q;
+    UINT8         pool_id;
     BUFFER_HDR_T  *p_hdr;
     tGKI_COM_CB *p_cb = &gki_cb.com;
 
@@ -380,12 +625,12 @@ void *GKI_getbuf (UINT16 size)
         return (NULL);
     }
 
-    /* Find the first buffer pool that is public that can hold the desired size */
-    for (i=0; i < p_cb->curr_total_no_of_pools; i++)
-    {
-        if ( size <= p_cb->freeq[p_cb->pool_list[i]].size )
-            break;
-    }
+    /* Find the first buffer pool that can hold the desired size, starting with
+     * the first pool of its size class */
+    i = p_cb->size_class[(size - 1) >> GKI_SIZE_CLASS_SHIFT];
+    while ((i < p_cb->curr_total_no_of_pools) &&
+           (size > p_cb->freeq[p_cb->pool_list[i]].size))
+        i++;
 
     if(i == p_cb->curr_total_no_of_pools)
     {
@@ -393,6 +638,25 @@ void *GKI_getbuf (UINT16 size)
         return (NULL);
     }
 
+#if (GKI_BUF_TASK_CACHE == TRUE)
+    {
+        UINT8 task_id = GKI_get_taskid();
+        UINT8 j;
+
+        /* Try the caches of the calling task before taking the GKI lock */
+        for (j = i; j < p_cb->curr_total_no_of_pools; j++)
+        {
+            pool_id = p_cb->pool_list[j];
+
+            if (((UINT16)1 << pool_id) & p_cb->pool_access_mask)
+                continue;
+
+            if ((p_hdr = gki_cache_get(task_id, pool_id)) != NULL)
+                return (gki_buf_hand_out(p_hdr, task_id));
+        }
+    }
+#endif
+
     /* Make sure the buffers aren't disturbed til finished with allocation */
     GKI_disable();
 
@@ -400,37 +664,19 @@ void *GKI_getbuf (UINT16 size)
      * until a free buffer is found */
     for ( ; i < p_cb->curr_total_no_of_pools; i++)
     {
+        pool_id = p_cb->pool_list[i];
+
         /* Only look at PUBLIC buffer pools (bypass RESTRICTED pools) */
-        if (((UINT16)1 << p_cb->pool_list[i]) & p_cb->pool_access_mask)
+        if (((UINT16)1 << pool_id) & p_cb->pool_access_mask)
             continue;
 
-        Q = &p_cb->freeq[p_cb->pool_list[i]];
-        if(Q->cur_cnt < Q->total)
+        if ((p_hdr = gki_take_free_buf(pool_id)) != NULL)
         {
-// btla-specific ++
-        #ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
-            if(Q->p_first == 0 && gki_alloc_free_queue(i) != TRUE)
-                return NULL;
-        #endif
-// btla-specific --
-            p_hdr = Q->p_first;
-            Q->p_first = p_hdr->p_next;
-
-            if (!Q->p_first)
-                Q->p_last = NULL;
-
-            if(++Q->cur_cnt > Q->max_cnt)
-                Q->max_cnt = Q->cur_cnt;
+            gki_buf_count_alloc(&p_cb->freeq[pool_id]);
 
             GKI_enable();
 
-            p_hdr->task_id = GKI_get_taskid();
-
-            p_hdr->status  = BUF_STATUS_UNLINKED;
-            p_hdr->p_next  = NULL;
-            p_hdr->Type    = 0;
-
-            return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
+            return (gki_buf_hand_out(p_hdr, GKI_get_taskid()));
         }
     }
 
@@ -457,44 +703,31 @@ void *GKI_getbuf (UINT16 size)
 *******************************************************************************/
 void *GKI_getpoolbuf (UINT8 pool_id)
 {
-    FREE_QUEUE_T  *Q;
     BUFFER_HDR_T  *p_hdr;
     tGKI_COM_CB *p_cb = &gki_cb.com;
 
     if (pool_id >= GKI_NUM_TOTAL_BUF_POOLS)
         return (NULL);
 
-    /* Make sure the buffers aren't disturbed til finished with allocation */
-    GKI_disable();
-
-    Q = &p_cb->freeq[pool_id];
-    if(Q->cur_cnt < Q->total)
+#if (GKI_BUF_TASK_CACHE == TRUE)
     {
-// btla-specific ++
-#ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
-        if(Q->p_first == 0 && gki_alloc_free_queue(pool_id) != TRUE)
-            return NULL;
+        UINT8 task_id = GKI_get_taskid();
+
+        if ((p_hdr = gki_cache_get(task_id, pool_id)) != NULL)
+            return (gki_buf_hand_out(p_hdr, task_id));
+    }
 #endif
-// btla-specific --
-        p_hdr = Q->p_first;
-        Q->p_first = p_hdr->p_next;
 
-        if (!Q->p_first)
-            Q->p_last = NULL;
+    /* Make sure the buffers aren't disturbed til finished with allocation */
+    GKI_disable();
 
-        if(++Q->cur_cnt > Q->max_cnt)
-            Q->max_cnt = Q->cur_cnt;
+    if ((p_hdr = gki_take_free_buf(pool_id)) != NULL)
+    {
+        gki_buf_count_alloc(&p_cb->freeq[pool_id]);
 
         GKI_enable();
 
-
-        p_hdr->task_id = GKI_get_taskid();
-
-        p_hdr->status  = BUF_STATUS_UNLINKED;
-        p_hdr->p_next  = NULL;
-        p_hdr->Type    = 0;
-
-        return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
+        return (gki_buf_hand_out(p_hdr, GKI_get_taskid()));
     }
 
     /* If here, no buffers in the specified pool */
@@ -543,6 +776,11 @@ void GKI_freebuf (void *p_buf)
         return;
     }
 
+#if (GKI_BUF_TASK_CACHE == TRUE)
+    if (gki_cache_put(GKI_get_taskid(), p_hdr))
+        return;
+#endif
+
     GKI_disable();
 
     /*
@@ -558,8 +796,7 @@ void GKI_freebuf (void *p_buf)
     p_hdr->p_next  = NULL;
     p_hdr->status  = BUF_STATUS_FREE;
     p_hdr->task_id = GKI_INVALID_TASK;
-    if (Q->cur_cnt > 0)
-        Q->cur_cnt--;
+    gki_buf_count_free(Q);
 
     GKI_enable();
 
@@ -1150,6 +1387,38 @@ static void gki_remove_from_pool_list(UINT8 pool_id)
     return;
 }
 
+/*******************************************************************************
+**
+** Function         gki_build_size_classes
+**
+** Description      Rebuilds the size-class table used by GKI_getbuf() to skip
+**                  the pools that are too small. Entry c holds the first index
+**                  of pool_list whose pool can hold a buffer of more than
+**                  (c << GKI_SIZE_CLASS_SHIFT) bytes. Called whenever the pool
+**                  list changes.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_build_size_classes(void)
+{
+    tGKI_COM_CB *p_cb = &gki_cb.com;
+    UINT32      min_size;
+    UINT16      c;
+    UINT8       i = 0;
+
+    for (c = 0; c < GKI_NUM_SIZE_CLASSES; c++)
+    {
+        min_size = ((UINT32)c << GKI_SIZE_CLASS_SHIFT) + 1;
+
+        while ((i < p_cb->curr_total_no_of_pools) &&
+               (p_cb->freeq[p_cb->pool_list[i]].size < min_size))
+            i++;
+
+        p_cb->size_class[c] = i;
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         GKI_igetpoolbuf
@@ -1164,32 +1433,17 @@ static void gki_remove_from_pool_list(UINT8 pool_id)
 *******************************************************************************/
 void *GKI_igetpoolbuf (UINT8 pool_id)
 {
-    FREE_QUEUE_T  *Q;
     BUFFER_HDR_T  *p_hdr;
 
     if (pool_id >= GKI_NUM_TOTAL_BUF_POOLS)
         return (NULL);
 
 
-    Q = &gki_cb.com.freeq[pool_id];
-    if(Q->cur_cnt < Q->total)
+    if ((p_hdr = gki_take_free_buf(pool_id)) != NULL)
     {
-        p_hdr = Q->p_first;
-        Q->p_first = p_hdr->p_next;
-
-        if (!Q->p_first)
-            Q->p_last = NULL;
-
-        if(++Q->cur_cnt > Q->max_cnt)
-            Q->max_cnt = Q->cur_cnt;
-
-        p_hdr->task_id = GKI_get_taskid();
+        gki_buf_count_alloc(&gki_cb.com.freeq[pool_id]);
 
-        p_hdr->status  = BUF_STATUS_UNLINKED;
-        p_hdr->p_next  = NULL;
-        p_hdr->Type    = 0;
-
-        return ((void *) ((UINT8 *)p_hdr + BUFFER_HDR_SIZE));
+        return (gki_buf_hand_out(p_hdr, GKI_get_taskid()));
     }
 
     return (NULL);
@@ -1377,6 +1631,7 @@ UINT8 GKI_create_pool (UINT16 size, UINT16 count, UINT8 permission, void *p_mem_
         gki_add_to_pool_list(xx);
         (void) GKI_set_pool_permission (xx, permission);
         p_cb->curr_total_no_of_pools++;
+        gki_build_size_classes();
 
         return (xx);
     }
@@ -1401,6 +1656,7 @@ void GKI_delete_pool (UINT8 pool_id)
 {
     FREE_QUEUE_T    *Q;
     tGKI_COM_CB     *p_cb = &gki_cb.com;
+    UINT16          cached = 0;
 
     if ((pool_id >= GKI_NUM_TOTAL_BUF_POOLS) || (!p_cb->pool_start[pool_id]))
         return;
@@ -1408,7 +1664,18 @@ void GKI_delete_pool (UINT8 pool_id)
     GKI_disable();
     Q  = &p_cb->freeq[pool_id];
 
-    if (!Q->cur_cnt)
+#if (GKI_BUF_TASK_CACHE == TRUE)
+    /* Buffers held in task caches still point into the pool memory */
+    if (pool_id < GKI_NUM_FIXED_BUF_POOLS)
+    {
+        UINT8 tt;
+
+        for (tt = 0; tt < GKI_MAX_TASKS; tt++)
+            cached += p_cb->task_cache_cnt[tt][pool_id];
+    }
+#endif
+
+    if (!Q->cur_cnt && !cached)
     {
         Q->size      = 0;
         Q->total     = 0;
@@ -1425,6 +1692,7 @@ void GKI_delete_pool (UINT8 pool_id)
 
         gki_remove_from_pool_list(pool_id);
         p_cb->curr_total_no_of_pools--;
+        gki_build_size_classes();
     }
     else
         GKI_exception(GKI_ERROR_DELETE_POOL_BAD_QID, "Deleting bad pool");
@@ -92,6 +92,10 @@ typedef struct _free_queue
 #define GKI_USE_DEFERED_ALLOC_BUF_POOLS
 // btla-specific --
 
+/* GKI_getbuf() size-class table: one entry per (1 << GKI_SIZE_CLASS_SHIFT) bytes */
+#define GKI_SIZE_CLASS_SHIFT    5
+#define GKI_NUM_SIZE_CLASSES    ((0xFFFF >> GKI_SIZE_CLASS_SHIFT) + 1)
+
 /* Exception related structures (Used in debug mode only)
 */
 #if (GKI_DEBUG == TRUE)
@@ -321,6 +325,13 @@ typedef struct
     UINT16      pool_access_mask;                   /* Bits are set if the corresponding buffer pool is a restricted pool */
     UINT8       pool_list[GKI_NUM_TOTAL_BUF_POOLS]; /* buffer pools arranged in the order of size */
     UINT8       curr_total_no_of_pools;             /* number of fixed buf pools + current number of dynamic pools */
+    UINT8       size_class[GKI_NUM_SIZE_CLASSES];   /* first pool_list index whose pools may fit each size class */
+
+#if (GKI_BUF_TASK_CACHE == TRUE)
+    BUFFER_HDR_T *task_cache[GKI_MAX_TASKS][GKI_NUM_FIXED_BUF_POOLS][GKI_BUF_TASK_CACHE_SIZE]; /* free buffers held by each task */
+    UINT8       task_cache_cnt[GKI_MAX_TASKS][GKI_NUM_FIXED_BUF_POOLS]; /* number of buffers in each task cache */
+    UINT8       task_cache_depth[GKI_NUM_FIXED_BUF_POOLS];              /* task cache limit of each pool, 0 if not cached */
+#endif
 
     BOOLEAN     timer_nesting;                      /* flag to prevent timer interrupt nesting */
 
@@ -350,6 +361,11 @@ extern void      gki_buffer_init (void);
 extern void      gki_timers_init(void);
 extern void      gki_adjust_timer_count (INT32);
 
+#if (GKI_TICKLESS_TIMER == TRUE)
+extern INT32     gki_tickless_elapsed_ticks(void);
+extern void      gki_tickless_rearm(void);
+#endif
+
 #ifdef GKI_USE_DEFERED_ALLOC_BUF_POOLS
 extern void      gki_dealloc_free_queue(void);
 #endif
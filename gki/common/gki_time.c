@@ -33,6 +33,47 @@
 #define GKI_UNUSED_LIST_ENTRY   (0x80000000L)   /* Marks an unused timer list entry (initial value) */
 #define GKI_MAX_INT32           (0x7fffffffL)
 
+#if (GKI_TICKLESS_TIMER == TRUE)
+/*******************************************************************************
+**
+** Function         gki_timers_catch_up
+**
+** Description      In tickless mode GKI_timer_update() only runs when a timer
+**                  is due, so bring the tick count, the time til the next
+**                  expiration and the inactivity delay up to date before they
+**                  are used. Expirations, and stopping the system tick, are
+**                  still left to the timer thread.
+**
+**                  NOTE:  This routine MUST be called while interrupts are
+**                          disabled.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gki_timers_catch_up(void)
+{
+    INT32 ticks = gki_tickless_elapsed_ticks();
+
+    if (ticks > 0)
+    {
+        gki_cb.com.OSTicks += ticks;
+        gki_cb.com.OSTicksTilExp -= ticks;
+
+#if (defined(GKI_DELAY_STOP_SYS_TICK) && (GKI_DELAY_STOP_SYS_TICK > 0))
+        /* keep the delay armed (non zero) so the timer thread still stops
+         * the system tick once it is over */
+        if (gki_cb.com.OSTicksTilStop)
+        {
+            if (gki_cb.com.OSTicksTilStop > (UINT32)ticks)
+                gki_cb.com.OSTicksTilStop -= ticks;
+            else
+                gki_cb.com.OSTicksTilStop = 1;
+        }
+#endif
+    }
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function         gki_timers_init
@@ -149,6 +190,11 @@ BOOLEAN gki_timers_is_timer_running(void)
 *******************************************************************************/
 UINT32  GKI_get_tick_count(void)
 {
+#if (GKI_TICKLESS_TIMER == TRUE)
+    GKI_disable();
+    gki_timers_catch_up();
+    GKI_enable();
+#endif
     return gki_cb.com.OSTicks;
 }
 
@@ -238,6 +284,11 @@ void GKI_start_timer (UINT8 tnum, INT32 ticks, BOOLEAN is_continuous)
         }
 #endif
     }
+
+#if (GKI_TICKLESS_TIMER == TRUE)
+    gki_timers_catch_up();
+#endif
+
     /* Add the time since the last task timer update.
     ** Note that this works when no timers are active since
     ** both OSNumOrigTicks and OSTicksTilExp are 0.
@@ -1016,6 +1067,11 @@ void gki_adjust_timer_count (INT32 ticks)
         {
             gki_cb.com.OSNumOrigTicks = (gki_cb.com.OSNumOrigTicks - gki_cb.com.OSTicksTilExp) + ticks;
             gki_cb.com.OSTicksTilExp = ticks;
+
+#if (GKI_TICKLESS_TIMER == TRUE)
+            /* the timer thread is sleeping until the previous expiration */
+            gki_tickless_rearm();
+#endif
         }
     }
 
@@ -90,6 +90,18 @@ static pthread_t            timer_thread_id = 0;
 static int                  shutdown_timer = 0;
 #endif
 
+#if (GKI_TICKLESS_TIMER == TRUE)
+#ifndef NO_GKI_RUN_RETURN
+#error "GKI_TICKLESS_TIMER requires NO_GKI_RUN_RETURN"
+#endif
+
+/* length of one GKI tick */
+#define GKI_TICK_NS ((long long)NSEC_PER_SEC / TICKS_PER_SEC)
+
+static struct timespec      tickless_last;          /* time of the last accounted tick */
+static BOOLEAN              tickless_rearm = FALSE; /* timer thread must recompute its deadline */
+#endif
+
 #ifndef GKI_SHUTDOWN_EVT
 #define GKI_SHUTDOWN_EVT    APPL_EVT_7
 #endif
@@ -206,7 +218,17 @@ void GKI_init(void)
      * this works too even if GKI_NO_TICK_STOP is defined in btld.txt */
     p_os->no_timer_suspend = GKI_TIMER_TICK_RUN_COND;
     pthread_mutex_init(&p_os->gki_timer_mutex, NULL);
-#ifndef NO_GKI_RUN_RETURN
+#if (GKI_TICKLESS_TIMER == TRUE)
+    {
+        pthread_condattr_t cond_attr;
+
+        /* the tickless timer thread sleeps until absolute monotonic deadlines */
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&p_os->gki_timer_cond, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+    }
+#elif !defined(NO_GKI_RUN_RETURN)
     pthread_cond_init(&p_os->gki_timer_cond, NULL);
 #endif
 }
@@ -223,8 +245,13 @@ void GKI_init(void)
 *******************************************************************************/
 UINT32 GKI_get_os_tick_count(void)
 {
+#if (GKI_TICKLESS_TIMER == TRUE)
+    /* OSTicks only moves when the timer thread runs: catch it up first */
+    return GKI_get_tick_count();
+#else
      /* TODO - add any OS specific code here */
     return (gki_cb.com.OSTicks);
+#endif
 }
 
 /*******************************************************************************
@@ -561,7 +588,7 @@ void gki_system_tick_start_stop_cback(BOOLEAN start)
         /* gki_system_tick_start_stop_cback() maybe called even so it was already stopped! */
         if (GKI_TIMER_TICK_RUN_COND == *p_run_cond)
         {
-#ifdef NO_GKI_RUN_RETURN
+#if defined(NO_GKI_RUN_RETURN) && (GKI_TICKLESS_TIMER != TRUE)
             /* take free mutex to block timer thread */
             pthread_mutex_lock(&p_os->gki_timer_mutex);
 #endif
@@ -587,10 +614,17 @@ void gki_system_tick_start_stop_cback(BOOLEAN start)
         acquire_wake_lock(PARTIAL_WAKE_LOCK, WAKE_LOCK_ID);
 
         g_GkiTimerWakeLockOn = 1;
+#endif
+#if (GKI_TICKLESS_TIMER == TRUE)
+        /* time does not advance while the system tick is stopped */
+        if (GKI_TIMER_TICK_RUN_COND != *p_run_cond)
+            clock_gettime(CLOCK_MONOTONIC, &tickless_last);
 #endif
         *p_run_cond = GKI_TIMER_TICK_RUN_COND;
 
-#ifdef NO_GKI_RUN_RETURN
+#if (GKI_TICKLESS_TIMER == TRUE)
+        gki_tickless_rearm();
+#elif defined(NO_GKI_RUN_RETURN)
         pthread_mutex_unlock( &p_os->gki_timer_mutex );
 #else
         pthread_mutex_lock( &p_os->gki_timer_mutex );
@@ -616,7 +650,156 @@ void gki_system_tick_start_stop_cback(BOOLEAN start)
 **                  one step, If your OS does it in one step, this function
 **                  should be empty.
 *********************************************************************************/
-#ifdef NO_GKI_RUN_RETURN
+#if (GKI_TICKLESS_TIMER == TRUE)
+/*******************************************************************************
+**
+** Function         gki_tickless_elapsed_ticks
+**
+** Description      Return the number of whole GKI ticks elapsed since the last
+**                  accounted tick and mark them as accounted. Called with
+**                  GKI_disable() held.
+**
+** Returns          Number of ticks, 0 while the system tick is stopped
+**
+*******************************************************************************/
+INT32 gki_tickless_elapsed_ticks(void)
+{
+    struct timespec now;
+    long long delta_ns;
+    INT32 ticks;
+
+    if (gki_cb.os.no_timer_suspend != GKI_TIMER_TICK_RUN_COND)
+        return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    delta_ns = (long long)(now.tv_sec - tickless_last.tv_sec) * NSEC_PER_SEC;
+    delta_ns += now.tv_nsec - tickless_last.tv_nsec;
+
+    if (delta_ns < GKI_TICK_NS)
+        return 0;
+
+    ticks = (INT32)(delta_ns / GKI_TICK_NS);
+
+    delta_ns = tickless_last.tv_nsec + (long long)ticks * GKI_TICK_NS;
+    tickless_last.tv_sec += delta_ns / NSEC_PER_SEC;
+    tickless_last.tv_nsec = delta_ns % NSEC_PER_SEC;
+
+    return ticks;
+}
+
+/*******************************************************************************
+**
+** Function         gki_tickless_rearm
+**
+** Description      Wake the timer thread so it recomputes its deadline after
+**                  the system tick was restarted or a timer expiring earlier
+**                  than the current one was started
+**
+** Returns          void
+**
+*******************************************************************************/
+void gki_tickless_rearm(void)
+{
+    tGKI_OS *p_os = &gki_cb.os;
+
+    pthread_mutex_lock(&p_os->gki_timer_mutex);
+    tickless_rearm = TRUE;
+    pthread_cond_signal(&p_os->gki_timer_cond);
+    pthread_mutex_unlock(&p_os->gki_timer_mutex);
+}
+
+/*******************************************************************************
+**
+** Function         timer_thread
+**
+** Description      Tickless timer thread. Sleeps until the next GKI timer
+**                  expiration (or until the system tick is restarted) and then
+**                  calls GKI_timer_update() with the number of ticks that
+**                  actually elapsed.
+**
+** Returns          void
+**
+*******************************************************************************/
+void* timer_thread(void *arg)
+{
+    tGKI_OS         *p_os = &gki_cb.os;
+    struct timespec deadline;
+    long long       sleep_ns;
+    INT32           ticks;
+    BOOLEAN         stopped, expired;
+
+    prctl(PR_SET_NAME, (unsigned long)"gki timer", 0, 0, 0);
+
+    raise_priority_a2dp(TASK_HIGH_GKI_TIMER);
+
+    GKI_disable();
+    clock_gettime(CLOCK_MONOTONIC, &tickless_last);
+    GKI_enable();
+
+    while (!shutdown_timer)
+    {
+        /* Compute the deadline of the next event from the last accounted tick */
+        GKI_disable();
+
+        stopped = (p_os->no_timer_suspend == GKI_TIMER_TICK_STOP_COND);
+
+        if (gki_cb.com.OSNumOrigTicks)
+            ticks = gki_cb.com.OSTicksTilExp;
+        else
+            ticks = TICKS_PER_SEC;
+#if (defined(GKI_DELAY_STOP_SYS_TICK) && (GKI_DELAY_STOP_SYS_TICK > 0))
+        if (gki_cb.com.OSTicksTilStop && ((INT32)gki_cb.com.OSTicksTilStop < ticks))
+            ticks = gki_cb.com.OSTicksTilStop;
+#endif
+        if (ticks < 0)
+            ticks = 0;
+
+        sleep_ns = tickless_last.tv_nsec + (long long)ticks * GKI_TICK_NS;
+        deadline.tv_sec = tickless_last.tv_sec + sleep_ns / NSEC_PER_SEC;
+        deadline.tv_nsec = sleep_ns % NSEC_PER_SEC;
+
+        GKI_enable();
+
+        /* Sleep until the deadline, or until a timer is started that expires
+         * earlier or the system tick is restarted */
+        expired = FALSE;
+
+        pthread_mutex_lock(&p_os->gki_timer_mutex);
+
+        while (!shutdown_timer && !tickless_rearm)
+        {
+            if (stopped)
+            {
+                /* no SW timer running: wait for gki_system_tick_start_stop_cback */
+                pthread_cond_wait(&p_os->gki_timer_cond, &p_os->gki_timer_mutex);
+            }
+            else if (pthread_cond_timedwait(&p_os->gki_timer_cond, \
+                             &p_os->gki_timer_mutex, &deadline) == ETIMEDOUT)
+            {
+                expired = TRUE;
+                break;
+            }
+        }
+        tickless_rearm = FALSE;
+
+        pthread_mutex_unlock(&p_os->gki_timer_mutex);
+
+        if (expired)
+        {
+            /* Update the GKI time value and internal timers by the elapsed
+             * ticks. GKI_start_timer() accounts elapsed ticks under the same
+             * lock. */
+            GKI_disable();
+            GKI_timer_update(gki_tickless_elapsed_ticks());
+            GKI_enable();
+        }
+    }
+    GKI_TRACE("gki_ulinux: Exiting timer_thread");
+    pthread_exit(NULL);
+    return NULL;
+}
+#elif defined(NO_GKI_RUN_RETURN)
 void* timer_thread(void *arg)
 {
     int timeout_ns=0;
@@ -778,6 +961,10 @@ void GKI_freeze()
 {
 #ifdef NO_GKI_RUN_RETURN
    shutdown_timer = 1;
+#if (GKI_TICKLESS_TIMER == TRUE)
+   pthread_mutex_lock( &gki_cb.os.gki_timer_mutex );
+   pthread_cond_signal( &gki_cb.os.gki_timer_cond );
+#endif
    pthread_mutex_unlock( &gki_cb.os.gki_timer_mutex );
    /* Ensure that the timer thread exits */
    pthread_join(timer_thread_id, NULL);
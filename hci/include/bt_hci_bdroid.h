@@ -70,6 +70,26 @@
 #define BTSNOOPDISP_INCLUDED TRUE
 #endif
 
+/* Size in bytes of each per-direction btsnoop record ring (power of 2) */
+#ifndef BTSNOOP_RING_SIZE
+#define BTSNOOP_RING_SIZE (64*1024)
+#endif
+
+/* Max delay before the btsnoop writer thread flushes queued records */
+#ifndef BTSNOOP_FLUSH_INTERVAL_MS
+#define BTSNOOP_FLUSH_INTERVAL_MS 100
+#endif
+
+/* Rotate the btsnoop file once it would grow past this size (0: never) */
+#ifndef BTSNOOP_MAX_FILE_SIZE
+#define BTSNOOP_MAX_FILE_SIZE 0
+#endif
+
+/* Number of rotated btsnoop files (<path>.1 .. <path>.N) kept on rotation */
+#ifndef BTSNOOP_MAX_FILES
+#define BTSNOOP_MAX_FILES 3
+#endif
+
 /* Disable external parser for production */
 #ifndef BTSNOOP_EXT_PARSER_INCLUDED
 #define BTSNOOP_EXT_PARSER_INCLUDED FALSE
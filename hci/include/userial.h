@@ -27,6 +27,8 @@
 #ifndef USERIAL_H
 #define USERIAL_H
 
+#include <sys/uio.h>
+
 /******************************************************************************
 **  Constants & Macros
 ******************************************************************************/
@@ -103,6 +105,34 @@ uint8_t userial_open(uint8_t port);
 *******************************************************************************/
 uint16_t  userial_read(uint16_t msg_id, uint8_t *p_buffer, uint16_t len);
 
+/*******************************************************************************
+**
+** Function        userial_read_peek
+**
+** Description     Return the unread bytes of the rx buffer at the head of the
+**                 receive queue without copying them. The caller must release
+**                 what it parsed with userial_read_consume() before peeking
+**                 again.
+**
+** Returns         Pointer to the first unread byte, or NULL if the receive
+**                 queue is empty. *p_len is set to the number of contiguous
+**                 bytes available at that pointer.
+**
+*******************************************************************************/
+uint8_t *userial_read_peek(uint16_t *p_len);
+
+/*******************************************************************************
+**
+** Function        userial_read_consume
+**
+** Description     Mark len bytes returned by userial_read_peek() as read and
+**                 release the rx buffer once it has been fully parsed
+**
+** Returns         None
+**
+*******************************************************************************/
+void userial_read_consume(uint16_t len);
+
 /*******************************************************************************
 **
 ** Function        userial_write
@@ -115,6 +145,20 @@ uint16_t  userial_read(uint16_t msg_id, uint8_t *p_buffer, uint16_t len);
 *******************************************************************************/
 uint16_t userial_write(uint16_t msg_id, uint8_t *p_data, uint16_t len);
 
+/*******************************************************************************
+**
+** Function        userial_writev
+**
+** Description     Write the data described by an iovec array to the userial
+**                 port, with as few system calls as the port allows. The
+**                 array is updated as data is written.
+**
+** Returns         Number of bytes actually written to the userial port. This
+**                 may be less than the total.
+**
+*******************************************************************************/
+uint16_t userial_writev(uint16_t msg_id, struct iovec *p_iov, int iovcnt);
+
 /*******************************************************************************
 **
 ** Function        userial_close
@@ -30,7 +30,9 @@
 #include <errno.h>
 #include <string.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <sys/prctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <fcntl.h>
@@ -77,6 +79,43 @@
 /* file descriptor of the BT snoop file (by default, -1 means disabled) */
 int hci_btsnoop_fd = -1;
 
+#define BTSNOOP_HDR_SIZE        24  /* btsnoop record header */
+#define BTSNOOP_SLOT_HDR_SIZE   4   /* ring slot length prefix */
+#define BTSNOOP_WRAP_MARK       0   /* slot length marking the ring wrap */
+#define BTSNOOP_RING_MASK       (BTSNOOP_RING_SIZE - 1)
+#define BTSNOOP_MAX_IOV         64  /* records written per writev() */
+
+#if (BTSNOOP_RING_SIZE & BTSNOOP_RING_MASK)
+#error "BTSNOOP_RING_SIZE must be a power of 2"
+#endif
+
+/* Record ring directions */
+enum {
+    BTSNOOP_DIR_TX,
+    BTSNOOP_DIR_RX,
+    BTSNOOP_DIR_MAX
+};
+
+typedef struct
+{
+    volatile uint32_t head;     /* producer position (free running) */
+    volatile uint32_t tail;     /* writer position (free running) */
+    volatile uint32_t drops;    /* records dropped while the ring was full */
+    uint8_t data[BTSNOOP_RING_SIZE];
+} tBTSNOOP_RING;
+
+typedef struct
+{
+    tBTSNOOP_RING ring[BTSNOOP_DIR_MAX];
+    pthread_t writer_thread;
+    sem_t writer_sem;
+    volatile uint8_t writer_running;
+    char path[256];
+    uint32_t file_size;
+} tBTSNOOP_CB;
+
+static tBTSNOOP_CB btsnoop_cb;
+
 /* Macro to perform a multiplication of 2 unsigned 32bit values and store the result
  * in an unsigned 64 bit value (as two 32 bit variables):
  * u64 = u32In1 * u32In2
@@ -199,6 +238,372 @@ int btsnoop_is_open(void)
 #endif
 }
 
+/********************************************************************************
+ ** Record rings
+ **
+ ** Each direction (host->controller and controller->host) owns a single
+ ** producer / single consumer ring. A record is formatted once, in place, as
+ ** a complete btsnoop record (24-byte header, H4 type byte, HCI packet) behind
+ ** a 4-byte slot length. A slot length of BTSNOOP_WRAP_MARK tells the reader
+ ** that the rest of the ring is unused and the next slot starts at offset 0,
+ ** so every record stays contiguous and can be handed to writev() as is.
+ ** When a ring is full the record is dropped and counted; the producer never
+ ** blocks on the file.
+ *********************************************************************************/
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_ring_put
+ **
+ ** Description      Format one record into the ring of the given direction
+ **
+ ** Returns          None
+*******************************************************************************/
+static void btsnoop_ring_put(uint8_t dir, uint8_t type, uint8_t *p,
+                             uint16_t len, uint32_t flags)
+{
+    tBTSNOOP_RING *p_ring = &btsnoop_cb.ring[dir];
+    uint32_t rec_len = BTSNOOP_HDR_SIZE + 1 + len;
+    uint32_t need = (BTSNOOP_SLOT_HDR_SIZE + rec_len + 3) & ~3;
+    uint32_t head = p_ring->head;
+    uint32_t tail = __atomic_load_n(&p_ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t idx = head & BTSNOOP_RING_MASK;
+    uint32_t skip = 0;
+    uint32_t value, value_hi;
+    uint8_t *p_rec;
+    struct timeval tv;
+
+    /* keep the record contiguous: skip the tail end of the ring if needed */
+    if ((BTSNOOP_RING_SIZE - idx) < need)
+        skip = BTSNOOP_RING_SIZE - idx;
+
+    if ((head - tail) + skip + need > BTSNOOP_RING_SIZE)
+    {
+        __atomic_add_fetch(&p_ring->drops, 1, __ATOMIC_RELAXED);
+        sem_post(&btsnoop_cb.writer_sem);
+        return;
+    }
+
+    if (skip)
+    {
+        value = BTSNOOP_WRAP_MARK;
+        memcpy(&p_ring->data[idx], &value, BTSNOOP_SLOT_HDR_SIZE);
+        head += skip;
+        idx = 0;
+    }
+
+    memcpy(&p_ring->data[idx], &rec_len, BTSNOOP_SLOT_HDR_SIZE);
+    p_rec = &p_ring->data[idx + BTSNOOP_SLOT_HDR_SIZE];
+
+    /* store the length in both original and included fields */
+    value = l_to_be(len + 1);
+    memcpy(p_rec, &value, 4);
+    memcpy(p_rec + 4, &value, 4);
+    /* flags */
+    value = l_to_be(flags);
+    memcpy(p_rec + 8, &value, 4);
+    /* cumulative drops */
+    value = l_to_be(p_ring->drops);
+    memcpy(p_rec + 12, &value, 4);
+    /* time */
+    gettimeofday(&tv, NULL);
+    tv_to_btsnoop_ts(&value, &value_hi, &tv);
+    value_hi = l_to_be(value_hi);
+    value = l_to_be(value);
+    memcpy(p_rec + 16, &value_hi, 4);
+    memcpy(p_rec + 20, &value, 4);
+    /* data */
+    p_rec[BTSNOOP_HDR_SIZE] = type;
+    memcpy(p_rec + BTSNOOP_HDR_SIZE + 1, p, len);
+
+    __atomic_store_n(&p_ring->head, head + need, __ATOMIC_RELEASE);
+
+    /* only wake the writer early once the ring is half full */
+    if ((head + need - tail) > (BTSNOOP_RING_SIZE / 2))
+        sem_post(&btsnoop_cb.writer_sem);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_ring_peek
+ **
+ ** Description      Return the record at consumer position *p_pos, skipping
+ **                  a wrap marker if there is one
+ **
+ ** Returns          Pointer to the btsnoop record or NULL if none is left
+ **                  before head. *p_len is set to the record length and
+ **                  *p_pos is moved past the record.
+*******************************************************************************/
+static uint8_t *btsnoop_ring_peek(tBTSNOOP_RING *p_ring, uint32_t *p_pos,
+                                  uint32_t head, uint32_t *p_len)
+{
+    uint32_t idx, rec_len;
+
+    while (*p_pos != head)
+    {
+        idx = *p_pos & BTSNOOP_RING_MASK;
+        memcpy(&rec_len, &p_ring->data[idx], BTSNOOP_SLOT_HDR_SIZE);
+
+        if (rec_len == BTSNOOP_WRAP_MARK)
+        {
+            *p_pos += BTSNOOP_RING_SIZE - idx;
+            continue;
+        }
+
+        *p_len = rec_len;
+        *p_pos += (BTSNOOP_SLOT_HDR_SIZE + rec_len + 3) & ~3;
+        return &p_ring->data[idx + BTSNOOP_SLOT_HDR_SIZE];
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_rec_ts
+ **
+ ** Description      Extract the timestamp of a formatted btsnoop record
+ **
+ ** Returns          64-bit btsnoop timestamp
+*******************************************************************************/
+static uint64_t btsnoop_rec_ts(uint8_t *p_rec)
+{
+    uint32_t hi, lo;
+
+    memcpy(&hi, p_rec + 16, 4);
+    memcpy(&lo, p_rec + 20, 4);
+
+    return ((uint64_t)l_to_be(hi) << 32) | l_to_be(lo);
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_file_open
+ **
+ ** Description      Create the BTSNOOP file and write the file header
+ **
+ ** Returns          TRUE if the file was opened
+*******************************************************************************/
+static uint8_t btsnoop_file_open(void)
+{
+    hci_btsnoop_fd = open(btsnoop_cb.path, \
+                          O_WRONLY|O_CREAT|O_TRUNC, \
+                          S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH);
+    if (hci_btsnoop_fd == -1)
+    {
+        perror("open");
+        SNOOPDBG("btsnoop_file_open: Unable to open snoop log file\n");
+        return FALSE;
+    }
+
+    write(hci_btsnoop_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
+    btsnoop_cb.file_size = 16;
+    return TRUE;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_file_rotate
+ **
+ ** Description      Shift <path>.N-1 .. <path> to <path>.N .. <path>.1 and
+ **                  start a new BTSNOOP file
+ **
+ ** Returns          TRUE if a new file is open
+*******************************************************************************/
+static uint8_t btsnoop_file_rotate(void)
+{
+    char old_path[sizeof(btsnoop_cb.path) + 8];
+    char new_path[sizeof(btsnoop_cb.path) + 8];
+    int i;
+
+    SNOOPDBG("btsnoop_file_rotate: %d bytes", btsnoop_cb.file_size);
+
+    close(hci_btsnoop_fd);
+
+    for (i = BTSNOOP_MAX_FILES - 1; i > 0; i--)
+    {
+        snprintf(old_path, sizeof(old_path), "%s.%d", btsnoop_cb.path, i);
+        snprintf(new_path, sizeof(new_path), "%s.%d", btsnoop_cb.path, i + 1);
+        rename(old_path, new_path);
+    }
+
+    if (BTSNOOP_MAX_FILES > 0)
+    {
+        snprintf(new_path, sizeof(new_path), "%s.1", btsnoop_cb.path);
+        rename(btsnoop_cb.path, new_path);
+    }
+
+    return btsnoop_file_open();
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_writev_all
+ **
+ ** Description      writev() the whole iovec array, picking up after short
+ **                  writes. The array is updated as data is written.
+ **
+ ** Returns          Number of bytes written, less than the total on error
+*******************************************************************************/
+static uint32_t btsnoop_writev_all(int fd, struct iovec *iov, int cnt)
+{
+    uint32_t total = 0;
+    ssize_t ret;
+
+    while (cnt > 0)
+    {
+        ret = writev(fd, iov, cnt);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (ret == 0)
+            break;
+
+        total += ret;
+
+        /* skip what went out, and cut into the first partial entry */
+        while ((cnt > 0) && ((size_t)ret >= iov->iov_len))
+        {
+            ret -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+
+    return total;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_flush
+ **
+ ** Description      Drain both record rings into the BTSNOOP file. Records of
+ **                  the two directions are merged in timestamp order and
+ **                  written with one writev() per batch.
+ **
+ ** Returns          None
+*******************************************************************************/
+static void btsnoop_flush(void)
+{
+    struct iovec iov[BTSNOOP_MAX_IOV];
+    uint32_t head[BTSNOOP_DIR_MAX], pos[BTSNOOP_DIR_MAX];
+    uint32_t next_pos[BTSNOOP_DIR_MAX], rec_len[BTSNOOP_DIR_MAX];
+    uint8_t *p_rec[BTSNOOP_DIR_MAX];
+    uint32_t batch_len;
+    int dir, pick, cnt;
+
+    for (dir = 0; dir < BTSNOOP_DIR_MAX; dir++)
+    {
+        head[dir] = __atomic_load_n(&btsnoop_cb.ring[dir].head,
+                                    __ATOMIC_ACQUIRE);
+        pos[dir] = next_pos[dir] = btsnoop_cb.ring[dir].tail;
+        p_rec[dir] = btsnoop_ring_peek(&btsnoop_cb.ring[dir], &next_pos[dir],
+                                       head[dir], &rec_len[dir]);
+    }
+
+    while ((p_rec[BTSNOOP_DIR_TX] != NULL) || (p_rec[BTSNOOP_DIR_RX] != NULL))
+    {
+        cnt = 0;
+        batch_len = 0;
+
+        while ((cnt < BTSNOOP_MAX_IOV) && \
+               ((p_rec[BTSNOOP_DIR_TX] != NULL) || \
+                (p_rec[BTSNOOP_DIR_RX] != NULL)))
+        {
+            if (p_rec[BTSNOOP_DIR_TX] == NULL)
+                pick = BTSNOOP_DIR_RX;
+            else if (p_rec[BTSNOOP_DIR_RX] == NULL)
+                pick = BTSNOOP_DIR_TX;
+            else
+                pick = (btsnoop_rec_ts(p_rec[BTSNOOP_DIR_RX]) < \
+                        btsnoop_rec_ts(p_rec[BTSNOOP_DIR_TX])) ? \
+                        BTSNOOP_DIR_RX : BTSNOOP_DIR_TX;
+
+            iov[cnt].iov_base = p_rec[pick];
+            iov[cnt].iov_len = rec_len[pick];
+            batch_len += rec_len[pick];
+            cnt++;
+
+            pos[pick] = next_pos[pick];
+            p_rec[pick] = btsnoop_ring_peek(&btsnoop_cb.ring[pick],
+                                            &next_pos[pick], head[pick],
+                                            &rec_len[pick]);
+        }
+
+        /* a failed rotation leaves no file: the records are discarded */
+        if ((BTSNOOP_MAX_FILE_SIZE > 0) && (hci_btsnoop_fd != -1) && \
+            (btsnoop_cb.file_size > 16) && \
+            (btsnoop_cb.file_size + batch_len > BTSNOOP_MAX_FILE_SIZE))
+        {
+            btsnoop_file_rotate();
+        }
+
+        if (hci_btsnoop_fd != -1)
+            btsnoop_cb.file_size += btsnoop_writev_all(hci_btsnoop_fd, iov, cnt);
+
+        /* hand the written slots back to the producers */
+        for (dir = 0; dir < BTSNOOP_DIR_MAX; dir++)
+            __atomic_store_n(&btsnoop_cb.ring[dir].tail, pos[dir],
+                             __ATOMIC_RELEASE);
+    }
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_writer_thread
+ **
+ ** Description      Drain the record rings every BTSNOOP_FLUSH_INTERVAL_MS, or
+ **                  earlier when a producer reports a ring half full
+ **
+ ** Returns          None
+*******************************************************************************/
+static void *btsnoop_writer_thread(void *arg)
+{
+    struct timespec ts;
+
+    prctl(PR_SET_NAME, (unsigned long)"btsnoop_writer", 0, 0, 0);
+
+    while (btsnoop_cb.writer_running)
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += (BTSNOOP_FLUSH_INTERVAL_MS % 1000) * 1000000;
+        ts.tv_sec += BTSNOOP_FLUSH_INTERVAL_MS / 1000 + ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+
+        sem_timedwait(&btsnoop_cb.writer_sem, &ts);
+
+        btsnoop_flush();
+    }
+
+    /* write out whatever is left before the file is closed */
+    btsnoop_flush();
+
+    return NULL;
+}
+
+/*******************************************************************************
+ **
+ ** Function         btsnoop_get_drops
+ **
+ ** Description      Get the number of records dropped since the BTSNOOP file
+ **                  was opened because the writer could not keep up
+ **
+ ** Returns          Number of dropped records
+*******************************************************************************/
+static uint32_t btsnoop_get_drops(void)
+{
+    return btsnoop_cb.ring[BTSNOOP_DIR_TX].drops + \
+           btsnoop_cb.ring[BTSNOOP_DIR_RX].drops;
+}
+
 /*******************************************************************************
  **
  ** Function         btsnoop_log_open
@@ -207,27 +612,38 @@ int btsnoop_is_open(void)
  **
  ** Returns          None
 *******************************************************************************/
+static int btsnoop_log_close(void);
+
 static int btsnoop_log_open(char *btsnoop_logfile)
 {
 #if defined(BTSNOOPDISP_INCLUDED) && (BTSNOOPDISP_INCLUDED == TRUE)
-    hci_btsnoop_fd = -1;
+    /* stop a writer left running after a failed rotation */
+    btsnoop_log_close();
 
     SNOOPDBG("btsnoop_log_open: snoop log file = %s\n", btsnoop_logfile);
 
     /* write the BT snoop header */
     if ((btsnoop_logfile != NULL) && (strlen(btsnoop_logfile) != 0))
     {
-        hci_btsnoop_fd = open(btsnoop_logfile, \
-                              O_WRONLY|O_CREAT|O_TRUNC, \
-                              S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP|S_IROTH);
-        if (hci_btsnoop_fd == -1)
+        memset(btsnoop_cb.ring, 0, sizeof(btsnoop_cb.ring));
+        strncpy(btsnoop_cb.path, btsnoop_logfile, sizeof(btsnoop_cb.path) - 1);
+        btsnoop_cb.path[sizeof(btsnoop_cb.path) - 1] = 0;
+
+        if (btsnoop_file_open() == FALSE)
+            return 0;
+
+        sem_init(&btsnoop_cb.writer_sem, 0, 0);
+        btsnoop_cb.writer_running = TRUE;
+
+        if (pthread_create(&btsnoop_cb.writer_thread, NULL, \
+                           btsnoop_writer_thread, NULL) != 0)
         {
-            perror("open");
-            SNOOPDBG("btsnoop_log_open: Unable to open snoop log file\n");
+            perror("pthread_create");
+            btsnoop_cb.writer_running = FALSE;
+            close(hci_btsnoop_fd);
             hci_btsnoop_fd = -1;
             return 0;
         }
-        write(hci_btsnoop_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
         return 1;
     }
 #endif
@@ -245,15 +661,32 @@ static int btsnoop_log_open(char *btsnoop_logfile)
 static int btsnoop_log_close(void)
 {
 #if defined(BTSNOOPDISP_INCLUDED) && (BTSNOOPDISP_INCLUDED == TRUE)
-    /* write the BT snoop header */
+    int ret = 0;
+
+    /* the writer runs until here even if a rotation left no file open */
+    if (btsnoop_cb.writer_running)
+    {
+        SNOOPDBG("btsnoop_log_close: Stopping snoop log writer\n");
+
+        btsnoop_cb.writer_running = FALSE;
+        sem_post(&btsnoop_cb.writer_sem);
+        pthread_join(btsnoop_cb.writer_thread, NULL);
+        sem_destroy(&btsnoop_cb.writer_sem);
+
+        if (btsnoop_get_drops())
+            ALOGE("btsnoop dropped %d records", btsnoop_get_drops());
+        ret = 1;
+    }
+
     if (hci_btsnoop_fd != -1)
     {
         SNOOPDBG("btsnoop_log_close: Closing snoop log file\n");
+
         close(hci_btsnoop_fd);
         hci_btsnoop_fd = -1;
-        return 1;
+        ret = 1;
     }
-    return 0;
+    return ret;
 #else
     return 2;  /* Snoop not available  */
 #endif
@@ -273,35 +706,8 @@ void btsnoop_hci_cmd(uint8_t *p)
 
     if (hci_btsnoop_fd != -1)
     {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be(p[2] + 4);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
         /* flags: command sent from the host */
-        value = l_to_be(2);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x1", 1);
-        write(hci_btsnoop_fd, p, p[2] + 3);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
+        btsnoop_ring_put(BTSNOOP_DIR_TX, 1, p, p[2] + 3, 2);
     }
 }
 
@@ -319,35 +725,8 @@ void btsnoop_hci_evt(uint8_t *p)
 
     if (hci_btsnoop_fd != -1)
     {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be(p[1] + 3);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
         /* flags: event received in the host */
-        value = l_to_be(3);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x4", 1);
-        write(hci_btsnoop_fd, p, p[1] + 2);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
+        btsnoop_ring_put(BTSNOOP_DIR_RX, 4, p, p[1] + 2, 3);
     }
 }
 
@@ -365,35 +744,9 @@ void btsnoop_sco_data(uint8_t *p, uint8_t is_rcvd)
 
     if (hci_btsnoop_fd != -1)
     {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be(p[2] + 4);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
         /* flags: data can be sent or received */
-        value = l_to_be(is_rcvd?1:0);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x3", 1);
-        write(hci_btsnoop_fd, p, p[2] + 3);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
+        btsnoop_ring_put(is_rcvd ? BTSNOOP_DIR_RX : BTSNOOP_DIR_TX, 3, p, \
+                         p[2] + 3, is_rcvd ? 1 : 0);
     }
 }
 
@@ -408,37 +761,12 @@ void btsnoop_sco_data(uint8_t *p, uint8_t is_rcvd)
 void btsnoop_acl_data(uint8_t *p, uint8_t is_rcvd)
 {
     SNOOPDBG("btsnoop_acl_data: fd = %d", hci_btsnoop_fd);
+
     if (hci_btsnoop_fd != -1)
     {
-        uint32_t value, value_hi;
-        struct timeval tv;
-
-        /* since these display functions are called from different contexts */
-        utils_lock();
-
-        /* store the length in both original and included fields */
-        value = l_to_be((p[3]<<8) + p[2] + 5);
-        write(hci_btsnoop_fd, &value, 4);
-        write(hci_btsnoop_fd, &value, 4);
         /* flags: data can be sent or received */
-        value = l_to_be(is_rcvd?1:0);
-        write(hci_btsnoop_fd, &value, 4);
-        /* drops: none */
-        value = 0;
-        write(hci_btsnoop_fd, &value, 4);
-        /* time */
-        gettimeofday(&tv, NULL);
-        tv_to_btsnoop_ts(&value, &value_hi, &tv);
-        value_hi = l_to_be(value_hi);
-        value = l_to_be(value);
-        write(hci_btsnoop_fd, &value_hi, 4);
-        write(hci_btsnoop_fd, &value, 4);
-        /* data */
-        write(hci_btsnoop_fd, "\x2", 1);
-        write(hci_btsnoop_fd, p, (p[3]<<8) + p[2] + 4);
-
-        /* since these display functions are called from different contexts */
-        utils_unlock();
+        btsnoop_ring_put(is_rcvd ? BTSNOOP_DIR_RX : BTSNOOP_DIR_TX, 2, p, \
+                         (p[3]<<8) + p[2] + 4, is_rcvd ? 1 : 0);
     }
 }
 
@@ -96,6 +96,9 @@ static const uint16_t msg_evt_table[] =
 #define ACL_RX_PKT_CONTINUE     1
 #define L2CAP_HEADER_SIZE       4
 
+/* Segments of a fragmented ACL packet handed to one writev() */
+#define H4_ACL_TX_MAX_SEGS      16
+
 /* Maximum numbers of allowed internal
 ** outstanding command packets at any time
 */
@@ -532,6 +535,115 @@ static uint8_t acl_rx_frame_end_chk (void)
     return frame_end;
 }
 
+/*******************************************************************************
+**
+** Function         acl_tx_send_segments
+**
+** Description      This function sends all but the last segment of an ACL
+**                  packet longer than the controller's ACL data length.
+**                  The H4 indicator and ACL header of each segment are built
+**                  aside, and written together with the payload, which is
+**                  left in place in p_msg, with one writev() per batch of
+**                  H4_ACL_TX_MAX_SEGS segments.
+**                  p_msg is then set up to hold the rest of the packet as a
+**                  continuation packet.
+**
+** Returns          TRUE if p_msg->layer_specific segments were sent and the
+**                  rest of the packet was handed back to the stack
+**
+*******************************************************************************/
+static uint8_t acl_tx_send_segments(HC_BT_HDR *p_msg, uint16_t acl_data_size)
+{
+    struct iovec iov[2 * H4_ACL_TX_MAX_SEGS];
+    uint8_t     seg_hdr[H4_ACL_TX_MAX_SEGS][1 + HCI_ACL_PREAMBLE_SIZE];
+    uint8_t     *p_seg[H4_ACL_TX_MAX_SEGS];
+    uint8_t     *p = ((uint8_t *)(p_msg + 1)) + p_msg->offset;
+    uint8_t     *p_data;
+    uint16_t    handle, cont_handle, remain;
+    uint8_t     num_segs, xx, partial = FALSE;
+
+    /* Get the handle from the packet */
+    STREAM_TO_UINT16 (handle, p);
+
+    /* Set packet boundary flags to "continuation packet" */
+    cont_handle = (handle & 0xCFFF) | 0x1000;
+
+    p_data = p + 2;
+    remain = p_msg->len - HCI_ACL_PREAMBLE_SIZE;
+
+    while ((remain > acl_data_size) && !partial)
+    {
+        for (num_segs = 0; (num_segs < H4_ACL_TX_MAX_SEGS) && (remain > acl_data_size); )
+        {
+            p = seg_hdr[num_segs];
+            *p++ = H4_TYPE_ACL_DATA;
+            UINT16_TO_STREAM (p, handle);
+            UINT16_TO_STREAM (p, acl_data_size);
+
+            iov[2 * num_segs].iov_base     = seg_hdr[num_segs];
+            iov[2 * num_segs].iov_len      = 1 + HCI_ACL_PREAMBLE_SIZE;
+            iov[2 * num_segs + 1].iov_base = p_data;
+            iov[2 * num_segs + 1].iov_len  = acl_data_size;
+
+            p_seg[num_segs++] = p_data;
+            p_data += acl_data_size;
+            remain -= acl_data_size;
+            handle  = cont_handle;
+
+            /* If we were only to send partial buffer, stop when done. */
+            if (p_msg->layer_specific)
+            {
+                if (--p_msg->layer_specific == 0)
+                {
+                    partial = TRUE;
+                    break;
+                }
+            }
+        }
+
+        userial_writev(MSG_STACK_TO_HC_HCI_ACL, iov, 2 * num_segs);
+
+        /* generate snoop trace messages, the segments have gone out so */
+        /* their headers may now be written in front of the payload     */
+        for (xx = 0; xx < num_segs; xx++)
+        {
+            memcpy(p_seg[xx] - HCI_ACL_PREAMBLE_SIZE, &seg_hdr[xx][1], HCI_ACL_PREAMBLE_SIZE);
+            p_msg->offset = (uint16_t)(p_seg[xx] - HCI_ACL_PREAMBLE_SIZE - (uint8_t *)(p_msg + 1));
+            p_msg->len    = acl_data_size + HCI_ACL_PREAMBLE_SIZE;
+            btsnoop_capture(p_msg, FALSE);
+        }
+    }
+
+    /* What is left goes out as one continuation packet */
+    p = p_data - HCI_ACL_PREAMBLE_SIZE;
+    p_msg->offset = (uint16_t)(p - (uint8_t *)(p_msg + 1));
+    p_msg->len    = remain + HCI_ACL_PREAMBLE_SIZE;
+
+    UINT16_TO_STREAM (p, cont_handle);
+    if (remain > acl_data_size)
+    {
+        UINT16_TO_STREAM (p, acl_data_size);
+    }
+    else
+    {
+        UINT16_TO_STREAM (p, remain);
+    }
+
+    /* Send the buffer back to L2CAP to send the rest of it later */
+    if (partial)
+    {
+        p_msg->event = MSG_HC_TO_STACK_L2C_SEG_XMIT;
+
+        if (bt_hc_cbacks)
+        {
+            bt_hc_cbacks->tx_result((TRANSAC) p_msg, (char *) (p_msg + 1), \
+                                        BT_HC_TX_FRAGMENT);
+        }
+    }
+
+    return partial;
+}
+
 /*****************************************************************************
 **   HCI H4 INTERFACE FUNCTIONS
 *****************************************************************************/
@@ -594,7 +706,6 @@ void hci_h4_cleanup(void)
 void hci_h4_send_msg(HC_BT_HDR *p_msg)
 {
     uint8_t type = 0;
-    uint16_t handle;
     uint16_t bytes_to_send, lay_spec;
     uint8_t *p = ((uint8_t *)(p_msg + 1)) + p_msg->offset;
     uint16_t event = p_msg->event & MSG_EVT_MASK;
@@ -626,68 +737,10 @@ void hci_h4_send_msg(HC_BT_HDR *p_msg)
     /* Check if sending ACL data that needs fragmenting */
     if ((event == MSG_STACK_TO_HC_HCI_ACL) && (p_msg->len > acl_pkt_size))
     {
-        /* Get the handle from the packet */
-        STREAM_TO_UINT16 (handle, p);
-
-        /* Set packet boundary flags to "continuation packet" */
-        handle = (handle & 0xCFFF) | 0x1000;
-
-        /* Do all the first chunks */
-        while (p_msg->len > acl_pkt_size)
-        {
-            /* remember layer_specific because uart borrow
-               one byte from layer_specific for packet type */
-            lay_spec = p_msg->layer_specific;
-
-            p = ((uint8_t *)(p_msg + 1)) + p_msg->offset - 1;
-            *p = type;
-            bytes_to_send = acl_pkt_size + 1; /* packet_size + message type */
-
-            bytes_sent = userial_write(event,(uint8_t *) p,bytes_to_send);
-
-            /* generate snoop trace message */
-            btsnoop_capture(p_msg, FALSE);
-
-            p_msg->layer_specific = lay_spec;
-            /* Adjust offset and length for what we just sent */
-            p_msg->offset += acl_data_size;
-            p_msg->len    -= acl_data_size;
-
-            p = ((uint8_t *)(p_msg + 1)) + p_msg->offset;
-
-            UINT16_TO_STREAM (p, handle);
-
-            if (p_msg->len > acl_pkt_size)
-            {
-                UINT16_TO_STREAM (p, acl_data_size);
-            }
-            else
-            {
-                UINT16_TO_STREAM (p, p_msg->len - HCI_ACL_PREAMBLE_SIZE);
-            }
-
-            /* If we were only to send partial buffer, stop when done.    */
-            /* Send the buffer back to L2CAP to send the rest of it later */
-            if (p_msg->layer_specific)
-            {
-                if (--p_msg->layer_specific == 0)
-                {
-                    p_msg->event = MSG_HC_TO_STACK_L2C_SEG_XMIT;
-
-                    if (bt_hc_cbacks)
-                    {
-                        bt_hc_cbacks->tx_result((TRANSAC) p_msg, \
-                                                    (char *) (p_msg + 1), \
-                                                    BT_HC_TX_FRAGMENT);
-                    }
-
-                    return;
-                }
-            }
-        }
+        if (acl_tx_send_segments(p_msg, acl_data_size))
+            return;
     }
 
-
     /* remember layer_specific because uart borrow
        one byte from layer_specific for packet type */
     lay_spec = p_msg->layer_specific;
@@ -745,6 +798,11 @@ void hci_h4_send_msg(HC_BT_HDR *p_msg)
 ** Description     Construct HCI EVENT/ACL packets and send them to stack once
 **                 complete packet has been received.
 **
+**                 The rx buffers queued by the userial reader thread are
+**                 parsed in place: preamble and payload bytes are copied in
+**                 the largest chunks the current buffer allows, so only the
+**                 H4 packet indicator is handled one byte at a time.
+**
 ** Returns         Number of read bytes
 **
 *******************************************************************************/
@@ -752,50 +810,59 @@ uint16_t hci_h4_receive_msg(void)
 {
     uint16_t    bytes_read = 0;
     uint8_t     byte;
+    uint8_t     *p_data;
+    uint16_t    avail, consumed, copy_len;
     uint16_t    msg_len, len;
     uint8_t     msg_received;
     tHCI_H4_CB  *p_cb=&h4_cb;
 
-    while (TRUE)
+    while ((p_data = userial_read_peek(&avail)) != NULL)
     {
-        /* Read one byte to see if there is anything waiting to be read */
-        if (userial_read(0 /*dummy*/, &byte, 1) == 0)
-        {
-            break;
-        }
+        consumed = 0;
 
-        bytes_read++;
-        msg_received = FALSE;
-
-        switch (p_cb->rcv_state)
+        while (consumed < avail)
         {
-        case H4_RX_MSGTYPE_ST:
-            /* Start of new message */
-            if ((byte < H4_TYPE_ACL_DATA) || (byte > H4_TYPE_EVENT))
+            msg_received = FALSE;
+
+            switch (p_cb->rcv_state)
             {
-                /* Unknown HCI message type */
-                /* Drop this byte */
-                ALOGE("[h4] Unknown HCI message type drop this byte 0x%x", byte);
+            case H4_RX_MSGTYPE_ST:
+                /* Start of new message */
+                byte = p_data[consumed++];
+
+                if ((byte < H4_TYPE_ACL_DATA) || (byte > H4_TYPE_EVENT))
+                {
+                    /* Unknown HCI message type */
+                    /* Drop this byte */
+                    ALOGE("[h4] Unknown HCI message type drop this byte 0x%x", \
+                          byte);
+                    break;
+                }
+
+                /* Initialize rx parameters */
+                p_cb->rcv_msg_type = byte;
+                p_cb->rcv_len = hci_preamble_table[byte-1];
+                memset(p_cb->preload_buffer, 0 , 6);
+                p_cb->preload_count = 0;
+                p_cb->rcv_state = H4_RX_LEN_ST; /* Next, wait for length */
                 break;
-            }
 
-            /* Initialize rx parameters */
-            p_cb->rcv_msg_type = byte;
-            p_cb->rcv_len = hci_preamble_table[byte-1];
-            memset(p_cb->preload_buffer, 0 , 6);
-            p_cb->preload_count = 0;
-            // p_cb->p_rcv_msg = NULL;
-            p_cb->rcv_state = H4_RX_LEN_ST; /* Next, wait for length to come */
-            break;
-
-        case H4_RX_LEN_ST:
-            /* Receiving preamble */
-            p_cb->preload_buffer[p_cb->preload_count++] = byte;
-            p_cb->rcv_len--;
-
-            /* Check if we received entire preamble yet */
-            if (p_cb->rcv_len == 0)
-            {
+            case H4_RX_LEN_ST:
+                /* Receiving preamble */
+                copy_len = avail - consumed;
+                if (copy_len > p_cb->rcv_len)
+                    copy_len = p_cb->rcv_len;
+
+                memcpy(p_cb->preload_buffer + p_cb->preload_count, \
+                       p_data + consumed, copy_len);
+                p_cb->preload_count += copy_len;
+                p_cb->rcv_len -= copy_len;
+                consumed += copy_len;
+
+                /* Check if we received entire preamble yet */
+                if (p_cb->rcv_len > 0)
+                    break;
+
                 if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
                 {
                     /* ACL data lengths are 16-bits */
@@ -831,7 +898,7 @@ uint16_t hci_h4_receive_msg(void)
                 {
                     /* Received entire preamble.
                      * Length is in the last received byte */
-                    msg_len = byte;
+                    msg_len = p_cb->preload_buffer[p_cb->preload_count - 1];
                     p_cb->rcv_len = msg_len;
 
                     /* Allocate a buffer for message */
@@ -894,81 +961,85 @@ uint16_t hci_h4_receive_msg(void)
                     /* Next, wait for next message */
                     p_cb->rcv_state = H4_RX_MSGTYPE_ST;
                 }
-            }
-            break;
+                break;
 
-        case H4_RX_DATA_ST:
-            *((uint8_t *)(p_cb->p_rcv_msg + 1) + p_cb->p_rcv_msg->len++) = byte;
-            p_cb->rcv_len--;
+            case H4_RX_DATA_ST:
+                /* Copy as much of the payload as this rx buffer holds */
+                copy_len = avail - consumed;
+                if (copy_len > p_cb->rcv_len)
+                    copy_len = p_cb->rcv_len;
 
-            if (p_cb->rcv_len > 0)
-            {
-                /* Read in the rest of the message */
-                len = userial_read(0 /*dummy*/, \
-                      ((uint8_t *)(p_cb->p_rcv_msg+1) + p_cb->p_rcv_msg->len), \
-                      p_cb->rcv_len);
-                p_cb->p_rcv_msg->len += len;
-                p_cb->rcv_len -= len;
-                bytes_read += len;
-            }
+                memcpy((uint8_t *)(p_cb->p_rcv_msg + 1) + p_cb->p_rcv_msg->len, \
+                       p_data + consumed, copy_len);
+                p_cb->p_rcv_msg->len += copy_len;
+                p_cb->rcv_len -= copy_len;
+                consumed += copy_len;
 
-            /* Check if we read in entire message yet */
-            if (p_cb->rcv_len == 0)
-            {
-                /* Received entire packet. */
-                /* Check for segmented l2cap packets */
-                if ((p_cb->rcv_msg_type == H4_TYPE_ACL_DATA) &&
-                    !acl_rx_frame_end_chk())
+                /* Check if we read in entire message yet */
+                if (p_cb->rcv_len == 0)
                 {
-                    /* Not the end of packet yet. */
-                    /* Next, wait for next message */
-                    p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                    /* Received entire packet. */
+                    /* Check for segmented l2cap packets */
+                    if ((p_cb->rcv_msg_type == H4_TYPE_ACL_DATA) &&
+                        !acl_rx_frame_end_chk())
+                    {
+                        /* Not the end of packet yet. */
+                        /* Next, wait for next message */
+                        p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                    }
+                    else
+                    {
+                        msg_received = TRUE;
+                        /* Next, wait for next message */
+                        p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                    }
                 }
-                else
+                break;
+
+            case H4_RX_IGNORE_ST:
+                /* Ignore reset of packet */
+                copy_len = avail - consumed;
+                if (copy_len > p_cb->rcv_len)
+                    copy_len = p_cb->rcv_len;
+
+                p_cb->rcv_len -= copy_len;
+                consumed += copy_len;
+
+                /* Check if we read in entire message yet */
+                if (p_cb->rcv_len == 0)
                 {
-                    msg_received = TRUE;
                     /* Next, wait for next message */
                     p_cb->rcv_state = H4_RX_MSGTYPE_ST;
                 }
+                break;
             }
-            break;
 
 
-        case H4_RX_IGNORE_ST:
-            /* Ignore reset of packet */
-            p_cb->rcv_len--;
-
-            /* Check if we read in entire message yet */
-            if (p_cb->rcv_len == 0)
+            /* If we received entire message, then send it to the task */
+            if (msg_received)
             {
-                /* Next, wait for next message */
-                p_cb->rcv_state = H4_RX_MSGTYPE_ST;
-            }
-            break;
-        }
-
-
-        /* If we received entire message, then send it to the task */
-        if (msg_received)
-        {
-            uint8_t intercepted = FALSE;
+                uint8_t intercepted = FALSE;
 
-            /* generate snoop trace message */
-            /* ACL packet tracing had done in acl_rx_frame_end_chk() */
-            if (p_cb->p_rcv_msg->event != MSG_HC_TO_STACK_HCI_ACL)
-                btsnoop_capture(p_cb->p_rcv_msg, TRUE);
+                /* generate snoop trace message */
+                /* ACL packet tracing had done in acl_rx_frame_end_chk() */
+                if (p_cb->p_rcv_msg->event != MSG_HC_TO_STACK_HCI_ACL)
+                    btsnoop_capture(p_cb->p_rcv_msg, TRUE);
 
-            if (p_cb->p_rcv_msg->event == MSG_HC_TO_STACK_HCI_EVT)
-                intercepted = internal_event_intercept();
+                if (p_cb->p_rcv_msg->event == MSG_HC_TO_STACK_HCI_EVT)
+                    intercepted = internal_event_intercept();
 
-            if ((bt_hc_cbacks) && (intercepted == FALSE))
-            {
-                bt_hc_cbacks->data_ind((TRANSAC) p_cb->p_rcv_msg, \
+                if ((bt_hc_cbacks) && (intercepted == FALSE))
+                {
+                    bt_hc_cbacks->data_ind((TRANSAC) p_cb->p_rcv_msg, \
                                        (char *) (p_cb->p_rcv_msg + 1), \
                                        p_cb->p_rcv_msg->len + BT_HC_HDR_SIZE);
+                }
+                p_cb->p_rcv_msg = NULL;
             }
-            p_cb->p_rcv_msg = NULL;
         }
+
+        userial_read_consume(avail);
+        bytes_read += avail;
     }
 
     return (bytes_read);
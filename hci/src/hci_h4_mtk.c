@@ -812,6 +812,11 @@ send_complete:
 ** Description     Construct HCI EVENT/ACL packets and send them to stack once
 **                 complete packet has been received.
 **
+**                 The rx buffers queued by the userial reader thread are
+**                 parsed in place: preamble and payload bytes are copied in
+**                 the largest chunks the current buffer allows, so only the
+**                 H4 packet indicator is handled one byte at a time.
+**
 ** Returns         Number of read bytes
 **
 *******************************************************************************/
@@ -819,50 +824,59 @@ uint16_t hci_h4_receive_msg(void)
 {
     uint16_t    bytes_read = 0;
     uint8_t     byte;
+    uint8_t     *p_data;
+    uint16_t    avail, consumed, copy_len;
     uint16_t    msg_len, len;
     uint8_t     msg_received;
     tHCI_H4_CB  *p_cb=&h4_cb;
 
-    while (TRUE)
+    while ((p_data = userial_read_peek(&avail)) != NULL)
     {
-        /* Read one byte to see if there is anything waiting to be read */
-        if (userial_read(0 /*dummy*/, &byte, 1) == 0)
-        {
-            break;
-        }
+        consumed = 0;
 
-        bytes_read++;
-        msg_received = FALSE;
-
-        switch (p_cb->rcv_state)
+        while (consumed < avail)
         {
-        case H4_RX_MSGTYPE_ST:
-            /* Start of new message */
-            if ((byte < H4_TYPE_ACL_DATA) || (byte > H4_TYPE_EVENT))
+            msg_received = FALSE;
+
+            switch (p_cb->rcv_state)
             {
-                /* Unknown HCI message type */
-                /* Drop this byte */
-                ALOGE("[h4] Unknown HCI message type drop this byte 0x%x", byte);
+            case H4_RX_MSGTYPE_ST:
+                /* Start of new message */
+                byte = p_data[consumed++];
+
+                if ((byte < H4_TYPE_ACL_DATA) || (byte > H4_TYPE_EVENT))
+                {
+                    /* Unknown HCI message type */
+                    /* Drop this byte */
+                    ALOGE("[h4] Unknown HCI message type drop this byte 0x%x", \
+                          byte);
+                    break;
+                }
+
+                /* Initialize rx parameters */
+                p_cb->rcv_msg_type = byte;
+                p_cb->rcv_len = hci_preamble_table[byte-1];
+                memset(p_cb->preload_buffer, 0 , 6);
+                p_cb->preload_count = 0;
+                p_cb->rcv_state = H4_RX_LEN_ST; /* Next, wait for length */
                 break;
-            }
 
-            /* Initialize rx parameters */
-            p_cb->rcv_msg_type = byte;
-            p_cb->rcv_len = hci_preamble_table[byte-1];
-            memset(p_cb->preload_buffer, 0 , 6);
-            p_cb->preload_count = 0;
-            // p_cb->p_rcv_msg = NULL;
-            p_cb->rcv_state = H4_RX_LEN_ST; /* Next, wait for length to come */
-            break;
-
-        case H4_RX_LEN_ST:
-            /* Receiving preamble */
-            p_cb->preload_buffer[p_cb->preload_count++] = byte;
-            p_cb->rcv_len--;
-
-            /* Check if we received entire preamble yet */
-            if (p_cb->rcv_len == 0)
-            {
+            case H4_RX_LEN_ST:
+                /* Receiving preamble */
+                copy_len = avail - consumed;
+                if (copy_len > p_cb->rcv_len)
+                    copy_len = p_cb->rcv_len;
+
+                memcpy(p_cb->preload_buffer + p_cb->preload_count, \
+                       p_data + consumed, copy_len);
+                p_cb->preload_count += copy_len;
+                p_cb->rcv_len -= copy_len;
+                consumed += copy_len;
+
+                /* Check if we received entire preamble yet */
+                if (p_cb->rcv_len > 0)
+                    break;
+
                 if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
                 {
                     /* ACL data lengths are 16-bits */
@@ -898,7 +912,7 @@ uint16_t hci_h4_receive_msg(void)
                 {
                     /* Received entire preamble.
                      * Length is in the last received byte */
-                    msg_len = byte;
+                    msg_len = p_cb->preload_buffer[p_cb->preload_count - 1];
                     p_cb->rcv_len = msg_len;
 
                     /* Allocate a buffer for message */
@@ -961,81 +975,85 @@ uint16_t hci_h4_receive_msg(void)
                     /* Next, wait for next message */
                     p_cb->rcv_state = H4_RX_MSGTYPE_ST;
                 }
-            }
-            break;
+                break;
 
-        case H4_RX_DATA_ST:
-            *((uint8_t *)(p_cb->p_rcv_msg + 1) + p_cb->p_rcv_msg->len++) = byte;
-            p_cb->rcv_len--;
+            case H4_RX_DATA_ST:
+                /* Copy as much of the payload as this rx buffer holds */
+                copy_len = avail - consumed;
+                if (copy_len > p_cb->rcv_len)
+                    copy_len = p_cb->rcv_len;
 
-            if (p_cb->rcv_len > 0)
-            {
-                /* Read in the rest of the message */
-                len = userial_read(0 /*dummy*/, \
-                      ((uint8_t *)(p_cb->p_rcv_msg+1) + p_cb->p_rcv_msg->len), \
-                      p_cb->rcv_len);
-                p_cb->p_rcv_msg->len += len;
-                p_cb->rcv_len -= len;
-                bytes_read += len;
-            }
+                memcpy((uint8_t *)(p_cb->p_rcv_msg + 1) + p_cb->p_rcv_msg->len, \
+                       p_data + consumed, copy_len);
+                p_cb->p_rcv_msg->len += copy_len;
+                p_cb->rcv_len -= copy_len;
+                consumed += copy_len;
 
-            /* Check if we read in entire message yet */
-            if (p_cb->rcv_len == 0)
-            {
-                /* Received entire packet. */
-                /* Check for segmented l2cap packets */
-                if ((p_cb->rcv_msg_type == H4_TYPE_ACL_DATA) &&
-                    !acl_rx_frame_end_chk())
+                /* Check if we read in entire message yet */
+                if (p_cb->rcv_len == 0)
                 {
-                    /* Not the end of packet yet. */
-                    /* Next, wait for next message */
-                    p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                    /* Received entire packet. */
+                    /* Check for segmented l2cap packets */
+                    if ((p_cb->rcv_msg_type == H4_TYPE_ACL_DATA) &&
+                        !acl_rx_frame_end_chk())
+                    {
+                        /* Not the end of packet yet. */
+                        /* Next, wait for next message */
+                        p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                    }
+                    else
+                    {
+                        msg_received = TRUE;
+                        /* Next, wait for next message */
+                        p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                    }
                 }
-                else
+                break;
+
+            case H4_RX_IGNORE_ST:
+                /* Ignore reset of packet */
+                copy_len = avail - consumed;
+                if (copy_len > p_cb->rcv_len)
+                    copy_len = p_cb->rcv_len;
+
+                p_cb->rcv_len -= copy_len;
+                consumed += copy_len;
+
+                /* Check if we read in entire message yet */
+                if (p_cb->rcv_len == 0)
                 {
-                    msg_received = TRUE;
                     /* Next, wait for next message */
                     p_cb->rcv_state = H4_RX_MSGTYPE_ST;
                 }
+                break;
             }
-            break;
-
 
-        case H4_RX_IGNORE_ST:
-            /* Ignore reset of packet */
-            p_cb->rcv_len--;
 
-            /* Check if we read in entire message yet */
-            if (p_cb->rcv_len == 0)
+            /* If we received entire message, then send it to the task */
+            if (msg_received)
             {
-                /* Next, wait for next message */
-                p_cb->rcv_state = H4_RX_MSGTYPE_ST;
-            }
-            break;
-        }
-
-
-        /* If we received entire message, then send it to the task */
-        if (msg_received)
-        {
-            uint8_t intercepted = FALSE;
+                uint8_t intercepted = FALSE;
 
-            /* generate snoop trace message */
-            /* ACL packet tracing had done in acl_rx_frame_end_chk() */
-            if (p_cb->p_rcv_msg->event != MSG_HC_TO_STACK_HCI_ACL)
-                btsnoop_capture(p_cb->p_rcv_msg, TRUE);
+                /* generate snoop trace message */
+                /* ACL packet tracing had done in acl_rx_frame_end_chk() */
+                if (p_cb->p_rcv_msg->event != MSG_HC_TO_STACK_HCI_ACL)
+                    btsnoop_capture(p_cb->p_rcv_msg, TRUE);
 
-            if (p_cb->p_rcv_msg->event == MSG_HC_TO_STACK_HCI_EVT)
-                intercepted = internal_event_intercept();
+                if (p_cb->p_rcv_msg->event == MSG_HC_TO_STACK_HCI_EVT)
+                    intercepted = internal_event_intercept();
 
-            if ((bt_hc_cbacks) && (intercepted == FALSE))
-            {
-                bt_hc_cbacks->data_ind((TRANSAC) p_cb->p_rcv_msg, \
+                if ((bt_hc_cbacks) && (intercepted == FALSE))
+                {
+                    bt_hc_cbacks->data_ind((TRANSAC) p_cb->p_rcv_msg, \
                                        (char *) (p_cb->p_rcv_msg + 1), \
                                        p_cb->p_rcv_msg->len + BT_HC_HDR_SIZE);
+                }
+                p_cb->p_rcv_msg = NULL;
             }
-            p_cb->p_rcv_msg = NULL;
         }
+
+        userial_read_consume(avail);
+        bytes_read += avail;
     }
 
     return (bytes_read);
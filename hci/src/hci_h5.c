@@ -27,6 +27,7 @@
 #define LOG_TAG "bt_h5"
 #include <utils/Log.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include "bt_hci_bdroid.h"
 #include "hci.h"
@@ -36,9 +37,15 @@
 #include <errno.h>
 #include "bt_skbuff.h"
 #include "bt_list.h"
+#include "bt_crc.h"
 
 #include <signal.h>
 #include <time.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 
 /******************************************************************************
@@ -505,12 +512,17 @@ static __inline uint16_t bit_rev16(uint16_t x)
     return (bit_rev8(x & 0xff) << 8) | bit_rev8(x >> 8);
 }
 
-static const uint16_t crc_table[] = 
+/* Byte classes for the SLIP scanner. Decoding stops a run on 0xc0 and 0xdb;
+ * encoding also escapes the software flow control bytes 0x11 and 0x13. */
+#define H5_SLIP_CLASS_DEC   0x01
+#define H5_SLIP_CLASS_ENC   0x02
+
+static const uint8_t h5_slip_class[256] =
 {
-    0x0000, 0x1081, 0x2102, 0x3183,
-    0x4204, 0x5285, 0x6306, 0x7387,
-    0x8408, 0x9489, 0xa50a, 0xb58b,
-    0xc60c, 0xd68d, 0xe70e, 0xf78f
+    [0x11] = H5_SLIP_CLASS_ENC,
+    [0x13] = H5_SLIP_CLASS_ENC,
+    [0xc0] = H5_SLIP_CLASS_ENC | H5_SLIP_CLASS_DEC,
+    [0xdb] = H5_SLIP_CLASS_ENC | H5_SLIP_CLASS_DEC
 };
 
 // Initialise the crc calculator 
@@ -836,12 +848,7 @@ HCI_CONN* ConnHashLookupByHandle(struct tHCI_H5_CB* h5, uint16_t Handle)
 */
 static void h5_crc_update(uint16_t *crc, uint8_t d)
 {
-    uint16_t reg = *crc;
-
-    reg = (reg >> 4) ^ crc_table[(reg ^ d) & 0x000f];
-    reg = (reg >> 4) ^ crc_table[(reg ^ (d >> 4)) & 0x000f];
-
-    *crc = reg;
+    *crc = bt_crc16_ccitt(*crc, &d, 1);
 }
 
 struct __una_u16 { uint16_t x; };
@@ -919,6 +926,106 @@ static void h5_slip_one_byte(sk_buff *skb, uint8_t c)
     }
 }
 
+/**
+* Count the bytes at the start of a buffer that SLIP passes through unchanged,
+* 16 at a time where SIMD is available.
+*
+* @param p data to scan
+* @param len length of data
+* @param cls H5_SLIP_CLASS_ENC or H5_SLIP_CLASS_DEC
+* @return length of the run of plain bytes
+*/
+static uint32_t h5_slip_scan(const uint8_t *p, uint32_t len, uint8_t cls)
+{
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i c0 = _mm_set1_epi8((char)0xc0), db = _mm_set1_epi8((char)0xdb);
+    const __m128i x11 = _mm_set1_epi8(0x11), x13 = _mm_set1_epi8(0x13);
+    __m128i v, m;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        v = _mm_loadu_si128((const __m128i *)(p + i));
+        m = _mm_or_si128(_mm_cmpeq_epi8(v, c0), _mm_cmpeq_epi8(v, db));
+        if (cls & H5_SLIP_CLASS_ENC)
+            m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, x11), _mm_cmpeq_epi8(v, x13)));
+        if (_mm_movemask_epi8(m))
+            break;
+    }
+#elif defined(__aarch64__)
+    const uint8x16_t c0 = vdupq_n_u8(0xc0), db = vdupq_n_u8(0xdb);
+    const uint8x16_t x11 = vdupq_n_u8(0x11), x13 = vdupq_n_u8(0x13);
+    uint8x16_t v, m;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        v = vld1q_u8(p + i);
+        m = vorrq_u8(vceqq_u8(v, c0), vceqq_u8(v, db));
+        if (cls & H5_SLIP_CLASS_ENC)
+            m = vorrq_u8(m, vorrq_u8(vceqq_u8(v, x11), vceqq_u8(v, x13)));
+        if (vmaxvq_u8(m))
+            break;
+    }
+#endif
+
+    while (i < len && !(h5_slip_class[p[i]] & cls))
+        i++;
+
+    return i;
+}
+
+/**
+* Slip encode a block of data, copying runs of plain bytes in one go
+*
+* @param skb socket buffer
+* @param data pure data
+* @param len length of data
+*/
+static void h5_slip_block(sk_buff *skb, const uint8_t *data, uint32_t len)
+{
+    uint32_t run;
+
+    while (len)
+    {
+        run = h5_slip_scan(data, len, H5_SLIP_CLASS_ENC);
+        if (run)
+        {
+            memcpy(skb_put(skb, run), data, run);
+            data += run;
+            len -= run;
+        }
+        if (len)
+        {
+            h5_slip_one_byte(skb, *data);
+            data++;
+            len--;
+        }
+    }
+}
+
+/**
+* Take in a run of received bytes that need no unescaping: copy them to
+* the packet and add them to the crc in one go.
+*
+* @param h5 realtek h5 struct
+* @param data received bytes, none of them 0xc0 or 0xdb
+* @param len number of bytes, at most rx_count
+*/
+static void h5_unslip_run(struct tHCI_H5_CB *h5, const uint8_t *data, uint32_t len)
+{
+    H5_PKT_HEADER * hdr;
+
+    memcpy(skb_put(h5->rx_skb, len), data, len);
+
+    //Check Pkt Header's CRC enable bit
+    hdr = (H5_PKT_HEADER *)skb_get_data(h5->rx_skb);
+    if (hdr->DicPresent && h5->rx_state != H5_W4_CRC)
+        h5->message_crc = bt_crc16_ccitt(h5->message_crc, data, len);
+
+    h5->rx_count -= len;
+}
+
 /**
 * Decode one byte in h5 proto, as follows:
 * 0xdb, 0xdc -> 0xc0
@@ -1017,7 +1124,7 @@ static sk_buff * h5_prepare_pkt(struct tHCI_H5_CB *h5, uint8_t *data, signed lon
     sk_buff *nskb;
     uint8_t hdr[4];
     uint16_t H5_CRC_INIT(h5_txmsg_crc);
-    int rel, i;
+    int rel;
     //ALOGI("HCI h5_prepare_pkt");   
 
     switch (pkt_type) 
@@ -1074,22 +1181,14 @@ static sk_buff * h5_prepare_pkt(struct tHCI_H5_CB *h5, uint8_t *data, signed lon
     hdr[3] = ~(hdr[0] + hdr[1] + hdr[2]);
 
     // Put h5 header */
-    for (i = 0; i < 4; i++) 
-    {
-	h5_slip_one_byte(nskb, hdr[i]);
-
-	if (h5->use_crc)
-	    h5_crc_update(&h5_txmsg_crc, hdr[i]);
-    }
+    h5_slip_block(nskb, hdr, 4);
+    if (h5->use_crc)
+	h5_txmsg_crc = bt_crc16_ccitt(h5_txmsg_crc, hdr, 4);
 
     // Put payload */
-    for (i = 0; i < len; i++) 
-    {
-	h5_slip_one_byte(nskb, data[i]);
-
-       if (h5->use_crc)
-	   h5_crc_update(&h5_txmsg_crc, data[i]);
-    }
+    h5_slip_block(nskb, data, len);
+    if (h5->use_crc)
+	h5_txmsg_crc = bt_crc16_ccitt(h5_txmsg_crc, data, len);
 
     // Put CRC */
     if (h5->use_crc) 
@@ -2197,6 +2296,7 @@ static void h5_complete_rx_pkt(struct tHCI_H5_CB *h5)
 static int h5_recv(struct tHCI_H5_CB *h5, void *data, int count)
 {
     unsigned char *ptr;
+    uint32_t run;
     uint8_t * skb_data = NULL;
     H5_PKT_HEADER * hdr = NULL;
         
@@ -2207,6 +2307,18 @@ static int h5_recv(struct tHCI_H5_CB *h5, void *data, int count)
     {
         if (h5->rx_count) 
         {
+            if (h5->rx_esc_state == H5_ESCSTATE_NOESC)
+            {
+                run = h5_slip_scan(ptr, ((uint32_t)count < h5->rx_count) ? (uint32_t)count : h5->rx_count,
+                                   H5_SLIP_CLASS_DEC);
+                if (run)
+                {
+                    h5_unslip_run(h5, ptr, run);
+                    ptr += run; count -= run;
+                    continue;
+                }
+            }
+
             if (*ptr == 0xc0) 
             {
 		ALOGE("short h5 packet");
@@ -31,6 +31,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include "bt_hci_bdroid.h"
@@ -58,6 +59,16 @@
 #endif
 
 #define MAX_SERIAL_PORT (USERIAL_PORT_3 + 1)
+
+/* Unix stream socket the controller is served on, overridden by the
+** USERIAL_SOCKET_ENV environment variable (e.g. for tools/btemu) */
+#ifndef USERIAL_SOCKET_PATH
+#define USERIAL_SOCKET_PATH "/home/nikhil/Desktop/bt-server-bredr"
+#endif
+
+#ifndef USERIAL_SOCKET_ENV
+#define USERIAL_SOCKET_ENV "BT_HCI_SOCKET"
+#endif
 #define READ_LIMIT (BTHC_USERIAL_READ_MEM_SIZE - BT_HC_HDR_SIZE)
 
 enum {
@@ -320,6 +331,7 @@ uint8_t userial_open(uint8_t port)
     struct sockaddr_un addr;
 	size_t len;
 	int fd;
+	char *p_sock;
 	
 	char path[] = "/tmp/bt-server-bredr";
 
@@ -420,7 +432,9 @@ uint8_t userial_open(uint8_t port)
 	
 	
 	//strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
-	strcpy(addr.sun_path, "/home/nikhil/Desktop/bt-server-bredr");
+	p_sock = getenv(USERIAL_SOCKET_ENV);
+	strncpy(addr.sun_path, (p_sock != NULL) ? p_sock : USERIAL_SOCKET_PATH,
+	        sizeof(addr.sun_path) - 1);
 
 	if (connect(fd, (struct sockaddr *) &addr, sizeof(struct sockaddr_un)) < 0) {
           close(fd);
@@ -532,6 +546,75 @@ uint16_t  userial_read(uint16_t msg_id, uint8_t *p_buffer, uint16_t len)
     return total_len;
 }
 
+/*******************************************************************************
+**
+** Function        userial_read_peek
+**
+** Description     Return the unread bytes of the rx buffer at the head of the
+**                 receive queue without copying them. The caller must release
+**                 what it parsed with userial_read_consume() before peeking
+**                 again.
+**
+** Returns         Pointer to the first unread byte, or NULL if the receive
+**                 queue is empty. *p_len is set to the number of contiguous
+**                 bytes available at that pointer.
+**
+*******************************************************************************/
+uint8_t *userial_read_peek(uint16_t *p_len)
+{
+    *p_len = 0;
+
+    while (userial_cb.p_rx_hdr == NULL || userial_cb.p_rx_hdr->len == 0)
+    {
+        if (userial_cb.p_rx_hdr != NULL)
+        {
+            if (bt_hc_cbacks)
+                bt_hc_cbacks->dealloc((TRANSAC) userial_cb.p_rx_hdr, \
+                                          (char *) (userial_cb.p_rx_hdr+1));
+        }
+
+        userial_cb.p_rx_hdr=(HC_BT_HDR *)utils_dequeue(&(userial_cb.rx_q));
+
+        if (userial_cb.p_rx_hdr == NULL)
+            return NULL;
+    }
+
+    *p_len = userial_cb.p_rx_hdr->len;
+    return ((uint8_t *)(userial_cb.p_rx_hdr + 1)) + userial_cb.p_rx_hdr->offset;
+}
+
+/*******************************************************************************
+**
+** Function        userial_read_consume
+**
+** Description     Mark len bytes returned by userial_read_peek() as read and
+**                 release the rx buffer once it has been fully parsed
+**
+** Returns         None
+**
+*******************************************************************************/
+void userial_read_consume(uint16_t len)
+{
+    if (userial_cb.p_rx_hdr == NULL)
+        return;
+
+    if (len > userial_cb.p_rx_hdr->len)
+        len = userial_cb.p_rx_hdr->len;
+
+    userial_cb.p_rx_hdr->offset += len;
+    userial_cb.p_rx_hdr->len -= len;
+    recv_byte_total += len;
+
+    if (userial_cb.p_rx_hdr->len == 0)
+    {
+        if (bt_hc_cbacks)
+            bt_hc_cbacks->dealloc((TRANSAC) userial_cb.p_rx_hdr, \
+                                      (char *) (userial_cb.p_rx_hdr+1));
+
+        userial_cb.p_rx_hdr = NULL;
+    }
+}
+
 /*******************************************************************************
 **
 ** Function        userial_write
@@ -578,6 +661,58 @@ uint16_t userial_write(uint16_t msg_id, uint8_t *p_data, uint16_t len)
     return ((uint16_t)total);
 }
 
+/*******************************************************************************
+**
+** Function        userial_writev
+**
+** Description     Write the data described by an iovec array to the userial
+**                 port, with as few system calls as the port allows. The
+**                 array is updated as data is written.
+**
+** Returns         Number of bytes actually written to the userial port. This
+**                 may be less than the total.
+**
+*******************************************************************************/
+uint16_t userial_writev(uint16_t msg_id, struct iovec *p_iov, int iovcnt)
+{
+    int ret, total = 0;
+    int retry = 0;
+
+    while (iovcnt > 0)
+    {
+        ret = writev(userial_cb.fd, p_iov, iovcnt);
+        if (ret < 0)
+        {
+            if (retry >= 5)
+            {
+                return total;
+            }
+            ALOGE("[h4] writev failed:%d-%d-%d-%d-%s-%d\n", ret, userial_cb.fd,
+                total, errno, strerror(errno), retry);
+            retry++;
+            usleep(10000);
+            continue;
+        }
+        total += ret;
+
+        /* Skip the entries written, a short write leaves one partly sent */
+        while ((iovcnt > 0) && ((size_t)ret >= p_iov->iov_len))
+        {
+            ret -= p_iov->iov_len;
+            p_iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            p_iov->iov_base = (uint8_t *)p_iov->iov_base + ret;
+            p_iov->iov_len -= ret;
+        }
+    }
+
+    send_byte_total += total;
+    return ((uint16_t)total);
+}
+
 /*******************************************************************************
 **
 ** Function        userial_close
@@ -202,6 +202,12 @@
 #define BTA_AV_INCLUDED TRUE
 #endif
 
+/* register an A2DP sink end point next to the source, received audio is
+   decoded by the media task */
+#ifndef BTIF_AV_SINK_INCLUDED
+#define BTIF_AV_SINK_INCLUDED TRUE
+#endif
+
 #ifndef BTA_AV_VDP_INCLUDED
 #define BTA_AV_VDP_INCLUDED FALSE
 #endif
@@ -270,6 +276,18 @@
 #define BTA_GATT_INCLUDED FALSE
 #endif
 
+/* Number of GATT servers whose client cache file is kept mapped */
+#ifndef BTA_GATTC_CO_CACHE_MAX
+#define BTA_GATTC_CO_CACHE_MAX 10
+#endif
+
+/* Load only the services from the GATT client cache file. The attributes of
+** a service are read back from the cache callout when the service is first
+** queried. */
+#ifndef BTA_GATTC_CACHE_LAZY
+#define BTA_GATTC_CACHE_LAZY TRUE
+#endif
+
 #ifndef BTA_DISABLE_DELAY
 #define BTA_DISABLE_DELAY 200 /* in milliseconds */
 #endif
@@ -378,6 +396,27 @@
 #define BT_TRACE_VERBOSE  FALSE
 #endif
 
+/* Deferred trace backend for LogMsg, enabled at run time by TraceRing in
+** bt_stack.conf. See bte_trace_ring.h. */
+#ifndef BTE_TRACE_RING_INCLUDED
+#define BTE_TRACE_RING_INCLUDED  TRUE
+#endif
+
+/* Messages kept per thread, a power of two; each takes 128 bytes. */
+#ifndef BTE_TRACE_RING_SLOTS
+#define BTE_TRACE_RING_SLOTS  1024
+#endif
+
+/* Threads that get a ring, the others format their messages in line. */
+#ifndef BTE_TRACE_RING_MAX_THREADS
+#define BTE_TRACE_RING_MAX_THREADS  32
+#endif
+
+/* Interval at which the rings are drained, in milliseconds. */
+#ifndef BTE_TRACE_RING_FLUSH_MS
+#define BTE_TRACE_RING_FLUSH_MS  100
+#endif
+
 #ifndef BTTRC_PARSER_INCLUDED
 #define BTTRC_PARSER_INCLUDED  FALSE
 #endif
@@ -717,6 +756,12 @@
 #define GATT_DB_POOL_ID                 GKI_POOL_ID_8
 #endif
 
+/* Largest service (in handles) that gets a handle index in the GATT server
+** database. Bigger services fall back to walking the attribute list. */
+#ifndef GATT_DB_INDEX_MAX_HDL
+#define GATT_DB_INDEX_MAX_HDL           512
+#endif
+
 /******************************************************************************
 **
 ** Lower Layer Interface
@@ -909,6 +954,12 @@ and USER_HW_DISABLE_API macros */
 #define BTM_INQ_DB_SIZE             40
 #endif
 
+/* The number of slots in the BD address index of the BTM inquiry database.
+** Must be a power of two, at least twice BTM_INQ_DB_SIZE. */
+#ifndef BTM_INQ_DB_HASH_SIZE
+#define BTM_INQ_DB_HASH_SIZE        128
+#endif
+
 /* This is set to enable automatic periodic inquiry at startup. */
 #ifndef BTM_ENABLE_AUTO_INQUIRY
 #define BTM_ENABLE_AUTO_INQUIRY     FALSE
@@ -1061,6 +1112,12 @@ and USER_HW_DISABLE_API macros */
 #define BTM_SEC_MAX_DEVICE_RECORDS  100
 #endif
 
+/* The number of slots in the BD address index of the security records.
+** Must be a power of two, at least twice BTM_SEC_MAX_DEVICE_RECORDS. */
+#ifndef BTM_SEC_DEV_HASH_SIZE
+#define BTM_SEC_DEV_HASH_SIZE       256
+#endif
+
 /* The number of security records for services. */
 #ifndef BTM_SEC_MAX_SERVICE_RECORDS
 #define BTM_SEC_MAX_SERVICE_RECORDS 32
@@ -1375,6 +1432,12 @@ and USER_HW_DISABLE_API macros */
 #define L2CAP_ROUND_ROBIN_CHANNEL_SERVICE   TRUE
 #endif
 
+/* Deficit round robin quantum in bytes granted to a link per turn, and to a */
+/* channel per turn multiplied by its Tx data rate (L2CA_SetChnlDataRate).  */
+#ifndef L2CAP_DRR_QUANTUM
+#define L2CAP_DRR_QUANTUM                   L2CAP_MTU_SIZE
+#endif
+
 /* Used for calculating transmit buffers off of */
 #ifndef L2CAP_NUM_XMIT_BUFFS
 #define L2CAP_NUM_XMIT_BUFFS                HCI_ACL_BUF_MAX
@@ -1432,6 +1495,19 @@ and USER_HW_DISABLE_API macros */
 #define LOCAL_BLE_CONTROLLER_ID         (1)
 #endif
 
+/* The number of resolvable private addresses remembered together with the
+** device they resolved to, or the fact that they did not resolve.
+** Must be a power of two. */
+#ifndef BTM_BLE_RPA_CACHE_SIZE
+#define BTM_BLE_RPA_CACHE_SIZE          64
+#endif
+
+/* Seconds a resolved private address is remembered, the minimum interval
+** at which devices refresh their private address. */
+#ifndef BTM_BLE_RPA_CACHE_TTL
+#define BTM_BLE_RPA_CACHE_TTL           900
+#endif
+
 /******************************************************************************
 **
 ** ATT/GATT Protocol/Profile Settings
@@ -1505,6 +1581,16 @@ and USER_HW_DISABLE_API macros */
 #define SMP_MIN_ENC_KEY_SIZE    7
 #endif
 
+/* Use the AES instructions of the CPU (AES-NI, ARMv8 Crypto Extensions) when present */
+#ifndef SMP_AES_HW_INCLUDED
+#define SMP_AES_HW_INCLUDED     TRUE
+#endif
+
+/* Number of expanded AES keys SMP keeps for reuse */
+#ifndef SMP_AES_KEY_CACHE_SIZE
+#define SMP_AES_KEY_CACHE_SIZE  4
+#endif
+
 /* Used for conformance testing ONLY */
 #ifndef SMP_CONFORMANCE_TESTING
 #define SMP_CONFORMANCE_TESTING           FALSE
@@ -1539,6 +1625,12 @@ and USER_HW_DISABLE_API macros */
 #define SDP_MAX_PAD_LEN             600
 #endif
 
+/* The maximum number of distinct UUIDs in the SDP server's UUID to record index.
+** A database holding more is searched record by record instead. */
+#ifndef SDP_MAX_UUID_INDEX
+#define SDP_MAX_UUID_INDEX          64
+#endif
+
 /* The maximum length, in bytes, of an attribute. */
 #ifndef SDP_MAX_ATTR_LEN
 //#if defined(HID_DEV_INCLUDED) && (HID_DEV_INCLUDED==TRUE)
@@ -1676,6 +1768,11 @@ and USER_HW_DISABLE_API macros */
 #define PORT_TX_BUF_HIGH_WM         10
 #endif
 
+/* The most buffers PORT_WriteDataCO fills with one call-out. */
+#ifndef PORT_CO_MAX_SEGS
+#define PORT_CO_MAX_SEGS            PORT_TX_BUF_HIGH_WM
+#endif
+
 /* The port transmit queue high watermark level, in number of buffers. */
 #ifndef PORT_TX_BUF_CRITICAL_WM
 #define PORT_TX_BUF_CRITICAL_WM     15
@@ -0,0 +1,155 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2001-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Definitions for the deferred trace backend of LogMsg.
+ *
+ *  Trace calls store the format string pointer, the raw arguments and a
+ *  CLOCK_MONOTONIC timestamp in a ring owned by the calling thread; copies
+ *  are only made of %s arguments. A background thread drains the rings and
+ *  either formats the messages to the usual log output or writes them in
+ *  the binary form below, which tools/bttrace decodes offline.
+ *
+ *  Binary file layout, all fields in host byte order:
+ *
+ *      tBTE_TRACE_FILE_HDR
+ *      records, each starting with tBTE_TRACE_REC_HDR:
+ *        BTE_TRACE_REC_FMT   fmt_id (8), format string (len - 12, no NUL)
+ *        BTE_TRACE_REC_EVT   tBTE_TRACE_EVT, args (8 each), strings
+ *        BTE_TRACE_REC_LOST  thread id (4), records lost (4)
+ *
+ *  A format string is written once, before the first event using it. The
+ *  %s arguments of an event are offsets into its strings, or
+ *  BTE_TRACE_STR_NULL.
+ *
+ ******************************************************************************/
+#ifndef BTE_TRACE_RING_H
+#define BTE_TRACE_RING_H
+
+#include <stdint.h>
+
+#define BTE_TRACE_FILE_MAGIC        0x52544442      /* "BDTR" */
+#define BTE_TRACE_FILE_VERSION      1
+
+/* maximum number of arguments of one trace message */
+#define BTE_TRACE_MAX_ARGS          6
+
+#define BTE_TRACE_REC_FMT           1
+#define BTE_TRACE_REC_EVT           2
+#define BTE_TRACE_REC_LOST          3
+
+#define BTE_TRACE_STR_NULL          0xFFFF
+
+typedef struct
+{
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    hdr_len;
+    int64_t     realtime_offset_ns;     /* CLOCK_REALTIME - CLOCK_MONOTONIC */
+} tBTE_TRACE_FILE_HDR;
+
+typedef struct
+{
+    uint16_t    type;
+    uint16_t    len;                    /* of the record, this header included */
+} tBTE_TRACE_REC_HDR;
+
+typedef struct
+{
+    uint64_t    ts_ns;                  /* CLOCK_MONOTONIC */
+    uint64_t    fmt_id;
+    uint32_t    trace_set_mask;
+    uint32_t    tid;
+    uint8_t     nargs;
+    uint8_t     str_mask;               /* bit n set if argument n is a %s */
+    uint16_t    str_len;
+} tBTE_TRACE_EVT;
+
+/* conversions in a format string, as counted by bte_trace_scan_fmt() */
+typedef struct
+{
+    uint8_t     nargs;
+    uint8_t     str_mask;
+    uint8_t     inline_only;            /* floating point, or too many arguments */
+} tBTE_TRACE_FMT_INFO;
+
+/* values of bte_trace_ring_mode */
+#define BTE_TRACE_RING_OFF          0       /* LogMsg formats and writes in line */
+#define BTE_TRACE_RING_TEXT         1       /* deferred, formatted to the log */
+#define BTE_TRACE_RING_BINARY       2       /* deferred, binary to bte_trace_ring_file */
+
+#ifndef BTE_TRACE_FILE_FORMAT_ONLY
+
+#include "data_types.h"
+
+extern UINT8 bte_trace_ring_mode;
+extern char  bte_trace_ring_file[256];
+
+/*******************************************************************************
+**
+** Function         bte_trace_scan_fmt
+**
+** Description      Counts the arguments a printf format string consumes, and
+**                  notes which of them are strings.
+**
+** Returns          void
+**
+*******************************************************************************/
+extern void bte_trace_scan_fmt(const char *p_fmt, tBTE_TRACE_FMT_INFO *p_info);
+
+/*******************************************************************************
+**
+** Function         bte_trace_ring_record
+**
+** Description      Stores a trace message in the ring of the calling thread.
+**
+** Returns          TRUE if stored, FALSE if the caller has to write the
+**                  message itself (backend off, no ring left, or a format
+**                  the ring cannot carry).
+**
+*******************************************************************************/
+extern BOOLEAN bte_trace_ring_record(UINT32 trace_set_mask, const char *p_fmt,
+                                     UINT8 nargs, const UINT32 *p_args);
+
+/*******************************************************************************
+**
+** Function         BTE_TraceRingInit
+**
+** Description      Starts the thread draining the rings if the backend is
+**                  enabled in the configuration.
+**
+** Returns          void
+**
+*******************************************************************************/
+extern void BTE_TraceRingInit(void);
+
+/*******************************************************************************
+**
+** Function         BTE_TraceRingShutdown
+**
+** Description      Drains the rings a last time and stops the drain thread.
+**
+** Returns          void
+**
+*******************************************************************************/
+extern void BTE_TraceRingShutdown(void);
+
+#endif  /* BTE_TRACE_FILE_FORMAT_ONLY */
+
+#endif  /* BTE_TRACE_RING_H */
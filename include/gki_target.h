@@ -135,6 +135,13 @@
 #define GKI_DELAY_STOP_SYS_TICK     10
 #endif
 
+/* Drive the GKI timers from a thread that sleeps until the next timer expiration
+ * instead of waking up on every tick. With no per-tick cost TICKS_PER_SEC may be
+ * raised for finer timer resolution. Requires NO_GKI_RUN_RETURN. */
+#ifndef GKI_TICKLESS_TIMER
+#define GKI_TICKLESS_TIMER          FALSE
+#endif
+
 /* Option to guarantee no preemption during timer expiration (most system don't need this) */
 #ifndef GKI_TIMER_LIST_NOPREEMPT
 #define GKI_TIMER_LIST_NOPREEMPT    FALSE
@@ -267,6 +274,19 @@ POOL_ID 9 is a public pool meant for large buffer needs such as SDP_DB
 #define GKI_NUM_TOTAL_BUF_POOLS     10
 #endif
 
+/* Give each GKI task a small private cache of free buffers per fixed pool so that
+ * GKI_getbuf()/GKI_freebuf() only take the GKI lock to refill or drain the cache
+ * in batches. Threads that are not GKI tasks always use the shared free queues. */
+#ifndef GKI_BUF_TASK_CACHE
+#define GKI_BUF_TASK_CACHE          FALSE
+#endif
+
+/* Maximum number of free buffers a task may hold per pool. A pool never lets its
+ * task caches hold more than half of its buffers between them. */
+#ifndef GKI_BUF_TASK_CACHE_SIZE
+#define GKI_BUF_TASK_CACHE_SIZE     8
+#endif
+
 /* The following is intended to be a reserved pool for L2CAP
 Flow control and retransmissions and intentionally kept out
 of order */
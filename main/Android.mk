@@ -16,6 +16,7 @@ LOCAL_SRC_FILES+= \
 	bte_init.c \
 	bte_version.c \
 	bte_logmsg.c \
+	bte_trace_ring.c \
 	bte_conf.c
 
 # BTIF
@@ -29,6 +30,7 @@ LOCAL_SRC_FILES += \
     ../btif/src/btif_av.c \
     ../btif/src/btif_rc.c \
     ../btif/src/btif_media_task.c \
+    ../btif/src/btif_media_clock.c \
     ../btif/src/btif_hh.c \
     ../btif/src/btif_hl.c \
     ../btif/src/btif_sock.c \
@@ -50,7 +52,8 @@ LOCAL_SRC_FILES+= \
     ../btif/co/bta_av_co.c \
     ../btif/co/bta_hh_co.c \
     ../btif/co/bta_hl_co.c \
-    ../btif/co/bta_pan_co.c
+    ../btif/co/bta_pan_co.c \
+    ../btif/co/bta_gattc_co.c
 
 # sbc encoder
 LOCAL_SRC_FILES+= \
@@ -63,6 +66,13 @@ LOCAL_SRC_FILES+= \
 	../embdrv/sbc/encoder/srce/sbc_encoder.c \
 	../embdrv/sbc/encoder/srce/sbc_packing.c \
 
+# sbc decoder
+LOCAL_SRC_FILES+= \
+	../embdrv/sbc/decoder/srce/sbc_dec_bit_alloc.c \
+	../embdrv/sbc/decoder/srce/sbc_dec_coeffs.c \
+	../embdrv/sbc/decoder/srce/sbc_decoder.c \
+	../embdrv/sbc/decoder/srce/sbc_synthesis.c
+
 LOCAL_SRC_FILES+= \
 	../udrv/ulinux/uipc.c
 
@@ -87,6 +97,7 @@ LOCAL_C_INCLUDES+= . \
 	$(LOCAL_PATH)/../hci/include\
 	$(LOCAL_PATH)/../brcm/include \
 	$(LOCAL_PATH)/../embdrv/sbc/encoder/include \
+	$(LOCAL_PATH)/../embdrv/sbc/decoder/include \
 	$(LOCAL_PATH)/../audio_a2dp_hw \
 	$(LOCAL_PATH)/../utils/include \
 	$(bdroid_C_INCLUDES) \
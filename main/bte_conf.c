@@ -35,6 +35,9 @@
 
 #include "bt_target.h"
 #include "bta_api.h"
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+#include "bte_trace_ring.h"
+#endif
 
 /******************************************************************************
 **  Externs
@@ -48,6 +51,10 @@ int device_class_cfg(char *p_conf_name, char *p_conf_value);
 int logging_cfg_onoff(char *p_conf_name, char *p_conf_value);
 int logging_set_filepath(char *p_conf_name, char *p_conf_value);
 int trace_cfg_onoff(char *p_conf_name, char *p_conf_value);
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+int trace_ring_cfg(char *p_conf_name, char *p_conf_value);
+int trace_ring_set_filepath(char *p_conf_name, char *p_conf_value);
+#endif
 
 BD_NAME local_device_default_name = BTM_DEF_LOCAL_NAME;
 DEV_CLASS local_device_default_class = {0x40, 0x02, 0x0C};
@@ -119,6 +126,10 @@ static const conf_entry_t conf_table[] = {
     {"BtSnoopLogOutput", logging_cfg_onoff},
     {"BtSnoopFileName", logging_set_filepath},
     {"TraceConf", trace_cfg_onoff},
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    {"TraceRing", trace_ring_cfg},
+    {"TraceRingFile", trace_ring_set_filepath},
+#endif
     {(const char *) NULL, NULL}
 };
 
@@ -183,6 +194,26 @@ int trace_cfg_onoff(char *p_conf_name, char *p_conf_value)
     return 0;
 }
 
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+int trace_ring_cfg(char *p_conf_name, char *p_conf_value)
+{
+    if (strcmp(p_conf_value, "text") == 0)
+        bte_trace_ring_mode = BTE_TRACE_RING_TEXT;
+    else if (strcmp(p_conf_value, "binary") == 0)
+        bte_trace_ring_mode = BTE_TRACE_RING_BINARY;
+    else
+        bte_trace_ring_mode = BTE_TRACE_RING_OFF;
+    return 0;
+}
+
+int trace_ring_set_filepath(char *p_conf_name, char *p_conf_value)
+{
+    strncpy(bte_trace_ring_file, p_conf_value, sizeof(bte_trace_ring_file) - 1);
+    bte_trace_ring_file[sizeof(bte_trace_ring_file) - 1] = 0;
+    return 0;
+}
+#endif
+
 /*****************************************************************************
 **   CONF INTERFACE FUNCTIONS
 *****************************************************************************/
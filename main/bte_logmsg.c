@@ -32,6 +32,9 @@
 #include "bte.h"
 
 #include "bte_appl.h"
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+#include "bte_trace_ring.h"
+#endif
 
 #if MMI_INCLUDED == TRUE
 #include "mmi.h"
@@ -214,32 +217,21 @@ const char * const bt_layer_tags[] = {
 #endif
 #define DBG_TRACE_DEBUG2( m, p0, p1 ) BT_TRACE_2( TRACE_LAYER_BTM, (TRACE_ORG_APPL|TRACE_TYPE_DEBUG), m, p0, p1 )
 
-void
-LogMsg(UINT32 trace_set_mask, const char *fmt_str, ...)
+/*******************************************************************************
+**
+** Function         bte_log_output
+**
+** Description      Writes a formatted trace message to logcat or stderr.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bte_log_output(UINT32 trace_set_mask, char *buffer)
 {
-	static char buffer[BTE_LOG_BUF_SIZE];
     int trace_layer = TRACE_GET_LAYER(trace_set_mask);
     if (trace_layer >= TRACE_LAYER_MAX_NUM)
         trace_layer = 0;
 
-	va_list ap;
-#if (BTE_ANDROID_INTERNAL_TIMESTAMP==TRUE)
-	struct timeval tv;
-	struct timezone tz;
-	struct tm *tm;
-	time_t t;
-
-	gettimeofday(&tv, &tz);
-	time(&t);
-	tm = localtime(&t);
-
-    sprintf(buffer, "%02d:%02d:%02d.%03d ", tm->tm_hour, tm->tm_min, tm->tm_sec,
-        tv.tv_usec / 1000);
-#endif
-	va_start(ap, fmt_str);
-	vsnprintf(&buffer[MSG_BUFFER_OFFSET], BTE_LOG_MAX_SIZE, fmt_str, ap);
-	va_end(ap);
-
 #if (defined(ANDROID_USE_LOGCAT) && (ANDROID_USE_LOGCAT==TRUE))
 #if (BTE_MAP_TRACE_LEVEL==TRUE)
     switch ( TRACE_GET_TYPE(trace_set_mask) )
@@ -270,6 +262,53 @@ LogMsg(UINT32 trace_set_mask, const char *fmt_str, ...)
 #endif
 }
 
+void
+LogMsg(UINT32 trace_set_mask, const char *fmt_str, ...)
+{
+	static char buffer[BTE_LOG_BUF_SIZE];
+
+	va_list ap;
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    tBTE_TRACE_FMT_INFO info;
+    UINT32 args[BTE_TRACE_MAX_ARGS];
+    UINT8 xx;
+
+    if (bte_trace_ring_mode != BTE_TRACE_RING_OFF)
+    {
+        bte_trace_scan_fmt(fmt_str, &info);
+        if (!info.inline_only)
+        {
+            va_start(ap, fmt_str);
+            for (xx = 0; xx < info.nargs; xx++)
+                args[xx] = va_arg(ap, UINT32);
+            va_end(ap);
+
+            if (bte_trace_ring_record(trace_set_mask, fmt_str, info.nargs, args))
+                return;
+        }
+    }
+#endif
+
+#if (BTE_ANDROID_INTERNAL_TIMESTAMP==TRUE)
+	struct timeval tv;
+	struct timezone tz;
+	struct tm *tm;
+	time_t t;
+
+	gettimeofday(&tv, &tz);
+	time(&t);
+	tm = localtime(&t);
+
+    sprintf(buffer, "%02d:%02d:%02d.%03d ", tm->tm_hour, tm->tm_min, tm->tm_sec,
+        tv.tv_usec / 1000);
+#endif
+	va_start(ap, fmt_str);
+	vsnprintf(&buffer[MSG_BUFFER_OFFSET], BTE_LOG_MAX_SIZE, fmt_str, ap);
+	va_end(ap);
+
+    bte_log_output(trace_set_mask, buffer);
+}
+
 void
 ScrLog(UINT32 trace_set_mask, const char *fmt_str, ...)
 {
@@ -544,6 +583,10 @@ BT_API void BTE_InitTraceLevels( void )
  **
  *********************************************************************************/
 void LogMsg_0(UINT32 trace_set_mask, const char *fmt_str) {
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    if (bte_trace_ring_record(trace_set_mask, fmt_str, 0, NULL))
+        return;
+#endif
     LogMsg(trace_set_mask, fmt_str);
 }
 
@@ -560,7 +603,10 @@ void LogMsg_0(UINT32 trace_set_mask, const char *fmt_str) {
  **
  *********************************************************************************/
 void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {
-
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    if (bte_trace_ring_record(trace_set_mask, fmt_str, 1, &p1))
+        return;
+#endif
     LogMsg(trace_set_mask, fmt_str, p1);
 }
 
@@ -577,6 +623,12 @@ void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {
  **
  *********************************************************************************/
 void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    UINT32 args[2] = { p1, p2 };
+
+    if (bte_trace_ring_record(trace_set_mask, fmt_str, 2, args))
+        return;
+#endif
     LogMsg(trace_set_mask, fmt_str, p1, p2);
 }
 
@@ -594,6 +646,12 @@ void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2)
  *********************************************************************************/
 void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
         UINT32 p3) {
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    UINT32 args[3] = { p1, p2, p3 };
+
+    if (bte_trace_ring_record(trace_set_mask, fmt_str, 3, args))
+        return;
+#endif
     LogMsg(trace_set_mask, fmt_str, p1, p2, p3);
 }
 
@@ -611,6 +669,12 @@ void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
  *********************************************************************************/
 void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
         UINT32 p3, UINT32 p4) {
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    UINT32 args[4] = { p1, p2, p3, p4 };
+
+    if (bte_trace_ring_record(trace_set_mask, fmt_str, 4, args))
+        return;
+#endif
     LogMsg(trace_set_mask, fmt_str, p1, p2, p3, p4);
 }
 
@@ -628,6 +692,12 @@ void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
  *********************************************************************************/
 void LogMsg_5(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
         UINT32 p3, UINT32 p4, UINT32 p5) {
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    UINT32 args[5] = { p1, p2, p3, p4, p5 };
+
+    if (bte_trace_ring_record(trace_set_mask, fmt_str, 5, args))
+        return;
+#endif
     LogMsg(trace_set_mask, fmt_str, p1, p2, p3, p4, p5);
 }
 
@@ -645,5 +715,11 @@ void LogMsg_5(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
  *********************************************************************************/
 void LogMsg_6(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
         UINT32 p3, UINT32 p4, UINT32 p5, UINT32 p6) {
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    UINT32 args[6] = { p1, p2, p3, p4, p5, p6 };
+
+    if (bte_trace_ring_record(trace_set_mask, fmt_str, 6, args))
+        return;
+#endif
     LogMsg(trace_set_mask, fmt_str, p1, p2, p3, p4, p5, p6);
 }
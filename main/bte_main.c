@@ -33,6 +33,9 @@
 #include "bte.h"
 #include "bta_api.h"
 #include "bt_hci_lib.h"
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+#include "bte_trace_ring.h"
+#endif
 
 /*******************************************************************************
 **  Constants & Macros
@@ -129,6 +132,11 @@ void bte_main_boot_entry(void)
 
     bte_load_conf(BTE_STACK_CONF_FILE);
 
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    /* start deferred tracing if enabled in the conf file */
+    BTE_TraceRingInit();
+#endif
+
 #if (BTTRC_INCLUDED == TRUE)
     /* Initialize trace feature */
     BTTRC_TraceInit(MAX_TRACE_RAM_SIZE, &BTE_TraceLogBuf[0], BTTRC_METHOD_RAM);
@@ -146,6 +154,10 @@ void bte_main_boot_entry(void)
 ******************************************************************************/
 void bte_main_shutdown()
 {
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+    BTE_TraceRingShutdown();
+#endif
+
     GKI_shutdown();
 }
 
@@ -0,0 +1,695 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2001-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Deferred trace backend for LogMsg.
+ *
+ *  Each thread that traces gets a ring of fixed size slots it alone writes
+ *  to, so recording takes no lock. A slot is guarded by its sequence number
+ *  like a seqlock: the writer clears it, fills the slot and stores the new
+ *  number, and the drain thread keeps a copy only if the number was the
+ *  expected one before and after copying. A full ring overwrites its oldest
+ *  messages, which keeps the latest history around for a crash; the drain
+ *  thread counts what it missed.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#include "gki.h"
+#include "bte.h"
+#include "bte_trace_ring.h"
+
+#if (BTE_TRACE_RING_INCLUDED == TRUE)
+
+#if ((BTE_TRACE_RING_SLOTS & (BTE_TRACE_RING_SLOTS - 1)) != 0)
+#error BTE_TRACE_RING_SLOTS must be a power of two
+#endif
+
+#define BTE_TRACE_RING_MASK         (BTE_TRACE_RING_SLOTS - 1)
+
+/* space for the %s arguments of a message, filling the slot to 128 bytes */
+#define BTE_TRACE_STR_SIZE          (128 - 32 - 8 * BTE_TRACE_MAX_ARGS)
+
+/* formats already written to the binary file, a power of two */
+#define BTE_TRACE_FMT_TABLE_SIZE    4096
+
+#define BTE_TRACE_MSG_SIZE          1024
+#define BTE_TRACE_WBUF_SIZE         8192
+
+typedef struct
+{
+    uint64_t    seq;                /* message number + 1, 0 while written */
+    uint64_t    ts_ns;
+    uint64_t    fmt;                /* format string pointer */
+    uint32_t    trace_set_mask;
+    uint8_t     nargs;
+    uint8_t     str_mask;
+    uint16_t    str_len;
+    uint64_t    args[BTE_TRACE_MAX_ARGS];
+    char        str[BTE_TRACE_STR_SIZE];
+} tBTE_TRACE_SLOT;
+
+typedef struct
+{
+    tBTE_TRACE_SLOT slot[BTE_TRACE_RING_SLOTS];
+    uint64_t        head;           /* written by the owner thread only */
+    uint64_t        tail;           /* drain side */
+    uint32_t        lost;           /* drain side */
+    uint32_t        tid;
+} tBTE_TRACE_RING;
+
+typedef struct
+{
+    tBTE_TRACE_RING *p_ring[BTE_TRACE_RING_MAX_THREADS];
+    UINT32          num_rings;
+    BOOLEAN         running;
+    BOOLEAN         draining;       /* held by whoever drains, see bte_trace_drain */
+    pthread_t       thread;
+    int             fd;
+    int64_t         realtime_offset_ns;
+
+    /* drain side */
+    tBTE_TRACE_SLOT pending[BTE_TRACE_RING_MAX_THREADS];
+    BOOLEAN         has_pending[BTE_TRACE_RING_MAX_THREADS];
+    uint64_t        fmt_seen[BTE_TRACE_FMT_TABLE_SIZE];
+    UINT32          num_fmt_seen;
+    char            msg[BTE_TRACE_MSG_SIZE];
+    UINT8           wbuf[BTE_TRACE_WBUF_SIZE];
+    UINT32          wbuf_len;
+} tBTE_TRACE_CB;
+
+UINT8 bte_trace_ring_mode = BTE_TRACE_RING_OFF;
+char  bte_trace_ring_file[256] = "/tmp/bt_trace.bin";
+
+static tBTE_TRACE_CB bte_trace_cb;
+
+static __thread tBTE_TRACE_RING *p_bte_trace_ring;
+static __thread BOOLEAN bte_trace_no_ring;
+
+extern void bte_log_output(UINT32 trace_set_mask, char *p_msg);
+
+static const int bte_trace_crash_signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+
+/*******************************************************************************
+**
+** Function         bte_trace_scan_fmt
+**
+** Description      Counts the arguments a printf format string consumes, and
+**                  notes which of them are strings.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bte_trace_scan_fmt(const char *p_fmt, tBTE_TRACE_FMT_INFO *p_info)
+{
+    const char *p = p_fmt;
+
+    p_info->nargs = 0;
+    p_info->str_mask = 0;
+    p_info->inline_only = FALSE;
+
+    while ((p = strchr(p, '%')) != NULL)
+    {
+        p++;
+        if (*p == '%')
+        {
+            p++;
+            continue;
+        }
+
+        /* flags, field width, precision and length modifiers */
+        while (*p != 0 && strchr("-+ #0123456789.*hlLqjzt", *p) != NULL)
+        {
+            if (*p == '*')
+                p_info->nargs++;
+            p++;
+        }
+        if (*p == 0)
+            break;
+
+        if ((p_info->nargs >= BTE_TRACE_MAX_ARGS) || (strchr("eEfFgGaA", *p) != NULL))
+        {
+            p_info->inline_only = TRUE;
+            break;
+        }
+        if (*p == 's')
+            p_info->str_mask |= (uint8_t)(1 << p_info->nargs);
+        p_info->nargs++;
+        p++;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_get_ring
+**
+** Description      Returns the ring of the calling thread, allocating it on
+**                  the first message of the thread.
+**
+** Returns          pointer to the ring, NULL if there are none left
+**
+*******************************************************************************/
+static tBTE_TRACE_RING *bte_trace_get_ring(void)
+{
+    tBTE_TRACE_RING *p_ring = p_bte_trace_ring;
+    UINT32          idx;
+
+    if (p_ring != NULL || bte_trace_no_ring)
+        return p_ring;
+
+    idx = __sync_fetch_and_add(&bte_trace_cb.num_rings, 1);
+    if ((idx >= BTE_TRACE_RING_MAX_THREADS) ||
+        ((p_ring = (tBTE_TRACE_RING *)calloc(1, sizeof(tBTE_TRACE_RING))) == NULL))
+    {
+        bte_trace_no_ring = TRUE;
+        return NULL;
+    }
+
+    p_ring->tid = (uint32_t)syscall(SYS_gettid);
+    __atomic_store_n(&bte_trace_cb.p_ring[idx], p_ring, __ATOMIC_RELEASE);
+
+    p_bte_trace_ring = p_ring;
+    return p_ring;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_ring_record
+**
+** Description      Stores a trace message in the ring of the calling thread.
+**
+** Returns          TRUE if stored, FALSE if the caller has to write the
+**                  message itself (backend off, no ring left, or a format
+**                  the ring cannot carry).
+**
+*******************************************************************************/
+BOOLEAN bte_trace_ring_record(UINT32 trace_set_mask, const char *p_fmt,
+                              UINT8 nargs, const UINT32 *p_args)
+{
+    tBTE_TRACE_RING     *p_ring;
+    tBTE_TRACE_SLOT     *p_slot;
+    tBTE_TRACE_FMT_INFO info;
+    struct timespec     ts;
+    const char          *p_str;
+    uint64_t            seq;
+    size_t              len;
+    uint16_t            off = 0;
+    UINT8               xx;
+
+    if (!__atomic_load_n(&bte_trace_cb.running, __ATOMIC_ACQUIRE) || (p_ring = bte_trace_get_ring()) == NULL)
+        return FALSE;
+
+    if (nargs > BTE_TRACE_MAX_ARGS)
+        nargs = BTE_TRACE_MAX_ARGS;
+
+    bte_trace_scan_fmt(p_fmt, &info);
+    if (info.inline_only)
+        return FALSE;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    seq = p_ring->head;
+    p_slot = &p_ring->slot[seq & BTE_TRACE_RING_MASK];
+
+    __atomic_store_n(&p_slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    p_slot->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    p_slot->fmt = (uintptr_t)p_fmt;
+    p_slot->trace_set_mask = (uint32_t)trace_set_mask;
+    p_slot->nargs = nargs;
+    p_slot->str_mask = info.str_mask & (uint8_t)((1 << nargs) - 1);
+
+    for (xx = 0; xx < nargs; xx++)
+    {
+        if ((p_slot->str_mask & (1 << xx)) == 0)
+        {
+            p_slot->args[xx] = p_args[xx];
+        }
+        else if ((p_str = (const char *)p_args[xx]) == NULL)
+        {
+            p_slot->args[xx] = BTE_TRACE_STR_NULL;
+        }
+        else
+        {
+            /* copy, truncated to what is left; the last byte is always a NUL */
+            len = strnlen(p_str, BTE_TRACE_STR_SIZE - 1 - off);
+            memcpy(&p_slot->str[off], p_str, len);
+            p_slot->str[off + len] = 0;
+            p_slot->args[xx] = off;
+
+            off += len + 1;
+            if (off > BTE_TRACE_STR_SIZE - 1)
+                off = BTE_TRACE_STR_SIZE - 1;
+        }
+    }
+    if (off == BTE_TRACE_STR_SIZE - 1)
+    {
+        p_slot->str[off] = 0;
+        off = BTE_TRACE_STR_SIZE;
+    }
+    p_slot->str_len = off;
+
+    __atomic_store_n(&p_slot->seq, seq + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&p_ring->head, seq + 1, __ATOMIC_RELEASE);
+
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_fetch
+**
+** Description      Copies the next message of a ring, up to head, skipping
+**                  those overwritten before or while being copied.
+**
+** Returns          TRUE if a message was copied
+**
+*******************************************************************************/
+static BOOLEAN bte_trace_fetch(tBTE_TRACE_RING *p_ring, uint64_t head, tBTE_TRACE_SLOT *p_out)
+{
+    tBTE_TRACE_SLOT *p_slot;
+    uint64_t        seq1, seq2;
+
+    if (head - p_ring->tail > BTE_TRACE_RING_SLOTS)
+    {
+        p_ring->lost += (uint32_t)(head - BTE_TRACE_RING_SLOTS - p_ring->tail);
+        p_ring->tail = head - BTE_TRACE_RING_SLOTS;
+    }
+
+    while (p_ring->tail < head)
+    {
+        p_slot = &p_ring->slot[p_ring->tail & BTE_TRACE_RING_MASK];
+
+        seq1 = __atomic_load_n(&p_slot->seq, __ATOMIC_ACQUIRE);
+        memcpy(p_out, p_slot, sizeof(tBTE_TRACE_SLOT));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n(&p_slot->seq, __ATOMIC_RELAXED);
+
+        p_ring->tail++;
+        if ((seq1 == p_ring->tail) && (seq2 == seq1))
+            return TRUE;
+
+        p_ring->lost++;
+    }
+    return FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_flush_wbuf
+**
+** Description      Writes out what has been put in the binary write buffer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_flush_wbuf(void)
+{
+    UINT8   *p = bte_trace_cb.wbuf;
+    ssize_t ret;
+
+    while (bte_trace_cb.wbuf_len > 0)
+    {
+        if ((ret = write(bte_trace_cb.fd, p, bte_trace_cb.wbuf_len)) <= 0)
+            break;
+        p += ret;
+        bte_trace_cb.wbuf_len -= ret;
+    }
+    bte_trace_cb.wbuf_len = 0;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_put
+**
+** Description      Appends a part of a record to the binary write buffer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_put(const void *p_data, UINT32 len)
+{
+    if (bte_trace_cb.wbuf_len + len > BTE_TRACE_WBUF_SIZE)
+        bte_trace_flush_wbuf();
+
+    memcpy(&bte_trace_cb.wbuf[bte_trace_cb.wbuf_len], p_data, len);
+    bte_trace_cb.wbuf_len += len;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_put_fmt
+**
+** Description      Writes a format string record to the binary file unless
+**                  it has been written already.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_put_fmt(uint64_t fmt)
+{
+    tBTE_TRACE_REC_HDR  hdr;
+    const char          *p_fmt = (const char *)(uintptr_t)fmt;
+    UINT32              slot = (UINT32)(((fmt >> 3) * 2654435761U) & (BTE_TRACE_FMT_TABLE_SIZE - 1));
+    size_t              len;
+
+    while (bte_trace_cb.fmt_seen[slot] != 0)
+    {
+        if (bte_trace_cb.fmt_seen[slot] == fmt)
+            return;
+        slot = (slot + 1) & (BTE_TRACE_FMT_TABLE_SIZE - 1);
+    }
+
+    /* keep the table at most three quarters full; past that, formats are
+    ** written again with every message */
+    if (bte_trace_cb.num_fmt_seen < (BTE_TRACE_FMT_TABLE_SIZE / 4) * 3)
+    {
+        bte_trace_cb.fmt_seen[slot] = fmt;
+        bte_trace_cb.num_fmt_seen++;
+    }
+
+    len = strnlen(p_fmt, BTE_TRACE_MSG_SIZE);
+    hdr.type = BTE_TRACE_REC_FMT;
+    hdr.len = (uint16_t)(sizeof(hdr) + sizeof(fmt) + len);
+    bte_trace_put(&hdr, sizeof(hdr));
+    bte_trace_put(&fmt, sizeof(fmt));
+    bte_trace_put(p_fmt, len);
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_emit
+**
+** Description      Writes out one message, formatted to the log or as a
+**                  binary record.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_emit(uint32_t tid, tBTE_TRACE_SLOT *p_slot)
+{
+    tBTE_TRACE_REC_HDR  hdr;
+    tBTE_TRACE_EVT      evt;
+    UINT32              a[BTE_TRACE_MAX_ARGS];
+    struct tm           tm;
+    time_t              t;
+    int64_t             real_ns;
+    int                 len;
+    UINT8               xx;
+
+    if (bte_trace_cb.fd >= 0)
+    {
+        bte_trace_put_fmt(p_slot->fmt);
+
+        memset(&evt, 0, sizeof(evt));
+        evt.ts_ns = p_slot->ts_ns;
+        evt.fmt_id = p_slot->fmt;
+        evt.trace_set_mask = p_slot->trace_set_mask;
+        evt.tid = tid;
+        evt.nargs = p_slot->nargs;
+        evt.str_mask = p_slot->str_mask;
+        evt.str_len = p_slot->str_len;
+
+        hdr.type = BTE_TRACE_REC_EVT;
+        hdr.len = (uint16_t)(sizeof(hdr) + sizeof(evt) + 8 * evt.nargs + evt.str_len);
+        bte_trace_put(&hdr, sizeof(hdr));
+        bte_trace_put(&evt, sizeof(evt));
+        bte_trace_put(p_slot->args, 8 * evt.nargs);
+        bte_trace_put(p_slot->str, evt.str_len);
+        return;
+    }
+
+    memset(a, 0, sizeof(a));
+    for (xx = 0; xx < p_slot->nargs; xx++)
+    {
+        if ((p_slot->str_mask & (1 << xx)) == 0)
+            a[xx] = (UINT32)p_slot->args[xx];
+        else if (p_slot->args[xx] != BTE_TRACE_STR_NULL)
+            a[xx] = (UINT32)(uintptr_t)&p_slot->str[p_slot->args[xx]];
+    }
+
+    real_ns = (int64_t)p_slot->ts_ns + bte_trace_cb.realtime_offset_ns;
+    t = (time_t)(real_ns / 1000000000LL);
+    localtime_r(&t, &tm);
+
+    len = snprintf(bte_trace_cb.msg, BTE_TRACE_MSG_SIZE, "%02d:%02d:%02d.%03d ",
+                   tm.tm_hour, tm.tm_min, tm.tm_sec, (int)((real_ns / 1000000LL) % 1000));
+    snprintf(&bte_trace_cb.msg[len], BTE_TRACE_MSG_SIZE - len, (const char *)(uintptr_t)p_slot->fmt,
+             a[0], a[1], a[2], a[3], a[4], a[5]);
+
+    bte_log_output(p_slot->trace_set_mask, bte_trace_cb.msg);
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_emit_lost
+**
+** Description      Reports the messages of a thread that were overwritten
+**                  before they could be drained.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_emit_lost(uint32_t tid, uint32_t lost)
+{
+    tBTE_TRACE_REC_HDR  hdr;
+
+    if (bte_trace_cb.fd >= 0)
+    {
+        hdr.type = BTE_TRACE_REC_LOST;
+        hdr.len = (uint16_t)(sizeof(hdr) + sizeof(tid) + sizeof(lost));
+        bte_trace_put(&hdr, sizeof(hdr));
+        bte_trace_put(&tid, sizeof(tid));
+        bte_trace_put(&lost, sizeof(lost));
+        return;
+    }
+
+    snprintf(bte_trace_cb.msg, BTE_TRACE_MSG_SIZE, "[bttrc] %u messages of thread %u lost",
+             (unsigned)lost, (unsigned)tid);
+    bte_log_output(TRACE_CTRL_GENERAL | TRACE_LAYER_NONE | TRACE_ORG_GKI | TRACE_TYPE_WARNING,
+                   bte_trace_cb.msg);
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_drain
+**
+** Description      Writes out all the messages in the rings, merged in time
+**                  order. The drain side state is used by one caller at a
+**                  time: if the drain thread, or a crash handler that
+**                  interrupted it, is draining already, this one skips.
+**
+** Returns          FALSE if skipped
+**
+*******************************************************************************/
+static BOOLEAN bte_trace_drain(void)
+{
+    tBTE_TRACE_RING *p_ring;
+    uint64_t        head[BTE_TRACE_RING_MAX_THREADS];
+    UINT32          num_rings = __atomic_load_n(&bte_trace_cb.num_rings, __ATOMIC_ACQUIRE);
+    UINT32          xx;
+    int             best;
+
+    if (__atomic_exchange_n(&bte_trace_cb.draining, TRUE, __ATOMIC_ACQUIRE))
+        return FALSE;
+
+    if (num_rings > BTE_TRACE_RING_MAX_THREADS)
+        num_rings = BTE_TRACE_RING_MAX_THREADS;
+
+    for (xx = 0; xx < num_rings; xx++)
+    {
+        bte_trace_cb.has_pending[xx] = FALSE;
+        if ((p_ring = __atomic_load_n(&bte_trace_cb.p_ring[xx], __ATOMIC_ACQUIRE)) == NULL)
+            continue;
+
+        head[xx] = __atomic_load_n(&p_ring->head, __ATOMIC_ACQUIRE);
+        bte_trace_cb.has_pending[xx] = bte_trace_fetch(p_ring, head[xx], &bte_trace_cb.pending[xx]);
+    }
+
+    while (TRUE)
+    {
+        best = -1;
+        for (xx = 0; xx < num_rings; xx++)
+        {
+            if (bte_trace_cb.has_pending[xx] &&
+                ((best < 0) || (bte_trace_cb.pending[xx].ts_ns < bte_trace_cb.pending[best].ts_ns)))
+                best = (int)xx;
+        }
+        if (best < 0)
+            break;
+
+        p_ring = bte_trace_cb.p_ring[best];
+        bte_trace_emit(p_ring->tid, &bte_trace_cb.pending[best]);
+        bte_trace_cb.has_pending[best] = bte_trace_fetch(p_ring, head[best], &bte_trace_cb.pending[best]);
+    }
+
+    for (xx = 0; xx < num_rings; xx++)
+    {
+        if ((p_ring = bte_trace_cb.p_ring[xx]) != NULL && p_ring->lost != 0)
+        {
+            bte_trace_emit_lost(p_ring->tid, p_ring->lost);
+            p_ring->lost = 0;
+        }
+    }
+
+    if (bte_trace_cb.fd >= 0)
+        bte_trace_flush_wbuf();
+
+    __atomic_store_n(&bte_trace_cb.draining, FALSE, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_drain_thread
+**
+** Description      Drains the rings every BTE_TRACE_RING_FLUSH_MS.
+**
+** Returns          NULL
+**
+*******************************************************************************/
+static void *bte_trace_drain_thread(void *arg)
+{
+    while (__atomic_load_n(&bte_trace_cb.running, __ATOMIC_ACQUIRE))
+    {
+        usleep(BTE_TRACE_RING_FLUSH_MS * 1000);
+        bte_trace_drain();
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         bte_trace_crash_handler
+**
+** Description      Writes the history left in the rings to the binary file
+**                  on a fatal signal, then lets the signal take its course.
+**                  The binary path only copies and calls write(). Nothing
+**                  is written if the signal hit a drain in progress, whose
+**                  state cannot be trusted, in this thread or another.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bte_trace_crash_handler(int sig)
+{
+    bte_trace_drain();
+    raise(sig);
+}
+
+/*******************************************************************************
+**
+** Function         BTE_TraceRingInit
+**
+** Description      Starts the thread draining the rings if the backend is
+**                  enabled in the configuration.
+**
+** Returns          void
+**
+*******************************************************************************/
+void BTE_TraceRingInit(void)
+{
+    tBTE_TRACE_FILE_HDR hdr;
+    struct sigaction    sa;
+    struct timespec     mono, real;
+    UINT32              xx;
+
+    if (bte_trace_ring_mode == BTE_TRACE_RING_OFF || bte_trace_cb.running)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    bte_trace_cb.realtime_offset_ns = ((int64_t)real.tv_sec - mono.tv_sec) * 1000000000LL +
+                                      (real.tv_nsec - mono.tv_nsec);
+    bte_trace_cb.fd = -1;
+
+    if (bte_trace_ring_mode == BTE_TRACE_RING_BINARY)
+    {
+        if ((bte_trace_cb.fd = open(bte_trace_ring_file, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        {
+            APPL_TRACE_ERROR1("[bttrc] cannot open %s, tracing as text", bte_trace_ring_file);
+        }
+        else
+        {
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.magic = BTE_TRACE_FILE_MAGIC;
+            hdr.version = BTE_TRACE_FILE_VERSION;
+            hdr.hdr_len = sizeof(hdr);
+            hdr.realtime_offset_ns = bte_trace_cb.realtime_offset_ns;
+            bte_trace_put(&hdr, sizeof(hdr));
+            bte_trace_flush_wbuf();
+
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = bte_trace_crash_handler;
+            sa.sa_flags = SA_RESETHAND;
+            sigemptyset(&sa.sa_mask);
+            for (xx = 0; xx < sizeof(bte_trace_crash_signals) / sizeof(bte_trace_crash_signals[0]); xx++)
+                sigaction(bte_trace_crash_signals[xx], &sa, NULL);
+        }
+    }
+
+    __atomic_store_n(&bte_trace_cb.running, TRUE, __ATOMIC_RELEASE);
+    if (pthread_create(&bte_trace_cb.thread, NULL, bte_trace_drain_thread, NULL) != 0)
+    {
+        __atomic_store_n(&bte_trace_cb.running, FALSE, __ATOMIC_RELEASE);
+        APPL_TRACE_ERROR0("[bttrc] cannot start the drain thread, tracing in line");
+    }
+}
+
+/*******************************************************************************
+**
+** Function         BTE_TraceRingShutdown
+**
+** Description      Drains the rings a last time and stops the drain thread.
+**
+** Returns          void
+**
+*******************************************************************************/
+void BTE_TraceRingShutdown(void)
+{
+    UINT32  xx;
+
+    if (!bte_trace_cb.running)
+        return;
+
+    __atomic_store_n(&bte_trace_cb.running, FALSE, __ATOMIC_RELEASE);
+    pthread_join(bte_trace_cb.thread, NULL);
+    bte_trace_drain();
+
+    if (bte_trace_cb.fd >= 0)
+    {
+        for (xx = 0; xx < sizeof(bte_trace_crash_signals) / sizeof(bte_trace_crash_signals[0]); xx++)
+            signal(bte_trace_crash_signals[xx], SIG_DFL);
+
+        close(bte_trace_cb.fd);
+        bte_trace_cb.fd = -1;
+    }
+}
+
+#endif  /* BTE_TRACE_RING_INCLUDED */
@@ -87,7 +87,8 @@ BOOLEAN BTM_SecAddBleDevice (BD_ADDR bd_addr, BD_NAME bd_name, tBT_DEVICE_TYPE d
                 memset (p_dev_rec, 0, sizeof (tBTM_SEC_DEV_REC));
                 p_dev_rec->sec_flags = BTM_SEC_IN_USE;
                 memcpy (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN);
-                p_dev_rec->hci_handle = BTM_GetHCIConnHandle (bd_addr);
+                btm_sec_dev_index_add (p_dev_rec);
+                btm_sec_set_dev_handle (p_dev_rec, BTM_GetHCIConnHandle (bd_addr));
 
                 /* update conn params, use default value for background connection params */
                 p_dev_rec->conn_params.min_conn_int     =
@@ -779,6 +780,9 @@ void btm_sec_save_le_key(BD_ADDR bd_addr, tBTM_LE_KEY_TYPE key_type, tBTM_LE_KEY
                 memcpy(p_rec->ble.keys.irk, p_keys->pid_key, BT_OCTET16_LEN);
                 p_rec->ble.key_type |= BTM_LE_KEY_PID;
                 BTM_TRACE_DEBUG1("BTM_LE_KEY_PID key_type=0x%x save peer IRK",  p_rec->ble.key_type);
+#if SMP_INCLUDED == TRUE
+                btm_ble_irk_changed();
+#endif
                 break;
 
             case BTM_LE_KEY_PCSRK:
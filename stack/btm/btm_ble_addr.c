@@ -196,148 +196,248 @@ void btm_gen_non_resolvable_private_addr (void)
 *******************************************************************************/
 /*******************************************************************************
 **
-** Function         btm_ble_resolve_address_cmpl
+** Function         btm_ble_rpa_hash
 **
-** Description      This function sends the random address resolving complete
-**                  callback.
+** Description      This function returns the home slot of a private address
+**                  in the RPA cache. The low 3 bytes of a resolvable private
+**                  address are a hash already.
 **
-** Returns          None.
+** Returns          slot index
 **
 *******************************************************************************/
-static void btm_ble_resolve_address_cmpl(void)
+static UINT16 btm_ble_rpa_hash(BD_ADDR rpa)
+{
+    UINT32 h = ((UINT32)rpa[3] << 16) | ((UINT32)rpa[4] << 8) | rpa[5];
+
+    return (UINT16)((h ^ rpa[2]) & (BTM_BLE_RPA_CACHE_SIZE - 1));
+}
+
+/*******************************************************************************
+**
+** Function         btm_ble_rpa_cache_find
+**
+** Description      This function looks up a private address resolved less
+**                  than BTM_BLE_RPA_CACHE_TTL seconds ago.
+**
+** Returns          pointer to the cache entry, NULL if not found.
+**
+*******************************************************************************/
+static tBTM_BLE_RPA_ENTRY *btm_ble_rpa_cache_find(BD_ADDR rpa)
 {
     tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
-    tBTM_SEC_DEV_REC    *p_dev_rec = NULL;
+    tBTM_BLE_RPA_ENTRY  *p_ent;
+    UINT32              now = GKI_get_tick_count();
+    UINT16              slot = btm_ble_rpa_hash(rpa);
+    UINT16              xx;
 
-    BTM_TRACE_EVENT0 ("btm_ble_resolve_address_cmpl");
-    if (p_mgnt_cb->index < BTM_SEC_MAX_DEVICE_RECORDS)
-        p_dev_rec = &btm_cb.sec_dev_rec[p_mgnt_cb->index];
+    for (xx = 0; xx < BTM_BLE_RPA_CACHE_PROBE; xx++)
+    {
+        p_ent = &p_mgnt_cb->rpa_cache[(slot + xx) & (BTM_BLE_RPA_CACHE_SIZE - 1)];
 
-    p_mgnt_cb->busy = FALSE;
+        if (p_ent->in_use && !memcmp(p_ent->rpa, rpa, BD_ADDR_LEN))
+        {
+            if ((now - p_ent->add_tick) < GKI_SECS_TO_TICKS(BTM_BLE_RPA_CACHE_TTL))
+                return p_ent;
 
-    (* p_mgnt_cb->p_resolve_cback)(p_dev_rec, p_mgnt_cb->p);
+            p_ent->in_use = FALSE;
+            return NULL;
+        }
+    }
+    return NULL;
 }
+
 /*******************************************************************************
 **
-** Function         btm_ble_proc_resolve_x
+** Function         btm_ble_rpa_cache_add
 **
-** Description      This function compares the X with random address 3 MSO bytes
-**                  to find a match, if not match, continue for next record.
+** Description      This function remembers what a private address resolved
+**                  to. It takes a free or expired slot among those probed for
+**                  the address, else the oldest one.
 **
-** Returns          None.
+** Returns          void
 **
 *******************************************************************************/
-static BOOLEAN btm_ble_proc_resolve_x(tSMP_ENC *p)
+static void btm_ble_rpa_cache_add(BD_ADDR rpa, UINT16 rec_index)
 {
     tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
-    UINT8    comp[3];
-    BTM_TRACE_EVENT0 ("btm_ble_proc_resolve_x");
-    /* compare the hash with 3 LSB of bd address */
-    comp[0] = p_mgnt_cb->random_bda[5];
-    comp[1] = p_mgnt_cb->random_bda[4];
-    comp[2] = p_mgnt_cb->random_bda[3];
+    tBTM_BLE_RPA_ENTRY  *p_ent, *p_oldest = NULL;
+    UINT32              now = GKI_get_tick_count();
+    UINT16              slot = btm_ble_rpa_hash(rpa);
+    UINT16              xx;
 
-    if (p && p->param_buf)
+    for (xx = 0; xx < BTM_BLE_RPA_CACHE_PROBE; xx++)
     {
-        if (!memcmp(p->param_buf, &comp[0], 3))
+        p_ent = &p_mgnt_cb->rpa_cache[(slot + xx) & (BTM_BLE_RPA_CACHE_SIZE - 1)];
+
+        if (!p_ent->in_use ||
+            (now - p_ent->add_tick) >= GKI_SECS_TO_TICKS(BTM_BLE_RPA_CACHE_TTL))
         {
-            /* match is found */
-            BTM_TRACE_EVENT0 ("match is found");
-            btm_ble_resolve_address_cmpl();
-            return TRUE;
+            p_oldest = p_ent;
+            break;
         }
+        if (p_oldest == NULL || (now - p_ent->add_tick) > (now - p_oldest->add_tick))
+            p_oldest = p_ent;
     }
-    return FALSE;
+
+    memcpy(p_oldest->rpa, rpa, BD_ADDR_LEN);
+    p_oldest->rec_index = rec_index;
+    p_oldest->add_tick = now;
+    p_oldest->in_use = TRUE;
 }
+
 /*******************************************************************************
 **
-** Function         btm_ble_match_random_bda
+** Function         btm_ble_irk_changed
 **
-** Description      This function match the random address to the appointed device
-**                  record, starting from calculating IRK. If record index exceed
-**                  the maximum record number, matching failed and send callback.
+** Description      This function is called when a peer IRK is stored. The
+**                  IRK table is rebuilt on next use, and the private addresses
+**                  resolved so far are forgotten since some that did not
+**                  resolve may now.
 **
-** Returns          None.
+** Returns          void
 **
 *******************************************************************************/
-static BOOLEAN btm_ble_match_random_bda(UINT16 rec_index)
+void btm_ble_irk_changed(void)
 {
-#if (BLE_INCLUDED == TRUE && SMP_INCLUDED == TRUE)
-    tBTM_SEC_DEV_REC    *p_dev_rec;
     tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
-    UINT8       rand[3];
-    tSMP_ENC    output;
 
-    /* use the 3 MSB of bd address as prand */
-    rand[0] = p_mgnt_cb->random_bda[2];
-    rand[1] = p_mgnt_cb->random_bda[1];
-    rand[2] = p_mgnt_cb->random_bda[0];
+    BTM_TRACE_EVENT0 ("btm_ble_irk_changed");
 
-    BTM_TRACE_EVENT1("btm_ble_match_random_bda rec_index = %d", rec_index);
+    p_mgnt_cb->irk_tbl_valid = FALSE;
+    memset(p_mgnt_cb->rpa_cache, 0, sizeof(p_mgnt_cb->rpa_cache));
+}
 
-    if (rec_index < BTM_SEC_MAX_DEVICE_RECORDS)
-    {
-        p_dev_rec = &btm_cb.sec_dev_rec[rec_index];
+/*******************************************************************************
+**
+** Function         btm_ble_build_irk_table
+**
+** Description      This function collects the IRKs of all security records
+**                  into a contiguous table of expanded keys.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_ble_build_irk_table(void)
+{
+    tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
+    tBTM_SEC_DEV_REC    *p_dev_rec = &btm_cb.sec_dev_rec[0];
+    UINT16              xx;
 
-        BTM_TRACE_ERROR2("sec_flags = %02x device_type = %d", p_dev_rec->sec_flags, p_dev_rec->device_type);
+    p_mgnt_cb->num_irk = 0;
 
-        if ((p_dev_rec->device_type == BT_DEVICE_TYPE_BLE) &&
+    for (xx = 0; xx < BTM_SEC_MAX_DEVICE_RECORDS; xx++, p_dev_rec++)
+    {
+        if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE) &&
             (p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
         {
-            /* generate X = E irk(R0, R1, R2) and R is random address 3 LSO */
-            SMP_Encrypt(p_dev_rec->ble.keys.irk, BT_OCTET16_LEN,
-                        &rand[0], 3, &output);
-            return btm_ble_proc_resolve_x(&output);
-        }
-        else
-        {
-            // not completed
-            return FALSE;
+            SMP_AesSetKey(p_dev_rec->ble.keys.irk, &p_mgnt_cb->irk_ks[p_mgnt_cb->num_irk]);
+            p_mgnt_cb->irk_rec_index[p_mgnt_cb->num_irk++] = xx;
         }
     }
-    else /* no  match found */
+
+    p_mgnt_cb->irk_tbl_valid = TRUE;
+
+    BTM_TRACE_DEBUG1 ("btm_ble_build_irk_table num_irk = %d", p_mgnt_cb->num_irk);
+}
+
+/*******************************************************************************
+**
+** Function         btm_ble_rec_has_irk
+**
+** Description      This function checks that a security record is still that
+**                  of a bonded LE device with an IRK.
+**
+** Returns          TRUE if the record can be matched to a private address.
+**
+*******************************************************************************/
+static BOOLEAN btm_ble_rec_has_irk(UINT16 rec_index)
+{
+    tBTM_SEC_DEV_REC    *p_dev_rec = &btm_cb.sec_dev_rec[rec_index];
+
+    return ((p_dev_rec->sec_flags & BTM_SEC_IN_USE) &&
+            (p_dev_rec->device_type == BT_DEVICE_TYPE_BLE) &&
+            (p_dev_rec->ble.key_type & BTM_LE_KEY_PID));
+}
+
+/*******************************************************************************
+**
+** Function         btm_ble_match_random_bda
+**
+** Description      This function matches the random address against the IRKs
+**                  of all bonded devices in one pass.
+**
+** Returns          index of the matching record, BTM_SEC_MAX_DEVICE_RECORDS
+**                  if none.
+**
+*******************************************************************************/
+static UINT16 btm_ble_match_random_bda(BD_ADDR random_bda)
+{
+    tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
+    UINT16              xx = 0;
+
+    if (!p_mgnt_cb->irk_tbl_valid)
+        btm_ble_build_irk_table();
+
+    while (xx < p_mgnt_cb->num_irk)
     {
-        btm_ble_resolve_address_cmpl();
-        return TRUE;
+        xx += SMP_MatchRpa(random_bda, &p_mgnt_cb->irk_ks[xx], (UINT16)(p_mgnt_cb->num_irk - xx));
+
+        if (xx < p_mgnt_cb->num_irk)
+        {
+            if (btm_ble_rec_has_irk(p_mgnt_cb->irk_rec_index[xx]))
+            {
+                BTM_TRACE_EVENT1 ("match is found, rec_index = %d", p_mgnt_cb->irk_rec_index[xx]);
+                return p_mgnt_cb->irk_rec_index[xx];
+            }
+            xx++;
+        }
     }
-#endif
+
+    return BTM_SEC_MAX_DEVICE_RECORDS;
 }
 
 /*******************************************************************************
 **
 ** Function         btm_ble_resolve_random_addr
 **
-** Description      This function is called to resolve a random address.
+** Description      This function is called to resolve a random address. The
+**                  callback is called before returning, with the security
+**                  record of the device the address belongs to, or NULL.
 **
-** Returns          pointer to the security record of the device whom a random
-**                  address is matched to.
+** Returns          void
 **
 *******************************************************************************/
 void btm_ble_resolve_random_addr(BD_ADDR random_bda, tBTM_BLE_RESOLVE_CBACK * p_cback, void *p)
 {
-    tBTM_LE_RANDOM_CB   *p_mgnt_cb = &btm_cb.ble_ctr_cb.addr_mgnt_cb;
+    tBTM_BLE_RPA_ENTRY  *p_ent;
+    tBTM_SEC_DEV_REC    *p_dev_rec = NULL;
+    UINT16              rec_index;
 
     BTM_TRACE_EVENT0 ("btm_ble_resolve_random_addr");
-    if ( !p_mgnt_cb->busy)
+
+    if ((p_ent = btm_ble_rpa_cache_find(random_bda)) != NULL &&
+        (p_ent->rec_index == BTM_SEC_MAX_DEVICE_RECORDS || btm_ble_rec_has_irk(p_ent->rec_index)))
+    {
+        rec_index = p_ent->rec_index;
+    }
+    else
     {
-        p_mgnt_cb->p = p;
-        p_mgnt_cb->busy = TRUE;
-        p_mgnt_cb->index = 0;
-        p_mgnt_cb->p_resolve_cback = p_cback;
-        memcpy(p_mgnt_cb->random_bda, random_bda, BD_ADDR_LEN);
-        /* start to resolve random address */
-        /* check for next security record */
-        while (TRUE)
+        rec_index = btm_ble_match_random_bda(random_bda);
+
+        /* the record the address was resolved to is gone, resolve again */
+        if (p_ent != NULL)
         {
-            if (btm_ble_match_random_bda(p_mgnt_cb->index++))
-            {
-                // match found or went through the list
-                break;
-            }
+            p_ent->rec_index = rec_index;
+            p_ent->add_tick = GKI_get_tick_count();
         }
+        else
+            btm_ble_rpa_cache_add(random_bda, rec_index);
     }
-    else
-        (*p_cback)(NULL, p);
+
+    if (rec_index < BTM_SEC_MAX_DEVICE_RECORDS)
+        p_dev_rec = &btm_cb.sec_dev_rec[rec_index];
+
+    (*p_cback)(p_dev_rec, p);
 }
     #endif
 /*******************************************************************************
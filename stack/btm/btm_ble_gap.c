@@ -1976,7 +1976,7 @@ void btm_ble_connected (UINT8 *bda, UINT16 handle, UINT8 enc_mode, UINT8 role)
     }
 
     p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
-    p_dev_rec->hci_handle = handle;
+    btm_sec_set_dev_handle (p_dev_rec, handle);
     if (role == HCI_ROLE_MASTER)
         p_dev_rec->role_master = TRUE;
 
@@ -149,16 +149,38 @@ typedef struct
 /* random address resolving complete callback */
 typedef void (tBTM_BLE_RESOLVE_CBACK) (void * match_rec, void *p);
 
+#if ((BTM_BLE_RPA_CACHE_SIZE & (BTM_BLE_RPA_CACHE_SIZE - 1)) != 0)
+#error BTM_BLE_RPA_CACHE_SIZE must be a power of two
+#endif
+
+/* number of slots probed for a private address in the RPA cache */
+#define BTM_BLE_RPA_CACHE_PROBE     4
+
+/* resolvable private address cache entry */
+typedef struct
+{
+    BD_ADDR                     rpa;
+    BOOLEAN                     in_use;
+    UINT16                      rec_index;  /* BTM_SEC_MAX_DEVICE_RECORDS if unresolved */
+    UINT32                      add_tick;
+} tBTM_BLE_RPA_ENTRY;
+
 /* random address management control block */
 typedef struct
 {
     BD_ADDR			            private_addr;
-    BD_ADDR                     random_bda;
-    BOOLEAN                     busy;
-    UINT16                       index;
-    tBTM_BLE_RESOLVE_CBACK      *p_resolve_cback;
-    void                        *p;
     TIMER_LIST_ENT              raddr_timer_ent;
+
+#if SMP_INCLUDED == TRUE
+    /* private addresses seen recently, hashed on the address */
+    tBTM_BLE_RPA_ENTRY          rpa_cache[BTM_BLE_RPA_CACHE_SIZE];
+
+    /* IRKs of the bonded devices, expanded, with their record index */
+    BOOLEAN                     irk_tbl_valid;
+    UINT16                      num_irk;
+    UINT16                      irk_rec_index[BTM_SEC_MAX_DEVICE_RECORDS];
+    tSMP_AES_KEY                irk_ks[BTM_SEC_MAX_DEVICE_RECORDS];
+#endif
 } tBTM_LE_RANDOM_CB;
 
 #define BTM_BLE_MAX_BG_CONN_DEV_NUM    10
@@ -284,6 +306,7 @@ extern tBLE_ADDR_TYPE btm_ble_map_bda_to_conn_bda(BD_ADDR bda);
 extern void btm_gen_resolvable_private_addr (void);
 extern void btm_gen_non_resolvable_private_addr (void);
 extern void btm_ble_resolve_random_addr(BD_ADDR random_bda, tBTM_BLE_RESOLVE_CBACK * p_cback, void *p);
+extern void btm_ble_irk_changed(void);
 
 #if BTM_BLE_CONFORMANCE_TESTING == TRUE
 BT_API extern void btm_ble_set_no_disc_if_pair_fail (BOOLEAN disble_disc);
@@ -36,6 +36,7 @@
 #include "hcidefs.h"
 #include "l2c_api.h"
 static tBTM_SEC_DEV_REC *btm_find_oldest_dev (void);
+static void btm_sec_dev_index_remove (tBTM_SEC_DEV_REC *p_dev_rec);
 
 /*******************************************************************************
 **
@@ -78,7 +79,8 @@ BOOLEAN BTM_SecAddDevice (BD_ADDR bd_addr, DEV_CLASS dev_class, BD_NAME bd_name,
                 memset (p_dev_rec, 0, sizeof (tBTM_SEC_DEV_REC));
                 p_dev_rec->sec_flags = BTM_SEC_IN_USE;
                 memcpy (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN);
-                p_dev_rec->hci_handle = BTM_GetHCIConnHandle (bd_addr);
+                btm_sec_dev_index_add (p_dev_rec);
+                btm_sec_set_dev_handle (p_dev_rec, BTM_GetHCIConnHandle (bd_addr));
 
 #if BLE_INCLUDED == TRUE
                 /* use default value for background connection params */
@@ -213,7 +215,10 @@ tBTM_SEC_DEV_REC *btm_sec_alloc_dev (BD_ADDR bd_addr)
     }
 
     if (!p_dev_rec)
+    {
         p_dev_rec = btm_find_oldest_dev();
+        btm_sec_dev_index_remove (p_dev_rec);
+    }
 
     memset (p_dev_rec, 0, sizeof (tBTM_SEC_DEV_REC));
 
@@ -255,8 +260,9 @@ tBTM_SEC_DEV_REC *btm_sec_alloc_dev (BD_ADDR bd_addr)
     }
 
     memcpy (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN);
+    btm_sec_dev_index_add (p_dev_rec);
 
-    p_dev_rec->hci_handle = BTM_GetHCIConnHandle (bd_addr);
+    btm_sec_set_dev_handle (p_dev_rec, BTM_GetHCIConnHandle (bd_addr));
     p_dev_rec->timestamp = btm_cb.dev_rec_count++;
 
     return(p_dev_rec);
@@ -272,6 +278,7 @@ tBTM_SEC_DEV_REC *btm_sec_alloc_dev (BD_ADDR bd_addr)
 *******************************************************************************/
 void btm_sec_free_dev (tBTM_SEC_DEV_REC *p_dev_rec)
 {
+    btm_sec_dev_index_remove (p_dev_rec);
     p_dev_rec->sec_flags = 0;
 
 #if BLE_INCLUDED == TRUE
@@ -336,6 +343,110 @@ BOOLEAN btm_dev_support_switch (BD_ADDR bd_addr)
     return(FALSE);
 }
 
+/*******************************************************************************
+**
+** Function         btm_sec_dev_hash
+**
+** Description      Returns the first slot of the BD address index to probe for
+**                  the specified BD address
+**
+*******************************************************************************/
+static UINT16 btm_sec_dev_hash (BD_ADDR bd_addr)
+{
+    UINT32 lap = ((UINT32)bd_addr[3] << 16) | ((UINT32)bd_addr[4] << 8) | bd_addr[5];
+    UINT32 nap = ((UINT32)bd_addr[0] << 16) | ((UINT32)bd_addr[1] << 8) | bd_addr[2];
+
+    return (UINT16)((((lap ^ (nap * 31)) * 2654435761U) >> 16) & (BTM_SEC_DEV_HASH_SIZE - 1));
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_dev_index_add
+**
+** Description      Adds a device record to the BD address index. Called once
+**                  the BD address of a newly allocated record is set.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btm_sec_dev_index_add (tBTM_SEC_DEV_REC *p_dev_rec)
+{
+    UINT16 slot = btm_sec_dev_hash (p_dev_rec->bd_addr);
+
+    while (btm_cb.sec_dev_hash[slot] != 0)
+        slot = (slot + 1) & (BTM_SEC_DEV_HASH_SIZE - 1);
+
+    btm_cb.sec_dev_hash[slot] = (UINT16)(p_dev_rec - btm_cb.sec_dev_rec) + 1;
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_dev_index_remove
+**
+** Description      Removes a device record from the BD address and the HCI
+**                  handle indexes. The entries following it in the probe
+**                  sequence are shifted back so no deleted markers are needed.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_sec_dev_index_remove (tBTM_SEC_DEV_REC *p_dev_rec)
+{
+    UINT16 entry = (UINT16)(p_dev_rec - btm_cb.sec_dev_rec) + 1;
+    UINT16 slot, next, home;
+
+    btm_sec_set_dev_handle (p_dev_rec, BTM_SEC_INVALID_HANDLE);
+
+    for (slot = btm_sec_dev_hash (p_dev_rec->bd_addr); btm_cb.sec_dev_hash[slot] != entry;
+         slot = (slot + 1) & (BTM_SEC_DEV_HASH_SIZE - 1))
+    {
+        if (btm_cb.sec_dev_hash[slot] == 0)
+            return;
+    }
+
+    next = slot;
+    for (;;)
+    {
+        next = (next + 1) & (BTM_SEC_DEV_HASH_SIZE - 1);
+        if (btm_cb.sec_dev_hash[next] == 0)
+            break;
+
+        /* Move the entry back unless its home slot lies cyclically in (slot, next] */
+        home = btm_sec_dev_hash (btm_cb.sec_dev_rec[btm_cb.sec_dev_hash[next] - 1].bd_addr);
+        if ((slot <= next) ? ((slot < home) && (home <= next)) : ((slot < home) || (home <= next)))
+            continue;
+
+        btm_cb.sec_dev_hash[slot] = btm_cb.sec_dev_hash[next];
+        slot = next;
+    }
+    btm_cb.sec_dev_hash[slot] = 0;
+}
+
+/*******************************************************************************
+**
+** Function         btm_sec_set_dev_handle
+**
+** Description      Sets the HCI handle of a device record and keeps the
+**                  handle index in sync. All changes of hci_handle of an
+**                  allocated record must go through this function.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btm_sec_set_dev_handle (tBTM_SEC_DEV_REC *p_dev_rec, UINT16 handle)
+{
+    UINT16 entry = (UINT16)(p_dev_rec - btm_cb.sec_dev_rec) + 1;
+    UINT16 old = p_dev_rec->hci_handle;
+
+    if ((old < BTM_SEC_DEV_HANDLE_SIZE) && (btm_cb.sec_dev_by_handle[old] == entry))
+        btm_cb.sec_dev_by_handle[old] = 0;
+
+    p_dev_rec->hci_handle = handle;
+
+    if (handle < BTM_SEC_DEV_HANDLE_SIZE)
+        btm_cb.sec_dev_by_handle[handle] = entry;
+}
+
 /*******************************************************************************
 **
 ** Function         btm_find_dev_by_handle
@@ -348,15 +459,17 @@ BOOLEAN btm_dev_support_switch (BD_ADDR bd_addr)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_find_dev_by_handle (UINT16 handle)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = &btm_cb.sec_dev_rec[0];
-    int i;
+    tBTM_SEC_DEV_REC *p_dev_rec;
+
+    if ((handle >= BTM_SEC_DEV_HANDLE_SIZE) || (btm_cb.sec_dev_by_handle[handle] == 0))
+        return(NULL);
+
+    p_dev_rec = &btm_cb.sec_dev_rec[btm_cb.sec_dev_by_handle[handle] - 1];
+
+    if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
+        && (p_dev_rec->hci_handle == handle))
+        return(p_dev_rec);
 
-    for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
-    {
-        if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
-            && (p_dev_rec->hci_handle == handle))
-            return(p_dev_rec);
-    }
     return(NULL);
 }
 
@@ -372,13 +485,16 @@ tBTM_SEC_DEV_REC *btm_find_dev_by_handle (UINT16 handle)
 *******************************************************************************/
 tBTM_SEC_DEV_REC *btm_find_dev (BD_ADDR bd_addr)
 {
-    tBTM_SEC_DEV_REC *p_dev_rec = &btm_cb.sec_dev_rec[0];
-    int i;
+    tBTM_SEC_DEV_REC *p_dev_rec;
+    UINT16 slot;
 
     if (bd_addr)
     {
-        for (i = 0; i < BTM_SEC_MAX_DEVICE_RECORDS; i++, p_dev_rec++)
+        for (slot = btm_sec_dev_hash (bd_addr); btm_cb.sec_dev_hash[slot] != 0;
+             slot = (slot + 1) & (BTM_SEC_DEV_HASH_SIZE - 1))
         {
+            p_dev_rec = &btm_cb.sec_dev_rec[btm_cb.sec_dev_hash[slot] - 1];
+
             if ((p_dev_rec->sec_flags & BTM_SEC_IN_USE)
                 && (!memcmp (p_dev_rec->bd_addr, bd_addr, BD_ADDR_LEN)))
                 return(p_dev_rec);
@@ -145,6 +145,9 @@ extern UINT16 BTM_EIR_UUID_LKUP_TBL[BTM_EIR_MAX_SERVICES];
 static void         btm_initiate_inquiry (tBTM_INQUIRY_VAR_ST *p_inq);
 static tBTM_STATUS  btm_set_inq_event_filter (UINT8 filter_cond_type, tBTM_INQ_FILT_COND *p_filt_cond);
 static void         btm_clr_inq_result_flt (void);
+static void         btm_inq_db_lru_touch (tINQ_DB_ENT *p_ent);
+static void         btm_inq_db_release (tINQ_DB_ENT *p_ent);
+static void         btm_inq_db_swap_links (tINQ_DB_ENT *p_a, tINQ_DB_ENT *p_b);
 
 #if ((BTM_EIR_SERVER_INCLUDED == TRUE)||(BTM_EIR_CLIENT_INCLUDED == TRUE))
 static UINT8        btm_convert_uuid_to_eir_service( UINT16 uuid16 );
@@ -1110,17 +1113,13 @@ tBTM_INQ_INFO *BTM_InqNextResult (tBTM_INQ_INFO *p_cur)
 *******************************************************************************/
 tBTM_INQ_INFO *BTM_InqDbRead (BD_ADDR p_bda)
 {
-    UINT16       xx;
-    tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
+    tINQ_DB_ENT  *p_ent;
 
     BTM_TRACE_API6 ("BTM_InqDbRead: bd addr [%02x%02x%02x%02x%02x%02x]",
                p_bda[0], p_bda[1], p_bda[2], p_bda[3], p_bda[4], p_bda[5]);
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
-    {
-        if ((p_ent->in_use) && (!memcmp (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN)))
-            return (&p_ent->inq_info);
-    }
+    if ((p_ent = btm_inq_db_find (p_bda)) != NULL)
+        return (&p_ent->inq_info);
 
     /* If here, not found */
     return ((tBTM_INQ_INFO *)NULL);
@@ -1512,13 +1511,21 @@ void btm_clr_inq_db (BD_ADDR p_bda)
 {
     tBTM_INQUIRY_VAR_ST     *p_inq = &btm_cb.btm_inq_vars;
     tINQ_DB_ENT             *p_ent = p_inq->inq_db;
-    UINT16                   xx;
+    UINT16                   xx = 0;
 
 #if (BTM_INQ_DEBUG == TRUE)
     BTM_TRACE_DEBUG2 ("btm_clr_inq_db: inq_active:0x%x state:%d",
         btm_cb.btm_inq_vars.inq_active, btm_cb.btm_inq_vars.state);
 #endif
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    if (p_bda != NULL)
+    {
+        /* A device has at most one entry, look it up in the index */
+        if ((p_ent = btm_inq_db_find (p_bda)) == NULL)
+            return;
+        xx = (UINT16)(p_ent - p_inq->inq_db);
+    }
+
+    for ( ; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
     {
         if (p_ent->in_use)
         {
@@ -1526,6 +1533,7 @@ void btm_clr_inq_db (BD_ADDR p_bda)
             if (p_bda == NULL ||
                 (!memcmp (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN)))
             {
+                btm_inq_db_release (p_ent);
                 p_ent->in_use = FALSE;
 #if (BTM_INQ_GET_REMOTE_NAME == TRUE)
                 p_ent->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
@@ -1533,6 +1541,9 @@ void btm_clr_inq_db (BD_ADDR p_bda)
 
                 if (btm_cb.btm_inq_vars.p_inq_change_cb)
                     (*btm_cb.btm_inq_vars.p_inq_change_cb) (&p_ent->inq_info, FALSE);
+
+                if (p_bda != NULL)
+                    break;
             }
         }
     }
@@ -1608,6 +1619,210 @@ BOOLEAN btm_inq_find_bdaddr (BD_ADDR p_bda)
     return (FALSE);
 }
 
+/*******************************************************************************
+**
+** Function         btm_inq_db_hash
+**
+** Description      Returns the first slot of the inquiry database index to
+**                  probe for the specified BD address
+**
+*******************************************************************************/
+static UINT16 btm_inq_db_hash (BD_ADDR p_bda)
+{
+    UINT32 lap = ((UINT32)p_bda[3] << 16) | ((UINT32)p_bda[4] << 8) | p_bda[5];
+    UINT32 nap = ((UINT32)p_bda[0] << 16) | ((UINT32)p_bda[1] << 8) | p_bda[2];
+
+    return (UINT16)((((lap ^ (nap * 31)) * 2654435761U) >> 16) & (BTM_INQ_DB_HASH_SIZE - 1));
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_hash_slot
+**
+** Description      Returns the index slot holding the specified entry
+**
+*******************************************************************************/
+static UINT16 btm_inq_db_hash_slot (tINQ_DB_ENT *p_ent)
+{
+    tBTM_INQUIRY_VAR_ST *p_inq = &btm_cb.btm_inq_vars;
+    UINT16 entry = (UINT16)(p_ent - p_inq->inq_db) + 1;
+    UINT16 slot = btm_inq_db_hash (p_ent->inq_info.results.remote_bd_addr);
+
+    while ((p_inq->inq_db_hash[slot] != entry) && (p_inq->inq_db_hash[slot] != 0))
+        slot = (slot + 1) & (BTM_INQ_DB_HASH_SIZE - 1);
+
+    return (slot);
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_lru_unlink
+**
+** Description      Takes an entry out of the least recently responded list
+**
+*******************************************************************************/
+static void btm_inq_db_lru_unlink (tINQ_DB_ENT *p_ent)
+{
+    tBTM_INQUIRY_VAR_ST *p_inq = &btm_cb.btm_inq_vars;
+
+    if (p_ent->lru_prev)
+        p_inq->inq_db[p_ent->lru_prev - 1].lru_next = p_ent->lru_next;
+    else
+        p_inq->inq_db_lru_head = p_ent->lru_next;
+
+    if (p_ent->lru_next)
+        p_inq->inq_db[p_ent->lru_next - 1].lru_prev = p_ent->lru_prev;
+    else
+        p_inq->inq_db_lru_tail = p_ent->lru_prev;
+
+    p_ent->lru_prev = p_ent->lru_next = 0;
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_lru_touch
+**
+** Description      Moves an entry in use to the most recently responded end of
+**                  the least recently responded list
+**
+*******************************************************************************/
+static void btm_inq_db_lru_touch (tINQ_DB_ENT *p_ent)
+{
+    tBTM_INQUIRY_VAR_ST *p_inq = &btm_cb.btm_inq_vars;
+    UINT16 entry = (UINT16)(p_ent - p_inq->inq_db) + 1;
+
+    if (p_inq->inq_db_lru_tail == entry)
+        return;
+
+    if (p_ent->lru_prev || p_ent->lru_next || (p_inq->inq_db_lru_head == entry))
+        btm_inq_db_lru_unlink (p_ent);
+
+    p_ent->lru_prev = p_inq->inq_db_lru_tail;
+    p_ent->lru_next = 0;
+
+    if (p_inq->inq_db_lru_tail)
+        p_inq->inq_db[p_inq->inq_db_lru_tail - 1].lru_next = entry;
+    else
+        p_inq->inq_db_lru_head = entry;
+
+    p_inq->inq_db_lru_tail = entry;
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_release
+**
+** Description      Removes an entry in use from the BD address index and the
+**                  least recently responded list. The caller marks it unused.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_inq_db_release (tINQ_DB_ENT *p_ent)
+{
+    tBTM_INQUIRY_VAR_ST *p_inq = &btm_cb.btm_inq_vars;
+    UINT16 slot, next, home;
+    UINT16 xx = (UINT16)(p_ent - p_inq->inq_db);
+
+    btm_inq_db_lru_unlink (p_ent);
+
+    /* Remove from the index, shifting back the entries that follow in the probe sequence */
+    slot = btm_inq_db_hash_slot (p_ent);
+    if (p_inq->inq_db_hash[slot] != 0)
+    {
+        next = slot;
+        for (;;)
+        {
+            next = (next + 1) & (BTM_INQ_DB_HASH_SIZE - 1);
+            if (p_inq->inq_db_hash[next] == 0)
+                break;
+
+            /* Leave the entry in place if its home slot lies cyclically in (slot, next] */
+            home = btm_inq_db_hash (p_inq->inq_db[p_inq->inq_db_hash[next] - 1].inq_info.results.remote_bd_addr);
+            if ((slot <= next) ? ((slot < home) && (home <= next)) : ((slot < home) || (home <= next)))
+                continue;
+
+            p_inq->inq_db_hash[slot] = p_inq->inq_db_hash[next];
+            slot = next;
+        }
+        p_inq->inq_db_hash[slot] = 0;
+    }
+
+    p_inq->inq_db_used--;
+    if (xx < p_inq->inq_db_free_hint)
+        p_inq->inq_db_free_hint = xx;
+}
+
+/*******************************************************************************
+**
+** Function         btm_inq_db_swap_links
+**
+** Description      Called before the contents of two entries are exchanged to
+**                  relabel the entries in the least recently responded list and
+**                  the BD address index, so both stay valid after the copy.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btm_inq_db_swap_links (tINQ_DB_ENT *p_a, tINQ_DB_ENT *p_b)
+{
+    tBTM_INQUIRY_VAR_ST *p_inq = &btm_cb.btm_inq_vars;
+    UINT16 ea = (UINT16)(p_a - p_inq->inq_db) + 1;
+    UINT16 eb = (UINT16)(p_b - p_inq->inq_db) + 1;
+    UINT16 nodes[6];
+    UINT16 slot_a = 0, slot_b = 0;
+    int    xx, yy;
+
+#define BTM_INQ_DB_RELABEL(e) (((e) == ea) ? eb : (((e) == eb) ? ea : (e)))
+
+    if (p_a->in_use)
+        slot_a = btm_inq_db_hash_slot (p_a);
+    if (p_b->in_use)
+        slot_b = btm_inq_db_hash_slot (p_b);
+
+    nodes[0] = ea;
+    nodes[1] = eb;
+    nodes[2] = p_a->lru_prev;
+    nodes[3] = p_a->lru_next;
+    nodes[4] = p_b->lru_prev;
+    nodes[5] = p_b->lru_next;
+
+    for (xx = 0; xx < 6; xx++)
+    {
+        if (nodes[xx] == 0)
+            continue;
+
+        for (yy = 0; yy < xx; yy++)
+        {
+            if (nodes[yy] == nodes[xx])
+                break;
+        }
+        if (yy < xx)
+            continue;
+
+        p_inq->inq_db[nodes[xx] - 1].lru_prev = BTM_INQ_DB_RELABEL(p_inq->inq_db[nodes[xx] - 1].lru_prev);
+        p_inq->inq_db[nodes[xx] - 1].lru_next = BTM_INQ_DB_RELABEL(p_inq->inq_db[nodes[xx] - 1].lru_next);
+    }
+
+    p_inq->inq_db_lru_head = BTM_INQ_DB_RELABEL(p_inq->inq_db_lru_head);
+    p_inq->inq_db_lru_tail = BTM_INQ_DB_RELABEL(p_inq->inq_db_lru_tail);
+
+    if (p_a->in_use)
+        p_inq->inq_db_hash[slot_a] = eb;
+    if (p_b->in_use)
+        p_inq->inq_db_hash[slot_b] = ea;
+
+    /* A free entry may move down */
+    if (!p_a->in_use || !p_b->in_use)
+    {
+        xx = ((ea < eb) ? ea : eb) - 1;
+        if (xx < p_inq->inq_db_free_hint)
+            p_inq->inq_db_free_hint = (UINT16)xx;
+    }
+
+#undef BTM_INQ_DB_RELABEL
+}
+
 /*******************************************************************************
 **
 ** Function         btm_inq_db_find
@@ -1620,11 +1835,15 @@ BOOLEAN btm_inq_find_bdaddr (BD_ADDR p_bda)
 *******************************************************************************/
 tINQ_DB_ENT *btm_inq_db_find (BD_ADDR p_bda)
 {
-    UINT16       xx;
-    tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
+    tBTM_INQUIRY_VAR_ST *p_inq = &btm_cb.btm_inq_vars;
+    tINQ_DB_ENT  *p_ent;
+    UINT16       slot;
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    for (slot = btm_inq_db_hash (p_bda); p_inq->inq_db_hash[slot] != 0;
+         slot = (slot + 1) & (BTM_INQ_DB_HASH_SIZE - 1))
     {
+        p_ent = &p_inq->inq_db[p_inq->inq_db_hash[slot] - 1];
+
         if ((p_ent->in_use) && (!memcmp (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN)))
             return (p_ent);
     }
@@ -1639,56 +1858,62 @@ tINQ_DB_ENT *btm_inq_db_find (BD_ADDR p_bda)
 ** Function         btm_inq_db_new
 **
 ** Description      This function looks through the inquiry database for an unused
-**                  entry. If no entry is free, it allocates the oldest entry.
+**                  entry. If no entry is free, it reuses the entry that has gone
+**                  the longest without a response.
 **
 ** Returns          pointer to entry
 **
 *******************************************************************************/
 tINQ_DB_ENT *btm_inq_db_new (BD_ADDR p_bda)
 {
+    tBTM_INQUIRY_VAR_ST *p_inq = &btm_cb.btm_inq_vars;
     UINT16       xx;
-    tINQ_DB_ENT  *p_ent = btm_cb.btm_inq_vars.inq_db;
-    tINQ_DB_ENT  *p_old = btm_cb.btm_inq_vars.inq_db;
-    UINT32       ot = 0xFFFFFFFF;
+    tINQ_DB_ENT  *p_ent = NULL;
 
-    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++)
+    if (p_inq->inq_db_used < BTM_INQ_DB_SIZE)
     {
-        if (!p_ent->in_use)
-        {
-            memset (p_ent, 0, sizeof (tINQ_DB_ENT));
-            memcpy (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
-            p_ent->in_use = TRUE;
-
-#if (BTM_INQ_GET_REMOTE_NAME==TRUE)
-            p_ent->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
-#endif
-
-            return (p_ent);
-        }
-
-        if (p_ent->time_of_resp < ot)
+        for (xx = p_inq->inq_db_free_hint; xx < BTM_INQ_DB_SIZE; xx++)
         {
-            p_old = p_ent;
-            ot    = p_ent->time_of_resp;
+            if (!p_inq->inq_db[xx].in_use)
+            {
+                p_ent = &p_inq->inq_db[xx];
+                p_inq->inq_db_free_hint = xx + 1;
+                break;
+            }
         }
     }
 
-    /* If here, no free entry found. Return the oldest. */
+    if (p_ent == NULL)
+    {
+        /* If here, no free entry found. Reuse the least recently responded one. */
+        p_ent = &p_inq->inq_db[p_inq->inq_db_lru_head - 1];
+
+        /* Before deleting the oldest, if anyone is registered for change */
+        /* notifications, then tell him we are deleting an entry.         */
+        if (p_inq->p_inq_change_cb)
+            (*p_inq->p_inq_change_cb) (&p_ent->inq_info, FALSE);
 
-    /* Before deleting the oldest, if anyone is registered for change */
-    /* notifications, then tell him we are deleting an entry.         */
-    if (btm_cb.btm_inq_vars.p_inq_change_cb)
-        (*btm_cb.btm_inq_vars.p_inq_change_cb) (&p_old->inq_info, FALSE);
+        btm_inq_db_release (p_ent);
+    }
 
-    memset (p_old, 0, sizeof (tINQ_DB_ENT));
-    memcpy (p_old->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
-    p_old->in_use = TRUE;
+    memset (p_ent, 0, sizeof (tINQ_DB_ENT));
+    memcpy (p_ent->inq_info.results.remote_bd_addr, p_bda, BD_ADDR_LEN);
+    p_ent->in_use = TRUE;
 
 #if (BTM_INQ_GET_REMOTE_NAME==TRUE)
-    p_old->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
+    p_ent->inq_info.remote_name_state = BTM_INQ_RMT_NAME_EMPTY;
 #endif
 
-    return (p_old);
+    /* Add the entry to the index and as the most recent one to the LRU list */
+    xx = btm_inq_db_hash (p_bda);
+    while (p_inq->inq_db_hash[xx] != 0)
+        xx = (xx + 1) & (BTM_INQ_DB_HASH_SIZE - 1);
+    p_inq->inq_db_hash[xx] = (UINT16)(p_ent - p_inq->inq_db) + 1;
+
+    btm_inq_db_lru_touch (p_ent);
+    p_inq->inq_db_used++;
+
+    return (p_ent);
 }
 
 
@@ -2108,6 +2333,7 @@ void btm_process_inq_results (UINT8 *p, UINT8 inq_res_mode)
             p_cur->clock_offset       = clock_offset  | BTM_CLOCK_OFFSET_VALID;
 
             p_i->time_of_resp = GKI_get_tick_count ();
+            btm_inq_db_lru_touch (p_i);
 
             if (p_i->inq_count != p_inq->inq_counter)
                 p_inq->inq_cmpl_info.num_resp++;       /* A new response was found */
@@ -2247,6 +2473,7 @@ void btm_sort_inq_result(void)
             {
                 if(p_ent->inq_info.results.rssi < p_next->inq_info.results.rssi)
                 {
+                    btm_inq_db_swap_links (p_ent, p_next);
                     memcpy (p_tmp,  p_next, size);
                     memcpy (p_next, p_ent,  size);
                     memcpy (p_ent,  p_tmp,  size);
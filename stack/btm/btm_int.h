@@ -242,8 +242,14 @@ typedef struct
 #if (BLE_INCLUDED == TRUE)
     BOOLEAN         scan_rsp;
 #endif
+    UINT16          lru_prev;           /* Links of the least recently responded list,              */
+    UINT16          lru_next;           /* entry index + 1 or 0 if none                             */
 } tINQ_DB_ENT;
 
+#if ((BTM_INQ_DB_HASH_SIZE & (BTM_INQ_DB_HASH_SIZE - 1)) != 0) || (BTM_INQ_DB_HASH_SIZE < 2 * BTM_INQ_DB_SIZE)
+#error BTM_INQ_DB_HASH_SIZE must be a power of two of at least twice BTM_INQ_DB_SIZE
+#endif
+
 
 typedef struct
 {
@@ -284,6 +290,11 @@ typedef struct
     UINT16           max_bd_entries;        /* Maximum number of entries that can be stored */
 #endif
     tINQ_DB_ENT      inq_db[BTM_INQ_DB_SIZE];
+    UINT16           inq_db_hash[BTM_INQ_DB_HASH_SIZE]; /* BD address index, entry index + 1 or 0 if empty */
+    UINT16           inq_db_lru_head;       /* Least recently responded entry (index + 1) */
+    UINT16           inq_db_lru_tail;       /* Most recently responded entry (index + 1) */
+    UINT16           inq_db_used;           /* Number of entries in use */
+    UINT16           inq_db_free_hint;      /* No entry below this index is free */
     tBTM_INQ_PARMS   inqparms;              /* Contains the parameters for the current inquiry */
     tBTM_INQUIRY_CMPL inq_cmpl_info;        /* Status and number of responses from the last inquiry */
 
@@ -314,6 +325,13 @@ typedef struct
 
 #define BTM_SEC_INVALID_HANDLE  0xFFFF
 
+/* Size of the HCI handle index of the security records (12 bit handles) */
+#define BTM_SEC_DEV_HANDLE_SIZE 0x1000
+
+#if ((BTM_SEC_DEV_HASH_SIZE & (BTM_SEC_DEV_HASH_SIZE - 1)) != 0) || (BTM_SEC_DEV_HASH_SIZE < 2 * BTM_SEC_MAX_DEVICE_RECORDS)
+#error BTM_SEC_DEV_HASH_SIZE must be a power of two of at least twice BTM_SEC_MAX_DEVICE_RECORDS
+#endif
+
 typedef UINT8 *BTM_BD_NAME_PTR;                        /* Pointer to Device name */
 
 /* Security callback is called by this unit when security
@@ -831,6 +849,8 @@ typedef struct
     UINT8                    disc_reason;   /* for legacy devices */
     tBTM_SEC_SERV_REC        sec_serv_rec[BTM_SEC_MAX_SERVICE_RECORDS];
     tBTM_SEC_DEV_REC         sec_dev_rec[BTM_SEC_MAX_DEVICE_RECORDS];
+    UINT16                   sec_dev_hash[BTM_SEC_DEV_HASH_SIZE];        /* BD address index, record index + 1 or 0 if empty */
+    UINT16                   sec_dev_by_handle[BTM_SEC_DEV_HANDLE_SIZE]; /* HCI handle index, record index + 1 or 0 if none */
     tBTM_SEC_SERV_REC       *p_out_serv;
     tBTM_MKEY_CALLBACK      *mkey_cback;
 
@@ -1039,6 +1059,8 @@ extern void               btm_sec_free_dev (tBTM_SEC_DEV_REC *p_dev_rec);
 extern tBTM_SEC_DEV_REC  *btm_find_dev (BD_ADDR bd_addr);
 extern tBTM_SEC_DEV_REC  *btm_find_or_alloc_dev (BD_ADDR bd_addr);
 extern tBTM_SEC_DEV_REC  *btm_find_dev_by_handle (UINT16 handle);
+extern void               btm_sec_dev_index_add (tBTM_SEC_DEV_REC *p_dev_rec);
+extern void               btm_sec_set_dev_handle (tBTM_SEC_DEV_REC *p_dev_rec, UINT16 handle);
 
 /* Internal functions provided by btm_sec.c
 **********************************************
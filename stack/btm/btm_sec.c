@@ -2018,7 +2018,7 @@ tBTM_STATUS btm_sec_l2cap_access_req (BD_ADDR bd_addr, UINT16 psm, UINT16 handle
     /* Find or get oldest record */
     p_dev_rec = btm_find_or_alloc_dev (bd_addr);
 
-    p_dev_rec->hci_handle = handle;
+    btm_sec_set_dev_handle (p_dev_rec, handle);
 
     /* Find the service record for the PSM */
     p_serv_rec = btm_sec_find_first_serv (conn_type, psm);
@@ -4214,7 +4214,7 @@ void btm_sec_connected (UINT8 *bda, UINT16 handle, UINT8 status, UINT8 enc_mode)
         return;
     }
 
-    p_dev_rec->hci_handle = handle;
+    btm_sec_set_dev_handle (p_dev_rec, handle);
 
     /* role may not be correct here, it will be updated by l2cap, but we need to */
     /* notify btm_acl that link is up, so starting of rmt name request will not */
@@ -4401,7 +4401,7 @@ void btm_sec_disconnected (UINT16 handle, UINT8 reason)
         }
     }
 
-    p_dev_rec->hci_handle = BTM_SEC_INVALID_HANDLE;
+    btm_sec_set_dev_handle (p_dev_rec, BTM_SEC_INVALID_HANDLE);
     p_dev_rec->sec_state  = BTM_SEC_STATE_IDLE;
 
 #if BLE_INCLUDED == TRUE && SMP_INCLUDED == TRUE
@@ -40,6 +40,9 @@ static BOOLEAN allocate_svc_db_buf(tGATT_SVC_DB *p_db);
 static void *allocate_attr_in_db(tGATT_SVC_DB *p_db, UINT16 uuid16, UINT8 *p_uuid128, tGATT_PERM perm);
 static BOOLEAN deallocate_attr_in_db(tGATT_SVC_DB *p_db, void *p_attr);
 static BOOLEAN copy_extra_byte_in_db(tGATT_SVC_DB *p_db, void **p_dst, UINT16 len);
+static void gatts_db_alloc_index(tGATT_SVC_DB *p_db, UINT16 num_handle);
+static void gatts_db_index_attr(tGATT_SVC_DB *p_db, tGATT_ATTR16 *p_attr);
+static void gatts_db_unindex_attr(tGATT_SVC_DB *p_db, tGATT_ATTR16 *p_attr);
 
 static void gatts_db_add_service_declaration(tGATT_SVC_DB *p_db, tBT_UUID service, BOOLEAN is_pri);
 static tGATT_STATUS gatts_send_app_read_request(tGATT_TCB *p_tcb, UINT8 op_code,
@@ -70,9 +73,12 @@ BOOLEAN gatts_init_service_db (tGATT_SVC_DB *p_db, tBT_UUID service,  BOOLEAN is
     GATT_TRACE_DEBUG2("s_hdl = %d num_handle = %d", s_hdl, num_handle );
 
     /* update service database information */
+    p_db->start_handle  = s_hdl;
     p_db->next_handle   = s_hdl;
     p_db->end_handle    = s_hdl + num_handle;
 
+    gatts_db_alloc_index(p_db, num_handle);
+
     gatts_db_add_service_declaration(p_db, service, is_pri);
 
     return TRUE;
@@ -104,6 +110,159 @@ tBT_UUID * gatts_get_service_uuid (tGATT_SVC_DB *p_db)
     }
 }
 
+/*******************************************************************************
+**
+** Function         gatts_db_find_attr_from
+**
+** Description      Find the first attribute of a service database whose handle
+**                  is not below s_handle. Indexed databases resolve this in
+**                  constant time, others walk the attribute list.
+**
+** Parameter        p_db: database pointer.
+**                  s_handle: starting handle.
+**
+** Returns          pointer to the attribute, NULL if none.
+**
+*******************************************************************************/
+void *gatts_db_find_attr_from (tGATT_SVC_DB *p_db, UINT16 s_handle)
+{
+    tGATT_ATTR16    *p_attr;
+
+    if (!p_db || !p_db->p_attr_list)
+        return NULL;
+
+    if (p_db->p_attr_index != NULL)
+    {
+        /* handles are allocated back to back from start_handle */
+        if (s_handle <= p_db->start_handle)
+            return p_db->p_attr_list;
+        if (s_handle >= p_db->next_handle)
+            return NULL;
+        return p_db->p_attr_index[s_handle - p_db->start_handle];
+    }
+
+    p_attr = (tGATT_ATTR16 *)p_db->p_attr_list;
+    while (p_attr && p_attr->handle < s_handle)
+        p_attr = (tGATT_ATTR16 *)p_attr->p_next;
+
+    return p_attr;
+}
+
+/*******************************************************************************
+**
+** Function         gatts_db_find_attr
+**
+** Description      Find an attribute of a service database by handle.
+**
+** Parameter        p_db: database pointer.
+**                  handle: attribute handle.
+**
+** Returns          pointer to the attribute, NULL if not found.
+**
+*******************************************************************************/
+void *gatts_db_find_attr (tGATT_SVC_DB *p_db, UINT16 handle)
+{
+    tGATT_ATTR16    *p_attr = (tGATT_ATTR16 *)gatts_db_find_attr_from(p_db, handle);
+
+    if (p_attr && p_attr->handle == handle)
+        return p_attr;
+
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         gatts_db_decl_type
+**
+** Description      Map a 16 bits attribute type onto the declaration chains of
+**                  the database index.
+**
+** Returns          chain index, -1 if the type is not chained.
+**
+*******************************************************************************/
+static int gatts_db_decl_type(UINT16 uuid16)
+{
+    if (uuid16 >= GATT_UUID_PRI_SERVICE &&
+        uuid16 < GATT_UUID_PRI_SERVICE + GATT_DB_NUM_DECL_TYPES)
+        return (int)(uuid16 - GATT_UUID_PRI_SERVICE);
+
+    return -1;
+}
+
+/*******************************************************************************
+**
+** Function         gatts_db_first_decl
+**
+** Description      Find the first declaration of a chained type at or after
+**                  s_handle.
+**
+** Returns          pointer to the attribute, NULL if none.
+**
+*******************************************************************************/
+static tGATT_ATTR16 *gatts_db_first_decl(tGATT_SVC_DB *p_db, int decl_type, UINT16 s_handle)
+{
+    UINT16  handle = p_db->decl_first[decl_type];
+
+    while (handle != 0 && handle < s_handle)
+        handle = p_db->p_decl_next[handle - p_db->start_handle];
+
+    if (handle == 0)
+        return NULL;
+
+    return (tGATT_ATTR16 *)p_db->p_attr_index[handle - p_db->start_handle];
+}
+
+/*******************************************************************************
+**
+** Function         gatts_db_next_decl
+**
+** Description      Find the next declaration of the same type as p_attr.
+**
+** Returns          pointer to the attribute, NULL if none.
+**
+*******************************************************************************/
+static tGATT_ATTR16 *gatts_db_next_decl(tGATT_SVC_DB *p_db, tGATT_ATTR16 *p_attr)
+{
+    UINT16  handle = p_db->p_decl_next[p_attr->handle - p_db->start_handle];
+
+    if (handle == 0)
+        return NULL;
+
+    return (tGATT_ATTR16 *)p_db->p_attr_index[handle - p_db->start_handle];
+}
+
+/*******************************************************************************
+**
+** Function         gatts_db_attr_uuid_match
+**
+** Description      Compare the type of an attribute with a UUID. 16 bits types
+**                  are compared directly, anything else goes through
+**                  gatt_uuid_compare().
+**
+** Returns          TRUE if the types match.
+**
+*******************************************************************************/
+static BOOLEAN gatts_db_attr_uuid_match(tGATT_ATTR16 *p_attr, tBT_UUID *p_type)
+{
+    tBT_UUID    attr_uuid;
+
+    if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
+    {
+        if (p_type->len == LEN_UUID_16)
+            return (BOOLEAN)(p_attr->uuid == p_type->uu.uuid16);
+
+        attr_uuid.len = LEN_UUID_16;
+        attr_uuid.uu.uuid16 = p_attr->uuid;
+    }
+    else
+    {
+        attr_uuid.len = LEN_UUID_128;
+        memcpy(attr_uuid.uu.uuid128, ((tGATT_ATTR128 *)p_attr)->uuid, LEN_UUID_128);
+    }
+
+    return gatt_uuid_compare(*p_type, attr_uuid);
+}
+
 /*******************************************************************************
 **
 ** Function         gatts_check_attr_readability
@@ -328,26 +487,22 @@ tGATT_STATUS gatts_db_read_attr_value_by_type (tGATT_TCB   *p_tcb,
     tGATT_ATTR16  *p_attr;
     UINT16      len = 0;
     UINT8       *p = (UINT8 *)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
-    tBT_UUID    attr_uuid;
+    int         decl_type = -1;
 
     if (p_db && p_db->p_attr_list)
     {
-        p_attr = (tGATT_ATTR16 *)p_db->p_attr_list;
+        /* declarations are chained by type, anything else is scanned from s_handle */
+        if (p_db->p_attr_index != NULL && type.len == LEN_UUID_16)
+            decl_type = gatts_db_decl_type(type.uu.uuid16);
+
+        if (decl_type >= 0)
+            p_attr = gatts_db_first_decl(p_db, decl_type, s_handle);
+        else
+            p_attr = (tGATT_ATTR16 *)gatts_db_find_attr_from(p_db, s_handle);
 
         while (p_attr && p_attr->handle <= e_handle)
         {
-            if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
-            {
-                attr_uuid.len = LEN_UUID_16;
-                attr_uuid.uu.uuid16 = p_attr->uuid;
-            }
-            else
-            {
-                attr_uuid.len = LEN_UUID_128;
-                memcpy(attr_uuid.uu.uuid128, ((tGATT_ATTR128 *)p_attr)->uuid, LEN_UUID_128);
-            }
-
-            if (p_attr->handle >= s_handle && gatt_uuid_compare(type, attr_uuid))
+            if (decl_type >= 0 || gatts_db_attr_uuid_match(p_attr, &type))
             {
                 if (*p_len <= 2)
                 {
@@ -389,7 +544,11 @@ tGATT_STATUS gatts_db_read_attr_value_by_type (tGATT_TCB   *p_tcb,
                     break;
                 }
             }
-            p_attr = (tGATT_ATTR16 *)p_attr->p_next;
+
+            if (decl_type >= 0)
+                p_attr = gatts_db_next_decl(p_db, p_attr);
+            else
+                p_attr = (tGATT_ATTR16 *)p_attr->p_next;
         }
     }
 
@@ -610,25 +769,15 @@ tGATT_STATUS gatts_read_attr_value_by_handle(tGATT_TCB *p_tcb,
     tGATT_ATTR16  *p_attr;
     UINT8       *pp = p_value;
 
-    if (p_db && p_db->p_attr_list)
+    if ((p_attr = (tGATT_ATTR16 *)gatts_db_find_attr(p_db, handle)) != NULL)
     {
-        p_attr = (tGATT_ATTR16 *)p_db->p_attr_list;
+        status = read_attr_value (p_attr, offset, &pp,
+                                  (BOOLEAN)(op_code == GATT_REQ_READ_BLOB),
+                                  mtu, p_len, sec_flag, key_size);
 
-        while (p_attr && handle >= p_attr->handle)
+        if (status == GATT_PENDING)
         {
-            if (p_attr->handle == handle)
-            {
-                status = read_attr_value (p_attr, offset, &pp,
-                                          (BOOLEAN)(op_code == GATT_REQ_READ_BLOB),
-                                          mtu, p_len, sec_flag, key_size);
-
-                if (status == GATT_PENDING)
-                {
-                    status = gatts_send_app_read_request(p_tcb, op_code, p_attr->handle, offset, trans_id);
-                }
-                break;
-            }
-            p_attr = (tGATT_ATTR16 *)p_attr->p_next;
+            status = gatts_send_app_read_request(p_tcb, op_code, p_attr->handle, offset, trans_id);
         }
     }
 
@@ -663,21 +812,11 @@ tGATT_STATUS gatts_read_attr_perm_check(tGATT_SVC_DB *p_db,
     tGATT_STATUS status = GATT_NOT_FOUND;
     tGATT_ATTR16  *p_attr;
 
-    if (p_db && p_db->p_attr_list)
+    if ((p_attr = (tGATT_ATTR16 *)gatts_db_find_attr(p_db, handle)) != NULL)
     {
-        p_attr = (tGATT_ATTR16 *)p_db->p_attr_list;
-
-        while (p_attr && handle >= p_attr->handle)
-        {
-            if (p_attr->handle == handle)
-            {
-                status = gatts_check_attr_readability (p_attr, 0,
-                                                       is_long,
-                                                       sec_flag, key_size);
-                break;
-            }
-            p_attr = (tGATT_ATTR16 *) p_attr->p_next;
-        }
+        status = gatts_check_attr_readability (p_attr, 0,
+                                               is_long,
+                                               sec_flag, key_size);
     }
 
     return status;
@@ -715,132 +854,124 @@ tGATT_STATUS gatts_write_attr_perm_check (tGATT_SVC_DB *p_db, UINT8 op_code,
 
     if (p_db != NULL)
     {
-        p_attr = (tGATT_ATTR16 *) p_db->p_attr_list;
-
-        while (p_attr != NULL)
+        if ((p_attr = (tGATT_ATTR16 *) gatts_db_find_attr(p_db, handle)) != NULL)
         {
-            if (p_attr->handle == handle)
+            perm = p_attr->permission;
+            min_key_size = (((perm & GATT_ENCRYPT_KEY_SIZE_MASK) >> 12));
+            if (min_key_size != 0 )
             {
-                perm = p_attr->permission;
-                min_key_size = (((perm & GATT_ENCRYPT_KEY_SIZE_MASK) >> 12));
-                if (min_key_size != 0 )
-                {
-                    min_key_size +=6;
-                }
-                GATT_TRACE_DEBUG2( "gatts_write_attr_perm_check p_attr->permission =0x%04x min_key_size==0x%04x",
-                                   p_attr->permission,
-                                   min_key_size);
-
-                if ((op_code == GATT_CMD_WRITE) && (perm & GATT_WRITE_SIGNED_PERM) )
-                {
-                    /* use the rules for the mixed security see section 10.2.3*/
-                    if (perm & GATT_PERM_WRITE_SIGNED)
-                    {
-                        perm = GATT_PERM_WRITE_ENCRYPTED;
-                    }
-                    else
-                    {
-                        perm = GATT_PERM_WRITE_ENC_MITM;
-                    }
-                }
+                min_key_size +=6;
+            }
+            GATT_TRACE_DEBUG2( "gatts_write_attr_perm_check p_attr->permission =0x%04x min_key_size==0x%04x",
+                               p_attr->permission,
+                               min_key_size);
 
-                if ((op_code == GATT_SIGN_CMD_WRITE) && !(perm & GATT_WRITE_SIGNED_PERM))
+            if ((op_code == GATT_CMD_WRITE) && (perm & GATT_WRITE_SIGNED_PERM) )
+            {
+                /* use the rules for the mixed security see section 10.2.3*/
+                if (perm & GATT_PERM_WRITE_SIGNED)
                 {
-                    status = GATT_WRITE_NOT_PERMIT;
-                    GATT_TRACE_DEBUG0( "gatts_write_attr_perm_check - sign cmd write not allowed");
+                    perm = GATT_PERM_WRITE_ENCRYPTED;
                 }
-                 if ((op_code == GATT_SIGN_CMD_WRITE) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+                else
                 {
-                    status = GATT_INVALID_PDU;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - Error!! sign cmd write sent on a encypted link");
+                    perm = GATT_PERM_WRITE_ENC_MITM;
                 }
-                else if (!(perm & GATT_WRITE_ALLOWED))
+            }
+
+            if ((op_code == GATT_SIGN_CMD_WRITE) && !(perm & GATT_WRITE_SIGNED_PERM))
+            {
+                status = GATT_WRITE_NOT_PERMIT;
+                GATT_TRACE_DEBUG0( "gatts_write_attr_perm_check - sign cmd write not allowed");
+            }
+             if ((op_code == GATT_SIGN_CMD_WRITE) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+            {
+                status = GATT_INVALID_PDU;
+                GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - Error!! sign cmd write sent on a encypted link");
+            }
+            else if (!(perm & GATT_WRITE_ALLOWED))
+            {
+                status = GATT_WRITE_NOT_PERMIT;
+                GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_WRITE_NOT_PERMIT");
+            }
+            else if ((perm & GATT_WRITE_AUTH_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_UNAUTHED))
+            {
+                status = GATT_INSUF_AUTHENTICATION;
+                GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION");
+            }
+            else if ((perm & GATT_WRITE_MITM_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_AUTHED))
+            {
+                status = GATT_INSUF_AUTHENTICATION;
+                GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION: MITM required");
+            }
+            else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && !(sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+            {
+                status = GATT_INSUF_ENCRYPTION;
+                GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_ENCRYPTION");
+            }
+            else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED) && (key_size < min_key_size))
+            {
+                status = GATT_INSUF_KEY_SIZE;
+                GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_KEY_SIZE");
+            }
+            else /* writable: must be char value declaration or char descritpors */
+            {
+                if(p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
                 {
-                    status = GATT_WRITE_NOT_PERMIT;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_WRITE_NOT_PERMIT");
-                }
-                else if ((perm & GATT_WRITE_AUTH_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_UNAUTHED))
+                switch (p_attr->uuid)
                 {
-                    status = GATT_INSUF_AUTHENTICATION;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION");
+                    case GATT_UUID_CHAR_PRESENT_FORMAT:/* should be readable only */
+                    case GATT_UUID_CHAR_EXT_PROP:/* should be readable only */
+                    case GATT_UUID_CHAR_AGG_FORMAT: /* should be readable only */
+                        case GATT_UUID_CHAR_VALID_RANGE:
+                        status = GATT_WRITE_NOT_PERMIT;
+                        break;
+
+                    case GATT_UUID_CHAR_CLIENT_CONFIG:
+                    case GATT_UUID_CHAR_SRVR_CONFIG:
+                        max_size = 2;
+                    case GATT_UUID_CHAR_DESCRIPTION:
+                    default: /* any other must be character value declaration */
+                        status = GATT_SUCCESS;
+                        break;
+                    }
                 }
-                else if ((perm & GATT_WRITE_MITM_REQUIRED ) && !(sec_flag & GATT_SEC_FLAG_LKEY_AUTHED))
+                else if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128)
                 {
-                    status = GATT_INSUF_AUTHENTICATION;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_AUTHENTICATION: MITM required");
+                     status = GATT_SUCCESS;
                 }
-                else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && !(sec_flag & GATT_SEC_FLAG_ENCRYPTED))
+                else
                 {
-                    status = GATT_INSUF_ENCRYPTION;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_ENCRYPTION");
+                    status = GATT_INVALID_PDU;
                 }
-                else if ((perm & GATT_WRITE_ENCRYPTED_PERM ) && (sec_flag & GATT_SEC_FLAG_ENCRYPTED) && (key_size < min_key_size))
+
+                if (p_data == NULL && len  > 0)
                 {
-                    status = GATT_INSUF_KEY_SIZE;
-                    GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INSUF_KEY_SIZE");
+                    status = GATT_INVALID_PDU;
                 }
-                else /* writable: must be char value declaration or char descritpors */
+                /* these attribute does not allow write blob */
+// btla-specific ++
+                else if ( (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16) &&
+                          (p_attr->uuid == GATT_UUID_CHAR_CLIENT_CONFIG ||
+                           p_attr->uuid == GATT_UUID_CHAR_SRVR_CONFIG) )
+// btla-specific --
                 {
-                    if(p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16)
+                    if (op_code == GATT_REQ_PREPARE_WRITE && offset != 0) /* does not allow write blob */
                     {
-                    switch (p_attr->uuid)
-                    {
-                        case GATT_UUID_CHAR_PRESENT_FORMAT:/* should be readable only */
-                        case GATT_UUID_CHAR_EXT_PROP:/* should be readable only */
-                        case GATT_UUID_CHAR_AGG_FORMAT: /* should be readable only */
-                            case GATT_UUID_CHAR_VALID_RANGE:
-                            status = GATT_WRITE_NOT_PERMIT;
-                            break;
-
-                        case GATT_UUID_CHAR_CLIENT_CONFIG:
-                        case GATT_UUID_CHAR_SRVR_CONFIG:
-                            max_size = 2;
-                        case GATT_UUID_CHAR_DESCRIPTION:
-                        default: /* any other must be character value declaration */
-                            status = GATT_SUCCESS;
-                            break;
-                        }
+                        status = GATT_NOT_LONG;
+                        GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_NOT_LONG");
                     }
-                    else if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_128)
-                    {
-                         status = GATT_SUCCESS;
-                    }
-                    else
+                    else if (len != max_size)    /* data does not match the required format */
                     {
                         status = GATT_INVALID_PDU;
+                        GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INVALID_PDU");
                     }
-
-                    if (p_data == NULL && len  > 0)
-                    {
-                        status = GATT_INVALID_PDU;
-                    }
-                    /* these attribute does not allow write blob */
-// btla-specific ++
-                    else if ( (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16) &&
-                              (p_attr->uuid == GATT_UUID_CHAR_CLIENT_CONFIG ||
-                               p_attr->uuid == GATT_UUID_CHAR_SRVR_CONFIG) )
-// btla-specific --
+                    else
                     {
-                        if (op_code == GATT_REQ_PREPARE_WRITE && offset != 0) /* does not allow write blob */
-                        {
-                            status = GATT_NOT_LONG;
-                            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_NOT_LONG");
-                        }
-                        else if (len != max_size)    /* data does not match the required format */
-                        {
-                            status = GATT_INVALID_PDU;
-                            GATT_TRACE_ERROR0( "gatts_write_attr_perm_check - GATT_INVALID_PDU");
-                        }
-                        else
-                        {
-                            status = GATT_SUCCESS;
-                        }
+                        status = GATT_SUCCESS;
                     }
                 }
-                break;
             }
-            else
-                p_attr = (tGATT_ATTR16 *)p_attr->p_next;
         }
     }
 
@@ -863,7 +994,7 @@ tGATT_STATUS gatts_write_attr_perm_check (tGATT_SVC_DB *p_db, UINT8 op_code,
 *******************************************************************************/
 static void *allocate_attr_in_db(tGATT_SVC_DB *p_db, UINT16 uuid16, UINT8 *uuid128, tGATT_PERM perm)
 {
-    tGATT_ATTR16    *p_attr16 = NULL, *p_last;
+    tGATT_ATTR16    *p_attr16 = NULL;
     tGATT_ATTR128   *p_attr128 = NULL;
     UINT16      len = (uuid16 == 0) ? sizeof(tGATT_ATTR128): sizeof(tGATT_ATTR16);
 
@@ -918,14 +1049,12 @@ static void *allocate_attr_in_db(tGATT_SVC_DB *p_db, UINT16 uuid16, UINT8 *uuid1
     if (p_db->p_attr_list == NULL)
         p_db->p_attr_list = p_attr16;
     else
-    {
-        p_last = (tGATT_ATTR16 *)p_db->p_attr_list;
+        ((tGATT_ATTR16 *)p_db->p_attr_last)->p_next = p_attr16;
 
-        while (p_last != NULL && p_last->p_next != NULL)
-            p_last = (tGATT_ATTR16 *)p_last->p_next;
+    p_db->p_attr_last = p_attr16;
 
-        p_last->p_next = p_attr16;
-    }
+    if (p_db->p_attr_index != NULL)
+        gatts_db_index_attr(p_db, p_attr16);
 
     if (p_attr16->uuid_type == GATT_ATTR_UUID_TYPE_16)
     {
@@ -970,21 +1099,137 @@ static BOOLEAN deallocate_attr_in_db(tGATT_SVC_DB *p_db, void *p_attr)
         if (p_next == p_attr)
         {
             p_cur->p_next = p_next->p_next;
+            p_db->p_attr_last = p_cur;
             found = TRUE;
         }
     }
     if (p_cur == p_attr && p_cur == p_db->p_attr_list)
     {
-        p_db->p_attr_list = p_cur->p_next;
+        p_db->p_attr_list = p_db->p_attr_last = p_cur->p_next;
         found = TRUE;
     }
     /* else attr not found */
     if ( found)
+    {
+        if (p_db->p_attr_index != NULL)
+            gatts_db_unindex_attr(p_db, (tGATT_ATTR16 *)p_attr);
+
         p_db->next_handle --;
+    }
 
     return found;
 }
 
+/*******************************************************************************
+**
+** Function         gatts_db_alloc_index
+**
+** Description      Allocate the handle index of a service database. The index
+**                  buffer is queued on svc_buffer so that it is released along
+**                  with the attribute records. Services above
+**                  GATT_DB_INDEX_MAX_HDL handles are not indexed.
+**
+** Parameter        p_db: database pointer.
+**                  num_handle: number of handles reserved for the service.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void gatts_db_alloc_index(tGATT_SVC_DB *p_db, UINT16 num_handle)
+{
+    UINT8   *p_buf;
+    UINT16  size;
+
+    p_db->p_attr_index = NULL;
+    p_db->p_decl_next  = NULL;
+    memset(p_db->decl_first, 0, sizeof(p_db->decl_first));
+    memset(p_db->decl_last, 0, sizeof(p_db->decl_last));
+
+    if (num_handle == 0 || num_handle > GATT_DB_INDEX_MAX_HDL)
+    {
+        GATT_TRACE_DEBUG1("gatts_db_alloc_index: %d handles, not indexed", num_handle);
+        return;
+    }
+
+    size = (UINT16)(num_handle * (sizeof(void *) + sizeof(UINT16)));
+
+    if ((p_buf = (UINT8 *)GKI_getbuf(size)) == NULL)
+    {
+        GATT_TRACE_WARNING0("gatts_db_alloc_index: no resources, not indexed");
+        return;
+    }
+
+    memset(p_buf, 0, size);
+    GKI_enqueue(&p_db->svc_buffer, p_buf);
+
+    p_db->p_attr_index = (void **)p_buf;
+    p_db->p_decl_next  = (UINT16 *)(p_db->p_attr_index + num_handle);
+}
+
+/*******************************************************************************
+**
+** Function         gatts_db_index_attr
+**
+** Description      Add a newly allocated attribute to the database index.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void gatts_db_index_attr(tGATT_SVC_DB *p_db, tGATT_ATTR16 *p_attr)
+{
+    UINT16  idx = p_attr->handle - p_db->start_handle;
+    int     decl_type;
+
+    p_db->p_attr_index[idx] = p_attr;
+
+    if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16 &&
+        (decl_type = gatts_db_decl_type(p_attr->uuid)) >= 0)
+    {
+        if (p_db->decl_last[decl_type] == 0)
+            p_db->decl_first[decl_type] = p_attr->handle;
+        else
+            p_db->p_decl_next[p_db->decl_last[decl_type] - p_db->start_handle] = p_attr->handle;
+
+        p_db->p_decl_next[idx] = 0;
+        p_db->decl_last[decl_type] = p_attr->handle;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gatts_db_unindex_attr
+**
+** Description      Remove the last allocated attribute from the database index.
+**
+** Returns          None.
+**
+*******************************************************************************/
+static void gatts_db_unindex_attr(tGATT_SVC_DB *p_db, tGATT_ATTR16 *p_attr)
+{
+    UINT16  handle;
+    int     decl_type;
+
+    p_db->p_attr_index[p_attr->handle - p_db->start_handle] = NULL;
+
+    if (p_attr->uuid_type == GATT_ATTR_UUID_TYPE_16 &&
+        (decl_type = gatts_db_decl_type(p_attr->uuid)) >= 0)
+    {
+        if (p_db->decl_first[decl_type] == p_attr->handle)
+        {
+            p_db->decl_first[decl_type] = p_db->decl_last[decl_type] = 0;
+        }
+        else
+        {
+            handle = p_db->decl_first[decl_type];
+            while (p_db->p_decl_next[handle - p_db->start_handle] != p_attr->handle)
+                handle = p_db->p_decl_next[handle - p_db->start_handle];
+
+            p_db->p_decl_next[handle - p_db->start_handle] = 0;
+            p_db->decl_last[decl_type] = handle;
+        }
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         copy_extra_byte_in_db
@@ -194,17 +194,30 @@ typedef struct
     UINT8                               uuid[LEN_UUID_128];
 } tGATT_ATTR128;
 
+/* declaration types (GATT_UUID_PRI_SERVICE .. GATT_UUID_CHAR_DECLARE) chained
+** in the service database index for Read By Type
+*/
+#define GATT_DB_NUM_DECL_TYPES      4
+
 /* Service Database definition
 */
 typedef struct
 {
     void            *p_attr_list;               /* pointer to the first attribute,
                                                   either tGATT_ATTR16 or tGATT_ATTR128 */
+    void            *p_attr_last;               /* pointer to the last attribute */
     UINT8           *p_free_mem;                /* Pointer to free memory       */
     BUFFER_Q        svc_buffer;                 /* buffer queue used for service database */
     UINT32          mem_free;                   /* Memory still available       */
+    UINT16          start_handle;               /* First handle number          */
     UINT16          end_handle;                 /* Last handle number           */
     UINT16          next_handle;                /* Next usable handle value     */
+    void            **p_attr_index;             /* attribute of each handle, indexed by
+                                                   handle - start_handle; NULL if not indexed */
+    UINT16          *p_decl_next;               /* next declaration handle of the same type,
+                                                   indexed by handle - start_handle */
+    UINT16          decl_first[GATT_DB_NUM_DECL_TYPES]; /* first handle of each declaration type */
+    UINT16          decl_last[GATT_DB_NUM_DECL_TYPES];  /* last handle of each declaration type */
 } tGATT_SVC_DB;
 
 /* Data Structure used for GATT server                                        */
@@ -665,6 +678,8 @@ extern tGATT_STATUS gatts_write_attr_perm_check (tGATT_SVC_DB *p_db, UINT8 op_co
 extern tGATT_STATUS gatts_read_attr_perm_check(tGATT_SVC_DB *p_db, BOOLEAN is_long, UINT16 handle, tGATT_SEC_FLAG sec_flag,UINT8 key_size);
 extern void gatts_update_srv_list_elem(UINT8 i_sreg, UINT16 handle, BOOLEAN is_primary);
 extern tBT_UUID * gatts_get_service_uuid (tGATT_SVC_DB *p_db);
+extern void *gatts_db_find_attr (tGATT_SVC_DB *p_db, UINT16 handle);
+extern void *gatts_db_find_attr_from (tGATT_SVC_DB *p_db, UINT16 s_handle);
 
 #endif
 
@@ -612,7 +612,7 @@ static tGATT_STATUS gatt_build_find_info_rsp(tGATT_SR_REG *p_rcb, BT_HDR *p_msg,
         return status;
 
     /* check the attribute database */
-    p_attr = (tGATT_ATTR16 *) p_rcb->p_db->p_attr_list;
+    p_attr = (tGATT_ATTR16 *) gatts_db_find_attr_from(p_rcb->p_db, s_hdl);
 
     p = (UINT8 *)(p_msg + 1) + L2CAP_MIN_OFFSET + p_msg->len;
 
@@ -1221,7 +1221,6 @@ void gatts_process_attribute_req (tGATT_TCB *p_tcb, UINT8 op_code,
     UINT8           *p = p_data, i;
     tGATT_SR_REG    *p_rcb = gatt_cb.sr_reg;
     tGATT_STATUS    status = GATT_INVALID_HANDLE;
-    tGATT_ATTR16    *p_attr;
 
     STREAM_TO_UINT16(handle, p);
     len -= 2;
@@ -1243,32 +1242,25 @@ void gatts_process_attribute_req (tGATT_TCB *p_tcb, UINT8 op_code,
         {
             if (p_rcb->in_use && p_rcb->s_hdl <= handle && p_rcb->e_hdl >= handle)
             {
-                p_attr = (tGATT_ATTR16 *)p_rcb->p_db->p_attr_list;
-
-                while (p_attr)
+                if (gatts_db_find_attr(p_rcb->p_db, handle) != NULL)
                 {
-                    if (p_attr->handle == handle)
+                    switch (op_code)
                     {
-                        switch (op_code)
-                        {
-                            case GATT_REQ_READ: /* read char/char descriptor value */
-                            case GATT_REQ_READ_BLOB:
-                                gatts_process_read_req(p_tcb, p_rcb, op_code, handle, len, p);
-                                break;
-
-                            case GATT_REQ_WRITE: /* write char/char descriptor value */
-                            case GATT_CMD_WRITE:
-                            case GATT_SIGN_CMD_WRITE:
-                            case GATT_REQ_PREPARE_WRITE:
-                                gatts_process_write_req(p_tcb, i, handle, op_code, len, p);
-                                break;
-                            default:
-                                break;
-                        }
-                        status = GATT_SUCCESS;
-                        break;
+                        case GATT_REQ_READ: /* read char/char descriptor value */
+                        case GATT_REQ_READ_BLOB:
+                            gatts_process_read_req(p_tcb, p_rcb, op_code, handle, len, p);
+                            break;
+
+                        case GATT_REQ_WRITE: /* write char/char descriptor value */
+                        case GATT_CMD_WRITE:
+                        case GATT_SIGN_CMD_WRITE:
+                        case GATT_REQ_PREPARE_WRITE:
+                            gatts_process_write_req(p_tcb, i, handle, op_code, len, p);
+                            break;
+                        default:
+                            break;
                     }
-                    p_attr = (tGATT_ATTR16 *)p_attr->p_next;
+                    status = GATT_SUCCESS;
                 }
                 break;
             }
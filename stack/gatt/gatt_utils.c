@@ -384,6 +384,9 @@ void gatt_free_srvc_db_buffer_app_id(tBT_UUID *p_app_id)
 
             p_elem->svc_db.mem_free = 0;
             p_elem->svc_db.p_attr_list = p_elem->svc_db.p_free_mem = NULL;
+            p_elem->svc_db.p_attr_last = NULL;
+            p_elem->svc_db.p_attr_index = NULL;
+            p_elem->svc_db.p_decl_next = NULL;
         }
     }
 }
@@ -101,8 +101,16 @@ typedef int  (tPORT_DATA_CALLBACK) (UINT16 port_handle, void *p_data, UINT16 len
 #define DATA_CO_CALLBACK_TYPE_INCOMING          1
 #define DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE     2
 #define DATA_CO_CALLBACK_TYPE_OUTGOING          3
+#define DATA_CO_CALLBACK_TYPE_OUTGOING_VECTOR   4   /* p_buf is a tPORT_CO_SEG array, len its count */
 typedef int  (tPORT_DATA_CO_CALLBACK) (UINT16 port_handle, UINT8* p_buf, UINT16 len, int type);
 
+/* One buffer to be filled by DATA_CO_CALLBACK_TYPE_OUTGOING_VECTOR */
+typedef struct
+{
+    UINT8   *p_data;
+    UINT16  len;
+} tPORT_CO_SEG;
+
 typedef void (tPORT_CALLBACK) (UINT32 code, UINT16 port_handle);
 
 /*
@@ -156,6 +156,12 @@ typedef struct
     UINT8   param_buf[BT_OCTET16_LEN];
 } tSMP_ENC;
 
+/* AES-128 round keys, FIPS-197 byte order */
+typedef struct
+{
+    UINT8   rk[11 * BT_OCTET16_LEN];
+} tSMP_AES_KEY;
+
 /* Simple Pairing Events.  Called by the stack when Simple Pairing related
 ** events occur.
 */
@@ -294,6 +300,37 @@ extern "C"
                                         UINT8 *plain_text, UINT8 pt_len,
                                         tSMP_ENC *p_out);
 
+/*******************************************************************************
+**
+** Function         SMP_AesSetKey
+**
+** Description      This function expands an AES-128 key into the round keys
+**                  used by SMP_MatchRpa().
+**
+** Parameters:      key                 - the key, key[0] contains the LSB
+**                  p_ks                - the expanded key
+**
+**  Returns         void
+*******************************************************************************/
+    SMP_API extern void SMP_AesSetKey (BT_OCTET16 key, tSMP_AES_KEY *p_ks);
+
+/*******************************************************************************
+**
+** Function         SMP_MatchRpa
+**
+** Description      This function looks for the IRK a resolvable private
+**                  address was generated from. The random part of the
+**                  address is hashed with all the keys in one pass, several
+**                  keys at a time where the CPU has AES instructions.
+**
+** Parameters:      rpa                 - the resolvable private address
+**                  p_ks                - IRKs expanded with SMP_AesSetKey()
+**                  num_keys            - number of keys at p_ks
+**
+**  Returns         index of the first matching key, num_keys if none matches
+*******************************************************************************/
+    SMP_API extern UINT16 SMP_MatchRpa (BD_ADDR rpa, const tSMP_AES_KEY *p_ks, UINT16 num_keys);
+
 #ifdef __cplusplus
 }
 #endif
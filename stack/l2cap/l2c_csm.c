@@ -1313,6 +1313,8 @@ void l2c_enqueue_peer_data (tL2C_CCB *p_ccb, BT_HDR *p_buf)
 
     GKI_enqueue (&p_ccb->xmit_hold_q, p_buf);
 
+    l2cu_mark_chnl_ready (p_ccb);
+
     l2cu_check_channel_congestion (p_ccb);
 
 #if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
@@ -272,6 +272,16 @@ typedef struct
 } tL2C_RCB;
 
 
+/* Transmit scheduler counters kept per channel
+*/
+typedef struct
+{
+    UINT32              pkts;                   /* PDUs handed to the link          */
+    UINT32              bytes;                  /* Bytes handed to the link         */
+    UINT32              turns;                  /* Deficit round-robin turns taken  */
+    UINT32              blocked;                /* Times passed over with data held */
+} tL2C_CCB_TX_STATS;
+
 /* Define a channel control block (CCB). There may be many channel control blocks
 ** between the same two Bluetooth devices (i.e. on the same link).
 ** Each CCB has unique local and remote CIDs. All channel control blocks on
@@ -337,6 +347,13 @@ typedef struct t_l2c_ccb
     BOOLEAN             is_flushable;                   /* TRUE if channel is flushable     */
 #endif
 
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    struct t_l2c_ccb    *p_next_ready;          /* Next CCB on the priority ready list */
+    BOOLEAN             is_ready;               /* TRUE when on the ready list      */
+    INT32               deficit;                /* DRR byte credit, may go negative */
+#endif
+    tL2C_CCB_TX_STATS   tx_stats;               /* Transmit scheduler counters      */
+
 #if (L2CAP_NUM_FIXED_CHNLS > 0) || (L2CAP_UCD_INCLUDED == TRUE)
     UINT16              fixed_chnl_idle_tout;   /* Idle timeout to use for the fixed channel       */
 #endif
@@ -363,11 +380,14 @@ typedef struct
 /* It will make sure that low priority channel (for example, HF signaling on RFCOMM)      */
 /* can be sent to headset even if higher priority channel (for example, AV media channel) */
 /* is congested.                                                                          */
+/* Only channels holding data sit on the ready list of their group. The head of the list  */
+/* is served while its deficit lasts (deficit round robin), then moves to the tail.       */
 
 typedef struct
 {
-    tL2C_CCB        *p_serve_ccb;               /* current serving ccb within priority group */
-    tL2C_CCB        *p_first_ccb;               /* first ccb of priority group */
+    tL2C_CCB        *p_first_ready;             /* first channel with data, served next */
+    tL2C_CCB        *p_last_ready;              /* last channel with data */
+    UINT8           num_ready;                  /* number of channels on the ready list */
     UINT8           num_ccb;                    /* number of channels in priority group */
     UINT8           quota;                      /* burst transmission quota */
 } tL2C_RR_SERV;
@@ -455,8 +475,26 @@ typedef struct t_l2c_linkcb
     UINT8               rr_pri;                             /* current serving priority group */
 #endif
 
+    struct t_l2c_linkcb *p_next_ready;              /* Next LCB on the ready list       */
+    BOOLEAN             is_ready;                   /* TRUE when on a ready list        */
+    INT32               deficit;                    /* DRR byte credit, may go negative */
+
 } tL2C_LCB;
 
+/* Links that have data to send are kept on a ready list per ACL priority; high
+** priority links are served first. The head of a list is served while its deficit
+** lasts (deficit round robin), whether it has a quota of its own or shares the
+** round-robin quota, then moves to the tail.
+*/
+#define L2C_NUM_ACL_PRIORITY    (L2CAP_PRIORITY_HIGH + 1)
+
+typedef struct
+{
+    tL2C_LCB        *p_first;                       /* Link served next                 */
+    tL2C_LCB        *p_last;
+    UINT16          count;
+} tL2C_LCB_READY_Q;
+
 /* Define the L2CAP control structure
 */
 typedef struct
@@ -467,6 +505,7 @@ typedef struct
     UINT16          round_robin_quota;              /* Round-robin link quota           */
     UINT16          round_robin_unacked;            /* Round-robin unacked              */
     BOOLEAN         check_round_robin;              /* Do a round robin check           */
+    tL2C_LCB_READY_Q rr_ready_q[L2C_NUM_ACL_PRIORITY]; /* Links with data to send       */
 
     BOOLEAN         is_cong_cback_context;
 
@@ -679,6 +718,8 @@ extern BOOLEAN  l2cu_lcb_disconnecting (void);
 extern BOOLEAN l2cu_create_conn (tL2C_LCB *p_lcb);
 extern BOOLEAN l2cu_create_conn_after_switch (tL2C_LCB *p_lcb);
 extern BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb);
+extern void    l2cu_mark_chnl_ready (tL2C_CCB *p_ccb);
+extern BOOLEAN l2cu_lcb_has_xmit_data (tL2C_LCB *p_lcb);
 extern void    l2cu_resubmit_pending_sec_req (BD_ADDR p_bda);
 extern void    l2cu_initialize_amp_ccb (tL2C_LCB *p_lcb);
 extern void    l2cu_adjust_out_mps (tL2C_CCB *p_ccb);
@@ -693,6 +734,8 @@ extern BOOLEAN  l2c_link_hci_qos_violation (UINT16 handle);
 extern void     l2c_link_timeout (tL2C_LCB *p_lcb);
 extern void     l2c_info_timeout (tL2C_LCB *p_lcb);
 extern void     l2c_link_check_send_pkts (tL2C_LCB *p_lcb, tL2C_CCB *p_ccb, BT_HDR *p_buf);
+extern void     l2c_link_mark_ready (tL2C_LCB *p_lcb);
+extern void     l2c_link_clear_ready (tL2C_LCB *p_lcb);
 extern void     l2c_link_adjust_allocation (void);
 extern void     l2c_link_process_num_completed_pkts (UINT8 *p);
 extern void     l2c_link_process_num_completed_blocks (UINT8 controller_id, UINT8 *p, UINT16 evt_len);
@@ -762,6 +762,10 @@ void l2c_link_adjust_allocation (void)
 #if L2CAP_HOST_FLOW_CTRL
             p_lcb->link_ack_thresh = L2CAP_HOST_FC_ACL_BUFS / l2cb.num_links_active;
 #endif
+            /* A link whose quota changed must not strand what it has queued */
+            if (l2cu_lcb_has_xmit_data (p_lcb))
+                l2c_link_mark_ready (p_lcb);
+
             L2CAP_TRACE_EVENT3 ("l2c_link_adjust_allocation LCB %d   Priority: %d  XmitQuota: %d",
                                 yy, p_lcb->acl_priority, p_lcb->link_xmit_quota);
 
@@ -1085,6 +1089,226 @@ BOOLEAN l2c_link_check_power_mode (tL2C_LCB *p_lcb)
 }
 #endif /* ((BTM_PWR_MGR_INCLUDED == TRUE) && L2CAP_WAKE_PARKED_LINK == TRUE) */
 
+/*******************************************************************************
+**
+** Function         l2c_link_mark_ready
+**
+** Description      This function puts a link on the ready list of its ACL
+**                  priority, if it is not on one yet.
+**
+** Returns          void
+**
+*******************************************************************************/
+void l2c_link_mark_ready (tL2C_LCB *p_lcb)
+{
+    tL2C_LCB_READY_Q    *p_q;
+
+    if (p_lcb->is_ready)
+        return;
+
+    p_q = &l2cb.rr_ready_q[(p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) ? L2CAP_PRIORITY_HIGH : L2CAP_PRIORITY_NORMAL];
+
+    p_lcb->p_next_ready = NULL;
+    if (p_q->p_last)
+        p_q->p_last->p_next_ready = p_lcb;
+    else
+        p_q->p_first = p_lcb;
+
+    p_q->p_last = p_lcb;
+    p_q->count++;
+    p_lcb->is_ready = TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         l2c_link_clear_ready
+**
+** Description      This function takes a link off the ready list it is on, if
+**                  any. Credit left from its turn is dropped, debt is kept.
+**
+** Returns          void
+**
+*******************************************************************************/
+void l2c_link_clear_ready (tL2C_LCB *p_lcb)
+{
+    tL2C_LCB_READY_Q    *p_q;
+    tL2C_LCB            *p_prev;
+    int                 xx;
+
+    if (!p_lcb->is_ready)
+        return;
+
+    for (xx = 0, p_q = &l2cb.rr_ready_q[0]; xx < L2C_NUM_ACL_PRIORITY; xx++, p_q++)
+    {
+        if (p_q->p_first == p_lcb)
+        {
+            p_prev = NULL;
+            p_q->p_first = p_lcb->p_next_ready;
+        }
+        else
+        {
+            for (p_prev = p_q->p_first; p_prev; p_prev = p_prev->p_next_ready)
+            {
+                if (p_prev->p_next_ready == p_lcb)
+                    break;
+            }
+            if (p_prev == NULL)
+                continue;
+
+            p_prev->p_next_ready = p_lcb->p_next_ready;
+        }
+
+        if (p_q->p_last == p_lcb)
+            p_q->p_last = p_prev;
+
+        p_q->count--;
+        break;
+    }
+
+    p_lcb->p_next_ready = NULL;
+    p_lcb->is_ready     = FALSE;
+
+    if (p_lcb->deficit > 0)
+        p_lcb->deficit = 0;
+}
+
+/*******************************************************************************
+**
+** Function         l2c_link_rotate_ready
+**
+** Description      This function moves a link from the head of a ready list
+**                  to its tail. Nothing is done if the link is no
+**                  longer at the head (L2CAP was re-entered while sending).
+**
+** Returns          void
+**
+*******************************************************************************/
+static void l2c_link_rotate_ready (tL2C_LCB_READY_Q *p_q, tL2C_LCB *p_lcb)
+{
+    if ( (p_q->p_first != p_lcb) || (p_q->p_last == p_lcb) )
+        return;
+
+    p_q->p_first        = p_lcb->p_next_ready;
+    p_lcb->p_next_ready = NULL;
+    p_q->p_last->p_next_ready = p_lcb;
+    p_q->p_last         = p_lcb;
+}
+
+/*******************************************************************************
+**
+** Function         l2c_link_can_send
+**
+** Description      This function checks if a link may send a packet now: the
+**                  controller has room for it, it has no segment pending, and
+**                  it is under its own quota, or under the round-robin quota
+**                  if it has none.
+**
+** Returns          TRUE if it may send
+**
+*******************************************************************************/
+static BOOLEAN l2c_link_can_send (tL2C_LCB *p_lcb)
+{
+#if (BLE_INCLUDED == TRUE)
+    if (p_lcb->is_ble_link)
+    {
+        if (l2cb.controller_le_xmit_window == 0)
+            return (FALSE);
+    }
+    else
+#endif
+    if (l2cb.controller_xmit_window == 0)
+        return (FALSE);
+
+    if ( (p_lcb->partial_segment_being_sent)
+      || (p_lcb->link_state != LST_CONNECTED)
+      || (L2C_LINK_CHECK_POWER_MODE (p_lcb)) )
+        return (FALSE);
+
+    if (p_lcb->link_xmit_quota == 0)
+        return (l2cb.round_robin_unacked < l2cb.round_robin_quota);
+
+    return (p_lcb->sent_not_acked < p_lcb->link_xmit_quota);
+}
+
+/*******************************************************************************
+**
+** Function         l2c_link_serve_ready_q
+**
+** Description      This function serves a ready list by deficit round robin.
+**                  The head link is granted L2CAP_DRR_QUANTUM bytes when its
+**                  turn starts and sends while its deficit lasts, each packet
+**                  charged by length, then moves to the tail. Links that have
+**                  nothing queued leave the list, blocked ones keep their
+**                  place. It stops after a full pass over the list without
+**                  sending anything.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void l2c_link_serve_ready_q (tL2C_LCB_READY_Q *p_q, BOOLEAN single_write)
+{
+    tL2C_LCB    *p_lcb;
+    BT_HDR      *p_buf;
+    UINT16      num_idle = 0;
+    UINT16      len;
+
+    while ( ((p_lcb = p_q->p_first) != NULL) && (num_idle < p_q->count) )
+    {
+        /* Links that went away leave the list */
+        if (!p_lcb->in_use)
+        {
+            l2c_link_clear_ready (p_lcb);
+            continue;
+        }
+
+        /* and so do links whose ACL priority changed, for the other list */
+        if (p_q != &l2cb.rr_ready_q[(p_lcb->acl_priority == L2CAP_PRIORITY_HIGH) ? L2CAP_PRIORITY_HIGH : L2CAP_PRIORITY_NORMAL])
+        {
+            l2c_link_clear_ready (p_lcb);
+            l2c_link_mark_ready (p_lcb);
+            continue;
+        }
+
+        /* If controller window is full, the link is busy or over its quota, try the next one */
+        if (!l2c_link_can_send (p_lcb))
+        {
+            l2c_link_rotate_ready (p_q, p_lcb);
+            num_idle++;
+            continue;
+        }
+
+        /* See if we can send anything from the Link Queue, then the channel queues */
+        if ( ((p_buf = (BT_HDR *)GKI_dequeue (&p_lcb->link_xmit_data_q)) == NULL)
+          && (!single_write) )
+            p_buf = l2cu_get_next_buffer_to_send (p_lcb);
+
+        if (p_buf != NULL)
+        {
+            num_idle = 0;
+
+            /* A new turn grants a quantum, the packet is charged by length */
+            if (p_lcb->deficit <= 0)
+                p_lcb->deficit += L2CAP_DRR_QUANTUM;
+
+            len = p_buf->len;
+            l2c_link_send_to_lower (p_lcb, p_buf);
+
+            p_lcb->deficit -= len;
+            if (p_lcb->deficit <= 0)
+                l2c_link_rotate_ready (p_q, p_lcb);
+        }
+        else
+        {
+            num_idle++;
+
+            if ( (!single_write) && (!l2cu_lcb_has_xmit_data (p_lcb)) )
+                l2c_link_clear_ready (p_lcb);
+            else
+                l2c_link_rotate_ready (p_q, p_lcb);
+        }
+    }
+}
+
 /*******************************************************************************
 **
 ** Function         l2c_link_check_send_pkts
@@ -1093,12 +1317,17 @@ BOOLEAN l2c_link_check_power_mode (tL2C_LCB *p_lcb)
 **                  to the Host Controller. It may be passed the address of
 **                  a packet to send.
 **
+**                  Links with their own quota and links sharing the
+**                  round-robin quota are served from the same ready lists,
+**                  high priority links first, so the controller buffers
+**                  they compete for are shared by bytes sent, not by the
+**                  order the links were created in.
+**
 ** Returns          void
 **
 *******************************************************************************/
 void l2c_link_check_send_pkts (tL2C_LCB *p_lcb, tL2C_CCB *p_ccb, BT_HDR *p_buf)
 {
-    int         xx;
     BOOLEAN     single_write = FALSE;
 
     /* Save the channel ID for faster counting */
@@ -1119,128 +1348,35 @@ void l2c_link_check_send_pkts (tL2C_LCB *p_lcb, tL2C_CCB *p_ccb, BT_HDR *p_buf)
             l2cb.check_round_robin = TRUE;
     }
 
+    if (p_lcb != NULL)
+        l2c_link_mark_ready (p_lcb);
+
     /* If this is called from uncongested callback context break recursive calling.
     ** This LCB will be served when receiving number of completed packet event.
     */
     if (l2cb.is_cong_cback_context)
         return;
 
-    /* If we are in a scenario where there are not enough buffers for each link to
-    ** have at least 1, then do a round-robin for all the LCBs
-    */
-    if ( (p_lcb == NULL) || (p_lcb->link_xmit_quota == 0) )
-    {
-        if (p_lcb == NULL)
-            p_lcb = l2cb.lcb_pool;
-        else if (!single_write)
-            p_lcb++;
+    l2c_link_serve_ready_q (&l2cb.rr_ready_q[L2CAP_PRIORITY_HIGH], single_write);
+    l2c_link_serve_ready_q (&l2cb.rr_ready_q[L2CAP_PRIORITY_NORMAL], single_write);
 
-        /* Loop through, starting at the next */
-        for (xx = 0; xx < MAX_L2CAP_LINKS; xx++, p_lcb++)
-        {
-            /* If controller window is full, nothing to do */
-            if ( (l2cb.controller_xmit_window == 0
-#if (BLE_INCLUDED == TRUE)
-                  && !p_lcb->is_ble_link
-#endif
-                )
+    /* If we finished without using up our quota, no need for a safety check */
 #if (BLE_INCLUDED == TRUE)
-                || (p_lcb->is_ble_link && l2cb.controller_le_xmit_window == 0 )
-#endif
-              || (l2cb.round_robin_unacked >= l2cb.round_robin_quota) )
-                break;
-
-            /* Check for wraparound */
-            if (p_lcb == &l2cb.lcb_pool[MAX_L2CAP_LINKS])
-                p_lcb = &l2cb.lcb_pool[0];
-
-            if ( (!p_lcb->in_use)
-               || (p_lcb->partial_segment_being_sent)
-               || (p_lcb->link_state != LST_CONNECTED)
-               || (p_lcb->link_xmit_quota != 0)
-               || (L2C_LINK_CHECK_POWER_MODE (p_lcb)) )
-                continue;
-
-            /* See if we can send anything from the Link Queue */
-            if ((p_buf = (BT_HDR *)GKI_dequeue (&p_lcb->link_xmit_data_q)) != NULL)
-            {
-                l2c_link_send_to_lower (p_lcb, p_buf);
-            }
-            else if (single_write)
-            {
-                /* If only doing one write, break out */
-                break;
-            }
-            /* If nothing on the link queue, check the channel queue */
-            else if ((p_buf = l2cu_get_next_buffer_to_send (p_lcb)) != NULL)
-            {
-                l2c_link_send_to_lower (p_lcb, p_buf);
-            }
-        }
-
-        /* If we finished without using up our quota, no need for a safety check */
-#if (BLE_INCLUDED == TRUE)
-        if ( ((l2cb.controller_xmit_window > 0 && !p_lcb->is_ble_link) ||
-             (l2cb.controller_le_xmit_window > 0 && p_lcb->is_ble_link))
-          && (l2cb.round_robin_unacked < l2cb.round_robin_quota) )
-#else
-        if ( (l2cb.controller_xmit_window > 0)
-          && (l2cb.round_robin_unacked < l2cb.round_robin_quota) )
-
-#endif
-            l2cb.check_round_robin = FALSE;
-    }
-    else /* if this is not round-robin service */
-    {
-        /* If a partial segment is being sent, can't send anything else */
-        if ( (p_lcb->partial_segment_being_sent)
-          || (p_lcb->link_state != LST_CONNECTED)
-          || (L2C_LINK_CHECK_POWER_MODE (p_lcb)) )
-            return;
-
-        /* See if we can send anything from the link queue */
-#if (BLE_INCLUDED == TRUE)
-        while ( ((l2cb.controller_xmit_window != 0 && !p_lcb->is_ble_link) ||
-                 (l2cb.controller_le_xmit_window != 0 && p_lcb->is_ble_link))
-             && (p_lcb->sent_not_acked < p_lcb->link_xmit_quota))
-#else
-        while ( (l2cb.controller_xmit_window != 0)
-             && (p_lcb->sent_not_acked < p_lcb->link_xmit_quota))
-#endif
-        {
-            if ((p_buf = (BT_HDR *)GKI_dequeue (&p_lcb->link_xmit_data_q)) == NULL)
-                break;
-
-            if (!l2c_link_send_to_lower (p_lcb, p_buf))
-                break;
-        }
-
-        if (!single_write)
-        {
-            /* See if we can send anything for any channel */
-#if (BLE_INCLUDED == TRUE)
-            while ( ((l2cb.controller_xmit_window != 0 && !p_lcb->is_ble_link) ||
-                    (l2cb.controller_le_xmit_window != 0 && p_lcb->is_ble_link))
-                    && (p_lcb->sent_not_acked < p_lcb->link_xmit_quota))
+    if ( (l2cb.controller_xmit_window > 0)
+      && (l2cb.controller_le_xmit_window > 0)
+      && (l2cb.round_robin_unacked < l2cb.round_robin_quota) )
 #else
-            while ((l2cb.controller_xmit_window != 0) && (p_lcb->sent_not_acked < p_lcb->link_xmit_quota))
+    if ( (l2cb.controller_xmit_window > 0)
+      && (l2cb.round_robin_unacked < l2cb.round_robin_quota) )
 #endif
-            {
-                if ((p_buf = l2cu_get_next_buffer_to_send (p_lcb)) == NULL)
-                    break;
-
-                if (!l2c_link_send_to_lower (p_lcb, p_buf))
-                    break;
-            }
-        }
-
-        /* There is a special case where we have readjusted the link quotas and  */
-        /* this link may have sent anything but some other link sent packets so  */
-        /* so we may need a timer to kick off this link's transmissions.         */
-        if ( (p_lcb->link_xmit_data_q.count) && (p_lcb->sent_not_acked < p_lcb->link_xmit_quota) )
-            btu_start_timer (&p_lcb->timer_entry, BTU_TTYPE_L2CAP_LINK, L2CAP_LINK_FLOW_CONTROL_TOUT);
-    }
-
+        l2cb.check_round_robin = FALSE;
+
+    /* There is a special case where we have readjusted the link quotas and  */
+    /* this link may have sent anything but some other link sent packets so  */
+    /* so we may need a timer to kick off this link's transmissions.         */
+    if ( (p_lcb != NULL) && (p_lcb->link_xmit_quota != 0)
+      && (p_lcb->link_xmit_data_q.count) && (p_lcb->sent_not_acked < p_lcb->link_xmit_quota) )
+        btu_start_timer (&p_lcb->timer_entry, BTU_TTYPE_L2CAP_LINK, L2CAP_LINK_FLOW_CONTROL_TOUT);
 }
 
 /*******************************************************************************
@@ -1391,6 +1527,7 @@ void l2c_link_process_num_completed_pkts (UINT8 *p)
     UINT16      handle;
     UINT16      num_sent;
     tL2C_LCB    *p_lcb;
+    BOOLEAN     any_lcb = FALSE;
 
     STREAM_TO_UINT8 (num_handles, p);
 
@@ -1438,15 +1575,7 @@ void l2c_link_process_num_completed_pkts (UINT8 *p)
             else
                 p_lcb->sent_not_acked = 0;
 
-            l2c_link_check_send_pkts (p_lcb, NULL, NULL);
-
-            /* If we were doing round-robin for low priority links, check 'em */
-            if ( (p_lcb->acl_priority == L2CAP_PRIORITY_HIGH)
-              && (l2cb.check_round_robin)
-              && (l2cb.round_robin_unacked < l2cb.round_robin_quota) )
-            {
-              l2c_link_check_send_pkts (NULL, NULL, NULL);
-            }
+            any_lcb = TRUE;
         }
 
 #if (L2CAP_HCI_FLOW_CONTROL_DEBUG == TRUE)
@@ -1488,6 +1617,11 @@ void l2c_link_process_num_completed_pkts (UINT8 *p)
 #endif
     }
 
+    /* Serve the links once all the buffers are back, so the first handle of the */
+    /* event does not get to fill the controller window before the others.       */
+    if (any_lcb)
+        l2c_link_check_send_pkts (NULL, NULL, NULL);
+
 #if (defined(HCILP_INCLUDED) && HCILP_INCLUDED == TRUE)
     /* only full stack can enable sleep mode */
     btu_check_bt_sleep ();
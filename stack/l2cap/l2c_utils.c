@@ -37,6 +37,10 @@
 #include "btm_int.h"
 #include "hcidefs.h"
 
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+static void l2cu_clear_chnl_ready (tL2C_CCB *p_ccb);
+#endif
+
 /*******************************************************************************
 **
 ** Function         l2cu_allocate_lcb
@@ -174,6 +178,8 @@ void l2cu_release_lcb (tL2C_LCB *p_lcb)
     while (p_lcb->link_xmit_data_q.p_first)
         GKI_freebuf (GKI_dequeue (&p_lcb->link_xmit_data_q));
 
+    l2c_link_clear_ready (p_lcb);
+
 #if (L2CAP_UCD_INCLUDED == TRUE)
     /* clean up any security pending UCD */
     l2c_ucd_delete_sec_pending_q(p_lcb);
@@ -1173,15 +1179,15 @@ void l2cu_enqueue_ccb (tL2C_CCB *p_ccb)
         /* if this is the first channel in this priority group */
         if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb == 0 )
         {
-        	/* Set the first channel to this CCB */
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
-        	/* Set the next serving channel in this group to this CCB */
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
         	/* Initialize quota of this priority group based on its priority */
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota = L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
         }
         /* increase number of channels in this group */
         p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb++;
+
+        /* a channel re-queued with data pending goes straight on the ready list */
+        if ( (p_ccb->xmit_hold_q.count) || (p_ccb->fcrb.retrans_q.count) )
+            l2cu_mark_chnl_ready (p_ccb);
     }
 #endif
 
@@ -1218,30 +1224,11 @@ void l2cu_dequeue_ccb (tL2C_CCB *p_ccb)
     /* Removing CCB from round robin service table of its LCB */
     if (p_ccb->p_lcb != NULL)
     {
+        /* take the channel off the ready list of its group */
+        l2cu_clear_chnl_ready (p_ccb);
+
         /* decrease number of channels in this priority group */
         p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb--;
-
-        /* if it was the last channel in the priority group */
-        if (p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb == 0 )
-        {
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = NULL;
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = NULL;
-        }
-        else
-        {
-            /* if it is the first channel of this group */
-            if ( p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb == p_ccb )
-            {
-                p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb->p_next_ccb;
-            }
-            /* if it is the next serving channel of this group */
-            if ( p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb == p_ccb )
-            {
-                /* simply, start serving from the first channel */
-                p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb
-                    = p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb;
-            }
-        }
     }
 #endif
 
@@ -1300,16 +1287,16 @@ void l2cu_change_pri_ccb (tL2C_CCB *p_ccb, tL2CAP_CHNL_PRIORITY priority)
         {
         	/* If CCB is the only guy on the queue, no need to re-enqueue */
             /* update only round robin service data */
+            l2cu_clear_chnl_ready (p_ccb);
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb = 0;
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = NULL;
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = NULL;
 
             p_ccb->ccb_priority = priority;
 
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ccb = p_ccb;
-            p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].p_serve_ccb = p_ccb;
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].quota = L2CAP_GET_PRIORITY_QUOTA(p_ccb->ccb_priority);
             p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority].num_ccb = 1;
+
+            if ( (p_ccb->xmit_hold_q.count) || (p_ccb->fcrb.retrans_q.count) )
+                l2cu_mark_chnl_ready (p_ccb);
         }
 #endif
     }
@@ -1374,6 +1361,13 @@ tL2C_CCB *l2cu_allocate_ccb (tL2C_LCB *p_lcb, UINT16 cid)
 
     p_ccb->p_next_ccb = p_ccb->p_prev_ccb = NULL;
 
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    p_ccb->p_next_ready = NULL;
+    p_ccb->is_ready     = FALSE;
+    p_ccb->deficit      = 0;
+#endif
+    memset (&p_ccb->tx_stats, 0, sizeof (tL2C_CCB_TX_STATS));
+
     p_ccb->in_use = TRUE;
 
     /* Get a CID for the connection */
@@ -1554,6 +1548,10 @@ void l2cu_release_ccb (tL2C_CCB *p_ccb)
 
     l2c_fcr_cleanup (p_ccb);
 
+    L2CAP_TRACE_DEBUG5 ("l2cu_release_ccb: cid 0x%04x  tx pkts: %u  bytes: %u  turns: %u  blocked: %u",
+                        p_ccb->local_cid, p_ccb->tx_stats.pkts, p_ccb->tx_stats.bytes,
+                        p_ccb->tx_stats.turns, p_ccb->tx_stats.blocked);
+
     /* Channel may not be assigned to any LCB if it was just pre-reserved */
     if ( (p_lcb) &&
          ( (p_ccb->local_cid >= L2CAP_BASE_APPL_CID)
@@ -3012,86 +3010,199 @@ tL2C_CCB *l2cu_find_ccb_by_cid (tL2C_LCB *p_lcb, UINT16 local_cid)
 
 /******************************************************************************
 **
-** Function         l2cu_get_next_channel_in_rr
+** Function         l2cu_rotate_ready_chnl
 **
-** Description      get the next channel to send on a link. It also adjusts the
-**                  CCB queue to do a basic priority and round-robin scheduling.
+** Description      Move the channel at the head of a ready list to its tail.
 **
-** Returns          pointer to CCB or NULL
+** Returns          None
 **
 *******************************************************************************/
-static tL2C_CCB *l2cu_get_next_channel_in_rr(tL2C_LCB *p_lcb)
+static void l2cu_rotate_ready_chnl (tL2C_RR_SERV *p_serv)
 {
-    tL2C_CCB    *p_serve_ccb = NULL;
-    tL2C_CCB    *p_ccb;
+    tL2C_CCB    *p_ccb = p_serv->p_first_ready;
+
+    if (p_ccb == p_serv->p_last_ready)
+        return;
 
-    int i, j;
+    p_serv->p_first_ready = p_ccb->p_next_ready;
+    p_ccb->p_next_ready   = NULL;
+    p_serv->p_last_ready->p_next_ready = p_ccb;
+    p_serv->p_last_ready  = p_ccb;
+}
 
-    /* scan all of priority until finding a channel to serve */
-    for ( i = 0; (i < L2CAP_NUM_CHNL_PRIORITY)&&(!p_serve_ccb); i++ )
+/******************************************************************************
+**
+** Function         l2cu_clear_chnl_ready
+**
+** Description      Take a channel off the ready list of its priority group.
+**                  Any unused credit is dropped, debt is kept.
+**
+** Returns          None
+**
+*******************************************************************************/
+static void l2cu_clear_chnl_ready (tL2C_CCB *p_ccb)
+{
+    tL2C_RR_SERV    *p_serv;
+    tL2C_CCB        *p_prev;
+
+    if (!p_ccb->is_ready)
+        return;
+
+    p_serv = &p_ccb->p_lcb->rr_serv[p_ccb->ccb_priority];
+
+    if (p_serv->p_first_ready == p_ccb)
+    {
+        p_prev = NULL;
+        p_serv->p_first_ready = p_ccb->p_next_ready;
+    }
+    else
+    {
+        for (p_prev = p_serv->p_first_ready; p_prev->p_next_ready != p_ccb; p_prev = p_prev->p_next_ready)
+            ;
+        p_prev->p_next_ready = p_ccb->p_next_ready;
+    }
+
+    if (p_serv->p_last_ready == p_ccb)
+        p_serv->p_last_ready = p_prev;
+
+    p_serv->num_ready--;
+
+    p_ccb->p_next_ready = NULL;
+    p_ccb->is_ready     = FALSE;
+
+    if (p_ccb->deficit > 0)
+        p_ccb->deficit = 0;
+}
+
+/******************************************************************************
+**
+** Function         l2cu_chnl_can_send
+**
+** Description      Check if a channel holding data may send now. Basic mode
+**                  channels only need to be open, eRTM/streaming channels
+**                  also need the peer window and the pool to allow it.
+**
+** Returns          TRUE if the channel may send
+**
+*******************************************************************************/
+static BOOLEAN l2cu_chnl_can_send (tL2C_CCB *p_ccb)
+{
+    if (p_ccb->chnl_state != CST_OPEN)
+        return (FALSE);
+
+    /* eL2CAP option in use */
+    if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
     {
-        /* scan all channel within serving priority group until finding a channel to serve */
-        for ( j = 0; (j < p_lcb->rr_serv[p_lcb->rr_pri].num_ccb)&&(!p_serve_ccb); j++)
+        if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy)
+            return (FALSE);
+
+        /* No more checks needed if sending from the retransmit queue */
+        if (p_ccb->fcrb.retrans_q.count == 0)
         {
-            /* scaning from next serving channel */
-            p_ccb = p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb;
+            /* If using the common pool, should be at least 10% free. */
+            if ( (p_ccb->ertm_info.fcr_tx_pool_id == HCI_ACL_POOL_ID) && (GKI_poolutilization (HCI_ACL_POOL_ID) > 90) )
+                return (FALSE);
 
-            if (!p_ccb)
-            {
-                L2CAP_TRACE_ERROR1("p_serve_ccb is NULL, rr_pri=%d", p_lcb->rr_pri);
-                return NULL;
-            }
+            /* If in eRTM mode, check for window closure */
+            if ( (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) && (l2c_fcr_is_flow_controlled (p_ccb)) )
+                return (FALSE);
+        }
+    }
 
-            L2CAP_TRACE_DEBUG3("RR scan pri=%d, lcid=0x%04x, q_cout=%d",
-                                p_ccb->ccb_priority, p_ccb->local_cid, p_ccb->xmit_hold_q.count );
+    return (TRUE);
+}
 
-            /* store the next serving channel */
-            /* this channel is the last channel of its priority group */
-            if (( p_ccb->p_next_ccb == NULL )
-              ||( p_ccb->p_next_ccb->ccb_priority != p_ccb->ccb_priority ))
-            {
-                /* next serving channel is set to the first channel in the group */
-                p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb = p_lcb->rr_serv[p_lcb->rr_pri].p_first_ccb;
-            }
-            else
+/******************************************************************************
+**
+** Function         l2cu_get_next_ready_chnl
+**
+** Description      Deficit round robin over the ready list of a priority
+**                  group. The channel at the head keeps being served while
+**                  it has credit; a new turn adds a quantum weighted by its
+**                  Tx data rate. Channels found empty leave the list, blocked
+**                  ones are moved to the tail.
+**
+** Returns          pointer to CCB or NULL
+**
+*******************************************************************************/
+static tL2C_CCB *l2cu_get_next_ready_chnl (tL2C_RR_SERV *p_serv)
+{
+    tL2C_CCB    *p_ccb;
+    BOOLEAN     in_debt;
+    UINT8       xx, num_ready;
+
+    do
+    {
+        in_debt = FALSE;
+
+        /* look at every channel on the list at most once per round */
+        for (xx = 0, num_ready = p_serv->num_ready; xx < num_ready; xx++)
+        {
+            p_ccb = p_serv->p_first_ready;
+
+            if ( (p_ccb->xmit_hold_q.count == 0) && (p_ccb->fcrb.retrans_q.count == 0) )
             {
-                /* next serving channel is set to the next channel in the group */
-                p_lcb->rr_serv[p_lcb->rr_pri].p_serve_ccb = p_ccb->p_next_ccb;
+                l2cu_clear_chnl_ready (p_ccb);
+                continue;
             }
 
-            if (p_ccb->chnl_state != CST_OPEN)
+            if (!l2cu_chnl_can_send (p_ccb))
+            {
+                p_ccb->tx_stats.blocked++;
+                l2cu_rotate_ready_chnl (p_serv);
                 continue;
+            }
 
-            /* eL2CAP option in use */
-            if (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_BASIC_MODE)
+            if (p_ccb->deficit <= 0)
             {
-                if (p_ccb->fcrb.wait_ack || p_ccb->fcrb.remote_busy)
-                    continue;
+                p_ccb->deficit += L2CAP_DRR_QUANTUM * ((p_ccb->tx_data_rate > L2CAP_CHNL_DATA_RATE_LOW) ? p_ccb->tx_data_rate : 1);
+                p_ccb->tx_stats.turns++;
 
-                if ( p_ccb->fcrb.retrans_q.count == 0 )
+                /* still paying for an earlier large PDU, wait for the next round */
+                if (p_ccb->deficit <= 0)
                 {
-                    if ( p_ccb->xmit_hold_q.count == 0 )
-                        continue;
-
-                    /* If using the common pool, should be at least 10% free. */
-                    if ( (p_ccb->ertm_info.fcr_tx_pool_id == HCI_ACL_POOL_ID) && (GKI_poolutilization (HCI_ACL_POOL_ID) > 90) )
-                        continue;
-
-                    /* If in eRTM mode, check for window closure */
-                    if ( (p_ccb->peer_cfg.fcr.mode == L2CAP_FCR_ERTM_MODE) && (l2c_fcr_is_flow_controlled (p_ccb)) )
-                        continue;
+                    in_debt = TRUE;
+                    l2cu_rotate_ready_chnl (p_serv);
+                    continue;
                 }
             }
-            else
+
+            L2CAP_TRACE_DEBUG3 ("DRR serve lcid=0x%04x, deficit=%d, q_count=%d",
+                                p_ccb->local_cid, p_ccb->deficit, p_ccb->xmit_hold_q.count);
+            return (p_ccb);
+        }
+    } while (in_debt);
+
+    return (NULL);
+}
+
+/******************************************************************************
+**
+** Function         l2cu_get_next_channel_in_rr
+**
+** Description      get the next channel to send on a link. Priority groups are
+**                  served in turn, each for a burst quota weighted by its
+**                  priority, and the channels within a group by deficit round
+**                  robin over the channels holding data.
+**
+** Returns          pointer to CCB or NULL
+**
+*******************************************************************************/
+static tL2C_CCB *l2cu_get_next_channel_in_rr(tL2C_LCB *p_lcb)
+{
+    tL2C_CCB    *p_serve_ccb = NULL;
+    int i;
+
+    /* scan all of priority until finding a channel to serve */
+    for ( i = 0; (i < L2CAP_NUM_CHNL_PRIORITY)&&(!p_serve_ccb); i++ )
+    {
+        if (p_lcb->rr_serv[p_lcb->rr_pri].num_ready != 0)
+        {
+            if ((p_serve_ccb = l2cu_get_next_ready_chnl (&p_lcb->rr_serv[p_lcb->rr_pri])) != NULL)
             {
-                if (p_ccb->xmit_hold_q.count == 0)
-                    continue;
+                /* decrease quota of its priority group */
+                p_lcb->rr_serv[p_lcb->rr_pri].quota--;
             }
-
-            /* found a channel to serve */
-            p_serve_ccb = p_ccb;
-            /* decrease quota of its priority group */
-            p_lcb->rr_serv[p_lcb->rr_pri].quota--;
         }
 
         /* if there is no more quota of the priority group or no channel to have data to send */
@@ -3210,6 +3321,8 @@ BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb)
 
             if ((p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb, 0)) != NULL)
             {
+                p_ccb->tx_stats.pkts++;
+                p_ccb->tx_stats.bytes += p_buf->len;
                 l2cu_set_acl_hci_header (p_buf, p_ccb);
                 return (p_buf);
             }
@@ -3219,6 +3332,8 @@ BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb)
             if (p_ccb->xmit_hold_q.count != 0)
             {
                 p_buf = (BT_HDR *)GKI_dequeue (&p_ccb->xmit_hold_q);
+                p_ccb->tx_stats.pkts++;
+                p_ccb->tx_stats.bytes += p_buf->len;
                 l2cu_set_acl_hci_header (p_buf, p_ccb);
                 return (p_buf);
             }
@@ -3247,6 +3362,16 @@ BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb)
         p_buf = (BT_HDR *)GKI_dequeue (&p_ccb->xmit_hold_q);
     }
 
+    p_ccb->tx_stats.pkts++;
+    p_ccb->tx_stats.bytes += p_buf->len;
+
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    /* Charge the channel for the PDU, its turn ends when the credit is used up */
+    p_ccb->deficit -= p_buf->len;
+    if ( (p_ccb->deficit <= 0) && (p_lcb->rr_serv[p_ccb->ccb_priority].p_first_ready == p_ccb) )
+        l2cu_rotate_ready_chnl (&p_lcb->rr_serv[p_ccb->ccb_priority]);
+#endif
+
     if ( p_ccb->p_rcb && p_ccb->p_rcb->api.pL2CA_TxComplete_Cb && (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE) )
         (*p_ccb->p_rcb->api.pL2CA_TxComplete_Cb)(p_ccb->local_cid, 1);
 
@@ -3258,6 +3383,98 @@ BT_HDR *l2cu_get_next_buffer_to_send (tL2C_LCB *p_lcb)
     return (p_buf);
 }
 
+/******************************************************************************
+**
+** Function         l2cu_mark_chnl_ready
+**
+** Description      Called when data is queued on a channel. The channel goes on
+**                  the ready list of its priority group, and the link on the
+**                  ready list of its ACL priority.
+**
+** Returns          None
+**
+*******************************************************************************/
+void l2cu_mark_chnl_ready (tL2C_CCB *p_ccb)
+{
+    tL2C_LCB        *p_lcb = p_ccb->p_lcb;
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    tL2C_RR_SERV    *p_serv;
+#endif
+
+    if (p_lcb == NULL)
+        return;
+
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    /* Fixed channels are served ahead of the round robin */
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+    if ( (p_ccb->local_cid < L2CAP_FIRST_FIXED_CHNL) || (p_ccb->local_cid > L2CAP_LAST_FIXED_CHNL) )
+#endif
+    {
+        if (!p_ccb->is_ready)
+        {
+            p_serv = &p_lcb->rr_serv[p_ccb->ccb_priority];
+
+            p_ccb->p_next_ready = NULL;
+            if (p_serv->p_last_ready)
+                p_serv->p_last_ready->p_next_ready = p_ccb;
+            else
+                p_serv->p_first_ready = p_ccb;
+
+            p_serv->p_last_ready = p_ccb;
+            p_serv->num_ready++;
+            p_ccb->is_ready = TRUE;
+        }
+    }
+#endif
+
+    l2c_link_mark_ready (p_lcb);
+}
+
+/******************************************************************************
+**
+** Function         l2cu_lcb_has_xmit_data
+**
+** Description      Check if anything is queued for transmission on a link,
+**                  whether or not it can be sent right now.
+**
+** Returns          TRUE if data is queued
+**
+*******************************************************************************/
+BOOLEAN l2cu_lcb_has_xmit_data (tL2C_LCB *p_lcb)
+{
+    tL2C_CCB    *p_ccb;
+    int         xx;
+
+    if (p_lcb->link_xmit_data_q.count)
+        return (TRUE);
+
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+    for (xx = 0; xx < L2CAP_NUM_FIXED_CHNLS; xx++)
+    {
+        if ( ((p_ccb = p_lcb->p_fixed_ccbs[xx]) != NULL)
+          && ((p_ccb->xmit_hold_q.count) || (p_ccb->fcrb.retrans_q.count)) )
+            return (TRUE);
+    }
+#endif
+
+#if (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE)
+    /* Channels that ran dry are only dropped from the ready lists when next looked at */
+    for (xx = 0; xx < L2CAP_NUM_CHNL_PRIORITY; xx++)
+    {
+        if (p_lcb->rr_serv[xx].num_ready)
+            return (TRUE);
+    }
+#else
+    for (p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb; p_ccb = p_ccb->p_next_ccb)
+    {
+        if ( (p_ccb->xmit_hold_q.count) || (p_ccb->fcrb.retrans_q.count) )
+            return (TRUE);
+    }
+#endif
+
+    return (FALSE);
+}
+
 /******************************************************************************
 **
 ** Function         l2cu_set_acl_hci_header
@@ -1456,53 +1456,91 @@ int PORT_WriteDataCO (UINT16 handle, int* p_len)
 
     //max_read = available < max_read ? available : max_read;
 
+    if (p_port->peer_mtu < length)
+        length = p_port->peer_mtu;
+
     while (available)
     {
-        /* if we're over buffer high water mark, we're done */
-        if ((p_port->tx.queue_size  > PORT_TX_HIGH_WM)
-         || (p_port->tx.queue.count > PORT_TX_BUF_HIGH_WM))
-            break;
-
-        /* continue with rfcomm data write */
-        p_buf = (BT_HDR *)GKI_getpoolbuf (RFCOMM_DATA_POOL_ID);
-        if (!p_buf)
+        tPORT_CO_SEG seg[PORT_CO_MAX_SEGS];
+        BT_HDR       *p_bufs[PORT_CO_MAX_SEGS];
+        int          count = 0, i;
+        int          max_count = PORT_CO_MAX_SEGS;
+        int          batch_len = 0;
+        int          buf_len;
+        BOOLEAN      failed = FALSE;
+
+        /* Read no further ahead than the peer credits allow, one buffer at least */
+        if (p_port->rfc.p_mcb && (p_port->rfc.p_mcb->flow == PORT_FC_CREDIT)
+         && (p_port->credit_tx < max_count))
+            max_count = p_port->credit_tx ? p_port->credit_tx : 1;
+
+        /* Get the buffers for as much of the data as the queue takes, */
+        /* and fill them all with one call-out */
+        while ((count < max_count) && (batch_len < available))
+        {
+            /* if we're over buffer high water mark, we're done */
+            if ((p_port->tx.queue_size + batch_len > PORT_TX_HIGH_WM)
+             || (p_port->tx.queue.count + count > PORT_TX_BUF_HIGH_WM))
+                break;
+
+            p_buf = (BT_HDR *)GKI_getpoolbuf (RFCOMM_DATA_POOL_ID);
+            if (!p_buf)
+                break;
+
+            p_buf->offset         = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+            p_buf->layer_specific = handle;
+            p_buf->len            = (available - batch_len < (int)length) ?
+                                    (UINT16)(available - batch_len) : length;
+            p_buf->event          = BT_EVT_TO_BTU_SP_DATA;
+
+            seg[count].p_data = (UINT8 *)(p_buf + 1) + p_buf->offset;
+            seg[count].len    = p_buf->len;
+            p_bufs[count++]   = p_buf;
+            batch_len        += p_buf->len;
+        }
+        if (count == 0)
             break;
 
-        p_buf->offset         = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-        p_buf->layer_specific = handle;
-
-        if (p_port->peer_mtu < length)
-            length = p_port->peer_mtu;
-        if (available < (int)length)
-            length = (UINT16)available;
-        p_buf->len = length;
-        p_buf->event          = BT_EVT_TO_BTU_SP_DATA;
-
-        //memcpy ((UINT8 *)(p_buf + 1) + p_buf->offset, p_data, length);
-        //if(recv(fd, (UINT8 *)(p_buf + 1) + p_buf->offset, (int)length, 0) != (int)length)
-        if(p_port->p_data_co_callback(handle, (UINT8 *)(p_buf + 1) + p_buf->offset, length,
-                                      DATA_CO_CALLBACK_TYPE_OUTGOING) == FALSE)
+        if(p_port->p_data_co_callback(handle, (UINT8 *)seg, (UINT16)count,
+                                      DATA_CO_CALLBACK_TYPE_OUTGOING_VECTOR) == FALSE)
         {
-            error("p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, length:%d", length);
+            error("p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING_VECTOR failed, length:%d", batch_len);
+            for (i = 0; i < count; i++)
+                GKI_freebuf (p_bufs[i]);
             return (PORT_UNKNOWN_ERROR);
         }
 
+        RFCOMM_TRACE_EVENT2 ("PORT_WriteData %d bytes in %d buffers", batch_len, count);
 
-        RFCOMM_TRACE_EVENT1 ("PORT_WriteData %d bytes", length);
+        for (i = 0; i < count; i++)
+        {
+            /* the data is read already, drop what is behind a failed write */
+            if (failed)
+            {
+                GKI_freebuf (p_bufs[i]);
+                continue;
+            }
 
-        rc = port_write (p_port, p_buf);
+            buf_len = p_bufs[i]->len;
+            rc = port_write (p_port, p_bufs[i]);
 
-        /* If queue went below the threashold need to send flow control */
-        event |= port_flow_control_user (p_port);
+            /* If queue went below the threashold need to send flow control */
+            event |= port_flow_control_user (p_port);
 
-        if (rc == PORT_SUCCESS)
-            event |= PORT_EV_TXCHAR;
+            if (rc == PORT_SUCCESS)
+                event |= PORT_EV_TXCHAR;
 
-        if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING))
-            break;
+            if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING))
+            {
+                failed = TRUE;
+                continue;
+            }
 
-        *p_len  += length;
-        available -= (int)length;
+            *p_len  += buf_len;
+            available -= buf_len;
+        }
+        if (failed)
+            break;
     }
     if (!available && (rc != PORT_CMD_PENDING) && (rc != PORT_TX_QUEUE_DISABLED))
         event |= PORT_EV_TXEMPTY;
@@ -44,6 +44,13 @@
 /********************************************************************************/
 static BOOLEAN find_uuid_in_seq (UINT8 *p , UINT32 seq_len, UINT8 *p_his_uuid,
                                  UINT16 his_len, int nest_level);
+static void    sdp_db_invalidate (tSDP_RECORD *p_rec);
+static void    sdp_db_encode_record (tSDP_RECORD *p_rec);
+static BOOLEAN sdp_db_uuid_to_128 (UINT8 *p_uuid, UINT32 len, UINT8 *p_uuid128);
+static BOOLEAN sdp_db_index_uuid (UINT8 *p_uuid, UINT32 len, UINT16 rec_idx);
+static BOOLEAN sdp_db_index_seq (UINT8 *p, UINT32 seq_len, UINT16 rec_idx, int nest_level);
+static void    sdp_db_build_uuid_index (void);
+static BOOLEAN sdp_db_uuid_index_search (tSDP_UUID_SEQ *p_seq, UINT8 *p_mask);
 
 
 /*******************************************************************************
@@ -62,6 +69,7 @@ tSDP_RECORD *sdp_db_service_search (tSDP_RECORD *p_rec, tSDP_UUID_SEQ *p_seq)
     UINT16          xx, yy;
     tSDP_ATTRIBUTE *p_attr;
     tSDP_RECORD     *p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+    UINT8           rec_mask[SDP_REC_MASK_LEN];
 
     /* If NULL, start at the beginning, else start at the first specified record */
     if (!p_rec)
@@ -69,6 +77,21 @@ tSDP_RECORD *sdp_db_service_search (tSDP_RECORD *p_rec, tSDP_UUID_SEQ *p_seq)
     else
         p_rec++;
 
+    if (!sdp_cb.server_db.uuid_index_valid)
+        sdp_db_build_uuid_index ();
+
+    /* The index gives the set of records holding all the UUIDs at once */
+    if (sdp_cb.server_db.uuid_index_usable && sdp_db_uuid_index_search (p_seq, rec_mask))
+    {
+        for ( ; p_rec < p_end; p_rec++)
+        {
+            xx = (UINT16) (p_rec - &sdp_cb.server_db.record[0]);
+            if (rec_mask[xx >> 3] & (1 << (xx & 7)))
+                return (p_rec);
+        }
+        return (NULL);
+    }
+
     /* Look through the records. The spec says that a match occurs if */
     /* the record contains all the passed UUIDs in it.                */
     for ( ; p_rec < p_end; p_rec++)
@@ -149,6 +172,210 @@ static BOOLEAN find_uuid_in_seq (UINT8 *p , UINT32 seq_len, UINT8 *p_uuid,
     return (FALSE);
 }
 
+/*******************************************************************************
+**
+** Function         sdp_db_uuid_to_128
+**
+** Description      This function expands a BE UUID to 128 bits, the same way
+**                  sdpu_compare_uuid_arrays() does before comparing.
+**
+** Returns          FALSE if the UUID is not 2, 4 or 16 bytes long
+**
+*******************************************************************************/
+static BOOLEAN sdp_db_uuid_to_128 (UINT8 *p_uuid, UINT32 len, UINT8 *p_uuid128)
+{
+    UINT16  uuid16;
+
+    switch (len)
+    {
+    case 2:
+        BE_STREAM_TO_UINT16 (uuid16, p_uuid);
+        sdpu_uuid16_to_uuid128 (uuid16, p_uuid128);
+        break;
+    case 4:
+        sdpu_uuid16_to_uuid128 (0, p_uuid128);
+        memcpy (p_uuid128, p_uuid, 4);
+        break;
+    case MAX_UUID_SIZE:
+        memcpy (p_uuid128, p_uuid, MAX_UUID_SIZE);
+        break;
+    default:
+        return (FALSE);
+    }
+    return (TRUE);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_index_uuid
+**
+** Description      This function adds a record to the index entry of a UUID,
+**                  creating the entry if needed.
+**
+** Returns          FALSE if the UUID cannot be indexed
+**
+*******************************************************************************/
+static BOOLEAN sdp_db_index_uuid (UINT8 *p_uuid, UINT32 len, UINT16 rec_idx)
+{
+    tSDP_DB         *p_db = &sdp_cb.server_db;
+    tSDP_UUID_INDEX *p_ent = &p_db->uuid_index[0];
+    UINT8           uuid128[MAX_UUID_SIZE];
+    UINT16          xx;
+
+    if (!sdp_db_uuid_to_128 (p_uuid, len, uuid128))
+        return (FALSE);
+
+    for (xx = 0; xx < p_db->num_uuid_index; xx++, p_ent++)
+    {
+        if (memcmp (p_ent->uuid, uuid128, MAX_UUID_SIZE) == 0)
+            break;
+    }
+
+    if (xx == p_db->num_uuid_index)
+    {
+        if (xx == SDP_MAX_UUID_INDEX)
+            return (FALSE);
+
+        memcpy (p_ent->uuid, uuid128, MAX_UUID_SIZE);
+        memset (p_ent->rec_mask, 0, SDP_REC_MASK_LEN);
+        p_db->num_uuid_index++;
+    }
+
+    p_ent->rec_mask[rec_idx >> 3] |= (UINT8) (1 << (rec_idx & 7));
+    return (TRUE);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_index_seq
+**
+** Description      This function indexes the UUIDs of a data element sequence,
+**                  down to the depth find_uuid_in_seq() searches.
+**
+** Returns          FALSE if the sequence cannot be indexed
+**
+*******************************************************************************/
+static BOOLEAN sdp_db_index_seq (UINT8 *p, UINT32 seq_len, UINT16 rec_idx, int nest_level)
+{
+    UINT8   *p_end = p + seq_len;
+    UINT8   type;
+    UINT32  len;
+
+    /* Deeper UUIDs are never matched by the search */
+    if (nest_level > 3)
+        return (TRUE);
+
+    while (p < p_end)
+    {
+        type = *p++;
+        p = sdpu_get_len_from_type (p, type, &len);
+        type = type >> 3;
+
+        /* Leave malformed sequences to the record by record search */
+        if (p + len > p_end)
+            return (FALSE);
+
+        if (type == UUID_DESC_TYPE)
+        {
+            if (!sdp_db_index_uuid (p, len, rec_idx))
+                return (FALSE);
+        }
+        else if (type == DATA_ELE_SEQ_DESC_TYPE)
+        {
+            if (!sdp_db_index_seq (p, len, rec_idx, nest_level + 1))
+                return (FALSE);
+        }
+        p = p + len;
+    }
+    return (TRUE);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_build_uuid_index
+**
+** Description      This function rebuilds the UUID to record index from the
+**                  database. If the records do not fit the index, it is marked
+**                  unusable and searches go through the records.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sdp_db_build_uuid_index (void)
+{
+    tSDP_DB         *p_db = &sdp_cb.server_db;
+    tSDP_RECORD     *p_rec = &p_db->record[0];
+    tSDP_ATTRIBUTE  *p_attr;
+    UINT16          xx, zz;
+    BOOLEAN         ok = TRUE;
+
+    p_db->num_uuid_index = 0;
+
+    for (zz = 0; ok && zz < p_db->num_records; zz++, p_rec++)
+    {
+        p_attr = &p_rec->attribute[0];
+        for (xx = 0; ok && xx < p_rec->num_attributes; xx++, p_attr++)
+        {
+            if (p_attr->type == UUID_DESC_TYPE)
+                ok = sdp_db_index_uuid (p_attr->value_ptr, p_attr->len, zz);
+            else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE)
+                ok = sdp_db_index_seq (p_attr->value_ptr, p_attr->len, zz, 0);
+        }
+    }
+
+    if (!ok)
+        SDP_TRACE_DEBUG1 ("SDP UUID index not usable, %d UUIDs", p_db->num_uuid_index);
+
+    p_db->uuid_index_usable = ok;
+    p_db->uuid_index_valid  = TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_uuid_index_search
+**
+** Description      This function looks up the UUIDs of a search pattern in the
+**                  UUID index. Bit N of p_mask is set if record[N] holds all
+**                  of them.
+**
+** Returns          FALSE if the pattern cannot be looked up in the index
+**
+*******************************************************************************/
+static BOOLEAN sdp_db_uuid_index_search (tSDP_UUID_SEQ *p_seq, UINT8 *p_mask)
+{
+    tSDP_DB         *p_db = &sdp_cb.server_db;
+    tSDP_UUID_INDEX *p_ent;
+    UINT8           uuid128[MAX_UUID_SIZE];
+    UINT16          xx, yy, zz;
+
+    memset (p_mask, 0xFF, SDP_REC_MASK_LEN);
+
+    for (yy = 0; yy < p_seq->num_uids; yy++)
+    {
+        if (!sdp_db_uuid_to_128 (&p_seq->uuid_entry[yy].value[0],
+                                 p_seq->uuid_entry[yy].len, uuid128))
+            return (FALSE);
+
+        p_ent = &p_db->uuid_index[0];
+        for (xx = 0; xx < p_db->num_uuid_index; xx++, p_ent++)
+        {
+            if (memcmp (p_ent->uuid, uuid128, MAX_UUID_SIZE) == 0)
+                break;
+        }
+
+        /* No record holds this UUID */
+        if (xx == p_db->num_uuid_index)
+        {
+            memset (p_mask, 0, SDP_REC_MASK_LEN);
+            return (TRUE);
+        }
+
+        for (zz = 0; zz < SDP_REC_MASK_LEN; zz++)
+            p_mask[zz] &= p_ent->rec_mask[zz];
+    }
+    return (TRUE);
+}
+
 /*******************************************************************************
 **
 ** Function         sdp_db_find_record
@@ -205,6 +432,103 @@ tSDP_ATTRIBUTE *sdp_db_find_attr_in_rec (tSDP_RECORD *p_rec, UINT16 start_attr,
     return (NULL);
 }
 
+/*******************************************************************************
+**
+** Function         sdp_db_invalidate
+**
+** Description      This function is called when the database changes. The
+**                  encoded image of the record (if any) and the UUID index are
+**                  rebuilt on next use.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sdp_db_invalidate (tSDP_RECORD *p_rec)
+{
+    if (p_rec)
+        p_rec->enc_valid = FALSE;
+
+    sdp_cb.server_db.uuid_index_valid = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_encode_record
+**
+** Description      This function builds the attribute entries of a record, in
+**                  attribute ID order, into the record's encoded image.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sdp_db_encode_record (tSDP_RECORD *p_rec)
+{
+    tSDP_ATTRIBUTE  *p_attr = &p_rec->attribute[0];
+    UINT8           *p = &p_rec->enc_image[0];
+    UINT16          xx;
+
+    for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++)
+    {
+        p_rec->enc_offset[xx] = (UINT16) (p - &p_rec->enc_image[0]);
+        p = sdpu_build_attrib_entry (p, p_attr);
+    }
+    p_rec->enc_offset[xx] = (UINT16) (p - &p_rec->enc_image[0]);
+    p_rec->enc_valid = TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_get_attr_image
+**
+** Description      This function returns the attribute entry, as sent on the
+**                  air, of an attribute of a record.
+**
+** Returns          Pointer to the entry, its length in p_len
+**
+*******************************************************************************/
+UINT8 *sdp_db_get_attr_image (tSDP_RECORD *p_rec, tSDP_ATTRIBUTE *p_attr, UINT16 *p_len)
+{
+    UINT16  xx = (UINT16) (p_attr - &p_rec->attribute[0]);
+
+    if (!p_rec->enc_valid)
+        sdp_db_encode_record (p_rec);
+
+    *p_len = p_rec->enc_offset[xx + 1] - p_rec->enc_offset[xx];
+    return (&p_rec->enc_image[p_rec->enc_offset[xx]]);
+}
+
+/*******************************************************************************
+**
+** Function         sdp_db_get_range_len
+**
+** Description      This function gets the length of the attribute entries of
+**                  a record with IDs from start_attr to end_attr.
+**
+** Returns          Length in bytes
+**
+*******************************************************************************/
+UINT16 sdp_db_get_range_len (tSDP_RECORD *p_rec, UINT16 start_attr, UINT16 end_attr)
+{
+    UINT16  first, last;
+
+    if (!p_rec->enc_valid)
+        sdp_db_encode_record (p_rec);
+
+    /* The attributes are sorted, so the range is one run of the image */
+    for (first = 0; first < p_rec->num_attributes; first++)
+    {
+        if (p_rec->attribute[first].id >= start_attr)
+            break;
+    }
+    for (last = first; last < p_rec->num_attributes; last++)
+    {
+        if (p_rec->attribute[last].id > end_attr)
+            break;
+    }
+
+    return (p_rec->enc_offset[last] - p_rec->enc_offset[first]);
+}
+
 
 /*******************************************************************************
 **
@@ -337,6 +661,7 @@ BOOLEAN SDP_DeleteRecord (UINT32 handle)
     {
         /* Delete all records in the database */
         sdp_cb.server_db.num_records = 0;
+        sdp_db_invalidate (NULL);
 
         /* require new DI record to be created in SDP_SetLocalDiRecord */
         sdp_cb.server_db.di_primary_handle = 0;
@@ -362,6 +687,7 @@ BOOLEAN SDP_DeleteRecord (UINT32 handle)
                 }
 
                 sdp_cb.server_db.num_records--;
+                sdp_db_invalidate (NULL);
 
                 SDP_TRACE_DEBUG1("SDP_DeleteRecord ok, num_records:%d", sdp_cb.server_db.num_records);
                 /* if we're deleting the primary DI record, clear the */
@@ -443,6 +769,8 @@ BOOLEAN SDP_AddAttribute (UINT32 handle, UINT16 attr_id, UINT8 attr_type,
         {
             tSDP_ATTRIBUTE  *p_attr = &p_rec->attribute[0];
 
+            sdp_db_invalidate (p_rec);
+
             /* Found the record. Now, see if the attribute already exists */
             for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++)
             {
@@ -850,6 +1178,8 @@ BOOLEAN SDP_DeleteAttribute (UINT32 handle, UINT16 attr_id)
             {
                 if (p_attr->id == attr_id)
                 {
+                    sdp_db_invalidate (p_rec);
+
                     pad_ptr = p_attr->value_ptr;
                     len = p_attr->len;
 
@@ -882,6 +1212,9 @@ BOOLEAN SDP_DeleteAttribute (UINT32 handle, UINT16 attr_id)
                     return (TRUE);
                 }
             }
+
+            /* xx now counts attributes, stop at the record found */
+            break;
         }
     }
 #endif
@@ -314,6 +314,7 @@ static void process_service_attr_req (tCONN_CB *p_ccb, UINT16 trans_num,
     BT_HDR          *p_buf;
     BOOLEAN         is_cont = FALSE;
     UINT16          attr_len;
+    UINT8           *p_image;
 
     /* Extract the record handle */
     BE_STREAM_TO_UINT32 (rec_handle, p_req);
@@ -415,11 +416,11 @@ static void process_service_attr_req (tCONN_CB *p_ccb, UINT16 trans_num,
                 break;
             }
 
-            attr_len = sdpu_get_attrib_entry_len(p_attr);
+            p_image = sdp_db_get_attr_image (p_rec, p_attr, &attr_len);
             /* if there is a partial attribute pending to be sent */
             if (p_ccb->cont_info.attr_offset)
             {
-                p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_attr, rem_len,
+                p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_image, attr_len, rem_len,
                                                          &p_ccb->cont_info.attr_offset);
 
                 /* If the partial attrib could not been fully added yet */
@@ -438,15 +439,18 @@ static void process_service_attr_req (tCONN_CB *p_ccb, UINT16 trans_num,
                 }
 
                 /* add the partial attribute if possible */
-                p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_attr, (UINT16)rem_len,
+                p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_image, attr_len, (UINT16)rem_len,
                                                          &p_ccb->cont_info.attr_offset);
 
                 p_ccb->cont_info.next_attr_index = xx;
                 p_ccb->cont_info.next_attr_start_id = p_attr->id;
                 break;
             }
-            else /* build the whole attribute */
-                p_rsp = sdpu_build_attrib_entry (p_rsp, p_attr);
+            else /* copy the whole attribute */
+            {
+                memcpy (p_rsp, p_image, attr_len);
+                p_rsp += attr_len;
+            }
 
             /* If doing a range, stick with this one till no more attributes found */
             if (attr_seq.attr_entry[xx].start != attr_seq.attr_entry[xx].end)
@@ -565,6 +569,7 @@ static void process_service_search_attr_req (tCONN_CB *p_ccb, UINT16 trans_num,
     BOOLEAN         maxxed_out = FALSE, is_cont = FALSE;
     UINT8           *p_seq_start;
     UINT16          seq_len, attr_len;
+    UINT8           *p_image;
 
     /* Extract the UUID sequence to search for */
     p_req = sdpu_extract_uid_seq (p_req, param_len, &uid_seq);
@@ -679,11 +684,11 @@ static void process_service_search_attr_req (tCONN_CB *p_ccb, UINT16 trans_num,
                     break;
                 }
 
-                attr_len = sdpu_get_attrib_entry_len(p_attr);
+                p_image = sdp_db_get_attr_image (p_rec, p_attr, &attr_len);
                 /* if there is a partial attribute pending to be sent */
                 if (p_ccb->cont_info.attr_offset)
                 {
-                    p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_attr, rem_len,
+                    p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_image, attr_len, rem_len,
                                                              &p_ccb->cont_info.attr_offset);
 
                     /* If the partial attrib could not been fully added yet */
@@ -705,7 +710,7 @@ static void process_service_search_attr_req (tCONN_CB *p_ccb, UINT16 trans_num,
                     }
 
                     /* add the partial attribute if possible */
-                    p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_attr, (UINT16)rem_len,
+                    p_rsp = sdpu_build_partial_attrib_entry (p_rsp, p_image, attr_len, (UINT16)rem_len,
                                                              &p_ccb->cont_info.attr_offset);
 
                     p_ccb->cont_info.next_attr_index = xx;
@@ -713,8 +718,11 @@ static void process_service_search_attr_req (tCONN_CB *p_ccb, UINT16 trans_num,
                     maxxed_out = TRUE;
                     break;
                 }
-                else /* build the whole attribute */
-                    p_rsp = sdpu_build_attrib_entry (p_rsp, p_attr);
+                else /* copy the whole attribute */
+                {
+                    memcpy (p_rsp, p_image, attr_len);
+                    p_rsp += attr_len;
+                }
 
                 /* If doing a range, stick with this one till no more attributes found */
                 if (attr_seq.attr_entry[xx].start != attr_seq.attr_entry[xx].end)
@@ -880,39 +880,14 @@ UINT16 sdpu_get_list_len(tSDP_UUID_SEQ *uid_seq, tSDP_ATTR_SEQ *attr_seq)
 *******************************************************************************/
 UINT16 sdpu_get_attrib_seq_len(tSDP_RECORD *p_rec, tSDP_ATTR_SEQ *attr_seq)
 {
-    tSDP_ATTRIBUTE *p_attr;
     UINT16 len1 = 0;
     UINT16 xx;
-    BOOLEAN is_range = FALSE;
-    UINT16 start_id, end_id;
 
     for (xx = 0; xx < attr_seq->num_attr; xx++)
     {
-        if (is_range == FALSE)
-        {
-            start_id = attr_seq->attr_entry[xx].start;
-            end_id = attr_seq->attr_entry[xx].end;
-        }
-        p_attr = sdp_db_find_attr_in_rec (p_rec,
-                                          start_id,
-                                          end_id);
-        if (p_attr)
-        {
-            len1 += sdpu_get_attrib_entry_len (p_attr);
-
-            /* If doing a range, stick with this one till no more attributes found */
-            if (start_id != end_id)
-            {
-                /* Update for next time through */
-                start_id = p_attr->id + 1;
-                xx--;
-                is_range = TRUE;
-            }
-            else
-                is_range = FALSE;
-        }
-        else
-            is_range = FALSE;
+        len1 += sdp_db_get_range_len (p_rec,
+                                      attr_seq->attr_entry[xx].start,
+                                      attr_seq->attr_entry[xx].end);
     }
     return len1;
 }
@@ -985,31 +960,26 @@ UINT16 sdpu_get_attrib_entry_len(tSDP_ATTRIBUTE *p_attr)
 **
 ** Function         sdpu_build_partial_attrib_entry
 **
-** Description      This function fills a buffer with partial attribute. It is
-**                  assumed that the maximum size of any attribute is 256 bytes.
+** Description      This function fills a buffer with partial attribute, taken
+**                  from the attribute entry encoded in the record.
 **
 **                  p_out: output buffer
-**                  p_attr: attribute to be copied partially into p_out
-**                  rem_len: num bytes to copy into p_out
+**                  p_image: encoded attribute entry, see sdp_db_get_attr_image()
+**                  attr_len: length of the encoded attribute entry
+**                  len: num bytes to copy into p_out
 **                  offset: current start offset within the attr that needs to be copied
 **
 ** Returns          Pointer to next byte in the output buffer.
 **                  offset is also updated
 **
 *******************************************************************************/
-UINT8 *sdpu_build_partial_attrib_entry (UINT8 *p_out, tSDP_ATTRIBUTE *p_attr, UINT16 len, UINT16 *offset)
+UINT8 *sdpu_build_partial_attrib_entry (UINT8 *p_out, UINT8 *p_image, UINT16 attr_len, UINT16 len, UINT16 *offset)
 {
-    UINT8   tmp_attr[MAX_ATTR_LEN];
-    UINT8   *p_tmp_attr = &tmp_attr[0];
     size_t  len_to_copy;
-    UINT16  attr_len;
-
-    sdpu_build_attrib_entry(p_tmp_attr, p_attr);
-    attr_len = sdpu_get_attrib_entry_len(p_attr);
 
     len_to_copy = ((attr_len - *offset) < len) ? (attr_len - *offset): len;
 
-    memcpy(p_out, &tmp_attr[*offset], len_to_copy);
+    memcpy(p_out, &p_image[*offset], len_to_copy);
 
     p_out = &p_out[len_to_copy];
     *offset += len_to_copy;
@@ -126,6 +126,10 @@ typedef struct
     UINT8   type;
 } tSDP_ATTRIBUTE;
 
+/* Worst case size of the encoded attribute entries of a record: the values */
+/* plus a 3 byte attribute ID and up to a 5 byte value header per attribute */
+#define SDP_MAX_ENC_LEN     (SDP_MAX_PAD_LEN + (SDP_MAX_REC_ATTR * 8))
+
 /* An SDP record consists of a handle, and 1 or more attributes */
 typedef struct
 {
@@ -134,8 +138,23 @@ typedef struct
     UINT16              num_attributes;
     tSDP_ATTRIBUTE      attribute[SDP_MAX_REC_ATTR];
     UINT8               attr_pad[SDP_MAX_PAD_LEN];
+
+    /* Attribute entries as sent on the air, built on first use and rebuilt */
+    /* after the record changes. Entry xx is enc_image[enc_offset[xx]] up to */
+    /* enc_image[enc_offset[xx + 1]]. Offsets keep it valid across moves.    */
+    BOOLEAN             enc_valid;
+    UINT16              enc_offset[SDP_MAX_REC_ATTR + 1];
+    UINT8               enc_image[SDP_MAX_ENC_LEN];
 } tSDP_RECORD;
 
+#define SDP_REC_MASK_LEN    ((SDP_MAX_RECORDS + 7) / 8)
+
+/* UUID index entry: a UUID expanded to 128 bits and the records holding it */
+typedef struct
+{
+    UINT8       uuid[MAX_UUID_SIZE];
+    UINT8       rec_mask[SDP_REC_MASK_LEN];     /* bit N set: record[N] has the UUID */
+} tSDP_UUID_INDEX;
 
 /* Define the SDP database */
 typedef struct
@@ -144,6 +163,11 @@ typedef struct
     BOOLEAN        brcm_di_registered;
     UINT16         num_records;
     tSDP_RECORD    record[SDP_MAX_RECORDS];
+
+    BOOLEAN        uuid_index_valid;        /* uuid_index matches the records */
+    BOOLEAN        uuid_index_usable;       /* FALSE if the records did not fit the index */
+    UINT16         num_uuid_index;
+    tSDP_UUID_INDEX uuid_index[SDP_MAX_UUID_INDEX];
 } tSDP_DB;
 
 enum
@@ -295,7 +319,7 @@ extern void     sdpu_sort_attr_list( UINT16 num_attr, tSDP_DISCOVERY_DB *p_db );
 extern UINT16 sdpu_get_list_len( tSDP_UUID_SEQ   *uid_seq, tSDP_ATTR_SEQ   *attr_seq );
 extern UINT16 sdpu_get_attrib_seq_len(tSDP_RECORD *p_rec, tSDP_ATTR_SEQ *attr_seq);
 extern UINT16 sdpu_get_attrib_entry_len(tSDP_ATTRIBUTE *p_attr);
-extern UINT8 *sdpu_build_partial_attrib_entry (UINT8 *p_out, tSDP_ATTRIBUTE *p_attr, UINT16 len, UINT16 *offset);
+extern UINT8 *sdpu_build_partial_attrib_entry (UINT8 *p_out, UINT8 *p_image, UINT16 attr_len, UINT16 len, UINT16 *offset);
 extern void sdpu_uuid16_to_uuid128(UINT16 uuid16, UINT8* p_uuid128);
 
 /* Functions provided by sdp_db.c
@@ -303,6 +327,8 @@ extern void sdpu_uuid16_to_uuid128(UINT16 uuid16, UINT8* p_uuid128);
 extern tSDP_RECORD    *sdp_db_service_search (tSDP_RECORD *p_rec, tSDP_UUID_SEQ *p_seq);
 extern tSDP_RECORD    *sdp_db_find_record (UINT32 handle);
 extern tSDP_ATTRIBUTE *sdp_db_find_attr_in_rec (tSDP_RECORD *p_rec, UINT16 start_attr, UINT16 end_attr);
+extern UINT8          *sdp_db_get_attr_image (tSDP_RECORD *p_rec, tSDP_ATTRIBUTE *p_attr, UINT16 *p_len);
+extern UINT16          sdp_db_get_range_len (tSDP_RECORD *p_rec, UINT16 start_attr, UINT16 end_attr);
 
 
 /* Functions provided by sdp_server.c
@@ -0,0 +1,562 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 1999-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the AES-128 block cipher used by SMP for key
+ *  generation and by AES-CMAC for data signing.
+ *
+ *  The key schedule is expanded in software, once per key, into FIPS-197
+ *  byte order and kept in a small cache. Blocks are encrypted with the
+ *  AES instructions of the CPU when present (AES-NI on x86, the ARMv8
+ *  Crypto Extensions on arm64), else with a table driven implementation.
+ *  All of them give the same output.
+ *
+ ******************************************************************************/
+
+#include "bt_target.h"
+
+#if SMP_INCLUDED == TRUE
+    #include <stdint.h>
+    #include <string.h>
+
+    #include "smp_int.h"
+
+    #if SMP_AES_HW_INCLUDED == TRUE
+        #if defined(__x86_64__) || defined(__i386__)
+            #include <cpuid.h>
+            #include <wmmintrin.h>
+            #define SMP_AES_NI      TRUE
+        #elif defined(__aarch64__)
+            #include <sys/auxv.h>
+            #include <asm/hwcap.h>
+            #include <arm_neon.h>
+            #define SMP_AES_ARMV8   TRUE
+        #endif
+    #endif
+
+    #define SMP_AES_ROUNDS      10
+
+typedef void (tSMP_AES_ENCRYPT_FN)(const tSMP_AES_KEY *p_ks, const UINT8 *p_in, UINT8 *p_out);
+typedef void (tSMP_AES_MULTI_FN)(const tSMP_AES_KEY *p_ks, UINT16 num_keys, const UINT8 *p_in, UINT8 *p_out);
+
+/* Expanded key cache, looked up by key value */
+typedef struct
+{
+    BOOLEAN         in_use;
+    UINT32          last_use;
+    BT_OCTET16      key;
+    tSMP_AES_KEY    ks;
+} tSMP_AES_CACHE;
+
+typedef struct
+{
+    tSMP_AES_ENCRYPT_FN *p_encrypt;
+    tSMP_AES_MULTI_FN   *p_encrypt_multi;
+    const char          *p_name;
+    UINT32              use_count;
+    tSMP_AES_CACHE      cache[SMP_AES_KEY_CACHE_SIZE];
+} tSMP_AES_CB;
+
+static void smp_aes_encrypt_sw (const tSMP_AES_KEY *p_ks, const UINT8 *p_in, UINT8 *p_out);
+static void smp_aes_encrypt_multi_sw (const tSMP_AES_KEY *p_ks, UINT16 num_keys, const UINT8 *p_in, UINT8 *p_out);
+
+static tSMP_AES_CB smp_aes_cb = { smp_aes_encrypt_sw, smp_aes_encrypt_multi_sw, "software", 0 };
+
+static const UINT8 smp_aes_sbox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/* Te0[x] = S[x].[02, 01, 01, 03], the other columns are rotations of it */
+static const uint32_t smp_aes_te0[256] =
+{
+    0xc66363a5U, 0xf87c7c84U, 0xee777799U, 0xf67b7b8dU, 0xfff2f20dU, 0xd66b6bbdU,
+    0xde6f6fb1U, 0x91c5c554U, 0x60303050U, 0x02010103U, 0xce6767a9U, 0x562b2b7dU,
+    0xe7fefe19U, 0xb5d7d762U, 0x4dababe6U, 0xec76769aU, 0x8fcaca45U, 0x1f82829dU,
+    0x89c9c940U, 0xfa7d7d87U, 0xeffafa15U, 0xb25959ebU, 0x8e4747c9U, 0xfbf0f00bU,
+    0x41adadecU, 0xb3d4d467U, 0x5fa2a2fdU, 0x45afafeaU, 0x239c9cbfU, 0x53a4a4f7U,
+    0xe4727296U, 0x9bc0c05bU, 0x75b7b7c2U, 0xe1fdfd1cU, 0x3d9393aeU, 0x4c26266aU,
+    0x6c36365aU, 0x7e3f3f41U, 0xf5f7f702U, 0x83cccc4fU, 0x6834345cU, 0x51a5a5f4U,
+    0xd1e5e534U, 0xf9f1f108U, 0xe2717193U, 0xabd8d873U, 0x62313153U, 0x2a15153fU,
+    0x0804040cU, 0x95c7c752U, 0x46232365U, 0x9dc3c35eU, 0x30181828U, 0x379696a1U,
+    0x0a05050fU, 0x2f9a9ab5U, 0x0e070709U, 0x24121236U, 0x1b80809bU, 0xdfe2e23dU,
+    0xcdebeb26U, 0x4e272769U, 0x7fb2b2cdU, 0xea75759fU, 0x1209091bU, 0x1d83839eU,
+    0x582c2c74U, 0x341a1a2eU, 0x361b1b2dU, 0xdc6e6eb2U, 0xb45a5aeeU, 0x5ba0a0fbU,
+    0xa45252f6U, 0x763b3b4dU, 0xb7d6d661U, 0x7db3b3ceU, 0x5229297bU, 0xdde3e33eU,
+    0x5e2f2f71U, 0x13848497U, 0xa65353f5U, 0xb9d1d168U, 0x00000000U, 0xc1eded2cU,
+    0x40202060U, 0xe3fcfc1fU, 0x79b1b1c8U, 0xb65b5bedU, 0xd46a6abeU, 0x8dcbcb46U,
+    0x67bebed9U, 0x7239394bU, 0x944a4adeU, 0x984c4cd4U, 0xb05858e8U, 0x85cfcf4aU,
+    0xbbd0d06bU, 0xc5efef2aU, 0x4faaaae5U, 0xedfbfb16U, 0x864343c5U, 0x9a4d4dd7U,
+    0x66333355U, 0x11858594U, 0x8a4545cfU, 0xe9f9f910U, 0x04020206U, 0xfe7f7f81U,
+    0xa05050f0U, 0x783c3c44U, 0x259f9fbaU, 0x4ba8a8e3U, 0xa25151f3U, 0x5da3a3feU,
+    0x804040c0U, 0x058f8f8aU, 0x3f9292adU, 0x219d9dbcU, 0x70383848U, 0xf1f5f504U,
+    0x63bcbcdfU, 0x77b6b6c1U, 0xafdada75U, 0x42212163U, 0x20101030U, 0xe5ffff1aU,
+    0xfdf3f30eU, 0xbfd2d26dU, 0x81cdcd4cU, 0x180c0c14U, 0x26131335U, 0xc3ecec2fU,
+    0xbe5f5fe1U, 0x359797a2U, 0x884444ccU, 0x2e171739U, 0x93c4c457U, 0x55a7a7f2U,
+    0xfc7e7e82U, 0x7a3d3d47U, 0xc86464acU, 0xba5d5de7U, 0x3219192bU, 0xe6737395U,
+    0xc06060a0U, 0x19818198U, 0x9e4f4fd1U, 0xa3dcdc7fU, 0x44222266U, 0x542a2a7eU,
+    0x3b9090abU, 0x0b888883U, 0x8c4646caU, 0xc7eeee29U, 0x6bb8b8d3U, 0x2814143cU,
+    0xa7dede79U, 0xbc5e5ee2U, 0x160b0b1dU, 0xaddbdb76U, 0xdbe0e03bU, 0x64323256U,
+    0x743a3a4eU, 0x140a0a1eU, 0x924949dbU, 0x0c06060aU, 0x4824246cU, 0xb85c5ce4U,
+    0x9fc2c25dU, 0xbdd3d36eU, 0x43acacefU, 0xc46262a6U, 0x399191a8U, 0x319595a4U,
+    0xd3e4e437U, 0xf279798bU, 0xd5e7e732U, 0x8bc8c843U, 0x6e373759U, 0xda6d6db7U,
+    0x018d8d8cU, 0xb1d5d564U, 0x9c4e4ed2U, 0x49a9a9e0U, 0xd86c6cb4U, 0xac5656faU,
+    0xf3f4f407U, 0xcfeaea25U, 0xca6565afU, 0xf47a7a8eU, 0x47aeaee9U, 0x10080818U,
+    0x6fbabad5U, 0xf0787888U, 0x4a25256fU, 0x5c2e2e72U, 0x381c1c24U, 0x57a6a6f1U,
+    0x73b4b4c7U, 0x97c6c651U, 0xcbe8e823U, 0xa1dddd7cU, 0xe874749cU, 0x3e1f1f21U,
+    0x964b4bddU, 0x61bdbddcU, 0x0d8b8b86U, 0x0f8a8a85U, 0xe0707090U, 0x7c3e3e42U,
+    0x71b5b5c4U, 0xcc6666aaU, 0x904848d8U, 0x06030305U, 0xf7f6f601U, 0x1c0e0e12U,
+    0xc26161a3U, 0x6a35355fU, 0xae5757f9U, 0x69b9b9d0U, 0x17868691U, 0x99c1c158U,
+    0x3a1d1d27U, 0x279e9eb9U, 0xd9e1e138U, 0xebf8f813U, 0x2b9898b3U, 0x22111133U,
+    0xd26969bbU, 0xa9d9d970U, 0x078e8e89U, 0x339494a7U, 0x2d9b9bb6U, 0x3c1e1e22U,
+    0x15878792U, 0xc9e9e920U, 0x87cece49U, 0xaa5555ffU, 0x50282878U, 0xa5dfdf7aU,
+    0x038c8c8fU, 0x59a1a1f8U, 0x09898980U, 0x1a0d0d17U, 0x65bfbfdaU, 0xd7e6e631U,
+    0x844242c6U, 0xd06868b8U, 0x824141c3U, 0x299999b0U, 0x5a2d2d77U, 0x1e0f0f11U,
+    0x7bb0b0cbU, 0xa85454fcU, 0x6dbbbbd6U, 0x2c16163aU
+};
+static const UINT8 smp_aes_rcon[SMP_AES_ROUNDS] =
+{
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36
+};
+
+    /* the cipher works on 32 bit words, UINT32 may be wider */
+    #define SMP_AES_GET32(p)    (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | \
+                                 ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+    #define SMP_AES_PUT32(p, v) {(p)[0] = (UINT8)((v) >> 24); (p)[1] = (UINT8)((v) >> 16); \
+                                 (p)[2] = (UINT8)((v) >> 8); (p)[3] = (UINT8)(v);}
+    #define SMP_AES_ROR(v, n)   (((v) >> (n)) | ((v) << (32 - (n))))
+
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_sw
+**
+** Description      This function encrypts one block with the table driven
+**                  implementation.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void smp_aes_encrypt_sw (const tSMP_AES_KEY *p_ks, const UINT8 *p_in, UINT8 *p_out)
+{
+    const UINT8 *p_rk = p_ks->rk;
+    uint32_t    s0, s1, s2, s3, t0, t1, t2, t3;
+    int         round;
+
+    s0 = SMP_AES_GET32(p_in)      ^ SMP_AES_GET32(p_rk);
+    s1 = SMP_AES_GET32(p_in + 4)  ^ SMP_AES_GET32(p_rk + 4);
+    s2 = SMP_AES_GET32(p_in + 8)  ^ SMP_AES_GET32(p_rk + 8);
+    s3 = SMP_AES_GET32(p_in + 12) ^ SMP_AES_GET32(p_rk + 12);
+
+    for (round = 1; round < SMP_AES_ROUNDS; round++)
+    {
+        p_rk += BT_OCTET16_LEN;
+        t0 = smp_aes_te0[s0 >> 24] ^ SMP_AES_ROR(smp_aes_te0[(s1 >> 16) & 0xff], 8) ^
+             SMP_AES_ROR(smp_aes_te0[(s2 >> 8) & 0xff], 16) ^ SMP_AES_ROR(smp_aes_te0[s3 & 0xff], 24) ^
+             SMP_AES_GET32(p_rk);
+        t1 = smp_aes_te0[s1 >> 24] ^ SMP_AES_ROR(smp_aes_te0[(s2 >> 16) & 0xff], 8) ^
+             SMP_AES_ROR(smp_aes_te0[(s3 >> 8) & 0xff], 16) ^ SMP_AES_ROR(smp_aes_te0[s0 & 0xff], 24) ^
+             SMP_AES_GET32(p_rk + 4);
+        t2 = smp_aes_te0[s2 >> 24] ^ SMP_AES_ROR(smp_aes_te0[(s3 >> 16) & 0xff], 8) ^
+             SMP_AES_ROR(smp_aes_te0[(s0 >> 8) & 0xff], 16) ^ SMP_AES_ROR(smp_aes_te0[s1 & 0xff], 24) ^
+             SMP_AES_GET32(p_rk + 8);
+        t3 = smp_aes_te0[s3 >> 24] ^ SMP_AES_ROR(smp_aes_te0[(s0 >> 16) & 0xff], 8) ^
+             SMP_AES_ROR(smp_aes_te0[(s1 >> 8) & 0xff], 16) ^ SMP_AES_ROR(smp_aes_te0[s2 & 0xff], 24) ^
+             SMP_AES_GET32(p_rk + 12);
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    /* last round: no MixColumns */
+    p_rk += BT_OCTET16_LEN;
+    t0 = ((uint32_t)smp_aes_sbox[s0 >> 24] << 24) | ((uint32_t)smp_aes_sbox[(s1 >> 16) & 0xff] << 16) |
+         ((uint32_t)smp_aes_sbox[(s2 >> 8) & 0xff] << 8) | smp_aes_sbox[s3 & 0xff];
+    t1 = ((uint32_t)smp_aes_sbox[s1 >> 24] << 24) | ((uint32_t)smp_aes_sbox[(s2 >> 16) & 0xff] << 16) |
+         ((uint32_t)smp_aes_sbox[(s3 >> 8) & 0xff] << 8) | smp_aes_sbox[s0 & 0xff];
+    t2 = ((uint32_t)smp_aes_sbox[s2 >> 24] << 24) | ((uint32_t)smp_aes_sbox[(s3 >> 16) & 0xff] << 16) |
+         ((uint32_t)smp_aes_sbox[(s0 >> 8) & 0xff] << 8) | smp_aes_sbox[s1 & 0xff];
+    t3 = ((uint32_t)smp_aes_sbox[s3 >> 24] << 24) | ((uint32_t)smp_aes_sbox[(s0 >> 16) & 0xff] << 16) |
+         ((uint32_t)smp_aes_sbox[(s1 >> 8) & 0xff] << 8) | smp_aes_sbox[s2 & 0xff];
+
+    SMP_AES_PUT32(p_out,      t0 ^ SMP_AES_GET32(p_rk));
+    SMP_AES_PUT32(p_out + 4,  t1 ^ SMP_AES_GET32(p_rk + 4));
+    SMP_AES_PUT32(p_out + 8,  t2 ^ SMP_AES_GET32(p_rk + 8));
+    SMP_AES_PUT32(p_out + 12, t3 ^ SMP_AES_GET32(p_rk + 12));
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_multi_sw
+**
+** Description      This function encrypts one block under num_keys keys in
+**                  software.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void smp_aes_encrypt_multi_sw (const tSMP_AES_KEY *p_ks, UINT16 num_keys, const UINT8 *p_in, UINT8 *p_out)
+{
+    for ( ; num_keys > 0; num_keys--, p_ks++, p_out += BT_OCTET16_LEN)
+        smp_aes_encrypt_sw(p_ks, p_in, p_out);
+}
+
+    #if SMP_AES_NI == TRUE
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_ni
+**
+** Description      This function encrypts one block with AES-NI.
+**
+** Returns          void
+**
+*******************************************************************************/
+__attribute__((target("aes,sse2")))
+static void smp_aes_encrypt_ni (const tSMP_AES_KEY *p_ks, const UINT8 *p_in, UINT8 *p_out)
+{
+    const __m128i   *p_rk = (const __m128i *)p_ks->rk;
+    __m128i         s;
+    int             round;
+
+    s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p_in), _mm_loadu_si128(p_rk));
+    for (round = 1; round < SMP_AES_ROUNDS; round++)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(p_rk + round));
+    s = _mm_aesenclast_si128(s, _mm_loadu_si128(p_rk + SMP_AES_ROUNDS));
+
+    _mm_storeu_si128((__m128i *)p_out, s);
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_multi_ni
+**
+** Description      This function encrypts one block under num_keys keys with
+**                  AES-NI. Four keys are worked on together so that the
+**                  latency of each AESENC is hidden behind the others.
+**
+** Returns          void
+**
+*******************************************************************************/
+__attribute__((target("aes,sse2")))
+static void smp_aes_encrypt_multi_ni (const tSMP_AES_KEY *p_ks, UINT16 num_keys, const UINT8 *p_in, UINT8 *p_out)
+{
+    const __m128i   in = _mm_loadu_si128((const __m128i *)p_in);
+    const __m128i   *k0, *k1, *k2, *k3;
+    __m128i         s0, s1, s2, s3;
+    int             round;
+
+    for ( ; num_keys >= 4; num_keys -= 4, p_ks += 4, p_out += 4 * BT_OCTET16_LEN)
+    {
+        k0 = (const __m128i *)p_ks[0].rk;
+        k1 = (const __m128i *)p_ks[1].rk;
+        k2 = (const __m128i *)p_ks[2].rk;
+        k3 = (const __m128i *)p_ks[3].rk;
+
+        s0 = _mm_xor_si128(in, _mm_loadu_si128(k0));
+        s1 = _mm_xor_si128(in, _mm_loadu_si128(k1));
+        s2 = _mm_xor_si128(in, _mm_loadu_si128(k2));
+        s3 = _mm_xor_si128(in, _mm_loadu_si128(k3));
+        for (round = 1; round < SMP_AES_ROUNDS; round++)
+        {
+            s0 = _mm_aesenc_si128(s0, _mm_loadu_si128(k0 + round));
+            s1 = _mm_aesenc_si128(s1, _mm_loadu_si128(k1 + round));
+            s2 = _mm_aesenc_si128(s2, _mm_loadu_si128(k2 + round));
+            s3 = _mm_aesenc_si128(s3, _mm_loadu_si128(k3 + round));
+        }
+        s0 = _mm_aesenclast_si128(s0, _mm_loadu_si128(k0 + SMP_AES_ROUNDS));
+        s1 = _mm_aesenclast_si128(s1, _mm_loadu_si128(k1 + SMP_AES_ROUNDS));
+        s2 = _mm_aesenclast_si128(s2, _mm_loadu_si128(k2 + SMP_AES_ROUNDS));
+        s3 = _mm_aesenclast_si128(s3, _mm_loadu_si128(k3 + SMP_AES_ROUNDS));
+
+        _mm_storeu_si128((__m128i *)p_out, s0);
+        _mm_storeu_si128((__m128i *)(p_out + BT_OCTET16_LEN), s1);
+        _mm_storeu_si128((__m128i *)(p_out + 2 * BT_OCTET16_LEN), s2);
+        _mm_storeu_si128((__m128i *)(p_out + 3 * BT_OCTET16_LEN), s3);
+    }
+
+    for ( ; num_keys > 0; num_keys--, p_ks++, p_out += BT_OCTET16_LEN)
+        smp_aes_encrypt_ni(p_ks, p_in, p_out);
+}
+    #endif
+
+    #if SMP_AES_ARMV8 == TRUE
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_armv8
+**
+** Description      This function encrypts one block with the ARMv8 Crypto
+**                  Extensions. AESE does AddRoundKey before SubBytes and
+**                  ShiftRows, so the last round key is added separately.
+**
+** Returns          void
+**
+*******************************************************************************/
+        #if defined(__clang__)
+__attribute__((target("aes")))
+        #else
+__attribute__((target("+crypto")))
+        #endif
+static void smp_aes_encrypt_armv8 (const tSMP_AES_KEY *p_ks, const UINT8 *p_in, UINT8 *p_out)
+{
+    uint8x16_t  s = vld1q_u8(p_in);
+    int         round;
+
+    for (round = 0; round < SMP_AES_ROUNDS - 1; round++)
+        s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(&p_ks->rk[round * BT_OCTET16_LEN])));
+    s = vaeseq_u8(s, vld1q_u8(&p_ks->rk[(SMP_AES_ROUNDS - 1) * BT_OCTET16_LEN]));
+    s = veorq_u8(s, vld1q_u8(&p_ks->rk[SMP_AES_ROUNDS * BT_OCTET16_LEN]));
+
+    vst1q_u8(p_out, s);
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_multi_armv8
+**
+** Description      This function encrypts one block under num_keys keys with
+**                  the ARMv8 Crypto Extensions, four keys at a time.
+**
+** Returns          void
+**
+*******************************************************************************/
+        #if defined(__clang__)
+__attribute__((target("aes")))
+        #else
+__attribute__((target("+crypto")))
+        #endif
+static void smp_aes_encrypt_multi_armv8 (const tSMP_AES_KEY *p_ks, UINT16 num_keys, const UINT8 *p_in, UINT8 *p_out)
+{
+    const uint8x16_t    in = vld1q_u8(p_in);
+    uint8x16_t          s0, s1, s2, s3;
+    int                 round, off;
+
+    for ( ; num_keys >= 4; num_keys -= 4, p_ks += 4, p_out += 4 * BT_OCTET16_LEN)
+    {
+        s0 = s1 = s2 = s3 = in;
+        for (round = 0; round < SMP_AES_ROUNDS - 1; round++)
+        {
+            off = round * BT_OCTET16_LEN;
+            s0 = vaesmcq_u8(vaeseq_u8(s0, vld1q_u8(&p_ks[0].rk[off])));
+            s1 = vaesmcq_u8(vaeseq_u8(s1, vld1q_u8(&p_ks[1].rk[off])));
+            s2 = vaesmcq_u8(vaeseq_u8(s2, vld1q_u8(&p_ks[2].rk[off])));
+            s3 = vaesmcq_u8(vaeseq_u8(s3, vld1q_u8(&p_ks[3].rk[off])));
+        }
+        off = (SMP_AES_ROUNDS - 1) * BT_OCTET16_LEN;
+        s0 = veorq_u8(vaeseq_u8(s0, vld1q_u8(&p_ks[0].rk[off])), vld1q_u8(&p_ks[0].rk[off + BT_OCTET16_LEN]));
+        s1 = veorq_u8(vaeseq_u8(s1, vld1q_u8(&p_ks[1].rk[off])), vld1q_u8(&p_ks[1].rk[off + BT_OCTET16_LEN]));
+        s2 = veorq_u8(vaeseq_u8(s2, vld1q_u8(&p_ks[2].rk[off])), vld1q_u8(&p_ks[2].rk[off + BT_OCTET16_LEN]));
+        s3 = veorq_u8(vaeseq_u8(s3, vld1q_u8(&p_ks[3].rk[off])), vld1q_u8(&p_ks[3].rk[off + BT_OCTET16_LEN]));
+
+        vst1q_u8(p_out, s0);
+        vst1q_u8(p_out + BT_OCTET16_LEN, s1);
+        vst1q_u8(p_out + 2 * BT_OCTET16_LEN, s2);
+        vst1q_u8(p_out + 3 * BT_OCTET16_LEN, s3);
+    }
+
+    for ( ; num_keys > 0; num_keys--, p_ks++, p_out += BT_OCTET16_LEN)
+        smp_aes_encrypt_armv8(p_ks, p_in, p_out);
+}
+    #endif
+
+/*******************************************************************************
+**
+** Function         smp_aes_init
+**
+** Description      This function picks the AES implementation for this CPU
+**                  and empties the key cache.
+**
+** Returns          void
+**
+*******************************************************************************/
+void smp_aes_init (void)
+{
+    #if SMP_AES_NI == TRUE
+    unsigned int    eax, ebx, ecx, edx;
+    #endif
+
+    memset(&smp_aes_cb, 0, sizeof(tSMP_AES_CB));
+    smp_aes_cb.p_encrypt = smp_aes_encrypt_sw;
+    smp_aes_cb.p_encrypt_multi = smp_aes_encrypt_multi_sw;
+    smp_aes_cb.p_name = "software";
+
+    #if SMP_AES_NI == TRUE
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES))
+    {
+        smp_aes_cb.p_encrypt = smp_aes_encrypt_ni;
+        smp_aes_cb.p_encrypt_multi = smp_aes_encrypt_multi_ni;
+        smp_aes_cb.p_name = "AES-NI";
+    }
+    #elif SMP_AES_ARMV8 == TRUE
+    if (getauxval(AT_HWCAP) & HWCAP_AES)
+    {
+        smp_aes_cb.p_encrypt = smp_aes_encrypt_armv8;
+        smp_aes_cb.p_encrypt_multi = smp_aes_encrypt_multi_armv8;
+        smp_aes_cb.p_name = "ARMv8 CE";
+    }
+    #endif
+
+    SMP_TRACE_DEBUG1 ("smp_aes_init: using %s AES", smp_aes_cb.p_name);
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_set_key
+**
+** Description      This function expands an AES-128 key, given MSB first,
+**                  into its round keys.
+**
+** Returns          void
+**
+*******************************************************************************/
+void smp_aes_set_key (const UINT8 *p_key, tSMP_AES_KEY *p_ks)
+{
+    UINT8   *p = p_ks->rk;
+    int     i;
+
+    memcpy(p, p_key, BT_OCTET16_LEN);
+
+    for (i = 0; i < SMP_AES_ROUNDS; i++, p += BT_OCTET16_LEN)
+    {
+        /* RotWord, SubWord and Rcon on the last word of the previous round key */
+        p[16] = p[0] ^ smp_aes_sbox[p[13]] ^ smp_aes_rcon[i];
+        p[17] = p[1] ^ smp_aes_sbox[p[14]];
+        p[18] = p[2] ^ smp_aes_sbox[p[15]];
+        p[19] = p[3] ^ smp_aes_sbox[p[12]];
+
+        p[20] = p[4] ^ p[16];  p[21] = p[5] ^ p[17];  p[22] = p[6] ^ p[18];  p[23] = p[7] ^ p[19];
+        p[24] = p[8] ^ p[20];  p[25] = p[9] ^ p[21];  p[26] = p[10] ^ p[22]; p[27] = p[11] ^ p[23];
+        p[28] = p[12] ^ p[24]; p[29] = p[13] ^ p[25]; p[30] = p[14] ^ p[26]; p[31] = p[15] ^ p[27];
+    }
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_get_key
+**
+** Description      This function returns the round keys of an AES-128 key,
+**                  given MSB first, from the key cache. The key is expanded
+**                  into the least recently used entry if not cached. The
+**                  result is valid until the next call.
+**
+** Returns          Pointer to the round keys
+**
+*******************************************************************************/
+const tSMP_AES_KEY *smp_aes_get_key (const UINT8 *p_key)
+{
+    tSMP_AES_CACHE  *p_ent = &smp_aes_cb.cache[0];
+    tSMP_AES_CACHE  *p_lru = p_ent;
+    int             i;
+
+    for (i = 0; i < SMP_AES_KEY_CACHE_SIZE; i++, p_ent++)
+    {
+        if (p_ent->in_use && memcmp(p_ent->key, p_key, BT_OCTET16_LEN) == 0)
+        {
+            p_ent->last_use = ++smp_aes_cb.use_count;
+            return &p_ent->ks;
+        }
+
+        if (!p_ent->in_use)
+        {
+            if (p_lru->in_use)
+                p_lru = p_ent;
+        }
+        else if (p_lru->in_use && p_ent->last_use < p_lru->last_use)
+            p_lru = p_ent;
+    }
+
+    memcpy(p_lru->key, p_key, BT_OCTET16_LEN);
+    smp_aes_set_key(p_key, &p_lru->ks);
+    p_lru->in_use = TRUE;
+    p_lru->last_use = ++smp_aes_cb.use_count;
+
+    return &p_lru->ks;
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt
+**
+** Description      This function encrypts one 16 byte block, MSB first.
+**                  p_in and p_out may be the same buffer.
+**
+** Returns          void
+**
+*******************************************************************************/
+void smp_aes_encrypt (const tSMP_AES_KEY *p_ks, const UINT8 *p_in, UINT8 *p_out)
+{
+    (*smp_aes_cb.p_encrypt)(p_ks, p_in, p_out);
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_multi
+**
+** Description      This function encrypts one 16 byte block, MSB first, under
+**                  each of num_keys keys. p_out receives num_keys blocks.
+**
+** Returns          void
+**
+*******************************************************************************/
+void smp_aes_encrypt_multi (const tSMP_AES_KEY *p_ks, UINT16 num_keys, const UINT8 *p_in, UINT8 *p_out)
+{
+    (*smp_aes_cb.p_encrypt_multi)(p_ks, num_keys, p_in, p_out);
+}
+
+/*******************************************************************************
+**
+** Function         smp_aes_encrypt_le
+**
+** Description      This function encrypts one 16 byte block held LSB first,
+**                  the byte order SMP keeps keys and data in, with a key also
+**                  held LSB first. p_in and p_out may be the same buffer.
+**
+** Returns          void
+**
+*******************************************************************************/
+void smp_aes_encrypt_le (const UINT8 *p_key, const UINT8 *p_in, UINT8 *p_out)
+{
+    UINT8   rev_key[BT_OCTET16_LEN];
+    UINT8   block[BT_OCTET16_LEN];
+    int     i;
+
+    for (i = 0; i < BT_OCTET16_LEN; i++)
+    {
+        rev_key[i] = p_key[BT_OCTET16_LEN - 1 - i];
+        block[i] = p_in[BT_OCTET16_LEN - 1 - i];
+    }
+
+    smp_aes_encrypt(smp_aes_get_key(rev_key), block, block);
+
+    for (i = 0; i < BT_OCTET16_LEN; i++)
+        p_out[i] = block[BT_OCTET16_LEN - 1 - i];
+}
+
+#endif /* SMP_INCLUDED */
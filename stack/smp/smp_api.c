@@ -58,6 +58,7 @@ void SMP_Init(void)
 #endif
 
     smp_l2cap_if_init();
+    smp_aes_init();
 }
 
 
@@ -332,6 +333,72 @@ BOOLEAN SMP_Encrypt (UINT8 *key, UINT8 key_len,
     status = smp_encrypt_data(key, key_len, plain_text, pt_len, p_out);
     return status;
 }
+
+/*******************************************************************************
+**
+** Function         SMP_AesSetKey
+**
+** Description      This function expands an AES-128 key into the round keys
+**                  used by SMP_MatchRpa().
+**
+** Parameters:      key                 - the key, key[0] contains the LSB
+**                  p_ks                - the expanded key
+**
+**  Returns         void
+*******************************************************************************/
+void SMP_AesSetKey (BT_OCTET16 key, tSMP_AES_KEY *p_ks)
+{
+    UINT8   rev_key[BT_OCTET16_LEN];
+    int     i;
+
+    for (i = 0; i < BT_OCTET16_LEN; i++)
+        rev_key[i] = key[BT_OCTET16_LEN - 1 - i];
+
+    smp_aes_set_key(rev_key, p_ks);
+}
+
+/*******************************************************************************
+**
+** Function         SMP_MatchRpa
+**
+** Description      This function looks for the IRK a resolvable private
+**                  address was generated from: the one for which
+**                  ah(IRK, prand), the AES of the 3 MSB of the address padded
+**                  with zeros, ends in the 3 LSB of the address.
+**
+** Parameters:      rpa                 - the resolvable private address
+**                  p_ks                - IRKs expanded with SMP_AesSetKey()
+**                  num_keys            - number of keys at p_ks
+**
+**  Returns         index of the first matching key, num_keys if none matches
+*******************************************************************************/
+UINT16 SMP_MatchRpa (BD_ADDR rpa, const tSMP_AES_KEY *p_ks, UINT16 num_keys)
+{
+    UINT8   r_prime[BT_OCTET16_LEN];
+    UINT8   hash[SMP_RPA_MATCH_BATCH][BT_OCTET16_LEN];
+    UINT16  xx, yy, num;
+
+    /* r' = padding || prand, MSB first */
+    memset(r_prime, 0, BT_OCTET16_LEN);
+    memcpy(&r_prime[BT_OCTET16_LEN - 3], rpa, 3);
+
+    for (xx = 0; xx < num_keys; xx += num)
+    {
+        num = num_keys - xx;
+        if (num > SMP_RPA_MATCH_BATCH)
+            num = SMP_RPA_MATCH_BATCH;
+
+        smp_aes_encrypt_multi(&p_ks[xx], num, r_prime, hash[0]);
+
+        for (yy = 0; yy < num; yy++)
+        {
+            if (memcmp(&hash[yy][BT_OCTET16_LEN - 3], &rpa[3], 3) == 0)
+                return xx + yy;
+        }
+    }
+
+    return num_keys;
+}
 #endif /* SMP_INCLUDED */
 
 
@@ -134,43 +134,31 @@ static void cmac_aes_cleanup(void)
 *******************************************************************************/
 static BOOLEAN cmac_aes_k_calculate(BT_OCTET16 key, UINT8 *p_signature, UINT16 tlen)
 {
-    tSMP_ENC output;
-    UINT8    i = 1, err = 0;
+    UINT8    i = 1;
     UINT8    x[16] = {0};
     UINT8   *p_mac;
 
     SMP_TRACE_EVENT0 ("cmac_aes_k_calculate ");
 
+    /* every block uses the same key, its round keys come from the SMP key cache */
     while (i <= cmac_cb.round)
     {
         smp_xor_128(&cmac_cb.text[(cmac_cb.round - i)*BT_OCTET16_LEN], x); /* Mi' := Mi (+) X  */
 
-        if (!SMP_Encrypt(key, BT_OCTET16_LEN, &cmac_cb.text[(cmac_cb.round - i)*BT_OCTET16_LEN], BT_OCTET16_LEN, &output))
-        {
-            err = 1;
-            break;
-        }
-
-        memcpy(x, output.param_buf, BT_OCTET16_LEN);
+        smp_aes_encrypt_le(key, &cmac_cb.text[(cmac_cb.round - i)*BT_OCTET16_LEN], x);
         i ++;
     }
 
-    if (!err)
-    {
-        p_mac = output.param_buf + (BT_OCTET16_LEN - tlen);
-        memcpy(p_signature, p_mac, tlen);
-
-        SMP_TRACE_DEBUG2("tlen = %d p_mac = %d", tlen, p_mac);
-        SMP_TRACE_DEBUG4("p_mac[0] = 0x%02x p_mac[1] = 0x%02x p_mac[2] = 0x%02x p_mac[3] = 0x%02x",
-                         *p_mac, *(p_mac + 1), *(p_mac + 2), *(p_mac + 3));
-        SMP_TRACE_DEBUG4("p_mac[4] = 0x%02x p_mac[5] = 0x%02x p_mac[6] = 0x%02x p_mac[7] = 0x%02x",
-                         *(p_mac + 4), *(p_mac + 5), *(p_mac + 6), *(p_mac + 7));
+    p_mac = x + (BT_OCTET16_LEN - tlen);
+    memcpy(p_signature, p_mac, tlen);
 
-        return TRUE;
+    SMP_TRACE_DEBUG2("tlen = %d p_mac = %d", tlen, p_mac);
+    SMP_TRACE_DEBUG4("p_mac[0] = 0x%02x p_mac[1] = 0x%02x p_mac[2] = 0x%02x p_mac[3] = 0x%02x",
+                     *p_mac, *(p_mac + 1), *(p_mac + 2), *(p_mac + 3));
+    SMP_TRACE_DEBUG4("p_mac[4] = 0x%02x p_mac[5] = 0x%02x p_mac[6] = 0x%02x p_mac[7] = 0x%02x",
+                     *(p_mac + 4), *(p_mac + 5), *(p_mac + 6), *(p_mac + 7));
 
-    }
-    else
-        return FALSE;
+    return TRUE;
 }
 /*******************************************************************************
 **
@@ -263,18 +251,13 @@ static void cmac_subkey_cont(tSMP_ENC *p)
 static BOOLEAN cmac_generate_subkey(BT_OCTET16 key)
 {
     BT_OCTET16 z = {0};
-    BOOLEAN     ret = TRUE;
     tSMP_ENC output;
     SMP_TRACE_EVENT0 (" cmac_generate_subkey");
 
-    if (SMP_Encrypt(key, BT_OCTET16_LEN, z, BT_OCTET16_LEN, &output))
-    {
-        cmac_subkey_cont(&output);;
-    }
-    else
-        ret = FALSE;
+    smp_aes_encrypt_le(key, z, output.param_buf);
+    cmac_subkey_cont(&output);
 
-    return ret;
+    return TRUE;
 }
 /*******************************************************************************
 **
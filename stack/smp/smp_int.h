@@ -40,6 +40,9 @@ typedef UINT8   tSMP_ASSO_MODEL;
     #define SMP_MAX_CONN    2
 #endif
 
+/* number of IRKs SMP_MatchRpa() hashes per call to smp_aes_encrypt_multi() */
+#define SMP_RPA_MATCH_BATCH     8
+
 #define SMP_WAIT_FOR_RSP_TOUT			30
 #define SMP_WAIT_FOR_REL_DELAY_TOUT     5
 /* SMP L2CAP command code */
@@ -299,6 +302,14 @@ extern void smp_xor_128(BT_OCTET16 a, BT_OCTET16 b);
 extern BOOLEAN smp_encrypt_data (UINT8 *key, UINT8 key_len,
                                  UINT8 *plain_text, UINT8 pt_len,
                                  tSMP_ENC *p_out);
+/* smp aes */
+extern void smp_aes_init (void);
+extern void smp_aes_set_key (const UINT8 *p_key, tSMP_AES_KEY *p_ks);
+extern const tSMP_AES_KEY *smp_aes_get_key (const UINT8 *p_key);
+extern void smp_aes_encrypt (const tSMP_AES_KEY *p_ks, const UINT8 *p_in, UINT8 *p_out);
+extern void smp_aes_encrypt_multi (const tSMP_AES_KEY *p_ks, UINT16 num_keys, const UINT8 *p_in, UINT8 *p_out);
+extern void smp_aes_encrypt_le (const UINT8 *p_key, const UINT8 *p_in, UINT8 *p_out);
+
 /* smp key */
 extern void smp_generate_confirm (tSMP_CB *p_cb, tSMP_INT_DATA *p_data);
 extern void smp_generate_compare (tSMP_CB *p_cb, tSMP_INT_DATA *p_data);
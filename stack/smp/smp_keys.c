@@ -36,7 +36,6 @@
     #include "btm_int.h"
     #include "btm_ble_int.h"
     #include "hcimsgs.h"
-    #include "aes.h"
     #ifndef SMP_MAX_ENC_REPEAT
         #define SMP_MAX_ENC_REPEAT      3
     #endif
@@ -99,12 +98,7 @@ BOOLEAN smp_encrypt_data (UINT8 *key, UINT8 key_len,
                           UINT8 *plain_text, UINT8 pt_len,
                           tSMP_ENC *p_out)
 {
-    aes_context     ctx;
-    UINT8           *p_start = NULL;
-    UINT8           *p = NULL;
-    UINT8           *p_rev_data = NULL;    /* input data in big endilan format */
-    UINT8           *p_rev_key = NULL;     /* input key in big endilan format */
-    UINT8           *p_rev_output = NULL;  /* encrypted output in big endilan format */
+    UINT8           data[SMP_ENCRYT_DATA_SIZE];   /* input data, zero padded */
 
     SMP_TRACE_DEBUG0 ("smp_encrypt_data");
     if ( (p_out == NULL ) || (key_len != SMP_ENCRYT_KEY_SIZE) )
@@ -113,39 +107,22 @@ BOOLEAN smp_encrypt_data (UINT8 *key, UINT8 key_len,
         return(FALSE);
     }
 
-    if ((p_start = (UINT8 *)GKI_getbuf((SMP_ENCRYT_DATA_SIZE*4))) == NULL)
-    {
-        BTM_TRACE_ERROR0 ("smp_encrypt_data Failed unable to allocate buffer");
-        return(FALSE);
-    }
-
     if (pt_len > SMP_ENCRYT_DATA_SIZE)
         pt_len = SMP_ENCRYT_DATA_SIZE;
 
-    memset(p_start, 0, SMP_ENCRYT_DATA_SIZE * 4);
-    p = p_start;
-    ARRAY_TO_STREAM (p, plain_text, pt_len); /* byte 0 to byte 15 */
-    p_rev_data = p = p_start + SMP_ENCRYT_DATA_SIZE; /* start at byte 16 */
-    REVERSE_ARRAY_TO_STREAM (p, p_start, SMP_ENCRYT_DATA_SIZE);  /* byte 16 to byte 31 */
-    p_rev_key = p; /* start at byte 32 */
-    REVERSE_ARRAY_TO_STREAM (p, key, SMP_ENCRYT_KEY_SIZE); /* byte 32 to byte 47 */
+    memset(data, 0, SMP_ENCRYT_DATA_SIZE);
+    memcpy(data, plain_text, pt_len);
 
     smp_debug_print_nbyte_little_endian(key, (const UINT8 *)"Key", SMP_ENCRYT_KEY_SIZE);
-    smp_debug_print_nbyte_little_endian(p_start, (const UINT8 *)"Plain text", SMP_ENCRYT_DATA_SIZE);
-    p_rev_output = p;
-    aes_set_key(p_rev_key, SMP_ENCRYT_KEY_SIZE, &ctx);
-    aes_encrypt(p_rev_data, p, &ctx);  /* outputs in byte 48 to byte 63 */
+    smp_debug_print_nbyte_little_endian(data, (const UINT8 *)"Plain text", SMP_ENCRYT_DATA_SIZE);
 
-    p = p_out->param_buf;
-    REVERSE_ARRAY_TO_STREAM (p, p_rev_output, SMP_ENCRYT_DATA_SIZE);
+    smp_aes_encrypt_le(key, data, p_out->param_buf);
     smp_debug_print_nbyte_little_endian(p_out->param_buf, (const UINT8 *)"Encrypted text", SMP_ENCRYT_KEY_SIZE);
 
     p_out->param_len = SMP_ENCRYT_KEY_SIZE;
     p_out->status = HCI_SUCCESS;
     p_out->opcode =  HCI_BLE_ENCRYPT;
 
-    GKI_freebuf(p_start);
-
     return(TRUE);
 }
 
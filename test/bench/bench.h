@@ -0,0 +1,127 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      bench.h
+ *
+ *  Description:   Shared definitions of btbench, the headless benchmark that
+ *                 runs the stack (GKI, BTU, L2CAP, RFCOMM) against a simulated
+ *                 controller over a socketpair
+ *
+ ******************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <semaphore.h>
+
+#include "bench_report.h"
+#include "bt_target.h"
+#include "gki.h"
+#include "bt_types.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+/* BTU mailbox event of a function call posted to the BTU task */
+#define BENCH_EVT_CALL          0x7f00
+
+/* PSMs served by the emulated peer */
+#define BENCH_PSM_ECHO          0x1001      /* data is looped back          */
+#define BENCH_PSM_SINK          0x1003      /* data is consumed and counted */
+
+/* Peers are 00:1b:dc:00:00:<n> */
+#define BENCH_PEER_ADDR_BASE    {0x00, 0x1b, 0xdc, 0x00, 0x00, 0x00}
+
+/* Devices that answer inquiry are 00:1b:dc:02:<n high>:<n low>, n from 1 */
+#define BENCH_INQ_ADDR(bd, n)   {static const BD_ADDR base = BENCH_PEER_ADDR_BASE; \
+                                 memcpy(bd, base, BD_ADDR_LEN); bd[3] = 0x02; \
+                                 bd[4] = (UINT8)((n) >> 8); bd[5] = (UINT8)(n);}
+
+/* Payloads sent by a scenario carry the 32 bit index of the packet, so the
+** sink and echo paths can find the time it was sent */
+#define BENCH_IDX_LEN           4
+
+#define BENCH_MAX_CHANNELS      MAX_L2CAP_CHANNELS
+
+/*******************************************************************************
+**  Type definitions
+********************************************************************************/
+
+typedef void (tBENCH_CALL_FN) (void *p_data);
+
+/* Simulated controller configuration */
+typedef struct
+{
+    BD_ADDR     local_addr;
+    UINT16      acl_data_len;       /* HCI_Read_Buffer_Size: ACL data length  */
+    UINT16      acl_num_bufs;       /* HCI_Read_Buffer_Size: ACL buffer count */
+    UINT16      peer_mtu;           /* MTU the peers offer in L2CAP config    */
+} tBENCH_CTRL_CFG;
+
+/* Called in the controller thread for every PDU received on a sink channel */
+typedef void (tBENCH_SINK_CBACK) (UINT16 psm, UINT8 *p_data, UINT16 len);
+
+/* Command line options shared by the scenarios */
+typedef struct
+{
+    UINT32      count;              /* packets, connections or messages       */
+    UINT16      size;               /* payload size, 0 for scenario default   */
+    UINT8       links;              /* ACL links used by acl_throughput       */
+    UINT8       chans;              /* channels per link for acl_throughput   */
+    UINT16      window;             /* packets in flight for echo scenarios   */
+    UINT32      timeout_ms;         /* per scenario                           */
+} tBENCH_OPTS;
+
+typedef void (tBENCH_SCENARIO_FN) (const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res);
+
+typedef struct
+{
+    const char          *p_name;
+    tBENCH_SCENARIO_FN  *p_run;
+    const char          *p_desc;
+} tBENCH_SCENARIO;
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/* bench_main.c */
+extern BOOLEAN bench_wait (sem_t *p_sem, UINT32 timeout_ms);
+extern void bench_call (tBENCH_CALL_FN *p_fn, void *p_data);
+extern void bench_call_sync (tBENCH_CALL_FN *p_fn, void *p_data);
+
+/* bench_hci.c */
+extern int bench_hci_open (void);
+extern void bench_hci_close (void);
+
+/* bench_ctrl.c */
+extern BOOLEAN bench_ctrl_start (int fd, const tBENCH_CTRL_CFG *p_cfg);
+extern void bench_ctrl_stop (void);
+extern void bench_ctrl_set_sink (tBENCH_SINK_CBACK *p_cb);
+extern void bench_ctrl_set_inq_peers (UINT16 num);
+
+/* bench_scen.c */
+extern const tBENCH_SCENARIO bench_scenarios[];
+extern BOOLEAN bench_scen_init (void);
+
+#endif /* BENCH_H */
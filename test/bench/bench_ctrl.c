@@ -0,0 +1,1444 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      bench_ctrl.c
+ *
+ *  Description:   Simulated controller of btbench
+ *
+ *                 Runs in its own thread on the controller end of the
+ *                 socketpair and speaks H4. HCI commands are answered with
+ *                 Command Complete, or with Command Status and the completion
+ *                 event, from a fixed controller description. Every device
+ *                 paged is taken to be an emulated peer that accepts the
+ *                 link, answers L2CAP signalling and, depending on the PSM,
+ *                 loops data back, consumes it, or plays the RFCOMM
+ *                 responder that echoes what it receives on each DLC.
+ *                 ACL packets from the host are completed (Number Of
+ *                 Completed Packets) once per read from the socket.
+ *
+ ******************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "hcidefs.h"
+#include "hcimsgs.h"
+#include "l2cdefs.h"
+#include "rfcdefs.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BENCH_CTRL_MAX_CONNS        MAX_L2CAP_LINKS
+#define BENCH_CTRL_MAX_CHANS        16          /* per connection */
+#define BENCH_CTRL_MAX_DLCS         4           /* per connection */
+#define BENCH_CTRL_MAX_PENDING      32          /* RFCOMM frames waiting for credits */
+
+#define BENCH_CTRL_FIRST_HANDLE     0x0040
+#define BENCH_CTRL_FIRST_CID        0x0040
+
+#define BENCH_CTRL_RX_BUF_SIZE      0x20000
+#define BENCH_CTRL_TX_BUF_SIZE      0x20000
+#define BENCH_CTRL_MAX_PDU          (0xFFFF + L2CAP_PKT_OVERHEAD)
+
+#define BENCH_CTRL_H4_CMD           1
+#define BENCH_CTRL_H4_ACL           2
+#define BENCH_CTRL_H4_EVT           4
+
+#define BENCH_CTRL_NAME             "btbench"
+#define BENCH_CTRL_PEER_NAME        "btbench peer"
+
+/* Credits the peer grants the host on a DLC, as far as PN allows */
+#define BENCH_CTRL_RFC_CREDITS      RFCOMM_K_MAX
+
+/* MSC signals the peer reports: RTC, RTR, DV */
+#define BENCH_CTRL_RFC_SIGNALS      (RFCOMM_EA | RFCOMM_MSC_RTC | RFCOMM_MSC_RTR | RFCOMM_MSC_DV)
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+/* Command Complete return parameters of commands with more than a status */
+typedef struct
+{
+    UINT16      opcode;
+    UINT8       echo_len;           /* leading command parameters returned (handle) */
+    UINT8       zero_len;           /* zeroed return parameters that follow         */
+} tBENCH_CTRL_CC;
+
+typedef struct
+{
+    BOOLEAN     in_use;
+    UINT16      psm;
+    UINT16      host_cid;
+    UINT16      peer_cid;
+} tBENCH_CTRL_CHAN;
+
+typedef struct
+{
+    UINT8       *p_data;
+    UINT16      len;
+} tBENCH_CTRL_FRAME;
+
+typedef struct
+{
+    BOOLEAN             in_use;
+    UINT8               dlci;
+    UINT16              tx_credits;     /* frames the host allows the peer to send */
+    UINT16              credits_owed;   /* frames consumed, not yet credited back  */
+    UINT8               pend_first;
+    UINT8               pend_count;
+    tBENCH_CTRL_FRAME   pend[BENCH_CTRL_MAX_PENDING];
+} tBENCH_CTRL_DLC;
+
+typedef struct
+{
+    BOOLEAN             in_use;
+    UINT16              handle;
+    BD_ADDR             bd_addr;
+    UINT16              num_completed;  /* not yet reported to the host */
+    UINT8               sig_id;
+    UINT16              next_cid;
+    tBENCH_CTRL_CHAN    chan[BENCH_CTRL_MAX_CHANS];
+
+    /* ACL data from the host being put back together */
+    UINT8               *p_rx;
+    UINT32              rx_len;
+    UINT32              rx_expected;
+
+    /* RFCOMM responder */
+    UINT16              rfc_host_cid;
+    tBENCH_CTRL_DLC     dlc[BENCH_CTRL_MAX_DLCS];
+} tBENCH_CTRL_CONN;
+
+typedef struct
+{
+    int                 fd;
+    pthread_t           thread;
+    BOOLEAN             running;
+    tBENCH_CTRL_CFG     cfg;
+    tBENCH_SINK_CBACK   *p_sink_cb;
+    UINT16              num_inq_peers;
+    UINT16              next_handle;
+    tBENCH_CTRL_CONN    conn[BENCH_CTRL_MAX_CONNS];
+    UINT8               rfc_crc[256];
+
+    UINT8               rx_buf[BENCH_CTRL_RX_BUF_SIZE];
+    UINT8               tx_buf[BENCH_CTRL_TX_BUF_SIZE];
+    UINT32              tx_len;
+    UINT8               pdu[BENCH_CTRL_MAX_PDU];
+} tBENCH_CTRL_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBENCH_CTRL_CB bench_ctrl_cb;
+
+/* Class of device of the devices that answer inquiry: phone, smartphone */
+static const DEV_CLASS bench_ctrl_inq_cod = {0x5a, 0x02, 0x0c};
+
+static const tBENCH_CTRL_CC bench_ctrl_cc_tbl[] =
+{
+    {HCI_ROLE_DISCOVERY,            2, 1},
+    {HCI_READ_POLICY_SETTINGS,      2, 2},
+    {HCI_WRITE_POLICY_SETTINGS,     2, 0},
+    {HCI_SNIFF_SUB_RATE,            2, 0},
+    {HCI_FLUSH,                     2, 0},
+    {HCI_READ_AUTO_FLUSH_TOUT,      2, 2},
+    {HCI_WRITE_AUTO_FLUSH_TOUT,     2, 0},
+    {HCI_READ_LINK_SUPER_TOUT,      2, 2},
+    {HCI_WRITE_LINK_SUPER_TOUT,     2, 0},
+    {HCI_READ_TRANSMIT_POWER_LEVEL, 2, 1},
+    {HCI_GET_LINK_QUALITY,          2, 1},
+    {HCI_READ_RSSI,                 2, 1},
+    {HCI_READ_STORED_LINK_KEY,      0, 4},
+    {HCI_WRITE_STORED_LINK_KEY,     0, 1},
+    {HCI_DELETE_STORED_LINK_KEY,    0, 2},
+    {HCI_READ_LOCAL_SUPPORTED_CMDS, 0, 64},
+    {HCI_READ_LOCAL_OOB_DATA,       0, 32},
+    {HCI_READ_INQ_TX_POWER_LEVEL,   0, 1},
+};
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_flush
+**
+** Description      Writes out what has been queued for the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_flush(void)
+{
+    UINT32      done = 0;
+    ssize_t     ret;
+
+    while (done < bench_ctrl_cb.tx_len)
+    {
+        ret = write(bench_ctrl_cb.fd, bench_ctrl_cb.tx_buf + done, bench_ctrl_cb.tx_len - done);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            bench_ctrl_cb.running = FALSE;
+            break;
+        }
+        done += ret;
+    }
+    bench_ctrl_cb.tx_len = 0;
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_out
+**
+** Description      Queues bytes for the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_out(const UINT8 *p, UINT32 len)
+{
+    if (bench_ctrl_cb.tx_len + len > BENCH_CTRL_TX_BUF_SIZE)
+        bench_ctrl_flush();
+
+    memcpy(bench_ctrl_cb.tx_buf + bench_ctrl_cb.tx_len, p, len);
+    bench_ctrl_cb.tx_len += len;
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_evt
+**
+** Description      Queues an HCI event for the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_evt(UINT8 code, const UINT8 *p_param, UINT8 len)
+{
+    UINT8   hdr[1 + HCIE_PREAMBLE_SIZE];
+
+    hdr[0] = BENCH_CTRL_H4_EVT;
+    hdr[1] = code;
+    hdr[2] = len;
+    bench_ctrl_out(hdr, sizeof(hdr));
+    bench_ctrl_out(p_param, len);
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_cmd_cmpl
+**
+** Description      Queues a Command Complete event; p_ret holds the return
+**                  parameters after the status, which is always success.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_cmd_cmpl(UINT16 opcode, const UINT8 *p_ret, UINT8 ret_len)
+{
+    UINT8   evt[255];
+    UINT8   *p = evt;
+
+    UINT8_TO_STREAM (p, 1);
+    UINT16_TO_STREAM (p, opcode);
+    UINT8_TO_STREAM (p, HCI_SUCCESS);
+    if (ret_len > sizeof(evt) - 4)
+        ret_len = sizeof(evt) - 4;
+    memcpy(p, p_ret, ret_len);
+
+    bench_ctrl_evt(HCI_COMMAND_COMPLETE_EVT, evt, (UINT8)(4 + ret_len));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_cmd_status
+**
+** Description      Queues a successful Command Status event.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_cmd_status(UINT16 opcode)
+{
+    UINT8   evt[4];
+    UINT8   *p = evt;
+
+    UINT8_TO_STREAM (p, HCI_SUCCESS);
+    UINT8_TO_STREAM (p, 1);
+    UINT16_TO_STREAM (p, opcode);
+
+    bench_ctrl_evt(HCI_COMMAND_STATUS_EVT, evt, sizeof(evt));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_find_conn
+**
+** Description      Finds a connection by handle.
+**
+** Returns          the connection, NULL if there is none
+**
+*******************************************************************************/
+static tBENCH_CTRL_CONN *bench_ctrl_find_conn(UINT16 handle)
+{
+    int xx;
+
+    for (xx = 0; xx < BENCH_CTRL_MAX_CONNS; xx++)
+    {
+        if (bench_ctrl_cb.conn[xx].in_use && (bench_ctrl_cb.conn[xx].handle == handle))
+            return &bench_ctrl_cb.conn[xx];
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_free_dlc
+**
+** Description      Drops a DLC and the frames it still had to send.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_free_dlc(tBENCH_CTRL_DLC *p_dlc)
+{
+    while (p_dlc->pend_count)
+    {
+        free(p_dlc->pend[p_dlc->pend_first].p_data);
+        p_dlc->pend_first = (p_dlc->pend_first + 1) % BENCH_CTRL_MAX_PENDING;
+        p_dlc->pend_count--;
+    }
+    memset(p_dlc, 0, sizeof(*p_dlc));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_free_conn
+**
+** Description      Releases a connection.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_free_conn(tBENCH_CTRL_CONN *p_conn)
+{
+    int xx;
+
+    for (xx = 0; xx < BENCH_CTRL_MAX_DLCS; xx++)
+        bench_ctrl_free_dlc(&p_conn->dlc[xx]);
+    free(p_conn->p_rx);
+    memset(p_conn, 0, sizeof(*p_conn));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_l2cap_tx
+**
+** Description      Sends an L2CAP PDU of the peer to the host, in ACL
+**                  fragments of the controller's ACL data length.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_l2cap_tx(tBENCH_CTRL_CONN *p_conn, UINT16 cid,
+                                const UINT8 *p_data, UINT16 len)
+{
+    UINT8   *p = bench_ctrl_cb.pdu;
+    UINT8   hdr[1 + HCI_DATA_PREAMBLE_SIZE];
+    UINT8   *pp;
+    UINT32  total, done, frag;
+    UINT16  pb = L2CAP_PKT_START;
+
+    UINT16_TO_STREAM (p, len);
+    UINT16_TO_STREAM (p, cid);
+    if (p_data != p)
+        memmove(p, p_data, len);
+    total = L2CAP_PKT_OVERHEAD + len;
+
+    for (done = 0; done < total; done += frag)
+    {
+        frag = total - done;
+        if (frag > bench_ctrl_cb.cfg.acl_data_len)
+            frag = bench_ctrl_cb.cfg.acl_data_len;
+
+        pp = hdr;
+        UINT8_TO_STREAM (pp, BENCH_CTRL_H4_ACL);
+        UINT16_TO_STREAM (pp, p_conn->handle | (pb << L2CAP_PKT_TYPE_SHIFT));
+        UINT16_TO_STREAM (pp, frag);
+        bench_ctrl_out(hdr, sizeof(hdr));
+        bench_ctrl_out(bench_ctrl_cb.pdu + done, frag);
+
+        pb = L2CAP_PKT_CONTINUE;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_sig_tx
+**
+** Description      Sends an L2CAP signalling command of the peer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_sig_tx(tBENCH_CTRL_CONN *p_conn, UINT8 code, UINT8 id,
+                              const UINT8 *p_data, UINT16 len)
+{
+    UINT8   *p = bench_ctrl_cb.pdu + L2CAP_PKT_OVERHEAD;
+
+    memmove(p + L2CAP_CMD_OVERHEAD, p_data, len);
+    UINT8_TO_STREAM (p, code);
+    UINT8_TO_STREAM (p, id);
+    UINT16_TO_STREAM (p, len);
+
+    bench_ctrl_l2cap_tx(p_conn, L2CAP_SIGNALLING_CID, bench_ctrl_cb.pdu + L2CAP_PKT_OVERHEAD,
+                        (UINT16)(L2CAP_CMD_OVERHEAD + len));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_rfc_tx
+**
+** Description      Sends an RFCOMM frame of the peer. UIH frames on a data
+**                  DLC carry credits when credits is not negative.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_rfc_tx(tBENCH_CTRL_CONN *p_conn, UINT8 dlci, BOOLEAN is_cmd,
+                              UINT8 type, int credits, const UINT8 *p_data, UINT16 len)
+{
+    UINT8   frame[RFCOMM_DATA_OVERHEAD + 1];
+    UINT8   *p = bench_ctrl_cb.pdu + L2CAP_PKT_OVERHEAD;
+    UINT8   *p_start = p;
+    UINT8   fcs = 0xFF;
+    UINT8   *pp;
+    UINT8   pf = (credits >= 0) ? 1 : 0;
+    int     fcs_len;
+
+    /* the peer is the responder */
+    pp = frame;
+    RFCOMM_FORMAT_CTRL_FIELD(pp, RFCOMM_EA, RFCOMM_CR(FALSE, is_cmd), dlci);
+    *pp++ = (UINT8)(type | ((type == RFCOMM_UIH) ? (pf << RFCOMM_PF_OFFSET) : RFCOMM_PF));
+    if (len <= 127)
+    {
+        *pp++ = (UINT8)((len << RFCOMM_SHIFT_LENGTH1) | RFCOMM_EA);
+    }
+    else
+    {
+        *pp++ = (UINT8)(len << RFCOMM_SHIFT_LENGTH1);
+        *pp++ = (UINT8)(len >> RFCOMM_SHIFT_LENGTH2);
+    }
+
+    fcs_len = (type == RFCOMM_UIH) ? 2 : (int)(pp - frame);
+    for (p = frame; p < frame + fcs_len; p++)
+        fcs = bench_ctrl_cb.rfc_crc[fcs ^ *p];
+
+    if (pf && (type == RFCOMM_UIH))
+        *pp++ = (UINT8)credits;
+
+    p = p_start;
+    memmove(p + (pp - frame), p_data, len);
+    memcpy(p, frame, pp - frame);
+    p += (pp - frame) + len;
+    *p++ = (UINT8)(0xFF - fcs);
+
+    bench_ctrl_l2cap_tx(p_conn, p_conn->rfc_host_cid, p_start, (UINT16)(p - p_start));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_rfc_mx_tx
+**
+** Description      Sends a multiplexer control message on DLCI 0.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_rfc_mx_tx(tBENCH_CTRL_CONN *p_conn, UINT8 type, BOOLEAN is_cmd,
+                                 const UINT8 *p_data, UINT8 len)
+{
+    UINT8   msg[2 + 127];
+
+    msg[0] = (UINT8)(type | RFCOMM_I_CR(is_cmd) | RFCOMM_EA);
+    msg[1] = (UINT8)((len << RFCOMM_SHIFT_LENGTH1) | RFCOMM_EA);
+    memcpy(&msg[2], p_data, len);
+
+    bench_ctrl_rfc_tx(p_conn, RFCOMM_MX_DLCI, TRUE, RFCOMM_UIH, -1, msg, (UINT16)(2 + len));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_find_dlc
+**
+** Description      Finds a DLC, optionally allocating it.
+**
+** Returns          the DLC, NULL if not found
+**
+*******************************************************************************/
+static tBENCH_CTRL_DLC *bench_ctrl_find_dlc(tBENCH_CTRL_CONN *p_conn, UINT8 dlci, BOOLEAN alloc)
+{
+    tBENCH_CTRL_DLC *p_free = NULL;
+    int             xx;
+
+    for (xx = 0; xx < BENCH_CTRL_MAX_DLCS; xx++)
+    {
+        if (p_conn->dlc[xx].in_use)
+        {
+            if (p_conn->dlc[xx].dlci == dlci)
+                return &p_conn->dlc[xx];
+        }
+        else if (p_free == NULL)
+            p_free = &p_conn->dlc[xx];
+    }
+
+    if (alloc && p_free)
+    {
+        p_free->in_use = TRUE;
+        p_free->dlci = dlci;
+        return p_free;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_rfc_send_pending
+**
+** Description      Echoes the frames of a DLC the host has credits for, and
+**                  returns the credits of the frames consumed.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_rfc_send_pending(tBENCH_CTRL_CONN *p_conn, tBENCH_CTRL_DLC *p_dlc)
+{
+    tBENCH_CTRL_FRAME   *p_frame;
+
+    while (p_dlc->pend_count && p_dlc->tx_credits)
+    {
+        p_frame = &p_dlc->pend[p_dlc->pend_first];
+        bench_ctrl_rfc_tx(p_conn, p_dlc->dlci, TRUE, RFCOMM_UIH,
+                          p_dlc->credits_owed ? p_dlc->credits_owed : -1,
+                          p_frame->p_data, p_frame->len);
+        free(p_frame->p_data);
+
+        p_dlc->credits_owed = 0;
+        p_dlc->tx_credits--;
+        p_dlc->pend_first = (p_dlc->pend_first + 1) % BENCH_CTRL_MAX_PENDING;
+        p_dlc->pend_count--;
+    }
+
+    if (p_dlc->credits_owed)
+    {
+        bench_ctrl_rfc_tx(p_conn, p_dlc->dlci, TRUE, RFCOMM_UIH, p_dlc->credits_owed, NULL, 0);
+        p_dlc->credits_owed = 0;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_rfc_mx_rx
+**
+** Description      Handles a multiplexer control message from the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_rfc_mx_rx(tBENCH_CTRL_CONN *p_conn, UINT8 *p, UINT16 len)
+{
+    tBENCH_CTRL_DLC *p_dlc;
+    UINT8           type, is_cmd, mx_len;
+    UINT8           rsp[RFCOMM_MX_RPN_LEN];
+
+    if (len < 2)
+        return;
+    type   = p[0] & ~(RFCOMM_CR_MASK | RFCOMM_EA_MASK);
+    is_cmd = (p[0] & RFCOMM_CR_MASK) != 0;
+    mx_len = p[1] >> RFCOMM_SHIFT_LENGTH1;
+    p += 2;
+    if ((mx_len + 2 > len) || !is_cmd)
+        return;
+
+    switch (type)
+    {
+        case RFCOMM_MX_PN:
+            if ((mx_len < RFCOMM_MX_PN_LEN) ||
+                ((p_dlc = bench_ctrl_find_dlc(p_conn, p[0] & RFCOMM_PN_DLCI_MASK, TRUE)) == NULL))
+                return;
+            p_dlc->tx_credits = p[7] & RFCOMM_PN_K_MASK;
+
+            memcpy(rsp, p, RFCOMM_MX_PN_LEN);
+            rsp[1] = ((p[1] & RFCOMM_PN_CONV_LAYER_MASK) == RFCOMM_PN_CONV_LAYER_CBFC_I) ?
+                     RFCOMM_PN_CONV_LAYER_CBFC_R : RFCOMM_PN_FRAM_TYPE_UIH;
+            rsp[3] = RFCOMM_T1_DSEC;
+            rsp[6] = RFCOMM_N2;
+            rsp[7] = BENCH_CTRL_RFC_CREDITS;
+            bench_ctrl_rfc_mx_tx(p_conn, RFCOMM_MX_PN, FALSE, rsp, RFCOMM_MX_PN_LEN);
+            break;
+
+        case RFCOMM_MX_RPN:
+            if (mx_len == RFCOMM_MX_RPN_REQ_LEN)
+            {
+                /* 115200 8N1, no flow control */
+                memset(rsp, 0, sizeof(rsp));
+                rsp[0] = p[0];
+                rsp[1] = RFCOMM_BAUD_RATE_115200;
+                rsp[2] = RFCOMM_8_BITS;
+                rsp[4] = 0x11;
+                rsp[5] = 0x13;
+                bench_ctrl_rfc_mx_tx(p_conn, type, FALSE, rsp, RFCOMM_MX_RPN_LEN);
+                break;
+            }
+            /* fall through, accept the settings */
+
+        case RFCOMM_MX_MSC:
+        case RFCOMM_MX_RLS:
+        case RFCOMM_MX_TEST:
+        case RFCOMM_MX_FCON:
+        case RFCOMM_MX_FCOFF:
+            bench_ctrl_rfc_mx_tx(p_conn, type, FALSE, p, mx_len);
+            break;
+
+        default:
+            rsp[0] = (UINT8)(type | RFCOMM_I_CR(TRUE) | RFCOMM_EA);
+            bench_ctrl_rfc_mx_tx(p_conn, RFCOMM_MX_NSC, FALSE, rsp, RFCOMM_MX_NSC_LEN);
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_rfc_rx
+**
+** Description      Handles an RFCOMM frame from the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_rfc_rx(tBENCH_CTRL_CONN *p_conn, UINT8 *p, UINT16 len)
+{
+    tBENCH_CTRL_DLC     *p_dlc;
+    tBENCH_CTRL_FRAME   *p_frame;
+    UINT8               *p_end = p + len;
+    UINT8               ea, cr, dlci, type, pf;
+    UINT16              info_len;
+    UINT8               msc[RFCOMM_MX_MSC_LEN_NO_BREAK];
+
+    if (len < RFCOMM_CTRL_FRAME_LEN + 1)
+        return;
+
+    RFCOMM_PARSE_CTRL_FIELD(ea, cr, dlci, p);
+    RFCOMM_PARSE_TYPE_FIELD(type, pf, p);
+    RFCOMM_PARSE_LEN_FIELD(ea, info_len, p);
+
+    switch (type)
+    {
+        case RFCOMM_SABME:
+            bench_ctrl_rfc_tx(p_conn, dlci, FALSE, RFCOMM_UA, -1, NULL, 0);
+            if ((dlci != RFCOMM_MX_DLCI) && (bench_ctrl_find_dlc(p_conn, dlci, TRUE) != NULL))
+            {
+                msc[0] = (UINT8)((dlci << RFCOMM_SHIFT_DLCI) | RFCOMM_CR_MASK | RFCOMM_EA);
+                msc[1] = BENCH_CTRL_RFC_SIGNALS;
+                bench_ctrl_rfc_mx_tx(p_conn, RFCOMM_MX_MSC, TRUE, msc, sizeof(msc));
+            }
+            break;
+
+        case RFCOMM_DISC:
+            bench_ctrl_rfc_tx(p_conn, dlci, FALSE, RFCOMM_UA, -1, NULL, 0);
+            if ((p_dlc = bench_ctrl_find_dlc(p_conn, dlci, FALSE)) != NULL)
+                bench_ctrl_free_dlc(p_dlc);
+            break;
+
+        case RFCOMM_UIH:
+            if (dlci == RFCOMM_MX_DLCI)
+            {
+                if (p + info_len < p_end)
+                    bench_ctrl_rfc_mx_rx(p_conn, p, info_len);
+                break;
+            }
+            if ((p_dlc = bench_ctrl_find_dlc(p_conn, dlci, FALSE)) == NULL)
+                break;
+            if (pf)
+                p_dlc->tx_credits += *p++;
+            if ((info_len > 0) && (p + info_len < p_end))
+            {
+                if (p_dlc->pend_count == BENCH_CTRL_MAX_PENDING)
+                    break;
+                p_frame = &p_dlc->pend[(p_dlc->pend_first + p_dlc->pend_count) % BENCH_CTRL_MAX_PENDING];
+                if ((p_frame->p_data = (UINT8 *)malloc(info_len)) == NULL)
+                    break;
+                memcpy(p_frame->p_data, p, info_len);
+                p_frame->len = info_len;
+                p_dlc->pend_count++;
+                p_dlc->credits_owed++;
+            }
+            bench_ctrl_rfc_send_pending(p_conn, p_dlc);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_sig_rx
+**
+** Description      Handles L2CAP signalling from the host. The peer accepts
+**                  every connection, configures its side with the configured
+**                  MTU and accepts any configuration of the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_sig_rx(tBENCH_CTRL_CONN *p_conn, UINT8 *p, UINT16 len)
+{
+    tBENCH_CTRL_CHAN    *p_chan;
+    UINT8               *p_next;
+    UINT8               code, id;
+    UINT16              cmd_len, psm, scid, dcid, info_type;
+    UINT8               rsp[16];
+    UINT8               *pp;
+    int                 xx;
+
+    while (len >= L2CAP_CMD_OVERHEAD)
+    {
+        STREAM_TO_UINT8 (code, p);
+        STREAM_TO_UINT8 (id, p);
+        STREAM_TO_UINT16 (cmd_len, p);
+        len -= L2CAP_CMD_OVERHEAD;
+        if (cmd_len > len)
+            return;
+        p_next = p + cmd_len;
+        len -= cmd_len;
+
+        pp = rsp;
+        switch (code)
+        {
+            case L2CAP_CMD_CONN_REQ:
+                STREAM_TO_UINT16 (psm, p);
+                STREAM_TO_UINT16 (scid, p);
+                for (xx = 0, p_chan = p_conn->chan; xx < BENCH_CTRL_MAX_CHANS; xx++, p_chan++)
+                {
+                    if (!p_chan->in_use)
+                        break;
+                }
+                UINT16_TO_STREAM (pp, (xx < BENCH_CTRL_MAX_CHANS) ? p_conn->next_cid : 0);
+                UINT16_TO_STREAM (pp, scid);
+                UINT16_TO_STREAM (pp, (xx < BENCH_CTRL_MAX_CHANS) ? L2CAP_CONN_OK : L2CAP_CONN_NO_RESOURCES);
+                UINT16_TO_STREAM (pp, 0);
+                bench_ctrl_sig_tx(p_conn, L2CAP_CMD_CONN_RSP, id, rsp, L2CAP_CONN_RSP_LEN);
+                if (xx == BENCH_CTRL_MAX_CHANS)
+                    break;
+
+                p_chan->in_use = TRUE;
+                p_chan->psm = psm;
+                p_chan->host_cid = scid;
+                p_chan->peer_cid = p_conn->next_cid++;
+                if (psm == BT_PSM_RFCOMM)
+                    p_conn->rfc_host_cid = scid;
+
+                pp = rsp;
+                UINT16_TO_STREAM (pp, scid);
+                UINT16_TO_STREAM (pp, 0);
+                UINT8_TO_STREAM (pp, L2CAP_CFG_TYPE_MTU);
+                UINT8_TO_STREAM (pp, L2CAP_CFG_MTU_OPTION_LEN);
+                UINT16_TO_STREAM (pp, bench_ctrl_cb.cfg.peer_mtu);
+                bench_ctrl_sig_tx(p_conn, L2CAP_CMD_CONFIG_REQ, ++p_conn->sig_id, rsp,
+                                  (UINT16)(pp - rsp));
+                break;
+
+            case L2CAP_CMD_CONFIG_REQ:
+                STREAM_TO_UINT16 (dcid, p);
+                for (xx = 0, p_chan = p_conn->chan; xx < BENCH_CTRL_MAX_CHANS; xx++, p_chan++)
+                {
+                    if (p_chan->in_use && (p_chan->peer_cid == dcid))
+                        break;
+                }
+                if (xx == BENCH_CTRL_MAX_CHANS)
+                    break;
+                UINT16_TO_STREAM (pp, p_chan->host_cid);
+                UINT16_TO_STREAM (pp, 0);
+                UINT16_TO_STREAM (pp, L2CAP_CFG_OK);
+                bench_ctrl_sig_tx(p_conn, L2CAP_CMD_CONFIG_RSP, id, rsp, L2CAP_CONFIG_RSP_LEN);
+                break;
+
+            case L2CAP_CMD_DISC_REQ:
+                STREAM_TO_UINT16 (dcid, p);
+                STREAM_TO_UINT16 (scid, p);
+                UINT16_TO_STREAM (pp, dcid);
+                UINT16_TO_STREAM (pp, scid);
+                bench_ctrl_sig_tx(p_conn, L2CAP_CMD_DISC_RSP, id, rsp, L2CAP_DISC_RSP_LEN);
+                for (xx = 0, p_chan = p_conn->chan; xx < BENCH_CTRL_MAX_CHANS; xx++, p_chan++)
+                {
+                    if (p_chan->in_use && (p_chan->peer_cid == dcid))
+                    {
+                        if (p_chan->psm == BT_PSM_RFCOMM)
+                            p_conn->rfc_host_cid = 0;
+                        memset(p_chan, 0, sizeof(*p_chan));
+                    }
+                }
+                break;
+
+            case L2CAP_CMD_ECHO_REQ:
+                bench_ctrl_sig_tx(p_conn, L2CAP_CMD_ECHO_RSP, id, p, cmd_len);
+                break;
+
+            case L2CAP_CMD_INFO_REQ:
+                STREAM_TO_UINT16 (info_type, p);
+                UINT16_TO_STREAM (pp, info_type);
+                if (info_type == L2CAP_EXTENDED_FEATURES_INFO_TYPE)
+                {
+                    /* basic mode only */
+                    UINT16_TO_STREAM (pp, L2CAP_INFO_RESP_RESULT_SUCCESS);
+                    UINT32_TO_STREAM (pp, 0);
+                }
+                else if (info_type == L2CAP_CONNLESS_MTU_INFO_TYPE)
+                {
+                    UINT16_TO_STREAM (pp, L2CAP_INFO_RESP_RESULT_SUCCESS);
+                    UINT16_TO_STREAM (pp, L2CAP_DEFAULT_MTU);
+                }
+                else
+                {
+                    UINT16_TO_STREAM (pp, L2CAP_INFO_RESP_RESULT_NOT_SUPPORTED);
+                }
+                bench_ctrl_sig_tx(p_conn, L2CAP_CMD_INFO_RSP, id, rsp, (UINT16)(pp - rsp));
+                break;
+
+            default:
+                /* responses to the peer's own requests */
+                break;
+        }
+
+        p = p_next;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_l2cap_rx
+**
+** Description      Handles a complete L2CAP PDU from the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_l2cap_rx(tBENCH_CTRL_CONN *p_conn, UINT8 *p, UINT32 len)
+{
+    tBENCH_CTRL_CHAN    *p_chan;
+    UINT16              l2cap_len, cid;
+    int                 xx;
+
+    STREAM_TO_UINT16 (l2cap_len, p);
+    STREAM_TO_UINT16 (cid, p);
+    if (l2cap_len + L2CAP_PKT_OVERHEAD != len)
+        return;
+
+    if (cid == L2CAP_SIGNALLING_CID)
+    {
+        bench_ctrl_sig_rx(p_conn, p, l2cap_len);
+        return;
+    }
+
+    for (xx = 0, p_chan = p_conn->chan; xx < BENCH_CTRL_MAX_CHANS; xx++, p_chan++)
+    {
+        if (p_chan->in_use && (p_chan->peer_cid == cid))
+            break;
+    }
+    if (xx == BENCH_CTRL_MAX_CHANS)
+        return;
+
+    switch (p_chan->psm)
+    {
+        case BENCH_PSM_ECHO:
+            bench_ctrl_l2cap_tx(p_conn, p_chan->host_cid, p, l2cap_len);
+            break;
+
+        case BT_PSM_RFCOMM:
+            bench_ctrl_rfc_rx(p_conn, p, l2cap_len);
+            break;
+
+        default:
+            if (bench_ctrl_cb.p_sink_cb)
+                (*bench_ctrl_cb.p_sink_cb)(p_chan->psm, p, l2cap_len);
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_acl_rx
+**
+** Description      Handles an ACL packet from the host. The packet counts as
+**                  sent to the peer, and is completed at the end of the read.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_acl_rx(UINT8 *p, UINT16 len)
+{
+    tBENCH_CTRL_CONN    *p_conn;
+    UINT8               *p_data = p + HCI_DATA_PREAMBLE_SIZE;
+    UINT16              handle, pb, l2cap_len;
+
+    STREAM_TO_UINT16 (handle, p);
+    pb = (handle >> L2CAP_PKT_TYPE_SHIFT) & L2CAP_PKT_TYPE_MASK;
+    len -= HCI_DATA_PREAMBLE_SIZE;
+
+    if ((p_conn = bench_ctrl_find_conn(handle & HCI_DATA_HANDLE_MASK)) == NULL)
+        return;
+    p_conn->num_completed++;
+
+    if (pb != L2CAP_PKT_CONTINUE)
+    {
+        if (len < L2CAP_PKT_OVERHEAD)
+            return;
+        l2cap_len = p_data[0] | (p_data[1] << 8);
+        if (len == L2CAP_PKT_OVERHEAD + l2cap_len)
+        {
+            bench_ctrl_l2cap_rx(p_conn, p_data, len);
+            return;
+        }
+        p_conn->rx_expected = L2CAP_PKT_OVERHEAD + l2cap_len;
+        p_conn->rx_len = 0;
+    }
+    else if (p_conn->rx_expected == 0)
+        return;
+
+    if (p_conn->p_rx == NULL)
+        p_conn->p_rx = (UINT8 *)malloc(BENCH_CTRL_MAX_PDU);
+    if ((p_conn->p_rx == NULL) || (p_conn->rx_len + len > p_conn->rx_expected))
+    {
+        p_conn->rx_expected = 0;
+        return;
+    }
+
+    memcpy(p_conn->p_rx + p_conn->rx_len, p_data, len);
+    p_conn->rx_len += len;
+    if (p_conn->rx_len == p_conn->rx_expected)
+    {
+        p_conn->rx_expected = 0;
+        bench_ctrl_l2cap_rx(p_conn, p_conn->p_rx, p_conn->rx_len);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_num_completed
+**
+** Description      Reports the ACL packets completed since the last report.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_num_completed(void)
+{
+    UINT8   evt[1 + 4 * BENCH_CTRL_MAX_CONNS];
+    UINT8   *p = evt + 1;
+    int     xx;
+
+    evt[0] = 0;
+    for (xx = 0; xx < BENCH_CTRL_MAX_CONNS; xx++)
+    {
+        if (bench_ctrl_cb.conn[xx].in_use && bench_ctrl_cb.conn[xx].num_completed)
+        {
+            UINT16_TO_STREAM (p, bench_ctrl_cb.conn[xx].handle);
+            UINT16_TO_STREAM (p, bench_ctrl_cb.conn[xx].num_completed);
+            bench_ctrl_cb.conn[xx].num_completed = 0;
+            evt[0]++;
+        }
+    }
+
+    if (evt[0])
+        bench_ctrl_evt(HCI_NUM_COMPL_DATA_PKTS_EVT, evt, (UINT8)(p - evt));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_create_conn
+**
+** Description      Pages a peer: every address answers and gets a link.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_create_conn(UINT8 *p)
+{
+    tBENCH_CTRL_CONN    *p_conn = NULL;
+    UINT8               evt[11];
+    UINT8               *pp = evt;
+    int                 xx;
+
+    for (xx = 0; xx < BENCH_CTRL_MAX_CONNS; xx++)
+    {
+        if (!bench_ctrl_cb.conn[xx].in_use)
+        {
+            p_conn = &bench_ctrl_cb.conn[xx];
+            break;
+        }
+    }
+
+    if (p_conn == NULL)
+    {
+        UINT8_TO_STREAM (pp, HCI_ERR_MAX_NUM_OF_CONNECTIONS);
+        UINT16_TO_STREAM (pp, 0);
+        memcpy(pp, p, BD_ADDR_LEN);
+        pp += BD_ADDR_LEN;
+    }
+    else
+    {
+        p_conn->in_use = TRUE;
+        p_conn->handle = bench_ctrl_cb.next_handle++;
+        p_conn->next_cid = BENCH_CTRL_FIRST_CID;
+        STREAM_TO_BDADDR (p_conn->bd_addr, p);
+
+        UINT8_TO_STREAM (pp, HCI_SUCCESS);
+        UINT16_TO_STREAM (pp, p_conn->handle);
+        BDADDR_TO_STREAM (pp, p_conn->bd_addr);
+    }
+    UINT8_TO_STREAM (pp, HCI_LINK_TYPE_ACL);
+    UINT8_TO_STREAM (pp, HCI_ENCRYPT_MODE_DISABLED);
+
+    bench_ctrl_evt(HCI_CONNECTION_COMP_EVT, evt, sizeof(evt));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_link_evt
+**
+** Description      Queues the completion event of a link command. The event
+**                  starts with the status and the handle of the command.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_link_evt(UINT8 code, UINT16 handle, const UINT8 *p_data, UINT8 len)
+{
+    UINT8   evt[3 + 248];
+    UINT8   *p = evt;
+
+    UINT8_TO_STREAM (p, HCI_SUCCESS);
+    UINT16_TO_STREAM (p, handle);
+    memcpy(p, p_data, len);
+
+    bench_ctrl_evt(code, evt, (UINT8)(3 + len));
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_cmd_rx
+**
+** Description      Handles an HCI command from the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_ctrl_cmd_rx(UINT8 *p, UINT8 len)
+{
+    tBENCH_CTRL_CONN    *p_conn;
+    UINT16              opcode, handle = 0;
+    UINT8               ret[255];
+    UINT8               *pp = ret;
+    UINT8               evt[255];
+    UINT8               *pe = evt;
+    UINT8               mode;
+    UINT32              xx;
+    BD_ADDR             bda;
+    UINT16              idx;
+
+    STREAM_TO_UINT16 (opcode, p);
+    p++;
+    len -= HCIC_PREAMBLE_SIZE;
+    if (len >= 2)
+        handle = (p[0] | (p[1] << 8)) & HCI_DATA_HANDLE_MASK;
+
+    memset(ret, 0, sizeof(ret));
+    memset(evt, 0, sizeof(evt));
+
+    switch (opcode)
+    {
+        case HCI_RESET:
+            for (xx = 0; xx < BENCH_CTRL_MAX_CONNS; xx++)
+            {
+                if (bench_ctrl_cb.conn[xx].in_use)
+                    bench_ctrl_free_conn(&bench_ctrl_cb.conn[xx]);
+            }
+            bench_ctrl_cmd_cmpl(opcode, ret, 0);
+            break;
+
+        case HCI_READ_LOCAL_VERSION_INFO:
+            UINT8_TO_STREAM (pp, HCI_PROTO_VERSION_2_0);
+            UINT16_TO_STREAM (pp, 0);
+            UINT8_TO_STREAM (pp, HCI_PROTO_VERSION_2_0);
+            UINT16_TO_STREAM (pp, LMP_COMPID_BROADCOM);
+            UINT16_TO_STREAM (pp, 0);
+            bench_ctrl_cmd_cmpl(opcode, ret, (UINT8)(pp - ret));
+            break;
+
+        case HCI_READ_LOCAL_FEATURES:
+            /* 3 and 5 slot packets, nothing optional */
+            ret[0] = 0x03;
+            bench_ctrl_cmd_cmpl(opcode, ret, HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_LOCAL_EXT_FEATURES:
+            ret[0] = p[0];
+            bench_ctrl_cmd_cmpl(opcode, ret, 2 + HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_BUFFER_SIZE:
+            UINT16_TO_STREAM (pp, bench_ctrl_cb.cfg.acl_data_len);
+            UINT8_TO_STREAM (pp, 0);
+            UINT16_TO_STREAM (pp, bench_ctrl_cb.cfg.acl_num_bufs);
+            UINT16_TO_STREAM (pp, 0);
+            bench_ctrl_cmd_cmpl(opcode, ret, (UINT8)(pp - ret));
+            break;
+
+        case HCI_READ_BD_ADDR:
+            BDADDR_TO_STREAM (pp, bench_ctrl_cb.cfg.local_addr);
+            bench_ctrl_cmd_cmpl(opcode, ret, BD_ADDR_LEN);
+            break;
+
+        case HCI_READ_LOCAL_NAME:
+            strcpy((char *)ret, BENCH_CTRL_NAME);
+            bench_ctrl_cmd_cmpl(opcode, ret, BD_NAME_LEN);
+            break;
+
+        case HCI_INQUIRY:
+            /* every device around answers once, one result per event */
+            bench_ctrl_cmd_status(opcode);
+            for (idx = 1; idx <= bench_ctrl_cb.num_inq_peers; idx++)
+            {
+                pe = evt;
+                UINT8_TO_STREAM (pe, 1);
+                BENCH_INQ_ADDR(bda, idx);
+                BDADDR_TO_STREAM (pe, bda);
+                UINT8_TO_STREAM (pe, HCI_PAGE_SCAN_REP_MODE_R1);
+                UINT8_TO_STREAM (pe, 0);
+                UINT8_TO_STREAM (pe, 0);
+                DEVCLASS_TO_STREAM (pe, bench_ctrl_inq_cod);
+                UINT16_TO_STREAM (pe, 0);
+                bench_ctrl_evt(HCI_INQUIRY_RESULT_EVT, evt, (UINT8)(pe - evt));
+            }
+            pe = evt;
+            UINT8_TO_STREAM (pe, HCI_SUCCESS);
+            bench_ctrl_evt(HCI_INQUIRY_COMP_EVT, evt, 1);
+            break;
+
+        case HCI_CREATE_CONNECTION:
+            bench_ctrl_cmd_status(opcode);
+            bench_ctrl_create_conn(p);
+            break;
+
+        case HCI_DISCONNECT:
+            bench_ctrl_cmd_status(opcode);
+            if ((p_conn = bench_ctrl_find_conn(handle)) != NULL)
+            {
+                bench_ctrl_free_conn(p_conn);
+                UINT8_TO_STREAM (pe, HCI_ERR_CONN_CAUSE_LOCAL_HOST);
+                bench_ctrl_link_evt(HCI_DISCONNECTION_COMP_EVT, handle, evt, 1);
+            }
+            break;
+
+        case HCI_READ_RMT_FEATURES:
+            bench_ctrl_cmd_status(opcode);
+            evt[0] = 0x03;
+            bench_ctrl_link_evt(HCI_READ_RMT_FEATURES_COMP_EVT, handle, evt, HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_RMT_EXT_FEATURES:
+            bench_ctrl_cmd_status(opcode);
+            evt[0] = p[2];
+            bench_ctrl_link_evt(HCI_READ_RMT_EXT_FEATURES_COMP_EVT, handle, evt, 2 + HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_RMT_VERSION_INFO:
+            bench_ctrl_cmd_status(opcode);
+            UINT8_TO_STREAM (pe, HCI_PROTO_VERSION_2_0);
+            UINT16_TO_STREAM (pe, LMP_COMPID_BROADCOM);
+            UINT16_TO_STREAM (pe, 0);
+            bench_ctrl_link_evt(HCI_READ_RMT_VERSION_COMP_EVT, handle, evt, (UINT8)(pe - evt));
+            break;
+
+        case HCI_READ_RMT_CLOCK_OFFSET:
+            bench_ctrl_cmd_status(opcode);
+            bench_ctrl_link_evt(HCI_READ_CLOCK_OFF_COMP_EVT, handle, evt, 2);
+            break;
+
+        case HCI_RMT_NAME_REQUEST:
+            bench_ctrl_cmd_status(opcode);
+            UINT8_TO_STREAM (pe, HCI_SUCCESS);
+            memcpy(pe, p, BD_ADDR_LEN);
+            strcpy((char *)pe + BD_ADDR_LEN, BENCH_CTRL_PEER_NAME);
+            bench_ctrl_evt(HCI_RMT_NAME_REQUEST_COMP_EVT, evt, 1 + BD_ADDR_LEN + BD_NAME_LEN);
+            break;
+
+        case HCI_CHANGE_CONN_PACKET_TYPE:
+            bench_ctrl_cmd_status(opcode);
+            bench_ctrl_link_evt(HCI_CONN_PKT_TYPE_CHANGE_EVT, handle, p + 2, 2);
+            break;
+
+        case HCI_AUTHENTICATION_REQUESTED:
+            bench_ctrl_cmd_status(opcode);
+            bench_ctrl_link_evt(HCI_AUTHENTICATION_COMP_EVT, handle, evt, 0);
+            break;
+
+        case HCI_SET_CONN_ENCRYPTION:
+            bench_ctrl_cmd_status(opcode);
+            bench_ctrl_link_evt(HCI_ENCRYPTION_CHANGE_EVT, handle, p + 2, 1);
+            break;
+
+        case HCI_SNIFF_MODE:
+        case HCI_EXIT_SNIFF_MODE:
+        case HCI_HOLD_MODE:
+        case HCI_PARK_MODE:
+        case HCI_EXIT_PARK_MODE:
+            bench_ctrl_cmd_status(opcode);
+            if (opcode == HCI_SNIFF_MODE)
+                mode = HCI_MODE_SNIFF;
+            else if (opcode == HCI_HOLD_MODE)
+                mode = HCI_MODE_HOLD;
+            else if (opcode == HCI_PARK_MODE)
+                mode = HCI_MODE_PARK;
+            else
+                mode = HCI_MODE_ACTIVE;
+            UINT8_TO_STREAM (pe, mode);
+            UINT16_TO_STREAM (pe, 0);
+            bench_ctrl_link_evt(HCI_MODE_CHANGE_EVT, handle, evt, (UINT8)(pe - evt));
+            break;
+
+        case HCI_SWITCH_ROLE:
+            bench_ctrl_cmd_status(opcode);
+            UINT8_TO_STREAM (pe, HCI_SUCCESS);
+            memcpy(pe, p, BD_ADDR_LEN + 1);
+            bench_ctrl_evt(HCI_ROLE_CHANGE_EVT, evt, 1 + BD_ADDR_LEN + 1);
+            break;
+
+        case HCI_QOS_SETUP:
+            bench_ctrl_cmd_status(opcode);
+            bench_ctrl_link_evt(HCI_QOS_SETUP_COMP_EVT, handle, p + 2, 18);
+            break;
+
+        default:
+            if (HCI_OGF(opcode) == (HCI_GRP_LINK_CONTROL_CMDS >> 10))
+            {
+                /* cancels and pairing replies return the address they were given */
+                bench_ctrl_cmd_cmpl(opcode, p, (len >= BD_ADDR_LEN) ? BD_ADDR_LEN : 0);
+                break;
+            }
+
+            for (xx = 0; xx < sizeof(bench_ctrl_cc_tbl) / sizeof(bench_ctrl_cc_tbl[0]); xx++)
+            {
+                if (bench_ctrl_cc_tbl[xx].opcode == opcode)
+                    break;
+            }
+            if (xx < sizeof(bench_ctrl_cc_tbl) / sizeof(bench_ctrl_cc_tbl[0]))
+            {
+                memcpy(ret, p, bench_ctrl_cc_tbl[xx].echo_len);
+                bench_ctrl_cmd_cmpl(opcode, ret,
+                                    bench_ctrl_cc_tbl[xx].echo_len + bench_ctrl_cc_tbl[xx].zero_len);
+            }
+            else
+                bench_ctrl_cmd_cmpl(opcode, ret, 0);
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_thread
+**
+** Description      Reads H4 packets from the host until the socket closes.
+**
+** Returns          NULL
+**
+*******************************************************************************/
+static void *bench_ctrl_thread(void *p_arg)
+{
+    UINT8       *p_buf = bench_ctrl_cb.rx_buf;
+    UINT8       *p;
+    UINT32      have = 0, used, pkt_len;
+    ssize_t     ret;
+
+    while (bench_ctrl_cb.running)
+    {
+        ret = read(bench_ctrl_cb.fd, p_buf + have, BENCH_CTRL_RX_BUF_SIZE - have);
+        if (ret <= 0)
+        {
+            if ((ret < 0) && (errno == EINTR))
+                continue;
+            break;
+        }
+        have += ret;
+
+        for (used = 0; used < have; used += 1 + pkt_len)
+        {
+            p = p_buf + used;
+
+            if (p[0] == BENCH_CTRL_H4_CMD)
+            {
+                if (have - used < 1 + HCIC_PREAMBLE_SIZE)
+                    break;
+                pkt_len = HCIC_PREAMBLE_SIZE + p[3];
+            }
+            else if (p[0] == BENCH_CTRL_H4_ACL)
+            {
+                if (have - used < 1 + HCI_DATA_PREAMBLE_SIZE)
+                    break;
+                pkt_len = HCI_DATA_PREAMBLE_SIZE + (p[3] | (p[4] << 8));
+            }
+            else
+            {
+                /* lost framing, nothing sensible left to do */
+                bench_ctrl_cb.running = FALSE;
+                break;
+            }
+            if (have - used < 1 + pkt_len)
+                break;
+
+            if (p[0] == BENCH_CTRL_H4_CMD)
+                bench_ctrl_cmd_rx(p + 1, (UINT8)pkt_len);
+            else
+                bench_ctrl_acl_rx(p + 1, (UINT16)pkt_len);
+        }
+
+        if (used < have)
+            memmove(p_buf, p_buf + used, have - used);
+        have -= used;
+
+        bench_ctrl_num_completed();
+        bench_ctrl_flush();
+    }
+
+    return p_arg;
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_start
+**
+** Description      Starts the simulated controller on fd.
+**
+** Returns          TRUE if the controller thread is running
+**
+*******************************************************************************/
+BOOLEAN bench_ctrl_start(int fd, const tBENCH_CTRL_CFG *p_cfg)
+{
+    UINT8   crc;
+    int     xx, k;
+
+    memset(&bench_ctrl_cb, 0, sizeof(bench_ctrl_cb));
+    bench_ctrl_cb.fd = fd;
+    bench_ctrl_cb.cfg = *p_cfg;
+    bench_ctrl_cb.next_handle = BENCH_CTRL_FIRST_HANDLE;
+    bench_ctrl_cb.running = TRUE;
+
+    /* RFCOMM FCS: reversed CRC-8, poly 0x07 */
+    for (xx = 0; xx < 256; xx++)
+    {
+        crc = (UINT8)xx;
+        for (k = 0; k < 8; k++)
+            crc = (crc & 1) ? (UINT8)((crc >> 1) ^ 0xE0) : (UINT8)(crc >> 1);
+        bench_ctrl_cb.rfc_crc[xx] = crc;
+    }
+
+    if (pthread_create(&bench_ctrl_cb.thread, NULL, bench_ctrl_thread, NULL) != 0)
+    {
+        bench_ctrl_cb.running = FALSE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_stop
+**
+** Description      Stops the controller thread and closes its socket.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_ctrl_stop(void)
+{
+    int xx;
+
+    if (bench_ctrl_cb.fd <= 0)
+        return;
+
+    bench_ctrl_cb.running = FALSE;
+    shutdown(bench_ctrl_cb.fd, SHUT_RDWR);
+    pthread_join(bench_ctrl_cb.thread, NULL);
+    close(bench_ctrl_cb.fd);
+    bench_ctrl_cb.fd = -1;
+
+    for (xx = 0; xx < BENCH_CTRL_MAX_CONNS; xx++)
+    {
+        if (bench_ctrl_cb.conn[xx].in_use)
+            bench_ctrl_free_conn(&bench_ctrl_cb.conn[xx]);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_set_inq_peers
+**
+** Description      Sets the number of devices that answer the next inquiries.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_ctrl_set_inq_peers(UINT16 num)
+{
+    bench_ctrl_cb.num_inq_peers = num;
+}
+
+/*******************************************************************************
+**
+** Function         bench_ctrl_set_sink
+**
+** Description      Sets the callback that sees the PDUs of sink channels.
+**                  Only change it while no data is flowing.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_ctrl_set_sink(tBENCH_SINK_CBACK *p_cb)
+{
+    bench_ctrl_cb.p_sink_cb = p_cb;
+}
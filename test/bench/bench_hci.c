@@ -0,0 +1,591 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      bench_hci.c
+ *
+ *  Description:   Host side of the btbench HCI transport
+ *
+ *                 Takes the place of bte_main.c and libbt-hci: the stack's
+ *                 HCI_xxx_TO_LOWER calls land in bte_main_hci_send(), which
+ *                 frames the packets as H4 on one end of a socketpair and
+ *                 splits ACL packets to the controller's ACL data length the
+ *                 way hci_h4.c does. A reader thread parses what the simulated
+ *                 controller writes on the socket, reassembles ACL packets to
+ *                 whole L2CAP PDUs and posts everything to the BTU task.
+ *
+ ******************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "btu.h"
+#include "btm_api.h"
+#include "hcidefs.h"
+#include "hcimsgs.h"
+#include "l2cdefs.h"
+#include "bta_sys.h"
+#include "bta_sys_ci.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BENCH_H4_TYPE_CMD       1
+#define BENCH_H4_TYPE_ACL       2
+#define BENCH_H4_TYPE_SCO       3
+#define BENCH_H4_TYPE_EVT       4
+
+/* ACL segments written with one writev() */
+#define BENCH_HCI_MAX_SEGS      8
+
+#define BENCH_HCI_RX_BUF_SIZE   0x10000
+
+/* Wait of the reader for a free GKI buffer */
+#define BENCH_HCI_RX_RETRY_US   100
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+/* An ACL packet being reassembled from its HCI fragments */
+typedef struct
+{
+    UINT16      handle;
+    UINT16      expected;           /* length of the whole HCI packet */
+    BT_HDR      *p_buf;
+} tBENCH_HCI_RX_ACL;
+
+typedef struct
+{
+    int                 fd;
+    pthread_t           rx_thread;
+    BOOLEAN             rx_running;
+    tBENCH_HCI_RX_ACL   rx_acl[MAX_L2CAP_LINKS];
+    UINT8               rx_buf[BENCH_HCI_RX_BUF_SIZE];
+} tBENCH_HCI_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBENCH_HCI_CB bench_hci_cb = { -1 };
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bench_hci_writev
+**
+** Description      Writes all of an iovec array to the socket.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_hci_writev(struct iovec *p_iov, int iovcnt)
+{
+    ssize_t     ret;
+
+    while (iovcnt > 0)
+    {
+        ret = writev(bench_hci_cb.fd, p_iov, iovcnt);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            BT_TRACE_1(TRACE_LAYER_HCI, TRACE_TYPE_ERROR, "bench hci write failed, errno %d", errno);
+            return;
+        }
+
+        while ((iovcnt > 0) && ((size_t)ret >= p_iov->iov_len))
+        {
+            ret -= p_iov->iov_len;
+            p_iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            p_iov->iov_base = (UINT8 *)p_iov->iov_base + ret;
+            p_iov->iov_len -= ret;
+        }
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_hci_send_segments
+**
+** Description      Sends all but the last segment of an ACL packet longer
+**                  than the controller's ACL data length, or the
+**                  layer_specific segments L2CAP asked for. p_msg is left
+**                  holding the rest as a continuation packet.
+**
+** Returns          TRUE if the rest was handed back to L2CAP
+**
+*******************************************************************************/
+static BOOLEAN bench_hci_send_segments(BT_HDR *p_msg, UINT16 acl_data_size)
+{
+    struct iovec    iov[2 * BENCH_HCI_MAX_SEGS];
+    UINT8           seg_hdr[BENCH_HCI_MAX_SEGS][1 + HCI_DATA_PREAMBLE_SIZE];
+    UINT8           *p = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    UINT8           *p_data;
+    UINT16          handle, cont_handle, remain;
+    int             num_segs;
+    BOOLEAN         partial = FALSE;
+
+    STREAM_TO_UINT16 (handle, p);
+    cont_handle = (handle & 0xCFFF) | (L2CAP_PKT_CONTINUE << L2CAP_PKT_TYPE_SHIFT);
+
+    p_data = p + 2;
+    remain = p_msg->len - HCI_DATA_PREAMBLE_SIZE;
+
+    while ((remain > acl_data_size) && !partial)
+    {
+        for (num_segs = 0; (num_segs < BENCH_HCI_MAX_SEGS) && (remain > acl_data_size); )
+        {
+            p = seg_hdr[num_segs];
+            *p++ = BENCH_H4_TYPE_ACL;
+            UINT16_TO_STREAM (p, handle);
+            UINT16_TO_STREAM (p, acl_data_size);
+
+            iov[2 * num_segs].iov_base     = seg_hdr[num_segs];
+            iov[2 * num_segs].iov_len      = 1 + HCI_DATA_PREAMBLE_SIZE;
+            iov[2 * num_segs + 1].iov_base = p_data;
+            iov[2 * num_segs + 1].iov_len  = acl_data_size;
+            num_segs++;
+
+            p_data += acl_data_size;
+            remain -= acl_data_size;
+            handle  = cont_handle;
+
+            if ((p_msg->layer_specific) && (--p_msg->layer_specific == 0))
+            {
+                partial = TRUE;
+                break;
+            }
+        }
+
+        bench_hci_writev(iov, 2 * num_segs);
+    }
+
+    /* what is left goes out as one continuation packet */
+    p = p_data - HCI_DATA_PREAMBLE_SIZE;
+    p_msg->offset = (UINT16)(p - (UINT8 *)(p_msg + 1));
+    p_msg->len    = remain + HCI_DATA_PREAMBLE_SIZE;
+
+    UINT16_TO_STREAM (p, cont_handle);
+    UINT16_TO_STREAM (p, (remain > acl_data_size) ? acl_data_size : remain);
+
+    if (partial)
+    {
+        p_msg->event = BT_EVT_TO_BTU_L2C_SEG_XMIT;
+        GKI_send_msg (BTU_TASK, BTU_HCI_RCV_MBOX, p_msg);
+    }
+
+    return partial;
+}
+
+/*******************************************************************************
+**
+** Function         bench_hci_to_btu
+**
+** Description      Posts a received HCI packet to the BTU task.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_hci_to_btu(BT_HDR *p_buf, UINT16 event)
+{
+    p_buf->event = event;
+    p_buf->layer_specific = 0;
+    GKI_send_msg (BTU_TASK, BTU_HCI_RCV_MBOX, p_buf);
+}
+
+/*******************************************************************************
+**
+** Function         bench_hci_getbuf
+**
+** Description      Gets a buffer for a packet from the controller. While the
+**                  pools are exhausted the reader stops, which holds the
+**                  controller back the way flow control would on a UART,
+**                  instead of dropping what it sent.
+**
+** Returns          the buffer, or NULL if the reader is stopping
+**
+*******************************************************************************/
+static BT_HDR *bench_hci_getbuf(UINT16 len)
+{
+    BT_HDR  *p_buf;
+
+    while ((p_buf = (BT_HDR *)GKI_getbuf(len)) == NULL)
+    {
+        if (!bench_hci_cb.rx_running)
+            break;
+        usleep(BENCH_HCI_RX_RETRY_US);
+    }
+    return p_buf;
+}
+
+/*******************************************************************************
+**
+** Function         bench_hci_rx_acl
+**
+** Description      Handles one received ACL fragment. Start fragments carry
+**                  the L2CAP length, which tells how much is to follow.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_hci_rx_acl(UINT8 *p_pkt, UINT16 len)
+{
+    tBENCH_HCI_RX_ACL   *p_rx = NULL, *p_free = NULL;
+    BT_HDR              *p_buf;
+    UINT8               *p = p_pkt;
+    UINT16              handle, pkt_type, l2cap_len, total;
+    int                 xx;
+
+    STREAM_TO_UINT16 (handle, p);
+    pkt_type = (handle >> L2CAP_PKT_TYPE_SHIFT) & L2CAP_PKT_TYPE_MASK;
+    handle   = HCID_GET_HANDLE (handle);
+
+    for (xx = 0; xx < MAX_L2CAP_LINKS; xx++)
+    {
+        if (bench_hci_cb.rx_acl[xx].p_buf == NULL)
+        {
+            if (p_free == NULL)
+                p_free = &bench_hci_cb.rx_acl[xx];
+        }
+        else if (bench_hci_cb.rx_acl[xx].handle == handle)
+            p_rx = &bench_hci_cb.rx_acl[xx];
+    }
+
+    if (pkt_type != L2CAP_PKT_CONTINUE)
+    {
+        if (p_rx != NULL)
+        {
+            BT_TRACE_1(TRACE_LAYER_HCI, TRACE_TYPE_WARNING, "bench hci: incomplete ACL on handle %d dropped", handle);
+            GKI_freebuf(p_rx->p_buf);
+            p_rx->p_buf = NULL;
+            p_free = p_rx;
+        }
+        if (len < HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD)
+            return;
+
+        p = p_pkt + HCI_DATA_PREAMBLE_SIZE;
+        STREAM_TO_UINT16 (l2cap_len, p);
+        total = HCI_DATA_PREAMBLE_SIZE + L2CAP_PKT_OVERHEAD + l2cap_len;
+
+        if ((p_buf = bench_hci_getbuf((UINT16)(sizeof(BT_HDR) + total))) == NULL)
+            return;
+        p_buf->offset = 0;
+        p_buf->len = len;
+        memcpy(p_buf + 1, p_pkt, len);
+
+        if (len >= total)
+        {
+            bench_hci_to_btu(p_buf, BT_EVT_TO_BTU_HCI_ACL);
+            return;
+        }
+        if (p_free == NULL)
+        {
+            GKI_freebuf(p_buf);
+            return;
+        }
+        p_free->handle = handle;
+        p_free->expected = total;
+        p_free->p_buf = p_buf;
+        return;
+    }
+
+    /* continuation */
+    if (p_rx == NULL)
+        return;
+    len -= HCI_DATA_PREAMBLE_SIZE;
+    if (p_rx->p_buf->len + len > p_rx->expected)
+    {
+        GKI_freebuf(p_rx->p_buf);
+        p_rx->p_buf = NULL;
+        return;
+    }
+    memcpy((UINT8 *)(p_rx->p_buf + 1) + p_rx->p_buf->len, p_pkt + HCI_DATA_PREAMBLE_SIZE, len);
+    p_rx->p_buf->len += len;
+
+    if (p_rx->p_buf->len == p_rx->expected)
+    {
+        /* the stack sees one packet with the length of the whole PDU */
+        p = (UINT8 *)(p_rx->p_buf + 1) + 2;
+        UINT16_TO_STREAM (p, p_rx->expected - HCI_DATA_PREAMBLE_SIZE);
+        bench_hci_to_btu(p_rx->p_buf, BT_EVT_TO_BTU_HCI_ACL);
+        p_rx->p_buf = NULL;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_hci_rx_thread
+**
+** Description      Reads H4 packets from the socket until it is shut down.
+**
+** Returns          NULL
+**
+*******************************************************************************/
+static void *bench_hci_rx_thread(void *p_arg)
+{
+    UINT8       *p_buf = bench_hci_cb.rx_buf;
+    UINT8       *p;
+    BT_HDR      *p_msg;
+    size_t      have = 0, used, pkt_len;
+    ssize_t     ret;
+
+    while (bench_hci_cb.rx_running)
+    {
+        ret = read(bench_hci_cb.fd, p_buf + have, BENCH_HCI_RX_BUF_SIZE - have);
+        if (ret <= 0)
+        {
+            if ((ret < 0) && (errno == EINTR))
+                continue;
+            break;
+        }
+        have += ret;
+
+        for (used = 0; used < have; used += 1 + pkt_len)
+        {
+            p = p_buf + used;
+
+            if (p[0] == BENCH_H4_TYPE_EVT)
+            {
+                if (have - used < 1 + HCIE_PREAMBLE_SIZE)
+                    break;
+                pkt_len = HCIE_PREAMBLE_SIZE + p[2];
+            }
+            else if (p[0] == BENCH_H4_TYPE_ACL)
+            {
+                if (have - used < 1 + HCI_DATA_PREAMBLE_SIZE)
+                    break;
+                pkt_len = HCI_DATA_PREAMBLE_SIZE + (p[3] | (p[4] << 8));
+            }
+            else
+            {
+                BT_TRACE_1(TRACE_LAYER_HCI, TRACE_TYPE_ERROR, "bench hci: bad packet type %d", p[0]);
+                bench_hci_cb.rx_running = FALSE;
+                break;
+            }
+            if (have - used < 1 + pkt_len)
+                break;
+
+            if (p[0] == BENCH_H4_TYPE_ACL)
+            {
+                bench_hci_rx_acl(p + 1, (UINT16)pkt_len);
+            }
+            else if ((p_msg = bench_hci_getbuf((UINT16)(sizeof(BT_HDR) + pkt_len))) != NULL)
+            {
+                p_msg->offset = 0;
+                p_msg->len = (UINT16)pkt_len;
+                memcpy(p_msg + 1, p + 1, pkt_len);
+                bench_hci_to_btu(p_msg, BT_EVT_TO_BTU_HCI_EVT | LOCAL_BR_EDR_CONTROLLER_ID);
+            }
+        }
+
+        if (used < have)
+            memmove(p_buf, p_buf + used, have - used);
+        have -= used;
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bench_hci_open
+**
+** Description      Creates the socketpair and starts the reader thread on the
+**                  host end.
+**
+** Returns          the controller end of the socketpair, -1 on failure
+**
+*******************************************************************************/
+int bench_hci_open(void)
+{
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return -1;
+
+    bench_hci_cb.fd = fds[0];
+    bench_hci_cb.rx_running = TRUE;
+
+    if (pthread_create(&bench_hci_cb.rx_thread, NULL, bench_hci_rx_thread, NULL) != 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        bench_hci_cb.fd = -1;
+        return -1;
+    }
+
+    return fds[1];
+}
+
+/*******************************************************************************
+**
+** Function         bench_hci_close
+**
+** Description      Shuts the host end of the socketpair down and waits for
+**                  the reader thread.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_hci_close(void)
+{
+    if (bench_hci_cb.fd < 0)
+        return;
+
+    bench_hci_cb.rx_running = FALSE;
+    shutdown(bench_hci_cb.fd, SHUT_RDWR);
+    pthread_join(bench_hci_cb.rx_thread, NULL);
+    close(bench_hci_cb.fd);
+    bench_hci_cb.fd = -1;
+}
+
+/******************************************************************************
+**
+** Function         bte_main_hci_send
+**
+** Description      BTE MAIN API - This function is called by the upper stack to
+**                  send an HCI message. In btbench the message goes out as
+**                  H4 on the socketpair to the simulated controller.
+**
+** Returns          None
+**
+******************************************************************************/
+void bte_main_hci_send (BT_HDR *p_msg, UINT16 event)
+{
+    struct iovec    iov[2];
+    UINT8           type;
+    UINT16          sub_event = event & BT_SUB_EVT_MASK;
+    UINT16          acl_data_size = btu_cb.hcit_acl_data_size;
+
+    p_msg->event = event;
+
+#if (BLE_INCLUDED == TRUE)
+    if (sub_event == LOCAL_BLE_CONTROLLER_ID)
+        acl_data_size = btu_cb.hcit_ble_acl_data_size;
+    else
+#endif
+    if (sub_event != LOCAL_BR_EDR_CONTROLLER_ID)
+    {
+        GKI_freebuf(p_msg);
+        return;
+    }
+
+    switch (event & BT_EVT_MASK)
+    {
+        case BT_EVT_TO_LM_HCI_CMD:
+            type = BENCH_H4_TYPE_CMD;
+            break;
+
+        case BT_EVT_TO_LM_HCI_ACL:
+            type = BENCH_H4_TYPE_ACL;
+            if ((acl_data_size != 0) &&
+                (p_msg->len > acl_data_size + HCI_DATA_PREAMBLE_SIZE) &&
+                bench_hci_send_segments(p_msg, acl_data_size))
+                return;
+            break;
+
+        default:
+            GKI_freebuf(p_msg);
+            return;
+    }
+
+    iov[0].iov_base = &type;
+    iov[0].iov_len  = 1;
+    iov[1].iov_base = (UINT8 *)(p_msg + 1) + p_msg->offset;
+    iov[1].iov_len  = p_msg->len;
+    bench_hci_writev(iov, 2);
+
+    GKI_freebuf(p_msg);
+}
+
+/******************************************************************************
+**
+** Function         bte_main_post_reset_init
+**
+** Description      BTE MAIN API - This function is mapped to BTM_APP_DEV_INIT
+**                  and shall be automatically called from BTE after HCI_Reset
+**
+** Returns          None
+**
+******************************************************************************/
+void bte_main_post_reset_init()
+{
+    BTM_ContinueReset();
+}
+
+/*******************************************************************************
+**
+** Function         devclass2uint
+**
+** Description      Same as the btif utility, which btbench does not link.
+**
+** Returns          the class of device as a number
+**
+*******************************************************************************/
+UINT32 devclass2uint(DEV_CLASS dev_class)
+{
+    return (dev_class[2]) | (dev_class[1] << 8) | (dev_class[0] << 16);
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_hw_co_enable
+**
+** Description      The simulated controller is always powered.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_sys_hw_co_enable( tBTA_SYS_HW_MODULE module )
+{
+    bta_sys_hw_ci_enabled( module );
+}
+
+/*******************************************************************************
+**
+** Function         bta_sys_hw_co_disable
+**
+** Description      The simulated controller is always powered.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_sys_hw_co_disable( tBTA_SYS_HW_MODULE module )
+{
+    bta_sys_hw_ci_disabled( module );
+}
@@ -0,0 +1,452 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      bench_main.c
+ *
+ *  Description:   btbench entry point
+ *
+ *                 Brings up GKI and the BTU task the way bte_main.c does, with
+ *                 the bench task in the BTIF task slot, resets the simulated
+ *                 controller through BTM and runs the selected scenarios. Each
+ *                 scenario prints one JSON object per line.
+ *
+ ******************************************************************************/
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "btu.h"
+#include "btm_api.h"
+#include "bt_trace.h"
+#include "l2cdefs.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BENCH_TASK_STR              ((INT8 *) "BENCH")
+#define BENCH_RESET_TIMEOUT_MS      5000
+
+#define BENCH_DEFAULT_COUNT         1000
+#define BENCH_DEFAULT_LINKS         1
+#define BENCH_DEFAULT_CHANS         1
+#define BENCH_DEFAULT_WINDOW        8
+#define BENCH_DEFAULT_TIMEOUT_MS    30000
+#define BENCH_DEFAULT_ACL_LEN       1021
+#define BENCH_DEFAULT_ACL_BUFS      8
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+/* Message carrying a function call to the BTU task */
+typedef struct
+{
+    BT_HDR          hdr;
+    tBENCH_CALL_FN  *p_fn;
+    void            *p_data;
+    sem_t           *p_sem;
+} tBENCH_CALL_MSG;
+
+typedef struct
+{
+    tBENCH_OPTS     opts;
+    tBENCH_CTRL_CFG ctrl_cfg;
+    char            *p_scenarios;
+    FILE            *p_out;
+    UINT8           trace_level;
+    sem_t           reset_sem;
+    sem_t           done_sem;
+    int             failed;
+} tBENCH_MAIN_CB;
+
+/*******************************************************************************
+**  Externs
+********************************************************************************/
+
+BTU_API extern UINT32 btu_task (UINT32 param);
+extern tBTTRC_FUNC_MAP bttrc_set_level_map[];
+extern BOOLEAN trace_conf_enabled;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBENCH_MAIN_CB bench_cb;
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static void bench_usage(const char *p_prog)
+{
+    const tBENCH_SCENARIO *p_scen;
+
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -s name[,name]   scenarios to run (default: all)\n"
+            "  -n count         packets, connections or messages (default %d)\n"
+            "  -b bytes         payload size (default: per scenario)\n"
+            "  -L links         ACL links for acl_throughput, acl_mixed (default %d)\n"
+            "  -C chans         channels per link for acl_throughput, acl_mixed (default %d)\n"
+            "  -w window        packets in flight for echo scenarios (default %d)\n"
+            "  -A bytes         controller ACL data length (default %d)\n"
+            "  -B bufs          controller ACL buffer count (default %d)\n"
+            "  -T ms            timeout per scenario (default %d)\n"
+            "  -t level         stack trace level, 0-5 (default 0)\n"
+            "  -o file          write results to file instead of stdout\n"
+            "scenarios:\n",
+            p_prog, BENCH_DEFAULT_COUNT, BENCH_DEFAULT_LINKS, BENCH_DEFAULT_CHANS,
+            BENCH_DEFAULT_WINDOW, BENCH_DEFAULT_ACL_LEN, BENCH_DEFAULT_ACL_BUFS,
+            BENCH_DEFAULT_TIMEOUT_MS);
+
+    for (p_scen = bench_scenarios; p_scen->p_name; p_scen++)
+        fprintf(stderr, "  %-18s %s\n", p_scen->p_name, p_scen->p_desc);
+}
+
+/*******************************************************************************
+**
+** Function         bench_call_evt
+**
+** Description      BTU event handler of the function calls posted by
+**                  bench_call().
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_call_evt(BT_HDR *p_msg)
+{
+    tBENCH_CALL_MSG *p_call = (tBENCH_CALL_MSG *)p_msg;
+
+    (*p_call->p_fn)(p_call->p_data);
+    if (p_call->p_sem)
+        sem_post(p_call->p_sem);
+    GKI_freebuf(p_msg);
+}
+
+/*******************************************************************************
+**
+** Function         bench_reset_cback
+**
+** Description      BTM_DeviceReset() completion.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_reset_cback(void *p1)
+{
+    sem_post(&bench_cb.reset_sem);
+}
+
+static void bench_reset(void *p_data)
+{
+    BTM_DeviceReset(bench_reset_cback);
+}
+
+/*******************************************************************************
+**
+** Function         bench_selected
+**
+** Description      Checks whether a scenario is in the -s list.
+**
+** Returns          TRUE if it is to run
+**
+*******************************************************************************/
+static BOOLEAN bench_selected(const char *p_name)
+{
+    const char  *p = bench_cb.p_scenarios;
+    size_t      len = strlen(p_name);
+
+    if (p == NULL)
+        return TRUE;
+
+    while ((p = strstr(p, p_name)) != NULL)
+    {
+        if (((p == bench_cb.p_scenarios) || (p[-1] == ',')) &&
+            ((p[len] == '\0') || (p[len] == ',')))
+            return TRUE;
+        p += len;
+    }
+    return FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         bench_task
+**
+** Description      Task of the scenarios, started in the BTIF task slot so
+**                  BTU kicks it once the stack is initialized.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_task(UINT32 param)
+{
+    const tBENCH_SCENARIO   *p_scen;
+    tBENCH_RESULT           res;
+
+    for (;;)
+    {
+        if (GKI_wait(0xFFFF, 0) & BT_EVT_TRIGGER_STACK_INIT)
+            break;
+    }
+
+    /* BTU is idle until the first message, so the handler of the calls can
+    ** be put in place from here */
+    btu_register_event_range(BENCH_EVT_CALL, bench_call_evt);
+
+    bench_call(bench_reset, NULL);
+    if (!bench_wait(&bench_cb.reset_sem, BENCH_RESET_TIMEOUT_MS))
+    {
+        fprintf(stderr, "btbench: controller reset timed out\n");
+        bench_cb.failed = 1;
+        sem_post(&bench_cb.done_sem);
+        return;
+    }
+
+    if (!bench_scen_init())
+    {
+        fprintf(stderr, "btbench: scenario setup failed\n");
+        bench_cb.failed = 1;
+        sem_post(&bench_cb.done_sem);
+        return;
+    }
+
+    for (p_scen = bench_scenarios; p_scen->p_name; p_scen++)
+    {
+        if (!bench_selected(p_scen->p_name))
+            continue;
+
+        bench_result_init(&res);
+        (*p_scen->p_run)(&bench_cb.opts, &res);
+
+        bench_print_result(bench_cb.p_out, p_scen->p_name, &res);
+        if (strcmp(res.p_status, "failed") == 0)
+            bench_cb.failed = 1;
+
+        bench_samples_free(&res.samples);
+        bench_samples_free(&res.samples2);
+    }
+
+    sem_post(&bench_cb.done_sem);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bench_wait
+**
+** Description      Waits for a semaphore.
+**
+** Returns          FALSE on timeout
+**
+*******************************************************************************/
+BOOLEAN bench_wait(sem_t *p_sem, UINT32 timeout_ms)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec  += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * BENCH_NS_PER_MS;
+    if (ts.tv_nsec >= (long)BENCH_NS_PER_SEC)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= BENCH_NS_PER_SEC;
+    }
+
+    while (sem_timedwait(p_sem, &ts) != 0)
+    {
+        if (errno != EINTR)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bench_call
+**
+** Description      Runs p_fn(p_data) in the BTU task, where the stack APIs
+**                  may be called.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_call(tBENCH_CALL_FN *p_fn, void *p_data)
+{
+    tBENCH_CALL_MSG *p_msg;
+
+    if ((p_msg = (tBENCH_CALL_MSG *)GKI_getbuf(sizeof(tBENCH_CALL_MSG))) == NULL)
+        return;
+
+    p_msg->hdr.event = BENCH_EVT_CALL;
+    p_msg->p_fn = p_fn;
+    p_msg->p_data = p_data;
+    p_msg->p_sem = NULL;
+    GKI_send_msg(BTU_TASK, BTU_HCI_RCV_MBOX, p_msg);
+}
+
+/*******************************************************************************
+**
+** Function         bench_call_sync
+**
+** Description      Runs p_fn(p_data) in the BTU task and waits for it to
+**                  return. Not to be called from the BTU task.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_call_sync(tBENCH_CALL_FN *p_fn, void *p_data)
+{
+    tBENCH_CALL_MSG *p_msg;
+    sem_t           sem;
+
+    if ((p_msg = (tBENCH_CALL_MSG *)GKI_getbuf(sizeof(tBENCH_CALL_MSG))) == NULL)
+        return;
+
+    sem_init(&sem, 0, 0);
+    p_msg->hdr.event = BENCH_EVT_CALL;
+    p_msg->p_fn = p_fn;
+    p_msg->p_data = p_data;
+    p_msg->p_sem = &sem;
+    GKI_send_msg(BTU_TASK, BTU_HCI_RCV_MBOX, p_msg);
+
+    while (sem_wait(&sem) != 0)
+        ;
+    sem_destroy(&sem);
+}
+
+/*******************************************************************************
+**
+** Function         main
+**
+** Description      Parses the options, starts the stack and the simulated
+**                  controller and waits for the scenarios to finish.
+**
+** Returns          0 if no scenario failed
+**
+*******************************************************************************/
+int main(int argc, char *argv[])
+{
+    static const BD_ADDR local_addr = {0x00, 0x1b, 0xdc, 0xff, 0xff, 0x01};
+    tBTTRC_FUNC_MAP *p_f_map;
+    int             opt, fd;
+
+    bench_cb.opts.count = BENCH_DEFAULT_COUNT;
+    bench_cb.opts.links = BENCH_DEFAULT_LINKS;
+    bench_cb.opts.chans = BENCH_DEFAULT_CHANS;
+    bench_cb.opts.window = BENCH_DEFAULT_WINDOW;
+    bench_cb.opts.timeout_ms = BENCH_DEFAULT_TIMEOUT_MS;
+    bench_cb.ctrl_cfg.acl_data_len = BENCH_DEFAULT_ACL_LEN;
+    bench_cb.ctrl_cfg.acl_num_bufs = BENCH_DEFAULT_ACL_BUFS;
+    bench_cb.ctrl_cfg.peer_mtu = L2CAP_MTU_SIZE;
+    memcpy(bench_cb.ctrl_cfg.local_addr, local_addr, BD_ADDR_LEN);
+    bench_cb.p_out = stdout;
+
+    while ((opt = getopt(argc, argv, "s:n:b:L:C:w:A:B:T:t:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 's': bench_cb.p_scenarios = optarg; break;
+            case 'n': bench_cb.opts.count = (UINT32)atoi(optarg); break;
+            case 'b': bench_cb.opts.size = (UINT16)atoi(optarg); break;
+            case 'L': bench_cb.opts.links = (UINT8)atoi(optarg); break;
+            case 'C': bench_cb.opts.chans = (UINT8)atoi(optarg); break;
+            case 'w': bench_cb.opts.window = (UINT16)atoi(optarg); break;
+            case 'A': bench_cb.ctrl_cfg.acl_data_len = (UINT16)atoi(optarg); break;
+            case 'B': bench_cb.ctrl_cfg.acl_num_bufs = (UINT16)atoi(optarg); break;
+            case 'T': bench_cb.opts.timeout_ms = (UINT32)atoi(optarg); break;
+            case 't': bench_cb.trace_level = (UINT8)atoi(optarg); break;
+            case 'o':
+                if ((bench_cb.p_out = fopen(optarg, "w")) == NULL)
+                {
+                    perror(optarg);
+                    return 2;
+                }
+                break;
+            default:
+                bench_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((bench_cb.opts.count == 0) || (bench_cb.opts.links == 0) || (bench_cb.opts.chans == 0) ||
+        (bench_cb.opts.window == 0) || (bench_cb.ctrl_cfg.acl_num_bufs == 0) ||
+        (bench_cb.ctrl_cfg.acl_data_len < L2CAP_PKT_OVERHEAD + L2CAP_CMD_OVERHEAD) ||
+        (bench_cb.opts.links > MAX_L2CAP_LINKS) ||
+        (bench_cb.opts.links * bench_cb.opts.chans > BENCH_MAX_CHANNELS))
+    {
+        fprintf(stderr, "btbench: bad option value (at most %d links, %d channels)\n",
+                MAX_L2CAP_LINKS, BENCH_MAX_CHANNELS);
+        return 2;
+    }
+
+    /* some layers print straight to stdout: keep it for the results only */
+    if (bench_cb.p_out == stdout)
+    {
+        if ((fd = dup(STDOUT_FILENO)) < 0 || (bench_cb.p_out = fdopen(fd, "w")) == NULL)
+        {
+            perror("btbench: stdout");
+            return 2;
+        }
+    }
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    sem_init(&bench_cb.reset_sem, 0, 0);
+    sem_init(&bench_cb.done_sem, 0, 0);
+
+    GKI_init();
+
+    /* every layer traces at the level asked for, applied once BTU is up */
+    for (p_f_map = bttrc_set_level_map; p_f_map->trc_name != NULL; p_f_map++)
+        p_f_map->trace_level = bench_cb.trace_level;
+    trace_conf_enabled = TRUE;
+
+    if (((fd = bench_hci_open()) < 0) || !bench_ctrl_start(fd, &bench_cb.ctrl_cfg))
+    {
+        fprintf(stderr, "btbench: cannot start the simulated controller\n");
+        return 1;
+    }
+
+    BTE_Init();
+    GKI_create_task((TASKPTR)btu_task, BTU_TASK, (INT8 *)"BTU", NULL, 0);
+    GKI_create_task(bench_task, BTIF_TASK, BENCH_TASK_STR, NULL, 0);
+    GKI_run(0);
+
+    /* the transport is up: let BTU initialize the stack */
+    GKI_send_event(BTU_TASK, TASK_MBOX_0_EVT_MASK);
+
+    while (sem_wait(&bench_cb.done_sem) != 0)
+        ;
+
+    fclose(bench_cb.p_out);
+
+    /* the stack tasks are left to exit with the process */
+    return bench_cb.failed;
+}
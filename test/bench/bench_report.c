@@ -0,0 +1,235 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      bench_report.c
+ *
+ *  Description:   Time sources, samples and JSON results of the benchmarks
+ *
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "bench_report.h"
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static int bench_cmp_u64(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a, b = *(const uint64_t *)p_b;
+
+    return (a < b) ? -1 : (a > b);
+}
+
+/*******************************************************************************
+**
+** Function         bench_print_samples
+**
+** Description      Prints the distribution of samples as a JSON member, in
+**                  us. Percentiles use the nearest rank.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_print_samples(FILE *p_out, const char *p_name, tBENCH_SAMPLES *p_smp)
+{
+    static const uint32_t pct[] = {50, 90, 99};
+    uint64_t    sum = 0;
+    uint32_t    xx, rank;
+
+    fprintf(p_out, ",\"%s\":{\"n\":%u", p_name, p_smp->num);
+    if (p_smp->num == 0)
+    {
+        fprintf(p_out, "}");
+        return;
+    }
+
+    qsort(p_smp->p_val, p_smp->num, sizeof(uint64_t), bench_cmp_u64);
+    for (xx = 0; xx < p_smp->num; xx++)
+        sum += p_smp->p_val[xx];
+
+    fprintf(p_out, ",\"min\":%.3f,\"mean\":%.3f",
+            (double)p_smp->p_val[0] / BENCH_NS_PER_US,
+            (double)sum / p_smp->num / BENCH_NS_PER_US);
+    for (xx = 0; xx < sizeof(pct) / sizeof(pct[0]); xx++)
+    {
+        rank = (uint32_t)(((uint64_t)pct[xx] * p_smp->num + 99) / 100);
+        fprintf(p_out, ",\"p%u\":%.3f", pct[xx],
+                (double)p_smp->p_val[rank - 1] / BENCH_NS_PER_US);
+    }
+    fprintf(p_out, ",\"max\":%.3f}",
+            (double)p_smp->p_val[p_smp->num - 1] / BENCH_NS_PER_US);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bench_now_ns
+**
+** Description      Monotonic time.
+**
+** Returns          ns
+**
+*******************************************************************************/
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * BENCH_NS_PER_SEC + ts.tv_nsec;
+}
+
+/*******************************************************************************
+**
+** Function         bench_cycles
+**
+** Description      CPU time stamp counter, for costs per operation. Where
+**                  there is none the monotonic clock in ns is used instead.
+**
+** Returns          cycles
+**
+*******************************************************************************/
+uint64_t bench_cycles(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return bench_now_ns();
+#endif
+}
+
+int bench_samples_init(tBENCH_SAMPLES *p_smp, uint32_t max)
+{
+    p_smp->num = 0;
+    p_smp->max = max;
+    p_smp->p_val = (uint64_t *)malloc((max ? max : 1) * sizeof(uint64_t));
+    return (p_smp->p_val != NULL);
+}
+
+void bench_samples_add(tBENCH_SAMPLES *p_smp, uint64_t val)
+{
+    if (p_smp->num < p_smp->max)
+        p_smp->p_val[p_smp->num++] = val;
+}
+
+void bench_samples_free(tBENCH_SAMPLES *p_smp)
+{
+    free(p_smp->p_val);
+    p_smp->p_val = NULL;
+    p_smp->num = p_smp->max = 0;
+}
+
+void bench_result_init(tBENCH_RESULT *p_res)
+{
+    memset(p_res, 0, sizeof(*p_res));
+    p_res->p_status = "ok";
+}
+
+/*******************************************************************************
+**
+** Function         bench_fail
+**
+** Description      Marks a case as failed, with the reason.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_fail(tBENCH_RESULT *p_res, const char *p_fmt, ...)
+{
+    va_list ap;
+
+    p_res->p_status = "failed";
+    va_start(ap, p_fmt);
+    vsnprintf(p_res->reason, sizeof(p_res->reason), p_fmt, ap);
+    va_end(ap);
+}
+
+/*******************************************************************************
+**
+** Function         bench_extra
+**
+** Description      Appends JSON members to the extra members of a result.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_extra(tBENCH_RESULT *p_res, const char *p_fmt, ...)
+{
+    size_t  used = strlen(p_res->extra);
+    va_list ap;
+
+    if (used && (used < sizeof(p_res->extra) - 1))
+        p_res->extra[used++] = ',';
+
+    va_start(ap, p_fmt);
+    vsnprintf(p_res->extra + used, sizeof(p_res->extra) - used, p_fmt, ap);
+    va_end(ap);
+}
+
+/*******************************************************************************
+**
+** Function         bench_print_result
+**
+** Description      Prints the result of a case as one line of JSON.
+**
+** Returns          void
+**
+*******************************************************************************/
+void bench_print_result(FILE *p_out, const char *p_name, tBENCH_RESULT *p_res)
+{
+    double secs = (double)p_res->elapsed_ns / BENCH_NS_PER_SEC;
+
+    fprintf(p_out, "{\"scenario\":\"%s\",\"status\":\"%s\"", p_name, p_res->p_status);
+    if (p_res->reason[0])
+        fprintf(p_out, ",\"reason\":\"%s\"", p_res->reason);
+    fprintf(p_out, ",\"params\":{%s}", p_res->params);
+
+    if (strcmp(p_res->p_status, "skipped") != 0)
+    {
+        fprintf(p_out, ",\"count\":%u,\"bytes\":%llu,\"elapsed_ms\":%.3f",
+                p_res->count, (unsigned long long)p_res->bytes, secs * 1000);
+        if (secs > 0)
+        {
+            fprintf(p_out, ",\"throughput_kBps\":%.1f,\"rate_pps\":%.1f",
+                    p_res->bytes / secs / 1000, p_res->count / secs);
+        }
+        if (p_res->p_samples_name)
+            bench_print_samples(p_out, p_res->p_samples_name, &p_res->samples);
+        if (p_res->p_samples2_name)
+            bench_print_samples(p_out, p_res->p_samples2_name, &p_res->samples2);
+        if (p_res->extra[0])
+            fprintf(p_out, ",%s", p_res->extra);
+    }
+
+    fprintf(p_out, "}\n");
+    fflush(p_out);
+}
@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      bench_report.h
+ *
+ *  Description:   Results of the benchmarks under test/bench
+ *
+ *                 btbench and the standalone benchmarks of single modules
+ *                 print one JSON object per line and case, in the same form,
+ *                 so their output can be collected by the same scripts.
+ *
+ ******************************************************************************/
+
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BENCH_NS_PER_US         1000ULL
+#define BENCH_NS_PER_MS         1000000ULL
+#define BENCH_NS_PER_SEC        1000000000ULL
+
+/*******************************************************************************
+**  Type definitions
+********************************************************************************/
+
+/* Collected samples of one case, in ns */
+typedef struct
+{
+    uint64_t    *p_val;
+    uint32_t    num;
+    uint32_t    max;
+} tBENCH_SAMPLES;
+
+/* Result of one case */
+typedef struct
+{
+    const char  *p_status;          /* "ok", "failed" or "skipped"            */
+    char        reason[96];
+    char        params[160];        /* JSON members, without braces           */
+    uint32_t    count;
+    uint64_t    bytes;
+    uint64_t    elapsed_ns;
+    const char  *p_samples_name;    /* e.g. "latency_us"                      */
+    tBENCH_SAMPLES samples;
+    const char  *p_samples2_name;
+    tBENCH_SAMPLES samples2;
+    char        extra[768];         /* further JSON members                   */
+} tBENCH_RESULT;
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+extern uint64_t bench_now_ns (void);
+extern uint64_t bench_cycles (void);
+extern int bench_samples_init (tBENCH_SAMPLES *p_smp, uint32_t max);
+extern void bench_samples_add (tBENCH_SAMPLES *p_smp, uint64_t val);
+extern void bench_samples_free (tBENCH_SAMPLES *p_smp);
+extern void bench_result_init (tBENCH_RESULT *p_res);
+extern void bench_fail (tBENCH_RESULT *p_res, const char *p_fmt, ...);
+extern void bench_extra (tBENCH_RESULT *p_res, const char *p_fmt, ...);
+extern void bench_print_result (FILE *p_out, const char *p_name, tBENCH_RESULT *p_res);
+
+#endif /* BENCH_REPORT_H */
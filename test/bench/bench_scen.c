@@ -0,0 +1,1531 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      bench_scen.c
+ *
+ *  Description:   btbench scenarios
+ *
+ *                 The scenarios run in the bench task and drive the stack
+ *                 through bench_call(), so every L2CAP and RFCOMM API call
+ *                 and callback happens in the BTU task. Latencies are taken
+ *                 from the packet index the payloads carry: the time the
+ *                 host handed the packet to the stack is noted by index,
+ *                 and the simulated controller or the echo path looks it up
+ *                 when the packet arrives.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "btm_api.h"
+#include "l2c_api.h"
+#include "l2cdefs.h"
+#include "l2c_int.h"
+#include "port_api.h"
+#include "rfcdefs.h"
+#include "sdpdefs.h"
+#include "sbc_encoder.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BENCH_CHAN_IDLE             0
+#define BENCH_CHAN_CONNECTING       1
+#define BENCH_CHAN_OPEN             2
+#define BENCH_CHAN_CLOSING          3
+
+/* Packets the throughput pump queues before it lets BTU run other events */
+#define BENCH_PUMP_BURST            32
+
+#define BENCH_ACL_DEFAULT_SIZE      1000
+
+/* acl_mixed: the channels of a link send PDUs of the size, a quarter of it
+** and a sixteenth of it, in turn */
+#define BENCH_MIX_SIZE_CLASSES      3
+#define BENCH_RFC_DEFAULT_SIZE      128
+#define BENCH_RFC_SCN               1
+#define BENCH_RFC_MTU               990
+
+/* A2DP media packet: RTP header and the SBC media payload header */
+#define BENCH_RTP_HDR_LEN           12
+#define BENCH_RTP_SSRC_OFFSET       8
+#define BENCH_SBC_HDR_LEN           1
+#define BENCH_SBC_MAX_FRAMES        15
+#define BENCH_SBC_BITRATE           328
+#define BENCH_SBC_SAMPLES_PER_FRAME 128     /* 16 blocks of 8 subbands */
+#define BENCH_SBC_SAMPLE_RATE       44100
+
+#define BENCH_SECS_CLOSE            5
+
+/* Inquiries of the inquiry scenario, all answered by the same devices */
+#define BENCH_INQ_ROUNDS            4
+
+#define BENCH_PEER_ADDR(bd, link)   {static const BD_ADDR base = BENCH_PEER_ADDR_BASE; \
+                                     memcpy(bd, base, BD_ADDR_LEN); bd[5] = (UINT8)((link) + 1);}
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    BOOLEAN     in_use;
+    UINT8       state;
+    UINT16      lcid;
+    UINT16      psm;
+    BOOLEAN     cfg_ind_done;
+    BOOLEAN     cfg_cfm_done;
+    BOOLEAN     congested;
+    UINT16      peer_mtu;
+    uint64_t    t_start;
+    BUFFER_Q    tx_q;               /* held while the channel is congested */
+} tBENCH_CHAN;
+
+/* Channels to open, or the channel to close */
+typedef struct
+{
+    UINT16      psm;
+    UINT8       links;
+    UINT8       chans;
+    UINT16      lcid;
+    UINT32      num;                /* out: requests made */
+} tBENCH_CHAN_REQ;
+
+typedef struct
+{
+    UINT16          echo_psm;
+    UINT16          sink_psm;
+    tBENCH_CHAN     chan[BENCH_MAX_CHANNELS];
+    sem_t           open_sem;       /* a channel opened or failed to */
+    sem_t           close_sem;      /* a channel closed */
+    uint64_t        last_open_ns;
+    uint64_t        last_close_ns;
+    tBENCH_CALL_FN  *p_pump;        /* resumes a sender on decongestion */
+} tBENCH_SCEN_CB;
+
+/* acl_throughput */
+typedef struct
+{
+    UINT32          total;
+    volatile UINT32 sent;
+    volatile UINT32 received;
+    UINT16          size;
+    UINT8           next_chan;
+    BOOLEAN         pump_pending;
+    uint64_t        *p_sent_ns;
+    uint64_t        t_last_rx;
+    tBENCH_SAMPLES  *p_lat;
+    sem_t           done_sem;
+} tBENCH_TP_CB;
+
+/* acl_mixed, by channel slot */
+typedef struct
+{
+    UINT32              total;
+    volatile UINT32     received;
+    volatile BOOLEAN    done;
+    UINT16              size[BENCH_MAX_CHANNELS];
+    tL2C_CCB_TX_STATS   stats[BENCH_MAX_CHANNELS];
+    UINT16              quota[BENCH_MAX_CHANNELS];  /* of the link, 0 if round robin */
+    UINT8               next_chan;
+    BOOLEAN             pump_pending;
+    uint64_t            t_last_rx;
+    sem_t               done_sem;
+} tBENCH_MIX_CB;
+
+/* rfcomm_echo */
+typedef struct
+{
+    UINT16          handle;
+    UINT32          last_code;
+    sem_t           evt_sem;
+    UINT32          total;
+    UINT32          window;
+    UINT16          size;
+    UINT32          sent;
+    UINT16          tx_off;         /* part of the current message written */
+    UINT32          done;
+    uint64_t        rx_bytes;
+    BOOLEAN         tx_error;
+    UINT8           *p_msg;
+    uint64_t        *p_sent_ns;
+    tBENCH_SAMPLES  *p_rtt;
+    sem_t           done_sem;
+} tBENCH_RFC_CB;
+
+/* a2dp_encode_send */
+typedef struct
+{
+    UINT32          total;
+    volatile UINT32 received;
+    uint64_t        *p_sent_ns;
+    uint64_t        t_last_rx;
+    tBENCH_SAMPLES  *p_lat;
+    tBENCH_CHAN     *p_chan;
+    sem_t           win_sem;
+    sem_t           done_sem;
+} tBENCH_A2DP_CB;
+
+/* inquiry */
+typedef struct
+{
+    UINT16          num_peers;
+    volatile UINT32 results;        /* reported in the current inquiry */
+    UINT32          found;          /* BTM_InqDbRead hits */
+    UINT32          found_recent;   /* of them, among the last responders */
+    uint64_t        lookup_ns;
+    tBTM_STATUS     status;
+    sem_t           done_sem;
+} tBENCH_INQ_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBENCH_SCEN_CB bench_scen_cb;
+static tBENCH_TP_CB bench_tp_cb;
+static tBENCH_MIX_CB bench_mix_cb;
+static tBENCH_RFC_CB bench_rfc_cb;
+static tBENCH_A2DP_CB bench_a2dp_cb;
+static tBENCH_INQ_CB bench_inq_cb;
+
+/*******************************************************************************
+**  Channel management, in the BTU task
+********************************************************************************/
+
+static tBENCH_CHAN *bench_scen_find_chan(UINT16 lcid)
+{
+    int xx;
+
+    for (xx = 0; xx < BENCH_MAX_CHANNELS; xx++)
+    {
+        if (bench_scen_cb.chan[xx].in_use && (bench_scen_cb.chan[xx].lcid == lcid))
+            return &bench_scen_cb.chan[xx];
+    }
+    return NULL;
+}
+
+static void bench_scen_free_chan(tBENCH_CHAN *p_chan)
+{
+    void *p_buf;
+
+    while ((p_buf = GKI_dequeue(&p_chan->tx_q)) != NULL)
+        GKI_freebuf(p_buf);
+    memset(p_chan, 0, sizeof(*p_chan));
+}
+
+/*******************************************************************************
+**
+** Function         bench_scen_write
+**
+** Description      Sends a packet on a channel, holding it while the channel
+**                  is congested.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_scen_write(tBENCH_CHAN *p_chan, BT_HDR *p_buf)
+{
+    if (p_chan->congested || p_chan->tx_q.count)
+    {
+        GKI_enqueue(&p_chan->tx_q, p_buf);
+        return;
+    }
+
+    if (L2CA_DataWrite(p_chan->lcid, p_buf) != L2CAP_DW_SUCCESS)
+        p_chan->congested = TRUE;
+}
+
+static void bench_scen_connect_cfm(UINT16 lcid, UINT16 result)
+{
+    tBENCH_CHAN     *p_chan = bench_scen_find_chan(lcid);
+    tL2CAP_CFG_INFO cfg;
+
+    if (p_chan == NULL)
+        return;
+
+    if (result == L2CAP_CONN_OK)
+    {
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.mtu_present = TRUE;
+        cfg.mtu = L2CAP_MTU_SIZE;
+        L2CA_ConfigReq(lcid, &cfg);
+    }
+    else if (result != L2CAP_CONN_PENDING)
+    {
+        bench_scen_free_chan(p_chan);
+        sem_post(&bench_scen_cb.open_sem);
+    }
+}
+
+static void bench_scen_check_open(tBENCH_CHAN *p_chan)
+{
+    if ((p_chan->state == BENCH_CHAN_CONNECTING) && p_chan->cfg_ind_done && p_chan->cfg_cfm_done)
+    {
+        p_chan->state = BENCH_CHAN_OPEN;
+        bench_scen_cb.last_open_ns = bench_now_ns() - p_chan->t_start;
+        sem_post(&bench_scen_cb.open_sem);
+    }
+}
+
+static void bench_scen_config_ind(UINT16 lcid, tL2CAP_CFG_INFO *p_cfg)
+{
+    tBENCH_CHAN *p_chan = bench_scen_find_chan(lcid);
+
+    if (p_chan)
+    {
+        p_chan->peer_mtu = p_cfg->mtu_present ? p_cfg->mtu : L2CAP_DEFAULT_MTU;
+        p_chan->cfg_ind_done = TRUE;
+    }
+
+    p_cfg->mtu_present = FALSE;
+    p_cfg->flush_to_present = FALSE;
+    p_cfg->qos_present = FALSE;
+    p_cfg->result = L2CAP_CFG_OK;
+    L2CA_ConfigRsp(lcid, p_cfg);
+
+    if (p_chan)
+        bench_scen_check_open(p_chan);
+}
+
+static void bench_scen_config_cfm(UINT16 lcid, tL2CAP_CFG_INFO *p_cfg)
+{
+    tBENCH_CHAN *p_chan = bench_scen_find_chan(lcid);
+
+    if (p_chan == NULL)
+        return;
+
+    if (p_cfg->result == L2CAP_CFG_OK)
+    {
+        p_chan->cfg_cfm_done = TRUE;
+        bench_scen_check_open(p_chan);
+    }
+    else
+    {
+        L2CA_DisconnectReq(lcid);
+        bench_scen_free_chan(p_chan);
+        sem_post(&bench_scen_cb.open_sem);
+    }
+}
+
+static void bench_scen_disconnect_ind(UINT16 lcid, BOOLEAN ack_needed)
+{
+    tBENCH_CHAN *p_chan = bench_scen_find_chan(lcid);
+
+    if (ack_needed)
+        L2CA_DisconnectRsp(lcid);
+
+    if (p_chan)
+    {
+        if (p_chan->state == BENCH_CHAN_CONNECTING)
+            sem_post(&bench_scen_cb.open_sem);
+        else if (p_chan->state == BENCH_CHAN_CLOSING)
+            sem_post(&bench_scen_cb.close_sem);
+        bench_scen_free_chan(p_chan);
+    }
+}
+
+static void bench_scen_disconnect_cfm(UINT16 lcid, UINT16 result)
+{
+    tBENCH_CHAN *p_chan = bench_scen_find_chan(lcid);
+
+    if (p_chan && (p_chan->state == BENCH_CHAN_CLOSING))
+    {
+        bench_scen_cb.last_close_ns = bench_now_ns() - p_chan->t_start;
+        bench_scen_free_chan(p_chan);
+        sem_post(&bench_scen_cb.close_sem);
+    }
+}
+
+static void bench_scen_data_ind(UINT16 lcid, BT_HDR *p_buf)
+{
+    GKI_freebuf(p_buf);
+}
+
+static void bench_scen_congestion(UINT16 lcid, BOOLEAN congested)
+{
+    tBENCH_CHAN *p_chan = bench_scen_find_chan(lcid);
+    BT_HDR      *p_buf;
+
+    if (p_chan == NULL)
+        return;
+
+    p_chan->congested = congested;
+    while (!p_chan->congested && ((p_buf = (BT_HDR *)GKI_dequeue(&p_chan->tx_q)) != NULL))
+    {
+        if (L2CA_DataWrite(p_chan->lcid, p_buf) != L2CAP_DW_SUCCESS)
+            p_chan->congested = TRUE;
+    }
+
+    if (!p_chan->congested && bench_scen_cb.p_pump)
+        (*bench_scen_cb.p_pump)(NULL);
+}
+
+static const tL2CAP_APPL_INFO bench_scen_l2c_appl =
+{
+    NULL,                           /* outgoing only */
+    bench_scen_connect_cfm,
+    NULL,
+    bench_scen_config_ind,
+    bench_scen_config_cfm,
+    bench_scen_disconnect_ind,
+    bench_scen_disconnect_cfm,
+    NULL,
+    bench_scen_data_ind,
+    bench_scen_congestion,
+    NULL
+};
+
+static void bench_scen_connect(void *p_data)
+{
+    tBENCH_CHAN_REQ *p_req = (tBENCH_CHAN_REQ *)p_data;
+    tBENCH_CHAN     *p_chan;
+    BD_ADDR         bd_addr;
+    UINT8           link, ch;
+    int             xx;
+
+    for (link = 0; link < p_req->links; link++)
+    {
+        BENCH_PEER_ADDR(bd_addr, link);
+
+        for (ch = 0; ch < p_req->chans; ch++)
+        {
+            for (xx = 0, p_chan = bench_scen_cb.chan; xx < BENCH_MAX_CHANNELS; xx++, p_chan++)
+            {
+                if (!p_chan->in_use)
+                    break;
+            }
+            p_req->num++;
+            if (xx == BENCH_MAX_CHANNELS)
+            {
+                sem_post(&bench_scen_cb.open_sem);
+                continue;
+            }
+
+            p_chan->in_use = TRUE;
+            p_chan->state = BENCH_CHAN_CONNECTING;
+            p_chan->psm = p_req->psm;
+            p_chan->t_start = bench_now_ns();
+
+            /* L2CAP drops the security record of a virtual PSM whenever
+            ** one of its channels is released */
+            BTM_SetSecurityLevel(TRUE, "", (p_req->psm == bench_scen_cb.echo_psm) ?
+                                 BTM_SEC_SERVICE_FIRST_EMPTY : BTM_SEC_SERVICE_FIRST_EMPTY + 1,
+                                 BTM_SEC_NONE, p_req->psm, BTM_SEC_PROTO_L2CAP, 0);
+            if ((p_chan->lcid = L2CA_ConnectReq(p_req->psm, bd_addr)) == 0)
+            {
+                bench_scen_free_chan(p_chan);
+                sem_post(&bench_scen_cb.open_sem);
+            }
+        }
+    }
+}
+
+static void bench_scen_disconnect(void *p_data)
+{
+    tBENCH_CHAN_REQ *p_req = (tBENCH_CHAN_REQ *)p_data;
+    tBENCH_CHAN     *p_chan = bench_scen_cb.chan;
+    int             xx;
+
+    for (xx = 0; xx < BENCH_MAX_CHANNELS; xx++, p_chan++)
+    {
+        if (!p_chan->in_use || (p_chan->state != BENCH_CHAN_OPEN) ||
+            (p_req->lcid && (p_chan->lcid != p_req->lcid)))
+            continue;
+
+        p_chan->state = BENCH_CHAN_CLOSING;
+        p_chan->t_start = bench_now_ns();
+        p_req->num++;
+        if (!L2CA_DisconnectReq(p_chan->lcid))
+        {
+            bench_scen_free_chan(p_chan);
+            sem_post(&bench_scen_cb.close_sem);
+        }
+    }
+}
+
+/*******************************************************************************
+**  Channel management, in the bench task
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bench_scen_open
+**
+** Description      Opens chans channels to psm on each of links peers.
+**
+** Returns          number of channels open
+**
+*******************************************************************************/
+static UINT32 bench_scen_open(UINT16 psm, UINT8 links, UINT8 chans, UINT32 timeout_ms)
+{
+    tBENCH_CHAN_REQ req;
+    UINT32          xx, num_open = 0;
+
+    memset(&req, 0, sizeof(req));
+    req.psm = psm;
+    req.links = links;
+    req.chans = chans;
+    bench_call_sync(bench_scen_connect, &req);
+
+    for (xx = 0; xx < req.num; xx++)
+    {
+        if (!bench_wait(&bench_scen_cb.open_sem, timeout_ms))
+            break;
+    }
+
+    for (xx = 0; xx < BENCH_MAX_CHANNELS; xx++)
+    {
+        if (bench_scen_cb.chan[xx].in_use && (bench_scen_cb.chan[xx].state == BENCH_CHAN_OPEN))
+            num_open++;
+    }
+    return num_open;
+}
+
+/*******************************************************************************
+**
+** Function         bench_scen_close
+**
+** Description      Closes the open channel lcid, or every open channel if
+**                  lcid is 0.
+**
+** Returns          TRUE if all of them closed in time
+**
+*******************************************************************************/
+static BOOLEAN bench_scen_close(UINT16 lcid, UINT32 timeout_ms)
+{
+    tBENCH_CHAN_REQ req;
+    UINT32          xx;
+
+    memset(&req, 0, sizeof(req));
+    req.lcid = lcid;
+    bench_call_sync(bench_scen_disconnect, &req);
+
+    for (xx = 0; xx < req.num; xx++)
+    {
+        if (!bench_wait(&bench_scen_cb.close_sem, timeout_ms))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static tBENCH_CHAN *bench_scen_first_open(void)
+{
+    int xx;
+
+    for (xx = 0; xx < BENCH_MAX_CHANNELS; xx++)
+    {
+        if (bench_scen_cb.chan[xx].in_use && (bench_scen_cb.chan[xx].state == BENCH_CHAN_OPEN))
+            return &bench_scen_cb.chan[xx];
+    }
+    return NULL;
+}
+
+static UINT16 bench_scen_min_mtu(void)
+{
+    UINT16  mtu = 0xFFFF;
+    int     xx;
+
+    for (xx = 0; xx < BENCH_MAX_CHANNELS; xx++)
+    {
+        if (bench_scen_cb.chan[xx].in_use && (bench_scen_cb.chan[xx].peer_mtu < mtu))
+            mtu = bench_scen_cb.chan[xx].peer_mtu;
+    }
+    return mtu;
+}
+
+static void bench_scen_sync(void *p_data)
+{
+}
+
+static BT_HDR *bench_scen_getbuf(UINT16 len)
+{
+    BT_HDR *p_buf;
+
+    if ((p_buf = (BT_HDR *)GKI_getbuf(BT_HDR_SIZE + L2CAP_MIN_OFFSET + len)) != NULL)
+    {
+        p_buf->offset = L2CAP_MIN_OFFSET;
+        p_buf->len = len;
+        p_buf->layer_specific = 0;
+        p_buf->event = 0;
+    }
+    return p_buf;
+}
+
+/*******************************************************************************
+**  acl_throughput
+********************************************************************************/
+
+static void bench_tp_sink(UINT16 psm, UINT8 *p_data, UINT16 len)
+{
+    uint64_t    now = bench_now_ns();
+    UINT32      idx;
+
+    if ((psm != BENCH_PSM_SINK) || (len != bench_tp_cb.size))
+        return;
+
+    STREAM_TO_UINT32 (idx, p_data);
+    if (idx >= bench_tp_cb.total)
+        return;
+
+    bench_samples_add(bench_tp_cb.p_lat, now - bench_tp_cb.p_sent_ns[idx]);
+    if (++bench_tp_cb.received == bench_tp_cb.total)
+    {
+        bench_tp_cb.t_last_rx = now;
+        sem_post(&bench_tp_cb.done_sem);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_tp_pump
+**
+** Description      Queues packets round robin on the channels that are not
+**                  congested, a burst at a time.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_tp_pump(void *p_data)
+{
+    tBENCH_CHAN *p_chan;
+    BT_HDR      *p_buf;
+    UINT8       *p;
+    UINT32      burst, tried;
+    UINT8       rc;
+
+    bench_tp_cb.pump_pending = FALSE;
+
+    for (burst = 0; (burst < BENCH_PUMP_BURST) && (bench_tp_cb.sent < bench_tp_cb.total); burst++)
+    {
+        for (tried = 0; tried < BENCH_MAX_CHANNELS; tried++)
+        {
+            p_chan = &bench_scen_cb.chan[bench_tp_cb.next_chan];
+            bench_tp_cb.next_chan = (bench_tp_cb.next_chan + 1) % BENCH_MAX_CHANNELS;
+            if (p_chan->in_use && (p_chan->state == BENCH_CHAN_OPEN) && !p_chan->congested)
+                break;
+        }
+        if (tried == BENCH_MAX_CHANNELS)
+            return;
+
+        if ((p_buf = bench_scen_getbuf(bench_tp_cb.size)) == NULL)
+            break;
+        p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        UINT32_TO_STREAM (p, bench_tp_cb.sent);
+        memset(p, 0x5a, bench_tp_cb.size - BENCH_IDX_LEN);
+
+        bench_tp_cb.p_sent_ns[bench_tp_cb.sent] = bench_now_ns();
+        rc = L2CA_DataWrite(p_chan->lcid, p_buf);
+        if (rc != L2CAP_DW_SUCCESS)
+            p_chan->congested = TRUE;
+        if (rc != L2CAP_DW_FAILED)
+            bench_tp_cb.sent++;
+    }
+
+    if ((bench_tp_cb.sent < bench_tp_cb.total) && !bench_tp_cb.pump_pending)
+    {
+        bench_tp_cb.pump_pending = TRUE;
+        bench_call(bench_tp_pump, NULL);
+    }
+}
+
+static void bench_scen_acl_throughput(const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res)
+{
+    tBENCH_TP_CB    *p_cb = &bench_tp_cb;
+    UINT32          num_chans = p_opts->links * p_opts->chans;
+    uint64_t        t0;
+    UINT16          mtu;
+
+    memset(p_cb, 0, sizeof(*p_cb));
+    p_cb->total = p_opts->count;
+    p_cb->size = p_opts->size ? p_opts->size : BENCH_ACL_DEFAULT_SIZE;
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"count\":%u,\"size\":%u,\"links\":%u,\"chans\":%u",
+             p_opts->count, p_cb->size, p_opts->links, p_opts->chans);
+
+    if (bench_scen_open(bench_scen_cb.sink_psm, p_opts->links, p_opts->chans,
+                        p_opts->timeout_ms) != num_chans)
+    {
+        bench_fail(p_res, "opened fewer than %u channels", num_chans);
+        bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+        return;
+    }
+
+    mtu = bench_scen_min_mtu();
+    if ((p_cb->size < BENCH_IDX_LEN) || (p_cb->size > mtu))
+    {
+        bench_fail(p_res, "size must be %u to %u", BENCH_IDX_LEN, mtu);
+        bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+        return;
+    }
+
+    p_cb->p_sent_ns = (uint64_t *)calloc(p_cb->total, sizeof(uint64_t));
+    p_res->p_samples_name = "latency_us";
+    p_cb->p_lat = &p_res->samples;
+    bench_samples_init(p_cb->p_lat, p_cb->total);
+    sem_init(&p_cb->done_sem, 0, 0);
+
+    bench_ctrl_set_sink(bench_tp_sink);
+    bench_scen_cb.p_pump = bench_tp_pump;
+
+    t0 = bench_now_ns();
+    p_cb->pump_pending = TRUE;
+    bench_call(bench_tp_pump, NULL);
+
+    if (!bench_wait(&p_cb->done_sem, p_opts->timeout_ms))
+    {
+        bench_fail(p_res, "timed out with %u of %u received", p_cb->received, p_cb->total);
+        p_cb->t_last_rx = bench_now_ns();
+    }
+
+    bench_call_sync(bench_scen_sync, NULL);     /* let a pending pump run out */
+    bench_scen_cb.p_pump = NULL;
+    bench_ctrl_set_sink(NULL);
+
+    p_res->count = p_cb->received;
+    p_res->bytes = (uint64_t)p_cb->received * p_cb->size;
+    p_res->elapsed_ns = p_cb->t_last_rx - t0;
+
+    bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+    free(p_cb->p_sent_ns);
+    sem_destroy(&p_cb->done_sem);
+}
+
+/*******************************************************************************
+**  acl_mixed
+********************************************************************************/
+
+static void bench_mix_sink(UINT16 psm, UINT8 *p_data, UINT16 len)
+{
+    UINT32  slot;
+
+    if ((psm != BENCH_PSM_SINK) || bench_mix_cb.done || (len < BENCH_IDX_LEN))
+        return;
+
+    STREAM_TO_UINT32 (slot, p_data);
+    if ((slot >= BENCH_MAX_CHANNELS) || (len != bench_mix_cb.size[slot]))
+        return;
+
+    if (++bench_mix_cb.received == bench_mix_cb.total)
+    {
+        bench_mix_cb.t_last_rx = bench_now_ns();
+        bench_mix_cb.done = TRUE;
+        sem_post(&bench_mix_cb.done_sem);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_mix_pump
+**
+** Description      Keeps every channel backlogged: packets are queued round
+**                  robin on the channels that are not congested, a burst at
+**                  a time, so the order they leave in is up to the L2CAP
+**                  scheduler. Each payload carries the channel slot.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_mix_pump(void *p_data)
+{
+    tBENCH_CHAN *p_chan;
+    BT_HDR      *p_buf;
+    UINT8       *p;
+    UINT32      burst, tried;
+    UINT8       slot = 0;
+
+    bench_mix_cb.pump_pending = FALSE;
+
+    for (burst = 0; (burst < BENCH_PUMP_BURST) && !bench_mix_cb.done; burst++)
+    {
+        for (tried = 0; tried < BENCH_MAX_CHANNELS; tried++)
+        {
+            slot = bench_mix_cb.next_chan;
+            bench_mix_cb.next_chan = (bench_mix_cb.next_chan + 1) % BENCH_MAX_CHANNELS;
+            p_chan = &bench_scen_cb.chan[slot];
+            if (p_chan->in_use && (p_chan->state == BENCH_CHAN_OPEN) && !p_chan->congested)
+                break;
+        }
+        if (tried == BENCH_MAX_CHANNELS)
+            return;
+
+        if ((p_buf = bench_scen_getbuf(bench_mix_cb.size[slot])) == NULL)
+            break;
+        p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        UINT32_TO_STREAM (p, slot);
+        memset(p, 0x5a, bench_mix_cb.size[slot] - BENCH_IDX_LEN);
+
+        if (L2CA_DataWrite(p_chan->lcid, p_buf) != L2CAP_DW_SUCCESS)
+            p_chan->congested = TRUE;
+    }
+
+    if (!bench_mix_cb.done && !bench_mix_cb.pump_pending)
+    {
+        bench_mix_cb.pump_pending = TRUE;
+        bench_call(bench_mix_pump, NULL);
+    }
+}
+
+/* Takes the scheduler counters of every channel and the quota of its link,
+** in the BTU task */
+static void bench_mix_stats(void *p_data)
+{
+    tL2C_CCB    *p_ccb;
+    int         xx;
+
+    for (xx = 0; xx < BENCH_MAX_CHANNELS; xx++)
+    {
+        if (bench_scen_cb.chan[xx].in_use && (bench_scen_cb.chan[xx].state == BENCH_CHAN_OPEN) &&
+            ((p_ccb = l2cu_find_ccb_by_cid(NULL, bench_scen_cb.chan[xx].lcid)) != NULL))
+        {
+            bench_mix_cb.stats[xx] = p_ccb->tx_stats;
+            bench_mix_cb.quota[xx] = p_ccb->p_lcb->link_xmit_quota;
+        }
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_mix_report
+**
+** Description      Adds the counters of every channel to the result, and
+**                  Jain's fairness index of the bytes the channels sent:
+**                  (sum x)^2 / (n * sum x^2), 1 when they all sent as much,
+**                  1/n when one channel had the link to itself. Links with
+**                  a quota of their own are served by byte deficit, but
+**                  never past that quota, so links given one buffer more
+**                  than the others by the split of the controller buffers
+**                  send more: chan_link_quota shows the split.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_mix_report(UINT32 num_chans, tBENCH_RESULT *p_res)
+{
+    static const char * const names[] = {"chan_size", "chan_pkts", "chan_bytes", "chan_turns", "chan_blocked",
+                                         "chan_link_quota"};
+    char        list[128];
+    double      sum = 0, sum_sq = 0;
+    UINT32      xx, val;
+    int         kind, len;
+
+    for (kind = 0; kind < (int)(sizeof(names) / sizeof(names[0])); kind++)
+    {
+        for (xx = 0, len = 0; xx < num_chans; xx++)
+        {
+            switch (kind)
+            {
+                case 0:  val = bench_mix_cb.size[xx];           break;
+                case 1:  val = bench_mix_cb.stats[xx].pkts;     break;
+                case 2:  val = bench_mix_cb.stats[xx].bytes;    break;
+                case 3:  val = bench_mix_cb.stats[xx].turns;    break;
+                case 4:  val = bench_mix_cb.stats[xx].blocked;  break;
+                default: val = bench_mix_cb.quota[xx];          break;
+            }
+            len += snprintf(list + len, sizeof(list) - len, "%s%u", xx ? "," : "", val);
+        }
+        bench_extra(p_res, "\"%s\":[%s]", names[kind], list);
+    }
+
+    for (xx = 0; xx < num_chans; xx++)
+    {
+        sum += bench_mix_cb.stats[xx].bytes;
+        sum_sq += (double)bench_mix_cb.stats[xx].bytes * bench_mix_cb.stats[xx].bytes;
+    }
+    bench_extra(p_res, "\"fairness\":%.3f", (sum_sq > 0) ? (sum * sum) / (num_chans * sum_sq) : 0.0);
+}
+
+static void bench_scen_acl_mixed(const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res)
+{
+    tBENCH_MIX_CB   *p_cb = &bench_mix_cb;
+    UINT32          num_chans = p_opts->links * p_opts->chans;
+    UINT32          xx;
+    UINT16          size, mtu;
+    uint64_t        t0;
+
+    memset(p_cb, 0, sizeof(*p_cb));
+    p_cb->total = p_opts->count;
+    size = p_opts->size ? p_opts->size : BENCH_ACL_DEFAULT_SIZE;
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"count\":%u,\"size\":%u,\"links\":%u,\"chans\":%u,\"drr_quantum\":%u",
+             p_opts->count, size, p_opts->links, p_opts->chans, L2CAP_DRR_QUANTUM);
+
+    if (bench_scen_open(bench_scen_cb.sink_psm, p_opts->links, p_opts->chans,
+                        p_opts->timeout_ms) != num_chans)
+    {
+        bench_fail(p_res, "opened fewer than %u channels", num_chans);
+        bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+        return;
+    }
+
+    mtu = bench_scen_min_mtu();
+    if (((size >> (2 * (BENCH_MIX_SIZE_CLASSES - 1))) < BENCH_IDX_LEN) || (size > mtu))
+    {
+        bench_fail(p_res, "size must be %u to %u", BENCH_IDX_LEN << (2 * (BENCH_MIX_SIZE_CLASSES - 1)), mtu);
+        bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+        return;
+    }
+
+    /* the slots were taken link by link, chans channels each */
+    for (xx = 0; xx < num_chans; xx++)
+        p_cb->size[xx] = size >> (2 * ((xx % p_opts->chans) % BENCH_MIX_SIZE_CLASSES));
+
+    sem_init(&p_cb->done_sem, 0, 0);
+    bench_ctrl_set_sink(bench_mix_sink);
+    bench_scen_cb.p_pump = bench_mix_pump;
+
+    t0 = bench_now_ns();
+    p_cb->pump_pending = TRUE;
+    bench_call(bench_mix_pump, NULL);
+
+    if (!bench_wait(&p_cb->done_sem, p_opts->timeout_ms))
+    {
+        bench_fail(p_res, "timed out with %u of %u received", p_cb->received, p_cb->total);
+        p_cb->t_last_rx = bench_now_ns();
+        p_cb->done = TRUE;
+    }
+
+    bench_call_sync(bench_mix_stats, NULL);
+    bench_scen_cb.p_pump = NULL;
+    bench_ctrl_set_sink(NULL);
+
+    p_res->count = p_cb->received;
+    for (xx = 0; xx < num_chans; xx++)
+        p_res->bytes += p_cb->stats[xx].bytes;
+    p_res->elapsed_ns = p_cb->t_last_rx - t0;
+    bench_mix_report(num_chans, p_res);
+
+    bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+    sem_destroy(&p_cb->done_sem);
+}
+
+/*******************************************************************************
+**  l2cap_connect
+********************************************************************************/
+
+static void bench_scen_l2cap_connect(const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res)
+{
+    tBENCH_CHAN *p_anchor, *p_chan;
+    uint64_t    t0;
+    UINT32      xx;
+    int         yy;
+
+    snprintf(p_res->params, sizeof(p_res->params), "\"count\":%u", p_opts->count);
+
+    /* the first channel pages the peer and stays open, so the cycles that
+    ** follow measure L2CAP alone */
+    if (bench_scen_open(bench_scen_cb.echo_psm, 1, 1, p_opts->timeout_ms) != 1)
+    {
+        bench_fail(p_res, "warm-up connection failed");
+        bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+        return;
+    }
+    p_anchor = bench_scen_first_open();
+
+    p_res->p_samples_name = "connect_us";
+    p_res->p_samples2_name = "disconnect_us";
+    bench_samples_init(&p_res->samples, p_opts->count);
+    bench_samples_init(&p_res->samples2, p_opts->count);
+
+    t0 = bench_now_ns();
+    for (xx = 0; xx < p_opts->count; xx++)
+    {
+        if (bench_scen_open(bench_scen_cb.echo_psm, 1, 1, p_opts->timeout_ms) != 2)
+        {
+            bench_fail(p_res, "connection %u failed", xx);
+            break;
+        }
+        bench_samples_add(&p_res->samples, bench_scen_cb.last_open_ns);
+
+        for (yy = 0, p_chan = bench_scen_cb.chan; yy < BENCH_MAX_CHANNELS; yy++, p_chan++)
+        {
+            if (p_chan->in_use && (p_chan != p_anchor))
+                break;
+        }
+        if ((yy == BENCH_MAX_CHANNELS) || !bench_scen_close(p_chan->lcid, p_opts->timeout_ms))
+        {
+            bench_fail(p_res, "disconnection %u failed", xx);
+            break;
+        }
+        bench_samples_add(&p_res->samples2, bench_scen_cb.last_close_ns);
+        p_res->count++;
+    }
+    p_res->elapsed_ns = bench_now_ns() - t0;
+
+    bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+}
+
+/*******************************************************************************
+**  rfcomm_echo
+********************************************************************************/
+
+static void bench_rfc_mgmt_cback(UINT32 code, UINT16 handle)
+{
+    bench_rfc_cb.last_code = code;
+    sem_post(&bench_rfc_cb.evt_sem);
+}
+
+/*******************************************************************************
+**
+** Function         bench_rfc_send
+**
+** Description      Keeps window messages in flight. RFCOMM takes what fits
+**                  under its transmit high water mark, the rest of a message
+**                  goes when echoed data frees the queue.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_rfc_send(void *p_data)
+{
+    tBENCH_RFC_CB   *p_cb = &bench_rfc_cb;
+    UINT8           *p;
+    UINT16          len;
+
+    while ((p_cb->sent < p_cb->total) && (p_cb->sent - p_cb->done < p_cb->window) && !p_cb->tx_error)
+    {
+        if (p_cb->tx_off == 0)
+        {
+            p = p_cb->p_msg;
+            UINT32_TO_STREAM (p, p_cb->sent);
+            p_cb->p_sent_ns[p_cb->sent] = bench_now_ns();
+        }
+
+        if (PORT_WriteData(p_cb->handle, (char *)p_cb->p_msg + p_cb->tx_off,
+                           (UINT16)(p_cb->size - p_cb->tx_off), &len) != PORT_SUCCESS)
+        {
+            p_cb->tx_error = TRUE;
+            sem_post(&p_cb->done_sem);
+            return;
+        }
+
+        p_cb->tx_off += len;
+        if (p_cb->tx_off < p_cb->size)
+            return;
+        p_cb->tx_off = 0;
+        p_cb->sent++;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bench_rfc_data_cback
+**
+** Description      Echoed data. RFCOMM is a byte stream, so messages are
+**                  counted off by size rather than taken per callback.
+**
+** Returns          0
+**
+*******************************************************************************/
+static int bench_rfc_data_cback(UINT16 handle, void *p_data, UINT16 len)
+{
+    tBENCH_RFC_CB   *p_cb = &bench_rfc_cb;
+    uint64_t        now = bench_now_ns();
+
+    p_cb->rx_bytes += len;
+    while ((p_cb->done < p_cb->sent) && (p_cb->rx_bytes >= (uint64_t)(p_cb->done + 1) * p_cb->size))
+    {
+        bench_samples_add(p_cb->p_rtt, now - p_cb->p_sent_ns[p_cb->done]);
+        p_cb->done++;
+    }
+
+    if (p_cb->done == p_cb->total)
+        sem_post(&p_cb->done_sem);
+    else
+        bench_rfc_send(NULL);
+    return 0;
+}
+
+static void bench_rfc_open(void *p_data)
+{
+    BD_ADDR bd_addr;
+
+    BENCH_PEER_ADDR(bd_addr, 0);
+    if (RFCOMM_CreateConnection(UUID_SERVCLASS_SERIAL_PORT, BENCH_RFC_SCN, FALSE, BENCH_RFC_MTU,
+                                bd_addr, &bench_rfc_cb.handle, bench_rfc_mgmt_cback) != PORT_SUCCESS)
+    {
+        bench_rfc_cb.last_code = PORT_UNKNOWN_ERROR;
+        sem_post(&bench_rfc_cb.evt_sem);
+        return;
+    }
+    PORT_SetDataCallback(bench_rfc_cb.handle, bench_rfc_data_cback);
+}
+
+static void bench_rfc_close(void *p_data)
+{
+    RFCOMM_RemoveConnection(bench_rfc_cb.handle);
+}
+
+static void bench_scen_rfcomm_echo(const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res)
+{
+    tBENCH_RFC_CB   *p_cb = &bench_rfc_cb;
+    uint64_t        t0;
+
+    memset(p_cb, 0, sizeof(*p_cb));
+    p_cb->total = p_opts->count;
+    p_cb->window = p_opts->window;
+    p_cb->size = p_opts->size ? p_opts->size : BENCH_RFC_DEFAULT_SIZE;
+    snprintf(p_res->params, sizeof(p_res->params), "\"count\":%u,\"size\":%u,\"window\":%u",
+             p_opts->count, p_cb->size, p_opts->window);
+
+    if ((p_cb->size < BENCH_IDX_LEN) || (p_cb->size > BENCH_RFC_MTU))
+    {
+        bench_fail(p_res, "size must be %u to %u", BENCH_IDX_LEN, BENCH_RFC_MTU);
+        return;
+    }
+
+    sem_init(&p_cb->evt_sem, 0, 0);
+    sem_init(&p_cb->done_sem, 0, 0);
+
+    bench_call(bench_rfc_open, NULL);
+    if (!bench_wait(&p_cb->evt_sem, p_opts->timeout_ms) || (p_cb->last_code != PORT_SUCCESS))
+    {
+        bench_fail(p_res, "connection failed (%u)", p_cb->last_code);
+        bench_call_sync(bench_rfc_close, NULL);
+        goto done;
+    }
+
+    p_cb->p_msg = (UINT8 *)malloc(p_cb->size);
+    memset(p_cb->p_msg, 0x5a, p_cb->size);
+    p_cb->p_sent_ns = (uint64_t *)calloc(p_cb->total, sizeof(uint64_t));
+    p_res->p_samples_name = "rtt_us";
+    p_cb->p_rtt = &p_res->samples;
+    bench_samples_init(p_cb->p_rtt, p_cb->total);
+
+    t0 = bench_now_ns();
+    bench_call(bench_rfc_send, NULL);
+    if (!bench_wait(&p_cb->done_sem, p_opts->timeout_ms))
+        bench_fail(p_res, "timed out with %u of %u echoed", p_cb->done, p_cb->total);
+    else if (p_cb->tx_error)
+        bench_fail(p_res, "write failed after %u messages", p_cb->sent);
+    p_res->elapsed_ns = bench_now_ns() - t0;
+
+    bench_call_sync(bench_rfc_close, NULL);
+    bench_wait(&p_cb->evt_sem, BENCH_SECS_CLOSE * 1000);
+
+    p_res->count = p_cb->done;
+    p_res->bytes = (uint64_t)p_cb->done * p_cb->size;
+
+    free(p_cb->p_msg);
+    free(p_cb->p_sent_ns);
+
+done:
+    sem_destroy(&p_cb->evt_sem);
+    sem_destroy(&p_cb->done_sem);
+}
+
+/*******************************************************************************
+**  a2dp_encode_send
+********************************************************************************/
+
+static void bench_a2dp_sink(UINT16 psm, UINT8 *p_data, UINT16 len)
+{
+    uint64_t    now = bench_now_ns();
+    UINT8       *p = p_data + BENCH_RTP_SSRC_OFFSET;
+    UINT32      idx;
+
+    if ((psm != BENCH_PSM_SINK) || (len < BENCH_RTP_HDR_LEN + BENCH_SBC_HDR_LEN))
+        return;
+
+    BE_STREAM_TO_UINT32 (idx, p);
+    if (idx >= bench_a2dp_cb.total)
+        return;
+
+    bench_samples_add(bench_a2dp_cb.p_lat, now - bench_a2dp_cb.p_sent_ns[idx]);
+    sem_post(&bench_a2dp_cb.win_sem);
+    if (++bench_a2dp_cb.received == bench_a2dp_cb.total)
+    {
+        bench_a2dp_cb.t_last_rx = now;
+        sem_post(&bench_a2dp_cb.done_sem);
+    }
+}
+
+static void bench_a2dp_write(void *p_data)
+{
+    if (bench_a2dp_cb.p_chan->in_use)
+        bench_scen_write(bench_a2dp_cb.p_chan, (BT_HDR *)p_data);
+    else
+        GKI_freebuf(p_data);
+}
+
+/*******************************************************************************
+**
+** Function         bench_a2dp_feed
+**
+** Description      Fills the encoder input with one frame of stereo PCM: a
+**                  sawtooth on the left, noise on the right.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_a2dp_feed(SBC_ENC_PARAMS *p_enc, UINT32 *p_seed, UINT32 *p_phase)
+{
+    SINT16  *p_pcm = p_enc->as16PcmBuffer;
+    int     xx;
+
+    for (xx = 0; xx < BENCH_SBC_SAMPLES_PER_FRAME; xx++)
+    {
+        *p_seed = *p_seed * 1103515245 + 12345;
+        *p_phase += 0x0280;
+        *p_pcm++ = (SINT16)(*p_phase & 0xFFFF);
+        *p_pcm++ = (SINT16)(*p_seed >> 18);
+    }
+}
+
+static void bench_scen_a2dp_encode_send(const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res)
+{
+    tBENCH_A2DP_CB  *p_cb = &bench_a2dp_cb;
+    SBC_ENC_PARAMS  *p_enc;
+    BT_HDR          *p_buf;
+    UINT8           *p, *p_frames;
+    uint64_t        t0, t_enc, audio_ns;
+    UINT32          idx, seed = 1, phase = 0, timestamp = 0;
+    UINT16          mtu, frame_len, num_frames, xx;
+
+    memset(p_cb, 0, sizeof(*p_cb));
+    p_cb->total = p_opts->count;
+
+    if (bench_scen_open(bench_scen_cb.sink_psm, 1, 1, p_opts->timeout_ms) != 1)
+    {
+        snprintf(p_res->params, sizeof(p_res->params), "\"count\":%u", p_opts->count);
+        bench_fail(p_res, "channel open failed");
+        bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+        return;
+    }
+    p_cb->p_chan = bench_scen_first_open();
+    mtu = p_cb->p_chan->peer_mtu;
+
+    /* 44.1 kHz joint stereo, 8 subbands, 16 blocks, loudness: the A2DP
+    ** high quality settings */
+    p_enc = (SBC_ENC_PARAMS *)calloc(1, sizeof(SBC_ENC_PARAMS));
+    p_enc->s16SamplingFreq = SBC_sf44100;
+    p_enc->s16ChannelMode = SBC_JOINT_STEREO;
+    p_enc->s16NumOfSubBands = 8;
+    p_enc->s16NumOfBlocks = 16;
+    p_enc->s16AllocationMethod = SBC_LOUDNESS;
+    p_enc->u16BitRate = BENCH_SBC_BITRATE;
+    SBC_Encoder_Init(p_enc);
+
+    /* the size of a frame decides how many fit in the MTU */
+    frame_len = 4 + (4 * 8 * 2) / 8 + (8 + 16 * p_enc->s16BitPool + 7) / 8;
+    num_frames = (mtu - BENCH_RTP_HDR_LEN - BENCH_SBC_HDR_LEN) / frame_len;
+    if (num_frames > BENCH_SBC_MAX_FRAMES)
+        num_frames = BENCH_SBC_MAX_FRAMES;
+
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"count\":%u,\"window\":%u,\"bitpool\":%d,\"frames_per_packet\":%u,\"mtu\":%u",
+             p_opts->count, p_opts->window, p_enc->s16BitPool, num_frames, mtu);
+    if (num_frames == 0)
+    {
+        bench_fail(p_res, "MTU %u too small for a frame", mtu);
+        free(p_enc);
+        bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+        return;
+    }
+
+    p_cb->p_sent_ns = (uint64_t *)calloc(p_cb->total, sizeof(uint64_t));
+    p_res->p_samples_name = "latency_us";
+    p_cb->p_lat = &p_res->samples;
+    bench_samples_init(p_cb->p_lat, p_cb->total);
+    p_res->p_samples2_name = "encode_us";
+    bench_samples_init(&p_res->samples2, p_cb->total);
+    sem_init(&p_cb->win_sem, 0, p_opts->window);
+    sem_init(&p_cb->done_sem, 0, 0);
+    bench_ctrl_set_sink(bench_a2dp_sink);
+
+    t0 = bench_now_ns();
+    for (idx = 0; idx < p_cb->total; idx++)
+    {
+        if (!bench_wait(&p_cb->win_sem, p_opts->timeout_ms))
+            break;
+        if ((p_buf = bench_scen_getbuf(BENCH_RTP_HDR_LEN + BENCH_SBC_HDR_LEN +
+                                       num_frames * frame_len)) == NULL)
+            break;
+
+        p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+        UINT8_TO_BE_STREAM (p, 0x80);                   /* RTP version 2 */
+        UINT8_TO_BE_STREAM (p, 0x60);                   /* dynamic payload type */
+        UINT16_TO_BE_STREAM (p, (UINT16)idx);
+        UINT32_TO_BE_STREAM (p, timestamp);
+        UINT32_TO_BE_STREAM (p, idx);                   /* SSRC carries the index */
+        UINT8_TO_BE_STREAM (p, (UINT8)num_frames);
+        timestamp += num_frames * BENCH_SBC_SAMPLES_PER_FRAME;
+
+        p_frames = p;
+        t_enc = 0;
+        for (xx = 0; xx < num_frames; xx++)
+        {
+            bench_a2dp_feed(p_enc, &seed, &phase);
+            p_enc->pu8Packet = p;
+            t_enc -= bench_now_ns();
+            SBC_Encoder(p_enc);
+            t_enc += bench_now_ns();
+            p += p_enc->u16PacketLength;
+        }
+        p_buf->len = (UINT16)(BENCH_RTP_HDR_LEN + BENCH_SBC_HDR_LEN + (p - p_frames));
+        bench_samples_add(&p_res->samples2, t_enc);
+
+        p_cb->p_sent_ns[idx] = bench_now_ns();
+        bench_call(bench_a2dp_write, p_buf);
+    }
+
+    if (!bench_wait(&p_cb->done_sem, p_opts->timeout_ms))
+    {
+        bench_fail(p_res, "timed out with %u of %u received", p_cb->received, p_cb->total);
+        p_cb->t_last_rx = bench_now_ns();
+    }
+    bench_ctrl_set_sink(NULL);
+
+    p_res->count = p_cb->received;
+    p_res->bytes = (uint64_t)p_cb->received * num_frames * frame_len;
+    p_res->elapsed_ns = p_cb->t_last_rx - t0;
+
+    /* how much faster than real time the audio went out */
+    audio_ns = (uint64_t)p_cb->received * num_frames * BENCH_SBC_SAMPLES_PER_FRAME *
+               BENCH_NS_PER_SEC / BENCH_SBC_SAMPLE_RATE;
+    if (p_res->elapsed_ns)
+    {
+        snprintf(p_res->extra, sizeof(p_res->extra), "\"realtime_factor\":%.1f",
+                 (double)audio_ns / p_res->elapsed_ns);
+    }
+
+    bench_scen_close(0, BENCH_SECS_CLOSE * 1000);
+    free(p_enc);
+    free(p_cb->p_sent_ns);
+    sem_destroy(&p_cb->win_sem);
+    sem_destroy(&p_cb->done_sem);
+}
+
+/*******************************************************************************
+**  inquiry
+********************************************************************************/
+
+static void bench_inq_results_cback(tBTM_INQ_RESULTS *p_inq, UINT8 *p_eir)
+{
+    bench_inq_cb.results++;
+}
+
+static void bench_inq_cmpl_cback(void *p1)
+{
+    sem_post(&bench_inq_cb.done_sem);
+}
+
+static void bench_inq_start(void *p_data)
+{
+    tBTM_INQ_PARMS  parms;
+
+    memset(&parms, 0, sizeof(parms));
+    parms.mode = BTM_GENERAL_INQUIRY;
+    parms.duration = BTM_DEFAULT_INQ_DUR;
+    parms.max_resps = 0;
+    parms.filter_cond_type = BTM_CLR_INQUIRY_FILTER;
+
+    bench_inq_cb.results = 0;
+    bench_inq_cb.status = BTM_StartInquiry(&parms, bench_inq_results_cback, bench_inq_cmpl_cback);
+}
+
+/*******************************************************************************
+**
+** Function         bench_inq_lookup
+**
+** Description      Reads every responder back from the inquiry database. The
+**                  database keeps the BTM_INQ_DB_SIZE devices that answered
+**                  last.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_inq_lookup(void *p_data)
+{
+    tBENCH_INQ_CB   *p_cb = &bench_inq_cb;
+    UINT32          first_recent = 1;
+    uint64_t        t0;
+    BD_ADDR         bda;
+    UINT16          idx;
+
+    if (p_cb->num_peers > BTM_INQ_DB_SIZE)
+        first_recent = p_cb->num_peers - BTM_INQ_DB_SIZE + 1;
+
+    p_cb->found = 0;
+    p_cb->found_recent = 0;
+
+    t0 = bench_now_ns();
+    for (idx = 1; idx <= p_cb->num_peers; idx++)
+    {
+        BENCH_INQ_ADDR(bda, idx);
+        if (BTM_InqDbRead(bda) != NULL)
+        {
+            p_cb->found++;
+            if (idx >= first_recent)
+                p_cb->found_recent++;
+        }
+    }
+    p_cb->lookup_ns = bench_now_ns() - t0;
+}
+
+static void bench_scen_inquiry(const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res)
+{
+    tBENCH_INQ_CB   *p_cb = &bench_inq_cb;
+    UINT32          expected;
+    uint64_t        t0, t_inq;
+    int             round;
+
+    memset(p_cb, 0, sizeof(*p_cb));
+    p_cb->num_peers = (p_opts->count > 0xFFFF) ? 0xFFFF : (UINT16)p_opts->count;
+    expected = (p_cb->num_peers < BTM_INQ_DB_SIZE) ? p_cb->num_peers : BTM_INQ_DB_SIZE;
+    sem_init(&p_cb->done_sem, 0, 0);
+
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"devices\":%u,\"inquiries\":%d,\"inq_db_size\":%d",
+             p_cb->num_peers, BENCH_INQ_ROUNDS, BTM_INQ_DB_SIZE);
+
+    bench_ctrl_set_inq_peers(p_cb->num_peers);
+
+    p_res->p_samples_name = "inquiry_us";
+    bench_samples_init(&p_res->samples, BENCH_INQ_ROUNDS);
+
+    t0 = bench_now_ns();
+    for (round = 0; round < BENCH_INQ_ROUNDS; round++)
+    {
+        t_inq = bench_now_ns();
+        bench_call_sync(bench_inq_start, NULL);
+        if (p_cb->status != BTM_CMD_STARTED)
+        {
+            bench_fail(p_res, "inquiry %d not started: %d", round, p_cb->status);
+            break;
+        }
+        if (!bench_wait(&p_cb->done_sem, p_opts->timeout_ms))
+        {
+            bench_fail(p_res, "inquiry %d timed out", round);
+            break;
+        }
+        bench_samples_add(&p_res->samples, bench_now_ns() - t_inq);
+
+        if (p_cb->results != p_cb->num_peers)
+        {
+            bench_fail(p_res, "inquiry %d: %u results of %u", round, p_cb->results, p_cb->num_peers);
+            break;
+        }
+        p_res->count += p_cb->results;
+    }
+    p_res->elapsed_ns = bench_now_ns() - t0;
+
+    if (strcmp(p_res->p_status, "failed") != 0)
+    {
+        bench_call_sync(bench_inq_lookup, NULL);
+        bench_extra(p_res, "\"lookup_ns\":%.1f,\"found\":%u",
+                    p_cb->num_peers ? (double)p_cb->lookup_ns / p_cb->num_peers : 0.0, p_cb->found);
+
+        if ((p_cb->found != expected) || (p_cb->found_recent != expected))
+            bench_fail(p_res, "%u devices in the inquiry database, %u of the last ones, %u expected",
+                       p_cb->found, p_cb->found_recent, expected);
+    }
+
+    bench_ctrl_set_inq_peers(0);
+    sem_destroy(&p_cb->done_sem);
+}
+
+/*******************************************************************************
+**  gatt_read_storm
+********************************************************************************/
+
+static void bench_scen_gatt_read_storm(const tBENCH_OPTS *p_opts, tBENCH_RESULT *p_res)
+{
+    snprintf(p_res->params, sizeof(p_res->params), "\"count\":%u", p_opts->count);
+
+    /* the simulated controller is BR/EDR only; GATT needs an LE link */
+    p_res->p_status = "skipped";
+#if (BLE_INCLUDED == TRUE)
+    snprintf(p_res->reason, sizeof(p_res->reason), "no LE support in the simulated controller");
+#else
+    snprintf(p_res->reason, sizeof(p_res->reason), "BLE_INCLUDED is FALSE");
+#endif
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+const tBENCH_SCENARIO bench_scenarios[] =
+{
+    {"acl_throughput",   bench_scen_acl_throughput,
+     "one way L2CAP data over -L links x -C channels, latency to the controller"},
+    {"acl_mixed",        bench_scen_acl_mixed,
+     "backlogged -L links x -C channels of mixed PDU sizes, bytes per channel"},
+    {"l2cap_connect",    bench_scen_l2cap_connect,
+     "L2CAP connect and disconnect cycles on an established link"},
+    {"rfcomm_echo",      bench_scen_rfcomm_echo,
+     "RFCOMM round trips through an echoing peer, -w in flight"},
+    {"a2dp_encode_send", bench_scen_a2dp_encode_send,
+     "SBC encode and send of RTP media packets, -w in flight"},
+    {"inquiry",          bench_scen_inquiry,
+     "inquiries answered by -n devices, then every device read back"},
+    {"gatt_read_storm",  bench_scen_gatt_read_storm,
+     "GATT reads (needs BLE_INCLUDED)"},
+    {NULL, NULL, NULL}
+};
+
+/*******************************************************************************
+**
+** Function         bench_scen_init_stack
+**
+** Description      Registers the PSMs of the scenarios, and RFCOMM without
+**                  security. The L2CAP PSMs are outgoing only, so their
+**                  security is set up with each connection.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bench_scen_init_stack(void *p_data)
+{
+    BOOLEAN *p_ok = (BOOLEAN *)p_data;
+
+    bench_scen_cb.echo_psm = L2CA_Register(BENCH_PSM_ECHO, (tL2CAP_APPL_INFO *)&bench_scen_l2c_appl);
+    bench_scen_cb.sink_psm = L2CA_Register(BENCH_PSM_SINK, (tL2CAP_APPL_INFO *)&bench_scen_l2c_appl);
+
+    *p_ok = (bench_scen_cb.echo_psm != 0) && (bench_scen_cb.sink_psm != 0) &&
+            BTM_SetSecurityLevel(TRUE, "", BTM_SEC_SERVICE_SERIAL_PORT, BTM_SEC_NONE,
+                                 BT_PSM_RFCOMM, BTM_SEC_PROTO_RFCOMM, BENCH_RFC_SCN);
+}
+
+/*******************************************************************************
+**
+** Function         bench_scen_init
+**
+** Description      Sets up what the scenarios share. Called in the bench task
+**                  once the controller is reset.
+**
+** Returns          TRUE if successful
+**
+*******************************************************************************/
+BOOLEAN bench_scen_init(void)
+{
+    BOOLEAN ok = FALSE;
+
+    memset(&bench_scen_cb, 0, sizeof(bench_scen_cb));
+    sem_init(&bench_scen_cb.open_sem, 0, 0);
+    sem_init(&bench_scen_cb.close_sem, 0, 0);
+
+    bench_call_sync(bench_scen_init_stack, &ok);
+    return ok;
+}
@@ -0,0 +1,551 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      ble_rpa_bench.c
+ *
+ *  Description:   LE private address resolution benchmark
+ *
+ *                 Replays advertising reports from bonded devices and from
+ *                 unknown ones, all with resolvable private addresses,
+ *                 through btm_ble_resolve_random_addr() as
+ *                 btm_ble_process_adv_pkt() does, against 500 bonded IRKs.
+ *                 Built from btm_ble_addr.c, smp_api.c and smp_aes.c, the
+ *                 last included here to run the software cipher and the
+ *                 one smp_aes_init() picks for this CPU in turn.
+ *
+ *                 per_record  The resolver btm_ble_addr.c had before the
+ *                             RPA cache and IRK table: SMP_Encrypt() once
+ *                             per security record, kept as the reference
+ *                 replay      The advertisers in range, taken at random
+ *                             from the bonded and the unknown ones, each
+ *                             reporting in turn at random, one of them
+ *                             taking a new address every -r reports
+ *                 fresh       A new address in every report: every one is
+ *                             matched against the IRK table
+ *
+ *                 Each report is checked against the record of the device
+ *                 that made its address; a mismatch fails the case.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include "bench_report.h"
+#include "btm_int.h"
+
+/* The cipher under test, with its static backends and dispatch */
+#include "smp_aes.c"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BRB_DEFAULT_REPORTS     20000
+#define BRB_DEFAULT_IRKS        500
+#define BRB_DEFAULT_UNKNOWN     100
+#define BRB_DEFAULT_ROTATE      1000
+#define BRB_DEFAULT_IN_RANGE    32
+#define BRB_MAX_UNKNOWN         4096
+
+/* the two MSB of a resolvable private address */
+#define BRB_RPA_TYPE            0x40
+#define BRB_RPA_TYPE_MASK       0xC0
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef UINT16 (tBRB_RESOLVER) (BD_ADDR rpa);
+
+/* One of the ciphers smp_aes can dispatch to */
+typedef struct
+{
+    const char          *p_name;
+    tSMP_AES_ENCRYPT_FN *p_encrypt;
+    tSMP_AES_MULTI_FN   *p_encrypt_multi;
+} tBRB_BACKEND;
+
+typedef struct
+{
+    BT_OCTET16  irk;
+    BD_ADDR     rpa;                /* current address                        */
+    UINT16      rec_index;          /* BTM_SEC_MAX_DEVICE_RECORDS if unknown  */
+    BOOLEAN     seen;               /* current address reported already       */
+} tBRB_ADVERTISER;
+
+/* A report of the stream and the record it has to resolve to */
+typedef struct
+{
+    BD_ADDR     rpa;
+    UINT16      rec_index;
+} tBRB_REPORT;
+
+typedef struct
+{
+    /* settings */
+    UINT32          num_reports;
+    UINT16          num_irks;
+    UINT16          num_unknown;
+    UINT32          rotate;
+    UINT16          in_range;
+
+    UINT32          seed;
+    tBRB_BACKEND    backend[2];             /* software first */
+    int             num_backends;
+    const char      *p_hw_name;             /* as smp_aes_init() traces it */
+    tBRB_ADVERTISER *p_adv;
+    UINT16          *p_in_range;            /* advertisers of the replay */
+    tBRB_REPORT     *p_replay;
+    tBRB_REPORT     *p_fresh;
+    UINT32          replay_repeats;         /* reports of an address seen before */
+
+    /* the record the resolver called back with */
+    UINT16          match;
+} tBRB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBRB_CB brb_cb;
+
+/*******************************************************************************
+**  Stubs of what GKI, btm_ble_addr.c and smp_api.c take from the rest of the
+**  stack
+********************************************************************************/
+
+tBTM_CB btm_cb;
+tSMP_CB smp_cb;
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4) {}
+void LogMsg_5(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5) {}
+void LogMsg_6(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5, UINT32 p6) {}
+
+tBTM_SEC_DEV_REC *btm_find_dev(BD_ADDR bd_addr) { return NULL; }
+BOOLEAN btsnd_hcic_ble_rand(void *p_cmd_cplt_cback) { return FALSE; }
+BOOLEAN btsnd_hcic_ble_set_random_addr(BD_ADDR random_addr) { return FALSE; }
+BOOLEAN btsnd_hcic_ble_set_adv_enable(UINT8 adv_enable) { return FALSE; }
+BOOLEAN btsnd_hcic_ble_write_adv_params(UINT16 adv_int_min, UINT16 adv_int_max,
+                                        UINT8 adv_type, UINT8 addr_type_own,
+                                        UINT8 addr_type_dir, BD_ADDR direct_bda,
+                                        UINT8 channel_map, UINT8 adv_filter_policy)
+{
+    return FALSE;
+}
+void btu_start_timer(TIMER_LIST_ENT *p_tle, UINT16 type, UINT32 timeout) {}
+void btu_stop_timer(TIMER_LIST_ENT *p_tle) {}
+BOOLEAN L2CA_ConnectFixedChnl(UINT16 fixed_cid, BD_ADDR bd_addr) { return FALSE; }
+void smp_sm_event(tSMP_CB *p_cb, tSMP_EVENT event, void *p_data) {}
+void smp_l2cap_if_init(void) {}
+void smp_convert_string_to_tk(BT_OCTET16 tk, UINT32 passkey) {}
+
+/* smp_keys.c, which brings in the whole of SMP with it */
+BOOLEAN smp_encrypt_data(UINT8 *key, UINT8 key_len, UINT8 *plain_text, UINT8 pt_len,
+                         tSMP_ENC *p_out)
+{
+    UINT8 data[SMP_ENCRYT_DATA_SIZE];
+
+    if ((p_out == NULL) || (key_len != SMP_ENCRYT_KEY_SIZE))
+        return FALSE;
+
+    if (pt_len > SMP_ENCRYT_DATA_SIZE)
+        pt_len = SMP_ENCRYT_DATA_SIZE;
+
+    memset(data, 0, SMP_ENCRYT_DATA_SIZE);
+    memcpy(data, plain_text, pt_len);
+
+    smp_aes_encrypt_le(key, data, p_out->param_buf);
+
+    p_out->param_len = SMP_ENCRYT_KEY_SIZE;
+    p_out->status = HCI_SUCCESS;
+    p_out->opcode = HCI_BLE_ENCRYPT;
+    return TRUE;
+}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static UINT32 brb_rand(void)
+{
+    brb_cb.seed = brb_cb.seed * 1103515245 + 12345;
+    return brb_cb.seed >> 8;
+}
+
+/*******************************************************************************
+**
+** Function         brb_use
+**
+** Description      Makes smp_aes dispatch to the backend
+**
+** Returns          void
+**
+*******************************************************************************/
+static void brb_use(const tBRB_BACKEND *p_be)
+{
+    smp_aes_cb.p_encrypt = p_be->p_encrypt;
+    smp_aes_cb.p_encrypt_multi = p_be->p_encrypt_multi;
+    smp_aes_cb.p_name = p_be->p_name;
+}
+
+/*******************************************************************************
+**
+** Function         brb_new_rpa
+**
+** Description      Gives an advertiser a new resolvable private address:
+**                  random prand with 01 in its two MSB, then the 3 LSB of
+**                  ah(IRK, prand).
+**
+** Returns          void
+**
+*******************************************************************************/
+static void brb_new_rpa(tBRB_ADVERTISER *p_adv)
+{
+    UINT8   r_prime[BT_OCTET16_LEN], hash[BT_OCTET16_LEN];
+    UINT32  prand = brb_rand();
+
+    p_adv->rpa[0] = (UINT8)(((prand >> 16) & ~BRB_RPA_TYPE_MASK) | BRB_RPA_TYPE);
+    p_adv->rpa[1] = (UINT8)(prand >> 8);
+    p_adv->rpa[2] = (UINT8)prand;
+
+    /* LSB first, as smp_encrypt_data() takes it */
+    memset(r_prime, 0, BT_OCTET16_LEN);
+    r_prime[0] = p_adv->rpa[2];
+    r_prime[1] = p_adv->rpa[1];
+    r_prime[2] = p_adv->rpa[0];
+    smp_aes_encrypt_le(p_adv->irk, r_prime, hash);
+
+    p_adv->rpa[3] = hash[2];
+    p_adv->rpa[4] = hash[1];
+    p_adv->rpa[5] = hash[0];
+    p_adv->seen = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         brb_setup
+**
+** Description      Bonds the first num_irks advertisers, each with a security
+**                  record of an LE device with an IRK, then builds the replay
+**                  and fresh report streams.
+**
+** Returns          FALSE if out of memory
+**
+*******************************************************************************/
+static BOOLEAN brb_setup(void)
+{
+    tBTM_SEC_DEV_REC    *p_dev_rec;
+    tBRB_ADVERTISER     *p_adv;
+    UINT16              num_adv = brb_cb.num_irks + brb_cb.num_unknown;
+    UINT32              xx;
+    UINT16              yy, tmp;
+    int                 i;
+
+    brb_cb.p_adv = (tBRB_ADVERTISER *)calloc(num_adv, sizeof(tBRB_ADVERTISER));
+    brb_cb.p_in_range = (UINT16 *)malloc(num_adv * sizeof(UINT16));
+    brb_cb.p_replay = (tBRB_REPORT *)malloc(brb_cb.num_reports * sizeof(tBRB_REPORT));
+    brb_cb.p_fresh = (tBRB_REPORT *)malloc(brb_cb.num_reports * sizeof(tBRB_REPORT));
+    if (!brb_cb.p_adv || !brb_cb.p_in_range || !brb_cb.p_replay || !brb_cb.p_fresh)
+        return FALSE;
+
+    memset(&btm_cb, 0, sizeof(btm_cb));
+    btm_cb.trace_level = BT_TRACE_LEVEL_NONE;
+
+    for (xx = 0; xx < num_adv; xx++)
+    {
+        p_adv = &brb_cb.p_adv[xx];
+        for (i = 0; i < BT_OCTET16_LEN; i++)
+            p_adv->irk[i] = (UINT8)brb_rand();
+        p_adv->rec_index = BTM_SEC_MAX_DEVICE_RECORDS;
+
+        if (xx < brb_cb.num_irks)
+        {
+            p_dev_rec = &btm_cb.sec_dev_rec[xx];
+            p_dev_rec->sec_flags = BTM_SEC_IN_USE;
+            p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+            p_dev_rec->ble.key_type = BTM_LE_KEY_PID;
+            memcpy(p_dev_rec->ble.keys.irk, p_adv->irk, BT_OCTET16_LEN);
+            p_adv->rec_index = (UINT16)xx;
+        }
+        brb_new_rpa(p_adv);
+        brb_cb.p_in_range[xx] = (UINT16)xx;
+    }
+
+    /* the advertisers in range are the first of a shuffle */
+    for (yy = num_adv - 1; yy > 0; yy--)
+    {
+        i = brb_rand() % (yy + 1);
+        tmp = brb_cb.p_in_range[yy];
+        brb_cb.p_in_range[yy] = brb_cb.p_in_range[i];
+        brb_cb.p_in_range[i] = tmp;
+    }
+
+    brb_cb.replay_repeats = 0;
+    for (xx = 0; xx < brb_cb.num_reports; xx++)
+    {
+        if (xx && ((xx % brb_cb.rotate) == 0))
+            brb_new_rpa(&brb_cb.p_adv[brb_cb.p_in_range[brb_rand() % brb_cb.in_range]]);
+
+        p_adv = &brb_cb.p_adv[brb_cb.p_in_range[brb_rand() % brb_cb.in_range]];
+        memcpy(brb_cb.p_replay[xx].rpa, p_adv->rpa, BD_ADDR_LEN);
+        brb_cb.p_replay[xx].rec_index = p_adv->rec_index;
+        brb_cb.replay_repeats += p_adv->seen;
+        p_adv->seen = TRUE;
+    }
+
+    for (xx = 0; xx < brb_cb.num_reports; xx++)
+    {
+        p_adv = &brb_cb.p_adv[brb_rand() % num_adv];
+        brb_new_rpa(p_adv);
+        memcpy(brb_cb.p_fresh[xx].rpa, p_adv->rpa, BD_ADDR_LEN);
+        brb_cb.p_fresh[xx].rec_index = p_adv->rec_index;
+    }
+
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         brb_resolve_per_record
+**
+** Description      btm_ble_resolve_random_addr() as it was before resolved
+**                  addresses were cached and IRKs kept expanded: ah() with
+**                  SMP_Encrypt(), which expands the IRK each time, for one
+**                  security record after the other until one matches.
+**
+** Returns          index of the matching record, BTM_SEC_MAX_DEVICE_RECORDS
+**                  if none.
+**
+*******************************************************************************/
+static UINT16 brb_resolve_per_record(BD_ADDR rpa)
+{
+    tBTM_SEC_DEV_REC    *p_dev_rec;
+    UINT8               rand[3];
+    tSMP_ENC            output;
+    UINT16              xx;
+
+    /* use the 3 MSB of bd address as prand */
+    rand[0] = rpa[2];
+    rand[1] = rpa[1];
+    rand[2] = rpa[0];
+
+    for (xx = 0; xx < BTM_SEC_MAX_DEVICE_RECORDS; xx++)
+    {
+        p_dev_rec = &btm_cb.sec_dev_rec[xx];
+
+        if ((p_dev_rec->device_type == BT_DEVICE_TYPE_BLE) &&
+            (p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
+        {
+            SMP_Encrypt(p_dev_rec->ble.keys.irk, BT_OCTET16_LEN, &rand[0], 3, &output);
+
+            /* compare the hash with 3 LSB of bd address */
+            if ((output.param_buf[0] == rpa[5]) && (output.param_buf[1] == rpa[4]) &&
+                (output.param_buf[2] == rpa[3]))
+                return xx;
+        }
+    }
+    return BTM_SEC_MAX_DEVICE_RECORDS;
+}
+
+static void brb_resolve_cback(void *p_rec, void *p)
+{
+    brb_cb.match = p_rec ? (UINT16)((tBTM_SEC_DEV_REC *)p_rec - btm_cb.sec_dev_rec) :
+                           BTM_SEC_MAX_DEVICE_RECORDS;
+}
+
+/*******************************************************************************
+**
+** Function         brb_resolve_cached
+**
+** Description      Resolves as btm_ble_process_adv_pkt() does.
+**
+** Returns          index of the matching record, BTM_SEC_MAX_DEVICE_RECORDS
+**                  if none.
+**
+*******************************************************************************/
+static UINT16 brb_resolve_cached(BD_ADDR rpa)
+{
+    brb_cb.match = 0xFFFF;
+    btm_ble_resolve_random_addr(rpa, brb_resolve_cback, NULL);
+    return brb_cb.match;
+}
+
+/*******************************************************************************
+**
+** Function         brb_run
+**
+** Description      Resolves every report of a stream, from an empty RPA cache
+**                  and an IRK table to build.
+**
+** Returns          TRUE if every report resolved to its record
+**
+*******************************************************************************/
+static BOOLEAN brb_run(const char *p_case, const tBRB_BACKEND *p_be, tBRB_RESOLVER *p_resolve,
+                       const tBRB_REPORT *p_reports)
+{
+    tBENCH_RESULT   res;
+    UINT32          xx, resolved = 0;
+    UINT16          rec_index;
+    uint64_t        t0, t1;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params),
+             "\"case\":\"%s\",\"backend\":\"%s\",\"irks\":%u,\"unknown\":%u,"
+             "\"in_range\":%u,\"rotate\":%u",
+             p_case, p_be->p_name, brb_cb.num_irks, brb_cb.num_unknown,
+             (p_reports == brb_cb.p_fresh) ? (brb_cb.num_irks + brb_cb.num_unknown) : brb_cb.in_range,
+             (p_reports == brb_cb.p_fresh) ? 1 : brb_cb.rotate);
+    res.p_samples_name = "resolve_us";
+    bench_samples_init(&res.samples, brb_cb.num_reports);
+
+    brb_use(p_be);
+    btm_ble_irk_changed();
+
+    for (xx = 0; xx < brb_cb.num_reports; xx++)
+    {
+        t0 = bench_now_ns();
+        rec_index = (*p_resolve)((UINT8 *)p_reports[xx].rpa);
+        t1 = bench_now_ns();
+
+        bench_samples_add(&res.samples, t1 - t0);
+        res.elapsed_ns += t1 - t0;
+
+        if (rec_index != p_reports[xx].rec_index)
+        {
+            bench_fail(&res, "report %u resolved to record %u, not %u",
+                       xx, rec_index, p_reports[xx].rec_index);
+            break;
+        }
+        resolved += (rec_index < BTM_SEC_MAX_DEVICE_RECORDS);
+    }
+
+    res.count = xx;
+    bench_extra(&res, "\"resolved\":%u,\"repeats\":%u", resolved,
+                (p_reports == brb_cb.p_fresh) ? 0 : brb_cb.replay_repeats);
+    if (p_be->p_name == brb_cb.backend[1].p_name)
+        bench_extra(&res, "\"hw\":\"%s\"", brb_cb.p_hw_name);
+
+    bench_print_result(stdout, "ble_rpa", &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "ok") == 0);
+}
+
+static void brb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         advertising reports per case (default %d)\n"
+            "  -k count         bonded devices with an IRK (default %d, max %d)\n"
+            "  -u count         advertisers with an unknown IRK (default %d, max %d)\n"
+            "  -a count         advertisers in range in the replay (default %d)\n"
+            "  -r count         reports between two address changes in the replay\n"
+            "                   (default %d)\n",
+            p_prog, BRB_DEFAULT_REPORTS, BRB_DEFAULT_IRKS, BTM_SEC_MAX_DEVICE_RECORDS,
+            BRB_DEFAULT_UNKNOWN, BRB_MAX_UNKNOWN, BRB_DEFAULT_IN_RANGE, BRB_DEFAULT_ROTATE);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int opt, i, failed = 0;
+
+    brb_cb.num_reports = BRB_DEFAULT_REPORTS;
+    brb_cb.num_irks = BRB_DEFAULT_IRKS;
+    brb_cb.num_unknown = BRB_DEFAULT_UNKNOWN;
+    brb_cb.rotate = BRB_DEFAULT_ROTATE;
+    brb_cb.in_range = BRB_DEFAULT_IN_RANGE;
+
+    while ((opt = getopt(argc, argv, "n:k:u:a:r:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': brb_cb.num_reports = (UINT32)atoi(optarg); break;
+            case 'k': brb_cb.num_irks = (UINT16)atoi(optarg); break;
+            case 'u': brb_cb.num_unknown = (UINT16)atoi(optarg); break;
+            case 'a': brb_cb.in_range = (UINT16)atoi(optarg); break;
+            case 'r': brb_cb.rotate = (UINT32)atoi(optarg); break;
+            default:
+                brb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((brb_cb.num_reports == 0) || (brb_cb.num_irks == 0) ||
+        (brb_cb.num_irks > BTM_SEC_MAX_DEVICE_RECORDS) ||
+        (brb_cb.num_unknown > BRB_MAX_UNKNOWN) || (brb_cb.rotate == 0) ||
+        (brb_cb.in_range == 0) || (brb_cb.in_range > brb_cb.num_irks + brb_cb.num_unknown))
+    {
+        fprintf(stderr, "ble_rpa_bench: bad option value\n");
+        return 2;
+    }
+
+    GKI_init();
+    memset(&smp_cb, 0, sizeof(smp_cb));
+    smp_cb.trace_level = BT_TRACE_LEVEL_NONE;
+
+    /* the software cipher always, the one picked for this CPU if another */
+    smp_aes_init();
+    brb_cb.backend[0].p_name = "sw";
+    brb_cb.backend[0].p_encrypt = smp_aes_encrypt_sw;
+    brb_cb.backend[0].p_encrypt_multi = smp_aes_encrypt_multi_sw;
+    brb_cb.num_backends = 1;
+    if (smp_aes_cb.p_encrypt != smp_aes_encrypt_sw)
+    {
+        brb_cb.backend[1].p_name = "hw";
+        brb_cb.p_hw_name = smp_aes_cb.p_name;
+        brb_cb.backend[1].p_encrypt = smp_aes_cb.p_encrypt;
+        brb_cb.backend[1].p_encrypt_multi = smp_aes_cb.p_encrypt_multi;
+        brb_cb.num_backends = 2;
+    }
+
+    brb_cb.seed = 0x5EED;
+    brb_use(&brb_cb.backend[0]);
+    if (!brb_setup())
+    {
+        fprintf(stderr, "ble_rpa_bench: out of memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < brb_cb.num_backends; i++)
+    {
+        failed |= !brb_run("per_record", &brb_cb.backend[i], brb_resolve_per_record, brb_cb.p_replay);
+        failed |= !brb_run("replay", &brb_cb.backend[i], brb_resolve_cached, brb_cb.p_replay);
+        failed |= !brb_run("fresh", &brb_cb.backend[i], brb_resolve_cached, brb_cb.p_fresh);
+    }
+
+    free(brb_cb.p_adv);
+    free(brb_cb.p_in_range);
+    free(brb_cb.p_replay);
+    free(brb_cb.p_fresh);
+    return failed;
+}
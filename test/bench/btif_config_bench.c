@@ -0,0 +1,494 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      btif_config_bench.c
+ *
+ *  Description:   btif_config store benchmark
+ *
+ *                 Built from btif_config.c with its default settings, and
+ *                 with the command thread of btif_sock_thread.c replaced by
+ *                 a call from the benchmark. Each device count runs in its
+ *                 own directory, and each of its processes initializes the
+ *                 store once.
+ *
+ *                 set     bonded devices written, 8 values each
+ *                 get     values read back at random
+ *                 save    one device updated and saved at a time, as on
+ *                         every connection: latency of each save, and the
+ *                         bytes written to disk per save. No save may
+ *                         write the xml file.
+ *                 export  the xml file written by btif_config_export_xml()
+ *                 load    a new process loads the store again, and every
+ *                         value must read back as written
+ *                 migrate a new process loads the exported xml file, with
+ *                         the journal removed, as on the first start after
+ *                         an upgrade, and every value must read back
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <hardware/bluetooth.h>
+#include "bench_report.h"
+#include "btif_api.h"
+#include "btif_config.h"
+#include "btif_sock_thread.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BCB_MAX_DEVICES         1000
+#define BCB_DEFAULT_GETS        100000
+#define BCB_DEFAULT_SAVES       200
+#define BCB_VALUES_PER_DEVICE   8
+
+/* the store files, in the directory of the run (CFG_PATH is "./") */
+#define BCB_JOURNAL_FILE        "bt_config.journal"
+#define BCB_XML_FILE            "bt_config.xml"
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    btsock_cmd_cb   p_cmd_cb;
+    int             cmd_type;
+    BOOLEAN         cmd_posted;
+    UINT32          gets;
+    UINT32          saves;
+} tBCB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBCB_CB bcb_cb;
+static const int bcb_default_counts[] = {10, 100, 1000};
+
+/*******************************************************************************
+**  Trace stubs, btif_config.c traces nothing at level none
+********************************************************************************/
+
+UINT8 btif_trace_level = BT_TRACE_LEVEL_NONE;
+
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4) {}
+
+/*******************************************************************************
+**  Stubs of the btif socket thread, the command runs when bcb_run_cmd is called
+********************************************************************************/
+
+int btsock_thread_init()
+{
+    return TRUE;
+}
+
+int btsock_thread_create(btsock_signaled_cb callback, btsock_cmd_cb cmd_callback)
+{
+    bcb_cb.p_cmd_cb = cmd_callback;
+    return 0;
+}
+
+int btsock_thread_post_cmd(int handle, int cmd_type, const unsigned char* cmd_data,
+                           int data_size, uint32_t user_id)
+{
+    bcb_cb.cmd_type = cmd_type;
+    bcb_cb.cmd_posted = TRUE;
+    return TRUE;
+}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static void bcb_run_cmd(void)
+{
+    if (bcb_cb.cmd_posted)
+    {
+        bcb_cb.cmd_posted = FALSE;
+        bcb_cb.p_cmd_cb(-1, bcb_cb.cmd_type, 0, 0);
+    }
+}
+
+static void bcb_addr(int dev, char *p_addr)
+{
+    sprintf(p_addr, "00:1b:dc:00:%02x:%02x", (dev >> 8) & 0xff, dev & 0xff);
+}
+
+static long bcb_file_size(const char *p_name)
+{
+    struct stat st;
+
+    return (stat(p_name, &st) == 0) ? (long)st.st_size : 0;
+}
+
+static void bcb_params(tBENCH_RESULT *p_res, int devices)
+{
+    snprintf(p_res->params, sizeof(p_res->params), "\"devices\":%d", devices);
+}
+
+/*******************************************************************************
+**
+** Function         bcb_set_device
+**
+** Description      Writes the values a bonded device has, the link key and
+**                  timestamp derived from gen so they can be checked
+**
+** Returns          TRUE if every value was set
+**
+*******************************************************************************/
+static BOOLEAN bcb_set_device(int dev, int gen)
+{
+    char    addr[18], name[32];
+    UINT8   key[16];
+    int     xx, ok = TRUE;
+
+    bcb_addr(dev, addr);
+    sprintf(name, "Device %d", dev);
+    for (xx = 0; xx < (int)sizeof(key); xx++)
+        key[xx] = (UINT8)(dev * 31 + gen * 7 + xx);
+
+    ok &= btif_config_set_str("Remote", addr, "Name", name);
+    ok &= btif_config_set_int("Remote", addr, "Timestamp", 1380000000 + gen);
+    ok &= btif_config_set_int("Remote", addr, "DevClass", 0x240404);
+    ok &= btif_config_set_int("Remote", addr, "DevType", 1);
+    ok &= btif_config_set("Remote", addr, "LinkKey", (const char *)key, sizeof(key),
+                          BTIF_CFG_TYPE_BIN);
+    ok &= btif_config_set_int("Remote", addr, "LinkKeyType", 5);
+    ok &= btif_config_set_int("Remote", addr, "PinLength", 0);
+    ok &= btif_config_set_str("Remote", addr, "Service",
+                              "0000110b-0000-1000-8000-00805f9b34fb 0000111e-0000-1000-8000-00805f9b34fb");
+    return ok;
+}
+
+/*******************************************************************************
+**
+** Function         bcb_check_device
+**
+** Description      Reads back the timestamp and link key of a device
+**
+** Returns          TRUE if they are those of generation gen
+**
+*******************************************************************************/
+static BOOLEAN bcb_check_device(int dev, int gen)
+{
+    char    addr[18], key[16];
+    int     xx, ts = 0, bytes = sizeof(key), type = BTIF_CFG_TYPE_BIN;
+
+    bcb_addr(dev, addr);
+    if (!btif_config_get_int("Remote", addr, "Timestamp", &ts) || (ts != 1380000000 + gen))
+        return FALSE;
+    if (!btif_config_get("Remote", addr, "LinkKey", key, &bytes, &type) || (bytes != sizeof(key)))
+        return FALSE;
+    for (xx = 0; xx < (int)sizeof(key); xx++)
+    {
+        if ((UINT8)key[xx] != (UINT8)(dev * 31 + gen * 7 + xx))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* generation of the values of a device once the save case has run */
+static int bcb_final_gen(int dev, int devices)
+{
+    int saves = (int)bcb_cb.saves;
+
+    return (dev < saves % devices) ? (saves / devices + 2) : (saves / devices + 1);
+}
+
+/*******************************************************************************
+**
+** Function         bcb_run_write
+**
+** Description      Creates the store of the given number of devices and runs
+**                  the set, get and save cases on it. Runs in a child.
+**
+** Returns          process exit status
+**
+*******************************************************************************/
+static int bcb_run_write(int devices)
+{
+    tBENCH_RESULT   res;
+    char            name[48], addr[18], str[32];
+    uint64_t        start, t0;
+    long            journal_bytes;
+    int             dev, xx, ts, size, failed = 0;
+
+    /* set */
+    btif_config_init();
+    bench_result_init(&res);
+    bcb_params(&res, devices);
+    start = bench_now_ns();
+    for (dev = 0; dev < devices; dev++)
+    {
+        if (!bcb_set_device(dev, 1))
+            bench_fail(&res, "device %d not set", dev);
+        res.count += BCB_VALUES_PER_DEVICE;
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+    btif_config_save();
+    bcb_run_cmd();
+    snprintf(name, sizeof(name), "btif_config_set_%d", devices);
+    bench_print_result(stdout, name, &res);
+    failed |= (strcmp(res.p_status, "failed") == 0);
+
+    /* get */
+    bench_result_init(&res);
+    bcb_params(&res, devices);
+    srand(devices);
+    start = bench_now_ns();
+    for (xx = 0; xx < (int)bcb_cb.gets; xx++)
+    {
+        dev = rand() % devices;
+        bcb_addr(dev, addr);
+        size = sizeof(str);
+        if (!btif_config_get_int("Remote", addr, "Timestamp", &ts) ||
+            !btif_config_get_str("Remote", addr, "Name", str, &size))
+        {
+            bench_fail(&res, "device %d not found", dev);
+            break;
+        }
+        res.count += 2;
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+    snprintf(name, sizeof(name), "btif_config_get_%d", devices);
+    bench_print_result(stdout, name, &res);
+    failed |= (strcmp(res.p_status, "failed") == 0);
+
+    /* save */
+    bench_result_init(&res);
+    bcb_params(&res, devices);
+    res.p_samples_name = "save_us";
+    bench_samples_init(&res.samples, bcb_cb.saves);
+    journal_bytes = bcb_file_size(BCB_JOURNAL_FILE);
+    start = bench_now_ns();
+    for (xx = 0; xx < (int)bcb_cb.saves; xx++)
+    {
+        dev = xx % devices;
+        t0 = bench_now_ns();
+        if (!bcb_set_device(dev, xx / devices + 2))
+            bench_fail(&res, "device %d not set", dev);
+        btif_config_save();
+        bcb_run_cmd();
+        bench_samples_add(&res.samples, bench_now_ns() - t0);
+        res.count++;
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+    journal_bytes = bcb_file_size(BCB_JOURNAL_FILE) - journal_bytes;
+    if (access(BCB_XML_FILE, F_OK) == 0)
+        bench_fail(&res, "a save wrote %s", BCB_XML_FILE);
+    bench_extra(&res, "\"journal_bytes\":%ld,\"disk_bytes_per_save\":%ld",
+                bcb_file_size(BCB_JOURNAL_FILE),
+                (journal_bytes > 0 ? journal_bytes : 0) / (res.count ? (long)res.count : 1));
+    snprintf(name, sizeof(name), "btif_config_save_%d", devices);
+    bench_print_result(stdout, name, &res);
+    bench_samples_free(&res.samples);
+    failed |= (strcmp(res.p_status, "failed") == 0);
+
+    btif_config_flush();
+
+    /* export */
+    bench_result_init(&res);
+    bcb_params(&res, devices);
+    start = bench_now_ns();
+    if (!btif_config_export_xml())
+        bench_fail(&res, "export failed");
+    res.elapsed_ns = bench_now_ns() - start;
+    res.count = 1;
+    res.bytes = bcb_file_size(BCB_XML_FILE);
+    snprintf(name, sizeof(name), "btif_config_export_%d", devices);
+    bench_print_result(stdout, name, &res);
+    failed |= (strcmp(res.p_status, "failed") == 0);
+
+    return failed;
+}
+
+/*******************************************************************************
+**
+** Function         bcb_run_load
+**
+** Description      Loads the store written by bcb_run_write, from the journal
+**                  or, if migrate, from the exported xml file alone, and
+**                  checks every device. Runs in a child.
+**
+** Returns          process exit status
+**
+*******************************************************************************/
+static int bcb_run_load_from(int devices, BOOLEAN migrate)
+{
+    tBENCH_RESULT   res;
+    char            name[48];
+    uint64_t        start;
+    int             dev;
+
+    if (migrate)
+        unlink(BCB_JOURNAL_FILE);
+
+    bench_result_init(&res);
+    bcb_params(&res, devices);
+    start = bench_now_ns();
+    btif_config_init();
+    res.elapsed_ns = bench_now_ns() - start;
+    res.count = 1;
+    res.bytes = bcb_file_size(migrate ? BCB_XML_FILE : BCB_JOURNAL_FILE);
+    if (migrate && (access(BCB_JOURNAL_FILE, F_OK) != 0))
+        bench_fail(&res, "no journal written from %s", BCB_XML_FILE);
+
+    for (dev = 0; dev < devices; dev++)
+    {
+        if (!bcb_check_device(dev, bcb_final_gen(dev, devices)))
+        {
+            bench_fail(&res, "device %d does not read back", dev);
+            break;
+        }
+    }
+
+    snprintf(name, sizeof(name), "btif_config_%s_%d", migrate ? "migrate" : "load", devices);
+    bench_print_result(stdout, name, &res);
+    return (strcmp(res.p_status, "failed") == 0);
+}
+
+static int bcb_run_load(int devices)
+{
+    return bcb_run_load_from(devices, FALSE);
+}
+
+static int bcb_run_migrate(int devices)
+{
+    return bcb_run_load_from(devices, TRUE);
+}
+
+/*******************************************************************************
+**
+** Function         bcb_run
+**
+** Description      Runs the cases of one device count in a fresh directory,
+**                  in three child processes
+**
+** Returns          TRUE if they passed
+**
+*******************************************************************************/
+static BOOLEAN bcb_run(int devices)
+{
+    char    dir[] = "/tmp/btif_config_bench.XXXXXX";
+    char    cmd[64];
+    int     (*p_run[3])(int) = {bcb_run_write, bcb_run_load, bcb_run_migrate};
+    int     xx, status, failed = 0;
+    pid_t   pid;
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return FALSE;
+    }
+
+    for (xx = 0; xx < 3 && !failed; xx++)
+    {
+        fflush(stdout);
+        if ((pid = fork()) == 0)
+        {
+            if (chdir(dir) != 0)
+                _exit(1);
+            status = p_run[xx](devices);
+            fflush(stdout);
+            _exit(status);
+        }
+        if ((pid < 0) || (waitpid(pid, &status, 0) != pid) ||
+            !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+            failed = 1;
+    }
+
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0)
+        fprintf(stderr, "btif_config_bench: cannot remove %s\n", dir);
+    return !failed;
+}
+
+static void bcb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d count         bonded devices, repeatable (default 10, 100 and 1000, max %d)\n"
+            "  -g count         values read in the get case (default %d)\n"
+            "  -s count         saves in the save case (default %d)\n",
+            p_prog, BCB_MAX_DEVICES, BCB_DEFAULT_GETS, BCB_DEFAULT_SAVES);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int     counts[16];
+    int     num_counts = 0, opt, xx, failed = 0;
+
+    bcb_cb.gets = BCB_DEFAULT_GETS;
+    bcb_cb.saves = BCB_DEFAULT_SAVES;
+
+    while ((opt = getopt(argc, argv, "d:g:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                if (num_counts < (int)(sizeof(counts) / sizeof(counts[0])))
+                    counts[num_counts++] = atoi(optarg);
+                break;
+            case 'g': bcb_cb.gets = (UINT32)atoi(optarg); break;
+            case 's': bcb_cb.saves = (UINT32)atoi(optarg); break;
+            default:
+                bcb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (num_counts == 0)
+    {
+        for (xx = 0; xx < (int)(sizeof(bcb_default_counts) / sizeof(bcb_default_counts[0])); xx++)
+            counts[num_counts++] = bcb_default_counts[xx];
+    }
+
+    for (xx = 0; xx < num_counts; xx++)
+    {
+        if ((counts[xx] <= 0) || (counts[xx] > BCB_MAX_DEVICES))
+        {
+            fprintf(stderr, "btif_config_bench: bad option value\n");
+            return 2;
+        }
+    }
+
+    for (xx = 0; xx < num_counts; xx++)
+        failed |= !bcb_run(counts[xx]);
+
+    return failed;
+}
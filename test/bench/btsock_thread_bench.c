@@ -0,0 +1,493 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      btsock_thread_bench.c
+ *
+ *  Description:   btif socket poll thread stress test
+ *
+ *                 Built from btif_sock_thread.c. One poll thread watches
+ *                 the local end of up to 512 socket pairs, as it would the
+ *                 RFCOMM and L2CAP sockets of the apps.
+ *
+ *                 wake    every peer writes a timestamp, the callback
+ *                         reads it and re-arms the socket in the poll
+ *                         thread: rate, and latency from write to callback
+ *                 hangup  every peer is closed, each socket must be
+ *                         signaled once with SOCK_THREAD_FD_EXCEPTION and
+ *                         be taken out of the epoll set, then the sockets
+ *                         are opened again, on the same fds, and must be
+ *                         signaled with their new user id
+ *
+ ******************************************************************************/
+
+#include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <hardware/bluetooth.h>
+#include "bench_report.h"
+#include "bt_types.h"
+#include "btif_sock_thread.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BSTB_MAX_SOCKS          512
+#define BSTB_DEFAULT_SOCKS      512
+#define BSTB_DEFAULT_ROUNDS     200
+#define BSTB_WAIT_SEC           5
+
+/* user id of a socket, the generation in the upper bits */
+#define BSTB_USER_ID(gen, i)    (((gen) << 16) | (i))
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    int             fd[2];          /* [0] watched by the poll thread, [1] the peer */
+    uint32_t        user_id;
+    uint32_t        reads;
+    uint32_t        hangups;
+} tBSTB_SOCK;
+
+typedef struct
+{
+    int             h;
+    tBSTB_SOCK      sock[BSTB_MAX_SOCKS];
+    int             num_socks;
+    uint32_t        rounds;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    uint32_t        signaled;
+    uint32_t        unexpected;
+    tBENCH_SAMPLES  *p_samples;
+} tBSTB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBSTB_CB bstb_cb;
+
+/*******************************************************************************
+**  Trace stubs, btif_sock_thread.c traces nothing at level none
+********************************************************************************/
+
+UINT8 appl_trace_level = BT_TRACE_LEVEL_NONE;
+
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         bstb_signaled_cb
+**
+** Description      Poll thread callback. Reads the timestamps of a signaled
+**                  socket and re-arms it, or records its hangup.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bstb_signaled_cb(int fd, int type, int flags, uint32_t user_id)
+{
+    tBSTB_SOCK  *p_sock = NULL;
+    uint64_t    sent, now;
+    int         i = (int)(user_id & 0xffff);
+
+    if ((i < bstb_cb.num_socks) && (bstb_cb.sock[i].fd[0] == fd) &&
+        (bstb_cb.sock[i].user_id == user_id))
+        p_sock = &bstb_cb.sock[i];
+
+    pthread_mutex_lock(&bstb_cb.lock);
+    if (p_sock == NULL)
+    {
+        bstb_cb.unexpected++;
+    }
+    else if (flags & SOCK_THREAD_FD_EXCEPTION)
+    {
+        /* left open, so the check of the epoll set sees whether it was removed */
+        p_sock->hangups++;
+        bstb_cb.signaled++;
+    }
+    else if (flags & SOCK_THREAD_FD_RD)
+    {
+        now = bench_now_ns();
+        while (recv(fd, &sent, sizeof(sent), MSG_DONTWAIT) == sizeof(sent))
+        {
+            if (bstb_cb.p_samples != NULL)
+                bench_samples_add(bstb_cb.p_samples, now - sent);
+            p_sock->reads++;
+            bstb_cb.signaled++;
+        }
+        btsock_thread_add_fd(bstb_cb.h, fd, 0, SOCK_THREAD_FD_RD | SOCK_THREAD_ADD_FD_SYNC,
+                             user_id);
+    }
+    else
+    {
+        bstb_cb.unexpected++;
+    }
+    pthread_cond_signal(&bstb_cb.cond);
+    pthread_mutex_unlock(&bstb_cb.lock);
+}
+
+/*******************************************************************************
+**
+** Function         bstb_wait
+**
+** Description      Waits until the callbacks have signaled count events
+**
+** Returns          TRUE if they did in time
+**
+*******************************************************************************/
+static BOOLEAN bstb_wait(uint32_t count)
+{
+    struct timespec deadline;
+    int             err = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += BSTB_WAIT_SEC;
+    pthread_mutex_lock(&bstb_cb.lock);
+    while ((bstb_cb.signaled < count) && (err == 0))
+        err = pthread_cond_timedwait(&bstb_cb.cond, &bstb_cb.lock, &deadline);
+    pthread_mutex_unlock(&bstb_cb.lock);
+    return (err == 0);
+}
+
+/*******************************************************************************
+**
+** Function         bstb_epoll_count
+**
+** Description      Counts the fds in the epoll sets of the process, from
+**                  /proc/self/fdinfo
+**
+** Returns          the count, or -1 if it cannot be read
+**
+*******************************************************************************/
+static int bstb_epoll_count(void)
+{
+    DIR             *p_dir;
+    struct dirent   *p_ent;
+    FILE            *p_file;
+    char            path[300], link[64], line[128];
+    ssize_t         len;
+    int             count = -1;
+
+    if ((p_dir = opendir("/proc/self/fd")) == NULL)
+        return -1;
+    while ((p_ent = readdir(p_dir)) != NULL)
+    {
+        snprintf(path, sizeof(path), "/proc/self/fd/%s", p_ent->d_name);
+        if (((len = readlink(path, link, sizeof(link) - 1)) <= 0))
+            continue;
+        link[len] = 0;
+        if (strcmp(link, "anon_inode:[eventpoll]") != 0)
+            continue;
+        snprintf(path, sizeof(path), "/proc/self/fdinfo/%s", p_ent->d_name);
+        if ((p_file = fopen(path, "r")) == NULL)
+            continue;
+        if (count < 0)
+            count = 0;
+        while (fgets(line, sizeof(line), p_file) != NULL)
+        {
+            if (strncmp(line, "tfd:", 4) == 0)
+                count++;
+        }
+        fclose(p_file);
+    }
+    closedir(p_dir);
+    return count;
+}
+
+static void bstb_params(tBENCH_RESULT *p_res)
+{
+    snprintf(p_res->params, sizeof(p_res->params), "\"sockets\":%d,\"rounds\":%u",
+             bstb_cb.num_socks, bstb_cb.rounds);
+}
+
+/*******************************************************************************
+**
+** Function         bstb_open
+**
+** Description      Opens the socket pairs and adds them to the poll thread
+**
+** Returns          TRUE if they were all opened
+**
+*******************************************************************************/
+static BOOLEAN bstb_open(uint32_t gen)
+{
+    tBSTB_SOCK  *p_sock;
+    int         i;
+
+    for (i = 0; i < bstb_cb.num_socks; i++)
+    {
+        p_sock = &bstb_cb.sock[i];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, p_sock->fd) < 0)
+        {
+            perror("socketpair");
+            return FALSE;
+        }
+        p_sock->user_id = BSTB_USER_ID(gen, i);
+        p_sock->reads = p_sock->hangups = 0;
+        btsock_thread_add_fd(bstb_cb.h, p_sock->fd[0], 0, SOCK_THREAD_FD_RD, p_sock->user_id);
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         bstb_wake_round
+**
+** Description      Writes a timestamp into every peer and waits for the
+**                  callbacks
+**
+** Returns          TRUE if every socket was signaled
+**
+*******************************************************************************/
+static BOOLEAN bstb_wake_round(void)
+{
+    uint64_t    now;
+    uint32_t    target;
+    int         i;
+
+    pthread_mutex_lock(&bstb_cb.lock);
+    target = bstb_cb.signaled + bstb_cb.num_socks;
+    pthread_mutex_unlock(&bstb_cb.lock);
+
+    for (i = 0; i < bstb_cb.num_socks; i++)
+    {
+        now = bench_now_ns();
+        if (send(bstb_cb.sock[i].fd[1], &now, sizeof(now), 0) != sizeof(now))
+            return FALSE;
+    }
+    return bstb_wait(target);
+}
+
+/*******************************************************************************
+**
+** Function         bstb_run_wake
+**
+** Description      Runs the wake case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN bstb_run_wake(void)
+{
+    tBENCH_RESULT   res;
+    uint64_t        start;
+    uint32_t        round;
+    int             i;
+
+    bench_result_init(&res);
+    bstb_params(&res);
+    res.p_samples_name = "latency_us";
+    bench_samples_init(&res.samples, bstb_cb.rounds * bstb_cb.num_socks);
+
+    /* the first adds are queued to the poll thread, let them land first */
+    if (!bstb_wake_round())
+        bench_fail(&res, "sockets not signaled after they were added");
+
+    pthread_mutex_lock(&bstb_cb.lock);
+    bstb_cb.p_samples = &res.samples;
+    pthread_mutex_unlock(&bstb_cb.lock);
+
+    start = bench_now_ns();
+    for (round = 0; (round < bstb_cb.rounds) && (strcmp(res.p_status, "failed") != 0); round++)
+    {
+        if (!bstb_wake_round())
+            bench_fail(&res, "round %u timed out", round);
+        res.count += bstb_cb.num_socks;
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+
+    pthread_mutex_lock(&bstb_cb.lock);
+    bstb_cb.p_samples = NULL;
+    pthread_mutex_unlock(&bstb_cb.lock);
+
+    for (i = 0; i < bstb_cb.num_socks; i++)
+    {
+        if (bstb_cb.sock[i].reads != bstb_cb.rounds + 1)
+        {
+            bench_fail(&res, "socket %d read %u times", i, bstb_cb.sock[i].reads);
+            break;
+        }
+    }
+    if (bstb_cb.unexpected)
+        bench_fail(&res, "%u unexpected callbacks", bstb_cb.unexpected);
+
+    bench_print_result(stdout, "btsock_thread_wake", &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         bstb_run_hangup
+**
+** Description      Runs the hangup case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN bstb_run_hangup(void)
+{
+    tBENCH_RESULT   res;
+    uint64_t        start;
+    uint32_t        target;
+    int             i, left = -1;
+
+    bench_result_init(&res);
+    bstb_params(&res);
+
+    pthread_mutex_lock(&bstb_cb.lock);
+    target = bstb_cb.signaled + bstb_cb.num_socks;
+    pthread_mutex_unlock(&bstb_cb.lock);
+
+    start = bench_now_ns();
+    for (i = 0; i < bstb_cb.num_socks; i++)
+    {
+        close(bstb_cb.sock[i].fd[1]);
+        bstb_cb.sock[i].fd[1] = -1;
+    }
+    if (!bstb_wait(target))
+        bench_fail(&res, "hangups not signaled");
+    res.elapsed_ns = bench_now_ns() - start;
+    res.count = bstb_cb.num_socks;
+
+    for (i = 0; i < bstb_cb.num_socks; i++)
+    {
+        if (bstb_cb.sock[i].hangups != 1)
+        {
+            bench_fail(&res, "socket %d signaled %u hangups", i, bstb_cb.sock[i].hangups);
+            break;
+        }
+    }
+
+    /* only the cmd eventfd is left in the set, the sockets are still open */
+    left = bstb_epoll_count();
+    if (left != 1)
+        bench_fail(&res, "%d fds in the epoll set after the hangups", left);
+
+    for (i = 0; i < bstb_cb.num_socks; i++)
+        close(bstb_cb.sock[i].fd[0]);
+
+    /* new sockets on the same fds, each signaled once with its new user id */
+    if (!bstb_open(1) || !bstb_wake_round())
+        bench_fail(&res, "reopened sockets not signaled");
+    for (i = 0; i < bstb_cb.num_socks; i++)
+    {
+        if (bstb_cb.sock[i].reads != 1)
+        {
+            bench_fail(&res, "reopened socket %d read %u times", i, bstb_cb.sock[i].reads);
+            break;
+        }
+    }
+    if (bstb_cb.unexpected)
+        bench_fail(&res, "%u unexpected callbacks", bstb_cb.unexpected);
+
+    bench_extra(&res, "\"epoll_fds_left\":%d", left);
+    bench_print_result(stdout, "btsock_thread_hangup", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+static void bstb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         socket pairs (default %d, max %d)\n"
+            "  -r count         rounds of the wake case (default %d)\n",
+            p_prog, BSTB_DEFAULT_SOCKS, BSTB_MAX_SOCKS, BSTB_DEFAULT_ROUNDS);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    struct rlimit   rl;
+    int             opt, i, failed = 0;
+
+    bstb_cb.num_socks = BSTB_DEFAULT_SOCKS;
+    bstb_cb.rounds = BSTB_DEFAULT_ROUNDS;
+
+    while ((opt = getopt(argc, argv, "n:r:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': bstb_cb.num_socks = atoi(optarg); break;
+            case 'r': bstb_cb.rounds = (uint32_t)atoi(optarg); break;
+            default:
+                bstb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((bstb_cb.num_socks <= 0) || (bstb_cb.num_socks > BSTB_MAX_SOCKS))
+    {
+        fprintf(stderr, "btsock_thread_bench: bad option value\n");
+        return 2;
+    }
+
+    /* two fds a pair, above the usual soft limit of 1024 */
+    if ((getrlimit(RLIMIT_NOFILE, &rl) == 0) && (rl.rlim_cur < rl.rlim_max))
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    pthread_mutex_init(&bstb_cb.lock, NULL);
+    pthread_cond_init(&bstb_cb.cond, NULL);
+    btsock_thread_init();
+    if ((bstb_cb.h = btsock_thread_create(bstb_signaled_cb, NULL)) < 0)
+    {
+        fprintf(stderr, "btsock_thread_bench: cannot create the poll thread\n");
+        return 1;
+    }
+
+    if (!bstb_open(0))
+        return 1;
+    failed |= !bstb_run_wake();
+    failed |= !bstb_run_hangup();
+
+    btsock_thread_exit(bstb_cb.h);
+    for (i = 0; i < bstb_cb.num_socks; i++)
+    {
+        close(bstb_cb.sock[i].fd[0]);
+        close(bstb_cb.sock[i].fd[1]);
+    }
+    return failed;
+}
@@ -0,0 +1,642 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      gatt_db_bench.c
+ *
+ *  Description:   GATT server database benchmark
+ *
+ *                 Built twice, as gatt_db_indexed and gatt_db_list, from
+ *                 gatt_db.c with GATT_DB_INDEX_MAX_HDL at its default and
+ *                 at 0, which leaves every service on the attribute list.
+ *                 The database has 10 services of 100 attributes by
+ *                 default: a service declaration, an include, and
+ *                 characteristics with a client configuration, a quarter
+ *                 of them with 128 bits UUIDs.
+ *
+ *                 Requests go to the services in their range as gatt_sr.c
+ *                 sends them, and every response is checked against the
+ *                 attributes the benchmark added.
+ *
+ *                 read      Read Request of a random handle: the value of a
+ *                           declaration, or the read permission check of a
+ *                           value or descriptor, which goes to the app
+ *                 discover  Read By Type of the characteristic declarations
+ *                           over the whole range, continued as a client
+ *                           does until nothing is found
+ *                 by_type   Read By Type of a 128 bits characteristic over
+ *                           the whole range, which is sent to the app
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_report.h"
+#include "bt_target.h"
+#include "gki.h"
+#include "gatt_int.h"
+#include "l2c_api.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#if (GATT_DB_INDEX_MAX_HDL == 0)
+#define GDB_MODE                "list"
+#else
+#define GDB_MODE                "indexed"
+#endif
+
+#define GDB_DEFAULT_SERVICES    10
+#define GDB_DEFAULT_ATTRS       100         /* per service */
+#define GDB_DEFAULT_REQUESTS    100000
+#define GDB_DEFAULT_MTU         23
+#define GDB_MAX_SERVICES        GATT_MAX_SR_PROFILES
+#define GDB_MAX_ATTRS           4096        /* in all */
+#define GDB_MAX_RSP             512
+#define GDB_GATT_IF             1
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+/* an attribute as the benchmark added it */
+typedef struct
+{
+    UINT16          type;           /* 16 bits type, 0 for a 128 bits value */
+    UINT8           svc;
+    tBT_UUID        uuid;           /* service, included service or characteristic UUID */
+    UINT16          ref_handle;     /* value handle, or included service start */
+    UINT16          ref_end;        /* included service end */
+    UINT8           prop;
+} tGDB_ATTR;
+
+typedef struct
+{
+    /* settings */
+    int             num_svc;
+    int             attrs_per_svc;
+    UINT32          requests;
+    UINT16          mtu;
+
+    tGATT_SVC_DB    db[GDB_MAX_SERVICES];
+    tGDB_ATTR       attr[GDB_MAX_ATTRS + 1];    /* by handle */
+    UINT16          num_handles;
+
+    UINT16          app_read_handle;            /* last read sent to the app */
+} tGDB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tGDB_CB gdb_cb;
+
+/*******************************************************************************
+**  Stubs of what GKI and gatt_db.c take from the rest of the stack
+********************************************************************************/
+
+tGATT_CB gatt_cb;
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4) {}
+void LogMsg_5(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5) {}
+void LogMsg_6(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5, UINT32 p6) {}
+
+UINT32 gatt_sr_enqueue_cmd(tGATT_TCB *p_tcb, UINT8 op_code, UINT16 handle)
+{
+    return ++p_tcb->trans_id;
+}
+
+/* not reached, gatt_utils.c is linked for gatt_uuid_compare() */
+tGATT_CH_STATE gatt_get_ch_state(tGATT_TCB *p_tcb) { return GATT_CH_CLOSE; }
+BOOLEAN gatt_disconnect(BD_ADDR rem_bda) { return FALSE; }
+void gatt_dequeue_sr_cmd(tGATT_TCB *p_tcb) {}
+void gatt_update_app_use_link_flag(tGATT_IF gatt_if, tGATT_TCB *p_tcb, BOOLEAN is_add,
+                                   BOOLEAN check_acl_link) {}
+BT_HDR *attp_build_sr_msg(tGATT_TCB *p_tcb, UINT8 op_code, tGATT_SR_MSG *p_msg) { return NULL; }
+tGATT_STATUS attp_send_cl_msg(tGATT_TCB *p_tcb, UINT16 clcb_idx, UINT8 op_code,
+                              tGATT_CL_MSG *p_msg) { return GATT_INTERNAL_ERROR; }
+tGATT_STATUS attp_send_sr_msg(tGATT_TCB *p_tcb, BT_HDR *p_msg) { return GATT_INTERNAL_ERROR; }
+void btu_start_timer(TIMER_LIST_ENT *p_tle, UINT16 type, UINT32 timeout) {}
+void btu_stop_timer(TIMER_LIST_ENT *p_tle) {}
+BOOLEAN BTM_BleUpdateBgConnDev(BOOLEAN add_remove, BD_ADDR remote_bda) { return FALSE; }
+BOOLEAN BTM_GetSecurityFlags(BD_ADDR bd_addr, UINT8 *p_sec_flags) { return FALSE; }
+UINT8 btm_ble_read_sec_key_size(BD_ADDR bd_addr) { return 0; }
+UINT32 SDP_CreateRecord(void) { return 0; }
+BOOLEAN SDP_DeleteRecord(UINT32 handle) { return FALSE; }
+BOOLEAN SDP_AddAttribute(UINT32 handle, UINT16 attr_id, UINT8 attr_type, UINT32 attr_len,
+                         UINT8 *p_val) { return FALSE; }
+BOOLEAN SDP_AddUuidSequence(UINT32 handle, UINT16 attr_id, UINT16 num_uuids,
+                            UINT16 *p_uuids) { return FALSE; }
+BOOLEAN SDP_AddProtocolList(UINT32 handle, UINT16 num_elem,
+                            tSDP_PROTOCOL_ELEM *p_elem_list) { return FALSE; }
+BOOLEAN SDP_AddServiceClassIdList(UINT32 handle, UINT16 num_services,
+                                  UINT16 *p_service_uuids) { return FALSE; }
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static void gdb_req_cback(UINT16 conn_id, UINT32 trans_id, tGATTS_REQ_TYPE type,
+                          tGATTS_DATA *p_data)
+{
+    if (type == GATTS_REQ_TYPE_READ)
+        gdb_cb.app_read_handle = p_data->read_req.handle;
+}
+
+static void gdb_uuid128(tBT_UUID *p_uuid, UINT16 seed)
+{
+    int xx;
+
+    p_uuid->len = LEN_UUID_128;
+    for (xx = 0; xx < LEN_UUID_128 - 2; xx++)
+        p_uuid->uu.uuid128[xx] = (UINT8)(xx * 7 + 1);
+    p_uuid->uu.uuid128[LEN_UUID_128 - 2] = (UINT8)seed;
+    p_uuid->uu.uuid128[LEN_UUID_128 - 1] = (UINT8)(seed >> 8);
+}
+
+/*******************************************************************************
+**
+** Function         gdb_build
+**
+** Description      Builds the services, recording each attribute as added
+**
+** Returns          TRUE if every attribute was added where expected
+**
+*******************************************************************************/
+static BOOLEAN gdb_build(void)
+{
+    tBT_UUID    uuid, ccc = {LEN_UUID_16, {GATT_UUID_CHAR_CLIENT_CONFIG}};
+    tBT_UUID    desc = {LEN_UUID_16, {GATT_UUID_CHAR_DESCRIPTION}};
+    tGDB_ATTR   *p;
+    UINT16      s_hdl, hdl, val, left, incl;
+    int         svc, chr = 0;
+
+    /* one application owns the services, and takes the reads of values */
+    gatt_cb.cl_rcb[GDB_GATT_IF - 1].in_use = TRUE;
+    gatt_cb.cl_rcb[GDB_GATT_IF - 1].gatt_if = GDB_GATT_IF;
+    gatt_cb.cl_rcb[GDB_GATT_IF - 1].app_cb.p_req_cb = gdb_req_cback;
+
+    for (svc = 0; svc < gdb_cb.num_svc; svc++)
+    {
+        s_hdl = (UINT16)(1 + svc * gdb_cb.attrs_per_svc);
+        uuid.len = LEN_UUID_16;
+        uuid.uu.uuid16 = (UINT16)(0x1800 + svc);
+        if (!gatts_init_service_db(&gdb_cb.db[svc], uuid, TRUE, s_hdl, (UINT16)gdb_cb.attrs_per_svc))
+            return FALSE;
+        gatt_cb.sr_reg[svc].in_use = TRUE;
+        gatt_cb.sr_reg[svc].p_db = &gdb_cb.db[svc];
+        gatt_cb.sr_reg[svc].s_hdl = s_hdl;
+        gatt_cb.sr_reg[svc].e_hdl = (UINT16)(s_hdl + gdb_cb.attrs_per_svc - 1);
+        gatt_cb.sr_reg[svc].gatt_if = GDB_GATT_IF;
+        p = &gdb_cb.attr[s_hdl];
+        p->type = GATT_UUID_PRI_SERVICE;
+        p->svc = (UINT8)svc;
+        p->uuid = uuid;
+
+        /* the next service, included */
+        incl = (UINT16)(1 + ((svc + 1) % gdb_cb.num_svc) * gdb_cb.attrs_per_svc);
+        uuid.uu.uuid16 = (UINT16)(0x1800 + (svc + 1) % gdb_cb.num_svc);
+        if ((hdl = gatts_add_included_service(&gdb_cb.db[svc], incl,
+                                              (UINT16)(incl + gdb_cb.attrs_per_svc - 1), uuid)) != s_hdl + 1)
+            return FALSE;
+        p = &gdb_cb.attr[hdl];
+        p->type = GATT_UUID_INCLUDE_SERVICE;
+        p->svc = (UINT8)svc;
+        p->uuid = uuid;
+        p->ref_handle = incl;
+        p->ref_end = (UINT16)(incl + gdb_cb.attrs_per_svc - 1);
+
+        for (left = (UINT16)(gdb_cb.attrs_per_svc - 2); left >= 3; left -= 3, chr++)
+        {
+            if ((chr % 4) == 3)
+                gdb_uuid128(&uuid, (UINT16)chr);
+            else
+                uuid.uu.uuid16 = (UINT16)(0x2a00 + chr), uuid.len = LEN_UUID_16;
+
+            val = gatts_add_characteristic(&gdb_cb.db[svc], GATT_PERM_READ | GATT_PERM_WRITE,
+                                           GATT_CHAR_PROP_BIT_READ | GATT_CHAR_PROP_BIT_NOTIFY, &uuid);
+            if ((val == 0) || (gatts_add_char_descr(&gdb_cb.db[svc], GATT_PERM_READ | GATT_PERM_WRITE,
+                                                    &ccc) != val + 1))
+                return FALSE;
+            p = &gdb_cb.attr[val - 1];
+            p->type = GATT_UUID_CHAR_DECLARE;
+            p->svc = (UINT8)svc;
+            p->uuid = uuid;
+            p->ref_handle = val;
+            p->prop = GATT_CHAR_PROP_BIT_READ | GATT_CHAR_PROP_BIT_NOTIFY;
+            p = &gdb_cb.attr[val];
+            p->type = (uuid.len == LEN_UUID_16) ? uuid.uu.uuid16 : 0;
+            p->svc = (UINT8)svc;
+            p->uuid = uuid;
+            p = &gdb_cb.attr[val + 1];
+            p->type = GATT_UUID_CHAR_CLIENT_CONFIG;
+            p->svc = (UINT8)svc;
+        }
+
+        /* the rest are descriptions of the last characteristic */
+        for (; left > 0; left--)
+        {
+            if ((hdl = gatts_add_char_descr(&gdb_cb.db[svc], GATT_PERM_READ, &desc)) == 0)
+                return FALSE;
+            gdb_cb.attr[hdl].type = GATT_UUID_CHAR_DESCRIPTION;
+            gdb_cb.attr[hdl].svc = (UINT8)svc;
+        }
+    }
+    gdb_cb.num_handles = (UINT16)(gdb_cb.num_svc * gdb_cb.attrs_per_svc);
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         gdb_decl_value
+**
+** Description      Builds the value of a declaration from what was added
+**
+** Returns          its length
+**
+*******************************************************************************/
+static UINT16 gdb_decl_value(UINT16 handle, UINT8 *p)
+{
+    tGDB_ATTR   *p_attr = &gdb_cb.attr[handle];
+    UINT8       *p_start = p;
+
+    switch (p_attr->type)
+    {
+        case GATT_UUID_PRI_SERVICE:
+            UINT16_TO_STREAM(p, p_attr->uuid.uu.uuid16);
+            break;
+        case GATT_UUID_INCLUDE_SERVICE:
+            UINT16_TO_STREAM(p, p_attr->ref_handle);
+            UINT16_TO_STREAM(p, p_attr->ref_end);
+            UINT16_TO_STREAM(p, p_attr->uuid.uu.uuid16);
+            break;
+        case GATT_UUID_CHAR_DECLARE:
+            UINT8_TO_STREAM(p, p_attr->prop);
+            UINT16_TO_STREAM(p, p_attr->ref_handle);
+            if (p_attr->uuid.len == LEN_UUID_16)
+            {
+                UINT16_TO_STREAM(p, p_attr->uuid.uu.uuid16);
+            }
+            else
+            {
+                ARRAY_TO_STREAM(p, p_attr->uuid.uu.uuid128, LEN_UUID_128);
+            }
+            break;
+    }
+    return (UINT16)(p - p_start);
+}
+
+/*******************************************************************************
+**
+** Function         gdb_read_by_type
+**
+** Description      Read By Type over the services in the range, as
+**                  gatts_process_read_by_type_req() does
+**
+** Returns          status of the request, the response in p_rsp
+**
+*******************************************************************************/
+static tGATT_STATUS gdb_read_by_type(BT_HDR *p_rsp, UINT16 s_hdl, UINT16 e_hdl, tBT_UUID type)
+{
+    tGATT_TCB       tcb;
+    tGATT_STATUS    reason = GATT_NOT_FOUND, ret;
+    UINT16          buf_len = gdb_cb.mtu - 2, err_hdl = 0;
+    int             svc;
+
+    memset(&tcb, 0, sizeof(tcb));
+    memset(p_rsp, 0, sizeof(BT_HDR));
+    for (svc = 0; svc < gdb_cb.num_svc; svc++)
+    {
+        if ((gdb_cb.db[svc].start_handle > e_hdl) || (gdb_cb.db[svc].end_handle <= s_hdl))
+            continue;
+        ret = gatts_db_read_attr_value_by_type(&tcb, &gdb_cb.db[svc], GATT_REQ_READ_BY_TYPE, p_rsp,
+                                               s_hdl, e_hdl, type, &buf_len, 0, 0, 0, &err_hdl);
+        if (ret != GATT_NOT_FOUND)
+            reason = (ret == GATT_NO_RESOURCES) ? GATT_SUCCESS : ret;
+        if ((ret != GATT_SUCCESS) && (ret != GATT_NOT_FOUND))
+            break;
+    }
+    return reason;
+}
+
+/*******************************************************************************
+**
+** Function         gdb_expect_decls
+**
+** Description      Builds the Read By Type response of the characteristic
+**                  declarations from s_hdl: same length entries that fit
+**                  the MTU
+**
+** Returns          length of the response, 0 if nothing is found
+**
+*******************************************************************************/
+static UINT16 gdb_expect_decls(UINT16 s_hdl, UINT8 *p_out, UINT16 *p_last)
+{
+    UINT8   *p = p_out;
+    UINT16  hdl, len, entry = 0, left = gdb_cb.mtu - 2;
+
+    for (hdl = s_hdl; hdl <= gdb_cb.num_handles; hdl++)
+    {
+        if (gdb_cb.attr[hdl].type != GATT_UUID_CHAR_DECLARE)
+            continue;
+        len = (gdb_cb.attr[hdl].uuid.len == LEN_UUID_16) ? 5 : 19;
+        if ((left <= 2) || (left - 2 < len) || (entry && (entry != len + 2)))
+            break;
+        entry = len + 2;
+        UINT16_TO_STREAM(p, hdl);
+        p += gdb_decl_value(hdl, p);
+        left -= entry;
+        *p_last = hdl;
+    }
+    return (UINT16)(p - p_out);
+}
+
+/*******************************************************************************
+**
+** Function         gdb_run_read
+**
+** Description      Runs the read case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN gdb_run_read(void)
+{
+    tBENCH_RESULT   res;
+    tGATT_TCB       tcb;
+    tGATT_STATUS    status;
+    UINT8           value[GDB_MAX_RSP], expect[GDB_MAX_RSP];
+    UINT16          handle, len, exp_len;
+    uint64_t        start;
+    UINT32          seed = 1, req;
+    int             svc;
+
+    memset(&tcb, 0, sizeof(tcb));
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"mode\":\"%s\",\"attributes\":%u",
+             GDB_MODE, gdb_cb.num_handles);
+
+    start = bench_now_ns();
+    for (req = 0; req < gdb_cb.requests; req++)
+    {
+        seed = seed * 1103515245 + 12345;
+        handle = (UINT16)(1 + (seed >> 8) % gdb_cb.num_handles);
+
+        /* the service of the handle, as gatt_sr.c finds it */
+        for (svc = 0; svc < gdb_cb.num_svc; svc++)
+        {
+            if ((handle >= gdb_cb.db[svc].start_handle) && (handle < gdb_cb.db[svc].end_handle))
+                break;
+        }
+        if (svc == gdb_cb.num_svc)
+        {
+            bench_fail(&res, "no service of handle %u", handle);
+            break;
+        }
+
+        switch (gdb_cb.attr[handle].type)
+        {
+            case GATT_UUID_PRI_SERVICE:
+            case GATT_UUID_INCLUDE_SERVICE:
+            case GATT_UUID_CHAR_DECLARE:
+                len = 0;
+                status = gatts_read_attr_value_by_handle(&tcb, &gdb_cb.db[svc], GATT_REQ_READ,
+                                                         handle, 0, value, &len,
+                                                         gdb_cb.mtu - 1, 0, 0, 0);
+                exp_len = gdb_decl_value(handle, expect);
+                if ((status != GATT_SUCCESS) || (len != exp_len) || memcmp(value, expect, len))
+                    bench_fail(&res, "read of declaration %u differs", handle);
+                break;
+            default:
+                status = gatts_read_attr_perm_check(&gdb_cb.db[svc], FALSE, handle, 0, 0);
+                if (status != GATT_SUCCESS)
+                    bench_fail(&res, "read of %u not permitted, status 0x%02x", handle, status);
+                break;
+        }
+        if (strcmp(res.p_status, "failed") == 0)
+            break;
+        res.count++;
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+
+    bench_print_result(stdout, "gatt_db_" GDB_MODE "_read", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         gdb_run_discover
+**
+** Description      Runs the discover case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN gdb_run_discover(void)
+{
+    tBENCH_RESULT   res;
+    tBT_UUID        type = {LEN_UUID_16, {GATT_UUID_CHAR_DECLARE}};
+    BT_HDR          *p_rsp;
+    tGATT_STATUS    status;
+    UINT8           expect[GDB_MAX_RSP];
+    UINT16          s_hdl, exp_len, last = 0;
+    uint64_t        start;
+    UINT32          rounds, round;
+    UINT32          found;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"mode\":\"%s\",\"attributes\":%u,\"mtu\":%u",
+             GDB_MODE, gdb_cb.num_handles, gdb_cb.mtu);
+    if ((p_rsp = (BT_HDR *)GKI_getbuf(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + GDB_MAX_RSP)) == NULL)
+    {
+        bench_fail(&res, "no buffer");
+        bench_print_result(stdout, "gatt_db_" GDB_MODE "_discover", &res);
+        return FALSE;
+    }
+
+    rounds = (gdb_cb.requests / 100) ? (gdb_cb.requests / 100) : 1;
+    start = bench_now_ns();
+    for (round = 0; (round < rounds) && (strcmp(res.p_status, "failed") != 0); round++)
+    {
+        found = 0;
+        for (s_hdl = 1; ; s_hdl = last + 1)
+        {
+            status = gdb_read_by_type(p_rsp, s_hdl, 0xffff, type);
+            exp_len = gdb_expect_decls(s_hdl, expect, &last);
+            res.count++;
+            if (exp_len == 0)
+            {
+                if (status != GATT_NOT_FOUND)
+                    bench_fail(&res, "found past handle %u", s_hdl);
+                break;
+            }
+            if ((status != GATT_SUCCESS) || (p_rsp->len != exp_len) ||
+                memcmp((UINT8 *)(p_rsp + 1) + L2CAP_MIN_OFFSET, expect, exp_len))
+            {
+                bench_fail(&res, "response from handle %u differs", s_hdl);
+                break;
+            }
+            found += exp_len / p_rsp->offset;
+        }
+        if ((strcmp(res.p_status, "failed") != 0) &&
+            (found != (UINT32)gdb_cb.num_svc * ((gdb_cb.attrs_per_svc - 2) / 3)))
+            bench_fail(&res, "%u characteristics discovered", found);
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+    GKI_freebuf(p_rsp);
+
+    bench_extra(&res, "\"requests_per_discovery\":%.1f", (double)res.count / rounds);
+    bench_print_result(stdout, "gatt_db_" GDB_MODE "_discover", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         gdb_run_by_type
+**
+** Description      Runs the by_type case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN gdb_run_by_type(void)
+{
+    tBENCH_RESULT   res;
+    BT_HDR          *p_rsp;
+    tBT_UUID        type;
+    tGATT_STATUS    status;
+    UINT16          hdl, values[GDB_MAX_ATTRS], num_values = 0;
+    uint64_t        start;
+    UINT32          seed = 7, req;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"mode\":\"%s\",\"attributes\":%u",
+             GDB_MODE, gdb_cb.num_handles);
+
+    for (hdl = 1; hdl <= gdb_cb.num_handles; hdl++)
+    {
+        if ((gdb_cb.attr[hdl].type == GATT_UUID_CHAR_DECLARE) &&
+            (gdb_cb.attr[hdl].uuid.len == LEN_UUID_128))
+            values[num_values++] = gdb_cb.attr[hdl].ref_handle;
+    }
+    if ((num_values == 0) ||
+        ((p_rsp = (BT_HDR *)GKI_getbuf(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + GDB_MAX_RSP)) == NULL))
+    {
+        bench_result_init(&res);
+        res.p_status = "skipped";
+        bench_print_result(stdout, "gatt_db_" GDB_MODE "_by_type", &res);
+        return TRUE;
+    }
+
+    start = bench_now_ns();
+    for (req = 0; req < gdb_cb.requests; req++)
+    {
+        seed = seed * 1103515245 + 12345;
+        hdl = values[(seed >> 8) % num_values];
+        type = gdb_cb.attr[hdl].uuid;
+        gdb_cb.app_read_handle = 0;
+        status = gdb_read_by_type(p_rsp, 1, 0xffff, type);
+        if ((status != GATT_PENDING) || (gdb_cb.app_read_handle != hdl))
+        {
+            bench_fail(&res, "read of %u not sent to the app", hdl);
+            break;
+        }
+        res.count++;
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+    GKI_freebuf(p_rsp);
+
+    bench_print_result(stdout, "gatt_db_" GDB_MODE "_by_type", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+static void gdb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -s count         services (default %d, max %d)\n"
+            "  -a count         attributes of a service (default %d, at least 5)\n"
+            "  -n count         requests of the read and by_type cases, a hundredth\n"
+            "                   of it discoveries (default %d)\n"
+            "  -m bytes         ATT MTU (default %d)\n",
+            p_prog, GDB_DEFAULT_SERVICES, GDB_MAX_SERVICES, GDB_DEFAULT_ATTRS,
+            GDB_DEFAULT_REQUESTS, GDB_DEFAULT_MTU);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int opt, failed = 0;
+
+    gdb_cb.num_svc = GDB_DEFAULT_SERVICES;
+    gdb_cb.attrs_per_svc = GDB_DEFAULT_ATTRS;
+    gdb_cb.requests = GDB_DEFAULT_REQUESTS;
+    gdb_cb.mtu = GDB_DEFAULT_MTU;
+
+    while ((opt = getopt(argc, argv, "s:a:n:m:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 's': gdb_cb.num_svc = atoi(optarg); break;
+            case 'a': gdb_cb.attrs_per_svc = atoi(optarg); break;
+            case 'n': gdb_cb.requests = (UINT32)atoi(optarg); break;
+            case 'm': gdb_cb.mtu = (UINT16)atoi(optarg); break;
+            default:
+                gdb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((gdb_cb.num_svc <= 0) || (gdb_cb.num_svc > GDB_MAX_SERVICES) ||
+        (gdb_cb.attrs_per_svc < 5) || (gdb_cb.num_svc * gdb_cb.attrs_per_svc > GDB_MAX_ATTRS) ||
+        (gdb_cb.requests == 0) || (gdb_cb.mtu < GATT_DEF_BLE_MTU_SIZE) ||
+        (gdb_cb.mtu > GDB_MAX_RSP))
+    {
+        fprintf(stderr, "gatt_db_bench: bad option value\n");
+        return 2;
+    }
+
+    GKI_init();
+    if (!gdb_build())
+    {
+        fprintf(stderr, "gatt_db_bench: cannot build the database\n");
+        return 1;
+    }
+
+    failed |= !gdb_run_read();
+    failed |= !gdb_run_discover();
+    failed |= !gdb_run_by_type();
+    return failed;
+}
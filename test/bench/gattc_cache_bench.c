@@ -0,0 +1,829 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2013 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      gattc_cache_bench.c
+ *
+ *  Description:   GATT client reconnect benchmark
+ *
+ *                 Built twice, as gattc_cache_lazy and gattc_cache_full, from
+ *                 the BTA GATT client and bta_gattc_co.c, with
+ *                 BTA_GATTC_CACHE_LAZY on and off. The GATT stack is replaced
+ *                 by a simulated peer: connections come up on request and
+ *                 discovery procedures are answered from a database of
+ *                 services, characteristics and client configurations. The
+ *                 ATT requests a real peer would take are counted at the MTU.
+ *
+ *                 There are more devices than BTA keeps server caches for,
+ *                 so each reconnect starts without a cache in memory.
+ *
+ *                 discover  First connection to every device: no cache file,
+ *                           full discovery, then the cache is saved
+ *                 cached    Reconnect to every device from its cache file
+ *                 query     First characteristic of one service after a
+ *                           cached reconnect, loading the service if lazy
+ *                 damaged   Reconnect with a damaged cache file, which has
+ *                           to fall back to discovery
+ *
+ *                 Every cache BTA ends up with is checked against the
+ *                 database of the peer.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "bench_report.h"
+#include "bt_target.h"
+#include "gki.h"
+#include "bd.h"
+#include "btm_api.h"
+#include "l2c_api.h"
+#include "sdp_api.h"
+#include "bta_gattc_int.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#if (BTA_GATTC_CACHE_LAZY == TRUE)
+#define GCB_MODE                "lazy"
+#else
+#define GCB_MODE                "full"
+#endif
+
+#define GCB_DEFAULT_DEVICES     100
+#define GCB_DEFAULT_SERVICES    8
+#define GCB_DEFAULT_CHARS       6           /* per service */
+#define GCB_DEFAULT_MTU         23
+#define GCB_DEFAULT_INTERVAL    30          /* ms, one ATT request per interval */
+#define GCB_MAX_DEVICES         1000
+#define GCB_MAX_SERVICES        32
+#define GCB_MAX_CHARS           16
+#define GCB_CLIENT_IF           1
+#define GCB_CONN_ID             0x0101
+
+/* handles of characteristic chr of service svc, each with a declaration, a
+** value and a client configuration */
+#define GCB_SVC_HANDLES         (1 + 3 * gcb_cb.num_chars)
+#define GCB_SVC_START(svc)      ((UINT16)(1 + (svc) * GCB_SVC_HANDLES))
+#define GCB_CHAR_DECL(svc, chr) ((UINT16)(GCB_SVC_START(svc) + 1 + 3 * (chr)))
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    /* settings */
+    int                 num_devices;
+    int                 num_svc;
+    int                 num_chars;
+    UINT16              mtu;
+    UINT32              interval_ms;
+
+    tGATT_CBACK         *p_gatt_cback;      /* BTA client callbacks */
+    BUFFER_Q            msg_q;              /* messages sent to BTA */
+
+    /* simulated peer */
+    BD_ADDR             peer_bda;
+    BOOLEAN             disc_pending;
+    tGATT_DISC_TYPE     disc_type;
+    tGATT_DISC_PARAM    disc_param;
+    UINT32              att_requests;
+
+    /* client application */
+    BOOLEAN             opened;
+    tBTA_GATT_STATUS    open_status;
+} tGCB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tGCB_CB gcb_cb;
+
+/*******************************************************************************
+**  Stubs of the GATT stack and of what BTA takes from the rest of the stack
+********************************************************************************/
+
+UINT8 appl_trace_level = BT_TRACE_LEVEL_NONE;
+UINT8 btif_trace_level = BT_TRACE_LEVEL_NONE;
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4) {}
+void LogMsg_6(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5, UINT32 p6) {}
+
+void bta_sys_sendmsg(void *p_msg)
+{
+    GKI_enqueue(&gcb_cb.msg_q, p_msg);
+}
+
+void utl_freebuf(void **p)
+{
+    if (*p != NULL)
+    {
+        GKI_freebuf(*p);
+        *p = NULL;
+    }
+}
+
+tGATT_IF GATT_Register(tBT_UUID *p_app_uuid128, tGATT_CBACK *p_cb_info)
+{
+    gcb_cb.p_gatt_cback = p_cb_info;
+    return GCB_CLIENT_IF;
+}
+
+void GATT_StartIf(tGATT_IF gatt_if) {}
+
+BOOLEAN GATT_Connect(tGATT_IF gatt_if, BD_ADDR bd_addr, BOOLEAN is_direct)
+{
+    bdcpy(gcb_cb.peer_bda, bd_addr);
+    return TRUE;
+}
+
+BOOLEAN GATT_GetConnIdIfConnected(tGATT_IF gatt_if, BD_ADDR bd_addr, UINT16 *p_conn_id)
+{
+    return FALSE;
+}
+
+BOOLEAN GATT_GetConnectionInfor(UINT16 conn_id, tGATT_IF *p_gatt_if, BD_ADDR bd_addr)
+{
+    *p_gatt_if = GCB_CLIENT_IF;
+    bdcpy(bd_addr, gcb_cb.peer_bda);
+    return TRUE;
+}
+
+void BTM_ReadDevInfo(BD_ADDR remote_bda, tBT_DEVICE_TYPE *p_dev_type, tBLE_ADDR_TYPE *p_addr_type)
+{
+    *p_dev_type = BT_DEVICE_TYPE_BLE;
+    *p_addr_type = BLE_ADDR_PUBLIC;
+}
+
+BOOLEAN L2CA_EnableUpdateBleConnParams(BD_ADDR rem_bda, BOOLEAN enable)
+{
+    return TRUE;
+}
+
+tGATT_STATUS GATTC_Discover(UINT16 conn_id, tGATT_DISC_TYPE disc_type, tGATT_DISC_PARAM *p_param)
+{
+    if (gcb_cb.disc_pending)
+        return GATT_BUSY;
+
+    gcb_cb.disc_pending = TRUE;
+    gcb_cb.disc_type = disc_type;
+    gcb_cb.disc_param = *p_param;
+    return GATT_SUCCESS;
+}
+
+/* not reached */
+void GATT_Deregister(tGATT_IF gatt_if) {}
+BOOLEAN GATT_CancelConnect(tGATT_IF gatt_if, BD_ADDR bd_addr, BOOLEAN is_direct) { return FALSE; }
+tGATT_STATUS GATT_Disconnect(UINT16 conn_id) { return GATT_SUCCESS; }
+tGATT_STATUS GATTC_Read(UINT16 conn_id, tGATT_READ_TYPE type,
+                        tGATT_READ_PARAM *p_read) { return GATT_ERROR; }
+tGATT_STATUS GATTC_Write(UINT16 conn_id, tGATT_WRITE_TYPE type,
+                         tGATT_VALUE *p_write) { return GATT_ERROR; }
+tGATT_STATUS GATTC_ExecuteWrite(UINT16 conn_id, BOOLEAN is_execute) { return GATT_ERROR; }
+tGATT_STATUS GATTC_SendHandleValueConfirm(UINT16 conn_id, UINT16 handle) { return GATT_ERROR; }
+UINT8 L2CA_GetBleConnRole(BD_ADDR bd_addr) { return HCI_ROLE_MASTER; }
+BOOLEAN SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB *p_db, UINT32 len, UINT16 num_uuid,
+                            tSDP_UUID *p_uuid_list, UINT16 num_attr,
+                            UINT16 *p_attr_list) { return FALSE; }
+BOOLEAN SDP_ServiceSearchAttributeRequest(UINT8 *p_bd_addr, tSDP_DISCOVERY_DB *p_db,
+                                          tSDP_DISC_CMPL_CB *p_cb) { return FALSE; }
+tSDP_DISC_REC *SDP_FindServiceInDb(tSDP_DISCOVERY_DB *p_db, UINT16 service_uuid,
+                                   tSDP_DISC_REC *p_start_rec) { return NULL; }
+BOOLEAN SDP_FindServiceUUIDInRec(tSDP_DISC_REC *p_rec, tBT_UUID *p_uuid) { return FALSE; }
+BOOLEAN SDP_FindProtocolListElemInRec(tSDP_DISC_REC *p_rec, UINT16 layer_uuid,
+                                      tSDP_PROTOCOL_ELEM *p_elem) { return FALSE; }
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/* every third service and every fourth characteristic has a 128 bits UUID */
+static void gcb_svc_uuid(int svc, tBT_UUID *p_uuid)
+{
+    int xx;
+
+    if ((svc % 3) == 2)
+    {
+        p_uuid->len = LEN_UUID_128;
+        for (xx = 0; xx < LEN_UUID_128; xx++)
+            p_uuid->uu.uuid128[xx] = (UINT8)(0x40 + xx);
+        p_uuid->uu.uuid128[12] = (UINT8)svc;
+    }
+    else
+    {
+        p_uuid->len = LEN_UUID_16;
+        p_uuid->uu.uuid16 = (UINT16)(0x1800 + svc);
+    }
+}
+
+static void gcb_char_uuid(int svc, int chr, tBT_UUID *p_uuid)
+{
+    int xx;
+
+    if ((chr % 4) == 3)
+    {
+        p_uuid->len = LEN_UUID_128;
+        for (xx = 0; xx < LEN_UUID_128; xx++)
+            p_uuid->uu.uuid128[xx] = (UINT8)(0x80 + xx);
+        p_uuid->uu.uuid128[12] = (UINT8)svc;
+        p_uuid->uu.uuid128[13] = (UINT8)chr;
+    }
+    else
+    {
+        p_uuid->len = LEN_UUID_16;
+        p_uuid->uu.uuid16 = (UINT16)(0x2a00 + svc * GCB_MAX_CHARS + chr);
+    }
+}
+
+static BOOLEAN gcb_uuid_equal(tBT_UUID *p_a, tBT_UUID *p_b)
+{
+    if (p_a->len != p_b->len)
+        return FALSE;
+    if (p_a->len == LEN_UUID_16)
+        return (p_a->uu.uuid16 == p_b->uu.uuid16);
+    return (memcmp(p_a->uu.uuid128, p_b->uu.uuid128, LEN_UUID_128) == 0);
+}
+
+/*******************************************************************************
+**
+** Function         gcb_att_requests
+**
+** Description      Counts the ATT requests of a discovery procedure: results
+**                  of the same size are packed into responses of the MTU, and
+**                  the procedure ends with an error response unless the last
+**                  result reaches the end of the range.
+**
+** Returns          number of requests
+**
+*******************************************************************************/
+static UINT32 gcb_att_requests(UINT8 *p_sizes, int num, BOOLEAN at_end)
+{
+    UINT32  requests = 0;
+    int     xx = 0, in_pdu;
+
+    while (xx < num)
+    {
+        requests++;
+        for (in_pdu = 0; (xx < num) && (p_sizes[xx] == p_sizes[xx - in_pdu]) &&
+                         ((in_pdu + 1) * p_sizes[xx] <= gcb_cb.mtu - 2); in_pdu++)
+            xx++;
+    }
+    return requests + (at_end ? 0 : 1);
+}
+
+/*******************************************************************************
+**
+** Function         gcb_peer_discover
+**
+** Description      Answers the pending discovery procedure from the database
+**                  of the peer, through the BTA result and complete callbacks.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gcb_peer_discover(void)
+{
+    tGATT_DISC_TYPE     type = gcb_cb.disc_type;
+    UINT16              s_hdl = gcb_cb.disc_param.s_handle, e_hdl = gcb_cb.disc_param.e_handle;
+    tGATT_DISC_RES      res;
+    UINT8               sizes[GCB_MAX_SERVICES * GCB_MAX_CHARS];
+    UINT16              hdl, last = 0;
+    int                 svc, chr, num = 0;
+
+    gcb_cb.disc_pending = FALSE;
+
+    for (svc = 0; svc < gcb_cb.num_svc; svc++)
+    {
+        switch (type)
+        {
+            case GATT_DISC_SRVC_ALL:
+                if (GCB_SVC_START(svc) < s_hdl)
+                    break;
+                memset(&res, 0, sizeof(res));
+                res.handle = GCB_SVC_START(svc);
+                res.value.group_value.e_handle = last = (UINT16)(GCB_SVC_START(svc) + GCB_SVC_HANDLES - 1);
+                gcb_svc_uuid(svc, &res.value.group_value.service_type);
+                sizes[num++] = (UINT8)(4 + res.value.group_value.service_type.len);
+                (*gcb_cb.p_gatt_cback->p_disc_res_cb)(GCB_CONN_ID, type, &res);
+                break;
+
+            case GATT_DISC_CHAR:
+            case GATT_DISC_CHAR_DSCPT:
+                for (chr = 0; chr < gcb_cb.num_chars; chr++)
+                {
+                    memset(&res, 0, sizeof(res));
+                    hdl = GCB_CHAR_DECL(svc, chr);
+                    if (type == GATT_DISC_CHAR_DSCPT)
+                        hdl += 2;
+                    if ((hdl < s_hdl) || (hdl > e_hdl))
+                        continue;
+
+                    res.handle = last = hdl;
+                    if (type == GATT_DISC_CHAR)
+                    {
+                        res.value.dclr_value.char_prop = GATT_CHAR_PROP_BIT_READ | GATT_CHAR_PROP_BIT_NOTIFY;
+                        res.value.dclr_value.val_handle = (UINT16)(hdl + 1);
+                        gcb_char_uuid(svc, chr, &res.value.dclr_value.char_uuid);
+                        sizes[num++] = (UINT8)(5 + res.value.dclr_value.char_uuid.len);
+                    }
+                    else
+                    {
+                        res.type.len = LEN_UUID_16;
+                        res.type.uu.uuid16 = GATT_UUID_CHAR_CLIENT_CONFIG;
+                        sizes[num++] = 4;
+                    }
+                    (*gcb_cb.p_gatt_cback->p_disc_res_cb)(GCB_CONN_ID, type, &res);
+                }
+                break;
+
+            default:
+                /* no included services */
+                break;
+        }
+    }
+
+    gcb_cb.att_requests += gcb_att_requests(sizes, num, (num > 0) && (last == e_hdl));
+    (*gcb_cb.p_gatt_cback->p_disc_cmpl_cb)(GCB_CONN_ID, type, GATT_SUCCESS);
+}
+
+/*******************************************************************************
+**
+** Function         gcb_run_pending
+**
+** Description      Runs BTA until it waits for nothing: delivers the messages
+**                  it sent itself, the callins of the cache, and the answers
+**                  of the peer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gcb_run_pending(void)
+{
+    BT_HDR  *p_msg;
+
+    for (;;)
+    {
+        if ((p_msg = (BT_HDR *)GKI_dequeue(&gcb_cb.msg_q)) != NULL)
+        {
+            if (bta_gattc_hdl_event(p_msg))
+                GKI_freebuf(p_msg);
+        }
+        else if (gcb_cb.disc_pending)
+        {
+            gcb_peer_discover();
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+static void gcb_cback(tBTA_GATTC_EVT event, tBTA_GATTC *p_data)
+{
+    if (event == BTA_GATTC_OPEN_EVT)
+    {
+        gcb_cb.opened = TRUE;
+        gcb_cb.open_status = p_data->open.status;
+    }
+}
+
+static void gcb_bda(int dev, BD_ADDR bda)
+{
+    bda[0] = 0x00;
+    bda[1] = 0x1b;
+    bda[2] = 0xdc;
+    bda[3] = 0x00;
+    bda[4] = (UINT8)(dev >> 8);
+    bda[5] = (UINT8)dev;
+}
+
+/*******************************************************************************
+**
+** Function         gcb_connect
+**
+** Description      Opens a connection to a device, as BTA_GATTC_Open() would,
+**                  brings it up and runs BTA until the cache is ready.
+**
+** Returns          TRUE if BTA reported the connection open
+**
+*******************************************************************************/
+static BOOLEAN gcb_connect(int dev)
+{
+    tBTA_GATTC_API_OPEN *p_buf;
+    BD_ADDR             bda;
+
+    gcb_bda(dev, bda);
+    gcb_cb.opened = FALSE;
+
+    if ((p_buf = (tBTA_GATTC_API_OPEN *)GKI_getbuf(sizeof(tBTA_GATTC_API_OPEN))) == NULL)
+        return FALSE;
+    p_buf->hdr.event = BTA_GATTC_API_OPEN_EVT;
+    p_buf->client_if = GCB_CLIENT_IF;
+    p_buf->is_direct = TRUE;
+    bdcpy(p_buf->remote_bda, bda);
+    bta_sys_sendmsg(p_buf);
+    gcb_run_pending();
+
+    (*gcb_cb.p_gatt_cback->p_conn_cb)(GCB_CLIENT_IF, bda, GCB_CONN_ID, TRUE, 0);
+    gcb_run_pending();
+
+    return gcb_cb.opened && (gcb_cb.open_status == BTA_GATT_OK);
+}
+
+static void gcb_disconnect(int dev)
+{
+    BD_ADDR bda;
+
+    gcb_bda(dev, bda);
+    (*gcb_cb.p_gatt_cback->p_conn_cb)(GCB_CLIENT_IF, bda, GCB_CONN_ID, FALSE,
+                                      GATT_CONN_TERMINATE_PEER_USER);
+    gcb_run_pending();
+}
+
+/*******************************************************************************
+**
+** Function         gcb_query_first
+**
+** Description      Queries the first characteristic of a service, as
+**                  BTA_GATTC_GetFirstChar() does
+**
+** Returns          TRUE if it is the one of the peer
+**
+*******************************************************************************/
+static BOOLEAN gcb_query_first(int svc)
+{
+    tBTA_GATT_SRVC_ID   srvc_id;
+    tBTA_GATT_ID        char_id;
+    tBTA_GATT_CHAR_PROP prop = 0;
+    tBT_UUID            uuid;
+
+    memset(&srvc_id, 0, sizeof(srvc_id));
+    srvc_id.is_primary = TRUE;
+    gcb_svc_uuid(svc, &srvc_id.id.uuid);
+
+    if (bta_gattc_query_cache(GCB_CONN_ID, BTA_GATTC_ATTR_TYPE_CHAR, &srvc_id, NULL, NULL,
+                              &char_id, &prop) != BTA_GATT_OK)
+        return FALSE;
+
+    gcb_char_uuid(svc, 0, &uuid);
+    return gcb_uuid_equal(&uuid, &char_id.uuid) &&
+           (prop == (GATT_CHAR_PROP_BIT_READ | GATT_CHAR_PROP_BIT_NOTIFY));
+}
+
+/*******************************************************************************
+**
+** Function         gcb_check_cache
+**
+** Description      Checks the cache BTA has for the connection against the
+**                  database of the peer: the characteristics of every service
+**                  in order, their client configuration and their handles.
+**
+** Returns          TRUE if they match
+**
+*******************************************************************************/
+static BOOLEAN gcb_check_cache(void)
+{
+    tBTA_GATTC_CLCB     *p_clcb = bta_gattc_find_clcb_by_conn_id(GCB_CONN_ID);
+    tBTA_GATT_SRVC_ID   srvc_id;
+    tBTA_GATT_ID        char_id, prev;
+    tBTA_GATT_CHAR_PROP prop;
+    tBT_UUID            uuid, ccc = {LEN_UUID_16, {GATT_UUID_CHAR_CLIENT_CONFIG}}, none;
+    int                 svc, chr;
+
+    if ((p_clcb == NULL) || (p_clcb->state != BTA_GATTC_CONN_ST))
+        return FALSE;
+
+    memset(&none, 0, sizeof(none));
+    for (svc = 0; svc < gcb_cb.num_svc; svc++)
+    {
+        memset(&srvc_id, 0, sizeof(srvc_id));
+        srvc_id.is_primary = TRUE;
+        gcb_svc_uuid(svc, &srvc_id.id.uuid);
+
+        for (chr = 0; chr <= gcb_cb.num_chars; chr++)
+        {
+            if (bta_gattc_query_cache(GCB_CONN_ID, BTA_GATTC_ATTR_TYPE_CHAR, &srvc_id,
+                                      chr ? &prev : NULL, NULL, &char_id, &prop) != BTA_GATT_OK)
+                break;
+            gcb_char_uuid(svc, chr, &uuid);
+            if ((chr == gcb_cb.num_chars) || !gcb_uuid_equal(&uuid, &char_id.uuid))
+                return FALSE;
+
+            if (bta_gattc_id2handle(p_clcb->p_srcb, &srvc_id, &char_id, none) !=
+                    GCB_CHAR_DECL(svc, chr) + 1 ||
+                bta_gattc_id2handle(p_clcb->p_srcb, &srvc_id, &char_id, ccc) !=
+                    GCB_CHAR_DECL(svc, chr) + 2)
+                return FALSE;
+            prev = char_id;
+        }
+        if (chr != gcb_cb.num_chars)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         gcb_damage
+**
+** Description      Flips a byte in the last record of the cache file of a
+**                  device
+**
+** Returns          TRUE if done
+**
+*******************************************************************************/
+static BOOLEAN gcb_damage(int dev)
+{
+    char    name[64];
+    BD_ADDR bda;
+    UINT8   byte;
+    off_t   end;
+    int     fd;
+    BOOLEAN ok;
+
+    gcb_bda(dev, bda);
+    snprintf(name, sizeof(name), "%sgatt_cache_%02x%02x%02x%02x%02x%02x", BTA_GATTC_CO_CACHE_PATH,
+             bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+    if ((fd = open(name, O_RDWR)) < 0)
+        return FALSE;
+
+    end = lseek(fd, 0, SEEK_END);
+    ok = (end > 8) && (pread(fd, &byte, 1, end - 8) == 1);
+    byte ^= 0x5a;
+    ok = ok && (pwrite(fd, &byte, 1, end - 8) == 1);
+    close(fd);
+    return ok;
+}
+
+/*******************************************************************************
+**
+** Function         gcb_run_reconnects
+**
+** Description      Connects to every device, checks the cache and disconnects
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN gcb_run_reconnects(const char *p_case, BOOLEAN damage)
+{
+    tBENCH_RESULT   res;
+    char            name[64];
+    uint64_t        t0;
+    UINT32          att_requests = 0;
+    int             dev;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params),
+             "\"mode\":\"%s\",\"devices\":%d,\"services\":%d,\"chars\":%d,\"mtu\":%u",
+             GCB_MODE, gcb_cb.num_devices, gcb_cb.num_svc, gcb_cb.num_chars, gcb_cb.mtu);
+    res.p_samples_name = "reconnect_us";
+    bench_samples_init(&res.samples, gcb_cb.num_devices);
+
+    for (dev = 0; dev < gcb_cb.num_devices; dev++)
+    {
+        if (damage && !gcb_damage(dev))
+        {
+            bench_fail(&res, "no cache file of device %d", dev);
+            break;
+        }
+
+        gcb_cb.att_requests = 0;
+        t0 = bench_now_ns();
+        if (!gcb_connect(dev))
+        {
+            bench_fail(&res, "connection to device %d not open", dev);
+            break;
+        }
+        res.elapsed_ns += bench_now_ns() - t0;
+        bench_samples_add(&res.samples, bench_now_ns() - t0);
+        att_requests += gcb_cb.att_requests;
+
+        if (!gcb_check_cache())
+        {
+            bench_fail(&res, "cache of device %d differs from the peer", dev);
+            gcb_disconnect(dev);
+            break;
+        }
+        gcb_disconnect(dev);
+        res.count++;
+    }
+
+    if (res.count)
+    {
+        bench_extra(&res, "\"att_requests_per_reconnect\":%.1f,\"interval_ms\":%u,"
+                    "\"att_ms_per_reconnect\":%.1f",
+                    (double)att_requests / res.count, gcb_cb.interval_ms,
+                    (double)att_requests * gcb_cb.interval_ms / res.count);
+    }
+    if (!damage && (strcmp(p_case, "cached") == 0) && att_requests)
+        bench_fail(&res, "%u ATT requests on cached reconnects", att_requests);
+    if (damage && (att_requests < (UINT32)res.count))
+        bench_fail(&res, "damaged cache files were used");
+
+    snprintf(name, sizeof(name), "gattc_cache_%s_%s", GCB_MODE, p_case);
+    bench_print_result(stdout, name, &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         gcb_run_query
+**
+** Description      Runs the query case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN gcb_run_query(void)
+{
+    tBENCH_RESULT   res;
+    uint64_t        t0;
+    int             dev, svc;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params),
+             "\"mode\":\"%s\",\"devices\":%d,\"services\":%d,\"chars\":%d",
+             GCB_MODE, gcb_cb.num_devices, gcb_cb.num_svc, gcb_cb.num_chars);
+    res.p_samples_name = "query_us";
+    bench_samples_init(&res.samples, gcb_cb.num_devices);
+
+    for (dev = 0; dev < gcb_cb.num_devices; dev++)
+    {
+        if (!gcb_connect(dev))
+        {
+            bench_fail(&res, "connection to device %d not open", dev);
+            break;
+        }
+
+        svc = dev % gcb_cb.num_svc;
+        t0 = bench_now_ns();
+        if (!gcb_query_first(svc))
+        {
+            bench_fail(&res, "first characteristic of service %d of device %d differs", svc, dev);
+            gcb_disconnect(dev);
+            break;
+        }
+        res.elapsed_ns += bench_now_ns() - t0;
+        bench_samples_add(&res.samples, bench_now_ns() - t0);
+
+        gcb_disconnect(dev);
+        res.count++;
+    }
+
+    bench_print_result(stdout, "gattc_cache_" GCB_MODE "_query", &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         gcb_run
+**
+** Description      Registers the client and runs the cases in the current
+**                  directory
+**
+** Returns          TRUE if they passed
+**
+*******************************************************************************/
+static BOOLEAN gcb_run(void)
+{
+    tBTA_GATTC_API_REG  *p_buf;
+    BOOLEAN             ok = TRUE;
+
+    GKI_init();
+    GKI_init_q(&gcb_cb.msg_q);
+    memset(&bta_gattc_cb, 0, sizeof(bta_gattc_cb));
+
+    if ((p_buf = (tBTA_GATTC_API_REG *)GKI_getbuf(sizeof(tBTA_GATTC_API_REG))) == NULL)
+        return FALSE;
+    memset(p_buf, 0, sizeof(tBTA_GATTC_API_REG));
+    p_buf->hdr.event = BTA_GATTC_API_REG_EVT;
+    p_buf->app_uuid.len = LEN_UUID_16;
+    p_buf->app_uuid.uu.uuid16 = 0x1234;
+    p_buf->p_cback = gcb_cback;
+    bta_sys_sendmsg(p_buf);
+    gcb_run_pending();
+    if (gcb_cb.p_gatt_cback == NULL)
+        return FALSE;
+
+    ok &= gcb_run_reconnects("discover", FALSE);
+    ok &= gcb_run_reconnects("cached", FALSE);
+    ok &= gcb_run_query();
+    ok &= gcb_run_reconnects("damaged", TRUE);
+    return ok;
+}
+
+static void gcb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d count         devices (default %d, max %d)\n"
+            "  -s count         services of a device (default %d, max %d)\n"
+            "  -c count         characteristics of a service (default %d, max %d)\n"
+            "  -m bytes         ATT MTU (default %d)\n"
+            "  -i ms            connection interval, one ATT request each (default %d)\n",
+            p_prog, GCB_DEFAULT_DEVICES, GCB_MAX_DEVICES, GCB_DEFAULT_SERVICES,
+            GCB_MAX_SERVICES, GCB_DEFAULT_CHARS, GCB_MAX_CHARS, GCB_DEFAULT_MTU,
+            GCB_DEFAULT_INTERVAL);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    char    dir[] = "/tmp/gattc_cache_bench.XXXXXX";
+    char    cmd[64];
+    int     opt;
+    BOOLEAN ok;
+
+    gcb_cb.num_devices = GCB_DEFAULT_DEVICES;
+    gcb_cb.num_svc = GCB_DEFAULT_SERVICES;
+    gcb_cb.num_chars = GCB_DEFAULT_CHARS;
+    gcb_cb.mtu = GCB_DEFAULT_MTU;
+    gcb_cb.interval_ms = GCB_DEFAULT_INTERVAL;
+
+    while ((opt = getopt(argc, argv, "d:s:c:m:i:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd': gcb_cb.num_devices = atoi(optarg); break;
+            case 's': gcb_cb.num_svc = atoi(optarg); break;
+            case 'c': gcb_cb.num_chars = atoi(optarg); break;
+            case 'm': gcb_cb.mtu = (UINT16)atoi(optarg); break;
+            case 'i': gcb_cb.interval_ms = (UINT32)atoi(optarg); break;
+            default:
+                gcb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    /* more devices than server caches, so reconnects do not find one; the
+    ** discovery list of BTA holds the services and the characteristics of one */
+    if ((gcb_cb.num_devices <= BTA_GATTC_KNOWN_SR_MAX) || (gcb_cb.num_devices > GCB_MAX_DEVICES) ||
+        (gcb_cb.num_svc <= 0) || (gcb_cb.num_svc > GCB_MAX_SERVICES) ||
+        (gcb_cb.num_chars <= 0) || (gcb_cb.num_chars > GCB_MAX_CHARS) ||
+        (gcb_cb.num_svc + gcb_cb.num_chars > BTA_GATTC_MAX_CACHE_CHAR) ||
+        (gcb_cb.mtu < GATT_DEF_BLE_MTU_SIZE) || (gcb_cb.mtu > 517))
+    {
+        fprintf(stderr, "gattc_cache_bench: bad option value, at least %d devices, "
+                "at most %d services and characteristics of a service\n",
+                BTA_GATTC_KNOWN_SR_MAX + 1, BTA_GATTC_MAX_CACHE_CHAR);
+        return 2;
+    }
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    if (chdir(dir) != 0)
+    {
+        perror("chdir");
+        return 1;
+    }
+
+    ok = gcb_run();
+
+    if (chdir("/") != 0)
+        perror("chdir");
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    if (system(cmd) != 0)
+        fprintf(stderr, "gattc_cache_bench: cannot remove %s\n", dir);
+    return ok ? 0 : 1;
+}
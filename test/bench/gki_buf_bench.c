@@ -0,0 +1,365 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      gki_buf_bench.c
+ *
+ *  Description:   GKI buffer pool alloc/free benchmark with several tasks
+ *
+ *                 Built twice, as gki_buf_shared and gki_buf_cached, from the
+ *                 GKI sources with GKI_BUF_TASK_CACHE FALSE and TRUE. Every
+ *                 thread is a GKI task, started together.
+ *
+ *                 local     each task gets a few buffers of mixed sizes and
+ *                           frees them again, in a loop
+ *                 handoff   tasks in pairs: one gets buffers and sends them
+ *                           to the mailbox of the other, which frees them,
+ *                           as BTU and the HCI layer do with ACL data
+ *
+ *                 All buffers must be back in their pools at the end.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <limits.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_report.h"
+#include "gki.h"
+#include "bt_trace.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#if (GKI_BUF_TASK_CACHE == TRUE)
+#define GBB_MODE                "cached"
+#else
+#define GBB_MODE                "shared"
+#endif
+
+#define GBB_DEFAULT_OPS         1000000     /* per task */
+#define GBB_DEFAULT_TASKS       GKI_MAX_TASKS
+#define GBB_DEFAULT_DEPTH       4
+
+#define GBB_START_EVT           EVENT_MASK(APPL_EVT_0)
+#define GBB_CREDIT_EVT          EVENT_MASK(APPL_EVT_1)
+#define GBB_MBOX                TASK_MBOX_0
+#define GBB_MBOX_EVT            TASK_MBOX_0_EVT_MASK
+
+/* sizes asked for, spread over the public pools of gki_target.h */
+static const UINT16 gbb_sizes[] = {40, 120, 250, 600, 2000};
+#define GBB_NUM_SIZES           (sizeof(gbb_sizes) / sizeof(gbb_sizes[0]))
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef enum
+{
+    GBB_CASE_LOCAL,
+    GBB_CASE_HANDOFF
+} tGBB_CASE;
+
+typedef struct
+{
+    UINT32          ops;
+    UINT8           tasks;
+    UINT8           depth;
+
+    tGBB_CASE       test;
+    volatile UINT32 failures;       /* GKI_getbuf() returned NULL             */
+    UINT32          freed[GKI_MAX_TASKS];   /* by the consumer tasks          */
+    uint64_t        task_ns[GKI_MAX_TASKS];
+    sem_t           done_sem;
+} tGBB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tGBB_CB gbb_cb;
+
+/*******************************************************************************
+**  Stubs of what GKI takes from the rest of the stack
+********************************************************************************/
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static UINT32 gbb_rand(UINT32 *p_seed)
+{
+    *p_seed ^= *p_seed << 13;
+    *p_seed ^= *p_seed >> 17;
+    *p_seed ^= *p_seed << 5;
+    return *p_seed;
+}
+
+/*******************************************************************************
+**
+** Function         gbb_local
+**
+** Description      Gets gbb_cb.depth buffers and frees them, until
+**                  gbb_cb.ops buffers went through the task.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gbb_local(UINT8 task_id)
+{
+    void    *p_buf[UCHAR_MAX];
+    UINT32  seed = 0x9e3779b9 * (task_id + 1);
+    UINT32  done, xx;
+
+    for (done = 0; done < gbb_cb.ops; done += gbb_cb.depth)
+    {
+        for (xx = 0; xx < gbb_cb.depth; xx++)
+        {
+            if ((p_buf[xx] = GKI_getbuf(gbb_sizes[gbb_rand(&seed) % GBB_NUM_SIZES])) == NULL)
+                gbb_cb.failures++;
+        }
+        for (xx = 0; xx < gbb_cb.depth; xx++)
+        {
+            if (p_buf[xx] != NULL)
+                GKI_freebuf(p_buf[xx]);
+        }
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gbb_produce
+**
+** Description      Sends gbb_cb.ops buffers to the mailbox of the peer task,
+**                  never more than twice gbb_cb.depth ahead of it.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gbb_produce(UINT8 task_id, UINT8 peer_id)
+{
+    UINT32  seed = 0x9e3779b9 * (task_id + 1);
+    UINT32  sent;
+    void    *p_buf;
+
+    for (sent = 0; sent < gbb_cb.ops; sent++)
+    {
+        /* the credit event latches, so a wakeup is never lost */
+        while (sent - __atomic_load_n(&gbb_cb.freed[peer_id], __ATOMIC_ACQUIRE) >=
+               2 * (UINT32)gbb_cb.depth)
+            GKI_wait(GBB_CREDIT_EVT, 0);
+
+        while ((p_buf = GKI_getbuf(gbb_sizes[gbb_rand(&seed) % GBB_NUM_SIZES])) == NULL)
+        {
+            gbb_cb.failures++;
+            GKI_delay(1);
+        }
+        GKI_send_msg(peer_id, GBB_MBOX, p_buf);
+    }
+}
+
+static void gbb_consume(UINT8 task_id, UINT8 peer_id)
+{
+    UINT32  freed = 0;
+    void    *p_buf;
+
+    while (freed < gbb_cb.ops)
+    {
+        if (!(GKI_wait(GBB_MBOX_EVT, 0) & GBB_MBOX_EVT))
+            continue;
+
+        while ((p_buf = GKI_read_mbox(GBB_MBOX)) != NULL)
+        {
+            GKI_freebuf(p_buf);
+            __atomic_store_n(&gbb_cb.freed[task_id], ++freed, __ATOMIC_RELEASE);
+            if ((freed % gbb_cb.depth) == 0)
+                GKI_send_event(peer_id, GBB_CREDIT_EVT);
+        }
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gbb_task
+**
+** Description      Task of the benchmark: runs the case of gbb_cb.test each
+**                  time it gets GBB_START_EVT.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gbb_task(UINT32 param)
+{
+    UINT8       task_id = GKI_get_taskid();
+    uint64_t    start;
+
+    for (;;)
+    {
+        if (!(GKI_wait(GBB_START_EVT, 0) & GBB_START_EVT))
+            continue;
+
+        start = bench_now_ns();
+        if (gbb_cb.test == GBB_CASE_LOCAL)
+            gbb_local(task_id);
+        else if (task_id & 1)
+            gbb_consume(task_id, task_id - 1);
+        else
+            gbb_produce(task_id, task_id + 1);
+        gbb_cb.task_ns[task_id] = bench_now_ns() - start;
+
+        sem_post(&gbb_cb.done_sem);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gbb_run_case
+**
+** Description      Starts all tasks on one case and reports it.
+**
+** Returns          FALSE if the case failed
+**
+*******************************************************************************/
+static BOOLEAN gbb_run_case(const char *p_name, tGBB_CASE test)
+{
+    tBENCH_RESULT   res;
+    uint64_t        start, cycles, max_ns = 0;
+    UINT16          in_use = 0;
+    UINT8           xx;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params),
+             "\"mode\":\"%s\",\"tasks\":%u,\"ops_per_task\":%u,\"depth\":%u",
+             GBB_MODE, gbb_cb.tasks, gbb_cb.ops, gbb_cb.depth);
+    res.p_samples_name = "task_ms";
+    bench_samples_init(&res.samples, gbb_cb.tasks);
+
+    gbb_cb.test = test;
+    gbb_cb.failures = 0;
+    memset(gbb_cb.freed, 0, sizeof(gbb_cb.freed));
+
+    start = bench_now_ns();
+    cycles = bench_cycles();
+    for (xx = 0; xx < gbb_cb.tasks; xx++)
+        GKI_send_event(xx, GBB_START_EVT);
+    for (xx = 0; xx < gbb_cb.tasks; xx++)
+    {
+        while (sem_wait(&gbb_cb.done_sem) != 0)
+            ;
+    }
+    cycles = bench_cycles() - cycles;
+    res.elapsed_ns = bench_now_ns() - start;
+
+    /* task times are shown in ms, through the us scale of the samples */
+    for (xx = 0; xx < gbb_cb.tasks; xx++)
+    {
+        bench_samples_add(&res.samples, gbb_cb.task_ns[xx] / 1000);
+        if (gbb_cb.task_ns[xx] > max_ns)
+            max_ns = gbb_cb.task_ns[xx];
+    }
+
+    /* one get and one free per buffer */
+    res.count = gbb_cb.ops * ((test == GBB_CASE_LOCAL) ? gbb_cb.tasks : gbb_cb.tasks / 2);
+    for (xx = 0; xx < GKI_NUM_TOTAL_BUF_POOLS; xx++)
+        in_use += GKI_poolutilization(xx) ? (GKI_poolcount(xx) - GKI_poolfreecount(xx)) : 0;
+
+    bench_extra(&res, "\"Mops_per_sec\":%.2f,\"ns_per_op\":%.1f,\"cycles_per_op\":%.1f,\"getbuf_failures\":%u",
+                2.0 * res.count * 1000 / max_ns, (double)max_ns / (2.0 * res.count / gbb_cb.tasks),
+                (double)cycles * gbb_cb.tasks / (2.0 * res.count), gbb_cb.failures);
+
+    if (in_use != 0)
+        bench_fail(&res, "%u buffers not back in their pools", in_use);
+
+    bench_print_result(stdout, p_name, &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "ok") == 0);
+}
+
+static void gbb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         buffers per task (default %d)\n"
+            "  -t tasks         GKI tasks, at most %d (default %d)\n"
+            "  -d depth         buffers held at once per task (default %d)\n",
+            p_prog, GBB_DEFAULT_OPS, GKI_MAX_TASKS, GBB_DEFAULT_TASKS,
+            GBB_DEFAULT_DEPTH);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    char    name[GKI_MAX_TASKS][8];
+    int     opt, failed = 0;
+    UINT8   xx;
+
+    gbb_cb.ops = GBB_DEFAULT_OPS;
+    gbb_cb.tasks = GBB_DEFAULT_TASKS;
+    gbb_cb.depth = GBB_DEFAULT_DEPTH;
+
+    while ((opt = getopt(argc, argv, "n:t:d:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': gbb_cb.ops = (UINT32)atoi(optarg); break;
+            case 't': gbb_cb.tasks = (UINT8)atoi(optarg); break;
+            case 'd': gbb_cb.depth = (UINT8)atoi(optarg); break;
+            default:
+                gbb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((gbb_cb.ops == 0) || (gbb_cb.tasks == 0) || (gbb_cb.tasks > GKI_MAX_TASKS) ||
+        (gbb_cb.depth == 0))
+    {
+        fprintf(stderr, "gki_buf: bad option value\n");
+        return 2;
+    }
+
+    sem_init(&gbb_cb.done_sem, 0, 0);
+
+    GKI_init();
+    for (xx = 0; xx < gbb_cb.tasks; xx++)
+    {
+        snprintf(name[xx], sizeof(name[xx]), "GBB%u", xx);
+        GKI_create_task(gbb_task, xx, (INT8 *)name[xx], NULL, 0);
+    }
+    GKI_run(0);
+
+    failed |= !gbb_run_case("gki_buf_local", GBB_CASE_LOCAL);
+    if (gbb_cb.tasks >= 2)
+    {
+        /* pairs only */
+        gbb_cb.tasks &= ~1;
+        failed |= !gbb_run_case("gki_buf_handoff", GBB_CASE_HANDOFF);
+    }
+
+    return failed;
+}
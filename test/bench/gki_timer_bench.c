@@ -0,0 +1,391 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      gki_timer_bench.c
+ *
+ *  Description:   GKI timer wakeup and latency benchmark
+ *
+ *                 Built twice, as gki_timer_tick and gki_timer_tickless, from
+ *                 the GKI sources with GKI_TICKLESS_TIMER FALSE and TRUE. A
+ *                 GKI task runs GKI timers and takes the time each TIMER_0
+ *                 event reaches it, so the lateness measured includes the
+ *                 wakeup of the task. The context switches of the GKI timer
+ *                 thread are counted as its wakeups.
+ *
+ *                 periodic  continuous timer: lateness of every expiration
+ *                           against its ideal time, and timer thread wakeups
+ *                 oneshot   one shot timers started at random points within
+ *                           a tick: time to expiration, to set against the
+ *                           period asked for
+ *                 idle      no timer running: timer thread wakeups
+ *
+ ******************************************************************************/
+
+#include <dirent.h>
+#include <getopt.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench_report.h"
+#include "gki.h"
+#include "bt_trace.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#if (GKI_TICKLESS_TIMER == TRUE)
+#define GTB_MODE                "tickless"
+#else
+#define GTB_MODE                "tick"
+#endif
+
+#define GTB_TASK_ID             0
+#define GTB_TICK_NS             (BENCH_NS_PER_SEC / TICKS_PER_SEC)
+
+#define GTB_DEFAULT_COUNT       200
+#define GTB_DEFAULT_PERIOD      2           /* ticks */
+#define GTB_DEFAULT_IDLE_MS     1000
+
+#define GTB_TIMER_THREAD_NAME   "gki timer"
+
+/* Commands from the main thread to the task */
+#define GTB_CMD_PERIODIC        1
+#define GTB_CMD_ONESHOT         2
+#define GTB_CMD_EVT             EVENT_MASK(APPL_EVT_0)
+#define GTB_STOP_EVT            EVENT_MASK(APPL_EVT_1)
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    UINT32          count;
+    UINT32          period;         /* ticks */
+    UINT32          idle_ms;
+
+    volatile UINT8  cmd;
+    tBENCH_SAMPLES  *p_samples;
+    sem_t           done_sem;
+} tGTB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tGTB_CB gtb_cb;
+
+/*******************************************************************************
+**  Stubs of what GKI takes from the rest of the stack
+********************************************************************************/
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         gtb_timer_wakeups
+**
+** Description      Context switches of the GKI timer thread so far.
+**
+** Returns          count, 0 if the thread was not found
+**
+*******************************************************************************/
+static uint64_t gtb_timer_wakeups(void)
+{
+    char            path[64], line[128];
+    struct dirent   *p_ent;
+    DIR             *p_dir;
+    FILE            *p_file;
+    uint64_t        total = 0;
+    unsigned long   val;
+
+    if ((p_dir = opendir("/proc/self/task")) == NULL)
+        return 0;
+
+    while ((p_ent = readdir(p_dir)) != NULL)
+    {
+        if (p_ent->d_name[0] == '.')
+            continue;
+
+        snprintf(path, sizeof(path), "/proc/self/task/%s/comm", p_ent->d_name);
+        if ((p_file = fopen(path, "r")) == NULL)
+            continue;
+        line[0] = 0;
+        fgets(line, sizeof(line), p_file);
+        fclose(p_file);
+        if (strncmp(line, GTB_TIMER_THREAD_NAME, strlen(GTB_TIMER_THREAD_NAME)) != 0)
+            continue;
+
+        snprintf(path, sizeof(path), "/proc/self/task/%s/status", p_ent->d_name);
+        if ((p_file = fopen(path, "r")) == NULL)
+            continue;
+        while (fgets(line, sizeof(line), p_file) != NULL)
+        {
+            if ((sscanf(line, "voluntary_ctxt_switches: %lu", &val) == 1) ||
+                (sscanf(line, "nonvoluntary_ctxt_switches: %lu", &val) == 1))
+                total += val;
+        }
+        fclose(p_file);
+    }
+
+    closedir(p_dir);
+    return total;
+}
+
+/*******************************************************************************
+**
+** Function         gtb_periodic
+**
+** Description      Runs a continuous timer for gtb_cb.count expirations.
+**                  Lateness is taken against start + n * period, so it does
+**                  not hide drift.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gtb_periodic(void)
+{
+    uint64_t    start, now, due;
+    UINT32      xx = 0;
+
+    start = bench_now_ns();
+    GKI_start_timer(TIMER_0, gtb_cb.period, TRUE);
+
+    while (xx < gtb_cb.count)
+    {
+        if (!(GKI_wait(TIMER_0_EVT_MASK, 0) & TIMER_0_EVT_MASK))
+            continue;
+
+        now = bench_now_ns();
+        due = start + (uint64_t)(xx + 1) * gtb_cb.period * GTB_TICK_NS;
+        bench_samples_add(gtb_cb.p_samples, (now > due) ? (now - due) : 0);
+        xx++;
+    }
+
+    GKI_stop_timer(TIMER_0);
+}
+
+/*******************************************************************************
+**
+** Function         gtb_oneshot
+**
+** Description      Starts gtb_cb.count one shot timers of gtb_cb.period
+**                  ticks, each after a random pause shorter than a tick.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gtb_oneshot(void)
+{
+    struct timespec ts;
+    uint64_t        start;
+    UINT32          xx;
+
+    for (xx = 0; xx < gtb_cb.count; xx++)
+    {
+        ts.tv_sec = 0;
+        ts.tv_nsec = (long)((uint64_t)rand() % GTB_TICK_NS);
+        nanosleep(&ts, NULL);
+
+        start = bench_now_ns();
+        GKI_start_timer(TIMER_0, gtb_cb.period, FALSE);
+        while (!(GKI_wait(TIMER_0_EVT_MASK, 0) & TIMER_0_EVT_MASK))
+            ;
+        bench_samples_add(gtb_cb.p_samples, bench_now_ns() - start);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         gtb_task
+**
+** Description      GKI task running the timer cases asked by main().
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gtb_task(UINT32 param)
+{
+    UINT16 evt;
+
+    for (;;)
+    {
+        evt = GKI_wait(GTB_CMD_EVT | GTB_STOP_EVT, 0);
+        if (evt & GTB_STOP_EVT)
+            break;
+        if (!(evt & GTB_CMD_EVT))
+            continue;
+
+        if (gtb_cb.cmd == GTB_CMD_PERIODIC)
+            gtb_periodic();
+        else if (gtb_cb.cmd == GTB_CMD_ONESHOT)
+            gtb_oneshot();
+
+        sem_post(&gtb_cb.done_sem);
+    }
+}
+
+static void gtb_params(tBENCH_RESULT *p_res, UINT32 count)
+{
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"mode\":\"%s\",\"ticks_per_sec\":%d,\"period_ticks\":%u,\"period_us\":%llu,\"count\":%u",
+             GTB_MODE, TICKS_PER_SEC, gtb_cb.period,
+             (unsigned long long)(gtb_cb.period * GTB_TICK_NS / BENCH_NS_PER_US), count);
+}
+
+/*******************************************************************************
+**
+** Function         gtb_run_case
+**
+** Description      Has the task run one timer case and reports it.
+**
+** Returns          FALSE if the case failed
+**
+*******************************************************************************/
+static BOOLEAN gtb_run_case(const char *p_name, UINT8 cmd)
+{
+    tBENCH_RESULT   res;
+    uint64_t        start, wakeups;
+    double          secs;
+
+    bench_result_init(&res);
+    gtb_params(&res, gtb_cb.count);
+    res.p_samples_name = (cmd == GTB_CMD_PERIODIC) ? "lateness_us" : "delay_us";
+    bench_samples_init(&res.samples, gtb_cb.count);
+    gtb_cb.p_samples = &res.samples;
+
+    wakeups = gtb_timer_wakeups();
+    start = bench_now_ns();
+
+    gtb_cb.cmd = cmd;
+    GKI_send_event(GTB_TASK_ID, GTB_CMD_EVT);
+    while (sem_wait(&gtb_cb.done_sem) != 0)
+        ;
+
+    res.elapsed_ns = bench_now_ns() - start;
+    wakeups = gtb_timer_wakeups() - wakeups;
+    res.count = res.samples.num;
+    secs = (double)res.elapsed_ns / BENCH_NS_PER_SEC;
+    bench_extra(&res, "\"timer_wakeups\":%llu,\"timer_wakeups_per_sec\":%.1f",
+                (unsigned long long)wakeups, secs > 0 ? wakeups / secs : 0.0);
+
+    if (res.count != gtb_cb.count)
+        bench_fail(&res, "%u of %u expirations", res.count, gtb_cb.count);
+
+    bench_print_result(stdout, p_name, &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "ok") == 0);
+}
+
+/*******************************************************************************
+**
+** Function         gtb_run_idle
+**
+** Description      Counts the timer thread wakeups while no timer runs.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void gtb_run_idle(void)
+{
+    tBENCH_RESULT   res;
+    uint64_t        wakeups;
+
+    bench_result_init(&res);
+    gtb_params(&res, 0);
+
+    wakeups = gtb_timer_wakeups();
+    res.elapsed_ns = bench_now_ns();
+    usleep(gtb_cb.idle_ms * 1000);
+    res.elapsed_ns = bench_now_ns() - res.elapsed_ns;
+    wakeups = gtb_timer_wakeups() - wakeups;
+
+    bench_extra(&res, "\"timer_wakeups\":%llu,\"timer_wakeups_per_sec\":%.1f",
+                (unsigned long long)wakeups,
+                wakeups / ((double)res.elapsed_ns / BENCH_NS_PER_SEC));
+    bench_print_result(stdout, "gki_timer_idle", &res);
+}
+
+static void gtb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         expirations per case (default %d)\n"
+            "  -p ticks         timer period, a tick is %d ms (default %d)\n"
+            "  -i ms            length of the idle case (default %d)\n",
+            p_prog, GTB_DEFAULT_COUNT, 1000 / TICKS_PER_SEC, GTB_DEFAULT_PERIOD,
+            GTB_DEFAULT_IDLE_MS);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int opt, failed = 0;
+
+    gtb_cb.count = GTB_DEFAULT_COUNT;
+    gtb_cb.period = GTB_DEFAULT_PERIOD;
+    gtb_cb.idle_ms = GTB_DEFAULT_IDLE_MS;
+
+    while ((opt = getopt(argc, argv, "n:p:i:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': gtb_cb.count = (UINT32)atoi(optarg); break;
+            case 'p': gtb_cb.period = (UINT32)atoi(optarg); break;
+            case 'i': gtb_cb.idle_ms = (UINT32)atoi(optarg); break;
+            default:
+                gtb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((gtb_cb.count == 0) || (gtb_cb.period == 0))
+    {
+        fprintf(stderr, "gki_timer: bad option value\n");
+        return 2;
+    }
+
+    sem_init(&gtb_cb.done_sem, 0, 0);
+    srand(1);
+
+    GKI_init();
+    GKI_create_task(gtb_task, GTB_TASK_ID, (INT8 *)"GTB", NULL, 0);
+    GKI_run(0);
+
+    failed |= !gtb_run_case("gki_timer_periodic", GTB_CMD_PERIODIC);
+    failed |= !gtb_run_case("gki_timer_oneshot", GTB_CMD_ONESHOT);
+    gtb_run_idle();
+
+    GKI_send_event(GTB_TASK_ID, GTB_STOP_EVT);
+    return failed;
+}
@@ -0,0 +1,753 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      h4_replay.c
+ *
+ *  Description:   H4 receive parser replay benchmark
+ *
+ *                 Replays a received HCI stream through hci_h4_receive_msg()
+ *                 and through the per byte parser it replaced. The stream is
+ *                 queued on the userial rx queue in buffers of the size the
+ *                 userial reader thread reads, and both parsers take it from
+ *                 there through the userial read functions. MB/s and CPU
+ *                 cycles per packet of each are printed as JSON.
+ *
+ *                 The stream is synthesized (ACL data with Number Of
+ *                 Completed Packets events and some fragmented L2CAP
+ *                 frames) or read from the received packets of a btsnoop
+ *                 capture. The packets both parsers hand to the stack are
+ *                 compared; a difference fails the run.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench_report.h"
+
+/* The parser under test, with its static state and the helpers the per
+** byte parser shares with it, and the rx queue both read from */
+#include "hci_h4.c"
+#undef LOG_TAG
+#include "userial.c"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define H4R_DEFAULT_PKTS        20000
+#define H4R_DEFAULT_ACL_LEN     1021
+#define H4R_DEFAULT_ITERS       10
+
+/* One Number Of Completed Packets event for this many ACL packets */
+#define H4R_NOCP_EVERY          4
+
+/* One L2CAP frame split in two ACL packets for this many ACL packets */
+#define H4R_FRAG_EVERY          16
+
+#define H4R_ACL_HANDLE          0x0001
+
+/* rx buffers queued between two calls of the parser */
+#define H4R_BATCH_BUFS          64
+
+#define H4R_BTSNOOP_HDR_SIZE    16
+#define H4R_BTSNOOP_REC_SIZE    24
+#define H4R_BTSNOOP_H4          1002
+#define H4R_BTSNOOP_RCVD        0x01
+
+#define H4R_FNV_BASIS           2166136261U
+#define H4R_FNV_PRIME           16777619U
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef uint16_t (tH4R_PARSER) (void);
+
+typedef struct
+{
+    uint8_t     *p_stream;
+    uint32_t    stream_len;
+    uint32_t    stream_size;
+    uint32_t    stream_pkts;        /* H4 packets in the stream               */
+    uint16_t    chunk;              /* rx buffer size                         */
+
+    /* what reached the stack in the current pass */
+    uint32_t    msgs;
+    uint32_t    hash;               /* of the messages, if hashing            */
+    uint8_t     hashing;
+} tH4R_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tH4R_CB h4r_cb;
+
+/*******************************************************************************
+**  Stubs of the HCI library around hci_h4.c
+********************************************************************************/
+
+BUFFER_Q tx_q;
+
+/* Buffers carry the queue link in front, as the stack's GKI buffers do */
+static char *h4r_alloc(int size)
+{
+    char *p = (char *)malloc(BT_HC_BUFFER_HDR_SIZE + size);
+
+    return p ? (p + BT_HC_BUFFER_HDR_SIZE) : NULL;
+}
+
+static int h4r_dealloc(TRANSAC transac, char *p_buf)
+{
+    free((char *)transac - BT_HC_BUFFER_HDR_SIZE);
+    return 0;
+}
+
+static int h4r_data_ind(TRANSAC transac, char *p_buf, int len)
+{
+    HC_BT_HDR   *p_msg = (HC_BT_HDR *)transac;
+    uint8_t     *p = (uint8_t *)(p_msg + 1) + p_msg->offset;
+    uint16_t    xx;
+
+    h4r_cb.msgs++;
+    if (h4r_cb.hashing)
+    {
+        h4r_cb.hash = (h4r_cb.hash ^ p_msg->event) * H4R_FNV_PRIME;
+        for (xx = 0; xx < p_msg->len; xx++)
+            h4r_cb.hash = (h4r_cb.hash ^ p[xx]) * H4R_FNV_PRIME;
+    }
+
+    return h4r_dealloc(transac, p_buf);
+}
+
+static bt_hc_callbacks_t h4r_cbacks =
+{
+    sizeof(bt_hc_callbacks_t),
+    NULL, NULL, NULL, NULL,
+    h4r_alloc,
+    h4r_dealloc,
+    h4r_data_ind,
+    NULL
+};
+
+bt_hc_callbacks_t *bt_hc_cbacks = &h4r_cbacks;
+bt_vendor_interface_t *bt_vnd_if = NULL;
+
+void bthc_signal_event(uint16_t event) {}
+void btsnoop_init(void) {}
+void btsnoop_close(void) {}
+void btsnoop_cleanup(void) {}
+void btsnoop_capture(HC_BT_HDR *p_buf, uint8_t is_rcvd) {}
+void lpm_wake_assert(void) {}
+void lpm_tx_done(uint8_t is_tx_done) {}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         h4r_receive_msg_per_byte
+**
+** Description      hci_h4_receive_msg() as it was before the receive stream
+**                  was parsed in blocks: one userial_read() call and one pass
+**                  of the state machine per byte, except for the payload of a
+**                  packet. Kept here as the reference of the replay.
+**
+** Returns          Number of read bytes
+**
+*******************************************************************************/
+static uint16_t h4r_receive_msg_per_byte(void)
+{
+    uint16_t    bytes_read = 0;
+    uint8_t     byte;
+    uint16_t    msg_len, len;
+    uint8_t     msg_received;
+    tHCI_H4_CB  *p_cb=&h4_cb;
+
+    while (TRUE)
+    {
+        /* Read one byte to see if there is anything waiting to be read */
+        if (userial_read(0 /*dummy*/, &byte, 1) == 0)
+        {
+            break;
+        }
+
+        bytes_read++;
+        msg_received = FALSE;
+
+        switch (p_cb->rcv_state)
+        {
+        case H4_RX_MSGTYPE_ST:
+            /* Start of new message */
+            if ((byte < H4_TYPE_ACL_DATA) || (byte > H4_TYPE_EVENT))
+            {
+                /* Unknown HCI message type */
+                /* Drop this byte */
+                ALOGE("[h4] Unknown HCI message type drop this byte 0x%x", byte);
+                break;
+            }
+
+            /* Initialize rx parameters */
+            p_cb->rcv_msg_type = byte;
+            p_cb->rcv_len = hci_preamble_table[byte-1];
+            memset(p_cb->preload_buffer, 0 , 6);
+            p_cb->preload_count = 0;
+            p_cb->rcv_state = H4_RX_LEN_ST; /* Next, wait for length to come */
+            break;
+
+        case H4_RX_LEN_ST:
+            /* Receiving preamble */
+            p_cb->preload_buffer[p_cb->preload_count++] = byte;
+            p_cb->rcv_len--;
+
+            /* Check if we received entire preamble yet */
+            if (p_cb->rcv_len == 0)
+            {
+                if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
+                {
+                    /* ACL data lengths are 16-bits */
+                    msg_len = p_cb->preload_buffer[3];
+                    msg_len = (msg_len << 8) + p_cb->preload_buffer[2];
+
+                    if (msg_len && (p_cb->preload_count == 4))
+                    {
+                        /* Check if this is a start packet */
+                        byte = ((p_cb->preload_buffer[1] >> 4) & 0x03);
+
+                        if (byte == ACL_RX_PKT_START)
+                        {
+                            /* Read 2 more bytes to get the L2CAP length */
+                            p_cb->rcv_len = 2;
+
+                            break;
+                        }
+                    }
+
+                    p_cb->p_rcv_msg = acl_rx_frame_buffer_alloc();
+                }
+                else
+                {
+                    /* Received entire preamble.
+                     * Length is in the last received byte */
+                    msg_len = byte;
+                    p_cb->rcv_len = msg_len;
+
+                    /* Allocate a buffer for message */
+                    if (bt_hc_cbacks)
+                    {
+                        len = msg_len + p_cb->preload_count + BT_HC_HDR_SIZE;
+                        p_cb->p_rcv_msg = \
+                            (HC_BT_HDR *) bt_hc_cbacks->alloc(len);
+                    }
+
+                    if (p_cb->p_rcv_msg)
+                    {
+                        /* Initialize buffer with preloaded data */
+                        p_cb->p_rcv_msg->offset = 0;
+                        p_cb->p_rcv_msg->layer_specific = 0;
+                        p_cb->p_rcv_msg->event = \
+                            msg_evt_table[p_cb->rcv_msg_type-1];
+                        p_cb->p_rcv_msg->len = p_cb->preload_count;
+                        memcpy((uint8_t *)(p_cb->p_rcv_msg + 1), \
+                               p_cb->preload_buffer, p_cb->preload_count);
+                    }
+                }
+
+                if (p_cb->p_rcv_msg == NULL)
+                {
+                    /* Unable to acquire message buffer. */
+                    ALOGE( \
+                     "H4: Unable to acquire buffer for incoming HCI message." \
+                    );
+
+                    if (msg_len == 0)
+                    {
+                        /* Wait for next message */
+                        p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                    }
+                    else
+                    {
+                        /* Ignore rest of the packet */
+                        p_cb->rcv_state = H4_RX_IGNORE_ST;
+                    }
+
+                    break;
+                }
+
+                /* Message length is valid */
+                if (msg_len)
+                {
+                    /* Read rest of message */
+                    p_cb->rcv_state = H4_RX_DATA_ST;
+                }
+                else
+                {
+                    /* Message has no additional parameters.
+                     * (Entire message has been received) */
+                    if (p_cb->rcv_msg_type == H4_TYPE_ACL_DATA)
+                        acl_rx_frame_end_chk(); /* to print snoop trace */
+
+                    msg_received = TRUE;
+
+                    /* Next, wait for next message */
+                    p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                }
+            }
+            break;
+
+        case H4_RX_DATA_ST:
+            *((uint8_t *)(p_cb->p_rcv_msg + 1) + p_cb->p_rcv_msg->len++) = byte;
+            p_cb->rcv_len--;
+
+            if (p_cb->rcv_len > 0)
+            {
+                /* Read in the rest of the message */
+                len = userial_read(0 /*dummy*/, \
+                      ((uint8_t *)(p_cb->p_rcv_msg+1) + p_cb->p_rcv_msg->len), \
+                      p_cb->rcv_len);
+                p_cb->p_rcv_msg->len += len;
+                p_cb->rcv_len -= len;
+                bytes_read += len;
+            }
+
+            /* Check if we read in entire message yet */
+            if (p_cb->rcv_len == 0)
+            {
+                /* Received entire packet. */
+                /* Check for segmented l2cap packets */
+                if ((p_cb->rcv_msg_type == H4_TYPE_ACL_DATA) &&
+                    !acl_rx_frame_end_chk())
+                {
+                    /* Not the end of packet yet. */
+                    /* Next, wait for next message */
+                    p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                }
+                else
+                {
+                    msg_received = TRUE;
+                    /* Next, wait for next message */
+                    p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+                }
+            }
+            break;
+
+        case H4_RX_IGNORE_ST:
+            /* Ignore reset of packet */
+            p_cb->rcv_len--;
+
+            /* Check if we read in entire message yet */
+            if (p_cb->rcv_len == 0)
+            {
+                /* Next, wait for next message */
+                p_cb->rcv_state = H4_RX_MSGTYPE_ST;
+            }
+            break;
+        }
+
+        /* If we received entire message, then send it to the task */
+        if (msg_received)
+        {
+            uint8_t intercepted = FALSE;
+
+            /* generate snoop trace message */
+            /* ACL packet tracing had done in acl_rx_frame_end_chk() */
+            if (p_cb->p_rcv_msg->event != MSG_HC_TO_STACK_HCI_ACL)
+                btsnoop_capture(p_cb->p_rcv_msg, TRUE);
+
+            if (p_cb->p_rcv_msg->event == MSG_HC_TO_STACK_HCI_EVT)
+                intercepted = internal_event_intercept();
+
+            if ((bt_hc_cbacks) && (intercepted == FALSE))
+            {
+                bt_hc_cbacks->data_ind((TRANSAC) p_cb->p_rcv_msg, \
+                                       (char *) (p_cb->p_rcv_msg + 1), \
+                                       p_cb->p_rcv_msg->len + BT_HC_HDR_SIZE);
+            }
+            p_cb->p_rcv_msg = NULL;
+        }
+    }
+
+    return (bytes_read);
+}
+
+static uint8_t *h4r_stream_put(uint32_t len)
+{
+    uint8_t *p;
+
+    if (h4r_cb.stream_len + len > h4r_cb.stream_size)
+    {
+        h4r_cb.stream_size = (h4r_cb.stream_len + len) * 2;
+        if ((p = (uint8_t *)realloc(h4r_cb.p_stream, h4r_cb.stream_size)) == NULL)
+        {
+            fprintf(stderr, "h4_replay: out of memory\n");
+            exit(1);
+        }
+        h4r_cb.p_stream = p;
+    }
+
+    p = h4r_cb.p_stream + h4r_cb.stream_len;
+    h4r_cb.stream_len += len;
+    h4r_cb.stream_pkts++;
+    return p;
+}
+
+/*******************************************************************************
+**
+** Function         h4r_put_acl
+**
+** Description      Appends an ACL packet of hci_len bytes. A start packet
+**                  carries an L2CAP header announcing l2cap_len bytes.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void h4r_put_acl(uint8_t pb, uint16_t hci_len, uint16_t l2cap_len, uint32_t seq)
+{
+    uint8_t     *p = h4r_stream_put(1 + HCI_ACL_PREAMBLE_SIZE + hci_len);
+    uint16_t    xx = 0;
+
+    *p++ = H4_TYPE_ACL_DATA;
+    UINT16_TO_STREAM(p, H4R_ACL_HANDLE | (pb << 12));
+    UINT16_TO_STREAM(p, hci_len);
+    if (pb == ACL_RX_PKT_START)
+    {
+        UINT16_TO_STREAM(p, l2cap_len);
+        UINT16_TO_STREAM(p, 0x0040);
+        xx = L2CAP_HEADER_SIZE;
+    }
+    for (; xx < hci_len; xx++)
+        *p++ = (uint8_t)(seq + xx);
+}
+
+static void h4r_put_nocp(uint16_t num)
+{
+    uint8_t *p = h4r_stream_put(1 + HCI_EVT_PREAMBLE_SIZE + 5);
+
+    *p++ = H4_TYPE_EVENT;
+    *p++ = 0x13;
+    *p++ = 5;
+    *p++ = 1;
+    UINT16_TO_STREAM(p, H4R_ACL_HANDLE);
+    UINT16_TO_STREAM(p, num);
+}
+
+/*******************************************************************************
+**
+** Function         h4r_synthesize
+**
+** Description      Builds a stream of num ACL packets of acl_len bytes, as a
+**                  controller sends them during a bulk transfer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void h4r_synthesize(uint32_t num, uint16_t acl_len)
+{
+    uint16_t    half = acl_len / 2;
+    uint32_t    xx;
+
+    for (xx = 0; xx < num; xx++)
+    {
+        if ((xx % H4R_FRAG_EVERY) == H4R_FRAG_EVERY - 1)
+        {
+            /* one L2CAP frame in a start and a continuation packet */
+            h4r_put_acl(ACL_RX_PKT_START, half, 2 * half - L2CAP_HEADER_SIZE, xx);
+            h4r_put_acl(ACL_RX_PKT_CONTINUE, half, 0, xx);
+        }
+        else
+        {
+            h4r_put_acl(ACL_RX_PKT_START, acl_len, acl_len - L2CAP_HEADER_SIZE, xx);
+        }
+
+        if ((xx % H4R_NOCP_EVERY) == H4R_NOCP_EVERY - 1)
+            h4r_put_nocp(H4R_NOCP_EVERY);
+    }
+}
+
+static uint32_t h4r_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/*******************************************************************************
+**
+** Function         h4r_load_btsnoop
+**
+** Description      Appends the received packets of an H4 btsnoop capture.
+**
+** Returns          0 on success
+**
+*******************************************************************************/
+static int h4r_load_btsnoop(const char *p_path)
+{
+    uint8_t     hdr[H4R_BTSNOOP_REC_SIZE];
+    uint32_t    incl_len, flags;
+    FILE        *p_file;
+    int         ret = 0;
+
+    if ((p_file = fopen(p_path, "rb")) == NULL)
+    {
+        perror(p_path);
+        return -1;
+    }
+
+    if ((fread(hdr, 1, H4R_BTSNOOP_HDR_SIZE, p_file) != H4R_BTSNOOP_HDR_SIZE) ||
+        memcmp(hdr, "btsnoop\0", 8) || (h4r_be32(hdr + 12) != H4R_BTSNOOP_H4))
+    {
+        fprintf(stderr, "%s: not an H4 btsnoop capture\n", p_path);
+        fclose(p_file);
+        return -1;
+    }
+
+    while (fread(hdr, 1, H4R_BTSNOOP_REC_SIZE, p_file) == H4R_BTSNOOP_REC_SIZE)
+    {
+        incl_len = h4r_be32(hdr + 4);
+        flags = h4r_be32(hdr + 8);
+
+        if (!(flags & H4R_BTSNOOP_RCVD))
+        {
+            fseek(p_file, incl_len, SEEK_CUR);
+            continue;
+        }
+        if (fread(h4r_stream_put(incl_len), 1, incl_len, p_file) != incl_len)
+        {
+            fprintf(stderr, "%s: truncated record\n", p_path);
+            ret = -1;
+            break;
+        }
+    }
+
+    fclose(p_file);
+    return ret;
+}
+
+static void h4r_reset(void)
+{
+    memset(&h4_cb, 0, sizeof(h4_cb));
+    utils_queue_init(&h4_cb.acl_rx_q);
+    h4r_cb.msgs = 0;
+    h4r_cb.hash = H4R_FNV_BASIS;
+}
+
+/*******************************************************************************
+**
+** Function         h4r_queue
+**
+** Description      Queues up to H4R_BATCH_BUFS rx buffers of the stream from
+**                  *p_pos on the userial rx queue, as the reader thread does
+**                  before the HCI thread gets to them.
+**
+** Returns          FALSE if out of memory
+**
+*******************************************************************************/
+static uint8_t h4r_queue(uint32_t *p_pos)
+{
+    HC_BT_HDR   *p_buf;
+    uint32_t    xx;
+    uint16_t    len;
+
+    for (xx = 0; (xx < H4R_BATCH_BUFS) && (*p_pos < h4r_cb.stream_len); xx++)
+    {
+        len = h4r_cb.chunk;
+        if (len > h4r_cb.stream_len - *p_pos)
+            len = (uint16_t)(h4r_cb.stream_len - *p_pos);
+
+        if ((p_buf = (HC_BT_HDR *)h4r_alloc(BT_HC_HDR_SIZE + len)) == NULL)
+            return FALSE;
+
+        p_buf->offset = 0;
+        p_buf->layer_specific = 0;
+        p_buf->len = len;
+        memcpy(p_buf + 1, h4r_cb.p_stream + *p_pos, len);
+        utils_enqueue(&userial_cb.rx_q, p_buf);
+        *p_pos += len;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         h4r_pass
+**
+** Description      Replays the whole stream once through a parser, which is
+**                  called once per batch of rx buffers, as on an HC_EVENT_RX.
+**                  Only the parser is timed.
+**
+** Returns          FALSE if out of memory
+**
+*******************************************************************************/
+static uint8_t h4r_pass(tH4R_PARSER *p_parser, uint64_t *p_ns, uint64_t *p_cycles)
+{
+    uint32_t    pos = 0;
+    uint64_t    t0, c0;
+
+    h4r_reset();
+    *p_ns = *p_cycles = 0;
+
+    while (pos < h4r_cb.stream_len)
+    {
+        if (!h4r_queue(&pos))
+            return FALSE;
+
+        t0 = bench_now_ns();
+        c0 = bench_cycles();
+        (*p_parser)();
+        *p_cycles += bench_cycles() - c0;
+        *p_ns += bench_now_ns() - t0;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         h4r_run
+**
+** Description      Replays the stream through one parser: once hashing what
+**                  reaches the stack, then iters times timed.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void h4r_run(const char *p_name, tH4R_PARSER *p_parser, uint32_t iters,
+                    tBENCH_RESULT *p_res, uint32_t *p_hash)
+{
+    uint64_t    ns, cycles, total_cycles = 0;
+    uint32_t    xx;
+
+    bench_result_init(p_res);
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"parser\":\"%s\",\"rx_buf\":%u,\"stream_bytes\":%u,\"stream_pkts\":%u,\"iters\":%u",
+             p_name, h4r_cb.chunk, h4r_cb.stream_len, h4r_cb.stream_pkts, iters);
+    p_res->p_samples_name = "pass_us";
+    bench_samples_init(&p_res->samples, iters);
+
+    h4r_cb.hashing = TRUE;
+    if (!h4r_pass(p_parser, &ns, &cycles))
+    {
+        bench_fail(p_res, "out of memory");
+        return;
+    }
+    *p_hash = h4r_cb.hash;
+    h4r_cb.hashing = FALSE;
+
+    for (xx = 0; xx < iters; xx++)
+    {
+        if (!h4r_pass(p_parser, &ns, &cycles))
+        {
+            bench_fail(p_res, "out of memory");
+            return;
+        }
+
+        bench_samples_add(&p_res->samples, ns);
+        p_res->elapsed_ns += ns;
+        total_cycles += cycles;
+        p_res->count += h4r_cb.msgs;
+        p_res->bytes += h4r_cb.stream_len;
+    }
+
+    bench_extra(p_res, "\"MBps\":%.1f,\"cycles_per_pkt\":%.1f,\"msgs_per_pass\":%u",
+                (double)p_res->bytes * BENCH_NS_PER_SEC / 1e6 /
+                (p_res->elapsed_ns ? p_res->elapsed_ns : 1),
+                (double)total_cycles / ((uint64_t)h4r_cb.stream_pkts * iters),
+                h4r_cb.msgs);
+}
+
+static void h4r_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         ACL packets synthesized (default %d)\n"
+            "  -b bytes         ACL data length of the packets (default %d)\n"
+            "  -r file          replay the received packets of an H4 btsnoop capture\n"
+            "  -c bytes         rx buffer size (default %d, as read by userial)\n"
+            "  -i iters         passes over the stream per parser (default %d)\n",
+            p_prog, H4R_DEFAULT_PKTS, H4R_DEFAULT_ACL_LEN,
+            BTHC_USERIAL_READ_MEM_SIZE - BT_HC_HDR_SIZE, H4R_DEFAULT_ITERS);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    tBENCH_RESULT   res_byte, res_block;
+    uint32_t        hash_byte, hash_block;
+    uint32_t        num = H4R_DEFAULT_PKTS, iters = H4R_DEFAULT_ITERS;
+    uint16_t        acl_len = H4R_DEFAULT_ACL_LEN;
+    const char      *p_file = NULL;
+    int             opt, chunk = BTHC_USERIAL_READ_MEM_SIZE - BT_HC_HDR_SIZE;
+
+    while ((opt = getopt(argc, argv, "n:b:r:c:i:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': num = (uint32_t)atoi(optarg); break;
+            case 'b': acl_len = (uint16_t)atoi(optarg); break;
+            case 'r': p_file = optarg; break;
+            case 'c': chunk = atoi(optarg); break;
+            case 'i': iters = (uint32_t)atoi(optarg); break;
+            default:
+                h4r_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((chunk < 1) || (chunk > 0xFFFF) || (iters == 0) ||
+        (acl_len < 2 * L2CAP_HEADER_SIZE))
+    {
+        fprintf(stderr, "h4_replay: bad option value\n");
+        return 2;
+    }
+    h4r_cb.chunk = (uint16_t)chunk;
+
+    utils_init();
+    if (p_file != NULL)
+    {
+        if (h4r_load_btsnoop(p_file) != 0)
+            return 1;
+    }
+    else
+    {
+        h4r_synthesize(num, acl_len);
+    }
+
+    h4r_run("per_byte", h4r_receive_msg_per_byte, iters, &res_byte, &hash_byte);
+    h4r_run("block", hci_h4_receive_msg, iters, &res_block, &hash_block);
+
+    if (strcmp(res_byte.p_status, "ok") != 0)
+        res_block.p_status = res_byte.p_status;
+    else if ((hash_byte != hash_block) || (res_byte.count != res_block.count))
+        bench_fail(&res_block, "stack input differs from the per byte parser");
+
+    bench_print_result(stdout, "h4_replay", &res_byte);
+    bench_print_result(stdout, "h4_replay", &res_block);
+
+    bench_samples_free(&res_byte.samples);
+    bench_samples_free(&res_block.samples);
+    free(h4r_cb.p_stream);
+    utils_cleanup();
+
+    return (strcmp(res_block.p_status, "ok") != 0);
+}
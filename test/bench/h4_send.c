@@ -0,0 +1,550 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      h4_send.c
+ *
+ *  Description:   H4 ACL send benchmark against btemu
+ *
+ *                 Sends ACL packets longer than the controller's ACL data
+ *                 length through hci_h4_send_msg(), which cuts them in
+ *                 segments written with userial_writev() from the parent
+ *                 buffer, and through the one write() per segment loop it
+ *                 replaced, kept here as the reference. userial connects
+ *                 to tools/btemu as the stack does, on the unix socket
+ *                 BT_HCI_SOCKET names; h4_send.sh starts btemu for it.
+ *
+ *                 The controller is reset, its buffer size read and a link
+ *                 to a peer created with HCI commands. Packets are then
+ *                 sent as controller buffers are freed, by Number Of
+ *                 Completed Packets events, as L2CAP does. A run fails if
+ *                 btemu does not complete every segment, which it does not
+ *                 for malformed or excess segments. MB/s and system calls
+ *                 per packet of each are printed as JSON.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "bench_report.h"
+
+/* Writes to the port are counted on their way to the kernel */
+static uint32_t h4s_syscalls;
+
+static ssize_t h4s_write(int fd, const void *p_data, size_t len)
+{
+    h4s_syscalls++;
+    return write(fd, p_data, len);
+}
+
+static ssize_t h4s_writev(int fd, const struct iovec *p_iov, int iovcnt)
+{
+    h4s_syscalls++;
+    return writev(fd, p_iov, iovcnt);
+}
+
+#define write(fd, p, n)         h4s_write(fd, p, n)
+#define writev(fd, p, n)        h4s_writev(fd, p, n)
+
+/* The sender under test, and the port it writes to */
+#include "hci_h4.c"
+#undef LOG_TAG
+#include "userial.c"
+
+#undef write
+#undef writev
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define H4S_DEFAULT_PKTS        20000
+#define H4S_DEFAULT_PKT_LEN     4096        /* ACL data of a packet, e.g. OBEX */
+#define H4S_TIMEOUT_MS          5000
+
+/* room in front of the ACL header, as the stack leaves for the H4 indicator */
+#define H4S_OFFSET              8
+
+#define H4S_PEER_ADDR           {0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01}
+#define H4S_L2CAP_CID           0x0040
+
+#define H4S_HCI_RESET           0x0C03
+#define H4S_HCI_READ_BUF_SIZE   0x1005
+#define H4S_HCI_CREATE_CONN     0x0405
+
+#define H4S_EVT_CONN_CMPL       0x03
+#define H4S_EVT_CMD_CMPL        0x0E
+#define H4S_EVT_CMD_STATUS      0x0F
+#define H4S_EVT_NUM_CMPL        0x13
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef void (tH4S_SEND) (HC_BT_HDR *p_msg);
+
+typedef struct
+{
+    sem_t       rx_sem;
+
+    /* controller state, as the events tell it */
+    uint16_t    acl_len;
+    uint16_t    acl_bufs;
+    uint16_t    credits;            /* controller buffers free */
+    uint16_t    handle;
+    uint16_t    cmd_opcode;         /* of the last command complete or status */
+    uint8_t     cmd_status;
+    uint8_t     conn_done;
+    uint8_t     conn_status;
+    uint32_t    fragments;          /* handed back, never expected */
+} tH4S_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tH4S_CB h4s_cb;
+
+/*******************************************************************************
+**  Stubs of the HCI library around hci_h4.c and userial.c
+********************************************************************************/
+
+BUFFER_Q tx_q;
+
+/* Buffers carry the queue link in front, as the stack's GKI buffers do */
+static char *h4s_alloc(int size)
+{
+    char *p = (char *)malloc(BT_HC_BUFFER_HDR_SIZE + size);
+
+    return p ? (p + BT_HC_BUFFER_HDR_SIZE) : NULL;
+}
+
+static int h4s_dealloc(TRANSAC transac, char *p_buf)
+{
+    free((char *)transac - BT_HC_BUFFER_HDR_SIZE);
+    return 0;
+}
+
+static int h4s_tx_result(TRANSAC transac, char *p_buf, bt_hc_transmit_result_t result)
+{
+    if (result == BT_HC_TX_FRAGMENT)
+        h4s_cb.fragments++;
+    return h4s_dealloc(transac, p_buf);
+}
+
+/*******************************************************************************
+**
+** Function         h4s_data_ind
+**
+** Description      Takes the controller state from the events btemu sends.
+**
+** Returns          0
+**
+*******************************************************************************/
+static int h4s_data_ind(TRANSAC transac, char *p_buf, int len)
+{
+    HC_BT_HDR   *p_msg = (HC_BT_HDR *)transac;
+    uint8_t     *p = (uint8_t *)(p_msg + 1) + p_msg->offset;
+    uint8_t     code, num;
+    uint16_t    handle, count;
+
+    if ((p_msg->event & MSG_EVT_MASK) != MSG_HC_TO_STACK_HCI_EVT)
+        return h4s_dealloc(transac, p_buf);
+
+    code = *p;
+    p += 2;
+    switch (code)
+    {
+        case H4S_EVT_CMD_CMPL:
+            p++;
+            STREAM_TO_UINT16 (h4s_cb.cmd_opcode, p);
+            h4s_cb.cmd_status = *p++;
+            if ((h4s_cb.cmd_opcode == H4S_HCI_READ_BUF_SIZE) && (h4s_cb.cmd_status == 0))
+            {
+                STREAM_TO_UINT16 (h4s_cb.acl_len, p);
+                p++;
+                STREAM_TO_UINT16 (h4s_cb.acl_bufs, p);
+                h4s_cb.credits = h4s_cb.acl_bufs;
+            }
+            break;
+
+        case H4S_EVT_CMD_STATUS:
+            h4s_cb.cmd_status = *p++;
+            p++;
+            STREAM_TO_UINT16 (h4s_cb.cmd_opcode, p);
+            break;
+
+        case H4S_EVT_CONN_CMPL:
+            h4s_cb.conn_status = *p++;
+            STREAM_TO_UINT16 (h4s_cb.handle, p);
+            h4s_cb.conn_done = TRUE;
+            break;
+
+        case H4S_EVT_NUM_CMPL:
+            num = *p++;
+            while (num--)
+            {
+                STREAM_TO_UINT16 (handle, p);
+                STREAM_TO_UINT16 (count, p);
+                if (handle == h4s_cb.handle)
+                    h4s_cb.credits += count;
+            }
+            break;
+    }
+
+    return h4s_dealloc(transac, p_buf);
+}
+
+static bt_hc_callbacks_t h4s_cbacks =
+{
+    sizeof(bt_hc_callbacks_t),
+    NULL, NULL, NULL, NULL,
+    h4s_alloc,
+    h4s_dealloc,
+    h4s_data_ind,
+    h4s_tx_result
+};
+
+bt_hc_callbacks_t *bt_hc_cbacks = &h4s_cbacks;
+bt_vendor_interface_t *bt_vnd_if = NULL;
+
+void bthc_signal_event(uint16_t event)
+{
+    if (event & HC_EVENT_RX)
+        sem_post(&h4s_cb.rx_sem);
+}
+
+void btsnoop_init(void) {}
+void btsnoop_close(void) {}
+void btsnoop_cleanup(void) {}
+void btsnoop_capture(HC_BT_HDR *p_buf, uint8_t is_rcvd) {}
+void lpm_wake_assert(void) {}
+void lpm_tx_done(uint8_t is_tx_done) {}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         h4s_rx
+**
+** Description      Waits for what the userial reader thread queued and parses
+**                  it, as the HCI thread does on HC_EVENT_RX.
+**
+** Returns          FALSE on timeout
+**
+*******************************************************************************/
+static uint8_t h4s_rx(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += H4S_TIMEOUT_MS / 1000;
+
+    while (sem_timedwait(&h4s_cb.rx_sem, &ts) != 0)
+    {
+        if (errno != EINTR)
+            return FALSE;
+    }
+
+    hci_h4_receive_msg();
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         h4s_cmd
+**
+** Description      Sends an HCI command and waits for its Command Complete or
+**                  Command Status event.
+**
+** Returns          TRUE if it succeeded
+**
+*******************************************************************************/
+static uint8_t h4s_cmd(uint16_t opcode, const uint8_t *p_param, uint8_t len)
+{
+    HC_BT_HDR   *p_msg;
+    uint8_t     *p;
+
+    if ((p_msg = (HC_BT_HDR *)h4s_alloc(BT_HC_HDR_SIZE + H4S_OFFSET + 3 + len)) == NULL)
+        return FALSE;
+
+    p_msg->event = MSG_STACK_TO_HC_HCI_CMD;
+    p_msg->offset = H4S_OFFSET;
+    p_msg->len = 3 + len;
+    p_msg->layer_specific = 0;
+    p = (uint8_t *)(p_msg + 1) + p_msg->offset;
+    UINT16_TO_STREAM (p, opcode);
+    *p++ = len;
+    memcpy(p, p_param, len);
+
+    h4s_cb.cmd_opcode = 0;
+    hci_h4_send_msg(p_msg);
+
+    while (h4s_cb.cmd_opcode != opcode)
+    {
+        if (!h4s_rx())
+            return FALSE;
+    }
+    return (h4s_cb.cmd_status == 0);
+}
+
+/*******************************************************************************
+**
+** Function         h4s_connect
+**
+** Description      Resets btemu, reads its buffer size and connects to the
+**                  first peer.
+**
+** Returns          TRUE if connected
+**
+*******************************************************************************/
+static uint8_t h4s_connect(void)
+{
+    uint8_t param[13] = H4S_PEER_ADDR;
+    uint8_t bd_addr[6] = H4S_PEER_ADDR;
+    uint8_t xx;
+
+    /* the address goes LSB first, packet types DM1 DH1 DM3 DH3 DM5 DH5 */
+    for (xx = 0; xx < 6; xx++)
+        param[xx] = bd_addr[5 - xx];
+    param[6] = 0x18;
+    param[7] = 0xCC;
+    param[8] = param[9] = param[10] = param[11] = param[12] = 0;
+
+    if (!h4s_cmd(H4S_HCI_RESET, NULL, 0) ||
+        !h4s_cmd(H4S_HCI_READ_BUF_SIZE, NULL, 0) ||
+        !h4s_cmd(H4S_HCI_CREATE_CONN, param, sizeof(param)))
+        return FALSE;
+
+    while (!h4s_cb.conn_done)
+    {
+        if (!h4s_rx())
+            return FALSE;
+    }
+
+    /* what hci_h4 learns from its own HCI_Read_Buffer_Size */
+    h4_cb.hc_acl_data_size = h4s_cb.acl_len;
+    return (h4s_cb.conn_status == 0) && (h4s_cb.acl_len != 0) && (h4s_cb.acl_bufs != 0);
+}
+
+/*******************************************************************************
+**
+** Function         h4s_send_per_segment
+**
+** Description      hci_h4_send_msg() as it was before segments were written
+**                  with userial_writev(): one userial_write() per segment,
+**                  the ACL header of the next segment written over the end
+**                  of the payload just sent. The last segment goes through
+**                  hci_h4_send_msg(), which sends it as before.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void h4s_send_per_segment(HC_BT_HDR *p_msg)
+{
+    uint16_t    acl_data_size = h4_cb.hc_acl_data_size;
+    uint16_t    acl_pkt_size = acl_data_size + HCI_ACL_PREAMBLE_SIZE;
+    uint16_t    handle;
+    uint8_t     *p = ((uint8_t *)(p_msg + 1)) + p_msg->offset;
+
+    STREAM_TO_UINT16 (handle, p);
+    handle = (handle & 0xCFFF) | 0x1000;
+
+    while (p_msg->len > acl_pkt_size)
+    {
+        p = ((uint8_t *)(p_msg + 1)) + p_msg->offset - 1;
+        *p = H4_TYPE_ACL_DATA;
+        userial_write(MSG_STACK_TO_HC_HCI_ACL, p, acl_pkt_size + 1);
+
+        p_msg->offset += acl_data_size;
+        p_msg->len    -= acl_data_size;
+
+        p = ((uint8_t *)(p_msg + 1)) + p_msg->offset;
+        UINT16_TO_STREAM (p, handle);
+        if (p_msg->len > acl_pkt_size)
+        {
+            UINT16_TO_STREAM (p, acl_data_size);
+        }
+        else
+        {
+            UINT16_TO_STREAM (p, p_msg->len - HCI_ACL_PREAMBLE_SIZE);
+        }
+    }
+
+    hci_h4_send_msg(p_msg);
+}
+
+/*******************************************************************************
+**
+** Function         h4s_run
+**
+** Description      Sends num packets of pkt_len bytes of ACL data, each once
+**                  the controller has buffers for all its segments, and
+**                  waits for the last of them to be completed.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void h4s_run(const char *p_name, tH4S_SEND *p_send, uint32_t num, uint16_t pkt_len,
+                    tBENCH_RESULT *p_res)
+{
+    HC_BT_HDR   *p_msg;
+    uint8_t     *p;
+    uint16_t    segs = (pkt_len + h4s_cb.acl_len - 1) / h4s_cb.acl_len;
+    uint32_t    xx;
+    uint64_t    t0;
+
+    bench_result_init(p_res);
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"send\":\"%s\",\"pkt_len\":%u,\"acl_len\":%u,\"acl_bufs\":%u,\"segs_per_pkt\":%u",
+             p_name, pkt_len, h4s_cb.acl_len, h4s_cb.acl_bufs, segs);
+
+    if (segs > h4s_cb.acl_bufs)
+    {
+        bench_fail(p_res, "a packet needs more than %u controller buffers", h4s_cb.acl_bufs);
+        return;
+    }
+
+    h4s_syscalls = 0;
+    t0 = bench_now_ns();
+
+    for (xx = 0; xx < num; xx++)
+    {
+        while (h4s_cb.credits < segs)
+        {
+            if (!h4s_rx())
+            {
+                bench_fail(p_res, "packet %u: no buffers completed in %u ms", xx, H4S_TIMEOUT_MS);
+                return;
+            }
+        }
+
+        if ((p_msg = (HC_BT_HDR *)h4s_alloc(BT_HC_HDR_SIZE + H4S_OFFSET +
+                                             HCI_ACL_PREAMBLE_SIZE + pkt_len)) == NULL)
+        {
+            bench_fail(p_res, "out of memory");
+            return;
+        }
+        p_msg->event = MSG_STACK_TO_HC_HCI_ACL | LOCAL_BR_EDR_CONTROLLER_ID;
+        p_msg->offset = H4S_OFFSET;
+        p_msg->len = HCI_ACL_PREAMBLE_SIZE + pkt_len;
+        p_msg->layer_specific = 0;
+
+        /* an L2CAP frame, the start automatically flushable, with the ACL
+        ** length of its first segment as l2cu_set_acl_hci_header() sets it */
+        p = (uint8_t *)(p_msg + 1) + p_msg->offset;
+        UINT16_TO_STREAM (p, h4s_cb.handle | 0x2000);
+        UINT16_TO_STREAM (p, (segs > 1) ? h4s_cb.acl_len : pkt_len);
+        UINT16_TO_STREAM (p, pkt_len - L2CAP_HEADER_SIZE);
+        UINT16_TO_STREAM (p, H4S_L2CAP_CID);
+        memset(p, (uint8_t)xx, pkt_len - L2CAP_HEADER_SIZE);
+
+        h4s_cb.credits -= segs;
+        (*p_send)(p_msg);
+    }
+
+    while (h4s_cb.credits < h4s_cb.acl_bufs)
+    {
+        if (!h4s_rx())
+        {
+            bench_fail(p_res, "btemu completed %u of %u buffers at the end",
+                       h4s_cb.credits, h4s_cb.acl_bufs);
+            return;
+        }
+    }
+
+    p_res->elapsed_ns = bench_now_ns() - t0;
+    p_res->count = num;
+    p_res->bytes = (uint64_t)num * pkt_len;
+    if (h4s_cb.fragments)
+        bench_fail(p_res, "%u packets handed back as fragments", h4s_cb.fragments);
+
+    bench_extra(p_res, "\"syscalls_per_pkt\":%.2f", (double)h4s_syscalls / num);
+}
+
+static void h4s_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         ACL packets sent per sender (default %d)\n"
+            "  -b bytes         ACL data length of the packets (default %d)\n"
+            "The controller is the btemu listening on $%s.\n",
+            p_prog, H4S_DEFAULT_PKTS, H4S_DEFAULT_PKT_LEN, USERIAL_SOCKET_ENV);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    tBENCH_RESULT   res_seg, res_iov;
+    uint32_t        num = H4S_DEFAULT_PKTS;
+    int             opt, pkt_len = H4S_DEFAULT_PKT_LEN;
+
+    while ((opt = getopt(argc, argv, "n:b:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': num = (uint32_t)atoi(optarg); break;
+            case 'b': pkt_len = atoi(optarg); break;
+            default:
+                h4s_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((num == 0) || (pkt_len < L2CAP_HEADER_SIZE) || (pkt_len > 0xFFFF - HCI_ACL_PREAMBLE_SIZE))
+    {
+        fprintf(stderr, "h4_send: bad option value\n");
+        return 2;
+    }
+    if (getenv(USERIAL_SOCKET_ENV) == NULL)
+    {
+        fprintf(stderr, "h4_send: set %s to the socket of a btemu\n", USERIAL_SOCKET_ENV);
+        return 2;
+    }
+
+    sem_init(&h4s_cb.rx_sem, 0, 0);
+    utils_init();
+    hci_h4_init();
+    userial_init();
+    if (!userial_open(USERIAL_PORT_1) || !h4s_connect())
+    {
+        fprintf(stderr, "h4_send: no link with btemu\n");
+        return 1;
+    }
+
+    h4s_run("per_segment", h4s_send_per_segment, num, (uint16_t)pkt_len, &res_seg);
+    h4s_run("writev", hci_h4_send_msg, num, (uint16_t)pkt_len, &res_iov);
+
+    bench_print_result(stdout, "h4_send", &res_seg);
+    bench_print_result(stdout, "h4_send", &res_iov);
+
+    userial_close();
+    utils_cleanup();
+
+    return (strcmp(res_seg.p_status, "ok") != 0) || (strcmp(res_iov.p_status, "ok") != 0);
+}
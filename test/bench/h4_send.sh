@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+#  Copyright (C) 2009-2012 Broadcom Corporation
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at:
+#
+#  http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS,
+#  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#  See the License for the specific language governing permissions and
+#  limitations under the License.
+#
+#  Runs h4_send against a btemu of its own.
+#
+#  usage: h4_send.sh <btemu> <h4_send> [h4_send options]
+#
+#  btemu sinks the ACL data; BTEMU_OPTS adds to its options. The run fails
+#  if h4_send fails or btemu saw a malformed segment or a buffer overrun.
+
+if [ $# -lt 2 ]; then
+    echo "usage: $0 <btemu> <h4_send> [h4_send options]" >&2
+    exit 2
+fi
+
+BTEMU=$1
+H4_SEND=$2
+shift 2
+
+DIR=${TMPDIR:-/tmp}
+SOCK=$DIR/h4_send.$$.sock
+STATS=$DIR/h4_send.$$.stats
+
+"$BTEMU" -u "$SOCK" -m sink -B 64 $BTEMU_OPTS > "$STATS" &
+EMU_PID=$!
+
+tries=0
+while [ ! -S "$SOCK" ]; do
+    tries=$((tries + 1))
+    if [ $tries -gt 50 ] || ! kill -0 $EMU_PID 2> /dev/null; then
+        echo "h4_send.sh: btemu did not start" >&2
+        kill $EMU_PID 2> /dev/null
+        rm -f "$STATS"
+        exit 1
+    fi
+    sleep 0.1
+done
+
+BT_HCI_SOCKET=$SOCK "$H4_SEND" "$@"
+ret=$?
+
+kill -TERM $EMU_PID
+wait $EMU_PID
+cat "$STATS"
+
+if ! grep -q '"buf_overruns":0,"acl_bad":0' "$STATS"; then
+    echo "h4_send.sh: btemu saw bad or excess ACL segments" >&2
+    ret=1
+fi
+
+rm -f "$STATS" "$SOCK"
+exit $ret
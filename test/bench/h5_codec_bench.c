@@ -0,0 +1,480 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      h5_codec_bench.c
+ *
+ *  Description:   H5 CRC and SLIP codec throughput benchmark
+ *
+ *                 Built from bt_crc.c and from hci_h5.c, included here to
+ *                 reach its static SLIP coder and receive state machine.
+ *                 Each case runs the code of the tree against the one it
+ *                 replaced, kept here as the reference, over frames of
+ *                 random bytes, and over frames one byte in four of which
+ *                 SLIP escapes.
+ *
+ *                 crc_h5       bt_crc16_ccitt() against the nibble table
+ *                              hci_h5.c had
+ *                 crc_fcs      bt_crc16() against the byte table
+ *                              l2c_fcr_updcrc() had
+ *                 slip_encode  h5_slip_block() against h5_slip_one_byte()
+ *                              for each byte
+ *                 slip_decode  The payload of a frame with a CRC through
+ *                              h5_recv(), against h5_unslip_one_byte() for
+ *                              each byte
+ *
+ *                 Every frame is checked against the reference before the
+ *                 timed pass: the same CRC, the same SLIP bytes, or the
+ *                 payload and its CRC back from the decoder. A mismatch
+ *                 fails the case.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "bench_report.h"
+
+/* bionic names, which hci_h5.c takes for granted */
+#define __packed                __attribute__((packed))
+#define ALOGD(...)
+
+/* The codec under test, with its static SLIP coder and receive state */
+#include "hci_h5.c"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define H5C_DEFAULT_FRAMES      20000
+#define H5C_DEFAULT_FRAME_LEN   1021        /* an ACL packet */
+#define H5C_MAX_FRAME_LEN       0xFFF       /* H5 payload length field */
+#define H5C_POOL_FRAMES         64
+
+/* one byte in this many is one SLIP escapes, in the dense frames */
+#define H5C_DENSE_EVERY         4
+
+#define H5C_CRC_CCITT_POLY      0x8408      /* bit reversed */
+#define H5C_CRC16_POLY          0xA001      /* bit reversed */
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    uint8_t     *p_data;
+    uint8_t     *p_slip;                /* SLIP encoded by the reference */
+    uint32_t    slip_len;
+} tH5C_FRAME;
+
+typedef struct
+{
+    /* settings */
+    uint32_t    num_frames;
+    uint32_t    frame_len;
+
+    uint32_t    seed;
+    tH5C_FRAME  pool[H5C_POOL_FRAMES];
+    uint16_t    fcs_table[256];
+    uint16_t    sink;                   /* keeps the CRCs computed */
+} tH5C_CB;
+
+/* What a case runs once per frame, the tree's code or the reference */
+typedef uint32_t (tH5C_FN) (tH5C_FRAME *p_frame, uint8_t check);
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tH5C_CB h5c_cb;
+
+static const char *h5c_mix_name[] = { "random", "dense" };
+
+/* the H5 CRC table hci_h5.c had, for a nibble at a time */
+static const uint16_t h5c_nibble_table[] =
+{
+    0x0000, 0x1081, 0x2102, 0x3183,
+    0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xa50a, 0xb58b,
+    0xc60c, 0xd68d, 0xe70e, 0xf78f
+};
+
+/*******************************************************************************
+**  Stubs of the HCI library around hci_h5.c
+********************************************************************************/
+
+bt_hc_callbacks_t *bt_hc_cbacks = NULL;
+
+void btsnoop_init(void) {}
+void btsnoop_close(void) {}
+void btsnoop_cleanup(void) {}
+void btsnoop_capture(HC_BT_HDR *p_buf, uint8_t is_rcvd) {}
+uint16_t userial_read(uint16_t msg_id, uint8_t *p_buffer, uint16_t len) { return 0; }
+uint16_t userial_write(uint16_t msg_id, uint8_t *p_data, uint16_t len) { return len; }
+void utils_queue_init(BUFFER_Q *p_q) {}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static uint32_t h5c_rand(void)
+{
+    h5c_cb.seed = h5c_cb.seed * 1103515245 + 12345;
+    return h5c_cb.seed >> 8;
+}
+
+/*******************************************************************************
+**
+** Function         h5c_fill
+**
+** Description      Fills the frame pool with random bytes, or with one byte
+**                  SLIP escapes in every H5C_DENSE_EVERY if dense, and
+**                  encodes each frame with the reference.
+**
+** Returns          FALSE if out of memory
+**
+*******************************************************************************/
+static uint8_t h5c_fill(uint8_t dense)
+{
+    static const uint8_t esc[] = { 0xc0, 0xdb, 0x11, 0x13 };
+    tH5C_FRAME  *p_frame;
+    sk_buff     *skb;
+    uint32_t    xx, yy;
+
+    for (xx = 0; xx < H5C_POOL_FRAMES; xx++)
+    {
+        p_frame = &h5c_cb.pool[xx];
+        for (yy = 0; yy < h5c_cb.frame_len; yy++)
+        {
+            if (dense && ((h5c_rand() % H5C_DENSE_EVERY) == 0))
+                p_frame->p_data[yy] = esc[h5c_rand() % sizeof(esc)];
+            else
+                p_frame->p_data[yy] = (uint8_t)h5c_rand();
+        }
+
+        if ((skb = skb_alloc(2 * h5c_cb.frame_len)) == NULL)
+            return FALSE;
+        for (yy = 0; yy < h5c_cb.frame_len; yy++)
+            h5_slip_one_byte(skb, p_frame->p_data[yy]);
+        p_frame->slip_len = skb_get_data_length(skb);
+        memcpy(p_frame->p_slip, skb_get_data(skb), p_frame->slip_len);
+        skb_free(&skb);
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         h5c_crc_bitwise
+**
+** Description      A bit reversed CRC-16, one bit at a time: what both the
+**                  tree's CRCs and the references are checked against.
+**
+** Returns          CRC
+**
+*******************************************************************************/
+static uint16_t h5c_crc_bitwise(uint16_t crc, uint16_t poly, const uint8_t *p, uint32_t len)
+{
+    int i;
+
+    while (len--)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
+    }
+    return crc;
+}
+
+/* crc_h5 */
+static uint32_t h5c_crc_h5_nibble(tH5C_FRAME *p_frame, uint8_t check)
+{
+    uint16_t    reg = 0xffff;
+    uint8_t     d;
+    uint32_t    xx;
+
+    for (xx = 0; xx < h5c_cb.frame_len; xx++)
+    {
+        d = p_frame->p_data[xx];
+        reg = (reg >> 4) ^ h5c_nibble_table[(reg ^ d) & 0x000f];
+        reg = (reg >> 4) ^ h5c_nibble_table[(reg ^ (d >> 4)) & 0x000f];
+    }
+    h5c_cb.sink += reg;
+
+    return !check || (reg == h5c_crc_bitwise(0xffff, H5C_CRC_CCITT_POLY, p_frame->p_data,
+                                             h5c_cb.frame_len));
+}
+
+static uint32_t h5c_crc_h5_tree(tH5C_FRAME *p_frame, uint8_t check)
+{
+    uint16_t crc = bt_crc16_ccitt(0xffff, p_frame->p_data, h5c_cb.frame_len);
+
+    h5c_cb.sink += crc;
+
+    return !check || (crc == h5c_crc_bitwise(0xffff, H5C_CRC_CCITT_POLY, p_frame->p_data,
+                                             h5c_cb.frame_len));
+}
+
+/* crc_fcs */
+static uint32_t h5c_crc_fcs_byte(tH5C_FRAME *p_frame, uint8_t check)
+{
+    uint16_t    crc = 0;
+    uint8_t     *cp = p_frame->p_data;
+    uint32_t    cnt = h5c_cb.frame_len;
+
+    while (cnt--)
+        crc = ((crc >> 8) & 0xff) ^ h5c_cb.fcs_table[(crc & 0xff) ^ *cp++];
+    h5c_cb.sink += crc;
+
+    return !check || (crc == h5c_crc_bitwise(0, H5C_CRC16_POLY, p_frame->p_data,
+                                             h5c_cb.frame_len));
+}
+
+static uint32_t h5c_crc_fcs_tree(tH5C_FRAME *p_frame, uint8_t check)
+{
+    uint16_t crc = bt_crc16(0, p_frame->p_data, h5c_cb.frame_len);
+
+    h5c_cb.sink += crc;
+
+    return !check || (crc == h5c_crc_bitwise(0, H5C_CRC16_POLY, p_frame->p_data,
+                                             h5c_cb.frame_len));
+}
+
+/* slip_encode */
+static uint32_t h5c_encode_check(tH5C_FRAME *p_frame, sk_buff *skb, uint8_t check)
+{
+    uint32_t ok = !check || ((skb_get_data_length(skb) == p_frame->slip_len) &&
+                             !memcmp(skb_get_data(skb), p_frame->p_slip, p_frame->slip_len));
+
+    skb_free(&skb);
+    return ok;
+}
+
+static uint32_t h5c_encode_byte(tH5C_FRAME *p_frame, uint8_t check)
+{
+    sk_buff     *skb = skb_alloc(2 * h5c_cb.frame_len);
+    uint32_t    xx;
+
+    for (xx = 0; xx < h5c_cb.frame_len; xx++)
+        h5_slip_one_byte(skb, p_frame->p_data[xx]);
+
+    return h5c_encode_check(p_frame, skb, check);
+}
+
+static uint32_t h5c_encode_tree(tH5C_FRAME *p_frame, uint8_t check)
+{
+    sk_buff *skb = skb_alloc(2 * h5c_cb.frame_len);
+
+    h5_slip_block(skb, p_frame->p_data, h5c_cb.frame_len);
+
+    return h5c_encode_check(p_frame, skb, check);
+}
+
+/*******************************************************************************
+**
+** Function         h5c_decode_start
+**
+** Description      Sets the receive state machine up as h5_recv() leaves it
+**                  after the header of a frame with a CRC.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void h5c_decode_start(void)
+{
+    H5_PKT_HEADER *p_hdr;
+
+    rtk_h5.rx_skb = skb_alloc(0x1005);
+    p_hdr = (H5_PKT_HEADER *)skb_put(rtk_h5.rx_skb, sizeof(H5_PKT_HEADER));
+    memset(p_hdr, 0, sizeof(H5_PKT_HEADER));
+    p_hdr->DicPresent = 1;
+    p_hdr->PktType = HCI_ACLDATA_PKT;
+    p_hdr->PayloadLen = h5c_cb.frame_len;
+
+    rtk_h5.rx_state = H5_W4_DATA;
+    rtk_h5.rx_count = h5c_cb.frame_len;
+    rtk_h5.rx_esc_state = H5_ESCSTATE_NOESC;
+    H5_CRC_INIT(rtk_h5.message_crc);
+}
+
+static uint32_t h5c_decode_check(tH5C_FRAME *p_frame, uint8_t check)
+{
+    uint32_t ok = !check ||
+                  ((rtk_h5.rx_count == 0) &&
+                   (skb_get_data_length(rtk_h5.rx_skb) == sizeof(H5_PKT_HEADER) + h5c_cb.frame_len) &&
+                   !memcmp(skb_get_data(rtk_h5.rx_skb) + sizeof(H5_PKT_HEADER), p_frame->p_data,
+                           h5c_cb.frame_len) &&
+                   (rtk_h5.message_crc == h5c_crc_bitwise(0xffff, H5C_CRC_CCITT_POLY, p_frame->p_data,
+                                                          h5c_cb.frame_len)));
+
+    skb_free(&rtk_h5.rx_skb);
+    return ok;
+}
+
+/* h5_recv() as it was before runs were scanned: one byte at a time */
+static uint32_t h5c_decode_byte(tH5C_FRAME *p_frame, uint8_t check)
+{
+    uint32_t xx;
+
+    h5c_decode_start();
+    for (xx = 0; (xx < p_frame->slip_len) && rtk_h5.rx_count; xx++)
+        h5_unslip_one_byte(&rtk_h5, p_frame->p_slip[xx]);
+
+    return h5c_decode_check(p_frame, check);
+}
+
+static uint32_t h5c_decode_tree(tH5C_FRAME *p_frame, uint8_t check)
+{
+    h5c_decode_start();
+    h5_recv(&rtk_h5, p_frame->p_slip, p_frame->slip_len);
+
+    return h5c_decode_check(p_frame, check);
+}
+
+/*******************************************************************************
+**
+** Function         h5c_run
+**
+** Description      Checks every frame of the pool, then runs num_frames of
+**                  them through the code.
+**
+** Returns          TRUE if every frame checked
+**
+*******************************************************************************/
+static uint8_t h5c_run(const char *p_case, const char *p_impl, int mix, tH5C_FN *p_fn)
+{
+    tBENCH_RESULT   res;
+    uint32_t        xx;
+    uint64_t        t0;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params),
+             "\"case\":\"%s\",\"impl\":\"%s\",\"mix\":\"%s\",\"frame_len\":%u",
+             p_case, p_impl, h5c_mix_name[mix], h5c_cb.frame_len);
+
+    for (xx = 0; xx < H5C_POOL_FRAMES; xx++)
+    {
+        if (!(*p_fn)(&h5c_cb.pool[xx], TRUE))
+        {
+            bench_fail(&res, "frame %u does not match the reference", xx);
+            break;
+        }
+    }
+
+    if (xx == H5C_POOL_FRAMES)
+    {
+        t0 = bench_now_ns();
+        for (xx = 0; xx < h5c_cb.num_frames; xx++)
+            (*p_fn)(&h5c_cb.pool[xx % H5C_POOL_FRAMES], FALSE);
+        res.elapsed_ns = bench_now_ns() - t0;
+
+        res.count = h5c_cb.num_frames;
+        res.bytes = (uint64_t)h5c_cb.num_frames * h5c_cb.frame_len;
+    }
+
+    bench_print_result(stdout, "h5_codec", &res);
+    return (strcmp(res.p_status, "ok") == 0);
+}
+
+static void h5c_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         frames per case (default %d)\n"
+            "  -b bytes         frame length (default %d, max %d)\n",
+            p_prog, H5C_DEFAULT_FRAMES, H5C_DEFAULT_FRAME_LEN, H5C_MAX_FRAME_LEN);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    uint8_t     b;
+    int         opt, mix, i, failed = 0;
+
+    h5c_cb.num_frames = H5C_DEFAULT_FRAMES;
+    h5c_cb.frame_len = H5C_DEFAULT_FRAME_LEN;
+
+    while ((opt = getopt(argc, argv, "n:b:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': h5c_cb.num_frames = (uint32_t)atoi(optarg); break;
+            case 'b': h5c_cb.frame_len = (uint32_t)atoi(optarg); break;
+            default:
+                h5c_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((h5c_cb.num_frames == 0) || (h5c_cb.frame_len == 0) ||
+        (h5c_cb.frame_len > H5C_MAX_FRAME_LEN))
+    {
+        fprintf(stderr, "h5_codec_bench: bad option value\n");
+        return 2;
+    }
+
+    for (i = 0; i < H5C_POOL_FRAMES; i++)
+    {
+        h5c_cb.pool[i].p_data = (uint8_t *)malloc(h5c_cb.frame_len);
+        h5c_cb.pool[i].p_slip = (uint8_t *)malloc(2 * h5c_cb.frame_len);
+        if (!h5c_cb.pool[i].p_data || !h5c_cb.pool[i].p_slip)
+        {
+            fprintf(stderr, "h5_codec_bench: out of memory\n");
+            return 1;
+        }
+    }
+
+    /* the byte table l2c_fcr.c had */
+    for (i = 0; i < 256; i++)
+    {
+        b = (uint8_t)i;
+        h5c_cb.fcs_table[i] = h5c_crc_bitwise(0, H5C_CRC16_POLY, &b, 1);
+    }
+
+    h5c_cb.seed = 0x5EED;
+    for (mix = 0; mix < 2; mix++)
+    {
+        if (!h5c_fill((uint8_t)mix))
+        {
+            fprintf(stderr, "h5_codec_bench: out of memory\n");
+            return 1;
+        }
+
+        failed |= !h5c_run("crc_h5", "per_nibble", mix, h5c_crc_h5_nibble);
+        failed |= !h5c_run("crc_h5", "bt_crc", mix, h5c_crc_h5_tree);
+        failed |= !h5c_run("crc_fcs", "per_byte", mix, h5c_crc_fcs_byte);
+        failed |= !h5c_run("crc_fcs", "bt_crc", mix, h5c_crc_fcs_tree);
+        failed |= !h5c_run("slip_encode", "per_byte", mix, h5c_encode_byte);
+        failed |= !h5c_run("slip_encode", "scan", mix, h5c_encode_tree);
+        failed |= !h5c_run("slip_decode", "per_byte", mix, h5c_decode_byte);
+        failed |= !h5c_run("slip_decode", "scan", mix, h5c_decode_tree);
+    }
+
+    for (i = 0; i < H5C_POOL_FRAMES; i++)
+    {
+        free(h5c_cb.pool[i].p_data);
+        free(h5c_cb.pool[i].p_slip);
+    }
+    return failed;
+}
@@ -0,0 +1,343 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      media_clock_bench.c
+ *
+ *  Description:   A2DP source media clock jitter benchmark
+ *
+ *                 Built with btif_media_clock.c, the frame accounting of the
+ *                 media task.
+ *
+ *                 accuracy  ticks with simulated jitter and stalls, for every
+ *                           sampling rate and frame size, with and without
+ *                           partial frames sent ahead: the frames sent must
+ *                           stay within one frame of the pcm time elapsed
+ *                 tick      a CLOCK_MONOTONIC timerfd of 5, 10 and 20 ms, as
+ *                           the media clock thread runs it, optionally with
+ *                           threads spinning on every cpu: lateness of each
+ *                           tick, late ticks, and the frames sent at
+ *                           44.1 kHz against the time elapsed
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench_report.h"
+#include "btif_media_clock.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define MCB_DEFAULT_TICKS       1000        /* per period                     */
+#define MCB_DEFAULT_SIM_SECS    600         /* simulated per setting          */
+#define MCB_MAX_LOAD_THREADS    64
+
+#define MCB_SIM_PERIOD_US       10000
+#define MCB_SIM_STALL_US        60000       /* one tick in MCB_SIM_STALL_EVERY */
+#define MCB_SIM_STALL_EVERY     97
+
+/* setting of the tick cases: 44.1 kHz, 16 blocks of 8 subbands */
+#define MCB_TICK_RATE           44100
+#define MCB_TICK_FRAME_SAMPLES  128
+
+#define MCB_USEC_PER_SEC        1000000LL
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    volatile int    stop;
+    pthread_t       tid[MCB_MAX_LOAD_THREADS];
+    int             num;
+} tMCB_LOAD;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static const UINT32 mcb_rates[] = {16000, 32000, 44100, 48000};
+static const UINT32 mcb_frame_samples[] = {4 * 4, 8 * 8, 12 * 8, 16 * 8};
+static const UINT32 mcb_periods_ms[] = {5, 10, 20};
+
+static tMCB_LOAD mcb_load;
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static void *mcb_spin(void *p_arg)
+{
+    volatile uint64_t x = 0;
+
+    while (!mcb_load.stop)
+        x++;
+    return NULL;
+}
+
+static void mcb_load_start(int num)
+{
+    mcb_load.stop = 0;
+    for (mcb_load.num = 0; mcb_load.num < num; mcb_load.num++)
+    {
+        if (pthread_create(&mcb_load.tid[mcb_load.num], NULL, mcb_spin, NULL) != 0)
+            break;
+    }
+}
+
+static void mcb_load_stop(void)
+{
+    int xx;
+
+    mcb_load.stop = 1;
+    for (xx = 0; xx < mcb_load.num; xx++)
+        pthread_join(mcb_load.tid[xx], NULL);
+    mcb_load.num = 0;
+}
+
+/*******************************************************************************
+**
+** Function         mcb_run_accuracy
+**
+** Description      Feeds jittered and stalled ticks to the frame accounting
+**                  of every setting. The difference between the pcm time of
+**                  the frames sent and the time elapsed is taken after every
+**                  tick: it must stay below one frame behind, and with
+**                  partial frames sent ahead below one frame ahead.
+**
+** Returns          TRUE if every setting kept within bounds
+**
+*******************************************************************************/
+static BOOLEAN mcb_run_accuracy(UINT32 sim_secs)
+{
+    tBENCH_RESULT   res;
+    UINT32          rr, ff, up, ticks;
+    uint64_t        elapsed_us, step_us, rnd = 1, start;
+    int64_t         residue, sent, cost, dev;
+    double          max_ahead_us = 0, max_behind_us = 0;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"sim_secs\":%u,\"period_us\":%u",
+             sim_secs, MCB_SIM_PERIOD_US);
+    start = bench_now_ns();
+
+    for (rr = 0; rr < sizeof(mcb_rates) / sizeof(mcb_rates[0]); rr++)
+    for (ff = 0; ff < sizeof(mcb_frame_samples) / sizeof(mcb_frame_samples[0]); ff++)
+    for (up = 0; up < 2; up++)
+    {
+        residue = 0;
+        sent = 0;
+        elapsed_us = 0;
+        cost = (int64_t)mcb_frame_samples[ff] * MCB_USEC_PER_SEC;
+
+        for (ticks = 1; elapsed_us < (uint64_t)sim_secs * MCB_USEC_PER_SEC; ticks++)
+        {
+            /* late by up to a period, and a long stall now and then */
+            rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+            step_us = MCB_SIM_PERIOD_US + (rnd >> 33) % MCB_SIM_PERIOD_US;
+            if ((ticks % MCB_SIM_STALL_EVERY) == 0)
+                step_us = MCB_SIM_STALL_US;
+
+            elapsed_us += step_us;
+            sent += btif_media_clock_frames(&residue, step_us, mcb_rates[rr],
+                                            mcb_frame_samples[ff], (BOOLEAN)up);
+            res.count++;
+
+            /* samples x us sent ahead of the elapsed time */
+            dev = sent * cost - (int64_t)(elapsed_us * mcb_rates[rr]);
+            if ((dev <= -cost) || (up ? (dev >= cost) : (dev > 0)))
+            {
+                bench_fail(&res, "rate %u frame %u round up %u: %lld us off after %u ticks",
+                           mcb_rates[rr], mcb_frame_samples[ff], up,
+                           (long long)(dev / mcb_rates[rr]), ticks);
+                break;
+            }
+            if ((double)dev / mcb_rates[rr] > max_ahead_us)
+                max_ahead_us = (double)dev / mcb_rates[rr];
+            if ((double)-dev / mcb_rates[rr] > max_behind_us)
+                max_behind_us = (double)-dev / mcb_rates[rr];
+        }
+    }
+
+    res.elapsed_ns = bench_now_ns() - start;
+    bench_extra(&res, "\"max_ahead_us\":%.1f,\"max_behind_us\":%.1f",
+                max_ahead_us, max_behind_us);
+    bench_print_result(stdout, "media_clock_accuracy", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         mcb_run_tick
+**
+** Description      Runs a periodic timerfd as the media clock thread does and
+**                  converts each tick into frames from the time really
+**                  elapsed. Lateness is taken against the ideal time of the
+**                  expiration.
+**
+** Returns          TRUE if the frames sent match the time elapsed
+**
+*******************************************************************************/
+static BOOLEAN mcb_run_tick(UINT32 period_ms, UINT32 num_ticks, int load)
+{
+    tBENCH_RESULT       res;
+    struct itimerspec   its;
+    uint64_t            start, prev, now, due, expirations, done = 0;
+    uint64_t            period_ns = period_ms * BENCH_NS_PER_MS;
+    uint64_t            late_ticks = 0, max_gap_ns = 0;
+    int64_t             residue = 0, sent = 0, dev;
+    char                name[48];
+    int                 fd;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params),
+             "\"period_ms\":%u,\"ticks\":%u,\"load_threads\":%d,\"rate\":%u,\"frame_samples\":%u",
+             period_ms, num_ticks, load, MCB_TICK_RATE, MCB_TICK_FRAME_SAMPLES);
+    snprintf(name, sizeof(name), "media_clock_tick_%ums", period_ms);
+    res.p_samples_name = "lateness_us";
+    bench_samples_init(&res.samples, num_ticks);
+
+    if ((fd = timerfd_create(CLOCK_MONOTONIC, 0)) < 0)
+    {
+        bench_fail(&res, "timerfd_create failed");
+        bench_print_result(stdout, name, &res);
+        bench_samples_free(&res.samples);
+        return FALSE;
+    }
+
+    mcb_load_start(load);
+
+    memset(&its, 0, sizeof(its));
+    its.it_interval.tv_sec = period_ms / 1000;
+    its.it_interval.tv_nsec = (period_ms % 1000) * BENCH_NS_PER_MS;
+    its.it_value = its.it_interval;
+    start = prev = bench_now_ns();
+    timerfd_settime(fd, 0, &its, NULL);
+
+    while (res.count < num_ticks)
+    {
+        if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            continue;
+
+        now = bench_now_ns();
+        done += expirations;
+        due = start + done * period_ns;
+        bench_samples_add(&res.samples, (now > due) ? (now - due) : 0);
+
+        if (now - prev > period_ns + period_ns / 2)
+            late_ticks++;
+        if (now - prev > max_gap_ns)
+            max_gap_ns = now - prev;
+
+        sent += btif_media_clock_frames(&residue, (now - prev) / BENCH_NS_PER_US,
+                                        MCB_TICK_RATE, MCB_TICK_FRAME_SAMPLES, FALSE);
+        prev = now;
+        res.count++;
+    }
+
+    res.elapsed_ns = prev - start;
+    mcb_load_stop();
+    close(fd);
+
+    /* the us lost to rounding each tick is at most one per tick */
+    dev = sent * MCB_TICK_FRAME_SAMPLES * MCB_USEC_PER_SEC -
+          (int64_t)(res.elapsed_ns / BENCH_NS_PER_US) * MCB_TICK_RATE;
+    bench_extra(&res, "\"late_ticks\":%llu,\"max_gap_us\":%llu,\"frames\":%lld,"
+                "\"frames_due\":%.2f",
+                (unsigned long long)late_ticks,
+                (unsigned long long)(max_gap_ns / BENCH_NS_PER_US), (long long)sent,
+                (double)(res.elapsed_ns / BENCH_NS_PER_US) * MCB_TICK_RATE /
+                MCB_TICK_FRAME_SAMPLES / MCB_USEC_PER_SEC);
+    if ((dev > 0) ||
+        (-dev >= (int64_t)MCB_TICK_FRAME_SAMPLES * MCB_USEC_PER_SEC + (int64_t)res.count * MCB_TICK_RATE))
+    {
+        bench_fail(&res, "%lld frames sent for %.2f due", (long long)sent,
+                   (double)(res.elapsed_ns / BENCH_NS_PER_US) * MCB_TICK_RATE /
+                   MCB_TICK_FRAME_SAMPLES / MCB_USEC_PER_SEC);
+    }
+
+    bench_print_result(stdout, name, &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+static void mcb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n ticks         ticks per timerfd period (default %d)\n"
+            "  -s secs          simulated seconds per setting in the accuracy check (default %d)\n"
+            "  -l threads       threads spinning while the timerfd runs (default 0, max %d)\n"
+            "  -x               accuracy check only\n",
+            p_prog, MCB_DEFAULT_TICKS, MCB_DEFAULT_SIM_SECS, MCB_MAX_LOAD_THREADS);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    UINT32  ticks = MCB_DEFAULT_TICKS;
+    UINT32  sim_secs = MCB_DEFAULT_SIM_SECS;
+    BOOLEAN check_only = FALSE;
+    int     load = 0;
+    int     opt, failed = 0;
+    UINT32  xx;
+
+    while ((opt = getopt(argc, argv, "n:s:l:xh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': ticks = (UINT32)atoi(optarg); break;
+            case 's': sim_secs = (UINT32)atoi(optarg); break;
+            case 'l': load = atoi(optarg); break;
+            case 'x': check_only = TRUE; break;
+            default:
+                mcb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((ticks == 0) || (sim_secs == 0) || (load < 0) || (load > MCB_MAX_LOAD_THREADS))
+    {
+        fprintf(stderr, "media_clock_bench: bad option value\n");
+        return 2;
+    }
+
+    failed |= !mcb_run_accuracy(sim_secs);
+
+    if (check_only)
+        return failed;
+
+    for (xx = 0; xx < sizeof(mcb_periods_ms) / sizeof(mcb_periods_ms[0]); xx++)
+        failed |= !mcb_run_tick(mcb_periods_ms[xx], ticks, load);
+
+    return failed;
+}
@@ -0,0 +1,341 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      pan_tap_bench.c
+ *
+ *  Description:   PAN tap data path benchmark
+ *
+ *                 Built twice, as pan_tap_batch and pan_tap_single, from
+ *                 btif_pan.c with MAX_TAP_READ_PACKETS at its default and
+ *                 at 1, with btif_sock_thread.c and GKI. Creating a tap
+ *                 device needs CAP_NET_ADMIN, the tap is a SOCK_SEQPACKET
+ *                 socket pair instead, which keeps the frame boundaries
+ *                 a tap has. PAN is a peer that echoes every frame it gets
+ *                 from bta_pan_ci_rx_writebuf() back with btpan_tap_send().
+ *
+ *                 Like iperf, one thread sends IP frames into the tap, up
+ *                 to a window of frames in flight, and another receives the
+ *                 echo, checking the order and the content of every frame.
+ *
+ ******************************************************************************/
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <hardware/bluetooth.h>
+#include "bench_report.h"
+#include "gki.h"
+#include "bta_api.h"
+#include "bta_pan_api.h"
+#include "bd.h"
+#include "btif_common.h"
+#include "btif_util.h"
+#include "btif_sock_thread.h"
+#include "btif_pan_internal.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#if defined(MAX_TAP_READ_PACKETS) && (MAX_TAP_READ_PACKETS == 1)
+#define PTB_MODE                "single"
+#else
+#define PTB_MODE                "batch"
+#endif
+
+#define PTB_DEFAULT_FRAMES      200000
+#define PTB_DEFAULT_SIZE        1500        /* payload of a frame, an ethernet MTU */
+#define PTB_MAX_SIZE            1691        /* BNEP MTU of the PAN profile */
+#define PTB_DEFAULT_WINDOW      32
+#define PTB_HANDLE              1
+#define PTB_WAIT_SEC            5
+
+/* byte of a frame payload, behind its sequence number */
+#define PTB_PATTERN(seq, off)   ((UINT8)((seq) + (off)))
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    /* settings */
+    UINT32          frames;
+    int             size;
+    UINT32          window;
+
+    int             tap[2];         /* [0] the tap fd of btif_pan.c, [1] the network side */
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    UINT32          received;       /* echoed frames received, in order */
+    BOOLEAN         done;
+
+    /* counters, of the poll thread */
+    UINT32          pan_frames;     /* frames given to pan */
+    UINT32          echo_errors;    /* btpan_tap_send() failures */
+} tPTB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tPTB_CB ptb_cb;
+static const BD_ADDR ptb_peer_addr = {0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01};
+static const BD_ADDR ptb_net_addr = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+/*******************************************************************************
+**  Stubs of what GKI and btif_pan.c take from the rest of the stack
+********************************************************************************/
+
+UINT8 appl_trace_level = BT_TRACE_LEVEL_NONE;
+UINT8 btif_trace_level = BT_TRACE_LEVEL_NONE;
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+
+void bdcpy(BD_ADDR a, const BD_ADDR b)
+{
+    memcpy(a, b, BD_ADDR_LEN);
+}
+
+/* not reached, the connection is set up by the benchmark */
+void BTA_PanEnable(tBTA_PAN_CBACK p_cback) {}
+void BTA_PanDisable(void) {}
+void BTA_PanSetRole(tBTA_PAN_ROLE role, tBTA_PAN_ROLE_INFO *p_user_info,
+                    tBTA_PAN_ROLE_INFO *p_gn_info, tBTA_PAN_ROLE_INFO *p_nap_info) {}
+void BTA_PanOpen(BD_ADDR bd_addr, tBTA_PAN_ROLE local_role, tBTA_PAN_ROLE peer_role) {}
+void BTA_PanClose(UINT16 handle) {}
+void BTM_GetLocalDeviceAddr(BD_ADDR bd_addr) {}
+char *bd2str(bt_bdaddr_t *addr, bdstr_t *bdstr) { return (char *)bdstr; }
+bt_status_t btif_transfer_context(tBTIF_CBACK *p_cback, UINT16 event, char* p_params,
+                                  int param_len, tBTIF_COPY_CBACK *p_copy_cback)
+{
+    return BT_STATUS_FAIL;
+}
+
+/*******************************************************************************
+**
+** Function         bta_pan_ci_rx_writebuf
+**
+** Description      PAN, as a peer that echoes the frame back to the tap
+**
+** Returns          void
+**
+*******************************************************************************/
+void bta_pan_ci_rx_writebuf(UINT16 handle, BD_ADDR src, BD_ADDR dst, UINT16 protocol,
+                            BT_HDR *p_buf, BOOLEAN ext)
+{
+    ptb_cb.pan_frames++;
+    if (btpan_tap_send(btpan_cb.tap_fd, src, dst, protocol,
+                       (const char *)(p_buf + 1) + p_buf->offset, p_buf->len, ext, 0) < 0)
+        ptb_cb.echo_errors++;
+    GKI_freebuf(p_buf);
+}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/* network side sender, frames of ptb_cb.size bytes up to the window */
+static void *ptb_sender(void *p_arg)
+{
+    UINT8       frame[sizeof(tETH_HDR) + PTB_MAX_SIZE];
+    tETH_HDR    *p_hdr = (tETH_HDR *)frame;
+    UINT8       *p_data = frame + sizeof(tETH_HDR);
+    UINT32      seq;
+    int         xx, len = sizeof(tETH_HDR) + ptb_cb.size;
+
+    memcpy(p_hdr->h_dest, ptb_peer_addr, ETH_ADDR_LEN);
+    memcpy(p_hdr->h_src, ptb_net_addr, ETH_ADDR_LEN);
+    p_hdr->h_proto = htons(ETH_P_IP);
+
+    for (seq = 0; seq < ptb_cb.frames; seq++)
+    {
+        pthread_mutex_lock(&ptb_cb.lock);
+        while ((seq - ptb_cb.received >= ptb_cb.window) && !ptb_cb.done)
+            pthread_cond_wait(&ptb_cb.cond, &ptb_cb.lock);
+        pthread_mutex_unlock(&ptb_cb.lock);
+        if (ptb_cb.done)
+            break;
+
+        memcpy(p_data, &seq, sizeof(seq));
+        for (xx = sizeof(seq); xx < ptb_cb.size; xx++)
+            p_data[xx] = PTB_PATTERN(seq, xx);
+        if (send(ptb_cb.tap[1], frame, len, 0) != len)
+            break;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         ptb_check
+**
+** Description      Checks an echoed frame
+**
+** Returns          TRUE if it is frame seq as it was sent
+**
+*******************************************************************************/
+static BOOLEAN ptb_check(const UINT8 *p_frame, int len, UINT32 seq)
+{
+    const tETH_HDR  *p_hdr = (const tETH_HDR *)p_frame;
+    const UINT8     *p_data = p_frame + sizeof(tETH_HDR);
+    UINT32          got;
+    int             xx;
+
+    if ((len != (int)sizeof(tETH_HDR) + ptb_cb.size) || (ntohs(p_hdr->h_proto) != ETH_P_IP))
+        return FALSE;
+    memcpy(&got, p_data, sizeof(got));
+    if (got != seq)
+        return FALSE;
+    for (xx = sizeof(seq); xx < ptb_cb.size; xx++)
+    {
+        if (p_data[xx] != PTB_PATTERN(seq, xx))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void ptb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         frames (default %d)\n"
+            "  -s bytes         payload of a frame (default %d, max %d)\n"
+            "  -w count         frames in flight (default %d)\n",
+            p_prog, PTB_DEFAULT_FRAMES, PTB_DEFAULT_SIZE, PTB_MAX_SIZE, PTB_DEFAULT_WINDOW);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    tBENCH_RESULT   res;
+    pthread_t       sender;
+    UINT8           frame[sizeof(tETH_HDR) + PTB_MAX_SIZE + 1];
+    struct timeval  tv = {PTB_WAIT_SEC, 0};
+    uint64_t        start;
+    int             opt, xx, len;
+
+    ptb_cb.frames = PTB_DEFAULT_FRAMES;
+    ptb_cb.size = PTB_DEFAULT_SIZE;
+    ptb_cb.window = PTB_DEFAULT_WINDOW;
+
+    while ((opt = getopt(argc, argv, "n:s:w:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': ptb_cb.frames = (UINT32)atoi(optarg); break;
+            case 's': ptb_cb.size = atoi(optarg); break;
+            case 'w': ptb_cb.window = (UINT32)atoi(optarg); break;
+            default:
+                ptb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((ptb_cb.frames == 0) || (ptb_cb.size < (int)sizeof(UINT32)) ||
+        (ptb_cb.size > PTB_MAX_SIZE) || (ptb_cb.window == 0))
+    {
+        fprintf(stderr, "pan_tap_bench: bad option value\n");
+        return 2;
+    }
+
+    /* the tap, non-blocking as btpan_tap_open() leaves it */
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, ptb_cb.tap) < 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+    fcntl(ptb_cb.tap[0], F_SETFL, fcntl(ptb_cb.tap[0], F_GETFL) | O_NONBLOCK);
+    setsockopt(ptb_cb.tap[1], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    pthread_mutex_init(&ptb_cb.lock, NULL);
+    pthread_cond_init(&ptb_cb.cond, NULL);
+    GKI_init();
+    btsock_thread_init();
+
+    /* one connection to the peer, as after BTA_PAN_OPEN_EVT */
+    memset(&btpan_cb, 0, sizeof(btpan_cb));
+    for (xx = 0; xx < MAX_PAN_CONNS; xx++)
+        btpan_cb.conns[xx].handle = -1;
+    btpan_new_conn(PTB_HANDLE, ptb_peer_addr, BTA_PAN_ROLE_NAP, BTA_PAN_ROLE_PANU);
+    btpan_cb.tap_fd = ptb_cb.tap[0];
+    create_tap_read_thread(btpan_cb.tap_fd);
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"mode\":\"%s\",\"size\":%d,\"window\":%u",
+             PTB_MODE, ptb_cb.size, ptb_cb.window);
+
+    start = bench_now_ns();
+    pthread_create(&sender, NULL, ptb_sender, NULL);
+    while (ptb_cb.received < ptb_cb.frames)
+    {
+        if ((len = recv(ptb_cb.tap[1], frame, sizeof(frame), 0)) <= 0)
+        {
+            bench_fail(&res, "echo ended at frame %u", ptb_cb.received);
+            break;
+        }
+        if (!ptb_check(frame, len, ptb_cb.received))
+        {
+            bench_fail(&res, "frame %u differs", ptb_cb.received);
+            break;
+        }
+        pthread_mutex_lock(&ptb_cb.lock);
+        ptb_cb.received++;
+        pthread_cond_signal(&ptb_cb.cond);
+        pthread_mutex_unlock(&ptb_cb.lock);
+    }
+    res.elapsed_ns = bench_now_ns() - start;
+    res.count = ptb_cb.received;
+    res.bytes = (uint64_t)ptb_cb.received * (sizeof(tETH_HDR) + ptb_cb.size);
+
+    pthread_mutex_lock(&ptb_cb.lock);
+    ptb_cb.done = TRUE;
+    pthread_cond_signal(&ptb_cb.cond);
+    pthread_mutex_unlock(&ptb_cb.lock);
+    pthread_join(sender, NULL);
+
+    destroy_tap_read_thread();
+    if (ptb_cb.echo_errors)
+        bench_fail(&res, "%u frames not written to the tap", ptb_cb.echo_errors);
+    bench_extra(&res, "\"mbps\":%.1f,\"pan_frames\":%u",
+                res.elapsed_ns ? (double)res.bytes * 8 * 1000 / res.elapsed_ns : 0.0,
+                ptb_cb.pan_frames);
+    bench_print_result(stdout, "pan_tap_" PTB_MODE, &res);
+
+    close(ptb_cb.tap[0]);
+    close(ptb_cb.tap[1]);
+    return (strcmp(res.p_status, "failed") == 0);
+}
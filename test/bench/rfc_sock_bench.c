@@ -0,0 +1,586 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      rfc_sock_bench.c
+ *
+ *  Description:   RFCOMM socket data path benchmark
+ *
+ *                 Built from btif_sock_rfc.c, btif_sock_thread.c and GKI,
+ *                 with BTA JV replaced by a stack thread that does what
+ *                 PORT_WriteDataCO does with the data of the app and then
+ *                 loops every frame back, as a peer echoing it would. The
+ *                 app writes a pattern to its RFCOMM socket from one thread
+ *                 and reads the echo back in another, checking every byte.
+ *
+ *                 vector  the app data is read into up to PORT_CO_MAX_SEGS
+ *                         pool buffers with one readv(), as the stack does
+ *                 single  one recv() per pool buffer, with the former
+ *                         DATA_CO_CALLBACK_TYPE_OUTGOING call-out
+ *
+ *                 Incoming frames go to the app through the queue drained
+ *                 with sendmsg() in both modes.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <hardware/bluetooth.h>
+#include <hardware/bt_sock.h>
+#include "bench_report.h"
+#include "gki.h"
+#include "bta_api.h"
+#include "bta_jv_api.h"
+#include "bta_jv_co.h"
+#include "l2c_api.h"
+#include "port_api.h"
+#include "rfcdefs.h"
+#include "btif_sock_rfc.h"
+#include "btif_sock_thread.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define RSB_DEFAULT_BYTES       (32 * 1024 * 1024)
+#define RSB_DEFAULT_MTU         990         /* RFCOMM frame of a 1021 byte ACL */
+#define RSB_DEFAULT_WRITE       4096
+#define RSB_MAX_WRITE           65536
+#define RSB_CHANNEL             5
+#define RSB_HANDLE              1
+#define RSB_WAIT_SEC            10
+
+#define RSB_MODE_VECTOR         0
+#define RSB_MODE_SINGLE         1
+
+/* byte at an offset of the stream */
+#define RSB_PATTERN(off)        ((UINT8)((off) % 251))
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    /* settings */
+    UINT32          bytes;
+    UINT16          mtu;
+    int             write_size;
+    int             credits;
+    int             mode;
+
+    /* the connection, as BTA JV holds it */
+    tBTA_JV_RFCOMM_CBACK *p_cback;
+    void            *user_data;
+    int             app_fd;
+
+    /* stack thread */
+    pthread_t       stack_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    BOOLEAN         write_req;      /* BTA_JvRfcommWrite() called */
+    BOOLEAN         close_req;      /* BTA_JvRfcommClose() called */
+    BOOLEAN         exiting;
+    UINT32          flow_gen;       /* bumped by PORT_FlowControl(TRUE) */
+
+    /* counters */
+    UINT32          writes;         /* BTA_JvRfcommWrite() calls */
+    UINT32          callouts;       /* outgoing data call-outs */
+    UINT32          frames;
+    UINT32          flow_stops;
+    BOOLEAN         failed;
+} tRSB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tRSB_CB rsb_cb;
+
+/*******************************************************************************
+**  Stubs of what GKI and btif_sock_rfc.c take from the rest of the stack
+********************************************************************************/
+
+UINT8 appl_trace_level = BT_TRACE_LEVEL_NONE;
+UINT8 btif_trace_level = BT_TRACE_LEVEL_NONE;
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4) {}
+void LogMsg_5(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5) {}
+void uuid_to_string(bt_uuid_t *p_uuid, char *str) {}
+
+tBTA_JV_STATUS BTA_JvEnable(tBTA_JV_DM_CBACK *p_cback)
+{
+    return BTA_JV_SUCCESS;
+}
+
+tBTA_JV_STATUS BTA_JvRfcommConnect(tBTA_SEC sec_mask, tBTA_JV_ROLE role, UINT8 remote_scn,
+                                   BD_ADDR peer_bd_addr, tBTA_JV_RFCOMM_CBACK *p_cback,
+                                   void *user_data)
+{
+    rsb_cb.p_cback = p_cback;
+    rsb_cb.user_data = user_data;
+    return BTA_JV_SUCCESS;
+}
+
+UINT16 BTA_JvRfcommGetPortHdl(UINT32 handle)
+{
+    return RSB_HANDLE;
+}
+
+tBTA_JV_STATUS BTA_JvRfcommWrite(UINT32 handle, UINT32 req_id)
+{
+    pthread_mutex_lock(&rsb_cb.lock);
+    rsb_cb.write_req = TRUE;
+    rsb_cb.writes++;
+    pthread_cond_broadcast(&rsb_cb.cond);
+    pthread_mutex_unlock(&rsb_cb.lock);
+    return BTA_JV_SUCCESS;
+}
+
+tBTA_JV_STATUS BTA_JvRfcommClose(UINT32 handle)
+{
+    pthread_mutex_lock(&rsb_cb.lock);
+    rsb_cb.close_req = TRUE;
+    pthread_cond_broadcast(&rsb_cb.cond);
+    pthread_mutex_unlock(&rsb_cb.lock);
+    return BTA_JV_SUCCESS;
+}
+
+int PORT_FlowControl(UINT16 handle, BOOLEAN enable)
+{
+    pthread_mutex_lock(&rsb_cb.lock);
+    if (enable)
+        rsb_cb.flow_gen++;
+    pthread_cond_broadcast(&rsb_cb.cond);
+    pthread_mutex_unlock(&rsb_cb.lock);
+    return PORT_SUCCESS;
+}
+
+/* not reached with a connection made to a channel */
+BOOLEAN BTM_TryAllocateSCN(UINT8 scn) { return TRUE; }
+UINT8 BTM_AllocateSCN(void) { return 0; }
+BOOLEAN BTM_FreeSCN(UINT8 scn) { return TRUE; }
+tBTA_JV_STATUS BTA_JvRfcommStartServer(tBTA_SEC sec_mask, tBTA_JV_ROLE role, UINT8 local_scn,
+                                       UINT8 max_session, tBTA_JV_RFCOMM_CBACK *p_cback,
+                                       void *user_data) { return BTA_JV_FAILURE; }
+tBTA_JV_STATUS BTA_JvRfcommStopServer(UINT32 handle) { return BTA_JV_SUCCESS; }
+tBTA_JV_STATUS BTA_JvStartDiscovery(BD_ADDR bd_addr, UINT16 num_uuid, tSDP_UUID *p_uuid_list,
+                                    void *user_data) { return BTA_JV_FAILURE; }
+tBTA_JV_STATUS BTA_JvCreateRecordByUser(void *user_data) { return BTA_JV_FAILURE; }
+int add_rfc_sdp_rec(const char* name, const uint8_t* uuid, int scn) { return 0; }
+void del_rfc_sdp_rec(int handle) {}
+int get_reserved_rfc_channel(const uint8_t* uuid) { return -1; }
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static void rsb_signaled_cb(int fd, int type, int flags, uint32_t user_id)
+{
+    btsock_rfc_signaled(fd, flags, user_id);
+}
+
+/*******************************************************************************
+**
+** Function         rsb_deliver
+**
+** Description      Hands a frame looped back by the peer to btif, and waits
+**                  for btif to enable the data flow again when it stopped it
+**
+** Returns          void
+**
+*******************************************************************************/
+static void rsb_deliver(BT_HDR *p_buf)
+{
+    UINT32  gen;
+
+    pthread_mutex_lock(&rsb_cb.lock);
+    gen = rsb_cb.flow_gen;
+    pthread_mutex_unlock(&rsb_cb.lock);
+
+    rsb_cb.frames++;
+    if (bta_co_rfc_data_incoming(rsb_cb.user_data, p_buf) == 0)
+    {
+        rsb_cb.flow_stops++;
+        pthread_mutex_lock(&rsb_cb.lock);
+        while ((rsb_cb.flow_gen == gen) && !rsb_cb.close_req && !rsb_cb.exiting)
+            pthread_cond_wait(&rsb_cb.cond, &rsb_cb.lock);
+        pthread_mutex_unlock(&rsb_cb.lock);
+    }
+}
+
+static BT_HDR *rsb_getbuf(UINT16 len)
+{
+    BT_HDR  *p_buf;
+
+    if ((p_buf = (BT_HDR *)GKI_getpoolbuf(RFCOMM_DATA_POOL_ID)) != NULL)
+    {
+        p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+        p_buf->len = len;
+        p_buf->layer_specific = RSB_HANDLE;
+    }
+    return p_buf;
+}
+
+/*******************************************************************************
+**
+** Function         rsb_write_data
+**
+** Description      Takes the data the app wrote, as PORT_WriteDataCO does,
+**                  and loops every frame back
+**
+** Returns          FALSE if a call-out failed
+**
+*******************************************************************************/
+static BOOLEAN rsb_write_data(void)
+{
+    tPORT_CO_SEG    seg[PORT_CO_MAX_SEGS];
+    BT_HDR          *p_bufs[PORT_CO_MAX_SEGS];
+    UINT16          length;
+    int             available = 0, count, max_count, batch_len, i;
+
+    if (!bta_co_rfc_data_outgoing_size(rsb_cb.user_data, &available))
+        return FALSE;
+
+    length = RFCOMM_DATA_POOL_BUF_SIZE -
+             (UINT16)(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + RFCOMM_DATA_OVERHEAD);
+    if (rsb_cb.mtu < length)
+        length = rsb_cb.mtu;
+
+    max_count = (rsb_cb.mode == RSB_MODE_VECTOR) ? rsb_cb.credits : 1;
+    while (available > 0)
+    {
+        for (count = 0, batch_len = 0; (count < max_count) && (batch_len < available); count++)
+        {
+            if ((p_bufs[count] = rsb_getbuf((available - batch_len < length) ?
+                                            (UINT16)(available - batch_len) : length)) == NULL)
+                break;
+            seg[count].p_data = (UINT8 *)(p_bufs[count] + 1) + p_bufs[count]->offset;
+            seg[count].len = p_bufs[count]->len;
+            batch_len += p_bufs[count]->len;
+        }
+        if (count == 0)
+            return FALSE;
+
+        rsb_cb.callouts++;
+        if (((rsb_cb.mode == RSB_MODE_VECTOR) &&
+             !bta_co_rfc_data_outgoing_vector(rsb_cb.user_data, seg, count)) ||
+            ((rsb_cb.mode == RSB_MODE_SINGLE) &&
+             !bta_co_rfc_data_outgoing(rsb_cb.user_data, seg[0].p_data, seg[0].len)))
+        {
+            for (i = 0; i < count; i++)
+                GKI_freebuf(p_bufs[i]);
+            return FALSE;
+        }
+
+        for (i = 0; i < count; i++)
+            rsb_deliver(p_bufs[i]);
+        available -= batch_len;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         rsb_stack_thread
+**
+** Description      Runs the writes requested with BTA_JvRfcommWrite(), and
+**                  reports them done with BTA_JV_RFCOMM_WRITE_EVT
+**
+** Returns          NULL
+**
+*******************************************************************************/
+static void *rsb_stack_thread(void *p_arg)
+{
+    tBTA_JV evt;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&rsb_cb.lock);
+        while (!rsb_cb.write_req && !rsb_cb.exiting)
+            pthread_cond_wait(&rsb_cb.cond, &rsb_cb.lock);
+        rsb_cb.write_req = FALSE;
+        pthread_mutex_unlock(&rsb_cb.lock);
+        if (rsb_cb.exiting)
+            break;
+
+        if (!rsb_write_data())
+            rsb_cb.failed = TRUE;
+
+        memset(&evt, 0, sizeof(evt));
+        evt.rfc_write.status = BTA_JV_SUCCESS;
+        evt.rfc_write.handle = RSB_HANDLE;
+        rsb_cb.p_cback(BTA_JV_RFCOMM_WRITE_EVT, &evt, rsb_cb.user_data);
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         rsb_connect
+**
+** Description      Connects an RFCOMM socket as an app does, with the events
+**                  BTA JV sends when the peer accepts
+**
+** Returns          TRUE if the app got the channel and the connect signal
+**
+*******************************************************************************/
+static BOOLEAN rsb_connect(void)
+{
+    bt_bdaddr_t             addr = {{0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01}};
+    sock_connect_signal_t   cs;
+    tBTA_JV                 evt;
+    int                     scn;
+
+    if (btsock_rfc_connect(&addr, NULL, RSB_CHANNEL, &rsb_cb.app_fd, 0) != BT_STATUS_SUCCESS)
+        return FALSE;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.rfc_cl_init.status = BTA_JV_SUCCESS;
+    evt.rfc_cl_init.handle = RSB_HANDLE;
+    rsb_cb.p_cback(BTA_JV_RFCOMM_CL_INIT_EVT, &evt, rsb_cb.user_data);
+
+    memset(&evt, 0, sizeof(evt));
+    evt.rfc_open.status = BTA_JV_SUCCESS;
+    evt.rfc_open.handle = RSB_HANDLE;
+    memcpy(evt.rfc_open.rem_bda, addr.address, BD_ADDR_LEN);
+    rsb_cb.p_cback(BTA_JV_RFCOMM_OPEN_EVT, &evt, rsb_cb.user_data);
+
+    return (recv(rsb_cb.app_fd, &scn, sizeof(scn), MSG_WAITALL) == sizeof(scn)) &&
+           (scn == RSB_CHANNEL) &&
+           (recv(rsb_cb.app_fd, &cs, sizeof(cs), MSG_WAITALL) == sizeof(cs)) &&
+           (cs.status == 0);
+}
+
+/* app writer, the pattern in write_size blocks */
+static void *rsb_app_writer(void *p_arg)
+{
+    UINT8   buf[RSB_MAX_WRITE];
+    UINT32  off = 0;
+    int     len, sent, xx;
+
+    while (off < rsb_cb.bytes)
+    {
+        len = ((rsb_cb.bytes - off) < (UINT32)rsb_cb.write_size) ?
+              (int)(rsb_cb.bytes - off) : rsb_cb.write_size;
+        for (xx = 0; xx < len; xx++)
+            buf[xx] = RSB_PATTERN(off + xx);
+        if ((sent = send(rsb_cb.app_fd, buf, len, 0)) <= 0)
+            break;
+        off += sent;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         rsb_run
+**
+** Description      Runs one mode, from connect to close
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN rsb_run(int mode)
+{
+    tBENCH_RESULT   res;
+    tBTA_JV         evt;
+    struct timespec deadline;
+    pthread_t       writer;
+    UINT8           buf[RSB_MAX_WRITE];
+    uint64_t        start;
+    UINT32          off = 0;
+    int             len, xx, err = 0;
+    char            name[32];
+
+    rsb_cb.writes = rsb_cb.callouts = rsb_cb.frames = rsb_cb.flow_stops = 0;
+    rsb_cb.failed = FALSE;
+    rsb_cb.mode = mode;
+    rsb_cb.write_req = rsb_cb.close_req = rsb_cb.exiting = FALSE;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params),
+             "\"mode\":\"%s\",\"mtu\":%u,\"write\":%d,\"credits\":%d",
+             (mode == RSB_MODE_VECTOR) ? "vector" : "single", rsb_cb.mtu, rsb_cb.write_size,
+             rsb_cb.credits);
+    snprintf(name, sizeof(name), "rfc_sock_%s", (mode == RSB_MODE_VECTOR) ? "vector" : "single");
+
+    pthread_create(&rsb_cb.stack_thread, NULL, rsb_stack_thread, NULL);
+    if (!rsb_connect())
+    {
+        bench_fail(&res, "not connected");
+    }
+    else
+    {
+        start = bench_now_ns();
+        pthread_create(&writer, NULL, rsb_app_writer, NULL);
+        while (off < rsb_cb.bytes)
+        {
+            if ((len = recv(rsb_cb.app_fd, buf, sizeof(buf), 0)) <= 0)
+            {
+                bench_fail(&res, "echo ended at %u bytes", off);
+                break;
+            }
+            for (xx = 0; xx < len; xx++)
+            {
+                if (buf[xx] != RSB_PATTERN(off + xx))
+                    break;
+            }
+            if (xx < len)
+            {
+                bench_fail(&res, "echo differs at byte %u", off + xx);
+                break;
+            }
+            off += len;
+        }
+        res.elapsed_ns = bench_now_ns() - start;
+        res.bytes = off;
+        res.count = rsb_cb.frames;
+        if (strcmp(res.p_status, "failed") != 0)
+            pthread_join(writer, NULL);
+        else
+            pthread_detach(writer);
+        if (rsb_cb.failed)
+            bench_fail(&res, "outgoing call-out failed");
+    }
+
+    /* the app closes its socket, btif must close the connection */
+    if (rsb_cb.app_fd != -1)
+        close(rsb_cb.app_fd);
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += RSB_WAIT_SEC;
+    pthread_mutex_lock(&rsb_cb.lock);
+    while (!rsb_cb.close_req && (err == 0))
+        err = pthread_cond_timedwait(&rsb_cb.cond, &rsb_cb.lock, &deadline);
+    rsb_cb.exiting = TRUE;
+    pthread_cond_broadcast(&rsb_cb.cond);
+    pthread_mutex_unlock(&rsb_cb.lock);
+    pthread_join(rsb_cb.stack_thread, NULL);
+    if (err != 0)
+        bench_fail(&res, "connection not closed after the app closed its socket");
+
+    memset(&evt, 0, sizeof(evt));
+    evt.rfc_close.status = BTA_JV_SUCCESS;
+    evt.rfc_close.handle = RSB_HANDLE;
+    if (rsb_cb.p_cback != NULL)
+        rsb_cb.p_cback(BTA_JV_RFCOMM_CLOSE_EVT, &evt, rsb_cb.user_data);
+    rsb_cb.p_cback = NULL;
+    rsb_cb.app_fd = -1;
+
+    bench_extra(&res, "\"jv_writes\":%u,\"callouts\":%u,\"frames_per_callout\":%.2f,"
+                "\"flow_stops\":%u", rsb_cb.writes, rsb_cb.callouts,
+                rsb_cb.callouts ? (double)rsb_cb.frames / rsb_cb.callouts : 0.0,
+                rsb_cb.flow_stops);
+    bench_print_result(stdout, name, &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+static void rsb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n bytes         bytes echoed (default %d)\n"
+            "  -f bytes         RFCOMM frame size, the peer MTU (default %d)\n"
+            "  -w bytes         size of the app writes (default %d, max %d)\n"
+            "  -c count         credits, frames read per call-out (default and max %d)\n"
+            "  -m mode          vector, single or both (default both)\n",
+            p_prog, RSB_DEFAULT_BYTES, RSB_DEFAULT_MTU, RSB_DEFAULT_WRITE, RSB_MAX_WRITE,
+            PORT_CO_MAX_SEGS);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int     opt, failed = 0;
+    BOOLEAN vector = TRUE, single = TRUE;
+    int     h;
+
+    rsb_cb.bytes = RSB_DEFAULT_BYTES;
+    rsb_cb.mtu = RSB_DEFAULT_MTU;
+    rsb_cb.write_size = RSB_DEFAULT_WRITE;
+    rsb_cb.credits = PORT_CO_MAX_SEGS;
+    rsb_cb.app_fd = -1;
+
+    while ((opt = getopt(argc, argv, "n:f:w:c:m:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': rsb_cb.bytes = (UINT32)atoi(optarg); break;
+            case 'f': rsb_cb.mtu = (UINT16)atoi(optarg); break;
+            case 'w': rsb_cb.write_size = atoi(optarg); break;
+            case 'c': rsb_cb.credits = atoi(optarg); break;
+            case 'm':
+                vector = !strcmp(optarg, "vector") || !strcmp(optarg, "both");
+                single = !strcmp(optarg, "single") || !strcmp(optarg, "both");
+                if (!vector && !single)
+                {
+                    rsb_usage(argv[0]);
+                    return 2;
+                }
+                break;
+            default:
+                rsb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((rsb_cb.bytes == 0) || (rsb_cb.mtu == 0) || (rsb_cb.write_size <= 0) ||
+        (rsb_cb.write_size > RSB_MAX_WRITE) || (rsb_cb.credits <= 0) ||
+        (rsb_cb.credits > PORT_CO_MAX_SEGS))
+    {
+        fprintf(stderr, "rfc_sock_bench: bad option value\n");
+        return 2;
+    }
+
+    pthread_mutex_init(&rsb_cb.lock, NULL);
+    pthread_cond_init(&rsb_cb.cond, NULL);
+    GKI_init();
+    btsock_thread_init();
+    if (((h = btsock_thread_create(rsb_signaled_cb, NULL)) < 0) ||
+        (btsock_rfc_init(h) != BT_STATUS_SUCCESS))
+    {
+        fprintf(stderr, "rfc_sock_bench: cannot create the poll thread\n");
+        return 1;
+    }
+
+    if (vector)
+        failed |= !rsb_run(RSB_MODE_VECTOR);
+    if (single)
+        failed |= !rsb_run(RSB_MODE_SINGLE);
+
+    btsock_thread_exit(h);
+    return failed;
+}
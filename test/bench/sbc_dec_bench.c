@@ -0,0 +1,716 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      sbc_dec_bench.c
+ *
+ *  Description:   SBC decoder round trip check and benchmark
+ *
+ *                 Built from the encoder and the fixed point decoder
+ *                 sources. Two tones are encoded with every sampling rate,
+ *                 block, subband and channel mode setting, descrambled
+ *                 (see the scramble code in sbc_encoder.c) and decoded
+ *                 again; the PCM must match the input, delayed by the
+ *                 filter banks, within a minimum SNR. Every synthesis
+ *                 kernel must give the PCM of the C kernel, bit for bit,
+ *                 also for frames whose sample bits are noise. Damaged
+ *                 frames must be refused with the matching error. Then
+ *                 the A2DP settings are decoded in a loop with each
+ *                 kernel, for frames per second.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_report.h"
+#include "sbc_encoder.h"
+#include "sbc_decoder.h"
+#include "sbc_dec_func_declare.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define SBD_DEFAULT_FRAMES      20000       /* per setting                    */
+#define SBD_TRIP_FRAMES         40          /* per setting in the round trip */
+#define SBD_EXACT_FRAMES        24          /* per setting and vector         */
+#define SBD_SKIP_FRAMES         4           /* filter banks settling         */
+#define SBD_MAX_FRAME_LEN       1024
+#define SBD_MAX_DELAY           (16 * 8)    /* samples searched for the delay */
+
+/* minimum SNR of the round trip at the largest bitpool of the mode */
+#define SBD_MIN_SNR_DB          30.0
+
+/* scrambled encoder output, as in sbc_encoder.c */
+#define SBD_PRTC_CRC_IDX        3
+#define SBD_PRTC_USE_MASK       0x64
+#define SBD_PRTC_SYNC_MASK      0x10
+#define SBD_PRTC_IDX(crc)       (((crc) & 0x3) + (((crc) & 0x30) >> 2))
+
+/* PCM vectors of the kernel comparison */
+#define SBD_VEC_TONES           0           /* the round trip tones           */
+#define SBD_VEC_LEVELS          1           /* largest scale factors, sample  */
+                                            /* bits noise, ones or zeros      */
+#define SBD_NUM_VECTORS         2
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    const char  *p_name;
+    UINT8       kernel;
+} tSBD_KERNEL;
+
+typedef struct
+{
+    const char  *p_name;
+    SINT16      sampling_freq;
+    SINT16      channel_mode;
+    SINT16      subbands;
+    SINT16      blocks;
+    SINT16      allocation;
+    SINT16      bitpool;
+} tSBD_SETTING;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static const tSBD_KERNEL sbd_kernels[] =
+{
+    {"c",    SBC_DEC_KERNEL_C},
+    {"sse2", SBC_DEC_KERNEL_SSE2},
+    {"neon", SBC_DEC_KERNEL_NEON}
+};
+#define SBD_NUM_KERNELS         (sizeof(sbd_kernels) / sizeof(sbd_kernels[0]))
+
+static const tSBD_SETTING sbd_bench_settings[] =
+{
+    {"a2dp_hq",     SBC_sf44100, SBC_JOINT_STEREO, 8, 16, SBC_LOUDNESS, 53},
+    {"a2dp_mq",     SBC_sf44100, SBC_JOINT_STEREO, 8, 16, SBC_LOUDNESS, 35},
+    {"48k_stereo",  SBC_sf48000, SBC_STEREO,       8, 16, SBC_LOUDNESS, 51},
+    {"32k_dual_4sb", SBC_sf32000, SBC_DUAL,        4, 16, SBC_SNR,      32}
+};
+#define SBD_NUM_BENCH_SETTINGS  (sizeof(sbd_bench_settings) / sizeof(sbd_bench_settings[0]))
+
+static const UINT32 sbd_sample_rate[] = {16000, 32000, 44100, 48000};
+static const SINT16 sbd_blocks[] = {4, 8, 12, 16};
+
+static SBC_ENC_PARAMS sbd_enc;
+static SBC_DEC_PARAMS sbd_dec;
+static UINT8 sbd_prtc_last_idx;
+static UINT32 sbd_seed;
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static UINT8 sbd_rand(void)
+{
+    sbd_seed = sbd_seed * 1103515245 + 12345;
+    return (UINT8)(sbd_seed >> 16);
+}
+
+/* 1 kHz and 5 kHz at -9 dBFS each, the right channel a quarter period late; */
+/* or full scale noise                                                       */
+static SINT16 sbd_sample(const tSBD_SETTING *p_set, UINT8 vector, UINT32 n, int ch)
+{
+    double  t = (double)n / sbd_sample_rate[p_set->sampling_freq];
+    double  v;
+
+    if (vector == SBD_VEC_LEVELS)
+        return (sbd_rand() & 1) ? 32767 : -32768;
+
+    v = sin(2 * M_PI * 1000 * t - ch * M_PI / 2) + sin(2 * M_PI * 5000 * t + ch * M_PI / 2);
+    return (SINT16)lrint(v * 11600.0);
+}
+
+static void sbd_init(const tSBD_SETTING *p_set)
+{
+    memset(&sbd_enc, 0, sizeof(sbd_enc));
+    sbd_enc.s16SamplingFreq = p_set->sampling_freq;
+    sbd_enc.s16ChannelMode = p_set->channel_mode;
+    sbd_enc.s16NumOfSubBands = p_set->subbands;
+    sbd_enc.s16NumOfBlocks = p_set->blocks;
+    sbd_enc.s16AllocationMethod = p_set->allocation;
+    sbd_enc.u16BitRate = 328;
+    SBC_Encoder_Init(&sbd_enc);
+
+    /* the bitpool is given, not derived from the bit rate */
+    sbd_enc.s16BitPool = p_set->bitpool;
+
+    SBC_Decoder_Init(&sbd_dec);
+    sbd_prtc_last_idx = 0;
+    sbd_seed = 1;
+}
+
+/*******************************************************************************
+**
+** Function         sbd_descramble
+**
+** Description      Undoes the scrambling of an encoded frame: the byte
+**                  rotated or the two bytes swapped past the scale factors,
+**                  chosen by the CRC of this frame or the one before, and
+**                  the sync word of the first frame.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sbd_descramble(UINT8 *p_frame, UINT16 len, BOOLEAN first)
+{
+    UINT8   *p = p_frame + 6 + sbd_enc.s16NumOfChannels * sbd_enc.s16NumOfSubBands / 2;
+    UINT8   crc = p_frame[SBD_PRTC_CRC_IDX];
+    UINT8   idx, tmp;
+
+    if (first)
+        p_frame[0] |= SBD_PRTC_SYNC_MASK;
+
+    idx = (crc & SBD_PRTC_USE_MASK) ? SBD_PRTC_IDX(crc) : sbd_prtc_last_idx;
+    sbd_prtc_last_idx = SBD_PRTC_IDX(crc);
+    if (idx == 0)
+        return;
+
+    if ((idx & 1) && (len > (p - p_frame) + (idx << 1)))
+    {
+        tmp = p[idx];
+        p[idx] = p[idx << 1];
+        p[idx << 1] = tmp;
+    }
+    else
+    {
+        p[idx] = (UINT8)((p[idx] << 5) | (p[idx] >> 3));
+    }
+}
+
+/* CRC-8 of the frame header, x^8 + x^4 + x^3 + x^2 + 1, over s32Bits bits */
+static UINT8 sbd_crc8(UINT8 crc, const UINT8 *p, int bits)
+{
+    UINT8   byte = 0;
+    int     xx;
+
+    for (xx = 0; xx < bits; xx++)
+    {
+        if ((xx & 7) == 0)
+            byte = *p++;
+        crc = (((crc ^ byte) & 0x80) != 0) ? (UINT8)((crc << 1) ^ 0x1D) : (UINT8)(crc << 1);
+        byte <<= 1;
+    }
+    return crc;
+}
+
+/*******************************************************************************
+**
+** Function         sbd_levels
+**
+** Description      Rewrites an encoded frame for SBD_VEC_LEVELS: the join
+**                  bits and scale factors all ones, the CRC over them fixed
+**                  up, and the sample bits noise, all ones or all zeros by
+**                  turns. So every level code occurs at scale factor 15,
+**                  and whole frames sit at the top level 2^bits - 1, which
+**                  gives the largest V the filter bank can see, or at the
+**                  bottom one.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sbd_levels(UINT8 *p_frame, UINT16 len, UINT32 index)
+{
+    int     hdr_bits = 4 * sbd_enc.s16NumOfSubBands * sbd_enc.s16NumOfChannels;
+    UINT16  pos;
+
+    if (sbd_enc.s16ChannelMode == SBC_JOINT_STEREO)
+        hdr_bits += sbd_enc.s16NumOfSubBands;
+
+    for (pos = SBC_DEC_HEADER_SIZE; pos < len; pos++)
+    {
+        if (pos < SBC_DEC_HEADER_SIZE + (hdr_bits + 7) / 8)
+            p_frame[pos] = 0xFF;
+        else
+            p_frame[pos] = (index % 3 == 0) ? sbd_rand() : ((index % 3 == 1) ? 0xFF : 0x00);
+    }
+    p_frame[SBD_PRTC_CRC_IDX] = sbd_crc8(sbd_crc8(0x0F, p_frame + 1, 16), p_frame + SBC_DEC_HEADER_SIZE, hdr_bits);
+}
+
+/*******************************************************************************
+**
+** Function         sbd_encode
+**
+** Description      Encodes frames of a PCM vector into plain SBC, keeping
+**                  the PCM fed in p_pcm when given. SBD_VEC_LEVELS frames
+**                  are rewritten by sbd_levels.
+**
+** Returns          bytes written to p_out
+**
+*******************************************************************************/
+static UINT32 sbd_encode(const tSBD_SETTING *p_set, UINT8 vector, UINT32 frames, UINT8 *p_out, SINT16 *p_pcm)
+{
+    UINT32  xx, n = 0, len = 0;
+    SINT16  *p;
+    int     yy, ch;
+
+    for (xx = 0; xx < frames; xx++)
+    {
+        p = sbd_enc.as16PcmBuffer;
+        for (yy = 0; yy < sbd_enc.s16NumOfBlocks * sbd_enc.s16NumOfSubBands; yy++, n++)
+        {
+            for (ch = 0; ch < sbd_enc.s16NumOfChannels; ch++)
+            {
+                *p = sbd_sample(p_set, vector, n, ch);
+                if (p_pcm != NULL)
+                    *p_pcm++ = *p;
+                p++;
+            }
+        }
+        sbd_enc.pu8Packet = p_out + len;
+        SBC_Encoder(&sbd_enc);
+        sbd_descramble(p_out + len, sbd_enc.u16PacketLength, (BOOLEAN)(xx == 0));
+        if (vector == SBD_VEC_LEVELS)
+            sbd_levels(p_out + len, sbd_enc.u16PacketLength, xx);
+        len += sbd_enc.u16PacketLength;
+    }
+    return len;
+}
+
+/*******************************************************************************
+**
+** Function         sbd_snr
+**
+** Description      Finds the delay that matches the decoded PCM best to the
+**                  input, past the first frames, and gives the SNR there.
+**
+** Returns          SNR in dB, of the worse channel
+**
+*******************************************************************************/
+static double sbd_snr(const SINT16 *p_in, const SINT16 *p_out, UINT32 samples, int channels,
+                      UINT32 skip, UINT32 *p_delay)
+{
+    double  sig, err, d, snr, best = -1000.0, worst;
+    UINT32  delay, n;
+    int     ch;
+
+    for (delay = 0; delay <= SBD_MAX_DELAY; delay++)
+    {
+        worst = 1000.0;
+        for (ch = 0; ch < channels; ch++)
+        {
+            sig = err = 0.0;
+            for (n = skip; n + delay < samples; n++)
+            {
+                d = (double)p_out[(n + delay) * channels + ch] - p_in[n * channels + ch];
+                sig += (double)p_in[n * channels + ch] * p_in[n * channels + ch];
+                err += d * d;
+            }
+            snr = (err > 0.0) ? 10.0 * log10(sig / err) : 200.0;
+            if (snr < worst)
+                worst = snr;
+        }
+        if (worst > best)
+        {
+            best = worst;
+            *p_delay = delay;
+        }
+    }
+    return best;
+}
+
+/*******************************************************************************
+**
+** Function         sbd_run_trip
+**
+** Description      Encodes and decodes every setting at the largest bitpool
+**                  of its mode and checks the SNR.
+**
+** Returns          FALSE if the case failed
+**
+*******************************************************************************/
+static BOOLEAN sbd_run_trip(void)
+{
+    tBENCH_RESULT   res;
+    tSBD_SETTING    set;
+    UINT8           *p_frames;
+    SINT16          *p_in, *p_out;
+    UINT32          len, pos, samples, delay = 0, settings = 0, failures = 0;
+    double          snr, min_snr = 1000.0;
+    uint64_t        t0;
+    INT16           status;
+    int             sf, blk, sb, mode;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"frames\":%d,\"min_snr_db\":%.1f",
+             SBD_TRIP_FRAMES, SBD_MIN_SNR_DB);
+
+    p_frames = (UINT8 *)malloc(SBD_TRIP_FRAMES * SBD_MAX_FRAME_LEN);
+    p_in = (SINT16 *)malloc(SBD_TRIP_FRAMES * SBC_DEC_MAX_PCM_SAMPLES * sizeof(SINT16));
+    p_out = (SINT16 *)malloc(SBD_TRIP_FRAMES * SBC_DEC_MAX_PCM_SAMPLES * sizeof(SINT16));
+    memset(&set, 0, sizeof(set));
+
+    t0 = bench_now_ns();
+    for (sf = SBC_sf16000; sf <= SBC_sf48000; sf++)
+    for (blk = 0; blk < 4; blk++)
+    for (sb = 4; sb <= 8; sb += 4)
+    for (mode = SBC_MONO; mode <= SBC_JOINT_STEREO; mode++)
+    {
+        set.sampling_freq = (SINT16)sf;
+        set.blocks = sbd_blocks[blk];
+        set.subbands = (SINT16)sb;
+        set.channel_mode = (SINT16)mode;
+        set.allocation = SBC_SNR;
+        set.bitpool = ((mode == SBC_MONO) || (mode == SBC_DUAL)) ? 16 * sb : 32 * sb;
+        if (set.bitpool > 250)
+            set.bitpool = 250;
+        settings++;
+
+        sbd_init(&set);
+        len = sbd_encode(&set, SBD_VEC_TONES, SBD_TRIP_FRAMES, p_frames, p_in);
+
+        for (pos = 0, samples = 0; pos < len; pos += sbd_dec.u16FrameLength)
+        {
+            status = SBC_Decoder(&sbd_dec, p_frames + pos,
+                                 (UINT16)(((len - pos) < SBD_MAX_FRAME_LEN) ? (len - pos) : SBD_MAX_FRAME_LEN),
+                                 p_out + samples);
+            if (status != SBC_DEC_OK)
+                break;
+            samples += sbd_dec.u16PcmLength;
+            res.count++;
+        }
+        res.bytes += len;
+
+        snr = -1000.0;
+        if (status == SBC_DEC_OK)
+            snr = sbd_snr(p_in, p_out, samples / sbd_enc.s16NumOfChannels, sbd_enc.s16NumOfChannels,
+                          SBD_SKIP_FRAMES * set.blocks * sb, &delay);
+        if (snr < min_snr)
+            min_snr = snr;
+
+        if ((status != SBC_DEC_OK) || (snr < SBD_MIN_SNR_DB))
+        {
+            if (failures++ == 0)
+                bench_fail(&res, "sf %d blocks %d subbands %d mode %d: status %d, snr %.1f dB",
+                           sf, set.blocks, sb, mode, status, snr);
+        }
+    }
+    res.elapsed_ns = bench_now_ns() - t0;
+
+    bench_extra(&res, "\"settings\":%u,\"failures\":%u,\"min_snr_db\":%.1f",
+                settings, failures, min_snr);
+    bench_print_result(stdout, "sbc_dec_roundtrip", &res);
+
+    free(p_frames);
+    free(p_in);
+    free(p_out);
+    return (failures == 0);
+}
+
+/*******************************************************************************
+**
+** Function         sbd_decode
+**
+** Description      Decodes the frames in p_frames into p_pcm with the
+**                  current kernel, from a fresh decoder.
+**
+** Returns          PCM samples written; *p_status gets the status of the
+**                  last frame decoded
+**
+*******************************************************************************/
+static UINT32 sbd_decode(const UINT8 *p_frames, UINT32 len, SINT16 *p_pcm, INT16 *p_status)
+{
+    UINT32  pos, samples = 0;
+
+    SBC_Decoder_Init(&sbd_dec);
+    for (pos = 0; pos < len; pos += sbd_dec.u16FrameLength)
+    {
+        *p_status = SBC_Decoder(&sbd_dec, p_frames + pos,
+                                (UINT16)(((len - pos) < SBD_MAX_FRAME_LEN) ? (len - pos) : SBD_MAX_FRAME_LEN),
+                                p_pcm + samples);
+        if (*p_status != SBC_DEC_OK)
+            break;
+        samples += sbd_dec.u16PcmLength;
+    }
+    return samples;
+}
+
+/*******************************************************************************
+**
+** Function         sbd_run_exact
+**
+** Description      Decodes every vector encoded with every setting using
+**                  kernel p_kern and the C kernel, and compares the PCM.
+**
+** Returns          FALSE if the case failed
+**
+*******************************************************************************/
+static BOOLEAN sbd_run_exact(const tSBD_KERNEL *p_kern)
+{
+    tBENCH_RESULT   res;
+    tSBD_SETTING    set;
+    char            name[48];
+    UINT8           *p_frames;
+    SINT16          *p_ref, *p_out;
+    UINT32          len, ref_samples, out_samples, settings = 0, mismatches = 0;
+    SINT16          bitpools[3];
+    uint64_t        t0;
+    INT16           ref_status, out_status;
+    int             sf, blk, sb, mode, bp, vec;
+
+    bench_result_init(&res);
+    snprintf(name, sizeof(name), "sbc_dec_exact_%s", p_kern->p_name);
+    snprintf(res.params, sizeof(res.params), "\"kernel\":\"%s\",\"vectors\":%d,\"frames\":%d",
+             p_kern->p_name, SBD_NUM_VECTORS, SBD_EXACT_FRAMES);
+
+    if (!SbcSynthesisSetKernel(p_kern->kernel))
+    {
+        res.p_status = "skipped";
+        snprintf(res.reason, sizeof(res.reason), "not available on this CPU or build");
+        bench_print_result(stdout, name, &res);
+        return TRUE;
+    }
+
+    p_frames = (UINT8 *)malloc(SBD_EXACT_FRAMES * SBD_MAX_FRAME_LEN);
+    p_ref = (SINT16 *)malloc(SBD_EXACT_FRAMES * SBC_DEC_MAX_PCM_SAMPLES * sizeof(SINT16));
+    p_out = (SINT16 *)malloc(SBD_EXACT_FRAMES * SBC_DEC_MAX_PCM_SAMPLES * sizeof(SINT16));
+    memset(&set, 0, sizeof(set));
+
+    t0 = bench_now_ns();
+    for (sf = SBC_sf16000; sf <= SBC_sf48000; sf++)
+    for (blk = 0; blk < 4; blk++)
+    for (sb = 4; sb <= 8; sb += 4)
+    for (mode = SBC_MONO; mode <= SBC_JOINT_STEREO; mode++)
+    {
+        bitpools[0] = 8;
+        bitpools[1] = 35;
+        bitpools[2] = ((mode == SBC_MONO) || (mode == SBC_DUAL)) ? 16 * sb : 32 * sb;
+        if (bitpools[2] > 250)
+            bitpools[2] = 250;
+
+        for (bp = 0; bp < 3; bp++)
+        {
+            set.sampling_freq = (SINT16)sf;
+            set.blocks = sbd_blocks[blk];
+            set.subbands = (SINT16)sb;
+            set.channel_mode = (SINT16)mode;
+            set.allocation = SBC_SNR;
+            set.bitpool = bitpools[bp];
+            settings++;
+
+            for (vec = 0; vec < SBD_NUM_VECTORS; vec++)
+            {
+                sbd_init(&set);
+                len = sbd_encode(&set, (UINT8)vec, SBD_EXACT_FRAMES, p_frames, NULL);
+
+                SbcSynthesisSetKernel(SBC_DEC_KERNEL_C);
+                ref_samples = sbd_decode(p_frames, len, p_ref, &ref_status);
+                SbcSynthesisSetKernel(p_kern->kernel);
+                out_samples = sbd_decode(p_frames, len, p_out, &out_status);
+
+                res.count++;
+                res.bytes += len;
+
+                if ((ref_status != SBC_DEC_OK) || (out_status != SBC_DEC_OK) ||
+                    (out_samples != ref_samples) || memcmp(p_out, p_ref, ref_samples * sizeof(SINT16)))
+                {
+                    if (mismatches++ == 0)
+                        bench_fail(&res, "differs from C: sf %d blocks %d subbands %d mode %d bitpool %d vector %d, "
+                                   "status %d/%d", sf, set.blocks, sb, mode, set.bitpool, vec, ref_status, out_status);
+                }
+            }
+        }
+    }
+    res.elapsed_ns = bench_now_ns() - t0;
+
+    bench_extra(&res, "\"settings\":%u,\"mismatches\":%u", settings, mismatches);
+    bench_print_result(stdout, name, &res);
+
+    SbcSynthesisSetKernel(SBC_DEC_KERNEL_AUTO);
+    free(p_frames);
+    free(p_ref);
+    free(p_out);
+    return (mismatches == 0);
+}
+
+/*******************************************************************************
+**
+** Function         sbd_run_errors
+**
+** Description      Decodes a truncated frame, a frame without sync word and
+**                  one with a damaged scale factor.
+**
+** Returns          FALSE if the case failed
+**
+*******************************************************************************/
+static BOOLEAN sbd_run_errors(void)
+{
+    tBENCH_RESULT   res;
+    UINT8           frame[SBD_MAX_FRAME_LEN];
+    SINT16          pcm[SBC_DEC_MAX_PCM_SAMPLES];
+    UINT32          len;
+    INT16           status;
+
+    bench_result_init(&res);
+    sbd_init(&sbd_bench_settings[0]);
+    len = sbd_encode(&sbd_bench_settings[0], SBD_VEC_TONES, 1, frame, NULL);
+
+    if ((status = SBC_Decoder(&sbd_dec, frame, (UINT16)(len - 1), pcm)) != SBC_DEC_ERR_SHORT)
+        bench_fail(&res, "truncated frame: status %d", status);
+
+    frame[0] ^= 0x01;
+    if ((status = SBC_Decoder(&sbd_dec, frame, (UINT16)len, pcm)) != SBC_DEC_ERR_SYNC)
+        bench_fail(&res, "no sync word: status %d", status);
+    frame[0] ^= 0x01;
+
+    /* the first scale factor, covered by the CRC */
+    frame[SBC_DEC_HEADER_SIZE + 1] ^= 0x10;
+    status = SBC_Decoder(&sbd_dec, frame, (UINT16)len, pcm);
+    if ((status != SBC_DEC_ERR_CRC) || (sbd_dec.u16FrameLength != len))
+        bench_fail(&res, "damaged scale factor: status %d, length %u", status, sbd_dec.u16FrameLength);
+    frame[SBC_DEC_HEADER_SIZE + 1] ^= 0x10;
+
+    if ((status = SBC_Decoder(&sbd_dec, frame, (UINT16)len, pcm)) != SBC_DEC_OK)
+        bench_fail(&res, "restored frame: status %d", status);
+
+    res.count = 4;
+    bench_print_result(stdout, "sbc_dec_errors", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         sbd_run_speed
+**
+** Description      Decodes frames of a setting in a loop with a kernel.
+**                  The frames are encoded ahead, outside the timed loop.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sbd_run_speed(const tSBD_SETTING *p_set, const tSBD_KERNEL *p_kern, UINT32 frames)
+{
+    tBENCH_RESULT   res;
+    char            name[48];
+    UINT8           *p_frames;
+    SINT16          pcm[SBC_DEC_MAX_PCM_SAMPLES];
+    UINT32          xx, len, pos;
+    uint64_t        t0, c0, cycles;
+    double          audio_secs;
+
+    bench_result_init(&res);
+    snprintf(name, sizeof(name), "sbc_decode_%s_%s", p_set->p_name, p_kern->p_name);
+    snprintf(res.params, sizeof(res.params), "\"kernel\":\"%s\",\"subbands\":%d,\"blocks\":%d,"
+             "\"mode\":%d,\"bitpool\":%d,\"frames\":%u", p_kern->p_name, p_set->subbands,
+             p_set->blocks, p_set->channel_mode, p_set->bitpool, frames);
+
+    if (!SbcSynthesisSetKernel(p_kern->kernel))
+    {
+        res.p_status = "skipped";
+        snprintf(res.reason, sizeof(res.reason), "not available on this CPU or build");
+        bench_print_result(stdout, name, &res);
+        return;
+    }
+
+    sbd_init(p_set);
+    p_frames = (UINT8 *)malloc(frames * SBD_MAX_FRAME_LEN);
+    len = sbd_encode(p_set, SBD_VEC_TONES, frames, p_frames, NULL);
+
+    t0 = bench_now_ns();
+    c0 = bench_cycles();
+    for (xx = 0, pos = 0; xx < frames; xx++, pos += sbd_dec.u16FrameLength)
+    {
+        /* the length is 16 bit: never more than one frame */
+        if (SBC_Decoder(&sbd_dec, p_frames + pos, (UINT16)(((len - pos) < SBD_MAX_FRAME_LEN) ? (len - pos) : SBD_MAX_FRAME_LEN),
+                        pcm) != SBC_DEC_OK)
+        {
+            bench_fail(&res, "frame %u does not decode", xx);
+            break;
+        }
+        res.count++;
+    }
+    cycles = bench_cycles() - c0;
+    res.elapsed_ns = bench_now_ns() - t0;
+    res.bytes = pos;
+
+    audio_secs = (double)frames * p_set->blocks * p_set->subbands / sbd_sample_rate[p_set->sampling_freq];
+    bench_extra(&res, "\"frames_per_sec\":%.0f,\"ns_per_frame\":%.1f,\"cycles_per_frame\":%.1f,"
+                "\"realtime_x\":%.1f", frames * (double)BENCH_NS_PER_SEC / res.elapsed_ns,
+                (double)res.elapsed_ns / frames, (double)cycles / frames,
+                audio_secs * BENCH_NS_PER_SEC / res.elapsed_ns);
+    bench_print_result(stdout, name, &res);
+
+    SbcSynthesisSetKernel(SBC_DEC_KERNEL_AUTO);
+    free(p_frames);
+}
+
+static void sbd_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n frames        frames per setting in the benchmark (default %d)\n"
+            "  -x               round trip, kernel and error checks only\n",
+            p_prog, SBD_DEFAULT_FRAMES);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    UINT32  frames = SBD_DEFAULT_FRAMES;
+    BOOLEAN check_only = FALSE;
+    int     opt, failed = 0;
+    UINT32  xx, yy;
+
+    while ((opt = getopt(argc, argv, "n:xh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': frames = (UINT32)atoi(optarg); break;
+            case 'x': check_only = TRUE; break;
+            default:
+                sbd_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (frames == 0)
+    {
+        fprintf(stderr, "sbc_dec_bench: bad option value\n");
+        return 2;
+    }
+
+    failed |= !sbd_run_trip();
+    for (xx = 0; xx < SBD_NUM_KERNELS; xx++)
+        failed |= !sbd_run_exact(&sbd_kernels[xx]);
+    failed |= !sbd_run_errors();
+
+    if (check_only)
+        return failed;
+
+    for (yy = 0; yy < SBD_NUM_BENCH_SETTINGS; yy++)
+    {
+        for (xx = 0; xx < SBD_NUM_KERNELS; xx++)
+            sbd_run_speed(&sbd_bench_settings[yy], &sbd_kernels[xx], frames);
+    }
+
+    return failed;
+}
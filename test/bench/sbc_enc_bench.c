@@ -0,0 +1,441 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      sbc_enc_bench.c
+ *
+ *  Description:   SBC encoder bit exactness check and benchmark
+ *
+ *                 Built from the encoder sources. Every windowing kernel the
+ *                 CPU has (C, SSE2, AVX2, NEON; see SbcAnalysisSetKernel())
+ *                 encodes the same fixed PCM vectors with every sampling
+ *                 rate, block, subband, channel mode and allocation setting
+ *                 at three bitpools, and must give the bytes of the C
+ *                 kernel. Then each kernel encodes the A2DP settings in a
+ *                 loop, for frames per second.
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_report.h"
+#include "sbc_encoder.h"
+#include "sbc_enc_func_declare.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define SBE_DEFAULT_FRAMES      20000       /* per setting and kernel        */
+#define SBE_EXACT_FRAMES        24          /* per vector and setting        */
+#define SBE_MAX_FRAME_LEN       1024        /* dual channel at bitpool 128: 524 */
+
+/* PCM vectors of the bit exactness check */
+#define SBE_VEC_SILENCE         0
+#define SBE_VEC_RAMP            1           /* sawtooth, inverted on the right */
+#define SBE_VEC_NOISE           2
+#define SBE_VEC_FULL_SCALE      3           /* square wave at the rails       */
+#define SBE_VEC_IMPULSE         4
+#define SBE_VEC_MIXED           5           /* ramp left, noise right         */
+#define SBE_NUM_VECTORS         6
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    const char  *p_name;
+    UINT8       kernel;
+} tSBE_KERNEL;
+
+typedef struct
+{
+    const char  *p_name;
+    SINT16      sampling_freq;
+    SINT16      channel_mode;
+    SINT16      subbands;
+    SINT16      blocks;
+    SINT16      allocation;
+    SINT16      bitpool;
+} tSBE_SETTING;
+
+/* PCM generator */
+typedef struct
+{
+    UINT8       vector;
+    UINT32      seed;
+    UINT32      n;
+} tSBE_PCM;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static const tSBE_KERNEL sbe_kernels[] =
+{
+    {"c",    SBC_KERNEL_C},
+    {"sse2", SBC_KERNEL_SSE2},
+    {"avx2", SBC_KERNEL_AVX2},
+    {"neon", SBC_KERNEL_NEON}
+};
+#define SBE_NUM_KERNELS         (sizeof(sbe_kernels) / sizeof(sbe_kernels[0]))
+
+static const tSBE_SETTING sbe_bench_settings[] =
+{
+    {"a2dp_hq",     SBC_sf44100, SBC_JOINT_STEREO, 8, 16, SBC_LOUDNESS, 53},
+    {"a2dp_mq",     SBC_sf44100, SBC_JOINT_STEREO, 8, 16, SBC_LOUDNESS, 35},
+    {"48k_stereo",  SBC_sf48000, SBC_STEREO,       8, 16, SBC_LOUDNESS, 51},
+    {"32k_dual_4sb", SBC_sf32000, SBC_DUAL,        4, 16, SBC_SNR,      32}
+};
+#define SBE_NUM_BENCH_SETTINGS  (sizeof(sbe_bench_settings) / sizeof(sbe_bench_settings[0]))
+
+static const SINT16 sbe_blocks[] = {4, 8, 12, 16};
+
+static SBC_ENC_PARAMS sbe_enc;
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static SINT16 sbe_sample(tSBE_PCM *p_pcm, int ch)
+{
+    UINT32  n = p_pcm->n;
+
+    switch (p_pcm->vector)
+    {
+        case SBE_VEC_RAMP:
+            return (SINT16)((ch ? -1 : 1) * (SINT16)(n * 0x0280));
+        case SBE_VEC_NOISE:
+            p_pcm->seed = p_pcm->seed * 1103515245 + 12345;
+            return (SINT16)(p_pcm->seed >> 16);
+        case SBE_VEC_FULL_SCALE:
+            return (((n / 37) & 1) ^ ch) ? 32767 : -32768;
+        case SBE_VEC_IMPULSE:
+            return ((n + ch * 13) % 97 == 0) ? 32767 : 0;
+        case SBE_VEC_MIXED:
+            if (ch == 0)
+                return (SINT16)(n * 0x0280);
+            p_pcm->seed = p_pcm->seed * 1103515245 + 12345;
+            return (SINT16)(p_pcm->seed >> 18);
+        default:
+            return 0;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         sbe_feed
+**
+** Description      Fills the PCM buffer of the encoder with one frame,
+**                  channels interleaved.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sbe_feed(SBC_ENC_PARAMS *p_enc, tSBE_PCM *p_pcm)
+{
+    SINT16  *p = p_enc->as16PcmBuffer;
+    int     xx, ch;
+
+    for (xx = 0; xx < p_enc->s16NumOfBlocks * p_enc->s16NumOfSubBands; xx++, p_pcm->n++)
+    {
+        for (ch = 0; ch < p_enc->s16NumOfChannels; ch++)
+            *p++ = sbe_sample(p_pcm, ch);
+    }
+}
+
+static void sbe_init(const tSBE_SETTING *p_set)
+{
+    memset(&sbe_enc, 0, sizeof(sbe_enc));
+    sbe_enc.s16SamplingFreq = p_set->sampling_freq;
+    sbe_enc.s16ChannelMode = p_set->channel_mode;
+    sbe_enc.s16NumOfSubBands = p_set->subbands;
+    sbe_enc.s16NumOfBlocks = p_set->blocks;
+    sbe_enc.s16AllocationMethod = p_set->allocation;
+    sbe_enc.u16BitRate = 328;
+    SBC_Encoder_Init(&sbe_enc);
+
+    /* the bitpool is given, not derived from the bit rate */
+    sbe_enc.s16BitPool = p_set->bitpool;
+}
+
+/*******************************************************************************
+**
+** Function         sbe_encode
+**
+** Description      Encodes frames of a PCM vector with the current kernel.
+**
+** Returns          bytes written to p_out
+**
+*******************************************************************************/
+static UINT32 sbe_encode(const tSBE_SETTING *p_set, UINT8 vector, UINT32 frames, UINT8 *p_out)
+{
+    tSBE_PCM    pcm;
+    UINT32      xx, len = 0;
+
+    memset(&pcm, 0, sizeof(pcm));
+    pcm.vector = vector;
+    pcm.seed = 1;
+    sbe_init(p_set);
+
+    for (xx = 0; xx < frames; xx++)
+    {
+        sbe_feed(&sbe_enc, &pcm);
+        sbe_enc.pu8Packet = p_out + len;
+        SBC_Encoder(&sbe_enc);
+        len += sbe_enc.u16PacketLength;
+    }
+    return len;
+}
+
+static SINT16 sbe_max_bitpool(SINT16 mode, SINT16 subbands)
+{
+    if ((mode == SBC_MONO) || (mode == SBC_DUAL))
+        return 16 * subbands;
+    return (32 * subbands > 250) ? 250 : 32 * subbands;
+}
+
+static uint64_t sbe_hash(uint64_t hash, const UINT8 *p, UINT32 len)
+{
+    while (len--)
+        hash = (hash ^ *p++) * 0x100000001b3ULL;
+    return hash;
+}
+
+/*******************************************************************************
+**
+** Function         sbe_run_exact
+**
+** Description      Encodes every vector with every setting using kernel
+**                  p_kern and the C kernel, and compares the bytes.
+**
+** Returns          FALSE if the case failed
+**
+*******************************************************************************/
+static BOOLEAN sbe_run_exact(const tSBE_KERNEL *p_kern)
+{
+    tBENCH_RESULT   res;
+    tSBE_SETTING    set;
+    char            name[32];
+    UINT8           *p_ref, *p_out;
+    UINT32          ref_len, out_len, settings = 0, mismatches = 0;
+    uint64_t        hash = 0xcbf29ce484222325ULL;
+    SINT16          bitpools[3];
+    uint64_t        t0;
+    int             sf, blk, sb, mode, alloc, bp, vec;
+
+    bench_result_init(&res);
+    snprintf(name, sizeof(name), "sbc_exact_%s", p_kern->p_name);
+    snprintf(res.params, sizeof(res.params), "\"kernel\":\"%s\",\"vectors\":%d,\"frames\":%d",
+             p_kern->p_name, SBE_NUM_VECTORS, SBE_EXACT_FRAMES);
+
+    if (!SbcAnalysisSetKernel(p_kern->kernel))
+    {
+        res.p_status = "skipped";
+        snprintf(res.reason, sizeof(res.reason), "not available on this CPU or build");
+        bench_print_result(stdout, name, &res);
+        return TRUE;
+    }
+
+    p_ref = (UINT8 *)malloc(SBE_EXACT_FRAMES * SBE_MAX_FRAME_LEN);
+    p_out = (UINT8 *)malloc(SBE_EXACT_FRAMES * SBE_MAX_FRAME_LEN);
+    memset(&set, 0, sizeof(set));
+
+    t0 = bench_now_ns();
+    for (sf = SBC_sf16000; sf <= SBC_sf48000; sf++)
+    for (blk = 0; blk < 4; blk++)
+    for (sb = 4; sb <= 8; sb += 4)
+    for (mode = SBC_MONO; mode <= SBC_JOINT_STEREO; mode++)
+    for (alloc = SBC_LOUDNESS; alloc <= SBC_SNR; alloc++)
+    {
+        bitpools[0] = 8;
+        bitpools[1] = 35;
+        bitpools[2] = sbe_max_bitpool((SINT16)mode, (SINT16)sb);
+
+        for (bp = 0; bp < 3; bp++)
+        {
+            set.sampling_freq = (SINT16)sf;
+            set.blocks = sbe_blocks[blk];
+            set.subbands = (SINT16)sb;
+            set.channel_mode = (SINT16)mode;
+            set.allocation = (SINT16)alloc;
+            set.bitpool = bitpools[bp];
+            settings++;
+
+            for (vec = 0; vec < SBE_NUM_VECTORS; vec++)
+            {
+                SbcAnalysisSetKernel(SBC_KERNEL_C);
+                ref_len = sbe_encode(&set, (UINT8)vec, SBE_EXACT_FRAMES, p_ref);
+                SbcAnalysisSetKernel(p_kern->kernel);
+                out_len = sbe_encode(&set, (UINT8)vec, SBE_EXACT_FRAMES, p_out);
+
+                res.count++;
+                res.bytes += out_len;
+                hash = sbe_hash(hash, p_out, out_len);
+
+                if ((out_len != ref_len) || memcmp(p_out, p_ref, ref_len))
+                {
+                    if (mismatches++ == 0)
+                        bench_fail(&res, "differs from C: sf %d blocks %d subbands %d mode %d alloc %d bitpool %d vector %d",
+                                   sf, set.blocks, sb, mode, alloc, set.bitpool, vec);
+                }
+            }
+        }
+    }
+    res.elapsed_ns = bench_now_ns() - t0;
+
+    bench_extra(&res, "\"settings\":%u,\"mismatches\":%u,\"hash\":\"%016llx\"",
+                settings, mismatches, (unsigned long long)hash);
+    bench_print_result(stdout, name, &res);
+
+    SbcAnalysisSetKernel(SBC_KERNEL_AUTO);
+    free(p_ref);
+    free(p_out);
+    return (mismatches == 0);
+}
+
+/*******************************************************************************
+**
+** Function         sbe_run_speed
+**
+** Description      Encodes frames of mixed PCM with a setting and kernel.
+**                  The PCM is generated ahead, outside the timed loop.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sbe_run_speed(const tSBE_SETTING *p_set, const tSBE_KERNEL *p_kern, UINT32 frames)
+{
+    static const UINT32 sample_rate[] = {16000, 32000, 44100, 48000};
+    tBENCH_RESULT   res;
+    tSBE_PCM        pcm;
+    char            name[48];
+    SINT16          *p_pcm;
+    UINT8           frame[SBE_MAX_FRAME_LEN];
+    UINT32          xx, frame_samples;
+    uint64_t        t0, c0, cycles;
+    double          audio_secs;
+
+    bench_result_init(&res);
+    snprintf(name, sizeof(name), "sbc_encode_%s_%s", p_set->p_name, p_kern->p_name);
+    snprintf(res.params, sizeof(res.params), "\"kernel\":\"%s\",\"subbands\":%d,\"blocks\":%d,"
+             "\"mode\":%d,\"bitpool\":%d,\"frames\":%u", p_kern->p_name, p_set->subbands,
+             p_set->blocks, p_set->channel_mode, p_set->bitpool, frames);
+
+    if (!SbcAnalysisSetKernel(p_kern->kernel))
+    {
+        res.p_status = "skipped";
+        snprintf(res.reason, sizeof(res.reason), "not available on this CPU or build");
+        bench_print_result(stdout, name, &res);
+        return;
+    }
+
+    sbe_init(p_set);
+    frame_samples = sbe_enc.s16NumOfBlocks * sbe_enc.s16NumOfSubBands * sbe_enc.s16NumOfChannels;
+
+    memset(&pcm, 0, sizeof(pcm));
+    pcm.vector = SBE_VEC_MIXED;
+    pcm.seed = 1;
+    p_pcm = (SINT16 *)malloc(frames * frame_samples * sizeof(SINT16));
+    for (xx = 0; xx < frames; xx++)
+    {
+        sbe_feed(&sbe_enc, &pcm);
+        memcpy(p_pcm + xx * frame_samples, sbe_enc.as16PcmBuffer, frame_samples * sizeof(SINT16));
+    }
+
+    sbe_enc.pu8Packet = frame;
+    t0 = bench_now_ns();
+    c0 = bench_cycles();
+    for (xx = 0; xx < frames; xx++)
+    {
+        memcpy(sbe_enc.as16PcmBuffer, p_pcm + xx * frame_samples, frame_samples * sizeof(SINT16));
+        SBC_Encoder(&sbe_enc);
+        res.bytes += sbe_enc.u16PacketLength;
+    }
+    cycles = bench_cycles() - c0;
+    res.elapsed_ns = bench_now_ns() - t0;
+    res.count = frames;
+
+    audio_secs = (double)frames * p_set->blocks * p_set->subbands / sample_rate[p_set->sampling_freq];
+    bench_extra(&res, "\"frames_per_sec\":%.0f,\"ns_per_frame\":%.1f,\"cycles_per_frame\":%.1f,"
+                "\"realtime_x\":%.1f", frames * (double)BENCH_NS_PER_SEC / res.elapsed_ns,
+                (double)res.elapsed_ns / frames, (double)cycles / frames,
+                audio_secs * BENCH_NS_PER_SEC / res.elapsed_ns);
+    bench_print_result(stdout, name, &res);
+
+    SbcAnalysisSetKernel(SBC_KERNEL_AUTO);
+    free(p_pcm);
+}
+
+static void sbe_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n frames        frames per setting and kernel in the benchmark (default %d)\n"
+            "  -x               bit exactness check only\n",
+            p_prog, SBE_DEFAULT_FRAMES);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    UINT32  frames = SBE_DEFAULT_FRAMES;
+    BOOLEAN exact_only = FALSE;
+    int     opt, failed = 0;
+    UINT32  xx, yy;
+
+    while ((opt = getopt(argc, argv, "n:xh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': frames = (UINT32)atoi(optarg); break;
+            case 'x': exact_only = TRUE; break;
+            default:
+                sbe_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (frames == 0)
+    {
+        fprintf(stderr, "sbc_enc_bench: bad option value\n");
+        return 2;
+    }
+
+    for (xx = 0; xx < SBE_NUM_KERNELS; xx++)
+        failed |= !sbe_run_exact(&sbe_kernels[xx]);
+
+    if (exact_only)
+        return failed;
+
+    for (yy = 0; yy < SBE_NUM_BENCH_SETTINGS; yy++)
+    {
+        for (xx = 0; xx < SBE_NUM_KERNELS; xx++)
+            sbe_run_speed(&sbe_bench_settings[yy], &sbe_kernels[xx], frames);
+    }
+
+    return failed;
+}
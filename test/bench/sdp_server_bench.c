@@ -0,0 +1,848 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2013 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      sdp_server_bench.c
+ *
+ *  Description:   SDP server benchmark
+ *
+ *                 Built twice, as sdp_server_indexed and sdp_server_scan,
+ *                 from sdp_db.c, sdp_server.c and sdp_utils.c, with the UUID
+ *                 index at its default size and at 1 entry, which overflows
+ *                 and leaves searches to the record by record scan. The
+ *                 database has 30 records by default, as profiles register
+ *                 them: service classes, some of 128 bits, protocol lists
+ *                 over L2CAP or RFCOMM, browse group, profile descriptor,
+ *                 name, and a long description in some.
+ *
+ *                 Requests go to sdp_server_handle_client_req() as L2CAP
+ *                 delivers them, continued as a client does until the whole
+ *                 attribute list is in. Every attribute list is checked
+ *                 against one built by the benchmark record by record,
+ *                 with sdpu_build_attrib_entry() for every attribute, as
+ *                 the server did before the records were pre-encoded.
+ *
+ *                 requests  Mix of the requests of an inquiring phone:
+ *                           browse of every record, service class search,
+ *                           protocol search for a few attributes, attribute
+ *                           request by handle, 128 bits service class
+ *                           search
+ *                 update    Attributes added, replaced and deleted and
+ *                           records deleted and created, each followed by
+ *                           a check of the encoded image of every
+ *                           attribute and by one request of each kind
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_report.h"
+#include "bt_target.h"
+#include "gki.h"
+#include "l2c_api.h"
+#include "sdp_api.h"
+#include "sdpint.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#if (SDP_MAX_UUID_INDEX > 1)
+#define SSB_MODE                "indexed"
+#else
+#define SSB_MODE                "scan"
+#endif
+
+#define SSB_DEFAULT_RECORDS     30
+#define SSB_DEFAULT_REQUESTS    10000
+#define SSB_DEFAULT_UPDATES     1000
+#define SSB_DEFAULT_MTU         SDP_MTU_SIZE
+#define SSB_MIN_MTU             48
+#define SSB_MAX_LIST            8192        /* reassembled attribute list */
+#define SSB_REQ_KINDS           5
+#define SSB_CID                 0x0040
+
+#define SSB_SERVCLASS(seed)     ((UINT16)(0x1100 + (seed)))
+#define SSB_PSM(seed)           ((UINT16)(0x1001 + 2 * (seed)))
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+/* a request as the client sends it, continuation state apart */
+typedef struct
+{
+    UINT8           pdu_id;
+    UINT8           uuid[SDP_MAX_UUID_FILTERS][MAX_UUID_SIZE];
+    UINT8           uuid_len[SDP_MAX_UUID_FILTERS];
+    UINT16          num_uuid;
+    UINT32          handle;                 /* ServiceAttribute request */
+    UINT16          attr_start[SDP_MAX_ATTR_FILTERS];
+    UINT16          attr_end[SDP_MAX_ATTR_FILTERS];
+    UINT16          num_attr;
+} tSSB_REQ;
+
+typedef struct
+{
+    /* settings */
+    int             num_records;
+    UINT32          requests;
+    UINT32          updates;
+    UINT16          mtu;
+
+    UINT16          next_seed;              /* of the next record created */
+    UINT32          seed;                   /* random numbers */
+
+    tCONN_CB        ccb;
+    BT_HDR          *p_rsp;                 /* last response sent */
+    UINT16          trans_num;
+
+    UINT8           list[SSB_MAX_LIST];     /* attribute list reassembled */
+    UINT8           ref[SSB_MAX_LIST];      /* attribute list built record by record */
+    UINT32          pdus;
+} tSSB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tSSB_CB ssb_cb;
+
+static const UINT8 ssb_base_uuid128[MAX_UUID_SIZE] =
+{
+    0x9a, 0x3c, 0x50, 0x00, 0x7d, 0x1e, 0x4b, 0x2a,
+    0xa1, 0x6f, 0x18, 0x05, 0xe2, 0x44, 0x00, 0x00
+};
+
+/*******************************************************************************
+**  Stubs of what GKI and the SDP server take from the rest of the stack
+********************************************************************************/
+
+tSDP_CB sdp_cb;
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4) {}
+void LogMsg_5(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5) {}
+void LogMsg_6(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5, UINT32 p6) {}
+
+void btu_start_timer(TIMER_LIST_ENT *p_tle, UINT16 type, UINT32 timeout) {}
+void btu_stop_timer(TIMER_LIST_ENT *p_tle) {}
+
+UINT8 L2CA_DataWrite(UINT16 cid, BT_HDR *p_data)
+{
+    if (ssb_cb.p_rsp != NULL)
+        GKI_freebuf(ssb_cb.p_rsp);
+    ssb_cb.p_rsp = p_data;
+    return L2CAP_DW_SUCCESS;
+}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static UINT32 ssb_rand(void)
+{
+    ssb_cb.seed = ssb_cb.seed * 1103515245 + 12345;
+    return ssb_cb.seed >> 8;
+}
+
+static void ssb_uuid128(UINT8 *p_uuid, UINT16 seed)
+{
+    memcpy(p_uuid, ssb_base_uuid128, MAX_UUID_SIZE);
+    p_uuid[MAX_UUID_SIZE - 2] = (UINT8)(seed >> 8);
+    p_uuid[MAX_UUID_SIZE - 1] = (UINT8)seed;
+}
+
+static void ssb_description(char *p_text, int len, UINT16 seed)
+{
+    int xx;
+
+    for (xx = 0; xx < len; xx++)
+        p_text[xx] = (char)('a' + (seed + xx) % 26);
+}
+
+/*******************************************************************************
+**
+** Function         ssb_add_record
+**
+** Description      Creates a record as a profile registers it: every 5th with
+**                  a 128 bits service class, every other one over RFCOMM,
+**                  every 7th with a description longer than the MTU.
+**
+** Returns          TRUE if done
+**
+*******************************************************************************/
+static BOOLEAN ssb_add_record(UINT16 seed)
+{
+    tSDP_PROTOCOL_ELEM  proto[2];
+    UINT8               seq[2 + 1 + MAX_UUID_SIZE];
+    UINT16              servclass[2], browse = UUID_SERVCLASS_PUBLIC_BROWSE_GROUP;
+    char                text[200];
+    UINT32              handle;
+    BOOLEAN             ok;
+
+    if ((handle = SDP_CreateRecord()) == 0)
+        return FALSE;
+
+    if ((seed % 5) == 4)
+    {
+        seq[0] = (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE;
+        seq[1] = 1 + MAX_UUID_SIZE;
+        seq[2] = (UUID_DESC_TYPE << 3) | SIZE_SIXTEEN_BYTES;
+        ssb_uuid128(&seq[3], seed);
+        ok = SDP_AddAttribute(handle, ATTR_ID_SERVICE_CLASS_ID_LIST, DATA_ELE_SEQ_DESC_TYPE,
+                              sizeof(seq), seq);
+    }
+    else
+    {
+        servclass[0] = SSB_SERVCLASS(seed);
+        servclass[1] = 0x1203;
+        ok = SDP_AddServiceClassIdList(handle, (seed % 4) ? 1 : 2, servclass);
+    }
+
+    memset(proto, 0, sizeof(proto));
+    proto[0].protocol_uuid = UUID_PROTOCOL_L2CAP;
+    if (seed & 1)
+    {
+        proto[1].protocol_uuid = UUID_PROTOCOL_RFCOMM;
+        proto[1].num_params = 1;
+        proto[1].params[0] = (UINT16)(1 + seed % 30);
+    }
+    else
+    {
+        proto[0].num_params = 1;
+        proto[0].params[0] = SSB_PSM(seed);
+    }
+    ok = ok && SDP_AddProtocolList(handle, (seed & 1) ? 2 : 1, proto);
+    ok = ok && SDP_AddUuidSequence(handle, ATTR_ID_BROWSE_GROUP_LIST, 1, &browse);
+    ok = ok && SDP_AddProfileDescriptorList(handle, SSB_SERVCLASS(seed), 0x0102);
+
+    snprintf(text, sizeof(text), "Service %u", seed);
+    ok = ok && SDP_AddAttribute(handle, ATTR_ID_SERVICE_NAME, TEXT_STR_DESC_TYPE,
+                                (UINT32)strlen(text) + 1, (UINT8 *)text);
+    if ((seed % 7) == 3)
+    {
+        ssb_description(text, sizeof(text), seed);
+        ok = ok && SDP_AddAttribute(handle, ATTR_ID_SERVICE_DESCRIPTION, TEXT_STR_DESC_TYPE,
+                                    sizeof(text), (UINT8 *)text);
+    }
+    return ok;
+}
+
+/*******************************************************************************
+**
+** Function         ssb_make_req
+**
+** Description      Makes request number n of the mix
+**
+** Returns          void
+**
+*******************************************************************************/
+static void ssb_make_req(UINT32 n, tSSB_REQ *p_req)
+{
+    tSDP_DB *p_db = &sdp_cb.server_db;
+    UINT16  seed = (UINT16)((n / SSB_REQ_KINDS) % (ssb_cb.next_seed + 2));
+
+    memset(p_req, 0, sizeof(tSSB_REQ));
+    p_req->pdu_id = SDP_PDU_SERVICE_SEARCH_ATTR_REQ;
+    p_req->num_uuid = 1;
+    p_req->uuid_len[0] = 2;
+    p_req->num_attr = 1;
+    p_req->attr_end[0] = 0xFFFF;
+
+    switch (n % SSB_REQ_KINDS)
+    {
+        case 0:     /* browse */
+            UINT16_TO_BE_FIELD(p_req->uuid[0], UUID_SERVCLASS_PUBLIC_BROWSE_GROUP);
+            break;
+
+        case 1:     /* service class, may not be in the database */
+            UINT16_TO_BE_FIELD(p_req->uuid[0], SSB_SERVCLASS(seed));
+            break;
+
+        case 2:     /* RFCOMM services, their class and protocols */
+            p_req->num_uuid = 2;
+            p_req->uuid_len[1] = 2;
+            UINT16_TO_BE_FIELD(p_req->uuid[0], UUID_PROTOCOL_L2CAP);
+            UINT16_TO_BE_FIELD(p_req->uuid[1], UUID_PROTOCOL_RFCOMM);
+            p_req->num_attr = 3;
+            p_req->attr_start[0] = p_req->attr_end[0] = ATTR_ID_SERVICE_CLASS_ID_LIST;
+            p_req->attr_start[1] = p_req->attr_end[1] = ATTR_ID_PROTOCOL_DESC_LIST;
+            p_req->attr_start[2] = ATTR_ID_SERVICE_NAME;
+            p_req->attr_end[2] = ATTR_ID_SERVICE_DESCRIPTION;
+            break;
+
+        case 3:     /* attributes of a record */
+            p_req->pdu_id = SDP_PDU_SERVICE_ATTR_REQ;
+            p_req->num_uuid = 0;
+            p_req->handle = p_db->record[seed % p_db->num_records].record_handle;
+            break;
+
+        default:    /* 128 bits service class */
+            p_req->uuid_len[0] = MAX_UUID_SIZE;
+            ssb_uuid128(p_req->uuid[0], (UINT16)(5 * (seed / 5) + 4));
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         ssb_send_req
+**
+** Description      Sends a request, or its continuation, to the server the
+**                  way L2CAP delivers it
+**
+** Returns          void
+**
+*******************************************************************************/
+static void ssb_send_req(tSSB_REQ *p_req, UINT8 *p_cont, UINT8 cont_len)
+{
+    BT_HDR  *p_buf = (BT_HDR *)GKI_getpoolbuf(SDP_POOL_ID);
+    UINT8   *p, *p_param_len, *p_seq_len;
+    UINT16  xx;
+
+    p_buf->offset = L2CAP_MIN_OFFSET;
+    p = (UINT8 *)(p_buf + 1) + p_buf->offset;
+
+    UINT8_TO_BE_STREAM(p, p_req->pdu_id);
+    UINT16_TO_BE_STREAM(p, ++ssb_cb.trans_num);
+    p_param_len = p;
+    p += 2;
+
+    if (p_req->pdu_id == SDP_PDU_SERVICE_ATTR_REQ)
+    {
+        UINT32_TO_BE_STREAM(p, p_req->handle);
+    }
+    else
+    {
+        UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+        p_seq_len = p++;
+        for (xx = 0; xx < p_req->num_uuid; xx++)
+        {
+            UINT8_TO_BE_STREAM(p, (UUID_DESC_TYPE << 3) |
+                               ((p_req->uuid_len[xx] == 2) ? SIZE_TWO_BYTES : SIZE_SIXTEEN_BYTES));
+            ARRAY_TO_BE_STREAM(p, p_req->uuid[xx], p_req->uuid_len[xx]);
+        }
+        *p_seq_len = (UINT8)(p - p_seq_len - 1);
+    }
+
+    /* as much as the MTU allows */
+    UINT16_TO_BE_STREAM(p, 0xFFFF);
+
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+    p_seq_len = p++;
+    for (xx = 0; xx < p_req->num_attr; xx++)
+    {
+        if (p_req->attr_start[xx] == p_req->attr_end[xx])
+        {
+            UINT8_TO_BE_STREAM(p, (UINT_DESC_TYPE << 3) | SIZE_TWO_BYTES);
+            UINT16_TO_BE_STREAM(p, p_req->attr_start[xx]);
+        }
+        else
+        {
+            UINT8_TO_BE_STREAM(p, (UINT_DESC_TYPE << 3) | SIZE_FOUR_BYTES);
+            UINT16_TO_BE_STREAM(p, p_req->attr_start[xx]);
+            UINT16_TO_BE_STREAM(p, p_req->attr_end[xx]);
+        }
+    }
+    *p_seq_len = (UINT8)(p - p_seq_len - 1);
+
+    UINT8_TO_BE_STREAM(p, cont_len);
+    ARRAY_TO_BE_STREAM(p, p_cont, cont_len);
+
+    p_buf->len = (UINT16)(p - (UINT8 *)(p_buf + 1) - p_buf->offset);
+    UINT16_TO_BE_STREAM(p_param_len, p_buf->len - 5);
+
+    sdp_server_handle_client_req(&ssb_cb.ccb, p_buf);
+    GKI_freebuf(p_buf);
+}
+
+/*******************************************************************************
+**
+** Function         ssb_transaction
+**
+** Description      Runs a request with its continuations on a new connection,
+**                  and reassembles the attribute list of the responses.
+**
+** Returns          length of the attribute list, -1 on an error response,
+**                  timing of the server in *p_ns
+**
+*******************************************************************************/
+static int ssb_transaction(tSSB_REQ *p_req, uint64_t *p_ns)
+{
+    UINT8       cont[SDP_CONTINUATION_LEN], cont_len = 0, rsp_id;
+    UINT8       *p;
+    UINT16      list_len;
+    int         len = 0;
+    uint64_t    t0;
+
+    memset(&ssb_cb.ccb, 0, sizeof(tCONN_CB));
+    ssb_cb.ccb.con_state = SDP_STATE_CONNECTED;
+    ssb_cb.ccb.connection_id = SSB_CID;
+    ssb_cb.ccb.rem_mtu_size = ssb_cb.mtu;
+    *p_ns = 0;
+
+    rsp_id = (p_req->pdu_id == SDP_PDU_SERVICE_ATTR_REQ) ? SDP_PDU_SERVICE_ATTR_RSP :
+                                                           SDP_PDU_SERVICE_SEARCH_ATTR_RSP;
+    do
+    {
+        t0 = bench_now_ns();
+        ssb_send_req(p_req, cont, cont_len);
+        *p_ns += bench_now_ns() - t0;
+        ssb_cb.pdus++;
+
+        if (ssb_cb.p_rsp == NULL)
+            return -1;
+        p = (UINT8 *)(ssb_cb.p_rsp + 1) + ssb_cb.p_rsp->offset;
+        if (*p != rsp_id)
+            return -1;
+
+        p += 5;
+        BE_STREAM_TO_UINT16(list_len, p);
+        if ((len + list_len > SSB_MAX_LIST) || (list_len > ssb_cb.mtu))
+            return -1;
+        memcpy(&ssb_cb.list[len], p, list_len);
+        len += list_len;
+        p += list_len;
+
+        cont_len = *p++;
+        if (cont_len > SDP_CONTINUATION_LEN)
+            return -1;
+        memcpy(cont, p, cont_len);
+
+        GKI_freebuf(ssb_cb.p_rsp);
+        ssb_cb.p_rsp = NULL;
+    } while (cont_len != 0);
+
+    sdpu_release_ccb(&ssb_cb.ccb);
+    return len;
+}
+
+static BOOLEAN ssb_seq_has_uuid(UINT8 *p, UINT32 seq_len, UINT8 *p_uuid, UINT16 uuid_len,
+                                int nest_level)
+{
+    UINT8   *p_end = p + seq_len;
+    UINT8   type;
+    UINT32  len;
+
+    if (nest_level > 3)
+        return FALSE;
+
+    while (p < p_end)
+    {
+        type = *p++;
+        p = sdpu_get_len_from_type(p, type, &len);
+        type = type >> 3;
+        if ((type == UUID_DESC_TYPE) && sdpu_compare_uuid_arrays(p, len, p_uuid, uuid_len))
+            return TRUE;
+        if ((type == DATA_ELE_SEQ_DESC_TYPE) &&
+            ssb_seq_has_uuid(p, len, p_uuid, uuid_len, nest_level + 1))
+            return TRUE;
+        p += len;
+    }
+    return FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         ssb_ref_record
+**
+** Description      Builds the attributes of a record in the ranges of the
+**                  request, attribute by attribute with
+**                  sdpu_build_attrib_entry()
+**
+** Returns          next byte of p
+**
+*******************************************************************************/
+static UINT8 *ssb_ref_record(tSDP_RECORD *p_rec, tSSB_REQ *p_req, UINT8 *p)
+{
+    tSDP_ATTRIBUTE  *p_attr;
+    UINT16          xx, yy;
+
+    for (xx = 0; xx < p_req->num_attr; xx++)
+    {
+        for (yy = 0, p_attr = &p_rec->attribute[0]; yy < p_rec->num_attributes; yy++, p_attr++)
+        {
+            if ((p_attr->id >= p_req->attr_start[xx]) && (p_attr->id <= p_req->attr_end[xx]))
+                p = sdpu_build_attrib_entry(p, p_attr);
+        }
+    }
+    return p;
+}
+
+/*******************************************************************************
+**
+** Function         ssb_ref_list
+**
+** Description      Builds the attribute list of a request as the server did
+**                  before the records were pre-encoded: records found by
+**                  scanning their attributes, attributes built one by one.
+**
+** Returns          length of the attribute list
+**
+*******************************************************************************/
+static int ssb_ref_list(tSSB_REQ *p_req)
+{
+    tSDP_DB         *p_db = &sdp_cb.server_db;
+    tSDP_RECORD     *p_rec;
+    tSDP_ATTRIBUTE  *p_attr;
+    UINT8           *p = &ssb_cb.ref[3], *p_seq;
+    UINT16          xx, yy, zz, seq_len;
+    int             len;
+
+    for (zz = 0, p_rec = &p_db->record[0]; zz < p_db->num_records; zz++, p_rec++)
+    {
+        if (p_req->pdu_id == SDP_PDU_SERVICE_ATTR_REQ)
+        {
+            if (p_rec->record_handle == p_req->handle)
+                p = ssb_ref_record(p_rec, p_req, p);
+            continue;
+        }
+
+        for (yy = 0; yy < p_req->num_uuid; yy++)
+        {
+            for (xx = 0, p_attr = &p_rec->attribute[0]; xx < p_rec->num_attributes; xx++, p_attr++)
+            {
+                if ((p_attr->type == UUID_DESC_TYPE) &&
+                    sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
+                                             p_req->uuid[yy], p_req->uuid_len[yy]))
+                    break;
+                if ((p_attr->type == DATA_ELE_SEQ_DESC_TYPE) &&
+                    ssb_seq_has_uuid(p_attr->value_ptr, p_attr->len,
+                                     p_req->uuid[yy], p_req->uuid_len[yy], 0))
+                    break;
+            }
+            if (xx == p_rec->num_attributes)
+                break;
+        }
+        if (yy < p_req->num_uuid)
+            continue;
+
+        /* records without any of the attributes are left out */
+        p_seq = p;
+        p = ssb_ref_record(p_rec, p_req, p + 3);
+        if (p == p_seq + 3)
+        {
+            p = p_seq;
+            continue;
+        }
+        seq_len = (UINT16)(p - p_seq - 3);
+        UINT8_TO_BE_STREAM(p_seq, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
+        UINT16_TO_BE_STREAM(p_seq, seq_len);
+    }
+
+    /* the server takes a 3 bytes header past 252 bytes */
+    len = (int)(p - &ssb_cb.ref[3]);
+    if (len + 3 > 255)
+    {
+        ssb_cb.ref[0] = (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD;
+        ssb_cb.ref[1] = (UINT8)(len >> 8);
+        ssb_cb.ref[2] = (UINT8)len;
+        return len + 3;
+    }
+    ssb_cb.ref[1] = (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE;
+    ssb_cb.ref[2] = (UINT8)len;
+    memmove(&ssb_cb.ref[0], &ssb_cb.ref[1], len + 2);
+    return len + 2;
+}
+
+/*******************************************************************************
+**
+** Function         ssb_check_req
+**
+** Description      Runs request number n and checks its attribute list
+**
+** Returns          TRUE if it matches, time of the server in *p_ns
+**
+*******************************************************************************/
+static BOOLEAN ssb_check_req(UINT32 n, uint64_t *p_ns, int *p_len)
+{
+    tSSB_REQ    req;
+    int         ref_len;
+
+    ssb_make_req(n, &req);
+    *p_len = ssb_transaction(&req, p_ns);
+    ref_len = ssb_ref_list(&req);
+
+    return (*p_len == ref_len) && (memcmp(ssb_cb.list, ssb_cb.ref, ref_len) == 0);
+}
+
+/*******************************************************************************
+**
+** Function         ssb_check_images
+**
+** Description      Checks the encoded image of every attribute of every record
+**                  against sdpu_build_attrib_entry(), and the length of the
+**                  whole range against the sum of the entries
+**
+** Returns          TRUE if they match
+**
+*******************************************************************************/
+static BOOLEAN ssb_check_images(void)
+{
+    tSDP_DB         *p_db = &sdp_cb.server_db;
+    tSDP_RECORD     *p_rec;
+    tSDP_ATTRIBUTE  *p_attr;
+    UINT8           entry[SDP_MAX_ATTR_LEN + 8], *p_image;
+    UINT16          xx, zz, len, total;
+
+    for (zz = 0, p_rec = &p_db->record[0]; zz < p_db->num_records; zz++, p_rec++)
+    {
+        total = 0;
+        for (xx = 0, p_attr = &p_rec->attribute[0]; xx < p_rec->num_attributes; xx++, p_attr++)
+        {
+            p_image = sdp_db_get_attr_image(p_rec, p_attr, &len);
+            if ((len != (UINT16)(sdpu_build_attrib_entry(entry, p_attr) - entry)) ||
+                (len != sdpu_get_attrib_entry_len(p_attr)) ||
+                (memcmp(p_image, entry, len) != 0))
+                return FALSE;
+            total += len;
+        }
+        if (sdp_db_get_range_len(p_rec, 0, 0xFFFF) != total)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         ssb_params
+**
+** Description      Fills the parameters of a result
+**
+** Returns          void
+**
+*******************************************************************************/
+static void ssb_params(tBENCH_RESULT *p_res)
+{
+    snprintf(p_res->params, sizeof(p_res->params),
+             "\"mode\":\"%s\",\"records\":%d,\"mtu\":%u,\"uuid_index\":%d",
+             SSB_MODE, ssb_cb.num_records, ssb_cb.mtu, SDP_MAX_UUID_INDEX);
+}
+
+/*******************************************************************************
+**
+** Function         ssb_run_requests
+**
+** Description      Runs the requests case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN ssb_run_requests(void)
+{
+    tBENCH_RESULT   res;
+    uint64_t        ns;
+    UINT32          n;
+    int             len;
+
+    bench_result_init(&res);
+    ssb_params(&res);
+    res.p_samples_name = "transaction_us";
+    bench_samples_init(&res.samples, ssb_cb.requests);
+    ssb_cb.pdus = 0;
+
+    for (n = 0; n < ssb_cb.requests; n++)
+    {
+        if (!ssb_check_req(n, &ns, &len))
+        {
+            bench_fail(&res, "request %u of kind %u: attribute list differs", n, n % SSB_REQ_KINDS);
+            break;
+        }
+        res.elapsed_ns += ns;
+        res.bytes += len;
+        res.count++;
+        bench_samples_add(&res.samples, ns);
+    }
+
+    bench_extra(&res, "\"pdus\":%u", ssb_cb.pdus);
+    bench_print_result(stdout, "sdp_server_" SSB_MODE "_requests", &res);
+    bench_samples_free(&res.samples);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         ssb_update
+**
+** Description      Changes the database at random
+**
+** Returns          TRUE if the change was made
+**
+*******************************************************************************/
+static BOOLEAN ssb_update(void)
+{
+    tSDP_DB *p_db = &sdp_cb.server_db;
+    UINT32  handle = p_db->record[ssb_rand() % p_db->num_records].record_handle;
+    char    text[200];
+    int     len;
+
+    switch (ssb_rand() % 4)
+    {
+        case 0:     /* description added or replaced */
+            len = 1 + (int)(ssb_rand() % sizeof(text));
+            ssb_description(text, len, (UINT16)handle);
+            return SDP_AddAttribute(handle, ATTR_ID_SERVICE_DESCRIPTION, TEXT_STR_DESC_TYPE,
+                                    (UINT32)len, (UINT8 *)text);
+
+        case 1:
+            SDP_DeleteAttribute(handle, ATTR_ID_SERVICE_DESCRIPTION);
+            return TRUE;
+
+        case 2:     /* service name replaced */
+            snprintf(text, sizeof(text), "Service %u renamed %u", (UINT16)handle, ssb_rand() % 1000);
+            return SDP_AddAttribute(handle, ATTR_ID_SERVICE_NAME, TEXT_STR_DESC_TYPE,
+                                    (UINT32)strlen(text) + 1, (UINT8 *)text);
+
+        default:    /* records after it move down */
+            return SDP_DeleteRecord(handle) && ssb_add_record(ssb_cb.next_seed++);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         ssb_run_update
+**
+** Description      Runs the update case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN ssb_run_update(void)
+{
+    tBENCH_RESULT   res;
+    uint64_t        ns, t0;
+    UINT32          n, kind;
+    int             len;
+
+    bench_result_init(&res);
+    ssb_params(&res);
+    ssb_cb.seed = 1;
+
+    for (n = 0; n < ssb_cb.updates; n++)
+    {
+        t0 = bench_now_ns();
+        if (!ssb_update())
+        {
+            bench_fail(&res, "update %u not made", n);
+            break;
+        }
+        res.elapsed_ns += bench_now_ns() - t0;
+
+        if (!ssb_check_images())
+        {
+            bench_fail(&res, "encoded image differs after update %u", n);
+            break;
+        }
+        for (kind = 0; kind < SSB_REQ_KINDS; kind++)
+        {
+            if (!ssb_check_req(n * SSB_REQ_KINDS + kind, &ns, &len))
+                break;
+        }
+        if (kind < SSB_REQ_KINDS)
+        {
+            bench_fail(&res, "request of kind %u: attribute list differs after update %u", kind, n);
+            break;
+        }
+        res.count++;
+    }
+
+    bench_print_result(stdout, "sdp_server_" SSB_MODE "_update", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+static void ssb_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -r count         records (default %d, max %d)\n"
+            "  -n count         requests (default %d)\n"
+            "  -u count         updates (default %d)\n"
+            "  -m bytes         L2CAP MTU of the client (default %d)\n",
+            p_prog, SSB_DEFAULT_RECORDS, SDP_MAX_RECORDS, SSB_DEFAULT_REQUESTS,
+            SSB_DEFAULT_UPDATES, SSB_DEFAULT_MTU);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int opt, failed = 0;
+
+    ssb_cb.num_records = SSB_DEFAULT_RECORDS;
+    ssb_cb.requests = SSB_DEFAULT_REQUESTS;
+    ssb_cb.updates = SSB_DEFAULT_UPDATES;
+    ssb_cb.mtu = SSB_DEFAULT_MTU;
+
+    while ((opt = getopt(argc, argv, "r:n:u:m:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': ssb_cb.num_records = atoi(optarg); break;
+            case 'n': ssb_cb.requests = (UINT32)atoi(optarg); break;
+            case 'u': ssb_cb.updates = (UINT32)atoi(optarg); break;
+            case 'm': ssb_cb.mtu = (UINT16)atoi(optarg); break;
+            default:
+                ssb_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    GKI_init();
+
+    /* responses have to fit a buffer of the SDP pool */
+    if ((ssb_cb.num_records <= 0) || (ssb_cb.num_records > SDP_MAX_RECORDS) ||
+        (ssb_cb.requests == 0) || (ssb_cb.mtu < SSB_MIN_MTU) ||
+        (ssb_cb.mtu + L2CAP_MIN_OFFSET + sizeof(BT_HDR) > GKI_get_pool_bufsize(SDP_POOL_ID)))
+    {
+        fprintf(stderr, "sdp_server_bench: bad option value\n");
+        return 2;
+    }
+
+    memset(&sdp_cb, 0, sizeof(sdp_cb));
+    sdp_cb.trace_level = BT_TRACE_LEVEL_NONE;
+    for (ssb_cb.next_seed = 0; ssb_cb.next_seed < ssb_cb.num_records; ssb_cb.next_seed++)
+    {
+        if (!ssb_add_record(ssb_cb.next_seed))
+        {
+            fprintf(stderr, "sdp_server_bench: cannot build the database\n");
+            return 1;
+        }
+    }
+
+    failed |= !ssb_check_images();
+    if (failed)
+        fprintf(stderr, "sdp_server_bench: encoded image differs\n");
+    failed |= !ssb_run_requests();
+    failed |= !ssb_run_update();
+    return failed;
+}
@@ -0,0 +1,599 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2013 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+
+/******************************************************************************
+ *
+ *  Filename:      smp_aes_bench.c
+ *
+ *  Description:   SMP AES-128 test and benchmark
+ *
+ *                 Built from smp_aes.c, included here to reach the software
+ *                 cipher next to the one smp_aes_init() picks for this CPU,
+ *                 and from smp_cmac.c. Each backend is run in turn through
+ *                 the smp_aes dispatch, so smp_aes_encrypt_le() and
+ *                 AES_CMAC() use it as the stack does.
+ *
+ *                 vectors     FIPS-197 appendix C.1, the c1 and s1 sample
+ *                             data of the core specification (Vol 3 Part H
+ *                             2.2.3 and 2.2.4) and RFC 4493 examples 1 to 4
+ *                             on every backend
+ *                 crosscheck  Random keys and blocks through the software
+ *                             and the hardware cipher, one key at a time
+ *                             and many keys at once; skipped when the CPU
+ *                             has no AES instructions
+ *                 encrypt     One block, round keys expanded beforehand
+ *                 set_key     One block under a new key each time, through
+ *                             the key cache as smp_encrypt_data() does
+ *                 multi       One block under every IRK of the resolving
+ *                             list, as SMP_MatchRpa() does
+ *                 cmac        AES-CMAC of a signed write sized message
+ *
+ ******************************************************************************/
+
+#include <getopt.h>
+#include <stdlib.h>
+
+#include "bench_report.h"
+#include "btm_ble_api.h"
+
+/* The cipher under test, with its static backends and dispatch */
+#include "smp_aes.c"
+
+extern BOOLEAN AES_CMAC (BT_OCTET16 key, UINT8 *input, UINT16 length, UINT16 tlen, UINT8 *p_signature);
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define SAB_DEFAULT_ITERS       1000000
+#define SAB_DEFAULT_CHECKS      100000
+#define SAB_DEFAULT_IRKS        500
+#define SAB_MAX_IRKS            4096
+#define SAB_CMAC_LEN            64      /* signed write: value and sign counter */
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+/* One of the ciphers smp_aes can dispatch to */
+typedef struct
+{
+    const char          *p_name;
+    tSMP_AES_ENCRYPT_FN *p_encrypt;
+    tSMP_AES_MULTI_FN   *p_encrypt_multi;
+} tSAB_BACKEND;
+
+/* A known answer, MSB first as the documents give them */
+typedef struct
+{
+    const char  *p_name;
+    const char  *p_key;
+    const char  *p_in;          /* hex, any multiple of 2 digits for CMAC   */
+    const char  *p_out;
+} tSAB_VECTOR;
+
+typedef struct
+{
+    /* settings */
+    UINT32          iters;
+    UINT32          checks;
+    UINT16          num_irks;
+
+    UINT32          seed;
+    tSAB_BACKEND    backend[2];             /* software first */
+    int             num_backends;
+    const char      *p_hw_name;             /* as smp_aes_init() traces it */
+    tSMP_AES_KEY    irk_ks[SAB_MAX_IRKS];
+    UINT8           irk_out[SAB_MAX_IRKS * BT_OCTET16_LEN];
+    UINT8           ref_out[SAB_MAX_IRKS * BT_OCTET16_LEN];
+} tSAB_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tSAB_CB sab_cb;
+
+static const tSAB_VECTOR sab_aes_vectors[] =
+{
+    { "fips197_c1", "000102030405060708090a0b0c0d0e0f",
+      "00112233445566778899aabbccddeeff", "69c4e0d86a7b0430d8cdb78070b4c55a" },
+};
+
+/* in: r, p1, p2 for c1 and r1, r2 for s1 */
+static const tSAB_VECTOR sab_c1_vector =
+{
+    "c1", "00000000000000000000000000000000",
+    "5783d52156ad6f0e6388274ec6702ee0"
+    "05000800000302070710000001010001"
+    "00000000a1a2a3a4a5a6b1b2b3b4b5b6",
+    "1e1e3fef878988ead2a74dc5bef13b86"
+};
+
+static const tSAB_VECTOR sab_s1_vector =
+{
+    "s1", "00000000000000000000000000000000",
+    "000f0e0d0c0b0a091122334455667788"
+    "010203040506070899aabbccddeeff00",
+    "9a1fe1f0e8b0f49b5b4216ae796da062"
+};
+
+static const tSAB_VECTOR sab_cmac_vectors[] =
+{
+    { "rfc4493_1", "2b7e151628aed2a6abf7158809cf4f3c",
+      "",
+      "bb1d6929e95937287fa37d129b756746" },
+    { "rfc4493_2", "2b7e151628aed2a6abf7158809cf4f3c",
+      "6bc1bee22e409f96e93d7e117393172a",
+      "070a16b46b4d4144f79bdd9dd04a287c" },
+    { "rfc4493_3", "2b7e151628aed2a6abf7158809cf4f3c",
+      "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+      "30c81c46a35ce411",
+      "dfa66747de9ae63030ca32611497c827" },
+    { "rfc4493_4", "2b7e151628aed2a6abf7158809cf4f3c",
+      "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+      "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710",
+      "51f0bebf7e3b9d92fc49741779363cfe" },
+};
+
+/*******************************************************************************
+**  Stubs of what GKI and smp_cmac.c take from the rest of the stack
+********************************************************************************/
+
+tSMP_CB smp_cb;
+
+void raise_priority_a2dp(int high_task) {}
+void LogMsg_0(UINT32 trace_set_mask, const char *p_str) {}
+void LogMsg_1(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1) {}
+void LogMsg_2(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2) {}
+void LogMsg_3(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3) {}
+void LogMsg_4(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4) {}
+void LogMsg_5(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5) {}
+void LogMsg_6(UINT32 trace_set_mask, const char *fmt_str, UINT32 p1, UINT32 p2,
+              UINT32 p3, UINT32 p4, UINT32 p5, UINT32 p6) {}
+
+/* smp_utils.c, which brings in the whole of SMP with it */
+void smp_xor_128(BT_OCTET16 a, BT_OCTET16 b)
+{
+    int i;
+
+    for (i = 0; i < BT_OCTET16_LEN; i++)
+        a[i] ^= b[i];
+}
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static UINT32 sab_rand(void)
+{
+    sab_cb.seed = sab_cb.seed * 1103515245 + 12345;
+    return sab_cb.seed >> 8;
+}
+
+static void sab_rand_block(UINT8 *p)
+{
+    int i;
+
+    for (i = 0; i < BT_OCTET16_LEN; i++)
+        p[i] = (UINT8)sab_rand();
+}
+
+/*******************************************************************************
+**
+** Function         sab_hex
+**
+** Description      Converts the first len bytes of hex digits, all of them
+**                  if len is 0, reversed to LSB first if le is TRUE
+**
+** Returns          Number of bytes
+**
+*******************************************************************************/
+static int sab_hex(const char *p_hex, int len, UINT8 *p_out, BOOLEAN le)
+{
+    int i;
+    unsigned int b;
+
+    if (len == 0)
+        len = (int)strlen(p_hex) / 2;
+    for (i = 0; i < len; i++)
+    {
+        sscanf(&p_hex[2 * i], "%2x", &b);
+        p_out[le ? (len - 1 - i) : i] = (UINT8)b;
+    }
+    return len;
+}
+
+/*******************************************************************************
+**
+** Function         sab_use
+**
+** Description      Makes smp_aes dispatch to the backend
+**
+** Returns          void
+**
+*******************************************************************************/
+static void sab_use(const tSAB_BACKEND *p_be)
+{
+    smp_aes_cb.p_encrypt = p_be->p_encrypt;
+    smp_aes_cb.p_encrypt_multi = p_be->p_encrypt_multi;
+    smp_aes_cb.p_name = p_be->p_name;
+}
+
+/*******************************************************************************
+**
+** Function         sab_check_vectors
+**
+** Description      Runs the known answers on the backend in use. c1 and s1
+**                  are built as smp_keys.c builds them, LSB first.
+**
+** Returns          Name of the first vector that fails, NULL if none
+**
+*******************************************************************************/
+static const char *sab_check_vectors(uint32_t *p_count)
+{
+    UINT8       key[BT_OCTET16_LEN], out[BT_OCTET16_LEN], exp[BT_OCTET16_LEN];
+    UINT8       in[SAB_CMAC_LEN], r[BT_OCTET16_LEN];
+    tSMP_AES_KEY ks;
+    int         i, len;
+
+    for (i = 0; i < (int)(sizeof(sab_aes_vectors) / sizeof(sab_aes_vectors[0])); i++)
+    {
+        sab_hex(sab_aes_vectors[i].p_key, BT_OCTET16_LEN, key, FALSE);
+        sab_hex(sab_aes_vectors[i].p_in, BT_OCTET16_LEN, in, FALSE);
+        sab_hex(sab_aes_vectors[i].p_out, BT_OCTET16_LEN, exp, FALSE);
+
+        smp_aes_set_key(key, &ks);
+        smp_aes_encrypt(&ks, in, out);
+        if (memcmp(out, exp, BT_OCTET16_LEN) != 0)
+            return sab_aes_vectors[i].p_name;
+        smp_aes_encrypt_multi(&ks, 1, in, out);
+        if (memcmp(out, exp, BT_OCTET16_LEN) != 0)
+            return sab_aes_vectors[i].p_name;
+        (*p_count)++;
+    }
+
+    /* c1 = e(k, e(k, r XOR p1) XOR p2) */
+    sab_hex(sab_c1_vector.p_key, BT_OCTET16_LEN, key, TRUE);
+    sab_hex(sab_c1_vector.p_out, BT_OCTET16_LEN, exp, TRUE);
+    sab_hex(sab_c1_vector.p_in, BT_OCTET16_LEN, r, TRUE);
+    sab_hex(sab_c1_vector.p_in + 32, BT_OCTET16_LEN, in, TRUE);
+    sab_hex(sab_c1_vector.p_in + 64, BT_OCTET16_LEN, &in[BT_OCTET16_LEN], TRUE);
+    smp_xor_128(r, in);
+    smp_aes_encrypt_le(key, r, out);
+    smp_xor_128(out, &in[BT_OCTET16_LEN]);
+    smp_aes_encrypt_le(key, out, out);
+    if (memcmp(out, exp, BT_OCTET16_LEN) != 0)
+        return sab_c1_vector.p_name;
+    (*p_count)++;
+
+    /* s1 = e(k, r') with r' the least significant halves of r1 and r2, r1' on top */
+    sab_hex(sab_s1_vector.p_key, BT_OCTET16_LEN, key, TRUE);
+    sab_hex(sab_s1_vector.p_out, BT_OCTET16_LEN, exp, TRUE);
+    sab_hex(sab_s1_vector.p_in + 32, BT_OCTET16_LEN, in, TRUE);
+    sab_hex(sab_s1_vector.p_in, BT_OCTET16_LEN, &in[BT_OCTET16_LEN], TRUE);
+    memcpy(r, in, BT_OCTET16_LEN / 2);
+    memcpy(&r[BT_OCTET16_LEN / 2], &in[BT_OCTET16_LEN], BT_OCTET16_LEN / 2);
+    smp_aes_encrypt_le(key, r, out);
+    if (memcmp(out, exp, BT_OCTET16_LEN) != 0)
+        return sab_s1_vector.p_name;
+    (*p_count)++;
+
+    /* AES_CMAC() takes key, message and MAC LSB first */
+    for (i = 0; i < (int)(sizeof(sab_cmac_vectors) / sizeof(sab_cmac_vectors[0])); i++)
+    {
+        sab_hex(sab_cmac_vectors[i].p_key, BT_OCTET16_LEN, key, TRUE);
+        len = sab_hex(sab_cmac_vectors[i].p_in, 0, in, TRUE);
+        sab_hex(sab_cmac_vectors[i].p_out, BT_OCTET16_LEN, exp, TRUE);
+
+        if (!AES_CMAC(key, in, (UINT16)len, BT_OCTET16_LEN, out) ||
+            memcmp(out, exp, BT_OCTET16_LEN) != 0)
+            return sab_cmac_vectors[i].p_name;
+        (*p_count)++;
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         sab_run_vectors
+**
+** Description      Runs the vectors case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN sab_run_vectors(void)
+{
+    tBENCH_RESULT   res;
+    const char      *p_failed;
+    int             i;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"backends\":%d", sab_cb.num_backends);
+
+    for (i = 0; i < sab_cb.num_backends; i++)
+    {
+        sab_use(&sab_cb.backend[i]);
+        if ((p_failed = sab_check_vectors(&res.count)) != NULL)
+        {
+            bench_fail(&res, "%s: %s differs", sab_cb.backend[i].p_name, p_failed);
+            break;
+        }
+    }
+
+    bench_print_result(stdout, "smp_aes_vectors", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         sab_run_crosscheck
+**
+** Description      Runs the crosscheck case
+**
+** Returns          TRUE if it passed
+**
+*******************************************************************************/
+static BOOLEAN sab_run_crosscheck(void)
+{
+    tBENCH_RESULT   res;
+    const tSAB_BACKEND *p_sw = &sab_cb.backend[0];
+    const tSAB_BACKEND *p_hw = &sab_cb.backend[1];
+    UINT8           key[BT_OCTET16_LEN], in[BT_OCTET16_LEN];
+    UINT8           out_sw[BT_OCTET16_LEN], out_hw[BT_OCTET16_LEN];
+    UINT16          num_keys, k;
+    UINT32          n;
+
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"checks\":%u", sab_cb.checks);
+
+    if (sab_cb.num_backends < 2)
+    {
+        res.p_status = "skipped";
+        snprintf(res.reason, sizeof(res.reason), "no AES instructions on this CPU");
+        bench_print_result(stdout, "smp_aes_crosscheck", &res);
+        return TRUE;
+    }
+    bench_extra(&res, "\"hw\":\"%s\"", sab_cb.p_hw_name);
+
+    sab_cb.seed = 1;
+    for (n = 0; n < sab_cb.checks; n++)
+    {
+        sab_rand_block(key);
+        sab_rand_block(in);
+        smp_aes_set_key(key, &sab_cb.irk_ks[0]);
+
+        (*p_sw->p_encrypt)(&sab_cb.irk_ks[0], in, out_sw);
+        (*p_hw->p_encrypt)(&sab_cb.irk_ks[0], in, out_hw);
+        if (memcmp(out_sw, out_hw, BT_OCTET16_LEN) != 0)
+        {
+            bench_fail(&res, "block %u differs", n);
+            break;
+        }
+        res.count++;
+
+        /* every remainder of the 4 keys at a time loop, now and then */
+        if ((n % 64) == 0)
+        {
+            num_keys = (UINT16)(1 + sab_rand() % 11);
+            for (k = 0; k < num_keys; k++)
+            {
+                sab_rand_block(key);
+                smp_aes_set_key(key, &sab_cb.irk_ks[k]);
+            }
+            (*p_sw->p_encrypt_multi)(sab_cb.irk_ks, num_keys, in, sab_cb.ref_out);
+            (*p_hw->p_encrypt_multi)(sab_cb.irk_ks, num_keys, in, sab_cb.irk_out);
+            if (memcmp(sab_cb.ref_out, sab_cb.irk_out, num_keys * BT_OCTET16_LEN) != 0)
+            {
+                bench_fail(&res, "multi block %u under %u keys differs", n, num_keys);
+                break;
+            }
+            res.count += num_keys;
+        }
+    }
+
+    bench_print_result(stdout, "smp_aes_crosscheck", &res);
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+/*******************************************************************************
+**
+** Function         sab_run_speed
+**
+** Description      Runs the encrypt, set_key, multi and cmac cases on the
+**                  backend in use. Every output is fed back as the next
+**                  input so that no call can be skipped or overlapped.
+**
+** Returns          TRUE if they passed
+**
+*******************************************************************************/
+static BOOLEAN sab_run_speed(const tSAB_BACKEND *p_be)
+{
+    tBENCH_RESULT   res;
+    char            name[64];
+    UINT8           key[BT_OCTET16_LEN], block[BT_OCTET16_LEN];
+    UINT8           msg[SAB_CMAC_LEN];
+    tSMP_AES_KEY    ks;
+    uint64_t        t0;
+    UINT32          n, iters;
+    int             i;
+
+    sab_use(p_be);
+    sab_cb.seed = 1;
+    sab_rand_block(key);
+    sab_rand_block(block);
+
+    /* encrypt */
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"backend\":\"%s\"", p_be->p_name);
+    smp_aes_set_key(key, &ks);
+    t0 = bench_now_ns();
+    for (n = 0; n < sab_cb.iters; n++)
+        smp_aes_encrypt(&ks, block, block);
+    res.elapsed_ns = bench_now_ns() - t0;
+    res.count = sab_cb.iters;
+    res.bytes = (uint64_t)sab_cb.iters * BT_OCTET16_LEN;
+    bench_extra(&res, "\"ns_per_block\":%.1f", (double)res.elapsed_ns / res.count);
+    snprintf(name, sizeof(name), "smp_aes_%s_encrypt", p_be->p_name);
+    bench_print_result(stdout, name, &res);
+
+    /* set_key: the key changes with every block, the cache never hits */
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"backend\":\"%s\",\"key_cache\":%d",
+             p_be->p_name, SMP_AES_KEY_CACHE_SIZE);
+    iters = sab_cb.iters / 4;
+    t0 = bench_now_ns();
+    for (n = 0; n < iters; n++)
+    {
+        smp_aes_encrypt_le(key, block, block);
+        key[n % BT_OCTET16_LEN] ^= block[0] | 1;
+    }
+    res.elapsed_ns = bench_now_ns() - t0;
+    res.count = iters;
+    res.bytes = (uint64_t)iters * BT_OCTET16_LEN;
+    bench_extra(&res, "\"ns_per_block\":%.1f", (double)res.elapsed_ns / res.count);
+    snprintf(name, sizeof(name), "smp_aes_%s_set_key", p_be->p_name);
+    bench_print_result(stdout, name, &res);
+
+    /* multi: one RPA hash against the whole resolving list */
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"backend\":\"%s\",\"irks\":%u",
+             p_be->p_name, sab_cb.num_irks);
+    for (i = 0; i < sab_cb.num_irks; i++)
+    {
+        sab_rand_block(key);
+        smp_aes_set_key(key, &sab_cb.irk_ks[i]);
+    }
+    iters = sab_cb.iters / sab_cb.num_irks;
+    if (iters == 0)
+        iters = 1;
+    t0 = bench_now_ns();
+    for (n = 0; n < iters; n++)
+    {
+        smp_aes_encrypt_multi(sab_cb.irk_ks, sab_cb.num_irks, block, sab_cb.irk_out);
+        block[n % BT_OCTET16_LEN] ^= sab_cb.irk_out[(sab_cb.num_irks - 1) * BT_OCTET16_LEN];
+    }
+    res.elapsed_ns = bench_now_ns() - t0;
+    res.count = iters;
+    res.bytes = (uint64_t)iters * sab_cb.num_irks * BT_OCTET16_LEN;
+    bench_extra(&res, "\"us_per_list\":%.2f,\"ns_per_block\":%.1f",
+                (double)res.elapsed_ns / res.count / BENCH_NS_PER_US,
+                (double)res.elapsed_ns / res.count / sab_cb.num_irks);
+    snprintf(name, sizeof(name), "smp_aes_%s_multi", p_be->p_name);
+    bench_print_result(stdout, name, &res);
+
+    /* cmac */
+    bench_result_init(&res);
+    snprintf(res.params, sizeof(res.params), "\"backend\":\"%s\",\"len\":%d",
+             p_be->p_name, SAB_CMAC_LEN);
+    for (i = 0; i < SAB_CMAC_LEN; i += BT_OCTET16_LEN)
+        sab_rand_block(&msg[i]);
+    iters = sab_cb.iters / 8;
+    t0 = bench_now_ns();
+    for (n = 0; n < iters; n++)
+    {
+        if (!AES_CMAC(key, msg, SAB_CMAC_LEN, BTM_CMAC_TLEN_SIZE, block))
+        {
+            bench_fail(&res, "no buffer for AES_CMAC");
+            break;
+        }
+        msg[n % SAB_CMAC_LEN] ^= block[0];
+    }
+    res.elapsed_ns = bench_now_ns() - t0;
+    res.count = n;
+    res.bytes = (uint64_t)n * SAB_CMAC_LEN;
+    if (n > 0)
+        bench_extra(&res, "\"ns_per_mac\":%.1f", (double)res.elapsed_ns / n);
+    snprintf(name, sizeof(name), "smp_aes_%s_cmac", p_be->p_name);
+    bench_print_result(stdout, name, &res);
+
+    return (strcmp(res.p_status, "failed") != 0);
+}
+
+static void sab_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count         blocks of the encrypt case (default %d)\n"
+            "  -c count         blocks of the crosscheck case (default %d)\n"
+            "  -k count         IRKs of the multi case (default %d, max %d)\n",
+            p_prog, SAB_DEFAULT_ITERS, SAB_DEFAULT_CHECKS, SAB_DEFAULT_IRKS, SAB_MAX_IRKS);
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int opt, i, failed = 0;
+
+    sab_cb.iters = SAB_DEFAULT_ITERS;
+    sab_cb.checks = SAB_DEFAULT_CHECKS;
+    sab_cb.num_irks = SAB_DEFAULT_IRKS;
+
+    while ((opt = getopt(argc, argv, "n:c:k:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': sab_cb.iters = (UINT32)atoi(optarg); break;
+            case 'c': sab_cb.checks = (UINT32)atoi(optarg); break;
+            case 'k': sab_cb.num_irks = (UINT16)atoi(optarg); break;
+            default:
+                sab_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((sab_cb.iters < 8) || (sab_cb.num_irks == 0) || (sab_cb.num_irks > SAB_MAX_IRKS))
+    {
+        fprintf(stderr, "smp_aes_bench: bad option value\n");
+        return 2;
+    }
+
+    GKI_init();
+    memset(&smp_cb, 0, sizeof(smp_cb));
+    smp_cb.trace_level = BT_TRACE_LEVEL_NONE;
+
+    /* the software cipher always, the one picked for this CPU if another */
+    smp_aes_init();
+    sab_cb.backend[0].p_name = "sw";
+    sab_cb.backend[0].p_encrypt = smp_aes_encrypt_sw;
+    sab_cb.backend[0].p_encrypt_multi = smp_aes_encrypt_multi_sw;
+    sab_cb.num_backends = 1;
+    if (smp_aes_cb.p_encrypt != smp_aes_encrypt_sw)
+    {
+        sab_cb.backend[1].p_name = "hw";
+        sab_cb.p_hw_name = smp_aes_cb.p_name;
+        sab_cb.backend[1].p_encrypt = smp_aes_cb.p_encrypt;
+        sab_cb.backend[1].p_encrypt_multi = smp_aes_cb.p_encrypt_multi;
+        sab_cb.num_backends = 2;
+    }
+
+    failed |= !sab_run_vectors();
+    failed |= !sab_run_crosscheck();
+    for (i = 0; i < sab_cb.num_backends; i++)
+        failed |= !sab_run_speed(&sab_cb.backend[i]);
+    return failed;
+}
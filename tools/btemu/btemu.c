@@ -0,0 +1,1423 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      btemu.c
+ *
+ *  Description:   Controller core of btemu
+ *
+ *                 Everything runs in one loop around ppoll(). ACL packets from
+ *                 the host take one of acl_num_bufs controller buffers; each
+ *                 is released nocp_latency_us later, when it is reported in a
+ *                 Number Of Completed Packets event and, for loopback peers,
+ *                 sent back to the host. Completions due at the same time are
+ *                 reported in one event. Inquiry results and LE advertising
+ *                 reports are generated from timers while inquiry or LE scan
+ *                 is enabled, and advertising reports are dropped rather than
+ *                 queued while the host is not reading.
+ *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btemu.h"
+#include "hcidefs.h"
+#include "hcimsgs.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BTEMU_MAX_CONNS             16
+#define BTEMU_FIRST_HANDLE          0x0001
+
+#define BTEMU_RX_BUF_SIZE           0x10000
+#define BTEMU_TX_BUF_SIZE           0x100000
+#define BTEMU_TX_HIGH_WATER         (BTEMU_TX_BUF_SIZE / 2)
+
+/* Reports generated per pass of the loop, so a late wakeup cannot flood */
+#define BTEMU_MAX_ADV_PER_PASS      64
+
+#define BTEMU_H4_CMD                1
+#define BTEMU_H4_ACL                2
+#define BTEMU_H4_SCO                3
+#define BTEMU_H4_EVT                4
+
+#define BTEMU_NAME                  "btemu"
+
+#define BTEMU_HCI_VERSION           0x06        /* 4.0 */
+#define BTEMU_FEATURE_LE_OFF        4
+#define BTEMU_FEATURE_LE_MASK       0x40
+#define BTEMU_WHITE_LIST_SIZE       8
+
+#define BTEMU_INQ_MODE_STANDARD     0
+#define BTEMU_INQ_MODE_RSSI         1
+#define BTEMU_INQ_MODE_EXT          2
+
+#define BTEMU_PB_FIRST_NON_FLUSH    0
+#define BTEMU_PB_FIRST_FLUSH        2
+#define BTEMU_PB_SHIFT              12
+
+#define BTEMU_ADV_IND               0x00
+#define BTEMU_ADDR_PUBLIC           0x00
+#define BTEMU_ADV_FLAGS             0x06        /* general discoverable, no BR/EDR */
+
+#define BTEMU_COD                   {0x5a, 0x02, 0x0c}     /* smartphone */
+
+#define BTEMU_NS_PER_US             1000ULL
+#define BTEMU_NS_PER_SEC            1000000000ULL
+#define BTEMU_NEVER                 UINT64_MAX
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef struct
+{
+    BOOLEAN     in_use;
+    UINT16      handle;
+    BD_ADDR     bd_addr;
+    BOOLEAN     is_le;
+    UINT16      num_completed;      /* not yet reported to the host */
+} tBTEMU_CONN;
+
+/* A controller buffer holding one ACL packet from the host */
+typedef struct
+{
+    uint64_t    due_ns;
+    UINT16      handle;             /* 0 once the link has gone */
+    UINT16      len;                /* of the whole packet, header included */
+    UINT8       *p_data;
+} tBTEMU_ACL_BUF;
+
+typedef struct
+{
+    tBTEMU_CFG      cfg;
+    int             fd;
+    volatile BOOLEAN stopping;
+    volatile BOOLEAN stats_requested;
+
+    UINT16          next_handle;
+    tBTEMU_CONN     conn[BTEMU_MAX_CONNS];
+
+    /* controller buffers, released in the order they were taken */
+    tBTEMU_ACL_BUF  *p_bufs;
+    UINT8           *p_buf_mem;
+    UINT32          buf_first;
+    UINT32          buf_count;
+
+    /* inquiry */
+    BOOLEAN         inq_active;
+    UINT8           inq_mode;
+    UINT16          inq_next_peer;
+    UINT16          inq_max_rsp;
+    UINT16          inq_num_rsp;
+    uint64_t        inq_next_ns;
+
+    /* LE scan */
+    BOOLEAN         scan_active;
+    BOOLEAN         scan_filter_dup;
+    UINT8           *p_adv_seen;    /* one bit per LE peer, for duplicate filtering */
+    UINT16          adv_next_peer;
+    uint64_t        adv_next_ns;
+    uint64_t        adv_period_ns;
+    BOOLEAN         le_conn_pending;
+    BD_ADDR         le_conn_addr;
+
+    tBTEMU_STATS    stats;
+
+    UINT8           rx_buf[BTEMU_RX_BUF_SIZE];
+    UINT32          rx_len;
+    UINT8           tx_buf[BTEMU_TX_BUF_SIZE];
+    UINT32          tx_first;
+    UINT32          tx_len;
+} tBTEMU_CB;
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBTEMU_CB btemu_cb;
+
+static const BD_ADDR btemu_peer_base = BTEMU_PEER_ADDR_BASE;
+static const UINT8 btemu_cod[DEV_CLASS_LEN] = BTEMU_COD;
+
+/* Commands answered with zeroed return parameters after the status; echo_len
+** leading command parameters (the handle) are returned first */
+static const struct
+{
+    UINT16      opcode;
+    UINT8       echo_len;
+    UINT8       zero_len;
+} btemu_cc_tbl[] =
+{
+    {HCI_ROLE_DISCOVERY,            2, 1},
+    {HCI_READ_POLICY_SETTINGS,      2, 2},
+    {HCI_WRITE_POLICY_SETTINGS,     2, 0},
+    {HCI_SNIFF_SUB_RATE,            2, 0},
+    {HCI_FLUSH,                     2, 0},
+    {HCI_READ_AUTO_FLUSH_TOUT,      2, 2},
+    {HCI_WRITE_AUTO_FLUSH_TOUT,     2, 0},
+    {HCI_READ_LINK_SUPER_TOUT,      2, 2},
+    {HCI_WRITE_LINK_SUPER_TOUT,     2, 0},
+    {HCI_READ_TRANSMIT_POWER_LEVEL, 2, 1},
+    {HCI_GET_LINK_QUALITY,          2, 1},
+    {HCI_READ_RSSI,                 2, 1},
+    {HCI_READ_STORED_LINK_KEY,      0, 4},
+    {HCI_WRITE_STORED_LINK_KEY,     0, 1},
+    {HCI_DELETE_STORED_LINK_KEY,    0, 2},
+    {HCI_READ_LOCAL_SUPPORTED_CMDS, 0, 64},
+    {HCI_READ_LOCAL_OOB_DATA,       0, 32},
+    {HCI_READ_INQ_TX_POWER_LEVEL,   0, 1},
+    {HCI_BLE_READ_LOCAL_SPT_FEAT,   0, 8},
+    {HCI_BLE_READ_SUPPORTED_STATES, 0, 8},
+    {HCI_BLE_READ_ADV_CHNL_TX_POWER,0, 1},
+};
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         btemu_now_ns
+**
+** Description      Reads the monotonic clock.
+**
+** Returns          the time in ns
+**
+*******************************************************************************/
+static uint64_t btemu_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * BTEMU_NS_PER_SEC + ts.tv_nsec;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_flush
+**
+** Description      Writes out as much of what is queued for the host as the
+**                  descriptor takes without blocking.
+**
+** Returns          FALSE if the host has gone
+**
+*******************************************************************************/
+static BOOLEAN btemu_flush(void)
+{
+    ssize_t     ret;
+
+    while (btemu_cb.tx_len)
+    {
+        ret = write(btemu_cb.fd, btemu_cb.tx_buf + btemu_cb.tx_first, btemu_cb.tx_len);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+        btemu_cb.tx_first += ret;
+        btemu_cb.tx_len -= ret;
+    }
+    btemu_cb.tx_first = 0;
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_out
+**
+** Description      Queues an H4 packet for the host. When the queue is full
+**                  the caller is blocked until the host reads, so events and
+**                  data are never lost.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_out(UINT8 type, const UINT8 *p_hdr, UINT32 hdr_len, const UINT8 *p, UINT32 len)
+{
+    struct pollfd   pfd;
+    UINT32          need = 1 + hdr_len + len;
+    UINT8           *p_dst;
+
+    while (btemu_cb.tx_first + btemu_cb.tx_len + need > BTEMU_TX_BUF_SIZE)
+    {
+        if (btemu_cb.tx_first)
+        {
+            memmove(btemu_cb.tx_buf, btemu_cb.tx_buf + btemu_cb.tx_first, btemu_cb.tx_len);
+            btemu_cb.tx_first = 0;
+            continue;
+        }
+        pfd.fd = btemu_cb.fd;
+        pfd.events = POLLOUT;
+        if ((poll(&pfd, 1, -1) < 0 && errno != EINTR) || !btemu_flush() || btemu_cb.stopping)
+        {
+            btemu_cb.stopping = TRUE;
+            return;
+        }
+    }
+
+    p_dst = btemu_cb.tx_buf + btemu_cb.tx_first + btemu_cb.tx_len;
+    *p_dst++ = type;
+    memcpy(p_dst, p_hdr, hdr_len);
+    memcpy(p_dst + hdr_len, p, len);
+    btemu_cb.tx_len += need;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_evt
+**
+** Description      Queues an HCI event for the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_evt(UINT8 code, const UINT8 *p_param, UINT8 len)
+{
+    UINT8   hdr[HCIE_PREAMBLE_SIZE];
+
+    hdr[0] = code;
+    hdr[1] = len;
+    btemu_out(BTEMU_H4_EVT, hdr, sizeof(hdr), p_param, len);
+}
+
+/*******************************************************************************
+**
+** Function         btemu_cmd_cmpl
+**
+** Description      Queues a Command Complete event; p_ret holds the return
+**                  parameters after the status.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_cmd_cmpl(UINT16 opcode, UINT8 status, const UINT8 *p_ret, UINT8 ret_len)
+{
+    UINT8   evt[255];
+    UINT8   *p = evt;
+
+    UINT8_TO_STREAM (p, 1);
+    UINT16_TO_STREAM (p, opcode);
+    UINT8_TO_STREAM (p, status);
+    if (ret_len > sizeof(evt) - 4)
+        ret_len = sizeof(evt) - 4;
+    memcpy(p, p_ret, ret_len);
+
+    btemu_evt(HCI_COMMAND_COMPLETE_EVT, evt, (UINT8)(4 + ret_len));
+}
+
+/*******************************************************************************
+**
+** Function         btemu_cmd_status
+**
+** Description      Queues a Command Status event.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_cmd_status(UINT16 opcode, UINT8 status)
+{
+    UINT8   evt[4];
+    UINT8   *p = evt;
+
+    UINT8_TO_STREAM (p, status);
+    UINT8_TO_STREAM (p, 1);
+    UINT16_TO_STREAM (p, opcode);
+
+    btemu_evt(HCI_COMMAND_STATUS_EVT, evt, sizeof(evt));
+}
+
+/*******************************************************************************
+**
+** Function         btemu_link_evt
+**
+** Description      Queues the completion event of a link command: status,
+**                  handle, then p_data.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_link_evt(UINT8 code, UINT16 handle, const UINT8 *p_data, UINT8 len)
+{
+    UINT8   evt[3 + 248];
+    UINT8   *p = evt;
+
+    UINT8_TO_STREAM (p, HCI_SUCCESS);
+    UINT16_TO_STREAM (p, handle);
+    memcpy(p, p_data, len);
+
+    btemu_evt(code, evt, (UINT8)(3 + len));
+}
+
+/*******************************************************************************
+**
+** Function         btemu_peer_index
+**
+** Description      Decodes the address of an emulated peer of a kind.
+**
+** Returns          the peer index from 1, 0 if bd_addr is no such peer
+**
+*******************************************************************************/
+static UINT16 btemu_peer_index(const UINT8 *bd_addr, UINT8 kind)
+{
+    UINT16  idx;
+
+    if (memcmp(bd_addr, btemu_peer_base, 3) || (bd_addr[3] != kind))
+        return 0;
+
+    idx = (UINT16)((bd_addr[4] << 8) | bd_addr[5]);
+    if (idx > ((kind == BTEMU_PEER_KIND_LE) ? btemu_cb.cfg.num_le_peers : btemu_cb.cfg.num_br_peers))
+        return 0;
+    return idx;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_peer_addr
+**
+** Description      Makes the address of an emulated peer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_peer_addr(BD_ADDR bd_addr, UINT8 kind, UINT16 idx)
+{
+    memcpy(bd_addr, btemu_peer_base, BD_ADDR_LEN);
+    bd_addr[3] = kind;
+    bd_addr[4] = (UINT8)(idx >> 8);
+    bd_addr[5] = (UINT8)idx;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_find_conn
+**
+** Description      Finds a connection by handle.
+**
+** Returns          the connection, NULL if there is none
+**
+*******************************************************************************/
+static tBTEMU_CONN *btemu_find_conn(UINT16 handle)
+{
+    int xx;
+
+    for (xx = 0; xx < BTEMU_MAX_CONNS; xx++)
+    {
+        if (btemu_cb.conn[xx].in_use && (btemu_cb.conn[xx].handle == handle))
+            return &btemu_cb.conn[xx];
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_alloc_conn
+**
+** Description      Takes a free connection for bd_addr.
+**
+** Returns          the connection, NULL if all are in use
+**
+*******************************************************************************/
+static tBTEMU_CONN *btemu_alloc_conn(const UINT8 *bd_addr, BOOLEAN is_le)
+{
+    tBTEMU_CONN *p_conn;
+    int         xx;
+
+    for (xx = 0; xx < BTEMU_MAX_CONNS; xx++)
+    {
+        p_conn = &btemu_cb.conn[xx];
+        if (!p_conn->in_use)
+        {
+            memset(p_conn, 0, sizeof(*p_conn));
+            p_conn->in_use = TRUE;
+            p_conn->is_le = is_le;
+            memcpy(p_conn->bd_addr, bd_addr, BD_ADDR_LEN);
+
+            /* handles are not reused before they wrap */
+            p_conn->handle = btemu_cb.next_handle;
+            if (++btemu_cb.next_handle > HCI_DATA_HANDLE_MASK)
+                btemu_cb.next_handle = BTEMU_FIRST_HANDLE;
+
+            btemu_cb.stats.conns++;
+            return p_conn;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_free_conn
+**
+** Description      Drops a connection. Its packets still in controller buffers
+**                  are flushed: the host counts them as completed on the
+**                  Disconnection Complete.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_free_conn(tBTEMU_CONN *p_conn)
+{
+    UINT32  xx, idx;
+
+    for (xx = 0; xx < btemu_cb.buf_count; xx++)
+    {
+        idx = (btemu_cb.buf_first + xx) % btemu_cb.cfg.acl_num_bufs;
+        if (btemu_cb.p_bufs[idx].handle == p_conn->handle)
+            btemu_cb.p_bufs[idx].handle = 0;
+    }
+    p_conn->in_use = FALSE;
+    btemu_cb.stats.disconns++;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_create_conn
+**
+** Description      Pages a peer. Emulated BR/EDR peers answer, anything else
+**                  times out.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_create_conn(UINT8 *p)
+{
+    tBTEMU_CONN *p_conn = NULL;
+    BD_ADDR     bd_addr;
+    UINT8       evt[11];
+    UINT8       *pp = evt;
+    UINT8       status = HCI_SUCCESS;
+
+    STREAM_TO_BDADDR (bd_addr, p);
+
+    if (!btemu_peer_index(bd_addr, BTEMU_PEER_KIND_BR))
+        status = HCI_ERR_PAGE_TIMEOUT;
+    else if ((p_conn = btemu_alloc_conn(bd_addr, FALSE)) == NULL)
+        status = HCI_ERR_MAX_NUM_OF_CONNECTIONS;
+
+    UINT8_TO_STREAM (pp, status);
+    UINT16_TO_STREAM (pp, (p_conn != NULL) ? p_conn->handle : 0);
+    BDADDR_TO_STREAM (pp, bd_addr);
+    UINT8_TO_STREAM (pp, HCI_LINK_TYPE_ACL);
+    UINT8_TO_STREAM (pp, HCI_ENCRYPT_MODE_DISABLED);
+
+    btemu_evt(HCI_CONNECTION_COMP_EVT, evt, sizeof(evt));
+}
+
+/*******************************************************************************
+**
+** Function         btemu_le_conn_cmpl
+**
+** Description      Queues an LE Connection Complete for the LE connection
+**                  being created.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_le_conn_cmpl(UINT8 status)
+{
+    tBTEMU_CONN *p_conn = NULL;
+    UINT8       evt[19];
+    UINT8       *pp = evt;
+
+    if ((status == HCI_SUCCESS) &&
+        ((p_conn = btemu_alloc_conn(btemu_cb.le_conn_addr, TRUE)) == NULL))
+        status = HCI_ERR_MAX_NUM_OF_CONNECTIONS;
+
+    btemu_cb.le_conn_pending = FALSE;
+
+    UINT8_TO_STREAM (pp, HCI_BLE_CONN_COMPLETE_EVT);
+    UINT8_TO_STREAM (pp, status);
+    UINT16_TO_STREAM (pp, (p_conn != NULL) ? p_conn->handle : 0);
+    UINT8_TO_STREAM (pp, HCI_ROLE_MASTER);
+    UINT8_TO_STREAM (pp, BTEMU_ADDR_PUBLIC);
+    BDADDR_TO_STREAM (pp, btemu_cb.le_conn_addr);
+    UINT16_TO_STREAM (pp, 0x0018);      /* interval, 30 ms     */
+    UINT16_TO_STREAM (pp, 0);           /* slave latency       */
+    UINT16_TO_STREAM (pp, 0x01F4);      /* supervision, 5 s    */
+    UINT8_TO_STREAM (pp, 0);            /* master clock accuracy */
+
+    btemu_evt(HCI_BLE_EVENT, evt, (UINT8)(pp - evt));
+}
+
+/*******************************************************************************
+**
+** Function         btemu_num_completed
+**
+** Description      Releases the controller buffers due by now_ns, loops the
+**                  packets of loopback peers back and reports the completions
+**                  in one Number Of Completed Packets event.
+**
+** Returns          the time the next buffer is due
+**
+*******************************************************************************/
+static uint64_t btemu_num_completed(uint64_t now_ns)
+{
+    tBTEMU_ACL_BUF  *p_buf;
+    tBTEMU_CONN     *p_conn;
+    UINT8           evt[1 + 4 * BTEMU_MAX_CONNS];
+    UINT8           *p = evt + 1;
+    UINT16          handle;
+    int             xx;
+
+    while (btemu_cb.buf_count)
+    {
+        p_buf = &btemu_cb.p_bufs[btemu_cb.buf_first];
+        if (p_buf->due_ns > now_ns)
+            break;
+
+        if ((p_buf->handle != 0) && ((p_conn = btemu_find_conn(p_buf->handle)) != NULL))
+        {
+            p_conn->num_completed++;
+            btemu_cb.stats.acl_completed++;
+
+            if (btemu_cb.cfg.acl_mode == BTEMU_ACL_LOOPBACK)
+            {
+                /* the controller only ever sends automatically flushable starts */
+                handle = p_buf->p_data[0] | (p_buf->p_data[1] << 8);
+                if (((handle >> BTEMU_PB_SHIFT) & 0x03) == BTEMU_PB_FIRST_NON_FLUSH)
+                    p_buf->p_data[1] |= (BTEMU_PB_FIRST_FLUSH << BTEMU_PB_SHIFT) >> 8;
+
+                btemu_out(BTEMU_H4_ACL, p_buf->p_data, HCI_DATA_PREAMBLE_SIZE,
+                          p_buf->p_data + HCI_DATA_PREAMBLE_SIZE,
+                          p_buf->len - HCI_DATA_PREAMBLE_SIZE);
+                btemu_cb.stats.acl_tx++;
+            }
+        }
+
+        btemu_cb.buf_first = (btemu_cb.buf_first + 1) % btemu_cb.cfg.acl_num_bufs;
+        btemu_cb.buf_count--;
+    }
+
+    evt[0] = 0;
+    for (xx = 0; xx < BTEMU_MAX_CONNS; xx++)
+    {
+        if (btemu_cb.conn[xx].in_use && btemu_cb.conn[xx].num_completed)
+        {
+            UINT16_TO_STREAM (p, btemu_cb.conn[xx].handle);
+            UINT16_TO_STREAM (p, btemu_cb.conn[xx].num_completed);
+            btemu_cb.conn[xx].num_completed = 0;
+            evt[0]++;
+        }
+    }
+    if (evt[0])
+    {
+        btemu_evt(HCI_NUM_COMPL_DATA_PKTS_EVT, evt, (UINT8)(p - evt));
+        btemu_cb.stats.nocp_evts++;
+    }
+
+    return btemu_cb.buf_count ? btemu_cb.p_bufs[btemu_cb.buf_first].due_ns : BTEMU_NEVER;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_acl_rx
+**
+** Description      Takes a controller buffer for an ACL packet from the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_acl_rx(UINT8 *p, UINT16 len)
+{
+    tBTEMU_ACL_BUF  *p_buf;
+    UINT16          handle;
+
+    handle = (p[0] | (p[1] << 8)) & HCI_DATA_HANDLE_MASK;
+
+    btemu_cb.stats.acl_rx++;
+    btemu_cb.stats.acl_rx_bytes += len - HCI_DATA_PREAMBLE_SIZE;
+
+    if ((btemu_find_conn(handle) == NULL) ||
+        (len - HCI_DATA_PREAMBLE_SIZE > btemu_cb.cfg.acl_data_len))
+    {
+        btemu_cb.stats.acl_bad++;
+        return;
+    }
+
+    if (btemu_cb.buf_count == btemu_cb.cfg.acl_num_bufs)
+    {
+        /* the host sent more than it was given buffers for */
+        btemu_cb.stats.buf_overruns++;
+        if (btemu_cb.cfg.verbose)
+            fprintf(stderr, "btemu: ACL packet on handle 0x%03x with no buffer free\n", handle);
+        return;
+    }
+
+    p_buf = &btemu_cb.p_bufs[(btemu_cb.buf_first + btemu_cb.buf_count) % btemu_cb.cfg.acl_num_bufs];
+    p_buf->due_ns = btemu_now_ns() + btemu_cb.cfg.nocp_latency_us * BTEMU_NS_PER_US;
+    p_buf->handle = handle;
+    p_buf->len = len;
+    memcpy(p_buf->p_data, p, len);
+
+    if (++btemu_cb.buf_count > btemu_cb.stats.bufs_in_use_max)
+        btemu_cb.stats.bufs_in_use_max = btemu_cb.buf_count;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_inq_result
+**
+** Description      Queues the inquiry result of a BR/EDR peer in the format of
+**                  the inquiry mode.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_inq_result(UINT16 idx)
+{
+    BD_ADDR bd_addr;
+    UINT8   evt[1 + 14 + HCI_EXT_INQ_RESPONSE_LEN];
+    UINT8   *p = evt;
+    char    name[32];
+    UINT8   name_len;
+
+    btemu_peer_addr(bd_addr, BTEMU_PEER_KIND_BR, idx);
+
+    UINT8_TO_STREAM (p, 1);
+    BDADDR_TO_STREAM (p, bd_addr);
+    UINT8_TO_STREAM (p, 0x01);                      /* page scan repetition mode R1 */
+    if (btemu_cb.inq_mode == BTEMU_INQ_MODE_STANDARD)
+    {
+        UINT8_TO_STREAM (p, 0);                     /* reserved */
+        UINT8_TO_STREAM (p, 0);
+    }
+    else
+        UINT8_TO_STREAM (p, 0);                     /* reserved */
+    DEVCLASS_TO_STREAM (p, btemu_cod);
+    UINT16_TO_STREAM (p, (UINT16)(idx & 0x7FFF));   /* clock offset */
+
+    if (btemu_cb.inq_mode == BTEMU_INQ_MODE_STANDARD)
+    {
+        btemu_evt(HCI_INQUIRY_RESULT_EVT, evt, (UINT8)(p - evt));
+        return;
+    }
+
+    INT8_TO_STREAM (p, -40 - (idx % 40));           /* RSSI */
+    if (btemu_cb.inq_mode == BTEMU_INQ_MODE_RSSI)
+    {
+        btemu_evt(HCI_INQUIRY_RSSI_RESULT_EVT, evt, (UINT8)(p - evt));
+        return;
+    }
+
+    memset(p, 0, HCI_EXT_INQ_RESPONSE_LEN);
+    name_len = (UINT8)snprintf(name, sizeof(name), "%s br %u", BTEMU_NAME, idx);
+    UINT8_TO_STREAM (p, 1 + name_len);
+    UINT8_TO_STREAM (p, HCI_EIR_COMPLETE_LOCAL_NAME_TYPE);
+    memcpy(p, name, name_len);
+    btemu_evt(HCI_EXTENDED_INQUIRY_RESULT_EVT, evt, 15 + HCI_EXT_INQ_RESPONSE_LEN);
+}
+
+/*******************************************************************************
+**
+** Function         btemu_inquiry
+**
+** Description      Sends the inquiry results due by now_ns, and Inquiry
+**                  Complete after the last.
+**
+** Returns          the time the next result is due
+**
+*******************************************************************************/
+static uint64_t btemu_inquiry(uint64_t now_ns)
+{
+    UINT8   status = HCI_SUCCESS;
+
+    if (!btemu_cb.inq_active)
+        return BTEMU_NEVER;
+
+    while (btemu_cb.inq_next_ns <= now_ns)
+    {
+        if ((btemu_cb.inq_next_peer > btemu_cb.cfg.num_br_peers) ||
+            (btemu_cb.inq_max_rsp && (btemu_cb.inq_num_rsp >= btemu_cb.inq_max_rsp)))
+        {
+            btemu_cb.inq_active = FALSE;
+            btemu_evt(HCI_INQUIRY_COMP_EVT, &status, 1);
+            return BTEMU_NEVER;
+        }
+
+        btemu_inq_result(btemu_cb.inq_next_peer++);
+        btemu_cb.inq_num_rsp++;
+        btemu_cb.stats.inq_results++;
+        btemu_cb.inq_next_ns += btemu_cb.cfg.inq_interval_us * BTEMU_NS_PER_US;
+    }
+    return btemu_cb.inq_next_ns;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_adv_report
+**
+** Description      Queues the LE advertising report of an LE peer.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_adv_report(UINT16 idx)
+{
+    BD_ADDR bd_addr;
+    UINT8   evt[3 + 6 + 1 + 31 + 1 + 1];
+    UINT8   *p = evt;
+    UINT8   *p_len;
+    char    name[24];
+    UINT8   name_len;
+
+    btemu_peer_addr(bd_addr, BTEMU_PEER_KIND_LE, idx);
+    name_len = (UINT8)snprintf(name, sizeof(name), "%s le %u", BTEMU_NAME, idx);
+
+    UINT8_TO_STREAM (p, HCI_BLE_ADV_PKT_RPT_EVT);
+    UINT8_TO_STREAM (p, 1);
+    UINT8_TO_STREAM (p, BTEMU_ADV_IND);
+    UINT8_TO_STREAM (p, BTEMU_ADDR_PUBLIC);
+    BDADDR_TO_STREAM (p, bd_addr);
+    p_len = p++;
+    UINT8_TO_STREAM (p, 2);
+    UINT8_TO_STREAM (p, HCI_EIR_FLAGS_TYPE);
+    UINT8_TO_STREAM (p, BTEMU_ADV_FLAGS);
+    UINT8_TO_STREAM (p, 1 + name_len);
+    UINT8_TO_STREAM (p, HCI_EIR_COMPLETE_LOCAL_NAME_TYPE);
+    memcpy(p, name, name_len);
+    p += name_len;
+    *p_len = (UINT8)(p - p_len - 1);
+    INT8_TO_STREAM (p, -50 - (idx % 40));           /* RSSI */
+
+    btemu_evt(HCI_BLE_EVENT, evt, (UINT8)(p - evt));
+}
+
+/*******************************************************************************
+**
+** Function         btemu_scan
+**
+** Description      Sends the LE advertising reports due by now_ns, going round
+**                  the LE peers at adv_rate reports a second.
+**
+** Returns          the time the next report is due
+**
+*******************************************************************************/
+static uint64_t btemu_scan(uint64_t now_ns)
+{
+    UINT16  idx;
+    int     num = 0;
+
+    if (!btemu_cb.scan_active || !btemu_cb.cfg.num_le_peers || !btemu_cb.adv_period_ns)
+        return BTEMU_NEVER;
+
+    while ((btemu_cb.adv_next_ns <= now_ns) && (num++ < BTEMU_MAX_ADV_PER_PASS))
+    {
+        idx = btemu_cb.adv_next_peer;
+        if (++btemu_cb.adv_next_peer > btemu_cb.cfg.num_le_peers)
+            btemu_cb.adv_next_peer = 1;
+        btemu_cb.adv_next_ns += btemu_cb.adv_period_ns;
+
+        if (btemu_cb.scan_filter_dup)
+        {
+            if (btemu_cb.p_adv_seen[idx >> 3] & (1 << (idx & 7)))
+                continue;
+            btemu_cb.p_adv_seen[idx >> 3] |= (UINT8)(1 << (idx & 7));
+        }
+
+        /* a controller drops reports it has no room for */
+        if (btemu_cb.tx_len > BTEMU_TX_HIGH_WATER)
+        {
+            btemu_cb.stats.adv_dropped++;
+            continue;
+        }
+        btemu_adv_report(idx);
+        btemu_cb.stats.adv_reports++;
+    }
+
+    /* do not try to catch up with more than one pass behind */
+    if (btemu_cb.adv_next_ns + BTEMU_MAX_ADV_PER_PASS * btemu_cb.adv_period_ns < now_ns)
+    {
+        btemu_cb.stats.adv_dropped += (now_ns - btemu_cb.adv_next_ns) / btemu_cb.adv_period_ns;
+        btemu_cb.adv_next_ns = now_ns;
+    }
+    return btemu_cb.adv_next_ns;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_cmd_rx
+**
+** Description      Handles an HCI command from the host.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void btemu_cmd_rx(UINT8 *p, UINT8 len)
+{
+    tBTEMU_CONN *p_conn;
+    UINT16      opcode, handle = 0;
+    UINT8       ret[255];
+    UINT8       *pp = ret;
+    UINT8       evt[255];
+    UINT8       *pe = evt;
+    UINT8       mode;
+    UINT32      xx;
+
+    STREAM_TO_UINT16 (opcode, p);
+    p++;
+    len -= HCIC_PREAMBLE_SIZE;
+    if (len >= 2)
+        handle = (p[0] | (p[1] << 8)) & HCI_DATA_HANDLE_MASK;
+
+    memset(ret, 0, sizeof(ret));
+    memset(evt, 0, sizeof(evt));
+    btemu_cb.stats.cmds++;
+
+    if (btemu_cb.cfg.verbose > 1)
+        fprintf(stderr, "btemu: command 0x%04x\n", opcode);
+
+    switch (opcode)
+    {
+        case HCI_RESET:
+            btemu_reset();
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 0);
+            break;
+
+        case HCI_READ_LOCAL_VERSION_INFO:
+            UINT8_TO_STREAM (pp, BTEMU_HCI_VERSION);
+            UINT16_TO_STREAM (pp, 0);
+            UINT8_TO_STREAM (pp, BTEMU_HCI_VERSION);
+            UINT16_TO_STREAM (pp, LMP_COMPID_BROADCOM);
+            UINT16_TO_STREAM (pp, 0);
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, (UINT8)(pp - ret));
+            break;
+
+        case HCI_READ_LOCAL_FEATURES:
+            /* 3 and 5 slot packets, RSSI and extended inquiry results, LE */
+            ret[0] = 0x03;
+            ret[HCI_FEATURE_INQ_RSSI_OFF] |= HCI_FEATURE_INQ_RSSI_MASK;
+            ret[HCI_FEATURE_EXT_INQ_RSP_OFF] |= HCI_FEATURE_EXT_INQ_RSP_MASK;
+            ret[BTEMU_FEATURE_LE_OFF] |= BTEMU_FEATURE_LE_MASK;
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_LOCAL_EXT_FEATURES:
+            ret[0] = p[0];
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 2 + HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_BUFFER_SIZE:
+            UINT16_TO_STREAM (pp, btemu_cb.cfg.acl_data_len);
+            UINT8_TO_STREAM (pp, 0);
+            UINT16_TO_STREAM (pp, btemu_cb.cfg.acl_num_bufs);
+            UINT16_TO_STREAM (pp, 0);
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, (UINT8)(pp - ret));
+            break;
+
+        case HCI_BLE_READ_BUFFER_SIZE:
+            /* no LE buffers of its own: LE links share the ACL ones */
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 3);
+            break;
+
+        case HCI_BLE_READ_WHITE_LIST_SIZE:
+            ret[0] = BTEMU_WHITE_LIST_SIZE;
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 1);
+            break;
+
+        case HCI_READ_BD_ADDR:
+            BDADDR_TO_STREAM (pp, btemu_cb.cfg.local_addr);
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, BD_ADDR_LEN);
+            break;
+
+        case HCI_READ_LOCAL_NAME:
+            strcpy((char *)ret, BTEMU_NAME);
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, BD_NAME_LEN);
+            break;
+
+        case HCI_WRITE_INQUIRY_MODE:
+            btemu_cb.inq_mode = p[0];
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 0);
+            break;
+
+        case HCI_INQUIRY:
+            /* LAP (3) and length (1) are ignored: results come at inq_interval_us */
+            if (btemu_cb.inq_active)
+            {
+                btemu_cmd_status(opcode, HCI_ERR_COMMAND_DISALLOWED);
+                break;
+            }
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_cb.inq_active = TRUE;
+            btemu_cb.inq_next_peer = 1;
+            btemu_cb.inq_num_rsp = 0;
+            btemu_cb.inq_max_rsp = p[4];
+            btemu_cb.inq_next_ns = btemu_now_ns();
+            break;
+
+        case HCI_INQUIRY_CANCEL:
+            btemu_cb.inq_active = FALSE;
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 0);
+            break;
+
+        case HCI_CREATE_CONNECTION:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_create_conn(p);
+            break;
+
+        case HCI_DISCONNECT:
+            if ((p_conn = btemu_find_conn(handle)) == NULL)
+            {
+                btemu_cmd_status(opcode, HCI_ERR_NO_CONNECTION);
+                break;
+            }
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_free_conn(p_conn);
+            UINT8_TO_STREAM (pe, HCI_ERR_CONN_CAUSE_LOCAL_HOST);
+            btemu_link_evt(HCI_DISCONNECTION_COMP_EVT, handle, evt, 1);
+            break;
+
+        case HCI_READ_RMT_FEATURES:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            evt[0] = 0x03;
+            btemu_link_evt(HCI_READ_RMT_FEATURES_COMP_EVT, handle, evt, HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_RMT_EXT_FEATURES:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            evt[0] = p[2];
+            btemu_link_evt(HCI_READ_RMT_EXT_FEATURES_COMP_EVT, handle, evt, 2 + HCI_NUM_FEATURE_BYTES);
+            break;
+
+        case HCI_READ_RMT_VERSION_INFO:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            UINT8_TO_STREAM (pe, BTEMU_HCI_VERSION);
+            UINT16_TO_STREAM (pe, LMP_COMPID_BROADCOM);
+            UINT16_TO_STREAM (pe, 0);
+            btemu_link_evt(HCI_READ_RMT_VERSION_COMP_EVT, handle, evt, (UINT8)(pe - evt));
+            break;
+
+        case HCI_READ_RMT_CLOCK_OFFSET:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_link_evt(HCI_READ_CLOCK_OFF_COMP_EVT, handle, evt, 2);
+            break;
+
+        case HCI_RMT_NAME_REQUEST:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            UINT8_TO_STREAM (pe, HCI_SUCCESS);
+            memcpy(pe, p, BD_ADDR_LEN);
+            snprintf((char *)pe + BD_ADDR_LEN, BD_NAME_LEN, "%s br %u", BTEMU_NAME,
+                     (p[1] << 8) | p[0]);
+            btemu_evt(HCI_RMT_NAME_REQUEST_COMP_EVT, evt, 1 + BD_ADDR_LEN + BD_NAME_LEN);
+            break;
+
+        case HCI_CHANGE_CONN_PACKET_TYPE:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_link_evt(HCI_CONN_PKT_TYPE_CHANGE_EVT, handle, p + 2, 2);
+            break;
+
+        case HCI_AUTHENTICATION_REQUESTED:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_link_evt(HCI_AUTHENTICATION_COMP_EVT, handle, evt, 0);
+            break;
+
+        case HCI_SET_CONN_ENCRYPTION:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_link_evt(HCI_ENCRYPTION_CHANGE_EVT, handle, p + 2, 1);
+            break;
+
+        case HCI_SNIFF_MODE:
+        case HCI_EXIT_SNIFF_MODE:
+        case HCI_HOLD_MODE:
+        case HCI_PARK_MODE:
+        case HCI_EXIT_PARK_MODE:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            if (opcode == HCI_SNIFF_MODE)
+                mode = HCI_MODE_SNIFF;
+            else if (opcode == HCI_HOLD_MODE)
+                mode = HCI_MODE_HOLD;
+            else if (opcode == HCI_PARK_MODE)
+                mode = HCI_MODE_PARK;
+            else
+                mode = HCI_MODE_ACTIVE;
+            UINT8_TO_STREAM (pe, mode);
+            UINT16_TO_STREAM (pe, 0);
+            btemu_link_evt(HCI_MODE_CHANGE_EVT, handle, evt, (UINT8)(pe - evt));
+            break;
+
+        case HCI_SWITCH_ROLE:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            UINT8_TO_STREAM (pe, HCI_SUCCESS);
+            memcpy(pe, p, BD_ADDR_LEN + 1);
+            btemu_evt(HCI_ROLE_CHANGE_EVT, evt, 1 + BD_ADDR_LEN + 1);
+            break;
+
+        case HCI_QOS_SETUP:
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            btemu_link_evt(HCI_QOS_SETUP_COMP_EVT, handle, p + 2, 18);
+            break;
+
+        case HCI_BLE_WRITE_SCAN_ENABLE:
+            btemu_cb.scan_active = (p[0] != 0);
+            btemu_cb.scan_filter_dup = (p[1] != 0);
+            if (btemu_cb.scan_active)
+            {
+                memset(btemu_cb.p_adv_seen, 0, btemu_cb.cfg.num_le_peers / 8 + 1);
+                btemu_cb.adv_next_peer = 1;
+                btemu_cb.adv_next_ns = btemu_now_ns();
+            }
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 0);
+            break;
+
+        case HCI_BLE_CREATE_LL_CONN:
+            /* peer address type and address follow interval, window and policy */
+            if (btemu_cb.le_conn_pending)
+            {
+                btemu_cmd_status(opcode, HCI_ERR_COMMAND_DISALLOWED);
+                break;
+            }
+            btemu_cmd_status(opcode, HCI_SUCCESS);
+            pp = p + 6;
+            STREAM_TO_BDADDR (btemu_cb.le_conn_addr, pp);
+            btemu_cb.le_conn_pending = TRUE;
+
+            /* anything else is never found, until the host cancels */
+            if (btemu_peer_index(btemu_cb.le_conn_addr, BTEMU_PEER_KIND_LE))
+                btemu_le_conn_cmpl(HCI_SUCCESS);
+            break;
+
+        case HCI_BLE_CREATE_CONN_CANCEL:
+            if (!btemu_cb.le_conn_pending)
+            {
+                btemu_cmd_cmpl(opcode, HCI_ERR_COMMAND_DISALLOWED, ret, 0);
+                break;
+            }
+            btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 0);
+            btemu_le_conn_cmpl(HCI_ERR_NO_CONNECTION);
+            break;
+
+        default:
+            if (HCI_OGF(opcode) == (HCI_GRP_LINK_CONTROL_CMDS >> 10))
+            {
+                /* cancels and pairing replies return the address they were given */
+                btemu_cmd_cmpl(opcode, HCI_SUCCESS, p, (len >= BD_ADDR_LEN) ? BD_ADDR_LEN : 0);
+                break;
+            }
+
+            for (xx = 0; xx < sizeof(btemu_cc_tbl) / sizeof(btemu_cc_tbl[0]); xx++)
+            {
+                if (btemu_cc_tbl[xx].opcode == opcode)
+                    break;
+            }
+            if (xx < sizeof(btemu_cc_tbl) / sizeof(btemu_cc_tbl[0]))
+            {
+                memcpy(ret, p, btemu_cc_tbl[xx].echo_len);
+                btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret,
+                               btemu_cc_tbl[xx].echo_len + btemu_cc_tbl[xx].zero_len);
+            }
+            else
+            {
+                /* settings, and vendor specific commands of the vendor libraries */
+                btemu_cmd_cmpl(opcode, HCI_SUCCESS, ret, 0);
+            }
+            break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         btemu_rx
+**
+** Description      Handles the complete H4 packets read from the host.
+**
+** Returns          FALSE if the framing is lost
+**
+*******************************************************************************/
+static BOOLEAN btemu_rx(void)
+{
+    UINT8   *p;
+    UINT32  used, pkt_len = 0;
+
+    for (used = 0; used < btemu_cb.rx_len; used += 1 + pkt_len)
+    {
+        p = btemu_cb.rx_buf + used;
+
+        if (p[0] == BTEMU_H4_CMD)
+        {
+            if (btemu_cb.rx_len - used < 1 + HCIC_PREAMBLE_SIZE)
+                break;
+            pkt_len = HCIC_PREAMBLE_SIZE + p[3];
+        }
+        else if (p[0] == BTEMU_H4_ACL)
+        {
+            if (btemu_cb.rx_len - used < 1 + HCI_DATA_PREAMBLE_SIZE)
+                break;
+            pkt_len = HCI_DATA_PREAMBLE_SIZE + (p[3] | (p[4] << 8));
+        }
+        else if (p[0] == BTEMU_H4_SCO)
+        {
+            if (btemu_cb.rx_len - used < 1 + HCI_SCO_PREAMBLE_SIZE)
+                break;
+            pkt_len = HCI_SCO_PREAMBLE_SIZE + p[3];
+        }
+        else
+        {
+            fprintf(stderr, "btemu: bad H4 packet type 0x%02x, dropping %u bytes\n",
+                    p[0], btemu_cb.rx_len - used);
+            btemu_cb.rx_len = 0;
+            return FALSE;
+        }
+
+        if (pkt_len + 1 > BTEMU_RX_BUF_SIZE)
+        {
+            fprintf(stderr, "btemu: H4 packet of %u bytes is too long\n", pkt_len);
+            btemu_cb.rx_len = 0;
+            return FALSE;
+        }
+        if (btemu_cb.rx_len - used < 1 + pkt_len)
+            break;
+
+        if (p[0] == BTEMU_H4_CMD)
+            btemu_cmd_rx(p + 1, (UINT8)pkt_len);
+        else if (p[0] == BTEMU_H4_ACL)
+            btemu_acl_rx(p + 1, (UINT16)pkt_len);
+    }
+
+    if (used < btemu_cb.rx_len)
+        memmove(btemu_cb.rx_buf, btemu_cb.rx_buf + used, btemu_cb.rx_len - used);
+    btemu_cb.rx_len -= used;
+    return TRUE;
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/*******************************************************************************
+**
+** Function         btemu_init
+**
+** Description      Sets up the emulator for a configuration.
+**
+** Returns          TRUE if the controller buffers could be allocated
+**
+*******************************************************************************/
+BOOLEAN btemu_init(const tBTEMU_CFG *p_cfg)
+{
+    UINT32  size = HCI_DATA_PREAMBLE_SIZE + p_cfg->acl_data_len;
+    UINT32  xx;
+
+    memset(&btemu_cb, 0, sizeof(btemu_cb));
+    btemu_cb.cfg = *p_cfg;
+    btemu_cb.fd = -1;
+    if (p_cfg->adv_rate)
+        btemu_cb.adv_period_ns = BTEMU_NS_PER_SEC / p_cfg->adv_rate;
+
+    btemu_cb.p_bufs = (tBTEMU_ACL_BUF *)calloc(p_cfg->acl_num_bufs, sizeof(tBTEMU_ACL_BUF));
+    btemu_cb.p_buf_mem = (UINT8 *)malloc(p_cfg->acl_num_bufs * size);
+    btemu_cb.p_adv_seen = (UINT8 *)calloc(p_cfg->num_le_peers / 8 + 1, 1);
+    if (!btemu_cb.p_bufs || !btemu_cb.p_buf_mem || !btemu_cb.p_adv_seen)
+        return FALSE;
+
+    for (xx = 0; xx < p_cfg->acl_num_bufs; xx++)
+        btemu_cb.p_bufs[xx].p_data = btemu_cb.p_buf_mem + xx * size;
+
+    btemu_reset();
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_reset
+**
+** Description      Brings the controller back to its power-on state: no
+**                  links, buffers all free, inquiry and scan off.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btemu_reset(void)
+{
+    int xx;
+
+    for (xx = 0; xx < BTEMU_MAX_CONNS; xx++)
+    {
+        if (btemu_cb.conn[xx].in_use)
+            btemu_free_conn(&btemu_cb.conn[xx]);
+    }
+    btemu_cb.next_handle = BTEMU_FIRST_HANDLE;
+    btemu_cb.buf_first = 0;
+    btemu_cb.buf_count = 0;
+    btemu_cb.inq_active = FALSE;
+    btemu_cb.inq_mode = BTEMU_INQ_MODE_STANDARD;
+    btemu_cb.scan_active = FALSE;
+    btemu_cb.le_conn_pending = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_run
+**
+** Description      Serves the host on fd until it hangs up or btemu_stop is
+**                  called. fd is made non-blocking.
+**
+** Returns          0 when the host hung up, -1 on stop or error
+**
+*******************************************************************************/
+int btemu_run(int fd)
+{
+    struct pollfd   pfd;
+    struct timespec ts;
+    uint64_t        now, next, due;
+    ssize_t         ret;
+    int             flags;
+
+    btemu_cb.fd = fd;
+    btemu_cb.rx_len = 0;
+    btemu_cb.tx_first = 0;
+    btemu_cb.tx_len = 0;
+    if ((flags = fcntl(fd, F_GETFL)) >= 0)
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    while (!btemu_cb.stopping)
+    {
+        if (btemu_cb.stats_requested)
+            btemu_print_stats(stdout);
+
+        now = btemu_now_ns();
+        next = btemu_num_completed(now);
+        if ((due = btemu_inquiry(now)) < next)
+            next = due;
+        if ((due = btemu_scan(now)) < next)
+            next = due;
+
+        if (!btemu_flush())
+            return 0;
+
+        pfd.fd = fd;
+        pfd.events = (btemu_cb.tx_len ? POLLOUT : 0) |
+                     ((btemu_cb.tx_len < BTEMU_TX_HIGH_WATER) ? POLLIN : 0);
+        pfd.revents = 0;
+
+        if (next != BTEMU_NEVER)
+        {
+            now = btemu_now_ns();
+            due = (next > now) ? next - now : 0;
+            ts.tv_sec = due / BTEMU_NS_PER_SEC;
+            ts.tv_nsec = due % BTEMU_NS_PER_SEC;
+        }
+        if (ppoll(&pfd, 1, (next != BTEMU_NEVER) ? &ts : NULL, NULL) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        if (pfd.revents & POLLIN)
+        {
+            ret = read(fd, btemu_cb.rx_buf + btemu_cb.rx_len, BTEMU_RX_BUF_SIZE - btemu_cb.rx_len);
+            if (ret == 0)
+                return 0;
+            if (ret < 0)
+            {
+                if ((errno == EINTR) || (errno == EAGAIN))
+                    continue;
+                /* a pty master reads EIO once the slave is closed */
+                return (errno == EIO) ? 0 : -1;
+            }
+            btemu_cb.rx_len += ret;
+            btemu_rx();
+        }
+        else if (pfd.revents & (POLLHUP | POLLERR))
+            return 0;
+    }
+    return -1;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_stop
+**
+** Description      Makes btemu_run return. May be called from a signal handler.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btemu_stop(void)
+{
+    btemu_cb.stopping = TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_request_stats
+**
+** Description      Has the counters printed to stdout from the loop. May be
+**                  called from a signal handler.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btemu_request_stats(void)
+{
+    btemu_cb.stats_requested = TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_stats
+**
+** Description      Returns the counters kept since btemu_init.
+**
+** Returns          the counters
+**
+*******************************************************************************/
+const tBTEMU_STATS *btemu_stats(void)
+{
+    return &btemu_cb.stats;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_print_stats
+**
+** Description      Prints the counters as one JSON object on a line.
+**
+** Returns          void
+**
+*******************************************************************************/
+void btemu_print_stats(FILE *p_out)
+{
+    const tBTEMU_STATS *p_st = &btemu_cb.stats;
+
+    btemu_cb.stats_requested = FALSE;
+    fprintf(p_out, "{\"cmds\":%llu,\"acl_rx\":%llu,\"acl_rx_bytes\":%llu,\"acl_tx\":%llu,"
+            "\"acl_completed\":%llu,\"nocp_evts\":%llu,\"bufs_in_use_max\":%u,"
+            "\"buf_overruns\":%llu,\"acl_bad\":%llu,\"inq_results\":%llu,"
+            "\"adv_reports\":%llu,\"adv_dropped\":%llu,\"conns\":%llu,\"disconns\":%llu}\n",
+            (unsigned long long)p_st->cmds, (unsigned long long)p_st->acl_rx,
+            (unsigned long long)p_st->acl_rx_bytes, (unsigned long long)p_st->acl_tx,
+            (unsigned long long)p_st->acl_completed, (unsigned long long)p_st->nocp_evts,
+            p_st->bufs_in_use_max, (unsigned long long)p_st->buf_overruns,
+            (unsigned long long)p_st->acl_bad, (unsigned long long)p_st->inq_results,
+            (unsigned long long)p_st->adv_reports, (unsigned long long)p_st->adv_dropped,
+            (unsigned long long)p_st->conns, (unsigned long long)p_st->disconns);
+    fflush(p_out);
+}
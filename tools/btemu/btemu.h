@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      btemu.h
+ *
+ *  Description:   Userspace HCI controller emulator
+ *
+ *                 The emulator speaks H4 on a file descriptor: the master of
+ *                 a pty the userial layer opens like a UART, or a connected
+ *                 stream socket. It answers HCI commands from a fixed
+ *                 controller description, pages and LE-connects emulated
+ *                 peers, injects inquiry results and LE advertising reports,
+ *                 and completes ACL packets after a configurable latency out
+ *                 of a pool of controller buffers of configurable size.
+ *
+ ******************************************************************************/
+
+#ifndef BTEMU_H
+#define BTEMU_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bt_types.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+/* Peers are 00:1b:dc:<kind>:<index high>:<index low>, index from 1 */
+#define BTEMU_PEER_ADDR_BASE    {0x00, 0x1b, 0xdc, 0x00, 0x00, 0x00}
+#define BTEMU_PEER_KIND_BR      0x00        /* answers page and inquiry */
+#define BTEMU_PEER_KIND_LE      0x01        /* advertises, accepts LE connections */
+
+#define BTEMU_MAX_BR_PEERS      1000
+#define BTEMU_MAX_LE_PEERS      65535
+
+/* What an emulated peer does with ACL data sent to it */
+#define BTEMU_ACL_LOOPBACK      0           /* sends every packet back as received */
+#define BTEMU_ACL_SINK          1           /* consumes it                         */
+
+/*******************************************************************************
+**  Type definitions
+********************************************************************************/
+
+typedef struct
+{
+    BD_ADDR     local_addr;
+    UINT16      acl_data_len;       /* HCI_Read_Buffer_Size: ACL data length  */
+    UINT16      acl_num_bufs;       /* HCI_Read_Buffer_Size: ACL buffer count */
+    UINT32      nocp_latency_us;    /* ACL packet in to Number Of Completed Packets */
+    UINT8       acl_mode;           /* BTEMU_ACL_LOOPBACK or BTEMU_ACL_SINK   */
+    UINT16      num_br_peers;
+    UINT16      num_le_peers;
+    UINT32      inq_interval_us;    /* between two inquiry results            */
+    UINT32      adv_rate;           /* LE advertising reports per second, all peers */
+    UINT8       verbose;
+} tBTEMU_CFG;
+
+typedef struct
+{
+    uint64_t    cmds;
+    uint64_t    acl_rx;             /* ACL packets from the host              */
+    uint64_t    acl_rx_bytes;
+    uint64_t    acl_tx;             /* ACL packets to the host                */
+    uint64_t    nocp_evts;
+    uint64_t    acl_completed;
+    UINT32      bufs_in_use_max;
+    uint64_t    buf_overruns;       /* packets sent with no controller buffer free */
+    uint64_t    acl_bad;            /* unknown handle or longer than the buffers */
+    uint64_t    inq_results;
+    uint64_t    adv_reports;
+    uint64_t    adv_dropped;        /* reports not sent: the host was not reading */
+    uint64_t    conns;
+    uint64_t    disconns;
+} tBTEMU_STATS;
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+extern BOOLEAN btemu_init (const tBTEMU_CFG *p_cfg);
+extern void btemu_reset (void);
+extern int btemu_run (int fd);
+extern void btemu_stop (void);
+extern void btemu_request_stats (void);
+extern const tBTEMU_STATS *btemu_stats (void);
+extern void btemu_print_stats (FILE *p_out);
+
+#endif /* BTEMU_H */
@@ -0,0 +1,295 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Filename:      btemu_main.c
+ *
+ *  Description:   btemu, a userspace HCI controller emulator
+ *
+ *                 Exposes the emulated controller on a unix stream socket,
+ *                 serving one host at a time, that userial connects to when
+ *                 BT_HCI_SOCKET names it. With -p it is a pty instead,
+ *                 reachable through a symlink the vendor library can be
+ *                 pointed at with BT_UART_PORT. Counters are printed to
+ *                 stdout as JSON on SIGUSR1 and on exit.
+ *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "btemu.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BTEMU_DEFAULT_SOCKET        "/tmp/btemu.sock"
+#define BTEMU_DEFAULT_ACL_LEN       1021
+#define BTEMU_DEFAULT_ACL_BUFS      8
+#define BTEMU_DEFAULT_NOCP_US       0
+#define BTEMU_DEFAULT_BR_PEERS      8
+#define BTEMU_DEFAULT_LE_PEERS      100
+#define BTEMU_DEFAULT_INQ_US        10000
+#define BTEMU_DEFAULT_ADV_RATE      1000
+
+#define BTEMU_LOCAL_ADDR            {0x00, 0x1b, 0xdc, 0xff, 0x00, 0x01}
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static volatile sig_atomic_t btemu_exiting;
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static void btemu_usage(const char *p_prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -u path          unix socket to listen on (default %s)\n"
+            "  -p path          serve a pty instead, symlinked from path\n"
+            "  -A bytes         ACL data length of a controller buffer (default %d)\n"
+            "  -B count         controller ACL buffers (default %d)\n"
+            "  -l us            latency from ACL packet to its completion (default %d)\n"
+            "  -m mode          ACL data sent to peers: loopback or sink (default loopback)\n"
+            "  -n count         BR/EDR peers, found by inquiry and paged (default %d, max %d)\n"
+            "  -N count         LE peers, advertising while scanned (default %d, max %d)\n"
+            "  -i us            interval between inquiry results (default %d)\n"
+            "  -r rate          LE advertising reports per second (default %d)\n"
+            "  -v               verbose, twice to trace every command\n"
+            "  -h               this help\n"
+            "Peers are 00:1b:dc:00:xx:xx (BR/EDR) and 00:1b:dc:01:xx:xx (LE), from 1.\n",
+            p_prog, BTEMU_DEFAULT_SOCKET, BTEMU_DEFAULT_ACL_LEN, BTEMU_DEFAULT_ACL_BUFS,
+            BTEMU_DEFAULT_NOCP_US, BTEMU_DEFAULT_BR_PEERS, BTEMU_MAX_BR_PEERS,
+            BTEMU_DEFAULT_LE_PEERS, BTEMU_MAX_LE_PEERS, BTEMU_DEFAULT_INQ_US,
+            BTEMU_DEFAULT_ADV_RATE);
+}
+
+static void btemu_sig_stop(int sig)
+{
+    btemu_exiting = 1;
+    btemu_stop();
+}
+
+static void btemu_sig_stats(int sig)
+{
+    btemu_request_stats();
+}
+
+/*******************************************************************************
+**
+** Function         btemu_serve_pty
+**
+** Description      Serves hosts on a pty. The emulator keeps the slave open
+**                  itself, so hosts can close and reopen it; a host starts
+**                  over with HCI_Reset.
+**
+** Returns          process exit status
+**
+*******************************************************************************/
+static int btemu_serve_pty(const char *p_link)
+{
+    struct termios  tio;
+    struct stat     st;
+    char            *p_slave;
+    int             master, slave;
+
+    if (((master = posix_openpt(O_RDWR | O_NOCTTY)) < 0) ||
+        (grantpt(master) < 0) || (unlockpt(master) < 0) ||
+        ((p_slave = ptsname(master)) == NULL) ||
+        ((slave = open(p_slave, O_RDWR | O_NOCTTY)) < 0))
+    {
+        perror("btemu: pty");
+        return 1;
+    }
+
+    /* raw until the host sets it up, so nothing is echoed or translated */
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    /* only ever replace a symlink */
+    if ((lstat(p_link, &st) == 0) && S_ISLNK(st.st_mode))
+        unlink(p_link);
+    if (symlink(p_slave, p_link) < 0)
+    {
+        perror(p_link);
+        return 1;
+    }
+    fprintf(stderr, "btemu: controller on %s (%s)\n", p_slave, p_link);
+
+    while (!btemu_exiting && (btemu_run(master) == 0))
+        ;
+
+    unlink(p_link);
+    close(slave);
+    close(master);
+    return 0;
+}
+
+/*******************************************************************************
+**
+** Function         btemu_serve_socket
+**
+** Description      Serves hosts on a unix stream socket, one at a time. Each
+**                  host gets a controller just out of reset.
+**
+** Returns          process exit status
+**
+*******************************************************************************/
+static int btemu_serve_socket(const char *p_path)
+{
+    struct sockaddr_un  addr;
+    int                 srv, fd, ret = 0;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, p_path, sizeof(addr.sun_path) - 1);
+    unlink(p_path);
+
+    if (((srv = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) ||
+        (bind(srv, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+        (listen(srv, 1) < 0))
+    {
+        perror(p_path);
+        return 1;
+    }
+    fprintf(stderr, "btemu: controller on %s\n", p_path);
+
+    while (!btemu_exiting)
+    {
+        if ((fd = accept(srv, NULL, NULL)) < 0)
+        {
+            if (errno == EINTR)
+            {
+                if (!btemu_exiting)
+                    btemu_print_stats(stdout);
+                continue;
+            }
+            perror("btemu: accept");
+            ret = 1;
+            break;
+        }
+
+        btemu_reset();
+        btemu_run(fd);
+        close(fd);
+    }
+
+    close(srv);
+    unlink(p_path);
+    return ret;
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    static const BD_ADDR local_addr = BTEMU_LOCAL_ADDR;
+    tBTEMU_CFG          cfg;
+    struct sigaction    sa;
+    const char          *p_link = NULL;
+    const char          *p_sock = BTEMU_DEFAULT_SOCKET;
+    int                 opt, ret;
+
+    memset(&cfg, 0, sizeof(cfg));
+    memcpy(cfg.local_addr, local_addr, BD_ADDR_LEN);
+    cfg.acl_data_len = BTEMU_DEFAULT_ACL_LEN;
+    cfg.acl_num_bufs = BTEMU_DEFAULT_ACL_BUFS;
+    cfg.nocp_latency_us = BTEMU_DEFAULT_NOCP_US;
+    cfg.acl_mode = BTEMU_ACL_LOOPBACK;
+    cfg.num_br_peers = BTEMU_DEFAULT_BR_PEERS;
+    cfg.num_le_peers = BTEMU_DEFAULT_LE_PEERS;
+    cfg.inq_interval_us = BTEMU_DEFAULT_INQ_US;
+    cfg.adv_rate = BTEMU_DEFAULT_ADV_RATE;
+
+    while ((opt = getopt(argc, argv, "p:u:A:B:l:m:n:N:i:r:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p': p_link = optarg; break;
+            case 'u': p_sock = optarg; break;
+            case 'A': cfg.acl_data_len = (UINT16)atoi(optarg); break;
+            case 'B': cfg.acl_num_bufs = (UINT16)atoi(optarg); break;
+            case 'l': cfg.nocp_latency_us = (UINT32)atoi(optarg); break;
+            case 'n': cfg.num_br_peers = (UINT16)atoi(optarg); break;
+            case 'N': cfg.num_le_peers = (UINT16)atoi(optarg); break;
+            case 'i': cfg.inq_interval_us = (UINT32)atoi(optarg); break;
+            case 'r': cfg.adv_rate = (UINT32)atoi(optarg); break;
+            case 'v': cfg.verbose++; break;
+            case 'm':
+                if (!strcmp(optarg, "loopback"))
+                    cfg.acl_mode = BTEMU_ACL_LOOPBACK;
+                else if (!strcmp(optarg, "sink"))
+                    cfg.acl_mode = BTEMU_ACL_SINK;
+                else
+                {
+                    btemu_usage(argv[0]);
+                    return 2;
+                }
+                break;
+            default:
+                btemu_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if ((cfg.acl_data_len == 0) || (cfg.acl_num_bufs == 0) ||
+        (cfg.num_br_peers > BTEMU_MAX_BR_PEERS))
+    {
+        fprintf(stderr, "btemu: bad option value\n");
+        return 2;
+    }
+
+    if (!btemu_init(&cfg))
+    {
+        fprintf(stderr, "btemu: out of memory\n");
+        return 1;
+    }
+
+    /* no SA_RESTART: signals have to interrupt the loop */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = btemu_sig_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sa.sa_handler = btemu_sig_stats;
+    sigaction(SIGUSR1, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    ret = (p_link != NULL) ? btemu_serve_pty(p_link) : btemu_serve_socket(p_sock);
+
+    btemu_print_stats(stdout);
+    return ret;
+}
@@ -0,0 +1,346 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2001-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Decodes the binary trace file written by the deferred trace backend
+ *  (TraceRing=binary in bt_stack.conf) into the usual text form.
+ *
+ *  usage: bttrace_decode <trace file>
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BTE_TRACE_FILE_FORMAT_ONLY
+#include "bte_trace_ring.h"
+#include "bt_types.h"
+
+#define BTTRACE_MSG_SIZE    1024
+
+typedef struct
+{
+    uint64_t    fmt_id;
+    char        *p_fmt;
+} tBTTRACE_FMT;
+
+static tBTTRACE_FMT *bttrace_fmt;
+static uint32_t     bttrace_fmt_size;
+static uint32_t     bttrace_num_fmt;
+
+static const char * const bttrace_layer_tags[] = {
+    "bt-btif", "bt-usb", "bt-serial", "bt-socket", "bt-rs232", "bt-lc", "bt-lm",
+    "bt-hci", "bt-l2cap", "bt-rfcomm", "bt-sdp", "bt-tcs", "bt-obex", "bt-btm",
+    "bt-gap", "bt-dun", "bt-goep", "bt-icp", "bt-hsp2", "bt-spp", "bt-ctp",
+    "bt-bpp", "bt-hcrp", "bt-ftp", "bt-opp", "bt-btu", "bt-gki", "bt-bnep",
+    "bt-pan", "bt-hfp", "bt-hid", "bt-bip", "bt-avp", "bt-a2d", "bt-sap",
+    "bt-amp", "bt-mca", "bt-att", "bt-smp", "bt-nfc", "bt-nci", "bt-idep",
+    "bt-ndep", "bt-llcp", "bt-rw", "bt-ce", "bt-snep", "bt-ndef", "bt-nfa",
+};
+
+static const char * const bttrace_type_tags[] = { "E", "W", "I", "I", "D" };
+
+/*******************************************************************************
+**
+** Function         bttrace_scan_fmt
+**
+** Description      Same count of conversions as bte_trace_scan_fmt() in the
+**                  stack, used to check a record against its format.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bttrace_scan_fmt(const char *p_fmt, tBTE_TRACE_FMT_INFO *p_info)
+{
+    const char *p = p_fmt;
+
+    p_info->nargs = 0;
+    p_info->str_mask = 0;
+    p_info->inline_only = 0;
+
+    while ((p = strchr(p, '%')) != NULL)
+    {
+        p++;
+        if (*p == '%')
+        {
+            p++;
+            continue;
+        }
+
+        while (*p != 0 && strchr("-+ #0123456789.*hlLqjzt", *p) != NULL)
+        {
+            if (*p == '*')
+                p_info->nargs++;
+            p++;
+        }
+        if (*p == 0)
+            break;
+
+        if ((p_info->nargs >= BTE_TRACE_MAX_ARGS) || (strchr("eEfFgGaA", *p) != NULL))
+        {
+            p_info->inline_only = 1;
+            break;
+        }
+        if (*p == 's')
+            p_info->str_mask |= (uint8_t)(1 << p_info->nargs);
+        p_info->nargs++;
+        p++;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         bttrace_fmt_slot
+**
+** Description      Finds the entry of a format id in the format table.
+**
+** Returns          the entry, with p_fmt NULL if the id is not known
+**
+*******************************************************************************/
+static tBTTRACE_FMT *bttrace_fmt_slot(uint64_t fmt_id)
+{
+    uint32_t idx = (uint32_t)(((fmt_id >> 3) * 2654435761U) & (bttrace_fmt_size - 1));
+
+    while (bttrace_fmt[idx].p_fmt != NULL && bttrace_fmt[idx].fmt_id != fmt_id)
+        idx = (idx + 1) & (bttrace_fmt_size - 1);
+
+    return &bttrace_fmt[idx];
+}
+
+/*******************************************************************************
+**
+** Function         bttrace_add_fmt
+**
+** Description      Stores a format string record, growing the table at half
+**                  full.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bttrace_add_fmt(uint64_t fmt_id, const char *p_data, uint32_t len)
+{
+    tBTTRACE_FMT    *p_old = bttrace_fmt;
+    tBTTRACE_FMT    *p_entry;
+    uint32_t        old_size = bttrace_fmt_size;
+    uint32_t        xx;
+
+    if (bttrace_num_fmt + 1 > bttrace_fmt_size / 2)
+    {
+        bttrace_fmt_size = (old_size == 0) ? 4096 : old_size * 2;
+        if ((bttrace_fmt = calloc(bttrace_fmt_size, sizeof(tBTTRACE_FMT))) == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        for (xx = 0; xx < old_size; xx++)
+        {
+            if (p_old[xx].p_fmt != NULL)
+                *bttrace_fmt_slot(p_old[xx].fmt_id) = p_old[xx];
+        }
+        free(p_old);
+    }
+
+    p_entry = bttrace_fmt_slot(fmt_id);
+    if (p_entry->p_fmt != NULL)
+        free(p_entry->p_fmt);
+    else
+        bttrace_num_fmt++;
+
+    p_entry->fmt_id = fmt_id;
+    p_entry->p_fmt = malloc(len + 1);
+    memcpy(p_entry->p_fmt, p_data, len);
+    p_entry->p_fmt[len] = 0;
+}
+
+/*******************************************************************************
+**
+** Function         bttrace_print_prefix
+**
+** Description      Prints the wall clock time, thread and tag of a message.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bttrace_print_prefix(int64_t real_ns, uint32_t tid, uint32_t trace_set_mask)
+{
+    struct tm   tm;
+    time_t      t = (time_t)(real_ns / 1000000000LL);
+    uint32_t    layer = TRACE_GET_LAYER(trace_set_mask);
+    uint32_t    type = TRACE_GET_TYPE(trace_set_mask);
+
+    localtime_r(&t, &tm);
+    printf("%02d:%02d:%02d.%06d %5u %s %-9s ", tm.tm_hour, tm.tm_min, tm.tm_sec,
+           (int)((real_ns / 1000) % 1000000), (unsigned)tid,
+           (type < sizeof(bttrace_type_tags) / sizeof(bttrace_type_tags[0])) ? bttrace_type_tags[type] : "?",
+           (layer < sizeof(bttrace_layer_tags) / sizeof(bttrace_layer_tags[0])) ? bttrace_layer_tags[layer] : "bt-?");
+}
+
+/*******************************************************************************
+**
+** Function         bttrace_print_evt
+**
+** Description      Formats an event record. The strings of the record are
+**                  only used where both the record and the format say the
+**                  argument is a string, and only within the record.
+**
+** Returns          void
+**
+*******************************************************************************/
+static void bttrace_print_evt(int64_t realtime_offset_ns, const uint8_t *p, uint32_t len)
+{
+    tBTE_TRACE_EVT      evt;
+    tBTE_TRACE_FMT_INFO info;
+    tBTTRACE_FMT        *p_entry;
+    uint64_t            raw[BTE_TRACE_MAX_ARGS];
+    unsigned long       a[BTE_TRACE_MAX_ARGS];
+    char                str[128 + 1];
+    char                msg[BTTRACE_MSG_SIZE];
+    uint8_t             xx;
+
+    if (len < sizeof(evt))
+        return;
+    memcpy(&evt, p, sizeof(evt));
+    p += sizeof(evt);
+    len -= sizeof(evt);
+
+    if ((evt.nargs > BTE_TRACE_MAX_ARGS) || (evt.str_len > sizeof(str) - 1) ||
+        (len != 8U * evt.nargs + evt.str_len))
+    {
+        printf("<bad event record>\n");
+        return;
+    }
+    memcpy(raw, p, 8 * evt.nargs);
+    memcpy(str, p + 8 * evt.nargs, evt.str_len);
+    str[evt.str_len] = 0;
+
+    bttrace_print_prefix((int64_t)evt.ts_ns + realtime_offset_ns, evt.tid, evt.trace_set_mask);
+
+    p_entry = bttrace_fmt_slot(evt.fmt_id);
+    if (p_entry->p_fmt == NULL)
+    {
+        printf("<unknown format 0x%llx>\n", (unsigned long long)evt.fmt_id);
+        return;
+    }
+
+    bttrace_scan_fmt(p_entry->p_fmt, &info);
+    if ((info.str_mask & ((1 << evt.nargs) - 1)) != evt.str_mask)
+    {
+        printf("<arguments do not match format \"%s\">\n", p_entry->p_fmt);
+        return;
+    }
+
+    memset(a, 0, sizeof(a));
+    for (xx = 0; xx < evt.nargs; xx++)
+    {
+        if ((evt.str_mask & (1 << xx)) == 0)
+            a[xx] = (unsigned long)raw[xx];
+        else if (raw[xx] < evt.str_len)
+            a[xx] = (unsigned long)(uintptr_t)&str[raw[xx]];
+        else if (raw[xx] == BTE_TRACE_STR_NULL)
+            a[xx] = (unsigned long)(uintptr_t)"(null)";
+        else
+            a[xx] = (unsigned long)(uintptr_t)"";
+    }
+    /* conversions the caller gave no argument for read a string of "" */
+    for (; xx < info.nargs; xx++)
+    {
+        if (info.str_mask & (1 << xx))
+            a[xx] = (unsigned long)(uintptr_t)"";
+    }
+
+    snprintf(msg, sizeof(msg), p_entry->p_fmt, a[0], a[1], a[2], a[3], a[4], a[5]);
+    printf("%s\n", msg);
+}
+
+int main(int argc, char *argv[])
+{
+    tBTE_TRACE_FILE_HDR hdr;
+    tBTE_TRACE_REC_HDR  rec;
+    FILE                *p_file;
+    uint8_t             data[0x10000];
+    uint64_t            fmt_id;
+    uint32_t            lost[2];
+    uint32_t            len;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+    if ((p_file = fopen(argv[1], "rb")) == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if ((fread(&hdr, sizeof(hdr), 1, p_file) != 1) || (hdr.magic != BTE_TRACE_FILE_MAGIC) ||
+        (hdr.version != BTE_TRACE_FILE_VERSION) || (hdr.hdr_len < sizeof(hdr)) ||
+        (fseek(p_file, hdr.hdr_len, SEEK_SET) != 0))
+    {
+        fprintf(stderr, "%s: not a trace file\n", argv[1]);
+        return 1;
+    }
+
+    while (fread(&rec, sizeof(rec), 1, p_file) == 1)
+    {
+        if (rec.len < sizeof(rec))
+        {
+            fprintf(stderr, "corrupt record, stopping\n");
+            break;
+        }
+        len = rec.len - sizeof(rec);
+        if (fread(data, 1, len, p_file) != len)
+        {
+            fprintf(stderr, "truncated record, stopping\n");
+            break;
+        }
+
+        switch (rec.type)
+        {
+            case BTE_TRACE_REC_FMT:
+                if (len >= sizeof(fmt_id))
+                {
+                    memcpy(&fmt_id, data, sizeof(fmt_id));
+                    bttrace_add_fmt(fmt_id, (const char *)&data[sizeof(fmt_id)], len - sizeof(fmt_id));
+                }
+                break;
+
+            case BTE_TRACE_REC_EVT:
+                bttrace_print_evt(hdr.realtime_offset_ns, data, len);
+                break;
+
+            case BTE_TRACE_REC_LOST:
+                if (len >= sizeof(lost))
+                {
+                    memcpy(lost, data, sizeof(lost));
+                    printf("--- %u messages of thread %u lost ---\n", (unsigned)lost[1], (unsigned)lost[0]);
+                }
+                break;
+
+            default:
+                /* skip records of later versions */
+                break;
+        }
+    }
+
+    fclose(p_file);
+    return 0;
+}
@@ -24,7 +24,8 @@
 
 #define UIPC_CH_ID_AV_CTRL  0
 #define UIPC_CH_ID_AV_AUDIO 1
-#define UIPC_CH_NUM         2
+#define UIPC_CH_ID_AV_AUDIO_SINK 2  /* decoded PCM received from a remote A2DP source */
+#define UIPC_CH_NUM         3
 
 #define UIPC_CH_ID_ALL      3   /* used to address all the ch id at once */
 
@@ -127,6 +128,32 @@ UDRV_API extern BOOLEAN UIPC_Send(tUIPC_CH_ID ch_id, UINT16 msg_evt, UINT8 *p_bu
 *******************************************************************************/
 UDRV_API extern UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UINT32 len);
 
+/*******************************************************************************
+**
+** Function         UIPC_ReadPtr
+**
+** Description      Called to read a message in place from a channel using the
+**                  shared memory transport. Waits like UIPC_Read for len
+**                  bytes. *pp_buf is NULL if the channel is not on shared
+**                  memory. The data stays valid until UIPC_ReadRelease or
+**                  the next read on the channel, from the same task.
+**
+** Returns          the number of contiguous bytes at *pp_buf, up to len
+**
+*******************************************************************************/
+UDRV_API extern UINT32 UIPC_ReadPtr(tUIPC_CH_ID ch_id, UINT8 **pp_buf, UINT32 len);
+
+/*******************************************************************************
+**
+** Function         UIPC_ReadRelease
+**
+** Description      Called to consume len bytes returned by UIPC_ReadPtr.
+**
+** Returns          void
+**
+*******************************************************************************/
+UDRV_API extern void UIPC_ReadRelease(tUIPC_CH_ID ch_id, UINT32 len);
+
 /*******************************************************************************
 **
 ** Function         UIPC_Ioctl
@@ -41,6 +41,9 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <stdint.h>
 
 
 #include "gki.h"
@@ -69,6 +72,18 @@
 
 #define ANDROID_SOCKET_NAMESPACE_ABSTRACT 0
 
+/* offer the shared memory pcm ring on the audio data channel */
+#ifndef UIPC_SHM_INCLUDED
+#define UIPC_SHM_INCLUDED TRUE
+#endif
+
+/* largest UIPC_ReadPtr request linearized across the ring wrap */
+#define UIPC_SHM_BOUNCE_SZ 2048
+
+/* sink pcm a late reader has not taken yet, sent ahead of the next write;
+   a longer tail is written out blocking */
+#define UIPC_SINK_TAIL_SZ 8192
+
 /*****************************************************************************
 **  Local type definitions
 ******************************************************************************/
@@ -86,6 +101,15 @@ typedef struct {
     pthread_mutex_t cond_mutex;
     pthread_cond_t  cond;
     tUIPC_RCV_CBACK *cback;
+
+    /* shared memory transport. The ring read from is only swapped for the
+       one offered to the last peer (shm_next) by the reader itself */
+    tA2DP_SHM_HDR *shm;
+    UINT8 *shm_ring;
+    int shm_evtfd;
+    tA2DP_SHM_HDR *shm_next;
+    int shm_evtfd_next;
+    UINT8 shm_bounce[UIPC_SHM_BOUNCE_SZ];
 } tUIPC_CHAN;
 
 typedef struct {
@@ -99,6 +123,9 @@ typedef struct {
     int signal_fds[2];
 
     tUIPC_CHAN ch[UIPC_CH_NUM];
+
+    UINT8 sink_tail[UIPC_SINK_TAIL_SZ];
+    UINT16 sink_tail_len;
 } tUIPC_MAIN;
 
 
@@ -114,6 +141,8 @@ static tUIPC_MAIN uipc_main;
 ******************************************************************************/
 
 static int uipc_close_ch_locked(tUIPC_CH_ID ch_id);
+static void uipc_shm_offer_locked(tUIPC_CH_ID ch_id);
+static void uipc_shm_release_locked(tUIPC_CH_ID ch_id);
 
 /*****************************************************************************
 **  Externs
@@ -252,13 +281,12 @@ static int uipc_main_init(void)
     int i;
 #ifdef LINUX_NATIVE
 	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
 #else
     const pthread_mutexattr_t attr = PTHREAD_MUTEX_RECURSIVE;
 #endif
     pthread_mutex_init(&uipc_main.mutex, &attr);
-#ifdef LINUX_NATIVE
-	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-#endif
 
     BTIF_TRACE_EVENT0("### uipc_main_init ###");
 
@@ -280,6 +308,10 @@ static int uipc_main_init(void)
         pthread_cond_init(&p->cond, NULL);
         pthread_mutex_init(&p->cond_mutex, NULL);
         p->cback = NULL;
+        p->shm = NULL;
+        p->shm_evtfd = -1;
+        p->shm_next = NULL;
+        p->shm_evtfd_next = -1;
     }
 
     return 0;
@@ -294,9 +326,13 @@ void uipc_main_cleanup(void)
     close(uipc_main.signal_fds[0]);
     close(uipc_main.signal_fds[1]);
 
-    /* close any open channels */
+    /* close any open channels. The rings go too, as the only reader is the
+       task waiting in UIPC_Close for this thread to exit */
     for (i=0; i<UIPC_CH_NUM; i++)
+    {
         uipc_close_ch_locked(i);
+        uipc_shm_release_locked(i);
+    }
 }
 
 
@@ -351,6 +387,9 @@ static int uipc_check_fd_locked(tUIPC_CH_ID ch_id)
             return -1;
         }
 
+        if (ch_id == UIPC_CH_ID_AV_AUDIO)
+            uipc_shm_offer_locked(ch_id);
+
         if (uipc_main.ch[ch_id].cback)
             uipc_main.ch[ch_id].cback(ch_id, UIPC_OPEN_EVT);
     }
@@ -463,6 +502,15 @@ static void uipc_flush_locked(tUIPC_CH_ID ch_id)
 
         case UIPC_CH_ID_AV_AUDIO:
             uipc_flush_ch_locked(UIPC_CH_ID_AV_AUDIO);
+            if (uipc_main.ch[ch_id].shm)
+            {
+                uipc_main.ch[ch_id].shm->rd_idx = uipc_main.ch[ch_id].shm->wr_idx;
+                __sync_synchronize();
+            }
+            break;
+
+        case UIPC_CH_ID_AV_AUDIO_SINK:
+            uipc_flush_ch_locked(UIPC_CH_ID_AV_AUDIO_SINK);
             break;
     }
 }
@@ -495,6 +543,9 @@ static int uipc_close_ch_locked(tUIPC_CH_ID ch_id)
         wakeup = 1;
     }
 
+    if (ch_id == UIPC_CH_ID_AV_AUDIO_SINK)
+        uipc_main.sink_tail_len = 0;
+
     /* notify this connection is closed */
     if (uipc_main.ch[ch_id].cback)
         uipc_main.ch[ch_id].cback(ch_id, UIPC_CLOSE_EVT);
@@ -520,6 +571,257 @@ void uipc_close_locked(tUIPC_CH_ID ch_id)
     uipc_wakeup_locked();
 }
 
+/*****************************************************************************
+**
+**   shared memory transport
+**
+*****************************************************************************/
+
+static void uipc_shm_unmap(tA2DP_SHM_HDR **pp_shm, int *p_evtfd)
+{
+    if (*pp_shm)
+    {
+        munmap(*pp_shm, A2DP_SHM_HDR_SZ + A2DP_SHM_RING_SZ);
+        *pp_shm = NULL;
+    }
+
+    if (*p_evtfd >= 0)
+    {
+        close(*p_evtfd);
+        *p_evtfd = -1;
+    }
+}
+
+static void uipc_shm_release_locked(tUIPC_CH_ID ch_id)
+{
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
+
+    uipc_shm_unmap(&p->shm, &p->shm_evtfd);
+    p->shm_ring = NULL;
+    uipc_shm_unmap(&p->shm_next, &p->shm_evtfd_next);
+}
+
+/* sends the offer, with the memfd and eventfd of the ring as SCM_RIGHTS, or
+   A2DP_SHM_MAGIC_NONE alone so the peer does not wait for a ring */
+static int uipc_shm_send_offer(int fd, int memfd, int evtfd)
+{
+    unsigned int magic = (memfd >= 0) ? A2DP_SHM_MAGIC : A2DP_SHM_MAGIC_NONE;
+    char cmsg_buf[CMSG_SPACE(2 * sizeof(int))];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    int fds[2];
+
+    iov.iov_base = &magic;
+    iov.iov_len = sizeof(magic);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (memfd >= 0)
+    {
+        fds[0] = memfd;
+        fds[1] = evtfd;
+        msg.msg_control = cmsg_buf;
+        msg.msg_controllen = sizeof(cmsg_buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    }
+
+    return sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+/* maps a fresh pcm ring and offers it to the peer that just connected, or
+   tells it there is none. The ring is left in shm_next for the reader to
+   swap in, as the media task may still be encoding from the previous one */
+static void uipc_shm_offer_locked(tUIPC_CH_ID ch_id)
+{
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
+    tA2DP_SHM_HDR *shm = NULL;
+    int memfd = -1;
+    int evtfd = -1;
+#if (UIPC_SHM_INCLUDED == TRUE) && defined(__NR_memfd_create)
+    void *map;
+#endif
+
+    /* a ring the reader has not taken yet is not in use */
+    uipc_shm_unmap(&p->shm_next, &p->shm_evtfd_next);
+
+#if (UIPC_SHM_INCLUDED == TRUE) && defined(__NR_memfd_create)
+    memfd = syscall(__NR_memfd_create, "a2dp-pcm", 0);
+    if (memfd < 0)
+    {
+        BTIF_TRACE_EVENT1("shm not available (%s)", strerror(errno));
+    }
+    else if (ftruncate(memfd, A2DP_SHM_HDR_SZ + A2DP_SHM_RING_SZ) < 0 ||
+             (map = mmap(NULL, A2DP_SHM_HDR_SZ + A2DP_SHM_RING_SZ, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, memfd, 0)) == MAP_FAILED)
+    {
+        BTIF_TRACE_ERROR1("shm map failed (%s)", strerror(errno));
+    }
+    else
+    {
+        shm = (tA2DP_SHM_HDR *)map;
+        shm->magic = A2DP_SHM_MAGIC;
+        shm->ring_sz = A2DP_SHM_RING_SZ;
+
+        evtfd = eventfd(0, EFD_NONBLOCK);
+        if (evtfd < 0)
+        {
+            BTIF_TRACE_ERROR1("shm eventfd failed (%s)", strerror(errno));
+            uipc_shm_unmap(&shm, &evtfd);
+        }
+    }
+
+    if ((shm == NULL) && (memfd >= 0))
+    {
+        close(memfd);
+        memfd = -1;
+    }
+#endif
+
+    if (uipc_shm_send_offer(p->fd, memfd, evtfd) < 0)
+    {
+        BTIF_TRACE_ERROR1("shm offer failed (%s)", strerror(errno));
+        uipc_shm_unmap(&shm, &evtfd);
+    }
+    else if (shm)
+    {
+        BTIF_TRACE_EVENT2("OFFERED SHM RING ON CH %d (%d bytes)", ch_id, A2DP_SHM_RING_SZ);
+        p->shm_evtfd_next = evtfd;
+        __atomic_store_n(&p->shm_next, shm, __ATOMIC_RELEASE);
+    }
+
+    /* the peer holds its own reference from here on */
+    if (memfd >= 0)
+        close(memfd);
+}
+
+/* called by the reader only, before a read, so the ring it unmaps is not in
+   use any more: takes the ring offered to the last peer in its place */
+static void uipc_shm_swap(tUIPC_CH_ID ch_id)
+{
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
+
+    if (__atomic_load_n(&p->shm_next, __ATOMIC_ACQUIRE) == NULL)
+        return;
+
+    UIPC_LOCK();
+
+    if (p->shm_next)
+    {
+        uipc_shm_unmap(&p->shm, &p->shm_evtfd);
+        p->shm = p->shm_next;
+        p->shm_ring = (UINT8 *)p->shm + A2DP_SHM_HDR_SZ;
+        p->shm_evtfd = p->shm_evtfd_next;
+        p->shm_next = NULL;
+        p->shm_evtfd_next = -1;
+    }
+
+    UIPC_UNLOCK();
+}
+
+static BOOLEAN uipc_shm_attached(tUIPC_CH_ID ch_id)
+{
+    tA2DP_SHM_HDR *shm = uipc_main.ch[ch_id].shm;
+
+    if ((shm == NULL) || (shm->attached == 0))
+        return FALSE;
+
+    __sync_synchronize();
+    return TRUE;
+}
+
+/* waits until len bytes are in the ring, the poll timeout elapses or the
+   peer goes away. returns the bytes available, 0 once detached */
+static UINT32 uipc_shm_wait(tUIPC_CH_ID ch_id, UINT32 len)
+{
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
+    tA2DP_SHM_HDR *shm = p->shm;
+    struct pollfd pfd[2];
+    uint64_t count;
+    UINT32 avail;
+    char c;
+    int ret;
+
+    while ((avail = shm->wr_idx - shm->rd_idx) < len)
+    {
+        /* ask for the doorbell, then look again so a write in between is not missed */
+        shm->rd_waiting = 1;
+        __sync_synchronize();
+        if ((avail = shm->wr_idx - shm->rd_idx) >= len)
+            break;
+
+        pfd[0].fd = p->shm_evtfd;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        pfd[1].fd = p->fd;
+        pfd[1].events = POLLIN | POLLHUP;
+        pfd[1].revents = 0;
+
+        ret = poll(pfd, 2, p->read_poll_tmo_ms);
+
+        if (ret == 0)
+        {
+            BTIF_TRACE_EVENT1("shm poll timeout (%d ms)", p->read_poll_tmo_ms);
+            break;
+        }
+
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            BTIF_TRACE_EVENT1("shm poll failed (%s)", strerror(errno));
+            break;
+        }
+
+        /* nothing but a hang up is expected on the socket once attached */
+        if ((pfd[1].revents & (POLLHUP | POLLERR | POLLNVAL)) ||
+            ((pfd[1].revents & POLLIN) && (recv(p->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0)))
+        {
+            BTIF_TRACE_EVENT0("shm : channel detached remotely");
+            shm->rd_waiting = 0;
+            UIPC_LOCK();
+            uipc_close_locked(ch_id);
+            UIPC_UNLOCK();
+            return 0;
+        }
+
+        if (pfd[0].revents & POLLIN)
+            read(p->shm_evtfd, &count, sizeof(count));
+    }
+
+    shm->rd_waiting = 0;
+    __sync_synchronize();
+
+    return avail;
+}
+
+static UINT32 uipc_shm_read(tUIPC_CH_ID ch_id, UINT8 *p_buf, UINT32 len)
+{
+    tUIPC_CHAN *p = &uipc_main.ch[ch_id];
+    UINT32 n = uipc_shm_wait(ch_id, len);
+    UINT32 offset = p->shm->rd_idx & (A2DP_SHM_RING_SZ - 1);
+    UINT32 first;
+
+    if (n > len)
+        n = len;
+
+    first = A2DP_SHM_RING_SZ - offset;
+    if (first > n)
+        first = n;
+
+    memcpy(p_buf, p->shm_ring + offset, first);
+    memcpy(p_buf + first, p->shm_ring, n - first);
+
+    UIPC_ReadRelease(ch_id, n);
+
+    return n;
+}
+
 
 static void uipc_read_task(void *arg)
 {
@@ -661,6 +963,10 @@ UDRV_API BOOLEAN UIPC_Open(tUIPC_CH_ID ch_id, tUIPC_RCV_CBACK *p_cback)
         case UIPC_CH_ID_AV_AUDIO:
             uipc_setup_server_locked(ch_id, A2DP_DATA_PATH, p_cback);
             break;
+
+        case UIPC_CH_ID_AV_AUDIO_SINK:
+            uipc_setup_server_locked(ch_id, A2DP_SINK_DATA_PATH, p_cback);
+            break;
     }
 
     UIPC_UNLOCK();
@@ -720,6 +1026,57 @@ UDRV_API BOOLEAN UIPC_SendBuf(tUIPC_CH_ID ch_id, BT_HDR *p_msg)
     return FALSE;
 }
 
+/*******************************************************************************
+ **
+ ** Function         uipc_sink_send_locked
+ **
+ ** Description      Writes pcm to the sink reader without waiting for it. What
+ **                  a partial write leaves is kept and goes out first on the
+ **                  next call, so the reader never sees a broken sample; new
+ **                  pcm is dropped whole while an older tail is pending.
+ **
+ ** Returns          TRUE if p_buf was sent or kept, FALSE if dropped.
+ **
+ *******************************************************************************/
+static BOOLEAN uipc_sink_send_locked(int fd, UINT8 *p_buf, UINT16 msglen)
+{
+    ssize_t n;
+
+    if (uipc_main.sink_tail_len > 0)
+    {
+        n = send(fd, uipc_main.sink_tail, uipc_main.sink_tail_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0)
+        {
+            uipc_main.sink_tail_len -= n;
+            memmove(uipc_main.sink_tail, uipc_main.sink_tail + n, uipc_main.sink_tail_len);
+        }
+        if (uipc_main.sink_tail_len > 0)
+            return FALSE;
+    }
+
+    n = send(fd, p_buf, msglen, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0)
+        return FALSE;
+    if (n == msglen)
+        return TRUE;
+
+    p_buf += n;
+    msglen -= n;
+    if (msglen <= UIPC_SINK_TAIL_SZ)
+    {
+        memcpy(uipc_main.sink_tail, p_buf, msglen);
+        uipc_main.sink_tail_len = msglen;
+        return TRUE;
+    }
+
+    while ((msglen > 0) && ((n = send(fd, p_buf, msglen, MSG_NOSIGNAL)) > 0))
+    {
+        p_buf += n;
+        msglen -= n;
+    }
+    return (msglen == 0);
+}
+
 /*******************************************************************************
  **
  ** Function         UIPC_Send
@@ -732,12 +1089,24 @@ UDRV_API BOOLEAN UIPC_SendBuf(tUIPC_CH_ID ch_id, BT_HDR *p_msg)
 UDRV_API BOOLEAN UIPC_Send(tUIPC_CH_ID ch_id, UINT16 msg_evt, UINT8 *p_buf,
         UINT16 msglen)
 {
-    int n;
+    BOOLEAN sent;
 
     BTIF_TRACE_DEBUG2("UIPC_Send : ch_id:%d %d bytes", ch_id, msglen);
 
+    if (ch_id >= UIPC_CH_NUM)
+        return FALSE;
+
     UIPC_LOCK();
 
+    if (ch_id == UIPC_CH_ID_AV_AUDIO_SINK)
+    {
+        /* the media task must never stall on a slow pcm reader, and a reader
+           that went away is reported through the channel callback */
+        sent = uipc_sink_send_locked(uipc_main.ch[ch_id].fd, p_buf, msglen);
+        UIPC_UNLOCK();
+        return sent;
+    }
+
     if (write(uipc_main.ch[ch_id].fd, p_buf, msglen) < 0)
     {
         BTIF_TRACE_ERROR1("failed to write (%s)", strerror(errno));
@@ -797,6 +1166,10 @@ UDRV_API UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UI
     //BTIF_TRACE_DEBUG4("UIPC_Read : ch_id %d, len %d, fd %d, polltmo %d", ch_id, len,
     //        fd, uipc_main.ch[ch_id].read_poll_tmo_ms);
 
+    uipc_shm_swap(ch_id);
+    if (uipc_shm_attached(ch_id))
+        return uipc_shm_read(ch_id, p_buf, len);
+
     while (n_read < (int)len)
     {
         pfd.fd = fd;
@@ -847,6 +1220,76 @@ UDRV_API UINT32 UIPC_Read(tUIPC_CH_ID ch_id, UINT16 *p_msg_evt, UINT8 *p_buf, UI
     return n_read;
 }
 
+/*******************************************************************************
+ **
+ ** Function         UIPC_ReadPtr
+ **
+ ** Description      Called to read a message in place from a channel using the
+ **                  shared memory transport. Data wrapping around the end of
+ **                  the ring is copied once to keep it contiguous.
+ **
+ ** Returns          the number of contiguous bytes at *pp_buf, up to len
+ **
+ *******************************************************************************/
+
+UDRV_API UINT32 UIPC_ReadPtr(tUIPC_CH_ID ch_id, UINT8 **pp_buf, UINT32 len)
+{
+    tUIPC_CHAN *p;
+    UINT32 n, offset, first;
+
+    *pp_buf = NULL;
+
+    if ((ch_id >= UIPC_CH_NUM) || (uipc_main.ch[ch_id].fd == UIPC_DISCONNECTED))
+        return 0;
+
+    uipc_shm_swap(ch_id);
+    if (!uipc_shm_attached(ch_id))
+        return 0;
+
+    p = &uipc_main.ch[ch_id];
+    n = uipc_shm_wait(ch_id, len);
+    if (n > len)
+        n = len;
+
+    offset = p->shm->rd_idx & (A2DP_SHM_RING_SZ - 1);
+    first = A2DP_SHM_RING_SZ - offset;
+    *pp_buf = p->shm_ring + offset;
+
+    if (n > first)
+    {
+        if (n > UIPC_SHM_BOUNCE_SZ)
+            return first;
+
+        memcpy(p->shm_bounce, p->shm_ring + offset, first);
+        memcpy(p->shm_bounce + first, p->shm_ring, n - first);
+        *pp_buf = p->shm_bounce;
+    }
+
+    return n;
+}
+
+/*******************************************************************************
+ **
+ ** Function         UIPC_ReadRelease
+ **
+ ** Description      Called to consume len bytes returned by UIPC_ReadPtr.
+ **
+ ** Returns          void
+ **
+ *******************************************************************************/
+
+UDRV_API void UIPC_ReadRelease(tUIPC_CH_ID ch_id, UINT32 len)
+{
+    tA2DP_SHM_HDR *shm;
+
+    if ((ch_id >= UIPC_CH_NUM) || ((shm = uipc_main.ch[ch_id].shm) == NULL))
+        return;
+
+    /* done with the data before handing the space back to the writer */
+    __sync_synchronize();
+    shm->rd_idx += len;
+}
+
 /*******************************************************************************
 **
 ** Function         UIPC_Ioctl
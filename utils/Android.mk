@@ -10,7 +10,8 @@ LOCAL_CFLAGS += -Werror $(bdroid_CFLAGS)
 
 LOCAL_PRELINK_MODULE:=false
 LOCAL_SRC_FILES:= \
-    ./src/bt_utils.c
+    ./src/bt_utils.c \
+    ./src/bt_crc.c
 
 LOCAL_MODULE := libbt-utils
 LOCAL_MODULE_TAGS := optional
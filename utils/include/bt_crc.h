@@ -0,0 +1,37 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef BT_CRC_H
+#define BT_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/* CRC-16 (x^16 + x^15 + x^2 + 1), bit reversed: the L2CAP FCS.
+ * The caller seeds crc (0 for the FCS) and chains calls over a frame. */
+uint16_t bt_crc16(uint16_t crc, const uint8_t *p, size_t len);
+
+/* CRC-CCITT (x^16 + x^12 + x^5 + 1), bit reversed: the three-wire UART
+ * (H5) data integrity check, seeded with 0xffff. */
+uint16_t bt_crc16_ccitt(uint16_t crc, const uint8_t *p, size_t len);
+
+#endif /* BT_CRC_H */
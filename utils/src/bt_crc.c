@@ -0,0 +1,147 @@
+/******************************************************************************
+ *
+ *  Copyright (C) 2009-2012 Broadcom Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/************************************************************************************
+ *
+ *  Filename:      bt_crc.c
+ *
+ *  Description:   Bit reversed CRC-16 used by the transport and L2CAP
+ *
+ *  Both CRCs run eight bytes per step from eight tables of 256 entries
+ *  (slicing-by-8). Table n gives the CRC contribution of a byte followed
+ *  by n zero bytes, so the contributions of eight bytes can be looked up
+ *  independently and combined with XOR. The tables are built on first use.
+ *
+ ***********************************************************************************/
+
+#include <pthread.h>
+
+#include "bt_crc.h"
+
+/*******************************************************************************
+**  Constants & Macros
+********************************************************************************/
+
+#define BT_CRC16_POLY           0xa001      /* 0x8005 bit reversed */
+#define BT_CRC16_CCITT_POLY     0x8408      /* 0x1021 bit reversed */
+
+/*******************************************************************************
+**  Local type definitions
+********************************************************************************/
+
+typedef uint16_t tBT_CRC16_TBL[8][256];
+
+/*******************************************************************************
+**  Static variables
+********************************************************************************/
+
+static tBT_CRC16_TBL bt_crc16_tbl;
+static tBT_CRC16_TBL bt_crc16_ccitt_tbl;
+static pthread_once_t bt_crc_once = PTHREAD_ONCE_INIT;
+
+/*******************************************************************************
+**  Static functions
+********************************************************************************/
+
+static void bt_crc16_make_tbl(uint16_t poly, tBT_CRC16_TBL tbl)
+{
+    uint16_t crc;
+    int i, k;
+
+    for (i = 0; i < 256; i++)
+    {
+        crc = (uint16_t)i;
+        for (k = 0; k < 8; k++)
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ poly) : (uint16_t)(crc >> 1);
+        tbl[0][i] = crc;
+    }
+
+    for (k = 1; k < 8; k++)
+    {
+        for (i = 0; i < 256; i++)
+            tbl[k][i] = (uint16_t)((tbl[k - 1][i] >> 8) ^ tbl[0][tbl[k - 1][i] & 0xff]);
+    }
+}
+
+static void bt_crc_init(void)
+{
+    bt_crc16_make_tbl(BT_CRC16_POLY, bt_crc16_tbl);
+    bt_crc16_make_tbl(BT_CRC16_CCITT_POLY, bt_crc16_ccitt_tbl);
+}
+
+static uint16_t bt_crc16_slice8(const tBT_CRC16_TBL tbl, uint16_t crc, const uint8_t *p, size_t len)
+{
+    uint32_t lo, hi;
+
+    while (len >= 8)
+    {
+        lo = ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+              ((uint32_t)p[3] << 24)) ^ crc;
+        hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) |
+             ((uint32_t)p[7] << 24);
+
+        crc = tbl[7][lo & 0xff] ^ tbl[6][(lo >> 8) & 0xff] ^
+              tbl[5][(lo >> 16) & 0xff] ^ tbl[4][lo >> 24] ^
+              tbl[3][hi & 0xff] ^ tbl[2][(hi >> 8) & 0xff] ^
+              tbl[1][(hi >> 16) & 0xff] ^ tbl[0][hi >> 24];
+
+        p += 8;
+        len -= 8;
+    }
+
+    while (len--)
+        crc = (uint16_t)((crc >> 8) ^ tbl[0][(crc ^ *p++) & 0xff]);
+
+    return crc;
+}
+
+/*******************************************************************************
+**  Functions
+********************************************************************************/
+
+/*****************************************************************************
+**
+** Function        bt_crc16
+**
+** Description     Runs the L2CAP FCS CRC over len bytes from p, starting
+**                 from crc.
+**
+** Returns         The updated CRC
+**
+*******************************************************************************/
+uint16_t bt_crc16(uint16_t crc, const uint8_t *p, size_t len)
+{
+    pthread_once(&bt_crc_once, bt_crc_init);
+    return bt_crc16_slice8(bt_crc16_tbl, crc, p, len);
+}
+
+/*****************************************************************************
+**
+** Function        bt_crc16_ccitt
+**
+** Description     Runs the H5 data integrity check CRC over len bytes from
+**                 p, starting from crc.
+**
+** Returns         The updated CRC
+**
+*******************************************************************************/
+uint16_t bt_crc16_ccitt(uint16_t crc, const uint8_t *p, size_t len)
+{
+    pthread_once(&bt_crc_once, bt_crc_init);
+    return bt_crc16_slice8(bt_crc16_ccitt_tbl, crc, p, len);
+}